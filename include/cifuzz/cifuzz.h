@@ -9,6 +9,9 @@
 #include <stddef.h>
 #include <stdint.h>
 #endif
+#if defined(__APPLE__) && !defined(_MSC_VER)
+#include <dlfcn.h>
+#endif
 
 #if defined(__CLION_IDE__) && defined(__cplusplus)
 /* This code will only be seen by CLion's static analysis/preprocessing engine
@@ -70,12 +73,7 @@ static const int DOCTEST_ANON_VAR_15771531 =    \
 #define CIFUZZ_GENERATED_CORPUS NULL
 #endif
 
-#define FUZZ_TEST                                                                \
-static void LLVMFuzzerTestOneInputNoReturn(const uint8_t *data, size_t size);    \
-CIFUZZ_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {  \
-  LLVMFuzzerTestOneInputNoReturn(data, size);                                    \
-  return 0;                                                                      \
-}                                                                                \
+#define CIFUZZ_TEST_METADATA                                                     \
 CIFUZZ_C_LINKAGE const char *cifuzz_test_name(void) {                            \
   return CIFUZZ_TEST_NAME;                                                       \
 }                                                                                \
@@ -84,10 +82,102 @@ CIFUZZ_C_LINKAGE const char *cifuzz_seed_corpus(void) {
 }                                                                                \
 CIFUZZ_C_LINKAGE const char *cifuzz_generated_corpus(void) {                     \
   return CIFUZZ_GENERATED_CORPUS;                                                \
+}
+
+/* Defines cifuzz_call_reset, which calls the function defined with
+ * FUZZ_TEST_RESET if there is one. This has to be expanded exactly once per
+ * fuzz test, which the definition of LLVMFuzzerTestOneInput ensures. The
+ * approaches to referencing an optional symbol follow those of libFuzzer:
+ * https://github.com/llvm/llvm-project/blob/0c8c05064d57fe3bbbb1edd4c6e67f909c720578/compiler-rt/lib/fuzzer/FuzzerExtFunctionsWindows.cpp */
+#if defined(_MSC_VER)
+/* MSVC does not support weak symbols, but /alternatename can be used to
+ * direct the linker to a default implementation. */
+#define CIFUZZ_RESET_CALLER                                                      \
+CIFUZZ_C_LINKAGE void cifuzz_test_reset(void);                                   \
+CIFUZZ_C_LINKAGE void cifuzz_test_reset_default(void) {}                         \
+__pragma(comment(linker,                                                         \
+    "/alternatename:cifuzz_test_reset=cifuzz_test_reset_default"))              \
+static void cifuzz_call_reset(void) {                                            \
+  cifuzz_test_reset();                                                           \
+}
+#elif defined(__APPLE__)
+/* Weak references require specifying -U on the command line on macOS, hence
+ * use dlsym to find the function. */
+#ifdef __cplusplus
+#define CIFUZZ_RESET_FROM_DLSYM(ptr) \
+  reinterpret_cast<void (*)(void)>(reinterpret_cast<uintptr_t>(ptr))
+#else
+#define CIFUZZ_RESET_FROM_DLSYM(ptr) ((void (*)(void)) ptr)
+#endif
+#define CIFUZZ_RESET_CALLER                                                      \
+static void cifuzz_call_reset(void) {                                            \
+  static int looked_up = 0;                                                      \
+  static void (*reset)(void) = NULL;                                             \
+  if (!looked_up) {                                                              \
+    reset = CIFUZZ_RESET_FROM_DLSYM(dlsym(RTLD_DEFAULT, "cifuzz_test_reset"));   \
+    looked_up = 1;                                                               \
+  }                                                                              \
+  if (reset != NULL) {                                                           \
+    reset();                                                                     \
+  }                                                                              \
+}
+#else
+#define CIFUZZ_RESET_CALLER                                                      \
+CIFUZZ_C_LINKAGE __attribute__((weak)) void cifuzz_test_reset(void);             \
+static void cifuzz_call_reset(void) {                                            \
+  if (cifuzz_test_reset != NULL) {                                               \
+    cifuzz_test_reset();                                                         \
+  }                                                                              \
+}
+#endif
+
+#define FUZZ_TEST                                                                \
+static void LLVMFuzzerTestOneInputNoReturn(const uint8_t *data, size_t size);    \
+CIFUZZ_RESET_CALLER                                                              \
+CIFUZZ_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {  \
+  LLVMFuzzerTestOneInputNoReturn(data, size);                                    \
+  cifuzz_call_reset();                                                           \
+  return 0;                                                                      \
 }                                                                                \
+CIFUZZ_TEST_METADATA                                                             \
 CLION_TEST_PLAY_BUTTON                                                           \
 void LLVMFuzzerTestOneInputNoReturn
 
+/* An input of a FUZZ_TEST_BATCH. */
+typedef struct cifuzz_input {
+  const uint8_t *data;
+  size_t size;
+} cifuzz_input;
+
+/* Defines a fuzz test that is handed an array of inputs at once, which allows
+ * it to set up expensive state once per batch rather than once per input:
+ *
+ *   FUZZ_TEST_BATCH(const cifuzz_input *inputs, size_t num_inputs) { ... }
+ *
+ * Engines that support batches call cifuzz_test_batch, all others, such as
+ * libFuzzer, call LLVMFuzzerTestOneInput with batches of a single input. */
+#define FUZZ_TEST_BATCH                                                          \
+static void cifuzz_test_batch_no_return(const cifuzz_input *inputs,              \
+                                        size_t num_inputs);                      \
+CIFUZZ_RESET_CALLER                                                              \
+CIFUZZ_C_LINKAGE int cifuzz_test_batch(const cifuzz_input *inputs,               \
+                                       size_t num_inputs) {                      \
+  cifuzz_test_batch_no_return(inputs, num_inputs);                               \
+  cifuzz_call_reset();                                                           \
+  return 0;                                                                      \
+}                                                                                \
+CIFUZZ_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {  \
+  cifuzz_input input;                                                            \
+  input.data = data;                                                             \
+  input.size = size;                                                             \
+  cifuzz_test_batch_no_return(&input, 1);                                        \
+  cifuzz_call_reset();                                                           \
+  return 0;                                                                      \
+}                                                                                \
+CIFUZZ_TEST_METADATA                                                             \
+CLION_TEST_PLAY_BUTTON                                                           \
+void cifuzz_test_batch_no_return
+
 #define FUZZ_TEST_SETUP                                              \
 static void LLVMFuzzerInitializeNoReturn(void);                      \
 CIFUZZ_C_LINKAGE int LLVMFuzzerInitialize(int *argc, char ***argv) { \
@@ -98,4 +188,633 @@ CIFUZZ_C_LINKAGE int LLVMFuzzerInitialize(int *argc, char ***argv) { \
 }                                                                    \
 void LLVMFuzzerInitializeNoReturn
 
+/* Defines a function that is called after every input (or batch of inputs),
+ * both when fuzzing and when replaying. It can clear the state an input left
+ * behind, so that pools and caches built by FUZZ_TEST_SETUP can be kept
+ * instead of being rebuilt for every input:
+ *
+ *   FUZZ_TEST_RESET() { my_cache_clear_dirty(); }
+ *
+ * It isn't called after an input that crashes. */
+#define FUZZ_TEST_RESET                                                          \
+CIFUZZ_C_LINKAGE void cifuzz_test_reset(void);                                   \
+CIFUZZ_C_LINKAGE void cifuzz_test_reset
+
+/* Declares that the fuzz test can run several inputs at the same time on
+ * different threads, which lets the replayer run the inputs of a regression
+ * test with -threads in a single process that shares the state set up by
+ * FUZZ_TEST_SETUP:
+ *
+ *   FUZZ_TEST_THREAD_SAFE
+ *
+ * It has to be used at most once per fuzz test executable. */
+#define FUZZ_TEST_THREAD_SAFE                                                    \
+CIFUZZ_C_LINKAGE int cifuzz_test_thread_safe(void) {                             \
+  return 1;                                                                      \
+}
+
+/* A fuzz test or setup function registered with FUZZ_TEST_NAMED or
+ * FUZZ_TEST_NAMED_SETUP. */
+typedef struct cifuzz_registered_test {
+  const char *name;
+  void (*test)(const uint8_t *data, size_t size);
+  void (*setup)(void);
+  struct cifuzz_registered_test *next;
+} cifuzz_registered_test;
+
+/* Defined by cifuzz/registry.h. */
+CIFUZZ_C_LINKAGE void cifuzz_register_test(cifuzz_registered_test *test);
+CIFUZZ_C_LINKAGE void cifuzz_register_setup(cifuzz_registered_test *setup);
+
+/* Defines a function that runs before main. C++ uses a static initializer,
+ * GCC and clang support constructors in C and MSVC runs the function
+ * pointers in the .CRT$XCU section, which /include keeps from being
+ * discarded. */
+#if defined(__cplusplus)
+#define CIFUZZ_CONSTRUCTOR(fn)                                                   \
+static void fn(void);                                                            \
+static const int fn##_registered = (fn(), 0);                                    \
+static void fn(void)
+#elif defined(_MSC_VER)
+#ifdef _WIN64
+#define CIFUZZ_SYMBOL_PREFIX ""
+#else
+#define CIFUZZ_SYMBOL_PREFIX "_"
+#endif
+#pragma section(".CRT$XCU", read)
+#define CIFUZZ_CONSTRUCTOR(fn)                                                   \
+static void fn(void);                                                            \
+__declspec(allocate(".CRT$XCU")) void (*fn##_ptr)(void) = fn;                    \
+__pragma(comment(linker, "/include:" CIFUZZ_SYMBOL_PREFIX #fn "_ptr"))           \
+static void fn(void)
+#else
+#define CIFUZZ_CONSTRUCTOR(fn)                                                   \
+__attribute__((constructor)) static void fn(void)
+#endif
+
+/* Defines a fuzz test that is registered under |name|, which has to be a
+ * valid identifier, so that several fuzz tests can be linked into one
+ * executable. Exactly one of its source files has to include
+ * cifuzz/registry.h, which selects the fuzz test to run by the CIFUZZ_TEST
+ * environment variable:
+ *
+ *   FUZZ_TEST_NAMED(parse_header)(const uint8_t *data, size_t size) { ... }
+ *   FUZZ_TEST_NAMED_SETUP(parse_header)() { ... }
+ *
+ * In such an executable, FUZZ_TEST_RESET applies to all fuzz tests, the other
+ * FUZZ_TEST macros can't be used. */
+#define FUZZ_TEST_NAMED(name)                                                    \
+static void cifuzz_test_##name(const uint8_t *data, size_t size);                \
+static cifuzz_registered_test cifuzz_registered_test_##name = {                  \
+  #name, cifuzz_test_##name, NULL, NULL                                          \
+};                                                                               \
+CIFUZZ_CONSTRUCTOR(cifuzz_register_test_##name) {                                \
+  cifuzz_register_test(&cifuzz_registered_test_##name);                          \
+}                                                                                \
+static void cifuzz_test_##name
+
+/* Defines the setup function of the fuzz test registered under |name|, which
+ * is only called if that fuzz test is selected. */
+#define FUZZ_TEST_NAMED_SETUP(name)                                              \
+static void cifuzz_setup_##name(void);                                           \
+static cifuzz_registered_test cifuzz_registered_setup_##name = {                 \
+  #name, NULL, cifuzz_setup_##name, NULL                                         \
+};                                                                               \
+CIFUZZ_CONSTRUCTOR(cifuzz_register_setup_##name) {                               \
+  cifuzz_register_setup(&cifuzz_registered_setup_##name);                        \
+}                                                                                \
+static void cifuzz_setup_##name
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L || defined(_MSVC_LANG))
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "../fuzzer/FuzzedDataProvider.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+/* Provided by libFuzzer. Declared weak so that the mutator of
+ * FUZZ_TEST_TYPED_WITH_MUTATOR still links into replayer builds. */
+extern "C" __attribute__((weak)) size_t
+LLVMFuzzerMutate(uint8_t *data, size_t size, size_t max_size);
+#define CIFUZZ_HAS_WEAK_LLVM_FUZZER_MUTATE
+#endif
+
+namespace cifuzz {
+namespace internal {
+
+/* Collects the bytes of a serialized input. FuzzedDataProvider reads strings
+ * from the front of the data and all other values from the back. */
+class TypedInputWriter {
+ public:
+  void PushFront(uint8_t byte) { front_.push_back(byte); }
+  /* The bytes have to be pushed in the order they are consumed in. */
+  void PushBack(uint8_t byte) { back_.push_back(byte); }
+
+  /* Pushes the bytes ConsumeIntegralInRange consumes to return min + offset
+   * for a range of max - min. */
+  void PushIntegral(uint64_t range, uint64_t offset) {
+    size_t num_bytes = 0;
+    while (num_bytes < sizeof(uint64_t) &&
+           (range >> (num_bytes * CHAR_BIT)) > 0)
+      ++num_bytes;
+    /* The first byte consumed ends up as the most significant one. */
+    for (size_t i = num_bytes; i != 0; --i)
+      PushBack(static_cast<uint8_t>(offset >> ((i - 1) * CHAR_BIT)));
+  }
+
+  /* Pushes the bytes ConsumeRandomLengthString consumes to return str. */
+  void PushString(const char *str, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      if (str[i] == '\\')
+        PushFront('\\');
+      PushFront(static_cast<uint8_t>(str[i]));
+    }
+    /* A backslash followed by anything but another one ends the string. */
+    PushFront('\\');
+    PushFront('\n');
+  }
+
+  std::vector<uint8_t> Finish() const {
+    std::vector<uint8_t> result(front_);
+    result.insert(result.end(), back_.rbegin(), back_.rend());
+    return result;
+  }
+
+ private:
+  std::vector<uint8_t> front_;
+  std::vector<uint8_t> back_;
+};
+
+/* Decodes and encodes arguments of FUZZ_TEST_TYPED of type T. */
+template <typename T, typename Enable = void> struct TypedArgument {
+  static_assert(sizeof(T) == 0, "Unsupported FUZZ_TEST_TYPED argument type.");
+};
+
+template <> struct TypedArgument<bool> {
+  static bool Decode(FuzzedDataProvider &fdp) { return fdp.ConsumeBool(); }
+  static void Encode(const bool &value, TypedInputWriter &writer) {
+    writer.PushBack(value ? 1 : 0);
+  }
+};
+
+template <typename T>
+struct TypedArgument<
+    T, typename std::enable_if<std::is_integral<T>::value &&
+                               !std::is_same<T, bool>::value>::type> {
+  static T Decode(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeIntegral<T>();
+  }
+  static void Encode(const T &value, TypedInputWriter &writer) {
+    uint64_t min = static_cast<uint64_t>(std::numeric_limits<T>::min());
+    uint64_t max = static_cast<uint64_t>(std::numeric_limits<T>::max());
+    writer.PushIntegral(max - min, static_cast<uint64_t>(value) - min);
+  }
+};
+
+/* Enums have to start at 0, be contiguous and contain kMaxValue aliased to
+ * their largest value, see FuzzedDataProvider::ConsumeEnum. */
+template <typename T>
+struct TypedArgument<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+  static T Decode(FuzzedDataProvider &fdp) { return fdp.ConsumeEnum<T>(); }
+  static void Encode(const T &value, TypedInputWriter &writer) {
+    writer.PushIntegral(static_cast<uint32_t>(T::kMaxValue),
+                        static_cast<uint32_t>(value));
+  }
+};
+
+/* Serialized floating point numbers decode to the nearest value
+ * FuzzedDataProvider can produce, which isn't always the same. */
+template <typename T>
+struct TypedArgument<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  using Integral =
+      typename std::conditional<(sizeof(T) <= sizeof(uint32_t)), uint32_t,
+                                uint64_t>::type;
+
+  static T Decode(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeFloatingPoint<T>();
+  }
+  static void Encode(const T &value, TypedInputWriter &writer) {
+    writer.PushBack(value >= 0 ? 1 : 0);
+    writer.PushIntegral(std::numeric_limits<Integral>::max(),
+                        Probability(value));
+  }
+
+  /* ConsumeFloatingPoint splits the full range into two halves, the upper
+   * one starting at lowest + max == 0. Returns the integral that is scaled
+   * to the offset of value in its half. */
+  static Integral Probability(const T &value) {
+    T range = std::numeric_limits<T>::max();
+    T base = value >= 0 ? T(0) : std::numeric_limits<T>::lowest();
+    T scaled = (value - base) / range *
+               static_cast<T>(std::numeric_limits<Integral>::max());
+    Integral probability = std::numeric_limits<Integral>::max();
+    if (!(scaled >= 0))
+      probability = 0;
+    else if (scaled < static_cast<T>(std::numeric_limits<Integral>::max()))
+      probability = static_cast<Integral>(scaled + T(0.5));
+    return probability;
+  }
+
+  static T FromProbability(bool positive, Integral probability) {
+    T base = positive ? T(0) : std::numeric_limits<T>::lowest();
+    return base + std::numeric_limits<T>::max() *
+                      (static_cast<T>(probability) /
+                       static_cast<T>(std::numeric_limits<Integral>::max()));
+  }
+};
+
+template <> struct TypedArgument<std::string> {
+  static std::string Decode(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeRandomLengthString();
+  }
+  static void Encode(const std::string &value, TypedInputWriter &writer) {
+    writer.PushString(value.data(), value.size());
+  }
+};
+
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+/* Views into the input, valid until the fuzz test returns. */
+template <> struct TypedArgument<std::string_view> {
+  static std::string_view Decode(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeRandomLengthStringView();
+  }
+  static void Encode(const std::string_view &value, TypedInputWriter &writer) {
+    writer.PushString(value.data(), value.size());
+  }
+};
+#endif
+
+template <typename T> struct IsByte {
+  static constexpr bool value = std::is_integral<T>::value &&
+                                !std::is_same<T, bool>::value && sizeof(T) == 1;
+};
+
+/* Vectors of bytes are encoded like strings. */
+template <typename T>
+struct TypedArgument<std::vector<T>,
+                     typename std::enable_if<IsByte<T>::value>::type> {
+  static std::vector<T> Decode(FuzzedDataProvider &fdp) {
+    std::string bytes = fdp.ConsumeRandomLengthString();
+    return std::vector<T>(bytes.begin(), bytes.end());
+  }
+  static void Encode(const std::vector<T> &value, TypedInputWriter &writer) {
+    std::string bytes(value.begin(), value.end());
+    writer.PushString(bytes.data(), bytes.size());
+  }
+};
+
+/* All other vectors are encoded as a sequence of elements that are each
+ * preceded by a true bool and followed by a false one. */
+template <typename T>
+struct TypedArgument<std::vector<T>,
+                     typename std::enable_if<!IsByte<T>::value>::type> {
+  static std::vector<T> Decode(FuzzedDataProvider &fdp) {
+    std::vector<T> result;
+    while (fdp.ConsumeBool())
+      result.push_back(TypedArgument<T>::Decode(fdp));
+    return result;
+  }
+  static void Encode(const std::vector<T> &value, TypedInputWriter &writer) {
+    for (const T &element : value) {
+      writer.PushBack(1);
+      TypedArgument<T>::Encode(element, writer);
+    }
+    writer.PushBack(0);
+  }
+};
+
+template <typename T>
+using DecayedArgument = TypedArgument<typename std::decay<T>::type>;
+
+template <size_t... I> struct IndexSequence {};
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeIndexSequence<0, I...> {
+  using Type = IndexSequence<I...>;
+};
+
+template <typename... Args, typename Tuple, size_t... I>
+void CallWithArguments(void (*test)(Args...), Tuple &args,
+                       IndexSequence<I...>) {
+  test(std::get<I>(args)...);
+}
+
+template <typename... Args>
+void RunTypedFuzzTest(const uint8_t *data, size_t size, void (*test)(Args...)) {
+  FuzzedDataProvider fdp(data, size);
+  /* The elements of a braced initializer list are evaluated in order, which
+   * decodes the arguments in order. */
+  std::tuple<typename std::decay<Args>::type...> args{
+      DecayedArgument<Args>::Decode(fdp)...};
+  CallWithArguments(test, args,
+                    typename MakeIndexSequence<sizeof...(Args)>::Type());
+}
+
+using TypedRandom = std::mt19937_64;
+
+/* Mutates size bytes at data in place into at most max_size bytes and returns
+ * their new number. Uses libFuzzer's mutator if it is linked in, which also
+ * inserts dictionary entries and the operands of comparisons. */
+inline size_t MutateTypedBytes(uint8_t *data, size_t size, size_t max_size,
+                               TypedRandom &rng) {
+#ifdef CIFUZZ_HAS_WEAK_LLVM_FUZZER_MUTATE
+  if (&LLVMFuzzerMutate != nullptr && max_size != 0)
+    return LLVMFuzzerMutate(data, size, max_size);
+#endif
+  size_t choice = static_cast<size_t>(rng() % 3);
+  if (size < max_size && (size == 0 || choice == 0)) {
+    size_t pos = static_cast<size_t>(rng() % (size + 1));
+    std::memmove(data + pos + 1, data + pos, size - pos);
+    data[pos] = static_cast<uint8_t>(rng());
+    return size + 1;
+  }
+  if (size == 0)
+    return 0;
+  size_t pos = static_cast<size_t>(rng() % size);
+  if (choice == 1) {
+    std::memmove(data + pos, data + pos + 1, size - pos - 1);
+    return size - 1;
+  }
+  data[pos] ^= static_cast<uint8_t>(1u << (rng() % CHAR_BIT));
+  return size;
+}
+
+inline void MutateTypedString(std::string &value, size_t max_size,
+                              TypedRandom &rng) {
+  /* Mutations grow a value by a few bytes at a time, which bounds the buffer
+   * that has to be passed. */
+  size_t size = value.size();
+  value.resize(std::max(size, std::min(max_size, 2 * size + 16)));
+  if (value.empty())
+    return;
+  value.resize(MutateTypedBytes(reinterpret_cast<uint8_t *>(&value[0]), size,
+                                value.size(), rng));
+}
+
+/* Mutates offset, the distance of a value from the minimum of its type, with
+ * range the distance of the maximum. zero is the offset of the value 0. */
+inline uint64_t MutateTypedOffset(uint64_t offset, uint64_t range,
+                                  uint64_t zero, TypedRandom &rng) {
+  if (range == 0)
+    return 0;
+  switch (rng() % 4) {
+  case 0: {
+    /* Values close to the current one, e.g. a length off by one. */
+    uint64_t delta = rng() % 16 + 1;
+    offset = rng() % 2 ? offset + delta : offset - delta;
+    break;
+  }
+  case 1: {
+    uint64_t bits = 1;
+    while (bits < 64 && (range >> bits) > 0)
+      ++bits;
+    offset ^= uint64_t(1) << (rng() % bits);
+    break;
+  }
+  case 2: {
+    const uint64_t boundaries[] = {0, range, zero, zero + 1, zero - 1};
+    offset = boundaries[rng() % 5];
+    break;
+  }
+  default:
+    offset = rng();
+    break;
+  }
+  if (range != std::numeric_limits<uint64_t>::max())
+    offset %= range + 1;
+  return offset;
+}
+
+/* Mutates the value of an argument of FUZZ_TEST_TYPED_WITH_MUTATOR of type T
+ * such that it still decodes with TypedArgument<T>. */
+template <typename T, typename Enable = void> struct TypedMutator;
+
+template <> struct TypedMutator<bool> {
+  static void Mutate(bool &value, size_t, TypedRandom &) { value = !value; }
+};
+
+template <typename T>
+struct TypedMutator<
+    T, typename std::enable_if<std::is_integral<T>::value &&
+                               !std::is_same<T, bool>::value>::type> {
+  static void Mutate(T &value, size_t, TypedRandom &rng) {
+    uint64_t min = static_cast<uint64_t>(std::numeric_limits<T>::min());
+    uint64_t max = static_cast<uint64_t>(std::numeric_limits<T>::max());
+    uint64_t offset = static_cast<uint64_t>(value) - min;
+    value = static_cast<T>(min +
+                           MutateTypedOffset(offset, max - min, 0 - min, rng));
+  }
+};
+
+template <typename T>
+struct TypedMutator<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+  static void Mutate(T &value, size_t, TypedRandom &rng) {
+    uint32_t offset = static_cast<uint32_t>(value);
+    value = static_cast<T>(MutateTypedOffset(
+        offset, static_cast<uint32_t>(T::kMaxValue), 0, rng));
+  }
+};
+
+/* Floating point values only decode to one of the values FuzzedDataProvider
+ * can produce, so the bool and the integral they are decoded from are
+ * mutated instead. */
+template <typename T>
+struct TypedMutator<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  using Argument = TypedArgument<T>;
+
+  static void Mutate(T &value, size_t, TypedRandom &rng) {
+    bool positive = value >= 0;
+    uint64_t probability = Argument::Probability(value);
+    if (rng() % 8 == 0)
+      positive = !positive;
+    else
+      probability = MutateTypedOffset(
+          probability,
+          std::numeric_limits<typename Argument::Integral>::max(), 0, rng);
+    value = Argument::FromProbability(
+        positive, static_cast<typename Argument::Integral>(probability));
+  }
+};
+
+template <> struct TypedMutator<std::string> {
+  static void Mutate(std::string &value, size_t max_size, TypedRandom &rng) {
+    MutateTypedString(value, max_size, rng);
+  }
+};
+
+template <typename T>
+struct TypedMutator<std::vector<T>,
+                    typename std::enable_if<IsByte<T>::value>::type> {
+  static void Mutate(std::vector<T> &value, size_t max_size,
+                     TypedRandom &rng) {
+    std::string bytes(value.begin(), value.end());
+    MutateTypedString(bytes, max_size, rng);
+    value.assign(bytes.begin(), bytes.end());
+  }
+};
+
+/* Inserts, erases or mutates a single element. */
+template <typename T>
+struct TypedMutator<std::vector<T>,
+                    typename std::enable_if<!IsByte<T>::value>::type> {
+  static void Mutate(std::vector<T> &value, size_t max_size,
+                     TypedRandom &rng) {
+    size_t choice = static_cast<size_t>(rng() % 4);
+    if (value.empty() || choice == 0) {
+      T element = T();
+      TypedMutator<T>::Mutate(element, max_size, rng);
+      value.insert(value.begin() + static_cast<std::ptrdiff_t>(
+                                       rng() % (value.size() + 1)),
+                   element);
+      return;
+    }
+    size_t pos = static_cast<size_t>(rng() % value.size());
+    if (choice == 1) {
+      value.erase(value.begin() + static_cast<std::ptrdiff_t>(pos));
+      return;
+    }
+    /* Copied out, as the elements of std::vector<bool> aren't references. */
+    T element = value[pos];
+    TypedMutator<T>::Mutate(element, max_size, rng);
+    value[pos] = element;
+  }
+};
+
+/* The types arguments are mutated as. Views can't hold mutated contents. */
+template <typename T> struct OwnedArgument {
+  using Type = T;
+};
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+template <> struct OwnedArgument<std::string_view> {
+  using Type = std::string;
+};
+#endif
+template <typename T> struct OwnedArgument<std::vector<T>> {
+  using Type = std::vector<typename OwnedArgument<T>::Type>;
+};
+
+template <typename T>
+using OwnedDecayedArgument =
+    typename OwnedArgument<typename std::decay<T>::type>::Type;
+
+template <size_t I, typename Tuple>
+typename std::enable_if<(I == std::tuple_size<Tuple>::value)>::type
+MutateTypedField(Tuple &, size_t, size_t, TypedRandom &) {}
+
+template <size_t I, typename Tuple>
+typename std::enable_if<(I < std::tuple_size<Tuple>::value)>::type
+MutateTypedField(Tuple &fields, size_t index, size_t max_size,
+                 TypedRandom &rng) {
+  if (index != I) {
+    MutateTypedField<I + 1>(fields, index, max_size, rng);
+    return;
+  }
+  using Field = typename std::tuple_element<I, Tuple>::type;
+  TypedMutator<Field>::Mutate(std::get<I>(fields), max_size, rng);
+}
+
+template <typename Tuple, size_t... I>
+std::vector<uint8_t> EncodeTypedFields(const Tuple &fields,
+                                       IndexSequence<I...>) {
+  TypedInputWriter writer;
+  int ordered[] = {
+      0, (TypedArgument<typename std::tuple_element<I, Tuple>::type>::Encode(
+              std::get<I>(fields), writer),
+          0)...};
+  (void) ordered;
+  return writer.Finish();
+}
+
+/* Decodes the input like RunTypedFuzzTest, mutates one of the arguments and
+ * encodes them again. Bytes the fuzz test doesn't consume are dropped. */
+template <typename... Args>
+size_t MutateTypedInput(uint8_t *data, size_t size, size_t max_size,
+                        unsigned int seed, void (*)(Args...)) {
+  TypedRandom rng(seed);
+  if (sizeof...(Args) == 0)
+    return MutateTypedBytes(data, size, max_size, rng);
+
+  using Fields = std::tuple<OwnedDecayedArgument<Args>...>;
+  std::vector<uint8_t> encoded;
+  {
+    FuzzedDataProvider fdp(data, size);
+    /* Decode in order, see RunTypedFuzzTest. */
+    Fields fields{TypedArgument<OwnedDecayedArgument<Args>>::Decode(fdp)...};
+    MutateTypedField<0>(fields, static_cast<size_t>(rng() % sizeof...(Args)),
+                        max_size, rng);
+    encoded = EncodeTypedFields(
+        fields, typename MakeIndexSequence<sizeof...(Args)>::Type());
+  }
+  if (encoded.size() > max_size)
+    return MutateTypedBytes(data, size, max_size, rng);
+  if (!encoded.empty())
+    std::memcpy(data, encoded.data(), encoded.size());
+  return encoded.size();
+}
+
+}  // namespace internal
+
+/* Returns an input that a FUZZ_TEST_TYPED with the parameter types Args
+ * decodes into args, e.g. to add readable seeds to a corpus. The types have
+ * to be given explicitly:
+ *
+ *   cifuzz::SerializeTypedInput<uint16_t, std::string>(8080, "host") */
+template <typename... Args>
+std::vector<uint8_t>
+SerializeTypedInput(const typename std::decay<Args>::type &...args) {
+  internal::TypedInputWriter writer;
+  /* Encode in order, see RunTypedFuzzTest. */
+  int ordered[] = {
+      0, (internal::DecayedArgument<Args>::Encode(args, writer), 0)...};
+  (void) ordered;
+  return writer.Finish();
+}
+
+}  // namespace cifuzz
+
+/* Defines a fuzz test that receives typed arguments decoded from the input
+ * with FuzzedDataProvider instead of the raw bytes:
+ *
+ *   FUZZ_TEST_TYPED(uint16_t port, const std::string &host, bool tls) { ... }
+ *
+ * Supported are bool, integral and floating point types, enums with
+ * kMaxValue, std::string, std::string_view (C++17) and std::vector of those.
+ * cifuzz::SerializeTypedInput creates inputs for given arguments. */
+#define FUZZ_TEST_TYPED(...)                                                     \
+static void cifuzz_typed_test(__VA_ARGS__);                                      \
+CIFUZZ_RESET_CALLER                                                              \
+CIFUZZ_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {  \
+  cifuzz::internal::RunTypedFuzzTest(data, size, &cifuzz_typed_test);            \
+  cifuzz_call_reset();                                                           \
+  return 0;                                                                      \
+}                                                                                \
+CIFUZZ_TEST_METADATA                                                             \
+CLION_TEST_PLAY_BUTTON                                                           \
+static void cifuzz_typed_test(__VA_ARGS__)
+
+/* Like FUZZ_TEST_TYPED, but also defines a LLVMFuzzerCustomMutator that
+ * mutates a single argument at a time and encodes the arguments again, so
+ * that mutations don't shift the bytes the other arguments are decoded from:
+ *
+ *   FUZZ_TEST_TYPED_WITH_MUTATOR(const std::string &host, bool tls) { ... }
+ *
+ * Strings and byte vectors are mutated by libFuzzer's own mutator. It can't
+ * be combined with another LLVMFuzzerCustomMutator. */
+#define FUZZ_TEST_TYPED_WITH_MUTATOR(...)                                        \
+static void cifuzz_typed_test(__VA_ARGS__);                                      \
+CIFUZZ_C_LINKAGE size_t LLVMFuzzerCustomMutator(uint8_t *data, size_t size,      \
+                                                size_t max_size,                 \
+                                                unsigned int seed) {             \
+  return cifuzz::internal::MutateTypedInput(data, size, max_size, seed,          \
+                                            &cifuzz_typed_test);                 \
+}                                                                                \
+FUZZ_TEST_TYPED(__VA_ARGS__)
+#endif
+
 #endif  // CIFUZZ_CIFUZZ_H
@@ -0,0 +1,142 @@
+#ifndef CIFUZZ_REGISTRY_H
+#define CIFUZZ_REGISTRY_H
+
+/* The entry points of an executable containing several fuzz tests registered
+ * with FUZZ_TEST_NAMED. This header has to be included by exactly one of its
+ * source files.
+ *
+ * The fuzz test to run is selected by the CIFUZZ_TEST environment variable,
+ * which can be omitted if there is only one. cifuzz_test_name,
+ * cifuzz_seed_corpus and cifuzz_generated_corpus describe the selected fuzz
+ * test, with the corpus paths formed from CIFUZZ_SEED_CORPUS_DIR and
+ * CIFUZZ_GENERATED_CORPUS_DIR if the build system integration defines them. */
+
+#include "cifuzz.h"
+
+#ifdef __cplusplus
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+#ifdef _WIN32
+#define CIFUZZ_PATH_SEPARATOR "\\"
+#else
+#define CIFUZZ_PATH_SEPARATOR "/"
+#endif
+
+static cifuzz_registered_test *cifuzz_registered_tests = NULL;
+static cifuzz_registered_test *cifuzz_registered_setups = NULL;
+static cifuzz_registered_test *cifuzz_selected_test = NULL;
+
+CIFUZZ_C_LINKAGE void cifuzz_register_test(cifuzz_registered_test *test) {
+  test->next = cifuzz_registered_tests;
+  cifuzz_registered_tests = test;
+}
+
+CIFUZZ_C_LINKAGE void cifuzz_register_setup(cifuzz_registered_test *setup) {
+  setup->next = cifuzz_registered_setups;
+  cifuzz_registered_setups = setup;
+}
+
+/* Returns the fuzz test selected by CIFUZZ_TEST or exits with a list of the
+ * registered fuzz tests if there is none. */
+static cifuzz_registered_test *cifuzz_select_test(void) {
+  const char *name;
+  cifuzz_registered_test *test;
+
+  if (cifuzz_selected_test != NULL) {
+    return cifuzz_selected_test;
+  }
+  name = getenv("CIFUZZ_TEST");
+  if (name != NULL && name[0] != '\0') {
+    for (test = cifuzz_registered_tests; test != NULL; test = test->next) {
+      if (strcmp(test->name, name) == 0) {
+        cifuzz_selected_test = test;
+        return test;
+      }
+    }
+    fprintf(stderr, "Unknown fuzz test in CIFUZZ_TEST: %s\n", name);
+  } else if (cifuzz_registered_tests != NULL && cifuzz_registered_tests->next == NULL) {
+    cifuzz_selected_test = cifuzz_registered_tests;
+    return cifuzz_selected_test;
+  } else {
+    fprintf(stderr, "Set CIFUZZ_TEST to select the fuzz test to run\n");
+  }
+  fprintf(stderr, "Registered fuzz tests:\n");
+  for (test = cifuzz_registered_tests; test != NULL; test = test->next) {
+    fprintf(stderr, "  %s\n", test->name);
+  }
+  exit(1);
+}
+
+/* Returns |prefix| followed by the name of the selected fuzz test and |suffix|
+ * in a buffer that is never freed. */
+static const char *cifuzz_selected_test_path(const char *prefix, const char *suffix) {
+  const char *name = cifuzz_select_test()->name;
+  char *path = (char *) malloc(strlen(prefix) + strlen(name) + strlen(suffix) + 1);
+
+  if (path == NULL) {
+    return NULL;
+  }
+  strcpy(path, prefix);
+  strcat(path, name);
+  strcat(path, suffix);
+  return path;
+}
+
+CIFUZZ_RESET_CALLER
+
+CIFUZZ_C_LINKAGE int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  cifuzz_registered_test *test = cifuzz_select_test();
+  cifuzz_registered_test *setup;
+
+  (void) argc;
+  (void) argv;
+  for (setup = cifuzz_registered_setups; setup != NULL; setup = setup->next) {
+    if (strcmp(setup->name, test->name) == 0) {
+      setup->setup();
+    }
+  }
+  return 0;
+}
+
+CIFUZZ_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  cifuzz_select_test()->test(data, size);
+  cifuzz_call_reset();
+  return 0;
+}
+
+CIFUZZ_C_LINKAGE const char *cifuzz_test_name(void) {
+  return cifuzz_select_test()->name;
+}
+
+CIFUZZ_C_LINKAGE const char *cifuzz_seed_corpus(void) {
+#ifdef CIFUZZ_SEED_CORPUS_DIR
+  static const char *seed_corpus = NULL;
+  if (seed_corpus == NULL) {
+    seed_corpus = cifuzz_selected_test_path(CIFUZZ_SEED_CORPUS_DIR CIFUZZ_PATH_SEPARATOR, "_inputs");
+  }
+  return seed_corpus;
+#else
+  return NULL;
+#endif
+}
+
+CIFUZZ_C_LINKAGE const char *cifuzz_generated_corpus(void) {
+#ifdef CIFUZZ_GENERATED_CORPUS_DIR
+  static const char *generated_corpus = NULL;
+  if (generated_corpus == NULL) {
+    generated_corpus = cifuzz_selected_test_path(CIFUZZ_GENERATED_CORPUS_DIR CIFUZZ_PATH_SEPARATOR, "");
+  }
+  return generated_corpus;
+#else
+  return NULL;
+#endif
+}
+
+#endif  /* CIFUZZ_REGISTRY_H */
@@ -0,0 +1,295 @@
+#ifndef CIFUZZ_SNAPSHOT_H
+#define CIFUZZ_SNAPSHOT_H
+
+/* Snapshots of state that is expensive to initialize in FUZZ_TEST_SETUP, such
+ * as parsed tables or dictionaries. A snapshot is saved once and mapped into
+ * memory by later runs of the fuzz test, which only pages in what is used:
+ *
+ *   static const struct my_tables *tables;
+ *
+ *   FUZZ_TEST_SETUP() {
+ *     size_t size;
+ *     tables = cifuzz_load_snapshot("my_tables", &size);
+ *     if (tables == NULL) {
+ *       struct my_tables *built = build_tables();
+ *       cifuzz_save_snapshot("my_tables", built, sizeof(*built));
+ *       tables = built;
+ *     }
+ *   }
+ *
+ * The state has to be position-independent, i.e. must not contain pointers.
+ * Snapshots are stored next to the fuzz test executable, or in the directory
+ * given by the CIFUZZ_SNAPSHOT_DIR environment variable, which allows fuzz
+ * tests built into different executables to share them. A snapshot that is
+ * older than the executable loading it is ignored, so rebuilding the fuzz
+ * test invalidates it. */
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CIFUZZ_SNAPSHOT_UNUSED __attribute__((unused))
+#else
+#define CIFUZZ_SNAPSHOT_UNUSED
+#endif
+
+#define CIFUZZ_SNAPSHOT_SUFFIX ".cifuzz-snapshot"
+
+/* Returns the path of the executable in a buffer allocated with malloc, or
+ * NULL if it can't be determined. */
+static char *cifuzz_snapshot_executable_path(void) {
+#ifdef _WIN32
+  DWORD capacity = MAX_PATH;
+  char *path = NULL;
+  DWORD len;
+
+  for (;;) {
+    char *new_path = (char *) realloc(path, capacity);
+    if (new_path == NULL) {
+      free(path);
+      return NULL;
+    }
+    path = new_path;
+    len = GetModuleFileNameA(NULL, path, capacity);
+    if (len == 0) {
+      free(path);
+      return NULL;
+    }
+    if (len < capacity) {
+      return path;
+    }
+    capacity *= 2;
+  }
+#elif defined(__APPLE__)
+  uint32_t capacity = 0;
+  char *path;
+
+  _NSGetExecutablePath(NULL, &capacity);
+  path = (char *) malloc(capacity);
+  if (path == NULL || _NSGetExecutablePath(path, &capacity) != 0) {
+    free(path);
+    return NULL;
+  }
+  return path;
+#else
+  size_t capacity = 256;
+  char *path = NULL;
+  ssize_t len;
+
+  for (;;) {
+    char *new_path = (char *) realloc(path, capacity);
+    if (new_path == NULL) {
+      free(path);
+      return NULL;
+    }
+    path = new_path;
+    len = readlink("/proc/self/exe", path, capacity);
+    if (len < 0) {
+      free(path);
+      return NULL;
+    }
+    if ((size_t) len < capacity) {
+      path[len] = '\0';
+      return path;
+    }
+    capacity *= 2;
+  }
+#endif
+}
+
+/* Returns the path of the snapshot |name| in a buffer allocated with malloc
+ * and stores the path of the executable in |*executable|. */
+static char *cifuzz_snapshot_path(const char *name, char **executable) {
+  const char *dir = getenv("CIFUZZ_SNAPSHOT_DIR");
+  size_t dir_len;
+  char *path;
+
+  *executable = cifuzz_snapshot_executable_path();
+  if (*executable == NULL) {
+    return NULL;
+  }
+  if (dir != NULL && dir[0] != '\0') {
+    dir_len = strlen(dir);
+  } else {
+    /* The directory of the executable, including the separator. */
+    dir = *executable;
+    dir_len = strlen(dir);
+    while (dir_len > 0 && dir[dir_len - 1] != '/'
+#ifdef _WIN32
+           && dir[dir_len - 1] != '\\'
+#endif
+    ) {
+      dir_len--;
+    }
+  }
+
+  path = (char *) malloc(dir_len + 1 + strlen(name) + sizeof(CIFUZZ_SNAPSHOT_SUFFIX));
+  if (path == NULL) {
+    free(*executable);
+    *executable = NULL;
+    return NULL;
+  }
+  memcpy(path, dir, dir_len);
+  if (dir_len > 0 && dir[dir_len - 1] != '/' && dir[dir_len - 1] != '\\') {
+    path[dir_len++] = '/';
+  }
+  strcpy(path + dir_len, name);
+  strcat(path, CIFUZZ_SNAPSHOT_SUFFIX);
+  return path;
+}
+
+/* Returns the contents of the snapshot |name|, which stay mapped until the
+ * process exits, and stores its size in |*size|. Returns NULL if there is no
+ * snapshot or it is older than the executable. */
+CIFUZZ_SNAPSHOT_UNUSED
+static const void *cifuzz_load_snapshot(const char *name, size_t *size) {
+  static const char empty_snapshot[1] = {0};
+  char *executable;
+  char *path = cifuzz_snapshot_path(name, &executable);
+  const void *result = NULL;
+#ifdef _WIN32
+  HANDLE exe_file;
+  HANDLE file;
+  HANDLE mapping;
+  FILETIME exe_time;
+  FILETIME snapshot_time;
+  LARGE_INTEGER file_size;
+#else
+  struct stat exe_info;
+  struct stat info;
+  int fd;
+  void *addr;
+#endif
+
+  if (path == NULL) {
+    return NULL;
+  }
+
+#ifdef _WIN32
+  exe_file = CreateFileA(executable, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                     FILE_ATTRIBUTE_NORMAL, NULL);
+  if (exe_file != INVALID_HANDLE_VALUE && file != INVALID_HANDLE_VALUE &&
+      GetFileTime(exe_file, NULL, NULL, &exe_time) && GetFileTime(file, NULL, NULL, &snapshot_time) &&
+      CompareFileTime(&snapshot_time, &exe_time) >= 0 && GetFileSizeEx(file, &file_size)) {
+    *size = (size_t) file_size.QuadPart;
+    if (*size == 0) {
+      result = empty_snapshot;
+    } else {
+      mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping != NULL) {
+        /* The view keeps the mapping alive. */
+        result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+      }
+    }
+  }
+  if (exe_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(exe_file);
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+  }
+#else
+  fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    if (stat(executable, &exe_info) == 0 && fstat(fd, &info) == 0 && info.st_mtime >= exe_info.st_mtime) {
+      *size = (size_t) info.st_size;
+      if (*size == 0) {
+        result = empty_snapshot;
+      } else {
+        addr = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+          result = addr;
+        }
+      }
+    }
+    close(fd);
+  }
+#endif
+
+  free(path);
+  free(executable);
+  return result;
+}
+
+/* Saves |size| bytes at |data| as the snapshot |name|. Concurrent runs never
+ * see a partially written snapshot. Returns 0 on success. */
+CIFUZZ_SNAPSHOT_UNUSED
+static int cifuzz_save_snapshot(const char *name, const void *data, size_t size) {
+  char *executable;
+  char *path = cifuzz_snapshot_path(name, &executable);
+  char *tmp_path;
+  size_t tmp_path_size;
+  FILE *f = NULL;
+  int written;
+  int result = -1;
+
+  if (path == NULL) {
+    return -1;
+  }
+  free(executable);
+  tmp_path_size = strlen(path) + 32;
+  tmp_path = (char *) malloc(tmp_path_size);
+  if (tmp_path == NULL) {
+    free(path);
+    return -1;
+  }
+#ifdef _WIN32
+  sprintf_s(tmp_path, tmp_path_size, "%s.%lu.tmp", path, (unsigned long) GetCurrentProcessId());
+  if (fopen_s(&f, tmp_path, "wb") != 0) {
+    f = NULL;
+  }
+#else
+  sprintf(tmp_path, "%s.%lu.tmp", path, (unsigned long) getpid());
+  f = fopen(tmp_path, "wb");
+#endif
+  if (f != NULL) {
+    written = fwrite(data, 1, size, f) == size;
+    if (fclose(f) == 0 && written) {
+#ifdef _WIN32
+      if (MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+        result = 0;
+      }
+#else
+      if (rename(tmp_path, path) == 0) {
+        result = 0;
+      }
+#endif
+    }
+    if (result != 0) {
+      remove(tmp_path);
+    }
+  }
+
+  free(tmp_path);
+  free(path);
+  return result;
+}
+
+#endif  /* CIFUZZ_SNAPSHOT_H */
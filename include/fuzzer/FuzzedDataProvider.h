@@ -3,6 +3,11 @@
 
 // Modified by Fabian Meumertzheim:
 //   - added preprocessor check for C++11
+//   - added non-owning string_view (C++17) and span (C++20) consumers
+//   - added an optional bump arena backing the copies of the view consumers
+//   - added bulk integral and floating point consumers
+//   - added records of fields decoded with compile-time ranges
+//   - added consumption profiling enabled by FUZZED_DATA_PROVIDER_PROFILE
 //
 //===- FuzzedDataProvider.h - Utility header for fuzz targets ---*- C++ -* ===//
 //
@@ -34,10 +39,138 @@
 #include <initializer_list>
 #include <limits>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+// The non-owning consumers require std::string_view (C++17) and std::span
+// (C++20), the rest of the header only C++11.
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+#include <memory>
+#include <string_view>
+#endif
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define FUZZED_DATA_PROVIDER_HAS_SPAN
+#include <span>
+#endif
+
+#ifdef FUZZED_DATA_PROVIDER_PROFILE
+#include <cstdio>
+#include <mutex>
+
+// Collects how many bytes of every input the FuzzedDataProviders of the
+// process consume, how often every method is called and how often it finds
+// no data left, and prints a summary to stderr at exit. Use it to tune
+// -max_len and to trim corpora. Inputs that crash or time out aren't
+// included.
+class FuzzedDataProviderProfile {
+ public:
+  static FuzzedDataProviderProfile &Get() {
+    static FuzzedDataProviderProfile profile;
+    return profile;
+  }
+
+  ~FuzzedDataProviderProfile() { Print(); }
+
+  // Returns the index of the counters for the method |name|.
+  size_t RegisterMethod(const char *name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < methods_.size(); ++i) {
+      if (std::strcmp(methods_[i].name, name) == 0)
+        return i;
+    }
+    methods_.push_back(MethodStats{name, 0, 0});
+    return methods_.size() - 1;
+  }
+
+  void RecordCall(size_t method, bool out_of_data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++methods_[method].calls;
+    if (out_of_data)
+      ++methods_[method].out_of_data_calls;
+  }
+
+  void RecordInput(size_t size, size_t remaining_bytes, bool ran_out) {
+    // Inputs are grouped by the number of bits of their size.
+    size_t bucket = 0;
+    while (bucket < sizeof(size_t) * CHAR_BIT && (size >> bucket) != 0)
+      ++bucket;
+    std::lock_guard<std::mutex> lock(mutex_);
+    InputStats &stats = inputs_[bucket];
+    ++stats.inputs;
+    stats.bytes += size;
+    stats.consumed_bytes += size - remaining_bytes;
+    if (remaining_bytes != 0)
+      ++stats.inputs_with_unconsumed_bytes;
+    if (ran_out)
+      ++stats.inputs_that_ran_out;
+  }
+
+ private:
+  struct MethodStats {
+    const char *name;
+    unsigned long long calls;
+    unsigned long long out_of_data_calls;
+  };
+  struct InputStats {
+    unsigned long long inputs;
+    unsigned long long bytes;
+    unsigned long long consumed_bytes;
+    unsigned long long inputs_with_unconsumed_bytes;
+    unsigned long long inputs_that_ran_out;
+  };
+
+  FuzzedDataProviderProfile() = default;
+
+  void Print() {
+    std::fprintf(stderr, "==FuzzedDataProvider profile==\n");
+    std::fprintf(stderr, "%-22s %12s %9s %12s %12s\n", "input size", "inputs",
+                 "consumed", "unconsumed", "ran out");
+    for (size_t i = 0; i < sizeof(inputs_) / sizeof(inputs_[0]); ++i) {
+      const InputStats &stats = inputs_[i];
+      if (stats.inputs == 0)
+        continue;
+      char range[32];
+      if (i <= 1)
+        std::snprintf(range, sizeof(range), "%zu", i);
+      else
+        std::snprintf(range, sizeof(range), "%llu-%llu",
+                      1ULL << (i - 1), (1ULL << (i - 1)) * 2 - 1);
+      double consumed = stats.bytes == 0 ? 100.0
+                                         : 100.0 * static_cast<double>(
+                                                       stats.consumed_bytes) /
+                                               static_cast<double>(stats.bytes);
+      std::fprintf(stderr, "%-22s %12llu %8.1f%% %12llu %12llu\n", range,
+                   stats.inputs, consumed, stats.inputs_with_unconsumed_bytes,
+                   stats.inputs_that_ran_out);
+    }
+    std::fprintf(stderr, "%-34s %12s %12s\n", "method", "calls",
+                 "out of data");
+    for (const MethodStats &stats : methods_) {
+      // Methods only ever called by other methods aren't counted.
+      if (stats.calls == 0)
+        continue;
+      std::fprintf(stderr, "%-34s %12llu %12llu\n", stats.name, stats.calls,
+                   stats.out_of_data_calls);
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<MethodStats> methods_;
+  InputStats inputs_[sizeof(size_t) * CHAR_BIT + 1] = {};
+};
+
+// Only counts the outermost call, not the calls it makes to other methods.
+#define FUZZED_DATA_PROVIDER_PROFILE_CALL(name)                                \
+  static const size_t profile_method =                                         \
+      FuzzedDataProviderProfile::Get().RegisterMethod(name);                   \
+  ProfileScope profile_scope(*this, profile_method)
+#else
+#define FUZZED_DATA_PROVIDER_PROFILE_CALL(name)
+#endif
+
 // In addition to the comments below, the API is also briefly documented at
 // https://github.com/google/fuzzing/blob/master/docs/split-inputs.md#fuzzed-data-provider
 class FuzzedDataProvider {
@@ -46,7 +179,27 @@ class FuzzedDataProvider {
   // provide more granular access. |data| must outlive the FuzzedDataProvider.
   FuzzedDataProvider(const uint8_t *data, size_t size)
       : data_ptr_(data), remaining_bytes_(size) {}
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+  // Additionally carves the copies backing the views returned below from
+  // the |arena_size| bytes at |arena|, e.g. a buffer reused by every
+  // iteration of the fuzz test. Only once it is exhausted, further copies
+  // are carved from heap blocks that are released together with the
+  // FuzzedDataProvider. |arena| must outlive the FuzzedDataProvider.
+  FuzzedDataProvider(const uint8_t *data, size_t size, void *arena,
+                     size_t arena_size)
+      : data_ptr_(data), remaining_bytes_(size),
+        arena_ptr_(static_cast<char *>(arena)),
+        arena_remaining_(arena_size) {}
+#endif
+#ifdef FUZZED_DATA_PROVIDER_PROFILE
+  ~FuzzedDataProvider() {
+    FuzzedDataProviderProfile::Get().RecordInput(profile_size_,
+                                                 remaining_bytes_,
+                                                 profile_ran_out_);
+  }
+#else
   ~FuzzedDataProvider() = default;
+#endif
 
   // See the implementation below (after the class definition) for more verbose
   // comments for each of the methods.
@@ -67,6 +220,28 @@ class FuzzedDataProvider {
   std::string ConsumeRandomLengthString();
   std::string ConsumeRemainingBytesAsString();
 
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+  // Methods returning views into the input data instead of copies, which
+  // avoids a heap allocation per call. They consume exactly the same bytes as
+  // their owning counterparts. The views remain valid as long as both the
+  // input data and the FuzzedDataProvider do. As the pieces aren't put into
+  // separate buffers, ASan doesn't catch overflows from one piece into the
+  // next.
+  std::string_view ConsumeBytesAsStringView(size_t num_bytes);
+  std::string_view ConsumeRandomLengthStringView(size_t max_length);
+  std::string_view ConsumeRandomLengthStringView();
+  std::string_view ConsumeRemainingBytesAsStringView();
+  // The contents of these views are copied from the input data into the
+  // arena of the FuzzedDataProvider, which is much cheaper than allocating
+  // a std::vector or std::string per call.
+  std::string_view ConsumeBytesWithTerminatorView(size_t num_bytes,
+                                                  char terminator = 0);
+#endif
+#ifdef FUZZED_DATA_PROVIDER_HAS_SPAN
+  template <typename T> std::span<const T> ConsumeBytesView(size_t num_bytes);
+  template <typename T> std::span<const T> ConsumeRemainingBytesView();
+#endif
+
   // Methods returning integer values.
   template <typename T> T ConsumeIntegral();
   template <typename T> T ConsumeIntegralInRange(T min, T max);
@@ -75,6 +250,25 @@ class FuzzedDataProvider {
   template <typename T> T ConsumeFloatingPoint();
   template <typename T> T ConsumeFloatingPointInRange(T min, T max);
 
+  // Methods filling arrays of |count| values. They produce exactly the same
+  // values as the same number of calls to their scalar counterparts, but
+  // avoid the per-byte loop for every value.
+  template <typename T> void ConsumeIntegralArray(T *values, size_t count);
+  template <typename T>
+  void ConsumeIntegralArrayInRange(T *values, size_t count, T min, T max);
+  template <typename T>
+  void ConsumeFloatingPointArray(T *values, size_t count);
+  template <typename T>
+  void ConsumeFloatingPointArrayInRange(T *values, size_t count, T min, T max);
+#ifdef FUZZED_DATA_PROVIDER_HAS_SPAN
+  template <typename T> void ConsumeIntegralArray(std::span<T> values);
+  template <typename T>
+  void ConsumeIntegralArrayInRange(std::span<T> values, T min, T max);
+  template <typename T> void ConsumeFloatingPointArray(std::span<T> values);
+  template <typename T>
+  void ConsumeFloatingPointArrayInRange(std::span<T> values, T min, T max);
+#endif
+
   // 0 <= return value <= 1.
   template <typename T> T ConsumeProbability();
 
@@ -83,6 +277,13 @@ class FuzzedDataProvider {
   // Returns a value chosen from the given enum.
   template <typename T> T ConsumeEnum();
 
+  // Returns a tuple of values described by |Fields|, such as
+  // |FuzzedIntegralField<uint16_t, 1, 512>|, the same ones consuming the
+  // fields one by one would return. The ranges of the fields are known at
+  // compile time and the remaining size is only checked once per record.
+  template <typename... Fields>
+  std::tuple<typename Fields::Type...> ConsumeRecord();
+
   // Returns a value from the given array.
   template <typename T, size_t size> T PickValueInArray(const T (&array)[size]);
   template <typename T, size_t size>
@@ -108,8 +309,49 @@ class FuzzedDataProvider {
 
   template <typename TS, typename TU> TS ConvertUnsignedToSigned(TU value);
 
+  const uint8_t *ConsumeFromTail(size_t num_bytes);
+
+#ifdef FUZZED_DATA_PROVIDER_PROFILE
+  class ProfileScope {
+   public:
+    ProfileScope(FuzzedDataProvider &fdp, size_t method) : fdp_(fdp) {
+      if (fdp_.profile_depth_++ != 0)
+        return;
+      bool out_of_data = fdp_.remaining_bytes_ == 0;
+      fdp_.profile_ran_out_ |= out_of_data;
+      FuzzedDataProviderProfile::Get().RecordCall(method, out_of_data);
+    }
+    ~ProfileScope() { --fdp_.profile_depth_; }
+
+   private:
+    FuzzedDataProvider &fdp_;
+  };
+#endif
+
+  template <size_t num_bytes, typename T>
+  void ConsumeIntegralsFromTail(T *values, size_t count, T min,
+                                uint64_t range);
+
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+  char *AllocateFromArena(size_t size);
+#endif
+
   const uint8_t *data_ptr_;
   size_t remaining_bytes_;
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+  // Backs the views that can't point into the input data. Memory is only
+  // ever bumped off the current block, blocks are never moved or freed
+  // individually, which keeps the views valid.
+  char *arena_ptr_ = nullptr;
+  size_t arena_remaining_ = 0;
+  size_t arena_block_size_ = 0;
+  std::vector<std::unique_ptr<char[]>> arena_blocks_;
+#endif
+#ifdef FUZZED_DATA_PROVIDER_PROFILE
+  size_t profile_size_ = remaining_bytes_;
+  size_t profile_depth_ = 0;
+  bool profile_ran_out_ = false;
+#endif
 };
 
 // Returns a std::vector containing |num_bytes| of input data. If fewer than
@@ -118,6 +360,7 @@ class FuzzedDataProvider {
 // char, unsigned char, uint8_t, etc.
 template <typename T>
 std::vector<T> FuzzedDataProvider::ConsumeBytes(size_t num_bytes) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytes");
   num_bytes = std::min(num_bytes, remaining_bytes_);
   return ConsumeBytes<T>(num_bytes, num_bytes);
 }
@@ -129,6 +372,7 @@ std::vector<T> FuzzedDataProvider::ConsumeBytes(size_t num_bytes) {
 template <typename T>
 std::vector<T> FuzzedDataProvider::ConsumeBytesWithTerminator(size_t num_bytes,
                                                               T terminator) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytesWithTerminator");
   num_bytes = std::min(num_bytes, remaining_bytes_);
   std::vector<T> result = ConsumeBytes<T>(num_bytes + 1, num_bytes);
   result.back() = terminator;
@@ -138,6 +382,7 @@ std::vector<T> FuzzedDataProvider::ConsumeBytesWithTerminator(size_t num_bytes,
 // Returns a std::vector containing all remaining bytes of the input data.
 template <typename T>
 std::vector<T> FuzzedDataProvider::ConsumeRemainingBytes() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRemainingBytes");
   return ConsumeBytes<T>(remaining_bytes_);
 }
 
@@ -146,6 +391,7 @@ std::vector<T> FuzzedDataProvider::ConsumeRemainingBytes() {
 // null-terminated C string. If fewer than |num_bytes| of data remain, returns
 // a shorter std::string containing all of the data that's left.
 inline std::string FuzzedDataProvider::ConsumeBytesAsString(size_t num_bytes) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytesAsString");
   static_assert(sizeof(std::string::value_type) == sizeof(uint8_t),
                 "ConsumeBytesAsString cannot convert the data to a string.");
 
@@ -162,6 +408,7 @@ inline std::string FuzzedDataProvider::ConsumeBytesAsString(size_t num_bytes) {
 // length and then consuming that many bytes with |ConsumeBytes|.
 inline std::string
 FuzzedDataProvider::ConsumeRandomLengthString(size_t max_length) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRandomLengthString");
   // Reads bytes from the start of |data_ptr_|. Maps "\\" to "\", and maps "\"
   // followed by anything else to the end of the string. As a result of this
   // logic, a fuzzer can insert characters into the string, and the string
@@ -172,16 +419,26 @@ FuzzedDataProvider::ConsumeRandomLengthString(size_t max_length) {
 
   // Reserve the anticipated capaticity to prevent several reallocations.
   result.reserve(std::min(max_length, remaining_bytes_));
-  for (size_t i = 0; i < max_length && remaining_bytes_ != 0; ++i) {
-    char next = ConvertUnsignedToSigned<char>(data_ptr_[0]);
+  while (result.size() < max_length && remaining_bytes_ != 0) {
+    // Append the characters up to the next "\" at once.
+    size_t run = std::min(max_length - result.size(), remaining_bytes_);
+    const uint8_t *backslash =
+        static_cast<const uint8_t *>(std::memchr(data_ptr_, '\\', run));
+    if (backslash != nullptr)
+      run = static_cast<size_t>(backslash - data_ptr_);
+    result.append(reinterpret_cast<const char *>(data_ptr_), run);
+    Advance(run);
+    if (backslash == nullptr)
+      break;
     Advance(1);
-    if (next == '\\' && remaining_bytes_ != 0) {
-      next = ConvertUnsignedToSigned<char>(data_ptr_[0]);
+    // A trailing "\" is kept as is.
+    if (remaining_bytes_ != 0) {
+      char next = ConvertUnsignedToSigned<char>(data_ptr_[0]);
       Advance(1);
       if (next != '\\')
         break;
     }
-    result += next;
+    result += '\\';
   }
 
   result.shrink_to_fit();
@@ -190,6 +447,7 @@ FuzzedDataProvider::ConsumeRandomLengthString(size_t max_length) {
 
 // Returns a std::string of length from 0 to |remaining_bytes_|.
 inline std::string FuzzedDataProvider::ConsumeRandomLengthString() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRandomLengthString");
   return ConsumeRandomLengthString(remaining_bytes_);
 }
 
@@ -197,13 +455,139 @@ inline std::string FuzzedDataProvider::ConsumeRandomLengthString() {
 // Prefer using |ConsumeRemainingBytes| unless you actually need a std::string
 // object.
 inline std::string FuzzedDataProvider::ConsumeRemainingBytesAsString() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRemainingBytesAsString");
   return ConsumeBytesAsString(remaining_bytes_);
 }
 
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+// Like |ConsumeBytesAsString|, but returns a view into the input data.
+inline std::string_view
+FuzzedDataProvider::ConsumeBytesAsStringView(size_t num_bytes) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytesAsStringView");
+  num_bytes = std::min(num_bytes, remaining_bytes_);
+  std::string_view result(reinterpret_cast<const char *>(data_ptr_),
+                          num_bytes);
+  Advance(num_bytes);
+  return result;
+}
+
+// Like |ConsumeRandomLengthString|, but returns a view into the input data.
+// Only if the string contains an escaped "\\", its unescaped contents can't
+// be viewed in place and are copied once into the arena.
+inline std::string_view
+FuzzedDataProvider::ConsumeRandomLengthStringView(size_t max_length) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRandomLengthStringView");
+  const char *start = reinterpret_cast<const char *>(data_ptr_);
+  size_t length = std::min(max_length, remaining_bytes_);
+  // |start| may be null for an empty input, which memchr doesn't accept.
+  const char *backslash =
+      length == 0 ? nullptr
+                  : static_cast<const char *>(std::memchr(start, '\\', length));
+  if (backslash == nullptr) {
+    Advance(length);
+    return std::string_view(start, length);
+  }
+  length = static_cast<size_t>(backslash - start);
+  Advance(length + 1);
+  // A trailing "\" is kept as is, which the view still covers.
+  if (remaining_bytes_ == 0)
+    return std::string_view(start, length + 1);
+  char next = ConvertUnsignedToSigned<char>(data_ptr_[0]);
+  Advance(1);
+  if (next != '\\')
+    return std::string_view(start, length);
+
+  // Fall back to unescaping the rest of the string into a copy. Every
+  // character consumes at least one byte, which bounds its length.
+  size_t capacity =
+      length + 1 + std::min(max_length - length - 1, remaining_bytes_);
+  char *result = AllocateFromArena(capacity);
+  std::memcpy(result, start, length);
+  result[length++] = next;
+  while (length < max_length && remaining_bytes_ != 0) {
+    size_t run = std::min(max_length - length, remaining_bytes_);
+    const uint8_t *escape =
+        static_cast<const uint8_t *>(std::memchr(data_ptr_, '\\', run));
+    if (escape != nullptr)
+      run = static_cast<size_t>(escape - data_ptr_);
+    std::memcpy(result + length, data_ptr_, run);
+    length += run;
+    Advance(run);
+    if (escape == nullptr)
+      break;
+    Advance(1);
+    if (remaining_bytes_ != 0) {
+      next = ConvertUnsignedToSigned<char>(data_ptr_[0]);
+      Advance(1);
+      if (next != '\\')
+        break;
+    }
+    result[length++] = '\\';
+  }
+  // The copy is the most recent allocation, so give back what it didn't use.
+  arena_ptr_ -= capacity - length;
+  arena_remaining_ += capacity - length;
+  return std::string_view(result, length);
+}
+
+// Returns a view of length from 0 to |remaining_bytes_|.
+inline std::string_view FuzzedDataProvider::ConsumeRandomLengthStringView() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRandomLengthStringView");
+  return ConsumeRandomLengthStringView(remaining_bytes_);
+}
+
+// Returns a view of all remaining bytes of the input data.
+inline std::string_view
+FuzzedDataProvider::ConsumeRemainingBytesAsStringView() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRemainingBytesAsStringView");
+  return ConsumeBytesAsStringView(remaining_bytes_);
+}
+
+// Like |ConsumeBytesWithTerminator|, but returns a view of a copy in the
+// arena. The terminator follows the end of the view, so |data()| can be
+// passed to functions expecting a C-string.
+inline std::string_view
+FuzzedDataProvider::ConsumeBytesWithTerminatorView(size_t num_bytes,
+                                                   char terminator) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytesWithTerminatorView");
+  num_bytes = std::min(num_bytes, remaining_bytes_);
+  char *result = AllocateFromArena(num_bytes + 1);
+  if (num_bytes != 0)
+    CopyAndAdvance(result, num_bytes);
+  result[num_bytes] = terminator;
+  return std::string_view(result, num_bytes);
+}
+#endif
+
+#ifdef FUZZED_DATA_PROVIDER_HAS_SPAN
+// Like |ConsumeBytes|, but returns a view into the input data. Can be used
+// with any byte sized type, such as char, unsigned char, uint8_t, std::byte,
+// etc.
+template <typename T>
+std::span<const T> FuzzedDataProvider::ConsumeBytesView(size_t num_bytes) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBytesView");
+  static_assert(sizeof(T) == sizeof(uint8_t), "Incompatible data type.");
+
+  num_bytes = std::min(num_bytes, remaining_bytes_);
+  std::span<const T> result(reinterpret_cast<const T *>(data_ptr_),
+                            num_bytes);
+  Advance(num_bytes);
+  return result;
+}
+
+// Returns a view of all remaining bytes of the input data.
+template <typename T>
+std::span<const T> FuzzedDataProvider::ConsumeRemainingBytesView() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRemainingBytesView");
+  return ConsumeBytesView<T>(remaining_bytes_);
+}
+#endif
+
 // Returns a number in the range [Type's min, Type's max]. The value might
 // not be uniformly distributed in the given range. If there's no input data
 // left, always returns |min|.
 template <typename T> T FuzzedDataProvider::ConsumeIntegral() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegral");
   return ConsumeIntegralInRange(std::numeric_limits<T>::min(),
                                 std::numeric_limits<T>::max());
 }
@@ -214,6 +598,7 @@ template <typename T> T FuzzedDataProvider::ConsumeIntegral() {
 // be less than or equal to |max|.
 template <typename T>
 T FuzzedDataProvider::ConsumeIntegralInRange(T min, T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegralInRange");
   static_assert(std::is_integral<T>::value, "An integral type is required.");
   static_assert(sizeof(T) <= sizeof(uint64_t), "Unsupported integral type.");
 
@@ -245,10 +630,154 @@ T FuzzedDataProvider::ConsumeIntegralInRange(T min, T max) {
   return static_cast<T>(min + result);
 }
 
+// Fills |values| with |count| numbers in the range [Type's min, Type's max].
+template <typename T>
+void FuzzedDataProvider::ConsumeIntegralArray(T *values, size_t count) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegralArray");
+  ConsumeIntegralArrayInRange(values, count, std::numeric_limits<T>::min(),
+                              std::numeric_limits<T>::max());
+}
+
+// Fills |values| with |count| numbers in the range [min, max], the same ones
+// |count| calls to |ConsumeIntegralInRange| would return.
+template <typename T>
+void FuzzedDataProvider::ConsumeIntegralArrayInRange(T *values, size_t count,
+                                                     T min, T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegralArrayInRange");
+  static_assert(std::is_integral<T>::value, "An integral type is required.");
+  static_assert(sizeof(T) <= sizeof(uint64_t), "Unsupported integral type.");
+
+  if (min > max)
+    abort();
+
+  // Every value consumes the same number of bytes, as long as enough remain.
+  uint64_t range = static_cast<uint64_t>(max) - min;
+  size_t num_bytes = 0;
+  while (num_bytes < sizeof(T) && (range >> (num_bytes * CHAR_BIT)) > 0)
+    ++num_bytes;
+
+  size_t num_full_values = count;
+  if (num_bytes != 0)
+    num_full_values = std::min(count, remaining_bytes_ / num_bytes);
+  switch (num_bytes) {
+  case 0:
+    std::fill(values, values + count, min);
+    return;
+  case 1:
+    ConsumeIntegralsFromTail<1>(values, num_full_values, min, range);
+    break;
+  case 2:
+    ConsumeIntegralsFromTail<2>(values, num_full_values, min, range);
+    break;
+  case 3:
+    ConsumeIntegralsFromTail<3>(values, num_full_values, min, range);
+    break;
+  case 4:
+    ConsumeIntegralsFromTail<4>(values, num_full_values, min, range);
+    break;
+  case 5:
+    ConsumeIntegralsFromTail<5>(values, num_full_values, min, range);
+    break;
+  case 6:
+    ConsumeIntegralsFromTail<6>(values, num_full_values, min, range);
+    break;
+  case 7:
+    ConsumeIntegralsFromTail<7>(values, num_full_values, min, range);
+    break;
+  default:
+    ConsumeIntegralsFromTail<8>(values, num_full_values, min, range);
+    break;
+  }
+
+  // Only the first of the remaining values gets the last few bytes.
+  for (size_t i = num_full_values; i < count; ++i)
+    values[i] = ConsumeIntegralInRange(min, max);
+}
+
+// Fills |values| with |count| numbers in the range [Type's lowest, Type's
+// max].
+template <typename T>
+void FuzzedDataProvider::ConsumeFloatingPointArray(T *values, size_t count) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPointArray");
+  ConsumeFloatingPointArrayInRange(values, count,
+                                   std::numeric_limits<T>::lowest(),
+                                   std::numeric_limits<T>::max());
+}
+
+// Fills |values| with |count| numbers in the range [min, max], the same ones
+// |count| calls to |ConsumeFloatingPointInRange| would return.
+template <typename T>
+void FuzzedDataProvider::ConsumeFloatingPointArrayInRange(T *values,
+                                                          size_t count, T min,
+                                                          T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPointArrayInRange");
+  static_assert(std::is_floating_point<T>::value,
+                "A floating point type is required.");
+
+  if (min > max)
+    abort();
+
+  constexpr T zero(.0);
+  if (max > zero && min < zero && max > min + std::numeric_limits<T>::max()) {
+    // Every value consumes a bool before its probability, which rules out
+    // consuming the probabilities in bulk.
+    for (size_t i = 0; i < count; ++i)
+      values[i] = ConsumeFloatingPointInRange(min, max);
+    return;
+  }
+
+  // See |ConsumeProbability|.
+  using IntegralType =
+      typename std::conditional<(sizeof(T) <= sizeof(uint32_t)), uint32_t,
+                                uint64_t>::type;
+  T range = max - min;
+  IntegralType chunk[64];
+  while (count != 0) {
+    size_t chunk_size = std::min(count, sizeof(chunk) / sizeof(chunk[0]));
+    ConsumeIntegralArray(chunk, chunk_size);
+    for (size_t i = 0; i < chunk_size; ++i) {
+      T probability = static_cast<T>(chunk[i]);
+      probability /= static_cast<T>(std::numeric_limits<IntegralType>::max());
+      values[i] = min + range * probability;
+    }
+    values += chunk_size;
+    count -= chunk_size;
+  }
+}
+
+#ifdef FUZZED_DATA_PROVIDER_HAS_SPAN
+template <typename T>
+void FuzzedDataProvider::ConsumeIntegralArray(std::span<T> values) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegralArray");
+  ConsumeIntegralArray(values.data(), values.size());
+}
+
+template <typename T>
+void FuzzedDataProvider::ConsumeIntegralArrayInRange(std::span<T> values,
+                                                     T min, T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeIntegralArrayInRange");
+  ConsumeIntegralArrayInRange(values.data(), values.size(), min, max);
+}
+
+template <typename T>
+void FuzzedDataProvider::ConsumeFloatingPointArray(std::span<T> values) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPointArray");
+  ConsumeFloatingPointArray(values.data(), values.size());
+}
+
+template <typename T>
+void FuzzedDataProvider::ConsumeFloatingPointArrayInRange(std::span<T> values,
+                                                          T min, T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPointArrayInRange");
+  ConsumeFloatingPointArrayInRange(values.data(), values.size(), min, max);
+}
+#endif
+
 // Returns a floating point value in the range [Type's lowest, Type's max] by
 // consuming bytes from the input data. If there's no input data left, always
 // returns approximately 0.
 template <typename T> T FuzzedDataProvider::ConsumeFloatingPoint() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPoint");
   return ConsumeFloatingPointInRange<T>(std::numeric_limits<T>::lowest(),
                                         std::numeric_limits<T>::max());
 }
@@ -258,6 +787,7 @@ template <typename T> T FuzzedDataProvider::ConsumeFloatingPoint() {
 // |min| must be less than or equal to |max|.
 template <typename T>
 T FuzzedDataProvider::ConsumeFloatingPointInRange(T min, T max) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeFloatingPointInRange");
   if (min > max)
     abort();
 
@@ -282,6 +812,7 @@ T FuzzedDataProvider::ConsumeFloatingPointInRange(T min, T max) {
 // Returns a floating point number in the range [0.0, 1.0]. If there's no
 // input data left, always returns 0.
 template <typename T> T FuzzedDataProvider::ConsumeProbability() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeProbability");
   static_assert(std::is_floating_point<T>::value,
                 "A floating point type is required.");
 
@@ -298,6 +829,7 @@ template <typename T> T FuzzedDataProvider::ConsumeProbability() {
 
 // Reads one byte and returns a bool, or false when no data remains.
 inline bool FuzzedDataProvider::ConsumeBool() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeBool");
   return 1 & ConsumeIntegral<uint8_t>();
 }
 
@@ -305,6 +837,7 @@ inline bool FuzzedDataProvider::ConsumeBool() {
 // also contain |kMaxValue| aliased to its largest (inclusive) value. Such as:
 // enum class Foo { SomeValue, OtherValue, kMaxValue = OtherValue };
 template <typename T> T FuzzedDataProvider::ConsumeEnum() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeEnum");
   static_assert(std::is_enum<T>::value, "|T| must be an enum type.");
   return static_cast<T>(
       ConsumeIntegralInRange<uint32_t>(0, static_cast<uint32_t>(T::kMaxValue)));
@@ -313,18 +846,21 @@ template <typename T> T FuzzedDataProvider::ConsumeEnum() {
 // Returns a copy of the value selected from the given fixed-size |array|.
 template <typename T, size_t size>
 T FuzzedDataProvider::PickValueInArray(const T (&array)[size]) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("PickValueInArray");
   static_assert(size > 0, "The array must be non empty.");
   return array[ConsumeIntegralInRange<size_t>(0, size - 1)];
 }
 
 template <typename T, size_t size>
 T FuzzedDataProvider::PickValueInArray(const std::array<T, size> &array) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("PickValueInArray");
   static_assert(size > 0, "The array must be non empty.");
   return array[ConsumeIntegralInRange<size_t>(0, size - 1)];
 }
 
 template <typename T>
 T FuzzedDataProvider::PickValueInArray(std::initializer_list<const T> list) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("PickValueInArray");
   // TODO(Dor1s): switch to static_assert once C++14 is allowed.
   if (!list.size())
     abort();
@@ -340,6 +876,7 @@ T FuzzedDataProvider::PickValueInArray(std::initializer_list<const T> list) {
 // fuzzing data.
 inline size_t FuzzedDataProvider::ConsumeData(void *destination,
                                               size_t num_bytes) {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeData");
   num_bytes = std::min(num_bytes, remaining_bytes_);
   CopyAndAdvance(destination, num_bytes);
   return num_bytes;
@@ -406,4 +943,180 @@ TS FuzzedDataProvider::ConvertUnsignedToSigned(TU value) {
   }
 }
 
+// Consumes |num_bytes| bytes, which have to remain, from the end of the data
+// and returns a pointer to them.
+inline const uint8_t *FuzzedDataProvider::ConsumeFromTail(size_t num_bytes) {
+  remaining_bytes_ -= num_bytes;
+  return data_ptr_ + remaining_bytes_;
+}
+
+// Consumes |count| values of |num_bytes| bytes each from the end of the data,
+// in the same order and with the same reduction as |ConsumeIntegralInRange|.
+// The byte count being a compile-time constant turns the per-byte loop into a
+// single load.
+template <size_t num_bytes, typename T>
+void FuzzedDataProvider::ConsumeIntegralsFromTail(T *values, size_t count,
+                                                  T min, uint64_t range) {
+  if (count * num_bytes > remaining_bytes_)
+    abort();
+
+  const uint8_t *tail = data_ptr_ + remaining_bytes_;
+  bool reduce = range != std::numeric_limits<decltype(range)>::max();
+  // A modulus that is a power of two only needs a mask.
+  bool mask = reduce && (range & (range + 1)) == 0;
+  // Other moduli of 32-bit values are computed without a division, see
+  // Lemire et al., "Faster Remainder by Direct Computation" (2019).
+  uint64_t modulus = range + 1;
+  uint64_t multiplier = 0;
+  if (num_bytes <= sizeof(uint32_t) && reduce && !mask)
+    multiplier = UINT64_MAX / modulus + 1;
+  for (size_t i = 0; i < count; ++i) {
+    tail -= num_bytes;
+    uint64_t result = 0;
+    for (size_t j = num_bytes; j != 0; --j)
+      result = (result << CHAR_BIT) | tail[j - 1];
+    if (mask) {
+      result &= range;
+    } else if (multiplier != 0) {
+      // The upper 64 bits of the 128-bit product of the fraction and the
+      // modulus, which is less than 2^32.
+      uint64_t fraction = multiplier * result;
+      uint64_t low = ((fraction & UINT32_MAX) * modulus) >> 32;
+      result = (low + (fraction >> 32) * modulus) >> 32;
+    } else if (reduce) {
+      result %= modulus;
+    }
+    values[i] = static_cast<T>(min + result);
+  }
+  remaining_bytes_ -= count * num_bytes;
+}
+
+#ifdef FUZZED_DATA_PROVIDER_HAS_STRING_VIEW
+inline char *FuzzedDataProvider::AllocateFromArena(size_t size) {
+  if (size > arena_remaining_) {
+    // Grow geometrically so that the number of blocks, and thus the cost of
+    // releasing them, stays logarithmic in the total size.
+    arena_block_size_ =
+        std::max({size_t{4096}, 2 * arena_block_size_, size});
+    arena_blocks_.emplace_back(new char[arena_block_size_]);
+    arena_ptr_ = arena_blocks_.back().get();
+    arena_remaining_ = arena_block_size_;
+  }
+  char *result = arena_ptr_;
+  arena_ptr_ += size;
+  arena_remaining_ -= size;
+  return result;
+}
+#endif
+
+// Fields of the records returned by |ConsumeRecord|. Every field consumes
+// exactly |kNumBytes| bytes from the end of the data while enough remain, so
+// |FuzzedRecordSize| also documents the input layout for corpus tooling.
+
+// An integral value in the range [Min, Max], see |ConsumeIntegralInRange|.
+template <typename T, T Min = std::numeric_limits<T>::min(),
+          T Max = std::numeric_limits<T>::max()>
+struct FuzzedIntegralField {
+  static_assert(std::is_integral<T>::value, "An integral type is required.");
+  static_assert(sizeof(T) <= sizeof(uint64_t), "Unsupported integral type.");
+  static_assert(Min <= Max, "Min must not be greater than Max.");
+
+  using Type = T;
+  static constexpr uint64_t kRange = static_cast<uint64_t>(Max) - Min;
+  static constexpr size_t kNumBytes =
+      kRange > 0xFFFFFFFFFFFFFF   ? 8
+      : kRange > 0xFFFFFFFFFFFF   ? 7
+      : kRange > 0xFFFFFFFFFF     ? 6
+      : kRange > 0xFFFFFFFF       ? 5
+      : kRange > 0xFFFFFF         ? 4
+      : kRange > 0xFFFF           ? 3
+      : kRange > 0xFF             ? 2
+      : kRange > 0                ? 1
+                                  : 0;
+
+  static T Consume(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeIntegralInRange<T>(Min, Max);
+  }
+
+  // Decodes the |kNumBytes| bytes at |bytes|, the last one of which is the
+  // most significant.
+  static T Decode(const uint8_t *bytes) {
+    uint64_t result = 0;
+    for (size_t i = kNumBytes; i != 0; --i)
+      result = (result << CHAR_BIT) | bytes[i - 1];
+    // Avoid division by 0, in case |kRange + 1| results in overflow.
+    if (kRange != std::numeric_limits<uint64_t>::max())
+      result = result % (kRange + 1);
+    return static_cast<T>(Min + result);
+  }
+};
+
+// A bool, see |ConsumeBool|.
+struct FuzzedBoolField {
+  using Type = bool;
+  static constexpr size_t kNumBytes = 1;
+
+  static bool Consume(FuzzedDataProvider &fdp) { return fdp.ConsumeBool(); }
+  static bool Decode(const uint8_t *bytes) { return 1 & bytes[0]; }
+};
+
+// A value of the enum |T|, see |ConsumeEnum|.
+template <typename T> struct FuzzedEnumField {
+  static_assert(std::is_enum<T>::value, "|T| must be an enum type.");
+
+  using Type = T;
+  using Integral =
+      FuzzedIntegralField<uint32_t, 0, static_cast<uint32_t>(T::kMaxValue)>;
+  static constexpr size_t kNumBytes = Integral::kNumBytes;
+
+  static T Consume(FuzzedDataProvider &fdp) { return fdp.ConsumeEnum<T>(); }
+  static T Decode(const uint8_t *bytes) {
+    return static_cast<T>(Integral::Decode(bytes));
+  }
+};
+
+// A floating point number in the range [0.0, 1.0], see |ConsumeProbability|.
+template <typename T> struct FuzzedProbabilityField {
+  static_assert(std::is_floating_point<T>::value,
+                "A floating point type is required.");
+
+  using Type = T;
+  using IntegralType =
+      typename std::conditional<(sizeof(T) <= sizeof(uint32_t)), uint32_t,
+                                uint64_t>::type;
+  using Integral = FuzzedIntegralField<IntegralType>;
+  static constexpr size_t kNumBytes = Integral::kNumBytes;
+
+  static T Consume(FuzzedDataProvider &fdp) {
+    return fdp.ConsumeProbability<T>();
+  }
+  static T Decode(const uint8_t *bytes) {
+    T result = static_cast<T>(Integral::Decode(bytes));
+    result /= static_cast<T>(std::numeric_limits<IntegralType>::max());
+    return result;
+  }
+};
+
+// The number of bytes a record of |Fields| consumes.
+template <typename... Fields> struct FuzzedRecordSize;
+template <> struct FuzzedRecordSize<> {
+  static constexpr size_t value = 0;
+};
+template <typename Field, typename... Fields>
+struct FuzzedRecordSize<Field, Fields...> {
+  static constexpr size_t value =
+      Field::kNumBytes + FuzzedRecordSize<Fields...>::value;
+};
+
+template <typename... Fields>
+std::tuple<typename Fields::Type...> FuzzedDataProvider::ConsumeRecord() {
+  FUZZED_DATA_PROVIDER_PROFILE_CALL("ConsumeRecord");
+  // The elements of a braced initializer list are evaluated in order, which
+  // consumes the fields in order.
+  if (remaining_bytes_ < FuzzedRecordSize<Fields...>::value)
+    return std::tuple<typename Fields::Type...>{Fields::Consume(*this)...};
+  return std::tuple<typename Fields::Type...>{
+      Fields::Decode(ConsumeFromTail(Fields::kNumBytes))...};
+}
+
 #endif // LLVM_FUZZER_FUZZED_DATA_PROVIDER_H_
@@ -0,0 +1,423 @@
+package benchmark
+
+import (
+	"bufio"
+	"context"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/otiai10/copy"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/integration-tests/shared"
+	builderPkg "code-intelligence.com/cifuzz/internal/builder"
+	"code-intelligence.com/cifuzz/internal/testutil"
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/util/executil"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+var (
+	resultsPath = flag.String("benchmark-results", "",
+		"The file to write the results of TestBenchmark to as JSON. The benchmark only runs if this is set.")
+	numRuns = flag.Uint64("benchmark-runs", 100_000,
+		"The number of inputs each fuzz test is executed with.")
+	runTimeout = flag.Duration("benchmark-timeout", 10*time.Minute,
+		"The maximum duration of a single run, including the build.")
+)
+
+// A target is a fuzz test of a project in this repository.
+type target struct {
+	Name     string `json:"name"`
+	FuzzTest string `json:"fuzz_test"`
+
+	// The directory of the project relative to the repository root,
+	// which is copied to a temporary directory before it's set up
+	dir         string
+	buildSystem string
+	// setup prepares the copied project, e.g. by adding the fuzz test
+	setup func(t *testing.T, runner *shared.CIFuzzRunner)
+	// The environment and the additional arguments of cifuzz run
+	env  func(dir string) []string
+	args []string
+}
+
+var targets = []*target{
+	{
+		Name:        "examples/cmake",
+		FuzzTest:    "my_fuzz_test",
+		dir:         filepath.Join("examples", "cmake"),
+		buildSystem: "cmake",
+	},
+	{
+		Name:        "examples/other",
+		FuzzTest:    "my_fuzz_test",
+		dir:         filepath.Join("examples", "other"),
+		buildSystem: "other",
+	},
+	{
+		Name:        "examples/bazel",
+		FuzzTest:    "//src:explore_me_fuzz_test",
+		dir:         filepath.Join("examples", "bazel"),
+		buildSystem: "bazel",
+	},
+	{
+		Name:        "integration-tests/cmake",
+		FuzzTest:    "parser_fuzz_test",
+		dir:         filepath.Join("integration-tests", "cmake", "testdata"),
+		buildSystem: "cmake",
+		setup:       setupCMakeTestdata,
+	},
+	{
+		Name:        "integration-tests/other",
+		FuzzTest:    "my_fuzz_test",
+		dir:         filepath.Join("integration-tests", "other", "testdata"),
+		buildSystem: "other",
+		env: func(dir string) []string {
+			if runtime.GOOS == "darwin" {
+				return append(os.Environ(), "DYLD_LIBRARY_PATH="+dir)
+			}
+			return append(os.Environ(), "LD_LIBRARY_PATH="+filepath.Join(dir, "build"))
+		},
+		args: []string{"--build-command", otherTestdataBuildCommand()},
+	},
+}
+
+// A config is a combination of the settings of cifuzz run which affect
+// the throughput of a fuzz test.
+type config struct {
+	Engine       string `json:"engine"`
+	BuildProfile string `json:"build_profile,omitempty"`
+	Sandbox      bool   `json:"sandbox"`
+	// cifuzz run always builds C/C++ fuzz tests with these sanitizers
+	Sanitizers []string `json:"sanitizers"`
+}
+
+func (c *config) String() string {
+	s := c.Engine
+	if c.BuildProfile != "" {
+		s += "-" + c.BuildProfile
+	}
+	if c.Sandbox {
+		s += "-sandbox"
+	}
+	return s
+}
+
+type result struct {
+	Target *target `json:"target"`
+	Config *config `json:"config"`
+	Runs   uint64  `json:"runs"`
+
+	// The throughput which the engine reported last
+	ExecutionsPerSecond int32 `json:"executions_per_second"`
+	// The throughput of the whole run of the fuzzer, from the start of
+	// the initialization until cifuzz exited. Compared to
+	// ExecutionsPerSecond, this includes the overhead of cifuzz.
+	EffectiveExecutionsPerSecond float64 `json:"effective_executions_per_second"`
+	TotalExecutions              uint64  `json:"total_executions"`
+	// The time from the start of cifuzz run until the fuzzer started,
+	// which is mostly the build
+	SecondsToStart float64 `json:"seconds_to_start"`
+	// The time from the start of the fuzzer until it finished running
+	// the seed corpus, e.g. until libFuzzer printed INITED
+	SecondsToInited float64 `json:"seconds_to_inited"`
+	TotalSeconds    float64 `json:"total_seconds"`
+	PeakRSSBytes    uint64  `json:"peak_rss_bytes,omitempty"`
+	// Whether the run stopped early because of a finding
+	Finding bool   `json:"finding"`
+	Error   string `json:"error,omitempty"`
+}
+
+type results struct {
+	Timestamp time.Time `json:"timestamp"`
+	OS        string    `json:"os"`
+	Arch      string    `json:"arch"`
+	NumCPU    int       `json:"num_cpu"`
+	Results   []*result `json:"results"`
+}
+
+// TestBenchmark runs the fuzz tests of the examples and the integration
+// tests with every engine, build profile and sandbox setting which is
+// available on this system for a fixed number of inputs and writes the
+// metrics of the runs to the file passed via -benchmark-results, so
+// that the overhead of cifuzz can be tracked across releases. Run it
+// with:
+//
+//	go test ./integration-tests/benchmark -run TestBenchmark -timeout 0 -args -benchmark-results=results.json
+func TestBenchmark(t *testing.T) {
+	if testing.Short() || *resultsPath == "" {
+		t.Skip("Pass -benchmark-results to run the benchmark")
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("The benchmark doesn't support Windows yet")
+	}
+
+	// Install cifuzz
+	testutil.RegisterTestDepOnCIFuzz()
+	installDir := shared.InstallCIFuzzInTemp(t)
+	t.Cleanup(func() { fileutil.Cleanup(installDir) })
+	cifuzz := builderPkg.CIFuzzExecutablePath(filepath.Join(installDir, "bin"))
+	// Include the CMake package by setting the CMAKE_PREFIX_PATH.
+	t.Setenv("CMAKE_PREFIX_PATH", filepath.Join(installDir, "share", "cmake"))
+
+	res := &results{
+		Timestamp: time.Now(),
+		OS:        runtime.GOOS,
+		Arch:      runtime.GOARCH,
+		NumCPU:    runtime.NumCPU(),
+	}
+	// The runs are not parallel, so that they don't compete for the CPUs
+	for _, tgt := range targets {
+		tgt := tgt
+		t.Run(tgt.Name, func(t *testing.T) {
+			if tgt.buildSystem == "bazel" {
+				if _, err := exec.LookPath("bazel"); err != nil {
+					t.Skip("bazel is not installed")
+				}
+			}
+			dir := copyProject(t, tgt.dir)
+			t.Cleanup(func() { fileutil.Cleanup(dir) })
+			if tgt.setup != nil {
+				tgt.setup(t, &shared.CIFuzzRunner{CIFuzzPath: cifuzz, DefaultWorkDir: dir, DefaultFuzzTest: tgt.FuzzTest})
+			}
+
+			for _, c := range configs(tgt) {
+				c := c
+				t.Run(c.String(), func(t *testing.T) {
+					r := runBenchmark(t, cifuzz, dir, tgt, c)
+					if r.Error != "" {
+						t.Errorf("%s failed: %s", c, r.Error)
+					}
+					t.Logf("%d exec/s (%.0f effective), %.2fs to INITED, %d MiB RSS",
+						r.ExecutionsPerSecond, r.EffectiveExecutionsPerSecond, r.SecondsToInited, r.PeakRSSBytes>>20)
+					res.Results = append(res.Results, r)
+				})
+			}
+		})
+	}
+
+	data, err := json.MarshalIndent(res, "", "  ")
+	require.NoError(t, err)
+	err = os.WriteFile(*resultsPath, data, 0o644)
+	require.NoError(t, err)
+}
+
+// configs returns the configs which are supported by the build system
+// of the target and are available on this system.
+func configs(tgt *target) []*config {
+	sanitizers := []string{"address", "undefined"}
+	sandboxes := []bool{false}
+	if runtime.GOOS == "linux" {
+		sandboxes = append(sandboxes, true)
+	}
+
+	// Only CMake fuzz tests support other engines and build profiles
+	if tgt.buildSystem != "cmake" {
+		var configs []*config
+		for _, sandbox := range sandboxes {
+			configs = append(configs, &config{Engine: "libfuzzer", Sandbox: sandbox, Sanitizers: sanitizers})
+		}
+		return configs
+	}
+
+	engines := []string{"libfuzzer"}
+	if _, err := exec.LookPath("afl-clang-lto"); err == nil {
+		engines = append(engines, "aflpp")
+	}
+	if _, err := exec.LookPath("centipede"); err == nil && os.Getenv("CIFUZZ_CENTIPEDE_RUNNER") != "" {
+		engines = append(engines, "centipede")
+	}
+	var configs []*config
+	for _, engine := range engines {
+		for _, profile := range []string{"debug", "throughput"} {
+			for _, sandbox := range sandboxes {
+				// Only libFuzzer supports the sandbox
+				if sandbox && engine != "libfuzzer" {
+					continue
+				}
+				configs = append(configs, &config{Engine: engine, BuildProfile: profile, Sandbox: sandbox, Sanitizers: sanitizers})
+			}
+		}
+	}
+	return configs
+}
+
+// runArgs returns the engine arguments which limit the run to a fixed
+// number of inputs and make it deterministic.
+func runArgs(engine string, runs uint64) []string {
+	n := strconv.FormatUint(runs, 10)
+	switch engine {
+	case "aflpp":
+		return []string{"-s", "1", "-E", n}
+	case "centipede":
+		return []string{"--seed=1", "--num_runs=" + n}
+	default:
+		return []string{"-seed=1", "-runs=" + n}
+	}
+}
+
+// runBenchmark runs the fuzz test with cifuzz run --json and collects
+// the metrics from the reports which it prints to stdout.
+func runBenchmark(t *testing.T, cifuzz, dir string, tgt *target, c *config) *result {
+	r := &result{Target: tgt, Config: c, Runs: *numRuns}
+
+	args := []string{
+		"run", tgt.FuzzTest,
+		"--json",
+		"--no-notifications",
+		"--interactive=false",
+		"--use-sandbox=" + strconv.FormatBool(c.Sandbox),
+	}
+	if tgt.buildSystem == "cmake" {
+		args = append(args, "--engine", c.Engine, "--build-profile", c.BuildProfile)
+	}
+	for _, arg := range runArgs(c.Engine, *numRuns) {
+		args = append(args, "--engine-arg="+arg)
+	}
+	args = append(args, tgt.args...)
+
+	ctx, cancel := context.WithTimeout(context.Background(), *runTimeout)
+	defer cancel()
+	cmd := executil.CommandContext(ctx, cifuzz, args...)
+	cmd.Dir = dir
+	if tgt.env != nil {
+		cmd.Env = tgt.env(dir)
+	}
+	stdout, err := cmd.StdoutPipe()
+	require.NoError(t, err)
+	stderr := &tailWriter{}
+	cmd.Stderr = stderr
+	shared.TerminateOnSignal(t, cmd)
+
+	t.Logf("Command: %s", cmd.String())
+	start := time.Now()
+	err = cmd.Start()
+	require.NoError(t, err)
+
+	var initializing, running time.Time
+	var lastMetric *report.FuzzingMetric
+	// The reports are printed as a stream of JSON objects
+	decoder := json.NewDecoder(bufio.NewReader(stdout))
+	for {
+		var rep report.Report
+		err := decoder.Decode(&rep)
+		if err != nil {
+			if err != io.EOF {
+				r.Error = fmt.Sprintf("failed to parse the output of cifuzz: %v", err)
+			}
+			// Read the rest of the output, else cifuzz could block
+			_, _ = io.Copy(io.Discard, stdout)
+			break
+		}
+		now := time.Now()
+		if rep.Status == report.RunStatusInitializing && initializing.IsZero() {
+			initializing = now
+		}
+		if rep.Status == report.RunStatusRunning && running.IsZero() {
+			running = now
+		}
+		if rep.Metric != nil {
+			lastMetric = rep.Metric
+			if rep.Metric.PeakRSSBytes > r.PeakRSSBytes {
+				r.PeakRSSBytes = rep.Metric.PeakRSSBytes
+			}
+		}
+		if rep.Finding != nil {
+			r.Finding = true
+		}
+	}
+	err = cmd.Wait()
+	end := time.Now()
+	if err != nil && r.Error == "" {
+		r.Error = fmt.Sprintf("%v\n%s", err, stderr.String())
+	}
+
+	r.TotalSeconds = end.Sub(start).Seconds()
+	if !initializing.IsZero() {
+		r.SecondsToStart = initializing.Sub(start).Seconds()
+		if !running.IsZero() {
+			r.SecondsToInited = running.Sub(initializing).Seconds()
+		}
+	}
+	if lastMetric != nil {
+		r.ExecutionsPerSecond = lastMetric.ExecutionsPerSecond
+		r.TotalExecutions = lastMetric.TotalExecutions
+		if !initializing.IsZero() {
+			r.EffectiveExecutionsPerSecond = float64(lastMetric.TotalExecutions) / end.Sub(initializing).Seconds()
+		}
+	}
+	return r
+}
+
+// copyProject copies the project at the path relative to the repository
+// root to a temporary directory and returns its path.
+func copyProject(t *testing.T, relPath string) string {
+	fileutil.ForceLongPathTempDir()
+
+	cwd, err := os.Getwd()
+	require.NoError(t, err)
+	dir, err := os.MkdirTemp("", "cifuzz-benchmark-")
+	require.NoError(t, err)
+	err = copy.Copy(filepath.Join(cwd, "..", "..", relPath), dir)
+	require.NoError(t, err)
+	return dir
+}
+
+// setupCMakeTestdata adds the parser fuzz test to the testdata of the
+// CMake integration test, like TestIntegration_CMake does.
+func setupCMakeTestdata(t *testing.T, runner *shared.CIFuzzRunner) {
+	dir := runner.DefaultWorkDir
+	linesToAdd := runner.CommandWithFilterForInstructions(t, "init", nil)
+	shared.AddLinesToFileAtBreakPoint(t, filepath.Join(dir, "CMakeLists.txt"), linesToAdd, "add_subdirectory", false)
+
+	outputPath := filepath.Join("src", "parser", "parser_fuzz_test.cpp")
+	linesToAdd = runner.CommandWithFilterForInstructions(t, "create", &shared.CommandOptions{
+		Args: []string{"cpp", "--output", outputPath},
+	})
+	fuzzTestPath := filepath.Join(dir, outputPath)
+	cmakeLists := filepath.Join(filepath.Dir(fuzzTestPath), "CMakeLists.txt")
+	shared.AppendLines(t, cmakeLists, linesToAdd)
+	shared.ModifyFuzzTestToCallFunction(t, fuzzTestPath)
+	shared.AppendLines(t, cmakeLists, []string{"target_link_libraries(parser_fuzz_test PRIVATE parser)"})
+}
+
+func otherTestdataBuildCommand() string {
+	if runtime.GOOS == "darwin" {
+		return "make -f Makefile.darwin clean && make -f Makefile.darwin $FUZZ_TEST"
+	}
+	return "make clean && make $FUZZ_TEST"
+}
+
+// tailWriter keeps the last lines written to it, which are included in
+// the result if cifuzz fails.
+type tailWriter struct {
+	lines   []string
+	partial string
+}
+
+const numTailLines = 20
+
+func (w *tailWriter) Write(p []byte) (int, error) {
+	lines := strings.Split(w.partial+string(p), "\n")
+	w.partial = lines[len(lines)-1]
+	w.lines = append(w.lines, lines[:len(lines)-1]...)
+	if len(w.lines) > numTailLines {
+		w.lines = w.lines[len(w.lines)-numTailLines:]
+	}
+	return len(p), nil
+}
+
+func (w *tailWriter) String() string {
+	return strings.Join(append(w.lines, w.partial), "\n")
+}
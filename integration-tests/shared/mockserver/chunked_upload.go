@@ -0,0 +1,146 @@
+package mockserver
+
+import (
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"strconv"
+	"strings"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+// ChunkedUpload mocks the chunked upload of a bundle to a project, see
+// api.UploadBundleInChunks.
+type ChunkedUpload struct {
+	Name string
+
+	mutex     sync.Mutex
+	size      int64
+	chunkSize int64
+	chunks    map[int][]byte
+	// The number of chunks which were sent, including those which
+	// were sent more than once
+	numChunksSent int
+	completed     bool
+}
+
+// HandleChunkedUpload registers the handlers of the chunked upload to
+// the project, which responds with artifactJSON once it's completed.
+func (server *MockServer) HandleChunkedUpload(t *testing.T, projectName string, artifactJSON string) *ChunkedUpload {
+	upload := &ChunkedUpload{
+		Name:   fmt.Sprintf("projects/%s/artifacts/uploads/upload-1", projectName),
+		chunks: make(map[int][]byte),
+	}
+
+	server.Handlers[fmt.Sprintf("/v2/projects/%s/artifacts/uploads", projectName)] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "POST", req.Method)
+		var body struct {
+			Size      int64 `json:"size"`
+			ChunkSize int64 `json:"chunk_size"`
+		}
+		require.NoError(t, json.NewDecoder(req.Body).Decode(&body))
+		upload.mutex.Lock()
+		upload.size, upload.chunkSize = body.Size, body.ChunkSize
+		upload.mutex.Unlock()
+		writeJSON(t, w, map[string]any{"name": upload.Name})
+	}
+
+	server.Handlers["/v2/"+upload.Name] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "GET", req.Method)
+		writeJSON(t, w, upload.status())
+	}
+
+	server.Handlers["/v2/"+upload.Name+"/chunks/"] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "PUT", req.Method)
+		index, err := strconv.Atoi(strings.TrimPrefix(req.URL.Path, "/v2/"+upload.Name+"/chunks/"))
+		require.NoError(t, err)
+		data, err := io.ReadAll(req.Body)
+		require.NoError(t, err)
+
+		sum := sha256.Sum256(data)
+		expectedDigest := "sha-256=:" + base64.StdEncoding.EncodeToString(sum[:]) + ":"
+		upload.mutex.Lock()
+		defer upload.mutex.Unlock()
+		upload.numChunksSent++
+		if req.Header.Get("Content-Digest") != expectedDigest {
+			w.WriteHeader(http.StatusUnprocessableEntity)
+			return
+		}
+		upload.chunks[index] = data
+		writeJSON(t, w, map[string]any{"index": index, "sha256": hex.EncodeToString(sum[:])})
+	}
+
+	server.Handlers["/v2/"+upload.Name+":complete"] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "POST", req.Method)
+		upload.mutex.Lock()
+		defer upload.mutex.Unlock()
+		assert.Equal(t, upload.size, int64(len(upload.content())), "Upload completed with missing chunks")
+		upload.completed = true
+		_, err := io.WriteString(w, artifactJSON)
+		require.NoError(t, err)
+	}
+
+	return upload
+}
+
+// AddChunk adds a chunk as if it was uploaded before, to test that
+// interrupted uploads are resumed.
+func (upload *ChunkedUpload) AddChunk(index int, data []byte, size, chunkSize int64) {
+	upload.mutex.Lock()
+	defer upload.mutex.Unlock()
+	upload.size, upload.chunkSize = size, chunkSize
+	upload.chunks[index] = data
+}
+
+// Content returns the uploaded file if the upload was completed.
+func (upload *ChunkedUpload) Content() ([]byte, bool) {
+	upload.mutex.Lock()
+	defer upload.mutex.Unlock()
+	return upload.content(), upload.completed
+}
+
+func (upload *ChunkedUpload) NumChunksSent() int {
+	upload.mutex.Lock()
+	defer upload.mutex.Unlock()
+	return upload.numChunksSent
+}
+
+func (upload *ChunkedUpload) content() []byte {
+	var content []byte
+	for i := 0; ; i++ {
+		chunk, ok := upload.chunks[i]
+		if !ok {
+			return content
+		}
+		content = append(content, chunk...)
+	}
+}
+
+func (upload *ChunkedUpload) status() map[string]any {
+	upload.mutex.Lock()
+	defer upload.mutex.Unlock()
+	var chunks []map[string]any
+	for index, data := range upload.chunks {
+		sum := sha256.Sum256(data)
+		chunks = append(chunks, map[string]any{"index": index, "sha256": hex.EncodeToString(sum[:])})
+	}
+	return map[string]any{
+		"name":       upload.Name,
+		"size":       upload.size,
+		"chunk_size": upload.chunkSize,
+		"chunks":     chunks,
+	}
+}
+
+func writeJSON(t *testing.T, w http.ResponseWriter, v any) {
+	err := json.NewEncoder(w).Encode(v)
+	require.NoError(t, err)
+}
@@ -0,0 +1,130 @@
+package mockserver
+
+import (
+	"archive/tar"
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"sort"
+	"strings"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+// CorpusSync mocks the corpus of a fuzz target on the server, see
+// api.SyncCorpus.
+type CorpusSync struct {
+	mutex  sync.Mutex
+	inputs map[string][]byte
+	// The hashes the client sent in its last sync request
+	clientHashes []string
+}
+
+// HandleCorpusSync registers the handlers of the corpus sync of the
+// fuzz target in the project, whose corpus initially has the inputs.
+func (server *MockServer) HandleCorpusSync(t *testing.T, projectName string, fuzzTarget string, inputs ...[]byte) *CorpusSync {
+	corpus := &CorpusSync{inputs: make(map[string][]byte)}
+	for _, input := range inputs {
+		corpus.inputs[hash(input)] = input
+	}
+	prefix := fmt.Sprintf("/v1/projects/%s/fuzz_targets/%s/", projectName, base64.URLEncoding.EncodeToString([]byte(fuzzTarget)))
+
+	server.Handlers[prefix+"corpus:sync"] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "POST", req.Method)
+		var body struct {
+			Hashes []string `json:"hashes"`
+		}
+		require.NoError(t, json.NewDecoder(req.Body).Decode(&body))
+
+		corpus.mutex.Lock()
+		defer corpus.mutex.Unlock()
+		corpus.clientHashes = body.Hashes
+		clientHashes := make(map[string]bool)
+		var missing []string
+		for _, h := range body.Hashes {
+			clientHashes[h] = true
+			if _, ok := corpus.inputs[h]; !ok {
+				missing = append(missing, h)
+			}
+		}
+		var hashes []string
+		for h := range corpus.inputs {
+			if !clientHashes[h] {
+				hashes = append(hashes, h)
+			}
+		}
+		if len(hashes) == 0 && len(missing) == 0 {
+			w.WriteHeader(http.StatusNoContent)
+			return
+		}
+		sort.Strings(hashes)
+
+		archive := tar.NewWriter(w)
+		for _, h := range hashes {
+			writeTarEntry(t, archive, "inputs/"+h, corpus.inputs[h])
+		}
+		if len(missing) > 0 {
+			writeTarEntry(t, archive, "missing", []byte(strings.Join(missing, "\n")+"\n"))
+		}
+		require.NoError(t, archive.Close())
+	}
+
+	server.Handlers[prefix+"corpus:upload"] = func(w http.ResponseWriter, req *http.Request) {
+		require.Equal(t, "POST", req.Method)
+		corpus.mutex.Lock()
+		defer corpus.mutex.Unlock()
+		archive := tar.NewReader(req.Body)
+		for {
+			header, err := archive.Next()
+			if err == io.EOF {
+				break
+			}
+			require.NoError(t, err)
+			data, err := io.ReadAll(archive)
+			require.NoError(t, err)
+			assert.Equal(t, "inputs/"+hash(data), header.Name)
+			corpus.inputs[hash(data)] = data
+		}
+		writeJSON(t, w, map[string]any{})
+	}
+
+	return corpus
+}
+
+// Inputs returns the contents of the inputs of the corpus, sorted.
+func (corpus *CorpusSync) Inputs() []string {
+	corpus.mutex.Lock()
+	defer corpus.mutex.Unlock()
+	var inputs []string
+	for _, input := range corpus.inputs {
+		inputs = append(inputs, string(input))
+	}
+	sort.Strings(inputs)
+	return inputs
+}
+
+// ClientHashes returns the hashes the client sent in its last sync.
+func (corpus *CorpusSync) ClientHashes() []string {
+	corpus.mutex.Lock()
+	defer corpus.mutex.Unlock()
+	return corpus.clientHashes
+}
+
+func hash(data []byte) string {
+	sum := sha256.Sum256(data)
+	return hex.EncodeToString(sum[:])
+}
+
+func writeTarEntry(t *testing.T, archive *tar.Writer, name string, data []byte) {
+	err := archive.WriteHeader(&tar.Header{Typeflag: tar.TypeReg, Name: name, Mode: 0o644, Size: int64(len(data))})
+	require.NoError(t, err)
+	_, err = archive.Write(data)
+	require.NoError(t, err)
+}
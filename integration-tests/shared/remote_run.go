@@ -24,7 +24,7 @@ func TestRemoteRun(t *testing.T, dir string, cifuzz string, args ...string) {
 
 	// define handlers
 	server.Handlers["/v1/projects"] = mockserver.ReturnResponse(t, mockserver.ProjectsJSON)
-	server.Handlers[fmt.Sprintf("/v2/projects/%s/artifacts/import", projectName)] = mockserver.ReturnResponse(t,
+	upload := server.HandleChunkedUpload(t, projectName,
 		fmt.Sprintf(`{"display-name": "test-artifacts", "resource-name": %q}`, artifactsName),
 	)
 	server.Handlers[fmt.Sprintf("/v1/%s:run", artifactsName)] = mockserver.ReturnResponse(t, `{"name": "test-campaign-run-123"}`)
@@ -58,6 +58,7 @@ func TestRemoteRun(t *testing.T, dir string, cifuzz string, args ...string) {
 			"--timeout", "100m",
 			"--project", projectName,
 			"--server", server.Address,
+			"--chunked-upload",
 		}, args...)
 	cmd := executil.Command(cifuzz, args...)
 	cmd.Dir = dir
@@ -73,6 +74,9 @@ func TestRemoteRun(t *testing.T, dir string, cifuzz string, args ...string) {
 	t.Logf("Command: %s", cmd.String())
 	err = cmd.Run()
 	require.NoError(t, err)
+
+	_, completed := upload.Content()
+	require.True(t, completed)
 }
 
 func TestRemoteRunWithAdditionalArgs(t *testing.T, dir string, cifuzz string, expectedErrorExp *regexp.Regexp, args ...string) {
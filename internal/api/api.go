@@ -1,6 +1,8 @@
 package api
 
 import (
+	"bytes"
+	"compress/gzip"
 	"context"
 	"encoding/json"
 	"fmt"
@@ -22,6 +24,7 @@ import (
 	"code-intelligence.com/cifuzz/internal/cmd/remoterun/progress"
 	"code-intelligence.com/cifuzz/internal/cmdutils"
 	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/sliceutil"
 	"code-intelligence.com/cifuzz/util/stringutil"
 )
 
@@ -87,6 +90,36 @@ func WrapConnectionError(err error) error {
 
 type APIClient struct {
 	Server string
+
+	// Set once the server rejected a compressed request
+	noCompression bool
+}
+
+const (
+	// The number of times a request is sent before giving up
+	maxRequestAttempts = 4
+	// Smaller request bodies are not worth compressing
+	minCompressedBodySize = 1024
+)
+
+// The time to wait before the first retry of a request, which doubles
+// with every retry
+var initialRetryBackoff = 2 * time.Second
+
+// The status codes with which the server tells us to try again later
+var retryStatusCodes = []int{
+	http.StatusTooManyRequests,
+	http.StatusBadGateway,
+	http.StatusServiceUnavailable,
+	http.StatusGatewayTimeout,
+}
+
+// The status codes with which the server tells us to try again later
+// without having handled the request. A gateway error can also mean
+// that the server handled the request but the response got lost.
+var notHandledStatusCodes = []int{
+	http.StatusTooManyRequests,
+	http.StatusServiceUnavailable,
 }
 
 var FeaturedProjectsOrganization = "organizations/1"
@@ -246,7 +279,7 @@ func (client *APIClient) StartRemoteFuzzingRun(artifact *Artifact, token string)
 }
 
 // sendRequest sends a request to the API server with a default timeout of 60 seconds.
-func (client *APIClient) sendRequest(method string, endpoint string, body io.Reader, token string) (*http.Response, error) {
+func (client *APIClient) sendRequest(method string, endpoint string, body []byte, token string) (*http.Response, error) {
 	// we use 60 seconds as a conservative timeout for the API server to
 	// respond to a request. We might have to revisit this value in the future
 	// after the rollout of our API  features.
@@ -255,16 +288,112 @@ func (client *APIClient) sendRequest(method string, endpoint string, body io.Rea
 }
 
 // sendRequestWithTimeout sends a request to the API server with a timeout.
-func (client *APIClient) sendRequestWithTimeout(method string, endpoint string, body io.Reader, token string, timeout time.Duration) (*http.Response, error) {
+// Requests which fail to connect or which the server is too busy to
+// handle are retried with an exponential backoff, see shouldRetry.
+func (client *APIClient) sendRequestWithTimeout(method string, endpoint string, body []byte, token string, timeout time.Duration) (*http.Response, error) {
+	backoff := initialRetryBackoff
+	for attempt := 1; ; attempt++ {
+		resp, err := client.sendRequestOnce(method, endpoint, body, token, timeout)
+		if !shouldRetry(method, resp, err) || attempt == maxRequestAttempts {
+			return resp, err
+		}
+
+		if err != nil {
+			log.Debugf("Request to %s failed, retrying in %s: %v", endpoint, backoff, err)
+		} else {
+			log.Debugf("Request to %s failed with %s, retrying in %s", endpoint, resp.Status, backoff)
+			resp.Body.Close()
+		}
+		err = waitBeforeRetry(backoff)
+		if err != nil {
+			return nil, err
+		}
+		backoff *= 2
+	}
+}
+
+// shouldRetry returns whether a request which failed with the response
+// or error can be sent again. Requests which are not idempotent, e.g.
+// those creating a fuzzing run, are only sent again if the server
+// didn't handle them, so that they aren't handled twice.
+func shouldRetry(method string, resp *http.Response, err error) bool {
+	idempotent := method != http.MethodPost && method != http.MethodPatch
+	if err != nil {
+		var connErr *ConnectionError
+		if !errors.As(err, &connErr) {
+			return false
+		}
+		return idempotent || !requestSent(err)
+	}
+	if idempotent {
+		return sliceutil.Contains(retryStatusCodes, resp.StatusCode)
+	}
+	return sliceutil.Contains(notHandledStatusCodes, resp.StatusCode)
+}
+
+// requestSent returns false if the request failed with the error
+// before it was sent, e.g. because the host name couldn't be resolved
+// or the connection was refused. Timeouts and connections closed by the
+// server can happen after the server received the request.
+func requestSent(err error) bool {
+	var dnsErr *net.DNSError
+	if errors.As(err, &dnsErr) {
+		return false
+	}
+	var opErr *net.OpError
+	return !errors.As(err, &opErr) || opErr.Op != "dial"
+}
+
+// waitBeforeRetry waits for the backoff before a request is sent
+// again, unless cifuzz receives a termination signal in the meantime.
+func waitBeforeRetry(backoff time.Duration) error {
+	sigs := make(chan os.Signal, 1)
+	signal.Notify(sigs, os.Interrupt, syscall.SIGTERM, syscall.SIGINT, syscall.SIGQUIT)
+	defer signal.Stop(sigs)
+	select {
+	case <-time.After(backoff):
+		return nil
+	case s := <-sigs:
+		log.Warnf("Received %s", s.String())
+		return cmdutils.NewSignalError(s.(syscall.Signal))
+	}
+}
+
+func (client *APIClient) sendRequestOnce(method string, endpoint string, body []byte, token string, timeout time.Duration) (*http.Response, error) {
 	url, err := url.JoinPath(client.Server, endpoint)
 	if err != nil {
 		return nil, err
 	}
-	req, err := http.NewRequestWithContext(context.Background(), method, url, body)
+
+	// Findings and metrics are mostly text, so large bodies are sent
+	// compressed, unless the server told us that it doesn't support
+	// that.
+	compress := len(body) >= minCompressedBodySize && !client.noCompression
+	var bodyReader io.Reader
+	if compress {
+		var compressed bytes.Buffer
+		w := gzip.NewWriter(&compressed)
+		_, err = w.Write(body)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		err = w.Close()
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		bodyReader = &compressed
+	} else if body != nil {
+		bodyReader = bytes.NewReader(body)
+	}
+
+	req, err := http.NewRequestWithContext(context.Background(), method, url, bodyReader)
 	if err != nil {
 		return nil, errors.WithStack(err)
 	}
 	req.Header.Add("Authorization", "Bearer "+token)
+	if compress {
+		req.Header.Set("Content-Encoding", "gzip")
+	}
 
 	httpClient := &http.Client{Transport: getCustomTransport(), Timeout: timeout}
 	resp, err := httpClient.Do(req)
@@ -272,6 +401,13 @@ func (client *APIClient) sendRequestWithTimeout(method string, endpoint string,
 		return nil, WrapConnectionError(errors.WithStack(err))
 	}
 
+	if compress && resp.StatusCode == http.StatusUnsupportedMediaType {
+		log.Debugf("Server doesn't support compressed requests, sending them uncompressed")
+		resp.Body.Close()
+		client.noCompression = true
+		return client.sendRequestOnce(method, endpoint, body, token, timeout)
+	}
+
 	return resp, nil
 }
 
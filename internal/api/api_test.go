@@ -0,0 +1,176 @@
+package api
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"net/http"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/integration-tests/shared/mockserver"
+)
+
+// recordingHandler records the bodies of the requests it receives,
+// decompressed if necessary, and responds with the given status codes
+// in turn, the last one to all remaining requests.
+type recordingHandler struct {
+	t           *testing.T
+	statusCodes []int
+
+	mutex      sync.Mutex
+	bodies     [][]byte
+	compressed []bool
+}
+
+func (h *recordingHandler) ServeHTTP(w http.ResponseWriter, req *http.Request) {
+	var reader io.Reader = req.Body
+	compressed := req.Header.Get("Content-Encoding") == "gzip"
+	if compressed {
+		gzipReader, err := gzip.NewReader(req.Body)
+		require.NoError(h.t, err)
+		reader = gzipReader
+	}
+	body, err := io.ReadAll(reader)
+	require.NoError(h.t, err)
+
+	h.mutex.Lock()
+	h.bodies = append(h.bodies, body)
+	h.compressed = append(h.compressed, compressed)
+	statusCode := h.statusCodes[0]
+	if len(h.statusCodes) > 1 {
+		h.statusCodes = h.statusCodes[1:]
+	}
+	h.mutex.Unlock()
+
+	w.WriteHeader(statusCode)
+	_, err = io.WriteString(w, "{}")
+	require.NoError(h.t, err)
+}
+
+func (h *recordingHandler) numRequests() int {
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	return len(h.bodies)
+}
+
+// requests returns the bodies of the requests and whether they were
+// compressed
+func (h *recordingHandler) requests() ([][]byte, []bool) {
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	return append([][]byte{}, h.bodies...), append([]bool{}, h.compressed...)
+}
+
+// shortenRetryBackoff makes retries fast for the duration of the test
+func shortenRetryBackoff(t *testing.T) {
+	defaultBackoff := initialRetryBackoff
+	initialRetryBackoff = time.Millisecond
+	t.Cleanup(func() { initialRetryBackoff = defaultBackoff })
+}
+
+func startRecordingServer(t *testing.T, path string, statusCodes ...int) (*APIClient, *recordingHandler) {
+	shortenRetryBackoff(t)
+	handler := &recordingHandler{t: t, statusCodes: statusCodes}
+	server := mockserver.New(t)
+	server.Handlers[path] = handler.ServeHTTP
+	server.Start(t)
+	return &APIClient{Server: server.Address}, handler
+}
+
+func TestSendRequest_UncompressedFallback(t *testing.T) {
+	client, handler := startRecordingServer(t, "/v1/test", http.StatusUnsupportedMediaType, http.StatusOK)
+	body := bytes.Repeat([]byte("a"), minCompressedBodySize)
+
+	resp, err := client.sendRequest("POST", "/v1/test", body, "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	assert.Equal(t, http.StatusOK, resp.StatusCode)
+	bodies, compressed := handler.requests()
+	assert.Equal(t, []bool{true, false}, compressed)
+	assert.Equal(t, [][]byte{body, body}, bodies)
+
+	// Once the server rejected a compressed request, all further
+	// requests are sent uncompressed
+	resp, err = client.sendRequest("POST", "/v1/test", body, "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	_, compressed = handler.requests()
+	assert.Equal(t, []bool{true, false, false}, compressed)
+}
+
+func TestSendRequest_RetryBusyServer(t *testing.T) {
+	client, handler := startRecordingServer(t, "/v1/test", http.StatusServiceUnavailable, http.StatusTooManyRequests, http.StatusOK)
+
+	resp, err := client.sendRequest("POST", "/v1/test", []byte("{}"), "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	assert.Equal(t, http.StatusOK, resp.StatusCode)
+	assert.Equal(t, 3, handler.numRequests())
+
+	// The server might have handled a POST request before the gateway
+	// failed, so it's not sent again
+	client, handler = startRecordingServer(t, "/v1/test", http.StatusBadGateway, http.StatusBadGateway, http.StatusOK)
+	resp, err = client.sendRequest("POST", "/v1/test", []byte("{}"), "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	assert.Equal(t, http.StatusBadGateway, resp.StatusCode)
+	assert.Equal(t, 1, handler.numRequests())
+
+	// ... unlike a GET request
+	resp, err = client.sendRequest("GET", "/v1/test", nil, "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	assert.Equal(t, http.StatusOK, resp.StatusCode)
+	assert.Equal(t, 3, handler.numRequests())
+
+	// Requests are sent at most maxRequestAttempts times
+	client, handler = startRecordingServer(t, "/v1/test", http.StatusServiceUnavailable)
+	resp, err = client.sendRequest("POST", "/v1/test", []byte("{}"), "token")
+	require.NoError(t, err)
+	resp.Body.Close()
+	assert.Equal(t, http.StatusServiceUnavailable, resp.StatusCode)
+	assert.Equal(t, maxRequestAttempts, handler.numRequests())
+}
+
+func TestSendRequest_ConnectionClosed(t *testing.T) {
+	shortenRetryBackoff(t)
+
+	// The server closes the connection after receiving the request
+	var mutex sync.Mutex
+	numRequests := 0
+	getNumRequests := func() int {
+		mutex.Lock()
+		defer mutex.Unlock()
+		return numRequests
+	}
+	server := mockserver.New(t)
+	server.Handlers["/v1/test"] = func(w http.ResponseWriter, req *http.Request) {
+		_, err := io.ReadAll(req.Body)
+		require.NoError(t, err)
+		mutex.Lock()
+		numRequests++
+		mutex.Unlock()
+		conn, _, err := w.(http.Hijacker).Hijack()
+		require.NoError(t, err)
+		conn.Close()
+	}
+	server.Start(t)
+	client := &APIClient{Server: server.Address}
+
+	// The server might have handled the POST request, so it's not sent
+	// again
+	_, err := client.sendRequest("POST", "/v1/test", []byte("{}"), "token")
+	var connErr *ConnectionError
+	require.ErrorAs(t, err, &connErr)
+	assert.Equal(t, 1, getNumRequests())
+
+	// ... unlike a GET request
+	_, err = client.sendRequest("GET", "/v1/test", nil, "token")
+	require.ErrorAs(t, err, &connErr)
+	assert.Equal(t, 1+maxRequestAttempts, getNumRequests())
+}
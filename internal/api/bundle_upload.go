@@ -0,0 +1,353 @@
+package api
+
+import (
+	"bytes"
+	"context"
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/hex"
+	"encoding/json"
+	"fmt"
+	"io"
+	"net/http"
+	"net/url"
+	"os"
+	"os/signal"
+	"path/filepath"
+	"strconv"
+	"syscall"
+	"time"
+
+	"github.com/pkg/errors"
+	"golang.org/x/sync/errgroup"
+	"golang.org/x/term"
+
+	"code-intelligence.com/cifuzz/internal/cmd/remoterun/progress"
+	"code-intelligence.com/cifuzz/internal/cmdutils"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/sliceutil"
+)
+
+const (
+	// The size of the chunks in which bundles are uploaded
+	bundleChunkSize = 16 << 20
+	// The number of chunks which are uploaded at the same time, which
+	// are kept in memory until the server confirmed them
+	maxChunksInFlight = 4
+	// The timeout of the upload of a single chunk, after which it is
+	// retried
+	chunkUploadTimeout = 5 * time.Minute
+)
+
+// The status codes with which the server rejects a chunk which can be
+// sent again, in addition to retryStatusCodes. The server responds with
+// 422 if the chunk doesn't match its checksum.
+var retryChunkStatusCodes = append([]int{http.StatusUnprocessableEntity}, retryStatusCodes...)
+
+var errChunkedUploadUnsupported = errors.New("The server doesn't support chunked uploads")
+
+// BundleUpload is an upload of a bundle in chunks, which can be resumed
+// until it is completed.
+type BundleUpload struct {
+	Name      string `json:"name"`
+	Size      int64  `json:"size"`
+	ChunkSize int64  `json:"chunk_size"`
+	// The chunks which the server received and verified so far
+	Chunks []*UploadedChunk `json:"chunks,omitempty"`
+}
+
+type UploadedChunk struct {
+	Index  int    `json:"index"`
+	SHA256 string `json:"sha256"`
+}
+
+type ChunkedUploadOptions struct {
+	// The name of an interrupted upload of the same bundle to resume
+	ResumeUpload string
+	// Called with the name of the upload once it was created, so that
+	// it can be resumed if this process is interrupted
+	OnUploadCreated func(name string)
+}
+
+// UploadBundleInChunks uploads the bundle in chunks, of which several
+// are sent at the same time. Each chunk is sent with its SHA-256
+// checksum, which the server verifies, and is retried on its own if it
+// fails. When resuming an upload, the chunks which the server confirmed
+// already are skipped. Only servers which support chunked uploads
+// accept them, so callers have to opt in to them explicitly. If the
+// server rejects the upload anyway, the bundle is uploaded in one
+// request via UploadBundle.
+func (client *APIClient) UploadBundleInChunks(path string, projectName string, token string, opts *ChunkedUploadOptions) (*Artifact, error) {
+	fileInfo, err := os.Stat(path)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	var upload *BundleUpload
+	if opts.ResumeUpload != "" {
+		upload, err = client.getBundleUpload(opts.ResumeUpload, token)
+		if err != nil {
+			log.Debugf("Failed to resume upload %s, starting a new one: %v", opts.ResumeUpload, err)
+			upload = nil
+		} else if upload.Size != fileInfo.Size() || upload.ChunkSize != bundleChunkSize {
+			log.Debugf("Upload %s is of a different file, starting a new one", opts.ResumeUpload)
+			upload = nil
+		}
+	}
+
+	if upload == nil {
+		upload, err = client.createBundleUpload(projectName, filepath.Base(path), fileInfo.Size(), token)
+		if errors.Is(err, errChunkedUploadUnsupported) {
+			log.Debugf("%s, uploading the bundle in one request", err.Error())
+			return client.UploadBundle(path, projectName, token)
+		}
+		if err != nil {
+			return nil, err
+		}
+		if opts.OnUploadCreated != nil {
+			opts.OnUploadCreated(upload.Name)
+		}
+	} else {
+		log.Infof("Resuming the upload of the bundle, %d chunks were uploaded already", len(upload.Chunks))
+	}
+
+	err = client.uploadChunks(path, upload, token)
+	if err != nil {
+		return nil, err
+	}
+	return client.completeBundleUpload(upload.Name, token)
+}
+
+func (client *APIClient) createBundleUpload(projectName string, fileName string, size int64, token string) (*BundleUpload, error) {
+	url, err := url.JoinPath("/v2", projectName, "artifacts", "uploads")
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	// The file name is only used for display purposes, like in the
+	// form data sent by UploadBundle
+	body, err := json.Marshal(struct {
+		FileName  string `json:"file_name"`
+		Size      int64  `json:"size"`
+		ChunkSize int64  `json:"chunk_size"`
+	}{fileName, size, bundleChunkSize})
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	resp, err := client.sendRequest("POST", url, body, token)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode == http.StatusNotFound || resp.StatusCode == http.StatusMethodNotAllowed {
+		return nil, errors.WithStack(errChunkedUploadUnsupported)
+	}
+	if resp.StatusCode != 200 {
+		return nil, responseToAPIError(resp)
+	}
+
+	upload := &BundleUpload{}
+	err = json.NewDecoder(resp.Body).Decode(upload)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	if upload.Name == "" {
+		return nil, errors.New("Server response doesn't include the name of the upload")
+	}
+	upload.Size = size
+	upload.ChunkSize = bundleChunkSize
+	return upload, nil
+}
+
+func (client *APIClient) getBundleUpload(name string, token string) (*BundleUpload, error) {
+	url, err := url.JoinPath("/v2", name)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	resp, err := client.sendRequest("GET", url, nil, token)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != 200 {
+		return nil, responseToAPIError(resp)
+	}
+
+	upload := &BundleUpload{}
+	err = json.NewDecoder(resp.Body).Decode(upload)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return upload, nil
+}
+
+func (client *APIClient) completeBundleUpload(name string, token string) (*Artifact, error) {
+	url, err := url.JoinPath("/v2", name+":complete")
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	resp, err := client.sendRequest("POST", url, nil, token)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != 200 {
+		return nil, responseToAPIError(resp)
+	}
+
+	artifact := &Artifact{}
+	err = json.NewDecoder(resp.Body).Decode(artifact)
+	if err != nil {
+		err = errors.WithStack(err)
+		log.Errorf(err, "Failed to parse response from upload bundle API call: %s", err.Error())
+		return nil, cmdutils.WrapSilentError(err)
+	}
+	return artifact, nil
+}
+
+// uploadChunks uploads the chunks of the file which the server didn't
+// confirm yet.
+func (client *APIClient) uploadChunks(path string, upload *BundleUpload, token string) error {
+	f, err := os.Open(path)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer f.Close()
+
+	confirmed := make(map[int]string)
+	for _, chunk := range upload.Chunks {
+		confirmed[chunk.Index] = chunk.SHA256
+	}
+	numChunks := int((upload.Size + upload.ChunkSize - 1) / upload.ChunkSize)
+
+	var counter *progress.Counter
+	if term.IsTerminal(int(os.Stdout.Fd())) {
+		fmt.Println("Uploading...")
+		counter = progress.NewCounter(upload.Size, "Upload complete")
+	}
+
+	signalHandlerCtx, cancelSignalHandler := context.WithCancel(context.Background())
+	routines, routinesCtx := errgroup.WithContext(context.Background())
+
+	// Cancel the routines context when receiving a termination signal
+	sigs := make(chan os.Signal, 1)
+	signal.Notify(sigs, os.Interrupt, syscall.SIGTERM, syscall.SIGINT, syscall.SIGQUIT)
+	defer signal.Stop(sigs)
+	routines.Go(func() error {
+		select {
+		case <-signalHandlerCtx.Done():
+			return nil
+		case s := <-sigs:
+			log.Warnf("Received %s", s.String())
+			return cmdutils.NewSignalError(s.(syscall.Signal))
+		}
+	})
+
+	routines.Go(func() error {
+		defer cancelSignalHandler()
+
+		// All chunks are sent via the same client, so that the
+		// connections are reused
+		httpClient := &http.Client{Transport: getCustomTransport(), Timeout: chunkUploadTimeout}
+		chunks, chunksCtx := errgroup.WithContext(routinesCtx)
+		chunks.SetLimit(maxChunksInFlight)
+		for i := 0; i < numChunks && chunksCtx.Err() == nil; i++ {
+			index := i
+			chunks.Go(func() error {
+				offset := int64(index) * upload.ChunkSize
+				length := upload.ChunkSize
+				if offset+length > upload.Size {
+					length = upload.Size - offset
+				}
+				data := make([]byte, length)
+				n, err := f.ReadAt(data, offset)
+				if err != nil && !(errors.Is(err, io.EOF) && n == len(data)) {
+					return errors.WithStack(err)
+				}
+				sum := sha256.Sum256(data)
+
+				// Chunks which are part of a resumed upload are only
+				// skipped if the file didn't change since
+				if confirmed[index] != hex.EncodeToString(sum[:]) {
+					err = client.uploadChunk(chunksCtx, httpClient, upload.Name, index, data, sum, token)
+					if err != nil {
+						return err
+					}
+				}
+				if counter != nil {
+					counter.Add(int64(len(data)))
+				}
+				return nil
+			})
+		}
+		return chunks.Wait()
+	})
+
+	err = routines.Wait()
+	if counter != nil {
+		counter.Stop()
+	}
+	return err
+}
+
+// uploadChunk sends a chunk of an upload, which is retried with an
+// exponential backoff if it fails to connect, the server is too busy
+// or the checksum doesn't match.
+func (client *APIClient) uploadChunk(ctx context.Context, httpClient *http.Client, uploadName string, index int, data []byte, sum [sha256.Size]byte, token string) error {
+	url, err := url.JoinPath(client.Server, "v2", uploadName, "chunks", strconv.Itoa(index))
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	backoff := initialRetryBackoff
+	for attempt := 1; ; attempt++ {
+		err = uploadChunkOnce(ctx, httpClient, url, data, sum, token)
+		if err == nil {
+			return nil
+		}
+		var apiErr *APIError
+		retry := !errors.As(err, &apiErr) || sliceutil.Contains(retryChunkStatusCodes, apiErr.StatusCode)
+		if !retry || attempt == maxRequestAttempts || ctx.Err() != nil {
+			return errors.WithMessagef(err, "Failed to upload chunk %d", index)
+		}
+
+		log.Debugf("Upload of chunk %d failed, retrying in %s: %v", index, backoff, err)
+		select {
+		case <-time.After(backoff):
+		case <-ctx.Done():
+			return errors.WithStack(ctx.Err())
+		}
+		backoff *= 2
+	}
+}
+
+func uploadChunkOnce(ctx context.Context, httpClient *http.Client, url string, data []byte, sum [sha256.Size]byte, token string) error {
+	req, err := http.NewRequestWithContext(ctx, "PUT", url, bytes.NewReader(data))
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	req.Header.Set("Content-Type", "application/octet-stream")
+	// See RFC 9530
+	req.Header.Set("Content-Digest", "sha-256=:"+base64.StdEncoding.EncodeToString(sum[:])+":")
+	req.Header.Add("Authorization", "Bearer "+token)
+
+	resp, err := httpClient.Do(req)
+	if err != nil {
+		return WrapConnectionError(errors.WithStack(err))
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != 200 {
+		return responseToAPIError(resp)
+	}
+
+	// The server confirms the checksum of the data it received
+	chunk := &UploadedChunk{}
+	err = json.NewDecoder(resp.Body).Decode(chunk)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	if chunk.SHA256 != hex.EncodeToString(sum[:]) {
+		return errors.Errorf("Server received the chunk with checksum %s, expected %x", chunk.SHA256, sum)
+	}
+	return nil
+}
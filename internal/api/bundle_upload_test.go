@@ -0,0 +1,86 @@
+package api
+
+import (
+	"crypto/rand"
+	"net/http"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/integration-tests/shared/mockserver"
+)
+
+const testArtifactJSON = `{"display-name": "test-artifacts", "resource-name": "projects/test-project/artifacts/1"}`
+
+func writeTestBundle(t *testing.T, size int) (string, []byte) {
+	content := make([]byte, size)
+	_, err := rand.Read(content)
+	require.NoError(t, err)
+	path := filepath.Join(t.TempDir(), "bundle.tar.gz")
+	require.NoError(t, os.WriteFile(path, content, 0o644))
+	return path, content
+}
+
+func TestUploadBundleInChunks(t *testing.T) {
+	path, content := writeTestBundle(t, 2*bundleChunkSize+1234)
+
+	server := mockserver.New(t)
+	upload := server.HandleChunkedUpload(t, "test-project", testArtifactJSON)
+	server.Start(t)
+
+	var created string
+	client := &APIClient{Server: server.Address}
+	artifact, err := client.UploadBundleInChunks(path, "projects/test-project", "token", &ChunkedUploadOptions{
+		OnUploadCreated: func(name string) { created = name },
+	})
+	require.NoError(t, err)
+	assert.Equal(t, "projects/test-project/artifacts/1", artifact.ResourceName)
+	assert.Equal(t, upload.Name, created)
+
+	uploaded, completed := upload.Content()
+	assert.True(t, completed)
+	assert.Equal(t, content, uploaded)
+	assert.Equal(t, 3, upload.NumChunksSent())
+}
+
+func TestUploadBundleInChunks_Resume(t *testing.T) {
+	path, content := writeTestBundle(t, 2*bundleChunkSize+1234)
+
+	server := mockserver.New(t)
+	upload := server.HandleChunkedUpload(t, "test-project", testArtifactJSON)
+	server.Start(t)
+
+	// The first chunk was uploaded before the upload was interrupted
+	upload.AddChunk(0, content[:bundleChunkSize], int64(len(content)), bundleChunkSize)
+
+	client := &APIClient{Server: server.Address}
+	_, err := client.UploadBundleInChunks(path, "projects/test-project", "token", &ChunkedUploadOptions{
+		ResumeUpload:    upload.Name,
+		OnUploadCreated: func(string) { require.Fail(t, "Created a new upload instead of resuming") },
+	})
+	require.NoError(t, err)
+
+	uploaded, completed := upload.Content()
+	assert.True(t, completed)
+	assert.Equal(t, content, uploaded)
+	assert.Equal(t, 2, upload.NumChunksSent())
+}
+
+func TestUploadBundleInChunks_Unsupported(t *testing.T) {
+	path, _ := writeTestBundle(t, 1234)
+
+	server := mockserver.New(t)
+	server.Handlers["/v2/projects/test-project/artifacts/uploads"] = func(w http.ResponseWriter, _ *http.Request) {
+		w.WriteHeader(http.StatusNotFound)
+	}
+	server.Handlers["/v2/projects/test-project/artifacts/import"] = mockserver.ReturnResponse(t, testArtifactJSON)
+	server.Start(t)
+
+	client := &APIClient{Server: server.Address}
+	artifact, err := client.UploadBundleInChunks(path, "projects/test-project", "token", &ChunkedUploadOptions{})
+	require.NoError(t, err)
+	assert.Equal(t, "projects/test-project/artifacts/1", artifact.ResourceName)
+}
@@ -1,7 +1,6 @@
 package api
 
 import (
-	"bytes"
 	"crypto/rand"
 	"encoding/base64"
 	"encoding/hex"
@@ -37,7 +36,7 @@ type Campaign struct {
 // returns the name of the campaign and fuzzing run. The campaign and fuzzing
 // run name is used to identify the campaign run in the API for consecutive
 // calls.
-func (client *APIClient) CreateCampaignRun(project string, token string, fuzzTarget string, firstMetrics *report.FuzzingMetric, lastMetrics *report.FuzzingMetric, numBuildJobs uint) (string, string, error) {
+func (client *APIClient) CreateCampaignRun(project string, token string, fuzzTarget string, firstMetrics *report.FuzzingMetric, lastMetrics *report.FuzzingMetric, resourceUsage *report.ResourceUsage, numBuildJobs uint) (string, string, error) {
 	fuzzTarget = base64.URLEncoding.EncodeToString([]byte(fuzzTarget))
 
 	// generate a short random string to use as the campaign run name
@@ -98,7 +97,8 @@ func (client *APIClient) CreateCampaignRun(project string, token string, fuzzTar
 			Engine:       "LIBFUZZER",
 			NumberOfJobs: 4,
 		},
-		Metrics: metricsList,
+		Metrics:       metricsList,
+		ResourceUsage: newResourceUsage(resourceUsage),
 		FuzzTargetConfig: FuzzTargetConfig{
 			Name: fuzzTargetConfigName,
 			CAPI: CAPI{
@@ -138,7 +138,7 @@ func (client *APIClient) CreateCampaignRun(project string, token string, fuzzTar
 	if err != nil {
 		return "", "", err
 	}
-	resp, err := client.sendRequest("POST", url, bytes.NewReader(body), token)
+	resp, err := client.sendRequest("POST", url, body, token)
 	if err != nil {
 		return "", "", err
 	}
@@ -150,3 +150,24 @@ func (client *APIClient) CreateCampaignRun(project string, token string, fuzzTar
 
 	return campaignRun.Name, fuzzingRun.Name, nil
 }
+
+// newResourceUsage converts the resource usage to the format of the
+// API, which expects 64-bit integers as strings.
+func newResourceUsage(usage *report.ResourceUsage) *ResourceUsage {
+	if usage == nil {
+		return nil
+	}
+	res := &ResourceUsage{
+		UserCPUSeconds:             usage.UserCPUSeconds,
+		SystemCPUSeconds:           usage.SystemCPUSeconds,
+		MaxRSSBytes:                fmt.Sprintf("%d", usage.MaxRSSBytes),
+		MajorPageFaults:            fmt.Sprintf("%d", usage.MajorPageFaults),
+		VoluntaryContextSwitches:   fmt.Sprintf("%d", usage.VoluntaryContextSwitches),
+		InvoluntaryContextSwitches: fmt.Sprintf("%d", usage.InvoluntaryContextSwitches),
+		SandboxCPUSeconds:          usage.SandboxCPUSeconds,
+	}
+	if usage.SandboxPeakMemoryBytes != 0 {
+		res.SandboxPeakMemoryBytes = fmt.Sprintf("%d", usage.SandboxPeakMemoryBytes)
+	}
+	return res
+}
@@ -0,0 +1,245 @@
+package api
+
+import (
+	"archive/tar"
+	"bytes"
+	"crypto/sha1"
+	"crypto/sha256"
+	"encoding/base64"
+	"encoding/hex"
+	"encoding/json"
+	"io"
+	"net/http"
+	"net/url"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+const (
+	// Corpus archives can be large, so they are given more time than
+	// other requests
+	corpusSyncTimeout = 10 * time.Minute
+	// The archive sent by the server lists the hashes of the inputs
+	// which the server doesn't have in this entry, next to the inputs
+	// in corpusSyncInputsDir
+	corpusSyncMissingEntry = "missing"
+	corpusSyncInputsDir    = "inputs/"
+)
+
+type CorpusSyncRequest struct {
+	// Hashes are the hex-encoded SHA-256 hashes of the contents of all
+	// inputs the client has.
+	Hashes []string `json:"hashes"`
+}
+
+// CorpusSyncResult are the numbers of inputs the client received from
+// and sent to the server during SyncCorpus.
+type CorpusSyncResult struct {
+	Received int
+	Sent     int
+}
+
+// SyncCorpus exchanges the inputs of the fuzz test which only the
+// client or only the server has. The client sends the hashes of the
+// contents of the inputs in corpusDirs and receives a tar archive of
+// the inputs the server has in addition, which are written to the
+// first of the corpusDirs, and the hashes of the inputs the server
+// lacks, which are then sent in a single tar archive. The data
+// transferred thus depends on the number of new inputs rather than on
+// the size of the corpus.
+func (client *APIClient) SyncCorpus(project string, fuzzTarget string, corpusDirs []string, token string) (*CorpusSyncResult, error) {
+	inputs, err := corpusHashes(corpusDirs)
+	if err != nil {
+		return nil, err
+	}
+	hashes := make([]string, 0, len(inputs))
+	for hash := range inputs {
+		hashes = append(hashes, hash)
+	}
+	sort.Strings(hashes)
+	body, err := json.Marshal(&CorpusSyncRequest{Hashes: hashes})
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	endpoint, err := corpusEndpoint(project, fuzzTarget, "corpus:sync")
+	if err != nil {
+		return nil, err
+	}
+	log.Debugf("Syncing corpus of %s with %d inputs", fuzzTarget, len(hashes))
+	resp, err := client.sendRequestWithTimeout("POST", endpoint, body, token, corpusSyncTimeout)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode == http.StatusNoContent {
+		// Client and server have the same inputs
+		return &CorpusSyncResult{}, nil
+	}
+	if resp.StatusCode != 200 {
+		return nil, responseToAPIError(resp)
+	}
+
+	result := &CorpusSyncResult{}
+	var missing []string
+	result.Received, missing, err = extractCorpusArchive(resp.Body, corpusDirs[0], inputs)
+	if err != nil {
+		return nil, err
+	}
+	if len(missing) == 0 {
+		return result, nil
+	}
+
+	archive, err := createCorpusArchive(missing, inputs)
+	if err != nil {
+		return nil, err
+	}
+	endpoint, err = corpusEndpoint(project, fuzzTarget, "corpus:upload")
+	if err != nil {
+		return nil, err
+	}
+	// The archive isn't compressed here, because sendRequest already
+	// compresses large bodies.
+	resp, err = client.sendRequestWithTimeout("POST", endpoint, archive, token, corpusSyncTimeout)
+	if err != nil {
+		return nil, err
+	}
+	defer resp.Body.Close()
+	if resp.StatusCode != 200 {
+		return nil, responseToAPIError(resp)
+	}
+	result.Sent = len(missing)
+	return result, nil
+}
+
+func corpusEndpoint(project string, fuzzTarget string, method string) (string, error) {
+	fuzzTarget = base64.URLEncoding.EncodeToString([]byte(fuzzTarget))
+	return url.JoinPath("/v1", project, "fuzz_targets", fuzzTarget, method)
+}
+
+// corpusHashes returns the paths of the inputs in the dirs by the
+// hashes of their contents. Inputs with the same contents are only
+// included once.
+func corpusHashes(dirs []string) (map[string]string, error) {
+	inputs := make(map[string]string)
+	for _, dir := range dirs {
+		entries, err := os.ReadDir(dir)
+		if os.IsNotExist(err) {
+			continue
+		}
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		for _, entry := range entries {
+			if !entry.Type().IsRegular() {
+				continue
+			}
+			path := filepath.Join(dir, entry.Name())
+			data, err := os.ReadFile(path)
+			if err != nil {
+				return nil, errors.WithStack(err)
+			}
+			sum := sha256.Sum256(data)
+			inputs[hex.EncodeToString(sum[:])] = path
+		}
+	}
+	return inputs, nil
+}
+
+// extractCorpusArchive writes the inputs in the archive to dir and
+// adds them to inputs. Like libFuzzer, the files are named after the
+// SHA-1 hash of their contents. It returns the number of new inputs
+// and the hashes of the inputs the server asked for.
+func extractCorpusArchive(r io.Reader, dir string, inputs map[string]string) (int, []string, error) {
+	err := os.MkdirAll(dir, 0o755)
+	if err != nil {
+		return 0, nil, errors.WithStack(err)
+	}
+
+	var missing []string
+	received := 0
+	archive := tar.NewReader(r)
+	for {
+		header, err := archive.Next()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return 0, nil, errors.WithStack(err)
+		}
+		if header.Typeflag != tar.TypeReg {
+			continue
+		}
+		data, err := io.ReadAll(archive)
+		if err != nil {
+			return 0, nil, errors.WithStack(err)
+		}
+
+		if header.Name == corpusSyncMissingEntry {
+			for _, hash := range strings.Fields(string(data)) {
+				if _, ok := inputs[hash]; ok {
+					missing = append(missing, hash)
+				}
+			}
+			continue
+		}
+
+		hash := strings.TrimPrefix(header.Name, corpusSyncInputsDir)
+		sum := sha256.Sum256(data)
+		if hash != hex.EncodeToString(sum[:]) {
+			// The names of the entries are never used as paths, so
+			// this only guards against corrupted archives
+			return 0, nil, errors.Errorf("Corpus archive entry %q doesn't match the hash of its content", header.Name)
+		}
+		if _, ok := inputs[hash]; ok {
+			continue
+		}
+		nameSum := sha1.Sum(data)
+		path := filepath.Join(dir, hex.EncodeToString(nameSum[:]))
+		err = os.WriteFile(path, data, 0o644)
+		if err != nil {
+			return 0, nil, errors.WithStack(err)
+		}
+		inputs[hash] = path
+		received++
+	}
+	return received, missing, nil
+}
+
+// createCorpusArchive returns a tar archive of the inputs with the
+// hashes, in the same layout as the archives sent by the server.
+func createCorpusArchive(hashes []string, inputs map[string]string) ([]byte, error) {
+	var buf bytes.Buffer
+	archive := tar.NewWriter(&buf)
+	for _, hash := range hashes {
+		data, err := os.ReadFile(inputs[hash])
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		err = archive.WriteHeader(&tar.Header{
+			Typeflag: tar.TypeReg,
+			Name:     corpusSyncInputsDir + hash,
+			Mode:     0o644,
+			Size:     int64(len(data)),
+		})
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		_, err = archive.Write(data)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+	}
+	err := archive.Close()
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return buf.Bytes(), nil
+}
@@ -0,0 +1,55 @@
+package api
+
+import (
+	"os"
+	"path/filepath"
+	"sort"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/integration-tests/shared/mockserver"
+)
+
+func TestSyncCorpus(t *testing.T) {
+	server := mockserver.New(t)
+	corpus := server.HandleCorpusSync(t, "test-project", "my_fuzz_test", []byte("shared"), []byte("remote"))
+	server.Start(t)
+
+	generatedCorpus := filepath.Join(t.TempDir(), "generated")
+	seedCorpus := t.TempDir()
+	require.NoError(t, os.MkdirAll(generatedCorpus, 0o755))
+	require.NoError(t, os.WriteFile(filepath.Join(generatedCorpus, "a"), []byte("shared"), 0o644))
+	require.NoError(t, os.WriteFile(filepath.Join(seedCorpus, "seed"), []byte("local"), 0o644))
+	corpusDirs := []string{generatedCorpus, seedCorpus}
+
+	client := &APIClient{Server: server.Address}
+	result, err := client.SyncCorpus("projects/test-project", "my_fuzz_test", corpusDirs, "token")
+	require.NoError(t, err)
+	assert.Equal(t, &CorpusSyncResult{Received: 1, Sent: 1}, result)
+	assert.Equal(t, []string{"local", "remote", "shared"}, corpus.Inputs())
+	assert.Equal(t, []string{"local", "remote", "shared"}, readCorpus(t, corpusDirs))
+
+	// Once client and server have the same inputs, only the hashes are
+	// exchanged
+	result, err = client.SyncCorpus("projects/test-project", "my_fuzz_test", corpusDirs, "token")
+	require.NoError(t, err)
+	assert.Equal(t, &CorpusSyncResult{}, result)
+	assert.Len(t, corpus.ClientHashes(), 3)
+}
+
+func readCorpus(t *testing.T, dirs []string) []string {
+	var inputs []string
+	for _, dir := range dirs {
+		entries, err := os.ReadDir(dir)
+		require.NoError(t, err)
+		for _, entry := range entries {
+			data, err := os.ReadFile(filepath.Join(dir, entry.Name()))
+			require.NoError(t, err)
+			inputs = append(inputs, string(data))
+		}
+	}
+	sort.Strings(inputs)
+	return inputs
+}
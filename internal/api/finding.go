@@ -1,7 +1,6 @@
 package api
 
 import (
-	"bytes"
 	"encoding/json"
 	"fmt"
 	"net/url"
@@ -13,10 +12,6 @@ import (
 	"code-intelligence.com/cifuzz/pkg/log"
 )
 
-type Findings struct {
-	Findings []Finding `json:"findings"`
-}
-
 type Finding struct {
 	Name        string      `json:"name"`
 	DisplayName string      `json:"display_name"`
@@ -68,18 +63,15 @@ type Severity struct {
 	Score       float32 `json:"score,omitempty"`
 }
 
-func (client *APIClient) UploadFinding(project string, fuzzTarget string, campaignRunName string, fuzzingRunName string, finding *finding.Finding, token string) error {
-	// loop through the stack trace and create a list of breakpoints
-	breakPoints := []BreakPoint{}
-	for _, stackFrame := range finding.StackTrace {
-		breakPoints = append(breakPoints, BreakPoint{
-			SourceFilePath: stackFrame.SourceFile,
-			Location: &FindingLocation{
-				Line:   stackFrame.Line,
-				Column: stackFrame.Column,
-			},
-			Function: stackFrame.Function,
-		})
+// maxFindingsBodySize is the size of the JSON body up to which findings
+// are uploaded in a single request.
+const maxFindingsBodySize = 4 << 20
+
+// UploadFindings uploads the findings of a fuzzing run, as few requests
+// as possible.
+func (client *APIClient) UploadFindings(project string, fuzzTarget string, campaignRunName string, fuzzingRunName string, findings []*finding.Finding, token string) error {
+	if len(findings) == 0 {
+		return nil
 	}
 
 	errorDetails, err := client.GetErrorDetails(token)
@@ -94,37 +86,72 @@ func (client *APIClient) UploadFinding(project string, fuzzTarget string, campai
 		}
 	}
 
-	err = finding.EnhanceWithErrorDetails(&errorDetails)
-	if err != nil {
-		return err
+	var batch []json.RawMessage
+	batchSize := 0
+	for _, f := range findings {
+		err = f.EnhanceWithErrorDetails(&errorDetails)
+		if err != nil {
+			return err
+		}
+
+		apiFinding, err := json.Marshal(newFinding(project, fuzzTarget, campaignRunName, fuzzingRunName, f))
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		if len(batch) > 0 && batchSize+len(apiFinding) > maxFindingsBodySize {
+			err = client.uploadFindingsBatch(project, batch, token)
+			if err != nil {
+				return err
+			}
+			batch = nil
+			batchSize = 0
+		}
+		batch = append(batch, apiFinding)
+		batchSize += len(apiFinding)
+	}
+	return client.uploadFindingsBatch(project, batch, token)
+}
+
+func newFinding(project string, fuzzTarget string, campaignRunName string, fuzzingRunName string, finding *finding.Finding) *Finding {
+	// loop through the stack trace and create a list of breakpoints
+	breakPoints := []BreakPoint{}
+	for _, stackFrame := range finding.StackTrace {
+		breakPoints = append(breakPoints, BreakPoint{
+			SourceFilePath: stackFrame.SourceFile,
+			Location: &FindingLocation{
+				Line:   stackFrame.Line,
+				Column: stackFrame.Column,
+			},
+			Function: stackFrame.Function,
+		})
 	}
 
-	findings := &Findings{
-		Findings: []Finding{
-			{
-				Name:        project + "/findings/cifuzz-" + finding.Name,
-				DisplayName: finding.Name,
-				FuzzTarget:  fuzzTarget,
-				FuzzingRun:  fuzzingRunName,
-				CampaignRun: campaignRunName,
-				ErrorReport: ErrorReport{
-					Logs:      finding.Logs,
-					Details:   finding.Details,
-					Type:      string(finding.Type),
-					InputData: finding.InputData,
-					DebuggingInfo: &DebuggingInfo{
-						BreakPoints: breakPoints,
-					},
-					MoreDetails:      finding.MoreDetails,
-					Tag:              fmt.Sprint(finding.Tag),
-					ShortDescription: finding.ShortDescription(),
-				},
-				Timestamp: time.Now().Format(time.RFC3339),
+	return &Finding{
+		Name:        project + "/findings/cifuzz-" + finding.Name,
+		DisplayName: finding.Name,
+		FuzzTarget:  fuzzTarget,
+		FuzzingRun:  fuzzingRunName,
+		CampaignRun: campaignRunName,
+		ErrorReport: ErrorReport{
+			Logs:      finding.Logs,
+			Details:   finding.Details,
+			Type:      string(finding.Type),
+			InputData: finding.InputData,
+			DebuggingInfo: &DebuggingInfo{
+				BreakPoints: breakPoints,
 			},
+			MoreDetails:      finding.MoreDetails,
+			Tag:              fmt.Sprint(finding.Tag),
+			ShortDescription: finding.ShortDescription(),
 		},
+		Timestamp: time.Now().Format(time.RFC3339),
 	}
+}
 
-	body, err := json.Marshal(findings)
+func (client *APIClient) uploadFindingsBatch(project string, findings []json.RawMessage, token string) error {
+	body, err := json.Marshal(struct {
+		Findings []json.RawMessage `json:"findings"`
+	}{findings})
 	if err != nil {
 		return errors.WithStack(err)
 	}
@@ -133,7 +160,7 @@ func (client *APIClient) UploadFinding(project string, fuzzTarget string, campai
 	if err != nil {
 		return errors.WithStack(err)
 	}
-	resp, err := client.sendRequest("POST", url, bytes.NewReader(body), token)
+	resp, err := client.sendRequest("POST", url, body, token)
 	if err != nil {
 		return err
 	}
@@ -0,0 +1,55 @@
+package api
+
+import (
+	"encoding/json"
+	"fmt"
+	"net/http"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/integration-tests/shared/mockserver"
+	"code-intelligence.com/cifuzz/pkg/finding"
+)
+
+func TestUploadFindings_Batches(t *testing.T) {
+	handler := &recordingHandler{t: t, statusCodes: []int{http.StatusOK}}
+	server := mockserver.New(t)
+	server.Handlers["/v2/error-details"] = mockserver.ReturnResponse(t, mockserver.ErrorDetailsJSON)
+	server.Handlers["/v1/projects/test-project/findings"] = handler.ServeHTTP
+	server.Start(t)
+
+	// The input of each finding takes up a quarter of the maximum body
+	// size once it's base64 encoded, so three findings fit into a batch
+	var findings []*finding.Finding
+	for i := 0; i < 5; i++ {
+		findings = append(findings, &finding.Finding{
+			Name:      fmt.Sprintf("finding-%d", i),
+			Type:      finding.ErrorTypeCrash,
+			Details:   "heap-buffer-overflow",
+			InputData: make([]byte, maxFindingsBodySize/4/4*3),
+		})
+	}
+
+	client := &APIClient{Server: server.Address}
+	err := client.UploadFindings("projects/test-project", "my_fuzz_test", "", "", findings, "token")
+	require.NoError(t, err)
+
+	bodies, _ := handler.requests()
+	var batchSizes []int
+	var names []string
+	for _, body := range bodies {
+		var batch struct {
+			Findings []*Finding `json:"findings"`
+		}
+		require.NoError(t, json.Unmarshal(body, &batch))
+		assert.LessOrEqual(t, len(body), maxFindingsBodySize+len(`{"findings":[]}`)+len(batch.Findings))
+		batchSizes = append(batchSizes, len(batch.Findings))
+		for _, f := range batch.Findings {
+			names = append(names, f.DisplayName)
+		}
+	}
+	assert.Equal(t, []int{3, 2}, batchSizes)
+	assert.Equal(t, []string{"finding-0", "finding-1", "finding-2", "finding-3", "finding-4"}, names)
+}
@@ -5,6 +5,7 @@ type FuzzingRun struct {
 	DisplayName             string                  `json:"display_name"`
 	Status                  string                  `json:"status"`
 	Metrics                 []*Metrics              `json:"metrics,omitempty"`
+	ResourceUsage           *ResourceUsage          `json:"resource_usage,omitempty"`
 	FuzzerRunConfigurations FuzzerRunConfigurations `json:"fuzzer_run_configurations"`
 	FuzzTargetConfig        FuzzTargetConfig        `json:"fuzz_target_config"`
 }
@@ -20,6 +21,19 @@ type Metrics struct {
 	SecondsSinceLastEdge     string `json:"seconds_since_last_edge"`
 }
 
+// ResourceUsage are the resources which the fuzzer used during the
+// run, see report.ResourceUsage.
+type ResourceUsage struct {
+	UserCPUSeconds             float64 `json:"user_cpu_seconds"`
+	SystemCPUSeconds           float64 `json:"system_cpu_seconds"`
+	MaxRSSBytes                string  `json:"max_rss_bytes"`
+	MajorPageFaults            string  `json:"major_page_faults"`
+	VoluntaryContextSwitches   string  `json:"voluntary_context_switches"`
+	InvoluntaryContextSwitches string  `json:"involuntary_context_switches"`
+	SandboxCPUSeconds          float64 `json:"sandbox_cpu_seconds,omitempty"`
+	SandboxPeakMemoryBytes     string  `json:"sandbox_peak_memory_bytes,omitempty"`
+}
+
 type FuzzTargetConfig struct {
 	Name string `json:"name"`
 	CAPI CAPI   `json:"c_api"`
@@ -22,6 +22,17 @@ import (
 	"code-intelligence.com/cifuzz/util/fileutil"
 )
 
+// Flags which make the actions of fuzz test builds independent of the
+// environment of the user who runs them, so that developers and CI
+// machines with the same toolchain share the results in a remote cache.
+// The flags are passed before the user's arguments, so that they can be
+// overridden.
+var hermeticFlags = []string{
+	// Don't pass the user's PATH and LD_LIBRARY_PATH on to the actions,
+	// which are part of the action keys
+	"--incompatible_strict_action_env",
+}
+
 type BuilderOptions struct {
 	ProjectDir string
 	Args       []string
@@ -132,6 +143,7 @@ func (b *Builder) BuildForRun(fuzzTests []string) ([]*build.Result, error) {
 		// Don't use the LLVM from Xcode
 		"--repo_env=BAZEL_USE_CPP_ONLY_TOOLCHAIN=1",
 	}
+	commonFlags = append(commonFlags, hermeticFlags...)
 	if b.NumJobs != 0 {
 		commonFlags = append(commonFlags, "--jobs", fmt.Sprint(b.NumJobs))
 	}
@@ -175,17 +187,16 @@ func (b *Builder) BuildForRun(fuzzTests []string) ([]*build.Result, error) {
 	args = append(args, b.Args...)
 	args = append(args, binLabels...)
 
+	stderr := &cacheStatsWriter{out: b.Stderr}
 	cmd = exec.Command("bazel", args...)
 	cmd.Stdout = b.Stdout
-	cmd.Stderr = b.Stderr
-	if err != nil {
-		return nil, err
-	}
+	cmd.Stderr = stderr
 	log.Debugf("Command: %s", cmd.String())
 	err = cmd.Run()
 	if err != nil {
 		return nil, cmdutils.WrapExecError(errors.WithStack(err), cmd)
 	}
+	stderr.logCacheStats()
 
 	// Assemble the build results
 	var results []*build.Result
@@ -242,6 +253,7 @@ func (b *Builder) BuildForBundle(sanitizers []string, fuzzTests []string) ([]*bu
 		// sanitizer is set to "undefined"
 		"--repo_env=SANITIZER=undefined",
 	}
+	commonFlags = append(commonFlags, hermeticFlags...)
 	if b.NumJobs != 0 {
 		commonFlags = append(commonFlags, "--jobs", fmt.Sprint(b.NumJobs))
 	}
@@ -311,14 +323,16 @@ func (b *Builder) BuildForBundle(sanitizers []string, fuzzTests []string) ([]*bu
 	}
 	args = append(args, labels...)
 
+	stderr := &cacheStatsWriter{out: b.Stderr}
 	cmd := exec.Command("bazel", args...)
 	cmd.Stdout = b.Stdout
-	cmd.Stderr = b.Stderr
+	cmd.Stderr = stderr
 	log.Debugf("Command: %s", cmd.String())
 	err = cmd.Run()
 	if err != nil {
 		return nil, cmdutils.WrapExecError(errors.WithStack(err), cmd)
 	}
+	stderr.logCacheStats()
 
 	// Assemble the build results
 	var results []*build.Result
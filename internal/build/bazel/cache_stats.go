@@ -0,0 +1,101 @@
+package bazel
+
+import (
+	"bytes"
+	"io"
+	"regexp"
+	"strconv"
+	"strings"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// Matches the summary of the executed actions which Bazel prints at the
+// end of a build, e.g.
+//
+//	INFO: 1234 processes: 1000 remote cache hit, 12 internal, 222 linux-sandbox.
+var processesSummaryRegex = regexp.MustCompile(`INFO: (\d+) process(?:es)?(?:: (.*))?\.`)
+
+var ansiEscapeRegex = regexp.MustCompile("\x1b\\[[0-9;]*m")
+
+// cacheStats are the numbers of actions which were executed by a Bazel
+// command and which were served from a (remote or disk) cache.
+type cacheStats struct {
+	// Actions which can be cached, i.e. all except the ones which
+	// Bazel runs internally
+	Cacheable int
+	Hits      int
+}
+
+// parseProcessesSummary returns the cache stats from a line of Bazel's
+// output, if it's the summary of the executed actions.
+func parseProcessesSummary(line string) (*cacheStats, bool) {
+	line = ansiEscapeRegex.ReplaceAllString(line, "")
+	matches := processesSummaryRegex.FindStringSubmatch(line)
+	if matches == nil {
+		return nil, false
+	}
+	total, err := strconv.Atoi(matches[1])
+	if err != nil {
+		return nil, false
+	}
+
+	stats := &cacheStats{Cacheable: total}
+	for _, item := range strings.Split(matches[2], ",") {
+		count, kind, found := strings.Cut(strings.TrimSpace(item), " ")
+		if !found {
+			continue
+		}
+		n, err := strconv.Atoi(count)
+		if err != nil {
+			continue
+		}
+		switch {
+		case kind == "internal":
+			stats.Cacheable -= n
+		case strings.HasSuffix(kind, "cache hit"):
+			stats.Hits += n
+		}
+	}
+	return stats, true
+}
+
+// cacheStatsWriter passes Bazel's output on to out and records the
+// cache stats of the last summary of executed actions.
+type cacheStatsWriter struct {
+	out   io.Writer
+	buf   []byte
+	stats *cacheStats
+}
+
+func (w *cacheStatsWriter) Write(p []byte) (int, error) {
+	w.buf = append(w.buf, p...)
+	for {
+		i := bytes.IndexByte(w.buf, '\n')
+		if i == -1 {
+			break
+		}
+		// Bazel updates lines in place if its output is a terminal
+		for _, line := range strings.Split(string(w.buf[:i]), "\r") {
+			if stats, ok := parseProcessesSummary(line); ok {
+				w.stats = stats
+			}
+		}
+		w.buf = w.buf[i+1:]
+	}
+	if w.out == nil {
+		return len(p), nil
+	}
+	return w.out.Write(p)
+}
+
+// logCacheStats reports how many of the actions run by the last Bazel
+// command were cache hits, which is useful to check whether a shared
+// remote cache is effective
+func (w *cacheStatsWriter) logCacheStats() {
+	if w.stats == nil || w.stats.Cacheable <= 0 {
+		return
+	}
+	log.Infof("Bazel cache hits: %d of %d actions (%d%%)",
+		w.stats.Hits, w.stats.Cacheable, 100*w.stats.Hits/w.stats.Cacheable)
+}
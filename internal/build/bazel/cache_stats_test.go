@@ -0,0 +1,38 @@
+package bazel
+
+import (
+	"bytes"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestParseProcessesSummary(t *testing.T) {
+	stats, ok := parseProcessesSummary("INFO: 1234 processes: 1000 remote cache hit, 12 internal, 222 linux-sandbox.")
+	require.True(t, ok)
+	assert.Equal(t, &cacheStats{Cacheable: 1222, Hits: 1000}, stats)
+
+	stats, ok = parseProcessesSummary("\x1b[32mINFO: \x1b[0m5 processes: 2 disk cache hit, 1 remote cache hit, 2 processwrapper-sandbox.")
+	require.True(t, ok)
+	assert.Equal(t, &cacheStats{Cacheable: 5, Hits: 3}, stats)
+
+	stats, ok = parseProcessesSummary("INFO: 1 process: 1 internal.")
+	require.True(t, ok)
+	assert.Equal(t, &cacheStats{Cacheable: 0, Hits: 0}, stats)
+
+	_, ok = parseProcessesSummary("INFO: Build completed successfully, 5 total actions")
+	assert.False(t, ok)
+}
+
+func TestCacheStatsWriter(t *testing.T) {
+	out := &bytes.Buffer{}
+	w := &cacheStatsWriter{out: out}
+	_, err := w.Write([]byte("INFO: Analyzed target //:fuzz_test (0 packages loaded).\nINFO: 3 processes: 1 remote"))
+	require.NoError(t, err)
+	assert.Nil(t, w.stats)
+	_, err = w.Write([]byte(" cache hit, 2 linux-sandbox.\n"))
+	require.NoError(t, err)
+	assert.Equal(t, &cacheStats{Cacheable: 3, Hits: 1}, w.stats)
+	assert.Equal(t, "INFO: Analyzed target //:fuzz_test (0 packages loaded).\nINFO: 3 processes: 1 remote cache hit, 2 linux-sandbox.\n", out.String())
+}
@@ -9,11 +9,37 @@ import (
 	"code-intelligence.com/cifuzz/util/envutil"
 )
 
+// The build profiles of fuzz tests, see enable_fuzz_testing in
+// tools/cmake/modules/cifuzz-functions.cmake.
+const (
+	// Disables optimizations so that findings are easy to debug
+	ProfileDebug = "debug"
+	// Optimizes for executions per second in long fuzzing runs while
+	// keeping asserts and frame pointers
+	ProfileThroughput = "throughput"
+)
+
+// The fuzzing engines which CMake fuzz tests can be built for, see
+// CIFUZZ_ENGINE in tools/cmake/modules/cifuzz-functions.cmake.
+const (
+	EngineLibFuzzer = "libfuzzer"
+	// AFL++ in persistent mode, built with afl-clang-lto
+	EngineAFLPlusPlus = "aflpp"
+	// Centipede, which runs batches of inputs out of process and
+	// shards the corpus across multiple processes
+	EngineCentipede = "centipede"
+)
+
 type Result struct {
 	// A name which uniquely identifies the fuzz test and is a valid path
 	Name string
 	// Canonical path of the fuzz test executable
 	Executable string
+	// Name under which the fuzz test is registered in an executable
+	// containing several fuzz tests, which selects it via the
+	// CIFUZZ_TEST environment variable. Empty if the executable
+	// contains only this fuzz test.
+	RegisteredTest string
 	// Canonical path of the fuzz test's generated corpus directory
 	GeneratedCorpus string
 	// Canonical path of the fuzz test's default seed corpus directory
@@ -0,0 +1,192 @@
+package cmake
+
+import (
+	"crypto/sha256"
+	"encoding/json"
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/build"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/vcs"
+	"code-intelligence.com/cifuzz/util/envutil"
+)
+
+// The file in the build directory which records the build results of
+// the fuzz tests together with the state of the source tree and the
+// compilers they were built from, see CachedBuild.
+const nameBuildCacheFile = "cifuzz-build-cache.json"
+
+type buildCacheEntry struct {
+	Key    string        `json:"key"`
+	Result *build.Result `json:"result"`
+	// The executable must not have been rebuilt or removed since
+	ExecutableSize    int64     `json:"executable_size"`
+	ExecutableModTime time.Time `json:"executable_mod_time"`
+}
+
+// CachedBuild returns the results of a previous build of the fuzz
+// tests if the source tree, which must be a Git repository, and the
+// compilers haven't changed since, so that configuring and building
+// can be skipped. Changes outside of the Git repository, e.g. to
+// installed libraries, are not detected.
+func (b *Builder) CachedBuild(fuzzTests []string) ([]*build.Result, bool) {
+	key, err := b.buildCacheKey()
+	if err != nil {
+		log.Debugf("Not using the build cache: %v", err)
+		return nil, false
+	}
+	entries, err := b.readBuildCache()
+	if err != nil {
+		log.Debugf("Failed to read the build cache: %v", err)
+		return nil, false
+	}
+
+	var results []*build.Result
+	for _, fuzzTest := range fuzzTests {
+		entry, ok := entries[fuzzTest]
+		if !ok || entry.Key != key {
+			return nil, false
+		}
+		info, err := os.Stat(entry.Result.Executable)
+		if err != nil || info.Size() != entry.ExecutableSize || !info.ModTime().Equal(entry.ExecutableModTime) {
+			return nil, false
+		}
+		results = append(results, entry.Result)
+	}
+	return results, true
+}
+
+// CacheBuild records the build results, so that the fuzz tests don't
+// have to be built again by CachedBuild with the same source tree.
+// CachedBuild must have been called before building them, else the
+// state of the source tree after the build would be recorded. Failing
+// to update the cache is not an error, it only makes the next run
+// slower.
+func (b *Builder) CacheBuild(results []*build.Result) {
+	err := b.writeBuildCache(results)
+	if err != nil {
+		log.Debugf("Failed to update the build cache: %v", err)
+	}
+}
+
+func (b *Builder) writeBuildCache(results []*build.Result) error {
+	if b.cacheKey == "" {
+		return errors.New("The state of the source tree is unknown")
+	}
+	entries, err := b.readBuildCache()
+	if err != nil {
+		entries = make(map[string]*buildCacheEntry)
+	}
+	for _, result := range results {
+		info, err := os.Stat(result.Executable)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		entries[result.Name] = &buildCacheEntry{
+			Key:               b.cacheKey,
+			Result:            result,
+			ExecutableSize:    info.Size(),
+			ExecutableModTime: info.ModTime(),
+		}
+	}
+	content, err := json.MarshalIndent(entries, "", "  ")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	// Write to a temporary file first so that concurrent runs never
+	// read a partially written cache.
+	buildDir, err := b.BuildDir()
+	if err != nil {
+		return err
+	}
+	f, err := os.CreateTemp(buildDir, ".tmp-"+nameBuildCacheFile)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	_, err = f.Write(content)
+	closeErr := f.Close()
+	if err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(f.Name(), filepath.Join(buildDir, nameBuildCacheFile))
+	}
+	if err != nil {
+		_ = os.Remove(f.Name())
+		return errors.WithStack(err)
+	}
+	return nil
+}
+
+func (b *Builder) readBuildCache() (map[string]*buildCacheEntry, error) {
+	buildDir, err := b.BuildDir()
+	if err != nil {
+		return nil, err
+	}
+	content, err := os.ReadFile(filepath.Join(buildDir, nameBuildCacheFile))
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	var entries map[string]*buildCacheEntry
+	err = json.Unmarshal(content, &entries)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return entries, nil
+}
+
+// buildCacheKey identifies the inputs of the build. The build options
+// are encoded in the build directory, in which the cache is stored, so
+// it only has to cover the source tree and the compilers.
+func (b *Builder) buildCacheKey() (string, error) {
+	if b.cacheKey != "" {
+		return b.cacheKey, nil
+	}
+
+	// The build directory, the generated corpora and the findings are
+	// in the project directory, but aren't inputs of the build
+	tree, err := vcs.GitWorkingTreeHash(b.ProjectDir, "**/.cifuzz-*/**")
+	if err != nil {
+		return "", err
+	}
+
+	h := sha256.New()
+	_, _ = fmt.Fprintf(h, "%s\x00", tree)
+	for _, compilerVar := range []string{"CC", "CXX"} {
+		compiler := envutil.Getenv(b.env, compilerVar)
+		if compiler == "" {
+			continue
+		}
+		// The compiler may be a command with arguments, e.g. "ccache clang"
+		args := strings.Fields(compiler)
+		cmd := exec.Command(args[0], append(args[1:], "--version")...)
+		cmd.Env = b.env
+		version, err := cmd.Output()
+		if err != nil {
+			return "", errors.Wrapf(err, "Failed to get the version of %s", compiler)
+		}
+		_, _ = fmt.Fprintf(h, "%s\x00%s\x00", compiler, version)
+	}
+	// Unlike the other options, the instrumentation focus lists aren't
+	// encoded in the build directory
+	_, _ = fmt.Fprintf(h, "%q\x00%q\x00", b.absDirs(b.FuzzingFocusDirs), b.absDirs(b.FuzzingIgnoreDirs))
+	if b.PGOProfile != "" {
+		// The profile is usually not part of the source tree
+		info, err := os.Stat(b.PGOProfile)
+		if err != nil {
+			return "", errors.WithStack(err)
+		}
+		_, _ = fmt.Fprintf(h, "%s\x00%d\x00%d\x00", b.PGOProfile, info.Size(), info.ModTime().UnixNano())
+	}
+
+	b.cacheKey = fmt.Sprintf("%x", h.Sum(nil))
+	return b.cacheKey, nil
+}
@@ -0,0 +1,76 @@
+package cmake
+
+import (
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"testing"
+
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/internal/build"
+)
+
+func TestBuildCache(t *testing.T) {
+	if runtime.GOOS == "windows" {
+		t.Skip("The fake compiler is a shell script")
+	}
+
+	projectDir, err := os.MkdirTemp(baseTempDir, "project-dir-")
+	require.NoError(t, err)
+	err = os.WriteFile(filepath.Join(projectDir, "fuzz_test.cpp"), []byte("// v1"), 0o644)
+	require.NoError(t, err)
+	runGit(t, projectDir, "init")
+
+	compiler := filepath.Join(projectDir, ".cifuzz-bin", "clang")
+	err = os.MkdirAll(filepath.Dir(compiler), 0o755)
+	require.NoError(t, err)
+	err = os.WriteFile(compiler, []byte("#!/bin/sh\necho clang version 15.0.0\n"), 0o755)
+	require.NoError(t, err)
+	t.Setenv("CC", compiler)
+	t.Setenv("CXX", compiler)
+
+	newBuilder := func() *Builder {
+		builder, err := NewBuilder(&BuilderOptions{
+			ProjectDir: projectDir,
+			Sanitizers: []string{"address"},
+			Stdout:     os.Stderr,
+			Stderr:     os.Stderr,
+		})
+		require.NoError(t, err)
+		return builder
+	}
+
+	builder := newBuilder()
+	_, ok := builder.CachedBuild([]string{"fuzz_test"})
+	require.False(t, ok)
+
+	buildDir, err := builder.BuildDir()
+	require.NoError(t, err)
+	executable := filepath.Join(buildDir, "fuzz_test")
+	err = os.WriteFile(executable, []byte("v1"), 0o755)
+	require.NoError(t, err)
+	result := &build.Result{Name: "fuzz_test", Executable: executable, BuildDir: buildDir}
+	builder.CacheBuild([]*build.Result{result})
+
+	// The build directory is not part of the source tree
+	results, ok := newBuilder().CachedBuild([]string{"fuzz_test"})
+	require.True(t, ok)
+	require.Equal(t, []*build.Result{result}, results)
+
+	// Changing the source tree invalidates the cache
+	err = os.WriteFile(filepath.Join(projectDir, "fuzz_test.cpp"), []byte("// v2"), 0o644)
+	require.NoError(t, err)
+	_, ok = newBuilder().CachedBuild([]string{"fuzz_test"})
+	require.False(t, ok)
+}
+
+func runGit(t *testing.T, dir string, args ...string) {
+	cmd := exec.Command("git", args...)
+	cmd.Dir = dir
+	cmd.Stdout = os.Stderr
+	cmd.Stderr = os.Stderr
+	err := cmd.Run()
+	require.NoError(t, err)
+}
@@ -13,13 +13,16 @@ import (
 	"path/filepath"
 	"runtime"
 	"strings"
+	"sync"
 
 	"github.com/pkg/errors"
+	"golang.org/x/sync/errgroup"
 
 	"code-intelligence.com/cifuzz/internal/build"
 	"code-intelligence.com/cifuzz/internal/cmdutils"
 	"code-intelligence.com/cifuzz/internal/ldd"
 	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/envutil"
 	"code-intelligence.com/cifuzz/util/fileutil"
 	"code-intelligence.com/cifuzz/util/sliceutil"
 )
@@ -44,6 +47,31 @@ type BuilderOptions struct {
 	BuildOnly  bool
 
 	FindRuntimeDeps bool
+	// The fuzzing engine, one of build.EngineLibFuzzer (the default if
+	// empty) and build.EngineAFLPlusPlus
+	Engine string
+	// The build profile, one of build.ProfileDebug (the default if
+	// empty) and build.ProfileThroughput
+	Profile string
+	// Whether to build with ThinLTO and a persistent link cache
+	ThinLTO bool
+	// The indexed profile (.profdata) to optimize the fuzz tests with,
+	// e.g. one created by "cifuzz coverage --format=profdata"
+	PGOProfile string
+	// The compiler launcher to prepend to compiler invocations, e.g.
+	// ccache or sccache
+	CompilerLauncher string
+	// The directories whose sources are instrumented in coverage
+	// builds, absolute or relative to the project directory. Defaults
+	// to the project directory.
+	CoverageSourceDirs []string
+	// If set, only the sources in these directories are instrumented
+	// for the coverage feedback of the fuzzing engine. Paths are
+	// absolute or relative to the project directory.
+	FuzzingFocusDirs []string
+	// The directories whose sources are not instrumented for the
+	// coverage feedback of the fuzzing engine
+	FuzzingIgnoreDirs []string
 }
 
 func (opts *BuilderOptions) Validate() error {
@@ -62,6 +90,11 @@ func (opts *BuilderOptions) Validate() error {
 type Builder struct {
 	*BuilderOptions
 	env []string
+	// The inputs of the build, see buildCacheKey
+	cacheKey string
+	// The index of the fuzz tests written by the last configure step,
+	// see loadFuzzTestIndex
+	fuzzTestIndex *fuzzTestIndex
 }
 
 func NewBuilder(opts *BuilderOptions) (*Builder, error) {
@@ -86,6 +119,28 @@ func NewBuilder(opts *BuilderOptions) (*Builder, error) {
 	if err != nil {
 		return nil, err
 	}
+	if b.engine() == build.EngineAFLPlusPlus {
+		// The AFL++ compilers instrument the fuzz tests, so they
+		// replace clang unless the user chose one of them already
+		b.env, err = setCompilerIfNotSet(b.env, "CC", "afl-clang-lto")
+		if err != nil {
+			return nil, err
+		}
+		b.env, err = setCompilerIfNotSet(b.env, "CXX", "afl-clang-lto++")
+		if err != nil {
+			return nil, err
+		}
+	}
+	if b.CompilerLauncher != "" {
+		// The CMake integration maps the paths in debug info to paths
+		// relative to the project directory. Let ccache rewrite the
+		// remaining absolute paths on the command line, such as include
+		// directories, so that the cache is shared between checkouts.
+		b.env, err = envutil.Setenv(b.env, "CCACHE_BASEDIR", b.ProjectDir)
+		if err != nil {
+			return nil, err
+		}
+	}
 
 	return b, nil
 }
@@ -98,12 +153,22 @@ func (b *Builder) BuildDir() (string, error) {
 	// Note: Invoking CMake on the same build directory with different cache
 	// variables is a no-op. For this reason, we have to encode all choices made
 	// for the cache variables below in the path to the build directory.
-	// Currently, this includes the fuzzing engine, the choice of sanitizers
-	// and optional user arguments
+	// Currently, this includes the fuzzing engine, the choice of sanitizers,
+	// the build profile, ThinLTO, PGO and optional user arguments
 	sanitizersSegment := strings.Join(b.Sanitizers, "+")
 	if sanitizersSegment == "" {
 		sanitizersSegment = "none"
 	}
+	// Keep the build directory of the default profile unchanged
+	if b.profile() != build.ProfileDebug {
+		sanitizersSegment += "-" + b.profile()
+	}
+	if b.ThinLTO {
+		sanitizersSegment += "-thinlto"
+	}
+	if b.PGOProfile != "" {
+		sanitizersSegment += "-pgo"
+	}
 
 	buildDir := sanitizersSegment
 
@@ -127,11 +192,57 @@ func (b *Builder) BuildDir() (string, error) {
 		buildDir = fmt.Sprintf("%s-%s", sanitizersSegment, hashString)
 	}
 
-	buildDir = filepath.Join(b.ProjectDir, ".cifuzz-build", "libfuzzer", buildDir)
+	buildDir = filepath.Join(b.ProjectDir, ".cifuzz-build", b.engine(), buildDir)
 
 	return buildDir, nil
 }
 
+func (b *Builder) engine() string {
+	if b.Engine == "" {
+		return build.EngineLibFuzzer
+	}
+	return b.Engine
+}
+
+// coverageSourceDirs returns the absolute paths of the directories
+// whose sources are instrumented in coverage builds. Third-party code
+// fetched into the build directory is below the project directory, so
+// it's only excluded if the directories are set explicitly.
+func (b *Builder) coverageSourceDirs() []string {
+	if len(b.CoverageSourceDirs) == 0 {
+		return []string{b.ProjectDir}
+	}
+	return b.absDirs(b.CoverageSourceDirs)
+}
+
+// absDirs resolves the directories relative to the project directory.
+func (b *Builder) absDirs(dirs []string) []string {
+	var absDirs []string
+	for _, dir := range dirs {
+		if !filepath.IsAbs(dir) {
+			dir = filepath.Join(b.ProjectDir, dir)
+		}
+		absDirs = append(absDirs, filepath.Clean(dir))
+	}
+	return absDirs
+}
+
+func (b *Builder) profile() string {
+	if b.Profile == "" {
+		return build.ProfileDebug
+	}
+	return b.Profile
+}
+
+// setCompilerIfNotSet sets the compiler variable key to compiler,
+// unless it already refers to an AFL++ compiler
+func setCompilerIfNotSet(env []string, key, compiler string) ([]string, error) {
+	if strings.HasPrefix(filepath.Base(envutil.Getenv(env, key)), "afl-") {
+		return env, nil
+	}
+	return envutil.Setenv(env, key, compiler)
+}
+
 // Configure calls cmake to "Generate a project buildsystem" (that's the
 // phrasing used by the CMake man page).
 // Note: This is usually a no-op after the directory has been created once,
@@ -149,8 +260,9 @@ func (b *Builder) Configure() error {
 
 	cacheArgs := []string{
 		"-DCMAKE_BUILD_TYPE=" + cmakeBuildConfiguration,
-		"-DCIFUZZ_ENGINE=libfuzzer",
+		"-DCIFUZZ_ENGINE=" + b.engine(),
 		"-DCIFUZZ_SANITIZERS=" + strings.Join(b.Sanitizers, ";"),
+		"-DCIFUZZ_BUILD_PROFILE=" + b.profile(),
 		"-DCIFUZZ_TESTING:BOOL=ON",
 	}
 	if runtime.GOOS != "windows" {
@@ -165,6 +277,36 @@ func (b *Builder) Configure() error {
 		// 2. Add all library directories to PATH.
 		cacheArgs = append(cacheArgs, "-DCMAKE_BUILD_RPATH_USE_ORIGIN:BOOL=ON")
 	}
+	if b.ThinLTO {
+		// Keep the cache outside of the build directory so that it
+		// survives the build directory being recreated.
+		cacheDir := filepath.Join(b.ProjectDir, ".cifuzz-build", "thinlto-cache", filepath.Base(buildDir))
+		cacheArgs = append(cacheArgs, "-DCIFUZZ_THINLTO:BOOL=ON", "-DCIFUZZ_THINLTO_CACHE_DIR="+cacheDir)
+	}
+	if b.PGOProfile != "" {
+		cacheArgs = append(cacheArgs, "-DCIFUZZ_PROFILE_USE="+b.PGOProfile)
+	}
+	if runner := envutil.Getenv(b.env, "CIFUZZ_CENTIPEDE_RUNNER"); b.engine() == build.EngineCentipede && runner != "" {
+		// Passed explicitly so that a changed path updates the cache
+		// variable, which only defaults to the environment variable
+		cacheArgs = append(cacheArgs, "-DCIFUZZ_CENTIPEDE_RUNNER="+runner)
+	}
+	// The lists are always passed, so that removing them from the
+	// config also removes them from the cache
+	if sliceutil.Contains(b.Sanitizers, "coverage") {
+		cacheArgs = append(cacheArgs, "-DCIFUZZ_COVERAGE_SOURCE_DIRS="+strings.Join(b.coverageSourceDirs(), ";"))
+	} else {
+		cacheArgs = append(cacheArgs,
+			"-DCIFUZZ_FUZZING_FOCUS_DIRS="+strings.Join(b.absDirs(b.FuzzingFocusDirs), ";"),
+			"-DCIFUZZ_FUZZING_IGNORE_DIRS="+strings.Join(b.absDirs(b.FuzzingIgnoreDirs), ";"))
+	}
+	if b.CompilerLauncher != "" {
+		// The launcher doesn't change the build output, so it doesn't
+		// have to be encoded in the build directory.
+		cacheArgs = append(cacheArgs,
+			"-DCMAKE_C_COMPILER_LAUNCHER="+b.CompilerLauncher,
+			"-DCMAKE_CXX_COMPILER_LAUNCHER="+b.CompilerLauncher)
+	}
 
 	args := cacheArgs
 	args = append(args, b.Args...)
@@ -181,6 +323,8 @@ func (b *Builder) Configure() error {
 	if err != nil {
 		return cmdutils.WrapExecError(errors.WithStack(err), cmd)
 	}
+	// The configure step writes a new index
+	b.fuzzTestIndex = nil
 	return nil
 }
 
@@ -218,41 +362,50 @@ func (b *Builder) Build(fuzzTests []string) ([]*build.Result, error) {
 		return nil, nil
 	}
 
-	var results []*build.Result
-	for _, fuzzTest := range fuzzTests {
-		executable, err := b.findFuzzTestExecutable(fuzzTest)
+	executables := make([]string, len(fuzzTests))
+	for i, fuzzTest := range fuzzTests {
+		executables[i], err = b.findFuzzTestExecutable(fuzzTest)
+		if err != nil {
+			return nil, err
+		}
+	}
+
+	var runtimeDeps [][]string
+	if b.FindRuntimeDeps {
+		runtimeDeps, err = b.findRuntimeDeps(fuzzTests, executables)
 		if err != nil {
 			return nil, err
 		}
+	}
+
+	var results []*build.Result
+	for i, fuzzTest := range fuzzTests {
+		executable := executables[i]
 		seedCorpus, err := b.findFuzzTestSeedCorpus(fuzzTest)
 		if err != nil {
 			return nil, err
 		}
+		registeredTest, err := b.findRegisteredTest(fuzzTest)
+		if err != nil {
+			return nil, err
+		}
 
-		var runtimeDeps []string
-		if b.FindRuntimeDeps {
-			// TODO if we have another solution for windows/darwin we should remove
-			// the getRuntimeDeps and the related code in cifuzz-functions.cmake
-			if runtime.GOOS == "linux" {
-				runtimeDeps, err = ldd.NonSystemSharedLibraries(executable)
-			} else {
-				runtimeDeps, err = b.getRuntimeDeps(fuzzTest)
-			}
-			if err != nil {
-				return nil, err
-			}
+		var deps []string
+		if runtimeDeps != nil {
+			deps = runtimeDeps[i]
 		}
 
 		generatedCorpus := filepath.Join(b.ProjectDir, ".cifuzz-corpus", fuzzTest)
 		result := &build.Result{
 			Name:            fuzzTest,
 			Executable:      executable,
+			RegisteredTest:  registeredTest,
 			GeneratedCorpus: generatedCorpus,
 			SeedCorpus:      seedCorpus,
 			BuildDir:        buildDir,
 			ProjectDir:      b.ProjectDir,
 			Sanitizers:      b.Sanitizers,
-			RuntimeDeps:     runtimeDeps,
+			RuntimeDeps:     deps,
 		}
 		results = append(results, result)
 	}
@@ -274,9 +427,39 @@ func (b *Builder) findFuzzTestSeedCorpus(fuzzTest string) (string, error) {
 	return b.readInfoFileAsPath(fuzzTest, "seed_corpus")
 }
 
+// findRegisteredTest uses the info files emitted by the CMake integration
+// in the configure step to look up the name under which a fuzz test is
+// registered in an executable containing several fuzz tests. It returns
+// the empty string for fuzz tests that have an executable of their own.
+func (b *Builder) findRegisteredTest(fuzzTest string) (string, error) {
+	index, err := b.loadFuzzTestIndex()
+	if err != nil {
+		return "", err
+	}
+	if index != nil {
+		if info, ok := index.infos[fuzzTest]; ok {
+			return info.registeredTest, nil
+		}
+	}
+	registeredTest, err := b.readInfoFileAsPath(fuzzTest, "registered_test")
+	if errors.Is(err, os.ErrNotExist) {
+		return "", nil
+	}
+	return registeredTest, err
+}
+
 // ListFuzzTests lists all fuzz tests defined in the CMake project after
 // Configure has been run.
 func (b *Builder) ListFuzzTests() ([]string, error) {
+	index, err := b.loadFuzzTestIndex()
+	if err != nil {
+		return nil, err
+	}
+	if index != nil {
+		return index.fuzzTests, nil
+	}
+
+	// CMake versions older than 3.19 don't write the index
 	fuzzTestsDir, err := b.fuzzTestsInfoDir()
 	if err != nil {
 		return nil, err
@@ -294,6 +477,58 @@ func (b *Builder) ListFuzzTests() ([]string, error) {
 	return fuzzTests, nil
 }
 
+// findRuntimeDeps returns the runtime dependencies of each of the fuzz
+// tests, which are built into the given executables. The executables
+// are resolved concurrently, and only once if they contain several fuzz
+// tests.
+func (b *Builder) findRuntimeDeps(fuzzTests []string, executables []string) ([][]string, error) {
+	// The fuzz test by which each executable is resolved
+	fuzzTestOf := make(map[string]string)
+	for i, executable := range executables {
+		if _, ok := fuzzTestOf[executable]; !ok {
+			fuzzTestOf[executable] = fuzzTests[i]
+		}
+	}
+
+	var mutex sync.Mutex
+	depsOf := make(map[string][]string, len(fuzzTestOf))
+	routines := errgroup.Group{}
+	routines.SetLimit(runtime.NumCPU())
+	for executable, fuzzTest := range fuzzTestOf {
+		executable, fuzzTest := executable, fuzzTest
+		routines.Go(func() error {
+			var deps []string
+			var err error
+			// TODO if we have another solution for windows/darwin we should remove
+			// the getRuntimeDeps and the related code in cifuzz-functions.cmake
+			if runtime.GOOS == "linux" {
+				deps, err = ldd.NonSystemSharedLibraries(executable)
+			} else {
+				deps, err = b.getRuntimeDeps(fuzzTest)
+			}
+			if err != nil {
+				return err
+			}
+			mutex.Lock()
+			depsOf[executable] = deps
+			mutex.Unlock()
+			return nil
+		})
+	}
+	err := routines.Wait()
+	if err != nil {
+		return nil, err
+	}
+
+	res := make([][]string, len(executables))
+	for i, executable := range executables {
+		// Each result gets its own slice, because the bundler adjusts
+		// the paths of the runtime dependencies of a result
+		res[i] = append([]string(nil), depsOf[executable]...)
+	}
+	return res, nil
+}
+
 // getRuntimeDeps returns the canonical paths of all (transitive) runtime
 // dependencies of the given fuzz test. It prints a warning if any dependency
 // couldn't be resolved or resolves to more than one file.
@@ -377,8 +612,23 @@ func (b *Builder) getRuntimeDeps(fuzzTest string) ([]string, error) {
 }
 
 // readInfoFileAsPath returns the contents of the CMake-generated info file of type kind for the given fuzz test,
-// interpreted as a path. All symlinks are followed.
+// interpreted as a path. All symlinks are followed. The fuzz test index is used instead of the info file if it
+// exists.
 func (b *Builder) readInfoFileAsPath(fuzzTest string, kind string) (string, error) {
+	index, err := b.loadFuzzTestIndex()
+	if err != nil {
+		return "", err
+	}
+	if index != nil {
+		if info, ok := index.infos[fuzzTest]; ok {
+			switch kind {
+			case "executable":
+				return info.executable, nil
+			case "seed_corpus":
+				return info.seedCorpus, nil
+			}
+		}
+	}
 
 	fuzzTestsInfoDir, err := b.fuzzTestsInfoDir()
 	if err != nil {
@@ -9,6 +9,8 @@ import (
 
 	"github.com/stretchr/testify/require"
 
+	"code-intelligence.com/cifuzz/internal/build"
+	"code-intelligence.com/cifuzz/util/envutil"
 	"code-intelligence.com/cifuzz/util/fileutil"
 )
 
@@ -78,3 +80,38 @@ func TestNewBuilder(t *testing.T) {
 	// (because they use the same engine and sanitizers)
 	require.Equal(t, buildDir1, buildDir3)
 }
+
+func TestNewBuilder_AFLPlusPlus(t *testing.T) {
+	projectDir, err := os.MkdirTemp(baseTempDir, "project-dir-")
+	require.NoError(t, err)
+	t.Setenv("CC", "")
+	t.Setenv("CXX", "/opt/aflplusplus/bin/afl-clang-fast++")
+
+	builder, err := NewBuilder(&BuilderOptions{
+		ProjectDir: projectDir,
+		Engine:     build.EngineAFLPlusPlus,
+		Sanitizers: []string{"address"},
+		Stdout:     os.Stderr,
+		Stderr:     os.Stderr,
+	})
+	require.NoError(t, err)
+	buildDir, err := builder.BuildDir()
+	require.NoError(t, err)
+	require.Equal(t, filepath.Join(projectDir, ".cifuzz-build", "aflpp", "address"), buildDir)
+
+	// The AFL++ compilers replace clang, but a user-specified one is kept
+	require.Equal(t, "afl-clang-lto", envutil.Getenv(builder.env, "CC"))
+	require.Equal(t, "/opt/aflplusplus/bin/afl-clang-fast++", envutil.Getenv(builder.env, "CXX"))
+}
+
+func TestCoverageSourceDirs(t *testing.T) {
+	projectDir := filepath.Join(baseTempDir, "project")
+	b := &Builder{BuilderOptions: &BuilderOptions{ProjectDir: projectDir}}
+	require.Equal(t, []string{projectDir}, b.coverageSourceDirs())
+
+	b.CoverageSourceDirs = []string{"src/", "/opt/shared/lib"}
+	require.Equal(t, []string{filepath.Join(projectDir, "src"), "/opt/shared/lib"}, b.coverageSourceDirs())
+
+	// The fuzzing focus lists have no default
+	require.Empty(t, b.absDirs(b.FuzzingFocusDirs))
+}
@@ -0,0 +1,123 @@
+package cmake
+
+import (
+	"os"
+	"path/filepath"
+	"strings"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/util/sliceutil"
+)
+
+// The index of the fuzz tests which the CMake integration writes next
+// to the fuzz_tests info directory with CMake 3.19 or newer. It has
+// one line per fuzz test, with its name, the paths of its executable
+// and its seed corpus and the name under which it's registered in the
+// executable (empty if it has an executable of its own), separated by
+// tabs. Unlike the info directory, it only contains the fuzz tests of
+// the last configure step.
+const fuzzTestIndexFile = "fuzz_tests.index"
+
+type fuzzTestInfo struct {
+	executable     string
+	seedCorpus     string
+	registeredTest string
+}
+
+type fuzzTestIndex struct {
+	// The fuzz tests in the order in which they were added
+	fuzzTests []string
+	infos     map[string]*fuzzTestInfo
+}
+
+// readFuzzTestIndex parses the index file at path. It returns an error
+// wrapping os.ErrNotExist if the file doesn't exist.
+func readFuzzTestIndex(path string) (*fuzzTestIndex, error) {
+	content, err := os.ReadFile(path)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return parseFuzzTestIndex(string(content))
+}
+
+func parseFuzzTestIndex(content string) (*fuzzTestIndex, error) {
+	index := &fuzzTestIndex{infos: make(map[string]*fuzzTestInfo)}
+	for _, line := range strings.Split(content, "\n") {
+		line = strings.TrimSuffix(line, "\r")
+		if line == "" {
+			continue
+		}
+		fields := strings.Split(line, "\t")
+		if len(fields) != 4 {
+			return nil, errors.Errorf("Invalid line in fuzz test index: %q", line)
+		}
+		name := fields[0]
+		if _, ok := index.infos[name]; !ok {
+			index.fuzzTests = append(index.fuzzTests, name)
+		}
+		index.infos[name] = &fuzzTestInfo{
+			executable:     fields[1],
+			seedCorpus:     fields[2],
+			registeredTest: fields[3],
+		}
+	}
+	return index, nil
+}
+
+// loadFuzzTestIndex returns the index of the fuzz tests in the build
+// directory, which is only read once after each configure step, or nil
+// if CMake didn't write one.
+func (b *Builder) loadFuzzTestIndex() (*fuzzTestIndex, error) {
+	if b.fuzzTestIndex != nil {
+		return b.fuzzTestIndex, nil
+	}
+	fuzzTestsInfoDir, err := b.fuzzTestsInfoDir()
+	if err != nil {
+		return nil, err
+	}
+	index, err := readFuzzTestIndex(filepath.Join(filepath.Dir(fuzzTestsInfoDir), fuzzTestIndexFile))
+	if errors.Is(err, os.ErrNotExist) {
+		return nil, nil
+	}
+	if err != nil {
+		return nil, err
+	}
+	b.fuzzTestIndex = index
+	return index, nil
+}
+
+// IndexedFuzzTests returns the fuzz tests in the indexes of all build
+// directories of the project, which takes a single read per build
+// directory. It returns an error wrapping os.ErrNotExist if there is no
+// index, e.g. because the project wasn't configured with CMake 3.19 or
+// newer.
+func IndexedFuzzTests(projectDir string) ([]string, error) {
+	buildDirs := filepath.Join(projectDir, ".cifuzz-build", "*", "*")
+	var paths []string
+	// See fuzzTestsInfoDir for the locations used by single- and
+	// multi-configuration generators
+	for _, pattern := range []string{
+		filepath.Join(buildDirs, ".cifuzz", fuzzTestIndexFile),
+		filepath.Join(buildDirs, cmakeBuildConfiguration, ".cifuzz", fuzzTestIndexFile),
+	} {
+		matches, err := filepath.Glob(pattern)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		paths = append(paths, matches...)
+	}
+	if len(paths) == 0 {
+		return nil, errors.WithStack(os.ErrNotExist)
+	}
+
+	var fuzzTests []string
+	for _, path := range paths {
+		index, err := readFuzzTestIndex(path)
+		if err != nil {
+			return nil, err
+		}
+		fuzzTests = append(fuzzTests, index.fuzzTests...)
+	}
+	return sliceutil.RemoveDuplicates(fuzzTests), nil
+}
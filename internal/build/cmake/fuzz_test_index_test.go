@@ -0,0 +1,47 @@
+package cmake
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestParseFuzzTestIndex(t *testing.T) {
+	index, err := parseFuzzTestIndex("" +
+		"parser_fuzz_test\t/build/parser_fuzz_test\t/src/parser_fuzz_test_inputs\t\n" +
+		"foo_test\t/build/tests\t/src/foo_test_inputs\tfoo_test\r\n" +
+		"\n")
+	require.NoError(t, err)
+	assert.Equal(t, []string{"parser_fuzz_test", "foo_test"}, index.fuzzTests)
+	assert.Equal(t, &fuzzTestInfo{
+		executable: "/build/parser_fuzz_test",
+		seedCorpus: "/src/parser_fuzz_test_inputs",
+	}, index.infos["parser_fuzz_test"])
+	assert.Equal(t, "foo_test", index.infos["foo_test"].registeredTest)
+
+	_, err = parseFuzzTestIndex("parser_fuzz_test\t/build/parser_fuzz_test\n")
+	require.Error(t, err)
+}
+
+func TestIndexedFuzzTests(t *testing.T) {
+	projectDir := t.TempDir()
+	_, err := IndexedFuzzTests(projectDir)
+	require.ErrorIs(t, err, os.ErrNotExist)
+
+	for _, dir := range []string{
+		filepath.Join(".cifuzz-build", "libfuzzer", "address+undefined", ".cifuzz"),
+		filepath.Join(".cifuzz-build", "replayer", "coverage", cmakeBuildConfiguration, ".cifuzz"),
+	} {
+		err = os.MkdirAll(filepath.Join(projectDir, dir), 0o755)
+		require.NoError(t, err)
+		err = os.WriteFile(filepath.Join(projectDir, dir, fuzzTestIndexFile),
+			[]byte("parser_fuzz_test\t/build/parser_fuzz_test\t/src/parser_fuzz_test_inputs\t\n"), 0o644)
+		require.NoError(t, err)
+	}
+	fuzzTests, err := IndexedFuzzTests(projectDir)
+	require.NoError(t, err)
+	assert.Equal(t, []string{"parser_fuzz_test"}, fuzzTests)
+}
@@ -100,24 +100,35 @@ func (b *Builder) Build(fuzzTest string) (*build.Result, error) {
 	var err error
 
 	if !slices.Equal(b.Sanitizers, []string{"coverage"}) {
-		// We compile the dumper without any user-provided flags. This
-		// should be safe as it does not use any stdlib functions.
+		// We compile the dumper and the input ring without any
+		// user-provided flags. This should be safe as they only use
+		// libc functions.
 		dumperSource, err := runfiles.Finder.DumperSourcePath()
 		if err != nil {
 			return nil, err
 		}
+		sources := map[string]string{"dumper.o": dumperSource}
+		if runtime.GOOS == "linux" {
+			inputRingSource, err := runfiles.Finder.InputRingSourcePath()
+			if err != nil {
+				return nil, err
+			}
+			sources["inputring.o"] = inputRingSource
+		}
 		clang, err := runfiles.Finder.ClangPath()
 		if err != nil {
 			return nil, err
 		}
-		// Compile with -fPIC just in case the fuzz test is a PIE.
-		cmd := exec.Command(clang, "-fPIC", "-c", dumperSource, "-o", filepath.Join(b.buildDir, "dumper.o"))
-		cmd.Stdout = b.Stdout
-		cmd.Stderr = b.Stderr
-		log.Debugf("Command: %s", cmd.String())
-		err = cmd.Run()
-		if err != nil {
-			return nil, errors.WithStack(err)
+		for object, source := range sources {
+			// Compile with -fPIC just in case the fuzz test is a PIE.
+			cmd := exec.Command(clang, "-fPIC", "-c", source, "-o", filepath.Join(b.buildDir, object))
+			cmd.Stdout = b.Stdout
+			cmd.Stderr = b.Stderr
+			log.Debugf("Command: %s", cmd.String())
+			err = cmd.Run()
+			if err != nil {
+				return nil, errors.WithStack(err)
+			}
 		}
 	}
 
@@ -248,6 +259,12 @@ func (b *Builder) setLibFuzzerEnv() error {
 		fuzzTestLdflags = append(fuzzTestLdflags, "-Wl,--wrap=__sanitizer_set_death_callback")
 	}
 	fuzzTestLdflags = append(fuzzTestLdflags, "-fsanitize=fuzzer", filepath.Join(b.buildDir, "dumper.o"))
+	// On Linux, we also link in the input ring, which keeps the last
+	// inputs in a memory-mapped file, so that they can be recovered if
+	// the fuzz test is killed. See src/inputring.c for details.
+	if runtime.GOOS == "linux" {
+		fuzzTestLdflags = append(fuzzTestLdflags, "-Wl,--wrap=LLVMFuzzerTestOneInput", filepath.Join(b.buildDir, "inputring.o"))
+	}
 	b.env, err = envutil.Setenv(b.env, "FUZZ_TEST_LDFLAGS", strings.Join(fuzzTestLdflags, " "))
 	if err != nil {
 		return err
@@ -3,6 +3,8 @@ package archive
 import (
 	"archive/tar"
 	"compress/gzip"
+	"crypto/sha256"
+	"encoding/hex"
 	"io"
 	"io/fs"
 	"os"
@@ -19,16 +21,64 @@ import (
 type ArchiveWriter struct {
 	*tar.Writer
 	manifest   map[string]string
-	gzipWriter *gzip.Writer
+	gzipWriter io.WriteCloser
+	// The regular files which were written to the archive, by size, to
+	// store files with the same content only once
+	filesBySize map[int64][]*archivedFile
+}
+
+type archivedFile struct {
+	archivePath string
+	sourcePath  string
+	mode        int64
+	// The SHA-256 of the content, computed once another file of the
+	// same size is written
+	hash string
+}
+
+// CompressionOptions configure the gzip compression of an archive.
+type CompressionOptions struct {
+	// Level is the gzip compression level, from gzip.BestSpeed (1) to
+	// gzip.BestCompression (9). Zero means gzip.DefaultCompression.
+	Level int
+	// Jobs is the number of blocks of the archive which are compressed
+	// in parallel, see parallelGzipWriter. Zero or one means that the
+	// archive is compressed as a single gzip stream.
+	Jobs uint
 }
 
 func NewArchiveWriter(w io.Writer) *ArchiveWriter {
-	gzipWriter := gzip.NewWriter(w)
-	return &ArchiveWriter{
-		Writer:     tar.NewWriter(gzipWriter),
-		manifest:   make(map[string]string),
-		gzipWriter: gzipWriter,
+	writer, err := NewArchiveWriterWithCompression(w, &CompressionOptions{})
+	if err != nil {
+		// The default compression options are always valid
+		panic(err)
+	}
+	return writer
+}
+
+func NewArchiveWriterWithCompression(w io.Writer, opts *CompressionOptions) (*ArchiveWriter, error) {
+	level := opts.Level
+	if level == 0 {
+		level = gzip.DefaultCompression
+	}
+
+	var gzipWriter io.WriteCloser
+	var err error
+	if opts.Jobs > 1 {
+		gzipWriter, err = newParallelGzipWriter(w, level, opts.Jobs)
+	} else {
+		gzipWriter, err = gzip.NewWriterLevel(w, level)
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
 	}
+
+	return &ArchiveWriter{
+		Writer:      tar.NewWriter(gzipWriter),
+		manifest:    make(map[string]string),
+		gzipWriter:  gzipWriter,
+		filesBySize: make(map[int64][]*archivedFile),
+	}, nil
 }
 
 // Close closes the tar writer and the gzip writer. It does not close
@@ -49,7 +99,10 @@ func (w *ArchiveWriter) Close() error {
 // WriteFile writes the contents of sourcePath to the archive, with the
 // filename archivePath (so when the archive is extracted, the file will
 // be created at archivePath). Symlinks will be followed.
-// WriteFile only handles regular files and symlinks.
+// WriteFile only handles regular files and symlinks. If a file with the
+// same content and mode was written before, a hard link to it is added
+// instead, so that e.g. the shared libraries and seeds used by multiple
+// fuzz tests are only stored once.
 func (w *ArchiveWriter) WriteFile(archivePath string, sourcePath string) error {
 	if fileutil.IsDir(sourcePath) {
 		return errors.Errorf("file is a directory: %s", sourcePath)
@@ -65,6 +118,7 @@ func (w *ArchiveWriter) writeFileOrEmptyDir(archivePath string, sourcePath strin
 	if conflict {
 		if existingAbsPath == sourcePath {
 			log.Debugf("Skipping file %q, was already added to the archive", sourcePath)
+			return nil
 		} else {
 			return errors.Errorf("archive path %q has two source files: %q and %q", archivePath, existingAbsPath, sourcePath)
 		}
@@ -88,6 +142,30 @@ func (w *ArchiveWriter) writeFileOrEmptyDir(archivePath string, sourcePath strin
 		return errors.WithStack(err)
 	}
 	header.Name = archivePath
+
+	var file *archivedFile
+	if info.Mode().IsRegular() && info.Size() > 0 {
+		file = &archivedFile{archivePath: archivePath, sourcePath: sourcePath, mode: header.Mode}
+		var target string
+		target, err = w.findSameContent(file, info.Size())
+		if err != nil {
+			return err
+		}
+		if target != "" {
+			log.Debugf("Adding %q as a hard link to %q, which has the same content", archivePath, target)
+			err = w.WriteHeader(&tar.Header{
+				Typeflag: tar.TypeLink,
+				Name:     archivePath,
+				Linkname: target,
+			})
+			if err != nil {
+				return errors.WithStack(err)
+			}
+			w.manifest[archivePath] = sourcePath
+			return nil
+		}
+	}
+
 	err = w.WriteHeader(header)
 	if err != nil {
 		return errors.WithStack(err)
@@ -106,9 +184,59 @@ func (w *ArchiveWriter) writeFileOrEmptyDir(archivePath string, sourcePath strin
 	}
 
 	w.manifest[archivePath] = sourcePath
+	if file != nil {
+		w.filesBySize[info.Size()] = append(w.filesBySize[info.Size()], file)
+	}
 	return nil
 }
 
+// findSameContent returns the archive path of a file which was written
+// before and has the same content and mode as the given file, or an
+// empty string if there is none. Files are only hashed if another file
+// of the same size was written, which is rare for unrelated files.
+func (w *ArchiveWriter) findSameContent(file *archivedFile, size int64) (string, error) {
+	candidates := w.filesBySize[size]
+	if len(candidates) == 0 {
+		return "", nil
+	}
+
+	var err error
+	file.hash, err = sha256sum(file.sourcePath)
+	if err != nil {
+		return "", err
+	}
+	for _, c := range candidates {
+		if c.mode != file.mode {
+			continue
+		}
+		if c.hash == "" {
+			c.hash, err = sha256sum(c.sourcePath)
+			if err != nil {
+				return "", err
+			}
+		}
+		if c.hash == file.hash {
+			return c.archivePath, nil
+		}
+	}
+	return "", nil
+}
+
+func sha256sum(path string) (string, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer f.Close()
+
+	h := sha256.New()
+	_, err = io.Copy(h, f)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return hex.EncodeToString(h.Sum(nil)), nil
+}
+
 // WriteHardLink adds a hard link header to the archive. When the
 // archive is extracted, a hard link to target with the name linkname is
 // created.
@@ -127,7 +255,7 @@ func (w *ArchiveWriter) WriteHardLink(target string, linkname string) error {
 	if err != nil {
 		return errors.WithStack(err)
 	}
-	w.manifest[target] = linkname
+	w.manifest[linkname] = w.manifest[target]
 	return nil
 }
 
@@ -1,8 +1,12 @@
 package archive
 
 import (
+	"archive/tar"
 	"bufio"
+	"bytes"
+	"compress/gzip"
 	"fmt"
+	"io"
 	"io/fs"
 	"os"
 	"os/exec"
@@ -10,6 +14,7 @@ import (
 	"runtime"
 	"strings"
 	"testing"
+	"time"
 
 	"github.com/otiai10/copy"
 	"github.com/stretchr/testify/assert"
@@ -138,3 +143,76 @@ func TestWriteArchive(t *testing.T) {
 	}
 	require.Empty(t, remainingExpectedEntries, "Archive did not contain the following expected entries: %s", msg.String())
 }
+
+func TestWriteArchive_DeduplicatesContent(t *testing.T) {
+	dir := t.TempDir()
+	writeFile := func(name, content string) string {
+		path := filepath.Join(dir, name)
+		require.NoError(t, os.WriteFile(path, []byte(content), 0o644))
+		return path
+	}
+	lib := writeFile("lib.so", "library")
+	sameLib := writeFile("same_lib.so", "library")
+	otherLib := writeFile("other_lib.so", "LIBRARY")
+
+	var archive bytes.Buffer
+	archiveWriter := NewArchiveWriter(&archive)
+	require.NoError(t, archiveWriter.WriteFile("fuzzing/bin/lib.so", lib))
+	require.NoError(t, archiveWriter.WriteFile("coverage/bin/lib.so", sameLib))
+	require.NoError(t, archiveWriter.WriteFile("coverage/bin/other_lib.so", otherLib))
+	require.NoError(t, archiveWriter.Close())
+
+	gr, err := gzip.NewReader(&archive)
+	require.NoError(t, err)
+	tr := tar.NewReader(gr)
+	links := make(map[string]string)
+	var files []string
+	for {
+		header, err := tr.Next()
+		if err == io.EOF {
+			break
+		}
+		require.NoError(t, err)
+		if header.Typeflag == tar.TypeLink {
+			links[header.Name] = header.Linkname
+		} else {
+			files = append(files, header.Name)
+		}
+	}
+	assert.Equal(t, []string{"fuzzing/bin/lib.so", "coverage/bin/other_lib.so"}, files)
+	assert.Equal(t, map[string]string{"coverage/bin/lib.so": "fuzzing/bin/lib.so"}, links)
+}
+
+func TestContentDigest(t *testing.T) {
+	dir := t.TempDir()
+	file := filepath.Join(dir, "file")
+	require.NoError(t, os.WriteFile(file, []byte("content"), 0o644))
+
+	createBundle := func(name string, opts *CompressionOptions) string {
+		path := filepath.Join(dir, name)
+		f, err := os.Create(path)
+		require.NoError(t, err)
+		defer f.Close()
+		archiveWriter, err := NewArchiveWriterWithCompression(f, opts)
+		require.NoError(t, err)
+		require.NoError(t, archiveWriter.WriteFile("file", file))
+		require.NoError(t, archiveWriter.Close())
+		return path
+	}
+
+	digest1, err := ContentDigest(createBundle("bundle1.tar.gz", &CompressionOptions{}))
+	require.NoError(t, err)
+
+	// Neither the modification time nor the compression matter
+	later := time.Now().Add(time.Hour)
+	require.NoError(t, os.Chtimes(file, later, later))
+	digest2, err := ContentDigest(createBundle("bundle2.tar.gz", &CompressionOptions{Level: 1, Jobs: 2}))
+	require.NoError(t, err)
+	assert.Equal(t, digest1, digest2)
+
+	// The content does
+	require.NoError(t, os.WriteFile(file, []byte("changed"), 0o644))
+	digest3, err := ContentDigest(createBundle("bundle3.tar.gz", &CompressionOptions{}))
+	require.NoError(t, err)
+	assert.NotEqual(t, digest1, digest3)
+}
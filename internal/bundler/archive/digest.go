@@ -0,0 +1,60 @@
+package archive
+
+import (
+	"archive/tar"
+	"compress/gzip"
+	"crypto/sha256"
+	"encoding/binary"
+	"encoding/hex"
+	"io"
+	"os"
+
+	"github.com/pkg/errors"
+)
+
+// ContentDigest returns the SHA-256 of the entries of the bundle, i.e.
+// of their paths, types, modes, link targets and contents. Unlike the
+// hash of the bundle file, it doesn't depend on the modification times
+// of the bundled files and on the compression, so bundles which were
+// created again from the same build artifacts have the same digest.
+func ContentDigest(bundle string) (string, error) {
+	f, err := os.Open(bundle)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer f.Close()
+	gr, err := gzip.NewReader(f)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer gr.Close()
+
+	h := sha256.New()
+	writeField := func(b []byte) {
+		// Prefix each field with its length to make the encoding
+		// unambiguous. Writes to a hash never fail.
+		_ = binary.Write(h, binary.BigEndian, uint64(len(b)))
+		_, _ = h.Write(b)
+	}
+
+	tr := tar.NewReader(gr)
+	for {
+		header, err := tr.Next()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return "", errors.WithStack(err)
+		}
+		writeField([]byte(header.Name))
+		writeField([]byte{header.Typeflag})
+		_ = binary.Write(h, binary.BigEndian, header.Mode)
+		writeField([]byte(header.Linkname))
+		_ = binary.Write(h, binary.BigEndian, header.Size)
+		_, err = io.Copy(h, tr)
+		if err != nil {
+			return "", errors.WithStack(err)
+		}
+	}
+	return hex.EncodeToString(h.Sum(nil)), nil
+}
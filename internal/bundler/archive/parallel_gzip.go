@@ -0,0 +1,152 @@
+package archive
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"sync"
+
+	"github.com/pkg/errors"
+)
+
+// The size of the blocks which are compressed in parallel. Each block
+// is compressed without the preceding data as a dictionary, so smaller
+// blocks compress worse.
+const parallelGzipBlockSize = 1 << 20
+
+// parallelGzipWriter compresses blocks of its input in parallel and
+// writes each of them as a separate gzip member. A sequence of gzip
+// members is a valid gzip file (see RFC 1952, section 2.2), which is
+// extracted as a single stream by gzip.Reader, gunzip and tar.
+type parallelGzipWriter struct {
+	out   io.Writer
+	level int
+	buf   []byte
+	// The results of the blocks which are being compressed, in the
+	// order of the input. Its capacity limits the number of blocks
+	// which are compressed at the same time.
+	pending chan chan *compressedBlock
+	// Closed once all compressed blocks were written
+	done chan struct{}
+	// Whether any block was submitted
+	submitted bool
+	pool      sync.Pool
+
+	errMutex sync.Mutex
+	err      error
+}
+
+type compressedBlock struct {
+	data []byte
+	err  error
+}
+
+func newParallelGzipWriter(out io.Writer, level int, jobs uint) (*parallelGzipWriter, error) {
+	// Fail early on an invalid level, which would else only be reported
+	// by the first block
+	_, err := gzip.NewWriterLevel(io.Discard, level)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	w := &parallelGzipWriter{
+		out:     out,
+		level:   level,
+		pending: make(chan chan *compressedBlock, jobs),
+		done:    make(chan struct{}),
+	}
+	go w.writeBlocks()
+	return w, nil
+}
+
+func (w *parallelGzipWriter) Write(p []byte) (int, error) {
+	if err := w.error(); err != nil {
+		return 0, err
+	}
+	n := len(p)
+	for len(w.buf)+len(p) >= parallelGzipBlockSize {
+		i := parallelGzipBlockSize - len(w.buf)
+		w.buf = append(w.buf, p[:i]...)
+		p = p[i:]
+		w.submit()
+	}
+	w.buf = append(w.buf, p...)
+	return n, nil
+}
+
+// Close compresses the remaining input and waits until everything was
+// written. It does not close the underlying io.Writer.
+func (w *parallelGzipWriter) Close() error {
+	// An empty input still results in a gzip member, like with
+	// gzip.Writer
+	if len(w.buf) > 0 || !w.submitted {
+		w.submit()
+	}
+	close(w.pending)
+	<-w.done
+	return w.error()
+}
+
+// submit starts compressing the buffered input
+func (w *parallelGzipWriter) submit() {
+	block := w.buf
+	w.buf = make([]byte, 0, parallelGzipBlockSize)
+	w.submitted = true
+
+	result := make(chan *compressedBlock, 1)
+	// Blocks until a job is free
+	w.pending <- result
+	go func() {
+		result <- w.compress(block)
+	}()
+}
+
+func (w *parallelGzipWriter) compress(block []byte) *compressedBlock {
+	var compressed bytes.Buffer
+	gz, _ := w.pool.Get().(*gzip.Writer)
+	if gz == nil {
+		// The level was validated by newParallelGzipWriter
+		gz, _ = gzip.NewWriterLevel(&compressed, w.level)
+	} else {
+		gz.Reset(&compressed)
+	}
+	defer w.pool.Put(gz)
+
+	_, err := gz.Write(block)
+	if err != nil {
+		return &compressedBlock{err: errors.WithStack(err)}
+	}
+	err = gz.Close()
+	if err != nil {
+		return &compressedBlock{err: errors.WithStack(err)}
+	}
+	return &compressedBlock{data: compressed.Bytes()}
+}
+
+// writeBlocks writes the compressed blocks in order. After an error,
+// the remaining blocks are discarded.
+func (w *parallelGzipWriter) writeBlocks() {
+	defer close(w.done)
+	for result := range w.pending {
+		block := <-result
+		if w.error() != nil {
+			continue
+		}
+		err := block.err
+		if err == nil {
+			_, err = w.out.Write(block.data)
+			err = errors.WithStack(err)
+		}
+		if err != nil {
+			w.errMutex.Lock()
+			w.err = err
+			w.errMutex.Unlock()
+		}
+	}
+}
+
+func (w *parallelGzipWriter) error() error {
+	w.errMutex.Lock()
+	defer w.errMutex.Unlock()
+	return w.err
+}
@@ -0,0 +1,46 @@
+package archive
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"math/rand"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestParallelGzipWriter(t *testing.T) {
+	// Several blocks with a partial last block, written in chunks which
+	// don't align with the blocks
+	data := make([]byte, 3*parallelGzipBlockSize+123)
+	rand.New(rand.NewSource(1)).Read(data[:len(data)/2])
+
+	for _, input := range [][]byte{data, {}} {
+		var compressed bytes.Buffer
+		w, err := newParallelGzipWriter(&compressed, gzip.BestSpeed, 4)
+		require.NoError(t, err)
+		for rest := input; len(rest) > 0; {
+			n := 100_000
+			if n > len(rest) {
+				n = len(rest)
+			}
+			_, err = w.Write(rest[:n])
+			require.NoError(t, err)
+			rest = rest[n:]
+		}
+		require.NoError(t, w.Close())
+
+		r, err := gzip.NewReader(&compressed)
+		require.NoError(t, err)
+		decompressed, err := io.ReadAll(r)
+		require.NoError(t, err)
+		assert.True(t, bytes.Equal(input, decompressed))
+	}
+}
+
+func TestParallelGzipWriter_InvalidLevel(t *testing.T) {
+	_, err := newParallelGzipWriter(io.Discard, 42, 4)
+	require.Error(t, err)
+}
@@ -10,6 +10,7 @@ import (
 	"github.com/pkg/errors"
 
 	"code-intelligence.com/cifuzz/internal/bundler/archive"
+	"code-intelligence.com/cifuzz/internal/bundler/corpuspack"
 	"code-intelligence.com/cifuzz/internal/config"
 	"code-intelligence.com/cifuzz/pkg/log"
 	"code-intelligence.com/cifuzz/pkg/vcs"
@@ -54,7 +55,13 @@ func (b *Bundler) Bundle() error {
 	}
 
 	bufWriter := bufio.NewWriter(bundle)
-	archiveWriter := archive.NewArchiveWriter(bufWriter)
+	archiveWriter, err := archive.NewArchiveWriterWithCompression(bufWriter, &archive.CompressionOptions{
+		Level: b.opts.CompressionLevel,
+		Jobs:  b.opts.CompressionJobs,
+	})
+	if err != nil {
+		return err
+	}
 
 	var fuzzers []*archive.Fuzzer
 
@@ -186,6 +193,54 @@ func (b *Bundler) getCodeRevision() *archive.CodeRevision {
 }
 
 func prepareSeeds(seedCorpusDirs []string, archiveSeedsDir string, archiveWriter *archive.ArchiveWriter) error {
+	for i, targetDir := range seedTargetDirs(seedCorpusDirs, archiveSeedsDir) {
+		// Add the seeds of the seed corpus directory to the target directory
+		err := archiveWriter.WriteDir(targetDir, seedCorpusDirs[i])
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// packSeeds is like prepareSeeds, but adds each seed corpus directory
+// as a single packed corpus file instead of one archive entry per seed.
+func packSeeds(seedCorpusDirs []string, archiveSeedsDir string, tempDir string, archiveWriter *archive.ArchiveWriter) error {
+	for i, targetDir := range seedTargetDirs(seedCorpusDirs, archiveSeedsDir) {
+		err := packSeedCorpus(seedCorpusDirs[i], targetDir+corpuspack.Suffix, tempDir, archiveWriter)
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func packSeedCorpus(sourceDir string, archivePath string, tempDir string, archiveWriter *archive.ArchiveWriter) error {
+	f, err := os.CreateTemp(tempDir, "seeds-*"+corpuspack.Suffix)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer f.Close()
+
+	w := bufio.NewWriter(f)
+	err = corpuspack.WriteDir(w, sourceDir)
+	if err != nil {
+		return err
+	}
+	err = w.Flush()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	err = f.Close()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return archiveWriter.WriteFile(archivePath, f.Name())
+}
+
+// seedTargetDirs returns the directories in the archive to put the
+// seeds of each seed corpus directory into.
+func seedTargetDirs(seedCorpusDirs []string, archiveSeedsDir string) []string {
 	var targetDirs []string
 	for _, sourceDir := range seedCorpusDirs {
 		// Put the seeds into subdirectories of the "seeds" directory
@@ -201,14 +256,8 @@ func prepareSeeds(seedCorpusDirs []string, archiveSeedsDir string, archiveWriter
 			i++
 		}
 		targetDirs = append(targetDirs, targetDir)
-
-		// Add the seeds of the seed corpus directory to the target directory
-		err := archiveWriter.WriteDir(targetDir, sourceDir)
-		if err != nil {
-			return err
-		}
 	}
-	return nil
+	return targetDirs
 }
 
 func parseAdditionalFilesArgument(arg string) (string, string, error) {
@@ -0,0 +1,209 @@
+// Package corpuspack reads and writes packed corpora, which store all
+// inputs of a corpus directory in a single file. Replaying or shipping
+// many small inputs as loose files is dominated by per-file overhead
+// (stat calls, file handles, tar entries), which a packed corpus avoids.
+//
+// The format is understood by the replayer (tools/replayer), which
+// maps the file once and addresses its entries like the files of a
+// directory, e.g. corpus.cifuzzpack/some/input. All integers are 32-bit
+// little endian:
+//
+//	header:   "CIFZPACK", version (1), number of entries, offset of the payloads, reserved (0)
+//	index:    for every entry: offset and size of its payload, offset and size of its name
+//	names:    the names of all entries, not null-terminated
+//	payloads: the contents of all entries, each starting at an offset that is a multiple of 8
+package corpuspack
+
+import (
+	"bytes"
+	"encoding/binary"
+	"io"
+	"io/fs"
+	"math"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+
+	"github.com/pkg/errors"
+)
+
+// Suffix is the file name suffix by which the replayer recognizes
+// packed corpora.
+const Suffix = ".cifuzzpack"
+
+const (
+	version        = 1
+	headerSize     = 24
+	indexEntrySize = 16
+	// Payloads are aligned to the shadow granularity of ASan, which
+	// allows the replayer to poison everything but the current input.
+	payloadAlignment = 8
+)
+
+var magic = []byte("CIFZPACK")
+
+// Entry is a single input of a packed corpus.
+type Entry struct {
+	// Name is the slash-separated path of the input relative to the
+	// corpus directory.
+	Name string
+	Data []byte
+}
+
+type dirEntry struct {
+	name string
+	path string
+	size uint32
+}
+
+// WriteDir writes a packed corpus containing all regular files below
+// dir to w. Like the replayer and libFuzzer, it skips hidden files and
+// directories. Entries are sorted by name, so the output only depends
+// on the contents of dir.
+func WriteDir(w io.Writer, dir string) error {
+	var entries []dirEntry
+	err := filepath.WalkDir(dir, func(path string, d fs.DirEntry, err error) error {
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		if path != dir && strings.HasPrefix(d.Name(), ".") {
+			if d.IsDir() {
+				return filepath.SkipDir
+			}
+			return nil
+		}
+		if d.IsDir() {
+			return nil
+		}
+		// Follow symlinks, as the replayer does.
+		info, err := os.Stat(path)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		if !info.Mode().IsRegular() {
+			return nil
+		}
+		if info.Size() > math.MaxUint32 {
+			return errors.Errorf("input %s is too large to be packed", path)
+		}
+		relPath, err := filepath.Rel(dir, path)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		entries = append(entries, dirEntry{name: filepath.ToSlash(relPath), path: path, size: uint32(info.Size())})
+		return nil
+	})
+	if err != nil {
+		return err
+	}
+	sort.Slice(entries, func(i, j int) bool { return entries[i].name < entries[j].name })
+
+	// Lay out the file before writing it, so that the payloads can be
+	// streamed without holding them in memory.
+	namesOffset := uint64(headerSize + indexEntrySize*len(entries))
+	payloadsOffset := namesOffset
+	for _, e := range entries {
+		payloadsOffset += uint64(len(e.name))
+	}
+	payloadsOffset = align(payloadsOffset)
+	index := make([]uint32, 0, 4*len(entries))
+	nameOffset, payloadOffset := namesOffset, payloadsOffset
+	for _, e := range entries {
+		index = append(index, uint32(payloadOffset), e.size, uint32(nameOffset), uint32(len(e.name)))
+		nameOffset += uint64(len(e.name))
+		payloadOffset = align(payloadOffset + uint64(e.size))
+	}
+	if payloadOffset > math.MaxUint32 {
+		return errors.Errorf("corpus %s is too large to be packed", dir)
+	}
+
+	var buf bytes.Buffer
+	buf.Write(magic)
+	header := []uint32{version, uint32(len(entries)), uint32(payloadsOffset), 0}
+	_ = binary.Write(&buf, binary.LittleEndian, header)
+	_ = binary.Write(&buf, binary.LittleEndian, index)
+	for _, e := range entries {
+		buf.WriteString(e.name)
+	}
+	buf.Write(make([]byte, payloadsOffset-uint64(buf.Len())))
+	_, err = w.Write(buf.Bytes())
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	offset := payloadsOffset
+	for _, e := range entries {
+		err = writePayload(w, e)
+		if err != nil {
+			return err
+		}
+		offset += uint64(e.size)
+		_, err = w.Write(make([]byte, align(offset)-offset))
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		offset = align(offset)
+	}
+	return nil
+}
+
+func writePayload(w io.Writer, e dirEntry) error {
+	f, err := os.Open(e.path)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer f.Close()
+
+	// Copy exactly the size that was used for the layout, so that a
+	// file that changes while it's being packed can't corrupt the
+	// offsets of the other entries.
+	n, err := io.CopyN(w, f, int64(e.size))
+	if err != nil {
+		return errors.Wrapf(err, "failed to pack %s (copied %d of %d bytes)", e.path, n, e.size)
+	}
+	return nil
+}
+
+// Read parses a packed corpus. The data of the returned entries refers
+// to data.
+func Read(data []byte) ([]Entry, error) {
+	if len(data) < headerSize || !bytes.Equal(data[:len(magic)], magic) {
+		return nil, errors.New("not a packed corpus")
+	}
+	le := binary.LittleEndian
+	if v := le.Uint32(data[8:]); v != version {
+		return nil, errors.Errorf("unsupported packed corpus version %d", v)
+	}
+	numEntries := uint64(le.Uint32(data[12:]))
+	payloadsOffset := uint64(le.Uint32(data[16:]))
+	size := uint64(len(data))
+	indexEnd := headerSize + indexEntrySize*numEntries
+	if indexEnd > size || payloadsOffset < indexEnd || payloadsOffset > size {
+		return nil, errors.New("invalid packed corpus index")
+	}
+
+	entries := make([]Entry, 0, numEntries)
+	for i := uint64(0); i < numEntries; i++ {
+		p := data[headerSize+indexEntrySize*i:]
+		payloadOffset := uint64(le.Uint32(p))
+		payloadSize := uint64(le.Uint32(p[4:]))
+		nameOffset := uint64(le.Uint32(p[8:]))
+		nameSize := uint64(le.Uint32(p[12:]))
+		if nameOffset < indexEnd || nameSize == 0 || nameOffset+nameSize > payloadsOffset {
+			return nil, errors.Errorf("invalid name of packed corpus entry %d", i)
+		}
+		if payloadOffset < payloadsOffset || payloadOffset%payloadAlignment != 0 || payloadOffset+payloadSize > size {
+			return nil, errors.Errorf("invalid payload of packed corpus entry %d", i)
+		}
+		entries = append(entries, Entry{
+			Name: string(data[nameOffset : nameOffset+nameSize]),
+			Data: data[payloadOffset : payloadOffset+payloadSize],
+		})
+	}
+	return entries, nil
+}
+
+func align(offset uint64) uint64 {
+	return (offset + payloadAlignment - 1) / payloadAlignment * payloadAlignment
+}
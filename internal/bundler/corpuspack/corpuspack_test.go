@@ -0,0 +1,63 @@
+package corpuspack
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestWriteDir(t *testing.T) {
+	dir := t.TempDir()
+	files := map[string]string{
+		"b":                        "seed b",
+		"a":                        "",
+		filepath.Join("sub", "c"):  "seed c with more than eight bytes",
+		".hidden":                  "skipped",
+		filepath.Join(".git", "d"): "skipped",
+	}
+	for name, content := range files {
+		err := os.MkdirAll(filepath.Dir(filepath.Join(dir, name)), 0755)
+		require.NoError(t, err)
+		err = os.WriteFile(filepath.Join(dir, name), []byte(content), 0644)
+		require.NoError(t, err)
+	}
+
+	var buf bytes.Buffer
+	err := WriteDir(&buf, dir)
+	require.NoError(t, err)
+
+	entries, err := Read(buf.Bytes())
+	require.NoError(t, err)
+	require.Len(t, entries, 3)
+	assert.Equal(t, "a", entries[0].Name)
+	assert.Empty(t, entries[0].Data)
+	assert.Equal(t, "b", entries[1].Name)
+	assert.Equal(t, "seed b", string(entries[1].Data))
+	assert.Equal(t, "sub/c", entries[2].Name)
+	assert.Equal(t, "seed c with more than eight bytes", string(entries[2].Data))
+
+	// The output only depends on the contents of the directory.
+	var buf2 bytes.Buffer
+	err = WriteDir(&buf2, dir)
+	require.NoError(t, err)
+	assert.Equal(t, buf.Bytes(), buf2.Bytes())
+}
+
+func TestRead_Invalid(t *testing.T) {
+	dir := t.TempDir()
+	err := os.WriteFile(filepath.Join(dir, "seed"), []byte("seed"), 0644)
+	require.NoError(t, err)
+	var buf bytes.Buffer
+	err = WriteDir(&buf, dir)
+	require.NoError(t, err)
+	data := buf.Bytes()
+
+	_, err = Read(data[:len(data)-8])
+	assert.Error(t, err)
+	_, err = Read([]byte("not a packed corpus at all"))
+	assert.Error(t, err)
+}
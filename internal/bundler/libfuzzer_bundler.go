@@ -10,11 +10,13 @@ import (
 	"runtime"
 	"sort"
 	"strings"
+	"sync"
 
 	"github.com/otiai10/copy"
 	"github.com/pkg/errors"
 	"github.com/spf13/viper"
 	"golang.org/x/exp/maps"
+	"golang.org/x/sync/errgroup"
 
 	"code-intelligence.com/cifuzz/internal/build"
 	"code-intelligence.com/cifuzz/internal/build/bazel"
@@ -32,6 +34,12 @@ import (
 
 type configureVariant struct {
 	Sanitizers []string
+	// The build profile, see cmake.BuilderOptions
+	Profile string
+	// Whether to build with ThinLTO, see cmake.BuilderOptions
+	ThinLTO bool
+	// The profile to optimize with, see cmake.BuilderOptions
+	PGOProfile string
 }
 
 // System library dependencies that are so common that we shouldn't emit a warning for them - they will be contained in
@@ -99,6 +107,13 @@ func (b *libfuzzerBundler) buildAllVariants() ([]*build.Result, error) {
 	fuzzingVariant := configureVariant{
 		// TODO: Do not hardcode these values.
 		Sanitizers: []string{"address"},
+		// Fuzzing runs benefit from a higher throughput, coverage
+		// builds always use the default profile.
+		Profile: b.opts.BuildProfile,
+		ThinLTO: b.opts.ThinLTO,
+		// The coverage builds have to match the source, so only the
+		// fuzzing build is optimized with the profile.
+		PGOProfile: b.opts.PGOProfile,
 	}
 	// UBSan is not supported by MSVb.
 	// TODO: Not needed anymore when sanitizers are configurable,
@@ -169,63 +184,116 @@ func (b *libfuzzerBundler) buildAllVariantsBazel(configureVariants []configureVa
 	return allResults, nil
 }
 
+// buildAllVariantsCMake builds the variants concurrently, each in its
+// own build directory. The builds are mostly serial while linking, so
+// this is faster than building them one after the other even if each
+// of them uses all cores while compiling.
 func (b *libfuzzerBundler) buildAllVariantsCMake(configureVariants []configureVariant) ([]*build.Result, error) {
-	var allResults []*build.Result
-	for i, variant := range configureVariants {
-		builder, err := cmake.NewBuilder(&cmake.BuilderOptions{
-			ProjectDir: b.opts.ProjectDir,
-			Args:       b.opts.BuildSystemArgs,
-			Sanitizers: variant.Sanitizers,
-			Parallel: cmake.ParallelOptions{
-				Enabled: viper.IsSet("build-jobs"),
-				NumJobs: b.opts.NumBuildJobs,
-			},
-			Stdout:          b.opts.BuildStdout,
-			Stderr:          b.opts.BuildStderr,
-			FindRuntimeDeps: true,
-		})
-		if err != nil {
-			return nil, err
+	// The number of build jobs is shared by the variant builds
+	numJobs := b.opts.NumBuildJobs
+	if numJobs != 0 {
+		numJobs /= uint(len(configureVariants))
+		if numJobs == 0 {
+			numJobs = 1
 		}
+	}
 
-		b.printBuildingMsg(variant, i)
-
-		err = builder.Configure()
-		if err != nil {
-			return nil, err
+	// Prefix the output of each build with its variant, unless there
+	// is only one
+	var outputMutex sync.Mutex
+	results := make([][]*build.Result, len(configureVariants))
+	routines := errgroup.Group{}
+	for i, variant := range configureVariants {
+		i, variant := i, variant
+		stdout, stderr := b.opts.BuildStdout, b.opts.BuildStderr
+		var writers []*prefixWriter
+		if len(configureVariants) > 1 {
+			prefix := fmt.Sprintf("[%s] ", variantDisplayString(variant))
+			stdoutWriter := newPrefixWriter(stdout, prefix, &outputMutex)
+			stderrWriter := newPrefixWriter(stderr, prefix, &outputMutex)
+			writers = append(writers, stdoutWriter, stderrWriter)
+			stdout, stderr = stdoutWriter, stderrWriter
 		}
 
-		var fuzzTests []string
-		if len(b.opts.FuzzTests) == 0 {
-			fuzzTests, err = builder.ListFuzzTests()
-			if err != nil {
-				return nil, err
+		routines.Go(func() error {
+			var err error
+			results[i], err = b.buildVariantCMake(variant, numJobs, stdout, stderr)
+			for _, w := range writers {
+				if flushErr := w.Flush(); flushErr != nil {
+					log.Debugf("Failed to write the build output: %v", flushErr)
+				}
 			}
-		} else {
-			fuzzTests = b.opts.FuzzTests
-		}
+			return err
+		})
+	}
+	err := routines.Wait()
+	if err != nil {
+		return nil, err
+	}
+
+	var allResults []*build.Result
+	for _, variantResults := range results {
+		allResults = append(allResults, variantResults...)
+	}
+	return allResults, nil
+}
 
-		// The fuzz tests passed to builder.Build must not contain
-		// duplicates, which is ensured by builder.ListFuzzTests()
-		// and the Opts.Validate() function.
-		results, err := builder.Build(fuzzTests)
+func (b *libfuzzerBundler) buildVariantCMake(variant configureVariant, numJobs uint, stdout, stderr io.Writer) ([]*build.Result, error) {
+	builder, err := cmake.NewBuilder(&cmake.BuilderOptions{
+		ProjectDir: b.opts.ProjectDir,
+		Args:       b.opts.BuildSystemArgs,
+		Sanitizers: variant.Sanitizers,
+		Parallel: cmake.ParallelOptions{
+			Enabled: viper.IsSet("build-jobs"),
+			NumJobs: numJobs,
+		},
+		Stdout:          stdout,
+		Stderr:          stderr,
+		FindRuntimeDeps: true,
+		Profile:         variant.Profile,
+		ThinLTO:         variant.ThinLTO,
+		PGOProfile:      variant.PGOProfile,
+
+		CompilerLauncher:   b.opts.CompilerLauncher,
+		CoverageSourceDirs: b.opts.CoverageSourceDirs,
+		FuzzingFocusDirs:   b.opts.FuzzingFocusDirs,
+		FuzzingIgnoreDirs:  b.opts.FuzzingIgnoreDirs,
+	})
+	if err != nil {
+		return nil, err
+	}
+
+	log.Infof("Building for %s...", variantDisplayString(variant))
+
+	err = builder.Configure()
+	if err != nil {
+		return nil, err
+	}
+
+	var fuzzTests []string
+	if len(b.opts.FuzzTests) == 0 {
+		fuzzTests, err = builder.ListFuzzTests()
 		if err != nil {
 			return nil, err
 		}
-		allResults = append(allResults, results...)
+	} else {
+		fuzzTests = b.opts.FuzzTests
 	}
 
-	return allResults, nil
+	// The fuzz tests passed to builder.Build must not contain
+	// duplicates, which is ensured by builder.ListFuzzTests()
+	// and the Opts.Validate() function.
+	return builder.Build(fuzzTests)
 }
 
-func (b *libfuzzerBundler) printBuildingMsg(variant configureVariant, i int) {
-	var typeDisplayString string
+func variantDisplayString(variant configureVariant) string {
 	if isCoverageBuild(variant.Sanitizers) {
-		typeDisplayString = "coverage"
-	} else {
-		typeDisplayString = "fuzzing"
+		return "coverage"
 	}
+	return "fuzzing"
+}
 
+func (b *libfuzzerBundler) printBuildingMsg(variant configureVariant, i int) {
 	// Print a newline to separate the build logs unless this is the
 
 	// first variant build
@@ -233,7 +301,7 @@ func (b *libfuzzerBundler) printBuildingMsg(variant configureVariant, i int) {
 		log.Print()
 	}
 
-	log.Infof("Building for %s...", typeDisplayString)
+	log.Infof("Building for %s...", variantDisplayString(variant))
 }
 
 func (b *libfuzzerBundler) buildAllVariantsOther(configureVariants []configureVariant) ([]*build.Result, error) {
@@ -419,6 +487,21 @@ func (b *libfuzzerBundler) assembleArtifacts(buildResult *build.Result) (
 		}
 	}
 
+	// With split DWARF, the debug information of the fuzz test is packaged from the .dwo files in the build directory
+	// into a .dwp file next to it (see add_fuzz_test), in which llvm-symbolizer looks it up.
+	fuzzTestDwpAbsPath := fuzzTestExecutableAbsPath + ".dwp"
+	dwpExists, err := fileutil.Exists(fuzzTestDwpAbsPath)
+	if err != nil {
+		err = errors.WithStack(err)
+		return
+	}
+	if dwpExists {
+		err = b.archiveWriter.WriteFile(fuzzTestArchivePath+".dwp", fuzzTestDwpAbsPath)
+		if err != nil {
+			return
+		}
+	}
+
 	var libraryPaths []string
 	// Add the runtime dependencies of the fuzz test executable.
 	externalLibrariesPrefix := ""
@@ -532,7 +615,11 @@ depsLoop:
 	if len(seedCorpusDirs) > 0 {
 		archiveSeedsDir = filepath.Join(fuzzTestPrefix(buildResult), "seeds")
 
-		err = prepareSeeds(seedCorpusDirs, archiveSeedsDir, b.archiveWriter)
+		if b.opts.PackSeedCorpus {
+			err = packSeeds(seedCorpusDirs, archiveSeedsDir, b.opts.tempDir, b.archiveWriter)
+		} else {
+			err = prepareSeeds(seedCorpusDirs, archiveSeedsDir, b.archiveWriter)
+		}
 		if err != nil {
 			return
 		}
@@ -544,6 +631,13 @@ depsLoop:
 	if err != nil {
 		return
 	}
+	// Select the fuzz test in an executable containing several ones
+	if buildResult.RegisteredTest != "" {
+		env, err = envutil.Setenv(env, "CIFUZZ_TEST", buildResult.RegisteredTest)
+		if err != nil {
+			return
+		}
+	}
 
 	baseFuzzerInfo := archive.Fuzzer{
 		Target:     buildResult.Name,
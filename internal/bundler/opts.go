@@ -4,6 +4,7 @@ import (
 	"fmt"
 	"io"
 	"os"
+	"path/filepath"
 	"strings"
 	"time"
 
@@ -16,21 +17,32 @@ import (
 )
 
 type Opts struct {
-	Branch          string        `mapstructure:"branch"`
-	BuildCommand    string        `mapstructure:"build-command"`
-	CleanCommand    string        `mapstructure:"clean-command"`
-	BuildSystem     string        `mapstructure:"build-system"`
-	NumBuildJobs    uint          `mapstructure:"build-jobs"`
-	Commit          string        `mapstructure:"commit"`
-	Dictionary      string        `mapstructure:"dict"`
-	DockerImage     string        `mapstructure:"docker-image"`
-	EngineArgs      []string      `mapstructure:"engine-args"`
-	Env             []string      `mapstructure:"env"`
-	SeedCorpusDirs  []string      `mapstructure:"seed-corpus-dirs"`
-	Timeout         time.Duration `mapstructure:"timeout"`
-	ProjectDir      string        `mapstructure:"project-dir"`
-	ConfigDir       string        `mapstructure:"config-dir"`
-	AdditionalFiles []string      `mapstructure:"add"`
+	Branch           string        `mapstructure:"branch"`
+	BuildCommand     string        `mapstructure:"build-command"`
+	CleanCommand     string        `mapstructure:"clean-command"`
+	BuildSystem      string        `mapstructure:"build-system"`
+	NumBuildJobs     uint          `mapstructure:"build-jobs"`
+	BuildProfile     string        `mapstructure:"build-profile"`
+	ThinLTO          bool          `mapstructure:"thinlto"`
+	CompilerLauncher string        `mapstructure:"compiler-launcher"`
+	PGOProfile       string        `mapstructure:"pgo-profile"`
+	Commit           string        `mapstructure:"commit"`
+	Dictionary       string        `mapstructure:"dict"`
+	DockerImage      string        `mapstructure:"docker-image"`
+	EngineArgs       []string      `mapstructure:"engine-args"`
+	Env              []string      `mapstructure:"env"`
+	SeedCorpusDirs   []string      `mapstructure:"seed-corpus-dirs"`
+	PackSeedCorpus   bool          `mapstructure:"pack-seed-corpus"`
+	CompressionLevel int           `mapstructure:"compression-level"`
+	CompressionJobs  uint          `mapstructure:"compression-jobs"`
+	Timeout          time.Duration `mapstructure:"timeout"`
+	ProjectDir       string        `mapstructure:"project-dir"`
+	ConfigDir        string        `mapstructure:"config-dir"`
+	AdditionalFiles  []string      `mapstructure:"add"`
+	// See cmake.BuilderOptions
+	CoverageSourceDirs []string `mapstructure:"coverage-source-dirs"`
+	FuzzingFocusDirs   []string `mapstructure:"fuzzing-focus-dirs"`
+	FuzzingIgnoreDirs  []string `mapstructure:"fuzzing-ignore-dirs"`
 
 	// Fields which are not configurable via viper (i.e. via cifuzz.yaml
 	// and CIFUZZ_* environment variables), by setting
@@ -54,6 +66,28 @@ func (opts *Opts) Validate() error {
 	// Ensure that the fuzz tests contain no duplicates
 	opts.FuzzTests = sliceutil.RemoveDuplicates(opts.FuzzTests)
 
+	if opts.BuildProfile != "" {
+		err = cmdutils.ValidateBuildProfile(opts.BuildProfile)
+		if err != nil {
+			return err
+		}
+	}
+
+	if opts.PGOProfile != "" {
+		// CMake is invoked in the build directory, so the profile has
+		// to be referenced by an absolute path
+		opts.PGOProfile, err = filepath.Abs(opts.PGOProfile)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		_, err = os.Stat(opts.PGOProfile)
+		if err != nil {
+			err = errors.WithStack(err)
+			log.Error(err, err.Error())
+			return cmdutils.ErrSilent
+		}
+	}
+
 	opts.SeedCorpusDirs, err = cmdutils.ValidateSeedCorpusDirs(opts.SeedCorpusDirs)
 	if err != nil {
 		log.Error(err, err.Error())
@@ -108,6 +142,11 @@ system type "other"`
 		}
 	}
 
+	if opts.CompressionLevel < 0 || opts.CompressionLevel > 9 {
+		msg := fmt.Sprintf("invalid argument %d for \"--compression-level\" flag: level must be between 1 and 9", opts.CompressionLevel)
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+
 	if opts.Timeout != 0 && opts.Timeout < time.Second {
 		msg := fmt.Sprintf("invalid argument %q for \"--timeout\" flag: timeout can't be less than a second", opts.Timeout)
 		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
@@ -0,0 +1,64 @@
+package bundler
+
+import (
+	"bytes"
+	"io"
+	"sync"
+
+	"github.com/pkg/errors"
+)
+
+// prefixWriter prefixes each line written to it, so that the output of
+// builds which run concurrently can be told apart. Only complete lines
+// are written to the underlying writer, under a mutex which is shared
+// by all prefix writers of the same output, so that lines of different
+// builds are not interleaved.
+type prefixWriter struct {
+	out    io.Writer
+	prefix []byte
+	mutex  *sync.Mutex
+	buf    []byte
+}
+
+func newPrefixWriter(out io.Writer, prefix string, mutex *sync.Mutex) *prefixWriter {
+	return &prefixWriter{out: out, prefix: []byte(prefix), mutex: mutex}
+}
+
+func (w *prefixWriter) Write(p []byte) (int, error) {
+	w.buf = append(w.buf, p...)
+	end := bytes.LastIndexByte(w.buf, '\n')
+	if end == -1 {
+		return len(p), nil
+	}
+	err := w.writeLines(w.buf[:end+1])
+	w.buf = w.buf[end+1:]
+	if err != nil {
+		return 0, err
+	}
+	return len(p), nil
+}
+
+// Flush writes the last line if it doesn't end with a newline
+func (w *prefixWriter) Flush() error {
+	if len(w.buf) == 0 {
+		return nil
+	}
+	err := w.writeLines(append(w.buf, '\n'))
+	w.buf = nil
+	return err
+}
+
+func (w *prefixWriter) writeLines(lines []byte) error {
+	var out []byte
+	for len(lines) > 0 {
+		i := bytes.IndexByte(lines, '\n')
+		out = append(out, w.prefix...)
+		out = append(out, lines[:i+1]...)
+		lines = lines[i+1:]
+	}
+
+	w.mutex.Lock()
+	defer w.mutex.Unlock()
+	_, err := w.out.Write(out)
+	return errors.WithStack(err)
+}
@@ -0,0 +1,31 @@
+package bundler
+
+import (
+	"bytes"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestPrefixWriter(t *testing.T) {
+	var out bytes.Buffer
+	var mutex sync.Mutex
+	fuzzing := newPrefixWriter(&out, "[fuzzing] ", &mutex)
+	coverage := newPrefixWriter(&out, "[coverage] ", &mutex)
+
+	_, err := fuzzing.Write([]byte("Scanning dependencies\n[ 50%] Build"))
+	require.NoError(t, err)
+	_, err = coverage.Write([]byte("Scanning dependencies\n"))
+	require.NoError(t, err)
+	_, err = fuzzing.Write([]byte("ing CXX object\nLinking"))
+	require.NoError(t, err)
+	require.NoError(t, fuzzing.Flush())
+	require.NoError(t, coverage.Flush())
+
+	assert.Equal(t, "[fuzzing] Scanning dependencies\n"+
+		"[coverage] Scanning dependencies\n"+
+		"[fuzzing] [ 50%] Building CXX object\n"+
+		"[fuzzing] Linking\n", out.String())
+}
@@ -232,13 +232,20 @@ https://github.com/CodeIntelligenceTesting/cifuzz/issues`, opts.BuildSystem, sys
 		cmdutils.AddBuildCommandFlag,
 		cmdutils.AddCleanCommandFlag,
 		cmdutils.AddBuildJobsFlag,
+		cmdutils.AddBuildProfileFlag,
 		cmdutils.AddCommitFlag,
+		cmdutils.AddCompilerLauncherFlag,
+		cmdutils.AddCompressionJobsFlag,
+		cmdutils.AddCompressionLevelFlag,
 		cmdutils.AddDictFlag,
 		cmdutils.AddDockerImageFlag,
 		cmdutils.AddEngineArgFlag,
 		cmdutils.AddEnvFlag,
+		cmdutils.AddPackSeedCorpusFlag,
+		cmdutils.AddPGOProfileFlag,
 		cmdutils.AddProjectDirFlag,
 		cmdutils.AddSeedCorpusFlag,
+		cmdutils.AddThinLTOFlag,
 		cmdutils.AddTimeoutFlag,
 		cmdutils.AddResolveSourceFileFlag,
 	)
@@ -111,12 +111,14 @@ func (cov *CoverageGenerator) GenerateCoverageReport() (string, error) {
 
 	log.Debugf("Parsing lcov report %s", reportPath)
 
-	lcovReportContent, err := os.ReadFile(reportPath)
+	// The report contains the line records of all source files, so it
+	// can be huge and is parsed without reading it into memory
+	reportFile, err := os.Open(reportPath)
 	if err != nil {
 		return "", errors.WithStack(err)
 	}
-	reportReader := strings.NewReader(string(lcovReportContent))
-	summary.ParseLcov(reportReader).PrintTable(cov.Stderr)
+	summary.ParseLcov(reportFile).PrintTable(cov.Stderr)
+	reportFile.Close()
 
 	commonFlags, err := cov.getBazelCommandFlags()
 	if err != nil {
@@ -136,13 +138,9 @@ func (cov *CoverageGenerator) GenerateCoverageReport() (string, error) {
 		// to 0o644 before umask - copy.Copy just copies the permissions
 		// from the source file, which has permissions 555 like all
 		// files created by bazel.
-		content, err := os.ReadFile(reportPath)
+		err = copyReport(reportPath, cov.OutputPath)
 		if err != nil {
-			return "", errors.WithStack(err)
-		}
-		err = os.WriteFile(cov.OutputPath, content, 0o644)
-		if err != nil {
-			return "", errors.WithStack(err)
+			return "", err
 		}
 		return cov.OutputPath, nil
 	}
@@ -215,3 +213,22 @@ func (cov *CoverageGenerator) getBazelCommandFlags() ([]string, error) {
 
 	return flags, nil
 }
+
+func copyReport(src, dst string) error {
+	in, err := os.Open(src)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer in.Close()
+
+	out, err := os.OpenFile(dst, os.O_WRONLY|os.O_CREATE|os.O_TRUNC, 0o644)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	_, err = io.Copy(out, in)
+	if err != nil {
+		out.Close()
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(out.Close())
+}
@@ -41,13 +41,16 @@ type coverageOptions struct {
 	BuildCommand          string   `mapstructure:"build-command"`
 	CleanCommand          string   `mapstructure:"clean-command"`
 	NumBuildJobs          uint     `mapstructure:"build-jobs"`
+	NumJobs               uint     `mapstructure:"jobs"`
 	SeedCorpusDirs        []string `mapstructure:"seed-corpus-dirs"`
 	UseSandbox            bool     `mapstructure:"use-sandbox"`
 	Preset                string
 	ResolveSourceFilePath bool
 	ProjectDir            string
+	// See cmake.BuilderOptions
+	CoverageSourceDirs []string `mapstructure:"coverage-source-dirs"`
 
-	fuzzTest   string
+	fuzzTests  []string
 	argsToPass []string
 
 	buildStdout io.Writer
@@ -87,6 +90,12 @@ func (opts *coverageOptions) validate() error {
 		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
 	}
 
+	if len(opts.fuzzTests) > 1 && opts.BuildSystem != config.BuildSystemCMake && opts.BuildSystem != config.BuildSystemOther {
+		msg := fmt.Sprintf("Multiple <fuzz test> arguments are only supported with CMake and the build system type 'other', got %d",
+			len(opts.fuzzTests))
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+
 	return nil
 }
 
@@ -100,7 +109,7 @@ func New() *cobra.Command {
 	var bindFlags func()
 
 	cmd := &cobra.Command{
-		Use:   "coverage [flags] <fuzz test>",
+		Use:   "coverage [flags] <fuzz test>...",
 		Short: "Generate coverage report for fuzz test",
 		Long: `This command generates a coverage report for a fuzz test.
 
@@ -109,10 +118,17 @@ addition to optional input directories specified with the seed-corpus flag.
 More details about the build system specific inputs directory location
 can be found in the help message of the run command.
 
+With CMake and the build system type "other", multiple fuzz tests can be
+specified. They are built together, replayed concurrently (see the jobs
+flag) and covered by a single report.
+
 Additional arguments for CMake and Bazel can be passed after a "--".
 
 The output can be displayed in the browser or written as a HTML
-or a lcov trace file.
+or a lcov trace file. CMake and other build systems can also write
+the indexed profile of the replay, or an impact map listing the
+source files covered by each input, with which the replayer only
+runs the inputs affected by a change (see docs/Regression-Testing.md).
 
 ` + pterm.Style{pterm.Reset, pterm.Bold}.Sprint("Browser") + `
     cifuzz coverage <fuzz test>
@@ -125,6 +141,12 @@ or a lcov trace file.
 
 ` + pterm.Style{pterm.Reset, pterm.Bold}.Sprint("XML (Jacoco Report)") + `
     cifuzz coverage --format=jacocoxml <fuzz test>
+
+` + pterm.Style{pterm.Reset, pterm.Bold}.Sprint("Profile for PGO (see cifuzz bundle --pgo-profile)") + `
+    cifuzz coverage --format=profdata <fuzz test>
+
+` + pterm.Style{pterm.Reset, pterm.Bold}.Sprint("Impact map for the replayer") + `
+    cifuzz coverage --format=impact-map <fuzz test>
 `,
 		ValidArgsFunction: completion.ValidFuzzTests,
 		PreRunE: func(cmd *cobra.Command, args []string) error {
@@ -134,6 +156,7 @@ or a lcov trace file.
 			bindFlags()
 			cmdutils.ViperMustBindPFlag("format", cmd.Flags().Lookup("format"))
 			cmdutils.ViperMustBindPFlag("output", cmd.Flags().Lookup("output"))
+			cmdutils.ViperMustBindPFlag("jobs", cmd.Flags().Lookup("jobs"))
 
 			var lenFuzzTestArgs int
 			var argsToPass []string
@@ -144,8 +167,12 @@ or a lcov trace file.
 			} else {
 				lenFuzzTestArgs = len(args)
 			}
-			if lenFuzzTestArgs != 1 {
-				msg := fmt.Sprintf("Exactly one <fuzz test> argument must be provided, got %d", lenFuzzTestArgs)
+			if lenFuzzTestArgs == 0 {
+				msg := "At least one <fuzz test> argument must be provided"
+				return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+			}
+			if lenFuzzTestArgs > 1 && opts.ResolveSourceFilePath {
+				msg := fmt.Sprintf("Exactly one <fuzz test> argument must be provided with --resolve, got %d", lenFuzzTestArgs)
 				return cmdutils.WrapIncorrectUsageError(errors.New(msg))
 			}
 
@@ -155,18 +182,18 @@ or a lcov trace file.
 				return cmdutils.WrapSilentError(err)
 			}
 
-			fuzzTest, err := resolve.FuzzTestArgument(opts.ResolveSourceFilePath, args, opts.BuildSystem, opts.ProjectDir)
+			fuzzTests, err := resolve.FuzzTestArgument(opts.ResolveSourceFilePath, args, opts.BuildSystem, opts.ProjectDir)
 			if err != nil {
 				log.Error(err)
 				return cmdutils.WrapSilentError(err)
 			}
-			opts.fuzzTest = fuzzTest[0]
+			opts.fuzzTests = fuzzTests
 			opts.argsToPass = argsToPass
 
 			opts.buildStdout = cmd.OutOrStdout()
 			opts.buildStderr = cmd.OutOrStderr()
 			if cmdutils.ShouldLogBuildToFile() {
-				opts.buildStdout, err = cmdutils.BuildOutputToFile(opts.ProjectDir, []string{opts.fuzzTest})
+				opts.buildStdout, err = cmdutils.BuildOutputToFile(opts.ProjectDir, opts.fuzzTests)
 				if err != nil {
 					log.Errorf(err, "Failed to setup logging: %v", err.Error())
 					return cmdutils.WrapSilentError(err)
@@ -199,8 +226,10 @@ or a lcov trace file.
 	if err != nil {
 		panic(err)
 	}
-	cmd.Flags().StringP("format", "f", "html", "Output format of the coverage report (html/lcov).")
+	cmd.Flags().StringP("format", "f", "html", "Output format of the coverage report (html/lcov/profdata/impact-map).")
 	cmd.Flags().StringP("output", "o", "", "Output path of the coverage report.")
+	cmd.Flags().Uint("jobs", 0, "Maximum number of fuzz tests to replay concurrently (CMake and other only).\n"+
+		"Defaults to the number of CPUs.")
 	err = cmd.RegisterFlagCompletionFunc("format", completion.ValidCoverageOutputFormat)
 	if err != nil {
 		panic(err)
@@ -219,7 +248,7 @@ func (c *coverageCmd) run() error {
 		log.CreateCurrentProgressSpinner(nil, log.BuildInProgressMsg)
 	}
 
-	log.Infof("Building %s", pterm.Style{pterm.Reset, pterm.FgLightBlue}.Sprint(c.opts.fuzzTest))
+	log.Infof("Building %s", pterm.Style{pterm.Reset, pterm.FgLightBlue}.Sprint(strings.Join(c.opts.fuzzTests, ", ")))
 
 	if c.opts.Preset == "vscode" {
 		var format string
@@ -248,7 +277,7 @@ func (c *coverageCmd) run() error {
 	switch c.opts.BuildSystem {
 	case config.BuildSystemBazel:
 		gen = &bazelCoverage.CoverageGenerator{
-			FuzzTest:        c.opts.fuzzTest,
+			FuzzTest:        c.opts.fuzzTests[0],
 			OutputFormat:    c.opts.OutputFormat,
 			OutputPath:      c.opts.OutputPath,
 			BuildSystemArgs: c.opts.argsToPass,
@@ -279,11 +308,14 @@ func (c *coverageCmd) run() error {
 			NumBuildJobs:    c.opts.NumBuildJobs,
 			SeedCorpusDirs:  c.opts.SeedCorpusDirs,
 			UseSandbox:      c.opts.UseSandbox,
-			FuzzTest:        c.opts.fuzzTest,
+			FuzzTests:       c.opts.fuzzTests,
+			NumJobs:         c.opts.NumJobs,
 			ProjectDir:      c.opts.ProjectDir,
 			Stderr:          c.OutOrStderr(),
 			BuildStdout:     c.opts.buildStdout,
 			BuildStderr:     c.opts.buildStderr,
+			// Only used by CMake builds
+			CoverageSourceDirs: c.opts.CoverageSourceDirs,
 		}
 	case config.BuildSystemGradle:
 		if len(c.opts.argsToPass) > 0 {
@@ -293,7 +325,7 @@ func (c *coverageCmd) run() error {
 
 		gen = &gradleCoverage.CoverageGenerator{
 			OutputPath: c.opts.OutputPath,
-			FuzzTest:   c.opts.fuzzTest,
+			FuzzTest:   c.opts.fuzzTests[0],
 			ProjectDir: c.opts.ProjectDir,
 			Parallel: gradle.ParallelOptions{
 				Enabled: viper.IsSet("build-jobs"),
@@ -310,7 +342,7 @@ func (c *coverageCmd) run() error {
 
 		gen = &mavenCoverage.CoverageGenerator{
 			OutputPath: c.opts.OutputPath,
-			FuzzTest:   c.opts.fuzzTest,
+			FuzzTest:   c.opts.fuzzTests[0],
 			ProjectDir: c.opts.ProjectDir,
 			Parallel: maven.ParallelOptions{
 				Enabled: viper.IsSet("build-jobs"),
@@ -364,6 +396,12 @@ func (c *coverageCmd) run() error {
 	case coverage.FormatJacocoXML:
 		log.Successf("Created jacoco.xml coverage report: %s", reportPath)
 		return nil
+	case coverage.FormatProfdata:
+		log.Successf("Created coverage profile: %s", reportPath)
+		return nil
+	case coverage.FormatImpactMap:
+		log.Successf("Created impact map: %s", reportPath)
+		return nil
 	default:
 		return errors.Errorf("Unsupported output format")
 	}
@@ -0,0 +1,155 @@
+package llvm
+
+import (
+	"crypto/sha256"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/config"
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// The exports of llvm-cov are cached because they take minutes for
+// large binaries, while re-running the coverage command without
+// changes or requesting the report in another format is common. Only
+// the most recently used exports are kept.
+const maxCachedExports = 8
+
+// exportCacheDir returns the directory in which the exports of
+// llvm-cov are cached.
+func (cov *CoverageGenerator) exportCacheDir() string {
+	if cov.BuildSystem == config.BuildSystemCMake {
+		return filepath.Join(cov.runs[0].buildResult.BuildDir, "coverage-export-cache")
+	}
+	// The build directory of other build systems is the project
+	// directory, so use the directory of the CMake builds instead.
+	return filepath.Join(cov.ProjectDir, ".cifuzz-build", "coverage-export-cache")
+}
+
+// exportCacheKey identifies the output of an llvm-cov invocation by
+// its arguments and the contents of the indexed profile and the
+// objects it processes, whose paths differ between runs.
+func exportCacheKey(llvmCov string, args []string, indexedProfile string, objects []string) (string, error) {
+	h := sha256.New()
+	for _, arg := range append([]string{llvmCov}, args...) {
+		// Terminate every argument so that different splits of the
+		// same string don't collide.
+		_, _ = fmt.Fprintf(h, "%s\x00", arg)
+	}
+	for _, path := range append([]string{indexedProfile}, objects...) {
+		err := hashFile(h, path)
+		if err != nil {
+			return "", err
+		}
+	}
+	return fmt.Sprintf("%x", h.Sum(nil)), nil
+}
+
+func hashFile(w io.Writer, path string) error {
+	f, err := os.Open(path)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer f.Close()
+
+	fileHash := sha256.New()
+	_, err = io.Copy(fileHash, f)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	_, _ = w.Write(fileHash.Sum(nil))
+	return nil
+}
+
+// readCachedExport returns the cached output for key, if any.
+func (cov *CoverageGenerator) readCachedExport(key string) (string, bool) {
+	path := filepath.Join(cov.exportCacheDir(), key)
+	output, err := os.ReadFile(path)
+	if err != nil {
+		return "", false
+	}
+	// Mark the export as recently used.
+	now := time.Now()
+	_ = os.Chtimes(path, now, now)
+	log.Debugf("Using cached llvm-cov output %s", path)
+	return string(output), true
+}
+
+// writeCachedExport caches output for key. Failing to do so is
+// not an error, it only makes the next run slower.
+func (cov *CoverageGenerator) writeCachedExport(key string, output string) {
+	err := cov.writeCachedExportFile(key, output)
+	if err != nil {
+		log.Debugf("Failed to cache llvm-cov output: %v", err)
+	}
+}
+
+func (cov *CoverageGenerator) writeCachedExportFile(key string, output string) error {
+	dir := cov.exportCacheDir()
+	err := os.MkdirAll(dir, 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	// Write to a temporary file first so that concurrent runs never
+	// read a partially written export.
+	f, err := os.CreateTemp(dir, ".tmp-")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	_, err = f.WriteString(output)
+	closeErr := f.Close()
+	if err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		_ = os.Remove(f.Name())
+		return errors.WithStack(err)
+	}
+	err = os.Rename(f.Name(), filepath.Join(dir, key))
+	if err != nil {
+		_ = os.Remove(f.Name())
+		return errors.WithStack(err)
+	}
+
+	return pruneExportCache(dir)
+}
+
+// pruneExportCache removes all but the maxCachedExports most recently
+// used exports from dir.
+func pruneExportCache(dir string) error {
+	entries, err := os.ReadDir(dir)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	type cachedExport struct {
+		path    string
+		modTime time.Time
+	}
+	var exports []cachedExport
+	for _, entry := range entries {
+		if !entry.Type().IsRegular() || entry.Name()[0] == '.' {
+			continue
+		}
+		info, err := entry.Info()
+		if err != nil {
+			// Removed by a concurrent run.
+			continue
+		}
+		exports = append(exports, cachedExport{path: filepath.Join(dir, entry.Name()), modTime: info.ModTime()})
+	}
+	sort.Slice(exports, func(i, j int) bool { return exports[i].modTime.After(exports[j].modTime) })
+	for i := maxCachedExports; i < len(exports); i++ {
+		err = os.Remove(exports[i].path)
+		if err != nil && !os.IsNotExist(err) {
+			return errors.WithStack(err)
+		}
+	}
+	return nil
+}
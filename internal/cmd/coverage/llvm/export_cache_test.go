@@ -0,0 +1,65 @@
+package llvm
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestExportCacheKey(t *testing.T) {
+	dir := t.TempDir()
+	profile := filepath.Join(dir, "default.profdata")
+	executable := filepath.Join(dir, "my_fuzz_test")
+	require.NoError(t, os.WriteFile(profile, []byte("profile"), 0o644))
+	require.NoError(t, os.WriteFile(executable, []byte("executable"), 0o755))
+	args := []string{"export", "-format=lcov"}
+
+	key, err := exportCacheKey("llvm-cov", args, profile, []string{executable})
+	require.NoError(t, err)
+
+	// The key only depends on the contents of the files, not on their
+	// paths.
+	otherDir := t.TempDir()
+	otherProfile := filepath.Join(otherDir, "default.profdata")
+	require.NoError(t, os.WriteFile(otherProfile, []byte("profile"), 0o644))
+	otherKey, err := exportCacheKey("llvm-cov", args, otherProfile, []string{executable})
+	require.NoError(t, err)
+	assert.Equal(t, key, otherKey)
+
+	otherKey, err = exportCacheKey("llvm-cov", []string{"export", "-format=lcov", "-summary-only"}, profile, []string{executable})
+	require.NoError(t, err)
+	assert.NotEqual(t, key, otherKey)
+
+	require.NoError(t, os.WriteFile(profile, []byte("new profile"), 0o644))
+	otherKey, err = exportCacheKey("llvm-cov", args, profile, []string{executable})
+	require.NoError(t, err)
+	assert.NotEqual(t, key, otherKey)
+}
+
+func TestExportCache(t *testing.T) {
+	cov := &CoverageGenerator{BuildSystem: "other", ProjectDir: t.TempDir()}
+
+	_, ok := cov.readCachedExport("key")
+	assert.False(t, ok)
+	cov.writeCachedExport("key", "report")
+	output, ok := cov.readCachedExport("key")
+	assert.True(t, ok)
+	assert.Equal(t, "report", output)
+
+	// Only the most recently used exports are kept.
+	past := time.Now().Add(-time.Hour)
+	require.NoError(t, os.Chtimes(filepath.Join(cov.exportCacheDir(), "key"), past, past))
+	for i := 0; i < maxCachedExports; i++ {
+		cov.writeCachedExport(fmt.Sprintf("key%d", i), "report")
+	}
+	_, ok = cov.readCachedExport("key")
+	assert.False(t, ok)
+	entries, err := os.ReadDir(cov.exportCacheDir())
+	require.NoError(t, err)
+	assert.Len(t, entries, maxCachedExports)
+}
@@ -0,0 +1,291 @@
+package llvm
+
+import (
+	"encoding/json"
+	"fmt"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/pkg/errors"
+	"golang.org/x/sync/errgroup"
+
+	"code-intelligence.com/cifuzz/internal/cmdutils"
+	"code-intelligence.com/cifuzz/pkg/binary"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/minijail"
+	"code-intelligence.com/cifuzz/pkg/vcs"
+	"code-intelligence.com/cifuzz/util/envutil"
+	"code-intelligence.com/cifuzz/util/executil"
+	"code-intelligence.com/cifuzz/util/stringutil"
+)
+
+// generateImpactMap writes the source files covered by each input of
+// the corpora of the fuzz tests, one input per line, followed by the
+// paths of its files relative to the top-level directory of the Git
+// repository, separated by tabs. With it, the replayer only runs the
+// inputs which cover any of the files changed since the revision the
+// map was created for (see -impact_map).
+//
+// Every input is run on its own, so that its profile only contains its
+// own coverage and that of the initialization of the fuzz test.
+func (cov *CoverageGenerator) generateImpactMap() (string, error) {
+	topLevel, err := vcs.GitTopLevel(cov.ProjectDir)
+	if err != nil {
+		log.Debugf("Using the project directory as the root of the impact map: %v", err)
+		topLevel = cov.ProjectDir
+	}
+	ignoreCIFuzzIncludesArgs, err := cov.getIgnoreCIFuzzIncludesArgs()
+	if err != nil {
+		return "", err
+	}
+	objectArgs, err := cov.llvmCovObjectArgs(cov.llvmCovObjects())
+	if err != nil {
+		return "", err
+	}
+
+	var mutex sync.Mutex
+	covered := make(map[string]map[string]bool)
+	routines := errgroup.Group{}
+	routines.SetLimit(cov.numJobs())
+	for _, r := range cov.runs {
+		inputs, err := r.corpusInputs()
+		if err != nil {
+			return "", err
+		}
+		for i, input := range inputs {
+			r, i, input := r, i, input
+			routines.Go(func() error {
+				profile, err := r.inputProfile(input, filepath.Join(r.outputDir, "impact-map", strconv.Itoa(i)))
+				if err != nil || profile == "" {
+					return err
+				}
+				args := append([]string{"export", "-summary-only", "-instr-profile=" + profile}, ignoreCIFuzzIncludesArgs...)
+				export, err := cov.llvmCovExport(append(args, objectArgs...))
+				if err != nil {
+					return err
+				}
+				files, err := parseCoveredFiles(export, topLevel)
+				if err != nil {
+					return err
+				}
+
+				mutex.Lock()
+				defer mutex.Unlock()
+				name := filepath.Base(input)
+				if covered[name] == nil {
+					covered[name] = make(map[string]bool)
+				}
+				for _, file := range files {
+					covered[name][file] = true
+				}
+				return nil
+			})
+		}
+	}
+	err = routines.Wait()
+	if err != nil {
+		return "", err
+	}
+
+	outputPath := cov.OutputPath
+	if cov.OutputPath == "" {
+		// Like the lcov report, the impact map is only useful if it is
+		// accessible after it was created.
+		outputPath = cov.reportName() + ".impact"
+	}
+	commit, err := vcs.GitCommit()
+	if err != nil {
+		log.Debugf("Failed to get the current Git commit: %v", err)
+		commit = "an unknown revision"
+	}
+	err = os.WriteFile(outputPath, []byte(formatImpactMap(cov.FuzzTests, commit, covered)), 0o644)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+
+	log.Debugf("Created impact map: %s", outputPath)
+	return outputPath, nil
+}
+
+// corpusInputs returns the inputs of the corpus dirs replayed by run,
+// which, like libFuzzer, includes the files in their subdirectories.
+func (r *fuzzTestRun) corpusInputs() ([]string, error) {
+	var inputs []string
+	for _, dir := range r.corpusDirs {
+		err := filepath.WalkDir(dir, func(path string, d fs.DirEntry, err error) error {
+			if err != nil {
+				return err
+			}
+			if d.Type().IsRegular() {
+				inputs = append(inputs, path)
+			}
+			return nil
+		})
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+	}
+	return inputs, nil
+}
+
+// inputProfile runs the fuzz test on the input and merges the raw
+// profiles it wrote to outputDir into an indexed profile, whose path
+// is returned. Inputs which crash the fuzz test are still covered as
+// far as continuous mode allows, an empty path is returned if there is
+// no profile at all.
+func (r *fuzzTestRun) inputProfile(input string, outputDir string) (string, error) {
+	err := os.MkdirAll(outputDir, 0o755)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+
+	executable := r.buildResult.Executable
+	pattern := "%m.profraw"
+	if binary.SupportsLlvmProfileContinuousMode(executable) {
+		pattern = "%c" + pattern
+	}
+	env, err := envutil.Setenv(nil, "LLVM_PROFILE_FILE", filepath.Join(outputDir, pattern))
+	if err != nil {
+		return "", err
+	}
+	env, err = envutil.Setenv(env, "NO_CIFUZZ", "1")
+	if err != nil {
+		return "", err
+	}
+	if r.buildResult.RegisteredTest != "" {
+		env, err = envutil.Setenv(env, "CIFUZZ_TEST", r.buildResult.RegisteredTest)
+		if err != nil {
+			return "", err
+		}
+	}
+
+	args := []string{executable, input}
+	if r.cov.UseSandbox {
+		executable, err = filepath.EvalSymlinks(executable)
+		if err != nil {
+			return "", errors.WithStack(err)
+		}
+		mj, err := minijail.NewMinijail(&minijail.Options{
+			Args:      []string{executable, input},
+			Bindings:  []*minijail.Binding{{Source: executable}, {Source: input}},
+			OutputDir: outputDir,
+		})
+		if err != nil {
+			return "", err
+		}
+		defer mj.Cleanup()
+		args = mj.Args
+	}
+
+	cmd := executil.Command(args[0], args[1:]...)
+	cmd.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return "", err
+	}
+	log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(cmd.Args, env))
+	out, err := cmd.CombinedOutput()
+	if err != nil {
+		// The inputs are known to pass, but the coverage of those
+		// which don't is still useful.
+		log.Debugf("Input %s failed: %v\n%s", input, err, string(out))
+	}
+
+	rawProfiles, err := filepath.Glob(filepath.Join(outputDir, "*.profraw"))
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	if len(rawProfiles) == 0 {
+		return "", nil
+	}
+	profile := filepath.Join(outputDir, "input.profdata")
+	err = r.cov.mergeProfiles(profile, rawProfiles, 1)
+	if err != nil {
+		return "", err
+	}
+	return profile, nil
+}
+
+// llvmCovExport runs llvm-cov with the args, without the cache used
+// by runLlvmCov for the reports of the merged profile.
+func (cov *CoverageGenerator) llvmCovExport(args []string) ([]byte, error) {
+	llvmCov, err := cov.runfilesFinder.LLVMCovPath()
+	if err != nil {
+		return nil, err
+	}
+	cmd := executil.Command(llvmCov, args...)
+	cmd.Stderr = os.Stderr
+	log.Debugf("Command: %s", strings.Join(stringutil.QuotedStrings(cmd.Args), " "))
+	output, err := cmd.Output()
+	if err != nil {
+		return nil, cmdutils.WrapExecError(errors.WithStack(err), cmd.Cmd)
+	}
+	return output, nil
+}
+
+// parseCoveredFiles returns the files with covered lines in the JSON
+// export of llvm-cov, relative to topLevel and with forward slashes
+// like in the output of "git diff --name-only". Files outside of
+// topLevel can't be changed in the repository and are left out.
+func parseCoveredFiles(export []byte, topLevel string) ([]string, error) {
+	var summary struct {
+		Data []struct {
+			Files []struct {
+				Filename string `json:"filename"`
+				Summary  struct {
+					Lines struct {
+						Covered int `json:"covered"`
+					} `json:"lines"`
+				} `json:"summary"`
+			} `json:"files"`
+		} `json:"data"`
+	}
+	err := json.Unmarshal(export, &summary)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	var files []string
+	for _, data := range summary.Data {
+		for _, file := range data.Files {
+			if file.Summary.Lines.Covered == 0 {
+				continue
+			}
+			rel, err := filepath.Rel(topLevel, file.Filename)
+			if err != nil || rel == ".." || strings.HasPrefix(rel, ".."+string(filepath.Separator)) {
+				continue
+			}
+			files = append(files, filepath.ToSlash(rel))
+		}
+	}
+	return files, nil
+}
+
+// formatImpactMap returns the impact map of the covered files of each
+// input, sorted by the names of the inputs and the paths of the files.
+func formatImpactMap(fuzzTests []string, commit string, covered map[string]map[string]bool) string {
+	var b strings.Builder
+	fmt.Fprintf(&b, "# cifuzz impact map of %s at %s\n", strings.Join(fuzzTests, " "), commit)
+	names := make([]string, 0, len(covered))
+	for name := range covered {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	for _, name := range names {
+		files := make([]string, 0, len(covered[name]))
+		for file := range covered[name] {
+			files = append(files, file)
+		}
+		sort.Strings(files)
+		b.WriteString(name)
+		for _, file := range files {
+			b.WriteString("\t" + file)
+		}
+		b.WriteString("\n")
+	}
+	return b.String()
+}
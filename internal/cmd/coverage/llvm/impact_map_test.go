@@ -0,0 +1,29 @@
+package llvm
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestParseCoveredFiles(t *testing.T) {
+	export := `{"data": [{"files": [
+		{"filename": "/repo/src/parser.c", "summary": {"lines": {"count": 10, "covered": 3}}},
+		{"filename": "/repo/src/unused.c", "summary": {"lines": {"count": 10, "covered": 0}}},
+		{"filename": "/usr/include/stdio.h", "summary": {"lines": {"count": 2, "covered": 2}}}
+	]}]}`
+	files, err := parseCoveredFiles([]byte(export), "/repo")
+	require.NoError(t, err)
+	assert.Equal(t, []string{"src/parser.c"}, files)
+}
+
+func TestFormatImpactMap(t *testing.T) {
+	covered := map[string]map[string]bool{
+		"crash-2": {"src/b.c": true, "src/a.c": true},
+		"crash-1": {"src/a.c": true},
+	}
+	assert.Equal(t,
+		"# cifuzz impact map of my_fuzz_test at abc\ncrash-1\tsrc/a.c\ncrash-2\tsrc/a.c\tsrc/b.c\n",
+		formatImpactMap([]string{"my_fuzz_test"}, "abc", covered))
+}
@@ -2,7 +2,9 @@ package llvm
 
 import (
 	"bytes"
+	"context"
 	"debug/macho"
+	"fmt"
 	"io"
 	"os"
 	"os/exec"
@@ -11,9 +13,11 @@ import (
 	"runtime"
 	"strings"
 
+	"github.com/otiai10/copy"
 	"github.com/pkg/errors"
 	"github.com/pterm/pterm"
 	"github.com/spf13/viper"
+	"golang.org/x/sync/errgroup"
 
 	"code-intelligence.com/cifuzz/internal/build"
 	"code-intelligence.com/cifuzz/internal/build/cmake"
@@ -41,18 +45,45 @@ type CoverageGenerator struct {
 	NumBuildJobs    uint
 	SeedCorpusDirs  []string
 	UseSandbox      bool
-	FuzzTest        string
-	ProjectDir      string
-	Stderr          io.Writer
-	BuildStdout     io.Writer
-	BuildStderr     io.Writer
-
-	buildResult    *build.Result
+	// CoverageSourceDirs are the directories whose sources are
+	// instrumented, see cmake.BuilderOptions
+	CoverageSourceDirs []string
+	// FuzzTests are built together and replayed concurrently, each
+	// with its own directory for the raw profiles. The report covers
+	// all of them.
+	FuzzTests []string
+	// NumJobs is the maximum number of fuzz tests that are replayed
+	// and whose raw profiles are merged at the same time. Defaults to
+	// the number of CPUs.
+	NumJobs     uint
+	ProjectDir  string
+	Stderr      io.Writer
+	BuildStdout io.Writer
+	BuildStderr io.Writer
+
+	runs           []*fuzzTestRun
+	merger         *profileMerger
 	tmpDir         string
-	outputDir      string
 	runfilesFinder runfiles.RunfilesFinder
 }
 
+// fuzzTestRun is the replay of the corpus of a single fuzz test and
+// the merge of the raw profiles it produces.
+type fuzzTestRun struct {
+	cov         *CoverageGenerator
+	fuzzTest    string
+	buildResult *build.Result
+	// outputDir holds the raw profiles and the temporary corpus dirs.
+	outputDir string
+	// corpusDirs are the corpus dirs replayed by run.
+	corpusDirs []string
+	// pool is the sandbox shared by all libFuzzer runs of the fuzz
+	// test and poolStderr collects their filtered output, if the
+	// sandbox is used and not in verbose mode.
+	pool       *minijail.Pool
+	poolStderr *bytes.Buffer
+}
+
 func (cov *CoverageGenerator) BuildFuzzTestForCoverage() error {
 	// ensure a finder is set
 	if cov.runfilesFinder == nil {
@@ -64,24 +95,39 @@ func (cov *CoverageGenerator) BuildFuzzTestForCoverage() error {
 	if err != nil {
 		return errors.WithStack(err)
 	}
-	cov.outputDir = filepath.Join(cov.tmpDir, "output")
-	err = os.Mkdir(cov.outputDir, 0o755)
+	err = os.Mkdir(filepath.Join(cov.tmpDir, "profiles"), 0o755)
 	if err != nil {
 		return errors.WithStack(err)
 	}
 
-	err = cov.build()
+	buildResults, err := cov.build()
 	if err != nil {
 		return err
 	}
 
+	for i, buildResult := range buildResults {
+		// Fuzz test executables have unique names, so they can be used
+		// to name the output directories.
+		outputDir := filepath.Join(cov.tmpDir, "output", filepath.Base(buildResult.Executable))
+		err = os.MkdirAll(outputDir, 0o755)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		cov.runs = append(cov.runs, &fuzzTestRun{
+			cov:         cov,
+			fuzzTest:    cov.FuzzTests[i],
+			buildResult: buildResult,
+			outputDir:   outputDir,
+		})
+	}
+
 	return nil
 }
 
 func (cov *CoverageGenerator) GenerateCoverageReport() (string, error) {
 	defer fileutil.Cleanup(cov.tmpDir)
 
-	err := cov.run()
+	err := cov.runAll()
 	if err != nil {
 		var exitErr *exec.ExitError
 		if errors.As(err, &exitErr) && cov.UseSandbox {
@@ -97,7 +143,7 @@ func (cov *CoverageGenerator) GenerateCoverageReport() (string, error) {
 	return reportPath, nil
 }
 
-func (cov *CoverageGenerator) build() error {
+func (cov *CoverageGenerator) build() ([]*build.Result, error) {
 	switch cov.BuildSystem {
 	case config.BuildSystemCMake:
 		builder, err := cmake.NewBuilder(&cmake.BuilderOptions{
@@ -112,25 +158,23 @@ func (cov *CoverageGenerator) build() error {
 			Stderr: cov.BuildStderr,
 			// We want the runtime deps in the build result because we
 			// pass them to the llvm-cov command.
-			FindRuntimeDeps: true,
+			FindRuntimeDeps:    true,
+			CoverageSourceDirs: cov.CoverageSourceDirs,
 		})
 		if err != nil {
-			return err
+			return nil, err
 		}
 		err = builder.Configure()
 		if err != nil {
-			return err
-		}
-		buildResults, err := builder.Build([]string{cov.FuzzTest})
-		if err != nil {
-			return err
+			return nil, err
 		}
-		cov.buildResult = buildResults[0]
-		return nil
+		// Build all fuzz tests with a single invocation of the build
+		// tool, which parallelizes across them.
+		return builder.Build(cov.FuzzTests)
 
 	case config.BuildSystemOther:
 		if runtime.GOOS == "windows" {
-			return errors.New("CMake is the only supported build system on Windows")
+			return nil, errors.New("CMake is the only supported build system on Windows")
 		}
 		builder, err := other.NewBuilder(&other.BuilderOptions{
 			ProjectDir:     cov.ProjectDir,
@@ -142,44 +186,109 @@ func (cov *CoverageGenerator) build() error {
 			Stderr:         cov.BuildStderr,
 		})
 		if err != nil {
-			return err
+			return nil, err
 		}
 
 		if err := builder.Clean(); err != nil {
-			return err
+			return nil, err
 		}
 
-		buildResult, err := builder.Build(cov.FuzzTest)
-		if err != nil {
-			return err
+		var buildResults []*build.Result
+		for _, fuzzTest := range cov.FuzzTests {
+			buildResult, err := builder.Build(fuzzTest)
+			if err != nil {
+				return nil, err
+			}
+			buildResults = append(buildResults, buildResult)
 		}
-		cov.buildResult = buildResult
-		return nil
+		return buildResults, nil
+
+	}
+	return nil, errors.New("unknown build system")
+}
+
+// runAll replays the corpora of the fuzz tests and merges the raw
+// profiles of each of them into an indexed profile on a pool of
+// NumJobs workers. The indexed profiles are merged by a profileMerger
+// while the remaining fuzz tests are replayed, and into a single one
+// by report.
+func (cov *CoverageGenerator) runAll() error {
+	numJobs := cov.numJobs()
+	// llvm-profdata merges profiles on multiple threads, which are
+	// split between the concurrently running workers
+	numThreads := numJobs
+	if len(cov.runs) > 1 {
+		numThreads = numJobs / minInt(numJobs, len(cov.runs))
+		cov.merger = &profileMerger{cov: cov}
+	}
+
+	// Limits the number of concurrently running workers.
+	slots := make(chan struct{}, numJobs)
+	routines, ctx := errgroup.WithContext(context.Background())
+	for _, r := range cov.runs {
+		r := r
+		routines.Go(func() error {
+			select {
+			case slots <- struct{}{}:
+			case <-ctx.Done():
+				// Don't start more fuzz tests after one failed.
+				return nil
+			}
+			defer func() { <-slots }()
 
+			err := r.run()
+			if err != nil {
+				return err
+			}
+			err = r.indexRawProfile(numThreads)
+			if err != nil {
+				return err
+			}
+			if cov.merger != nil {
+				return cov.merger.add(r.indexedProfilePath(), numThreads)
+			}
+			return nil
+		})
 	}
-	return errors.New("unknown build system")
+	return routines.Wait()
 }
 
-func (cov *CoverageGenerator) run() error {
-	log.Infof("Running %s on corpus", pterm.Style{pterm.Reset, pterm.FgLightBlue}.Sprint(cov.FuzzTest))
-	log.Debugf("Executable: %s", cov.buildResult.Executable)
+func (cov *CoverageGenerator) numJobs() int {
+	if cov.NumJobs == 0 {
+		return runtime.NumCPU()
+	}
+	return int(cov.NumJobs)
+}
+
+func minInt(a, b int) int {
+	if a < b {
+		return a
+	}
+	return b
+}
+
+func (r *fuzzTestRun) run() error {
+	cov := r.cov
+	log.Infof("Running %s on corpus", pterm.Style{pterm.Reset, pterm.FgLightBlue}.Sprint(r.fuzzTest))
+	log.Debugf("Executable: %s", r.buildResult.Executable)
 
 	// Use user-specified seed corpus dirs (if any), the default seed
 	// corpus (if it exists), and the generated corpus (if it exists).
-	corpusDirs := cov.SeedCorpusDirs
-	exists, err := fileutil.Exists(cov.buildResult.SeedCorpus)
+	// Copy the user-specified dirs, which are shared by all fuzz tests.
+	corpusDirs := append([]string{}, cov.SeedCorpusDirs...)
+	exists, err := fileutil.Exists(r.buildResult.SeedCorpus)
 	if err != nil {
 		return err
 	}
 	if exists {
-		corpusDirs = append(corpusDirs, cov.buildResult.SeedCorpus)
+		corpusDirs = append(corpusDirs, r.buildResult.SeedCorpus)
 	}
-	exists, err = fileutil.Exists(cov.buildResult.GeneratedCorpus)
+	exists, err = fileutil.Exists(r.buildResult.GeneratedCorpus)
 	if err != nil {
 		return err
 	}
 	if exists {
-		corpusDirs = append(corpusDirs, cov.buildResult.GeneratedCorpus)
+		corpusDirs = append(corpusDirs, r.buildResult.GeneratedCorpus)
 	}
 
 	// Ensure that symlinks are resolved to be able to add minijail
@@ -190,11 +299,12 @@ func (cov *CoverageGenerator) run() error {
 			return errors.WithStack(err)
 		}
 	}
+	r.corpusDirs = corpusDirs
 
-	executable := cov.buildResult.Executable
+	executable := r.buildResult.Executable
 	conModeSupport := binary.SupportsLlvmProfileContinuousMode(executable)
 	var env []string
-	env, err = envutil.Setenv(env, "LLVM_PROFILE_FILE", cov.rawProfilePattern(conModeSupport))
+	env, err = envutil.Setenv(env, "LLVM_PROFILE_FILE", r.rawProfilePattern(conModeSupport))
 	if err != nil {
 		return err
 	}
@@ -202,8 +312,14 @@ func (cov *CoverageGenerator) run() error {
 	if err != nil {
 		return err
 	}
+	if r.buildResult.RegisteredTest != "" {
+		env, err = envutil.Setenv(env, "CIFUZZ_TEST", r.buildResult.RegisteredTest)
+		if err != nil {
+			return err
+		}
+	}
 
-	dirWithEmptyFile := filepath.Join(cov.outputDir, "empty-file-corpus")
+	dirWithEmptyFile := filepath.Join(r.outputDir, "empty-file-corpus")
 	err = os.Mkdir(dirWithEmptyFile, 0o755)
 	if err != nil {
 		return err
@@ -213,12 +329,12 @@ func (cov *CoverageGenerator) run() error {
 		return err
 	}
 
-	emptyDir := filepath.Join(cov.outputDir, "merge-target")
+	emptyDir := filepath.Join(r.outputDir, "merge-target")
 	err = os.Mkdir(emptyDir, 0o755)
 	if err != nil {
 		return err
 	}
-	artifactsDir := filepath.Join(cov.outputDir, "merge-artifacts")
+	artifactsDir := filepath.Join(r.outputDir, "merge-artifacts")
 	err = os.Mkdir(artifactsDir, 0o755)
 	if err != nil {
 		return err
@@ -234,44 +350,90 @@ func (cov *CoverageGenerator) run() error {
 	// always logs any error we encounter.
 	// This line is responsible for empty inputs being skipped:
 	// https://github.com/llvm/llvm-project/blob/c7c0ce7d9ebdc0a49313bc77e14d1e856794f2e0/compiler-rt/lib/fuzzer/FuzzerIO.cpp#L127
-	_ = cov.runFuzzer(append(args, "-runs=0"), []string{dirWithEmptyFile}, env)
+	if cov.UseSandbox {
+		err = r.startPool(corpusDirs, env)
+		if err != nil {
+			return err
+		}
+		defer func() {
+			err := r.pool.Close()
+			if err != nil {
+				log.Debugf("Failed to stop sandbox: %v", err)
+			}
+		}()
+	}
+
+	_ = r.runFuzzer(append(args, "-runs=0"), []string{dirWithEmptyFile}, env)
 
 	// We use libFuzzer's crash-resistant merge mode to merge all corpus directories into an empty directory, which
 	// makes libFuzzer go over all inputs in a subprocess that is restarted in case it crashes. With LLVM's continuous
 	// mode (see rawProfilePattern) and since the LLVM coverage information is automatically appended to the existing
 	// .profraw file, we collect complete coverage information even if the target crashes on an input in the corpus.
-	return cov.runFuzzer(append(args, "-merge=1"), append([]string{emptyDir}, corpusDirs...), env)
+	return r.runFuzzer(append(args, "-merge=1"), append([]string{emptyDir}, corpusDirs...), env)
+}
+
+// startPool starts the sandbox in which runFuzzer runs libFuzzer, so
+// that its namespaces and mounts are only set up once per fuzz test.
+func (r *fuzzTestRun) startPool(corpusDirs []string, env []string) error {
+	executable, err := filepath.EvalSymlinks(r.buildResult.Executable)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	bindings := []*minijail.Binding{
+		// The fuzz target must be accessible
+		{Source: executable},
+	}
+	// The temporary corpus dirs are below the output dir, which is
+	// bound read-write.
+	for _, dir := range corpusDirs {
+		bindings = append(bindings, &minijail.Binding{Source: dir})
+	}
+
+	opts := &minijail.PoolOptions{
+		Options: &minijail.Options{
+			Bindings:  bindings,
+			OutputDir: r.outputDir,
+		},
+	}
+	opts.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return err
+	}
+	if viper.GetBool("verbose") {
+		opts.Stdout = os.Stdout
+		opts.Stderr = os.Stderr
+	} else {
+		r.poolStderr = &bytes.Buffer{}
+		opts.Stderr = minijail.NewOutputFilter(r.poolStderr)
+	}
+
+	r.pool, err = minijail.NewPool(opts)
+	return err
 }
 
-func (cov *CoverageGenerator) runFuzzer(preCorpusArgs []string, corpusDirs []string, env []string) error {
+func (r *fuzzTestRun) runFuzzer(preCorpusArgs []string, corpusDirs []string, env []string) error {
 	var err error
-	args := []string{cov.buildResult.Executable}
+	args := []string{r.buildResult.Executable}
 	args = append(args, preCorpusArgs...)
 	args = append(args, corpusDirs...)
 
-	if cov.UseSandbox {
-		bindings := []*minijail.Binding{
-			// The fuzz target must be accessible
-			{Source: cov.buildResult.Executable},
-		}
-
-		for _, dir := range corpusDirs {
-			bindings = append(bindings, &minijail.Binding{Source: dir})
-		}
-
-		// Set up Minijail
-		mj, err := minijail.NewMinijail(&minijail.Options{
-			Args:      args,
-			Bindings:  bindings,
-			OutputDir: cov.outputDir,
-		})
+	if r.pool != nil {
+		// The sandbox only contains the executable with symlinks
+		// resolved, see startPool.
+		args[0], err = filepath.EvalSymlinks(args[0])
 		if err != nil {
-			return err
+			return errors.WithStack(err)
 		}
-		defer mj.Cleanup()
-
-		// Use the command which runs the fuzz test via minijail
-		args = mj.Args
+		log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(args, env))
+		err = r.pool.Run(args)
+		if err != nil && r.poolStderr != nil {
+			// Add stderr output of the fuzzer to provide users with
+			// the context of this error even without verbose mode.
+			// The output of all runs in the sandbox is collected
+			// together.
+			err = errors.Errorf("%v\n %s", err, r.poolStderr.String())
+		}
+		return errors.WithStack(err)
 	}
 
 	cmd := executil.Command(args[0], args[1:]...)
@@ -284,8 +446,6 @@ func (cov *CoverageGenerator) runFuzzer(preCorpusArgs []string, corpusDirs []str
 	if viper.GetBool("verbose") {
 		cmd.Stdout = os.Stdout
 		cmd.Stderr = os.Stderr
-	} else if cov.UseSandbox {
-		cmd.Stderr = minijail.NewOutputFilter(errStream)
 	} else {
 		cmd.Stderr = errStream
 	}
@@ -304,7 +464,7 @@ func (cov *CoverageGenerator) runFuzzer(preCorpusArgs []string, corpusDirs []str
 }
 
 func (cov *CoverageGenerator) report() (string, error) {
-	err := cov.indexRawProfile()
+	err := cov.mergeIndexedProfiles()
 	if err != nil {
 		return "", err
 	}
@@ -329,28 +489,55 @@ func (cov *CoverageGenerator) report() (string, error) {
 		if err != nil {
 			return "", err
 		}
+
+	case "profdata":
+		reportPath, err = cov.copyIndexedProfile()
+		if err != nil {
+			return "", err
+		}
+
+	case "impact-map":
+		reportPath, err = cov.generateImpactMap()
+		if err != nil {
+			return "", err
+		}
 	}
 
 	return reportPath, nil
 }
 
-func (cov *CoverageGenerator) indexRawProfile() error {
-	rawProfileFiles, err := cov.rawProfileFiles()
+func (r *fuzzTestRun) indexRawProfile(numThreads int) error {
+	rawProfileFiles, err := r.rawProfileFiles()
 	if err != nil {
 		return err
 	}
 	if len(rawProfileFiles) == 0 {
 		// The rawProfilePattern parameter only governs whether we add "%c",
 		// which doesn't affect the actual raw profile location.
-		return errors.Errorf("%s did not generate .profraw files at %s", cov.buildResult.Executable, cov.rawProfilePattern(false))
+		return errors.Errorf("%s did not generate .profraw files at %s", r.buildResult.Executable, r.rawProfilePattern(false))
+	}
+	return r.cov.mergeProfiles(r.indexedProfilePath(), rawProfileFiles, numThreads)
+}
+
+// mergeIndexedProfiles merges the indexed profiles of all fuzz tests,
+// or the intermediate profiles the merger created from them, into the
+// one the report is generated from. With a single fuzz test, its
+// indexed profile is used as is.
+func (cov *CoverageGenerator) mergeIndexedProfiles() error {
+	if len(cov.runs) == 1 {
+		return nil
 	}
+	return cov.mergeProfiles(cov.indexedProfilePath(), cov.merger.remaining(), cov.numJobs())
+}
 
+func (cov *CoverageGenerator) mergeProfiles(outputPath string, profiles []string, numThreads int) error {
 	llvmProfData, err := cov.runfilesFinder.LLVMProfDataPath()
 	if err != nil {
 		return err
 	}
 
-	args := append([]string{"merge", "-sparse", "-o", cov.indexedProfilePath()}, rawProfileFiles...)
+	args := []string{"merge", "-sparse", fmt.Sprintf("-num-threads=%d", numThreads), "-o", outputPath}
+	args = append(args, profiles...)
 	cmd := exec.Command(llvmProfData, args...)
 	cmd.Stdout = os.Stdout
 	cmd.Stderr = os.Stderr
@@ -362,7 +549,7 @@ func (cov *CoverageGenerator) indexRawProfile() error {
 	return nil
 }
 
-func (cov *CoverageGenerator) rawProfilePattern(supportsContinuousMode bool) string {
+func (r *fuzzTestRun) rawProfilePattern(supportsContinuousMode bool) string {
 	// Use "%m" instead of a fixed path to support coverage of shared
 	// libraries: Each executable or library generates its own profile
 	// file, all of which we have to merge in the end. By using "%m",
@@ -376,7 +563,7 @@ func (cov *CoverageGenerator) rawProfilePattern(supportsContinuousMode bool) str
 	if supportsContinuousMode {
 		basePattern = "%c" + basePattern
 	}
-	return filepath.Join(cov.outputDir, basePattern)
+	return filepath.Join(r.outputDir, basePattern)
 }
 
 func (cov *CoverageGenerator) generateHTMLReport() (string, error) {
@@ -408,7 +595,7 @@ func (cov *CoverageGenerator) generateHTMLReport() (string, error) {
 		if err != nil {
 			return "", errors.WithStack(err)
 		}
-		cov.OutputPath = filepath.Join(outputDir, cov.executableName())
+		cov.OutputPath = filepath.Join(outputDir, cov.reportName())
 	}
 
 	// Create an HTML report via genhtml
@@ -436,24 +623,22 @@ func (cov *CoverageGenerator) runLlvmCov(args []string) (string, error) {
 		return "", err
 	}
 
-	// Add all runtime dependencies of the fuzz test to the binaries
-	// processed by llvm-cov to include them in the coverage report
-	args = append(args, "-instr-profile="+cov.indexedProfilePath())
-	args = append(args, cov.buildResult.Executable)
-	if archArg, err := cov.archFlagIfNeeded(cov.buildResult.Executable); err != nil {
+	objects := cov.llvmCovObjects()
+	cacheKey, err := exportCacheKey(llvmCov, args, cov.indexedProfilePath(), objects)
+	if err != nil {
 		return "", err
-	} else if archArg != "" {
-		args = append(args, archArg)
 	}
-	for _, path := range cov.buildResult.RuntimeDeps {
-		args = append(args, "-object="+path)
-		if archArg, err := cov.archFlagIfNeeded(path); err != nil {
-			return "", err
-		} else if archArg != "" {
-			args = append(args, archArg)
-		}
+	if output, ok := cov.readCachedExport(cacheKey); ok {
+		return output, nil
 	}
 
+	args = append(args, "-instr-profile="+cov.indexedProfilePath())
+	objectArgs, err := cov.llvmCovObjectArgs(objects)
+	if err != nil {
+		return "", err
+	}
+	args = append(args, objectArgs...)
+
 	cmd := exec.Command(llvmCov, args...)
 	cmd.Stderr = os.Stderr
 	log.Debugf("Command: %s", strings.Join(stringutil.QuotedStrings(cmd.Args), " "))
@@ -461,9 +646,51 @@ func (cov *CoverageGenerator) runLlvmCov(args []string) (string, error) {
 	if err != nil {
 		return "", cmdutils.WrapExecError(errors.WithStack(err), cmd)
 	}
+	cov.writeCachedExport(cacheKey, string(output))
 	return string(output), nil
 }
 
+// llvmCovObjects returns all fuzz tests and their runtime dependencies,
+// which are processed by llvm-cov to include them in the coverage
+// report.
+func (cov *CoverageGenerator) llvmCovObjects() []string {
+	candidates := []string{cov.runs[0].buildResult.Executable}
+	for i, r := range cov.runs {
+		if i > 0 {
+			candidates = append(candidates, r.buildResult.Executable)
+		}
+		candidates = append(candidates, r.buildResult.RuntimeDeps...)
+	}
+	// Fuzz tests commonly share runtime dependencies, which only have
+	// to be processed once.
+	var objects []string
+	seen := make(map[string]bool)
+	for _, path := range candidates {
+		if !seen[path] {
+			seen[path] = true
+			objects = append(objects, path)
+		}
+	}
+	return objects
+}
+
+func (cov *CoverageGenerator) llvmCovObjectArgs(objects []string) ([]string, error) {
+	var args []string
+	for i, path := range objects {
+		if i == 0 {
+			args = append(args, path)
+		} else {
+			args = append(args, "-object="+path)
+		}
+		if archArg, err := cov.archFlagIfNeeded(path); err != nil {
+			return nil, err
+		} else if archArg != "" {
+			args = append(args, archArg)
+		}
+	}
+	return args, nil
+}
+
 func (cov *CoverageGenerator) generateLcovReport() (string, error) {
 	args := []string{"export", "-format=lcov"}
 	ignoreCIFuzzIncludesArgs, err := cov.getIgnoreCIFuzzIncludesArgs()
@@ -483,7 +710,7 @@ func (cov *CoverageGenerator) generateLcovReport() (string, error) {
 		// directory like we do for HTML reports, because we can't open
 		// the lcov report in a browser, so the command is only useful
 		// if the lcov report is accessible after it was created.
-		outputPath = cov.executableName() + ".coverage.lcov"
+		outputPath = cov.reportName() + ".coverage.lcov"
 	}
 
 	err = os.WriteFile(outputPath, []byte(report), 0o644)
@@ -495,6 +722,26 @@ func (cov *CoverageGenerator) generateLcovReport() (string, error) {
 	return outputPath, nil
 }
 
+// copyIndexedProfile writes the merged indexed profile to the output
+// path, from where it can be used for profile-guided optimization of
+// the fuzzing build.
+func (cov *CoverageGenerator) copyIndexedProfile() (string, error) {
+	outputPath := cov.OutputPath
+	if cov.OutputPath == "" {
+		// Like the lcov report, the profile is only useful if it is
+		// accessible after it was created.
+		outputPath = cov.reportName() + ".profdata"
+	}
+
+	err := copy.Copy(cov.indexedProfilePath(), outputPath)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+
+	log.Debugf("Created indexed profile: %s", outputPath)
+	return outputPath, nil
+}
+
 func (cov *CoverageGenerator) lcovReportSummary() (string, error) {
 	args := []string{"export", "-format=lcov", "-summary-only"}
 	ignoreCIFuzzIncludesArgs, err := cov.getIgnoreCIFuzzIncludesArgs()
@@ -518,17 +765,31 @@ func (cov *CoverageGenerator) getIgnoreCIFuzzIncludesArgs() ([]string, error) {
 	return []string{"-ignore-filename-regex=" + regexp.QuoteMeta(cifuzzIncludePath) + "/.*"}, nil
 }
 
-func (cov *CoverageGenerator) rawProfileFiles() ([]string, error) {
-	files, err := filepath.Glob(filepath.Join(cov.outputDir, "*.profraw"))
+func (r *fuzzTestRun) rawProfileFiles() ([]string, error) {
+	files, err := filepath.Glob(filepath.Join(r.outputDir, "*.profraw"))
 	return files, errors.WithStack(err)
 }
 
+func (r *fuzzTestRun) indexedProfilePath() string {
+	return filepath.Join(r.cov.tmpDir, "profiles", filepath.Base(r.buildResult.Executable)+".profdata")
+}
+
+// indexedProfilePath returns the path of the indexed profile the
+// report is generated from.
 func (cov *CoverageGenerator) indexedProfilePath() string {
-	return filepath.Join(cov.tmpDir, filepath.Base(cov.buildResult.Executable)+".profdata")
+	if len(cov.runs) == 1 {
+		return cov.runs[0].indexedProfilePath()
+	}
+	return filepath.Join(cov.tmpDir, "merged.profdata")
 }
 
-func (cov *CoverageGenerator) executableName() string {
-	return filepath.Base(cov.buildResult.Executable)
+// reportName returns the name of the fuzz test executable if the
+// report covers a single one.
+func (cov *CoverageGenerator) reportName() string {
+	if len(cov.runs) == 1 {
+		return filepath.Base(cov.runs[0].buildResult.Executable)
+	}
+	return "fuzz_tests"
 }
 
 // Returns an llvm-cov -arch flag indicating the preferred architecture of the given object on macOS, where objects can
@@ -73,7 +73,7 @@ func TestLLVM(t *testing.T) {
 				BuildSystem:    "other",
 				BuildCommand:   "make clean && make $FUZZ_TEST",
 				UseSandbox:     false,
-				FuzzTest:       "my_fuzz_test",
+				FuzzTests:      []string{"my_fuzz_test"},
 				ProjectDir:     tmpDir,
 				BuildStdout:    outBuf,
 				Stderr:         os.Stderr,
@@ -97,3 +97,55 @@ func TestLLVM(t *testing.T) {
 		})
 	}
 }
+
+func TestLLVM_MultipleFuzzTests(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+
+	cwd, err := os.Getwd()
+	require.NoError(t, err)
+	testdataDir := filepath.Join(cwd, "testdata")
+	testutil.RegisterTestDeps(testdataDir)
+
+	repoRoot, err := builder.FindProjectDir()
+	require.NoError(t, err)
+	includePath := filepath.Join(repoRoot, "include")
+
+	tmpDir, cleanup := testutil.ChdirToTempDir("llvm-coverage-gen")
+	defer cleanup()
+	err = copy.Copy(testdataDir, tmpDir)
+	require.NoError(t, err)
+
+	finderMock := &mocks.RunfilesFinderMock{}
+	finderMock.On("CIFuzzIncludePath").Return(includePath, nil)
+	finderMock.On("LLVMProfDataPath").Return("llvm-profdata", nil)
+	finderMock.On("LLVMCovPath").Return("llvm-cov", nil)
+
+	testLLVM := &CoverageGenerator{
+		OutputFormat:   "lcov",
+		BuildSystem:    "other",
+		BuildCommand:   "make $FUZZ_TEST",
+		CleanCommand:   "make clean",
+		UseSandbox:     false,
+		FuzzTests:      []string{"my_fuzz_test", "my_other_fuzz_test"},
+		NumJobs:        2,
+		ProjectDir:     tmpDir,
+		BuildStdout:    io.Discard,
+		Stderr:         os.Stderr,
+		runfilesFinder: finderMock,
+	}
+
+	err = testLLVM.BuildFuzzTestForCoverage()
+	require.NoError(t, err)
+	reportPath, err := testLLVM.GenerateCoverageReport()
+	require.NoError(t, err)
+
+	// A single report covers both fuzz tests.
+	assert.Equal(t, "fuzz_tests.coverage.lcov", filepath.Base(reportPath))
+	report, err := os.ReadFile(reportPath)
+	require.NoError(t, err)
+	assert.Contains(t, string(report), "src/explore_me.cpp")
+	assert.Contains(t, string(report), "my_fuzz_test.cpp")
+	assert.Contains(t, string(report), "my_other_fuzz_test.cpp")
+}
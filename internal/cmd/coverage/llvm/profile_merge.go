@@ -0,0 +1,70 @@
+package llvm
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"sync"
+
+	"github.com/pkg/errors"
+)
+
+// The number of indexed profiles which are merged into an intermediate
+// profile by a profileMerger. Every profile is read once per level of
+// the merge tree, so larger values mean fewer levels but less overlap
+// with the replays.
+const profileMergeFanIn = 8
+
+// profileMerger merges the indexed profiles of the fuzz tests in a tree
+// while other fuzz tests are still being replayed: As soon as
+// profileMergeFanIn profiles are pending, they are merged into an
+// intermediate profile, which is pending again. This way, the final
+// merge in report only has to read a few profiles instead of one per
+// fuzz test.
+type profileMerger struct {
+	cov   *CoverageGenerator
+	mutex sync.Mutex
+	// The profiles which haven't been merged yet
+	pending []string
+	// The number of intermediate profiles created so far
+	numMerged int
+}
+
+// add adds the profile to the pending ones and merges them if there
+// are enough. It's called by the workers of runAll, so the merges count
+// against the concurrently running jobs.
+func (m *profileMerger) add(profile string, numThreads int) error {
+	for {
+		m.mutex.Lock()
+		m.pending = append(m.pending, profile)
+		if len(m.pending) < profileMergeFanIn {
+			m.mutex.Unlock()
+			return nil
+		}
+		batch := m.pending
+		m.pending = nil
+		m.numMerged++
+		// The profiles of the fuzz tests are named after their
+		// executables, so the intermediate ones are kept apart
+		dir := filepath.Join(m.cov.tmpDir, "profiles", "intermediate")
+		profile = filepath.Join(dir, fmt.Sprintf("%d.profdata", m.numMerged))
+		m.mutex.Unlock()
+
+		err := os.MkdirAll(dir, 0o755)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		err = m.cov.mergeProfiles(profile, batch, numThreads)
+		if err != nil {
+			return err
+		}
+	}
+}
+
+// remaining returns the profiles that still have to be merged once
+// all fuzz tests were replayed.
+func (m *profileMerger) remaining() []string {
+	m.mutex.Lock()
+	defer m.mutex.Unlock()
+	return m.pending
+}
@@ -0,0 +1,68 @@
+package llvm
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/runfiles"
+)
+
+// fakeProfDataFinder returns an llvm-profdata which concatenates the
+// profiles it merges
+type fakeProfDataFinder struct {
+	runfiles.RunfilesFinder
+	llvmProfData string
+}
+
+func (f *fakeProfDataFinder) LLVMProfDataPath() (string, error) {
+	return f.llvmProfData, nil
+}
+
+func TestProfileMerger(t *testing.T) {
+	if runtime.GOOS == "windows" {
+		t.Skip("The fake llvm-profdata is a shell script")
+	}
+
+	tmpDir := t.TempDir()
+	require.NoError(t, os.Mkdir(filepath.Join(tmpDir, "profiles"), 0o755))
+	llvmProfData := filepath.Join(tmpDir, "llvm-profdata")
+	// Called as: merge -sparse -num-threads=N -o <output> <profiles>...
+	script := "#!/bin/sh\nshift 3\nout=\"$2\"\nshift 2\ncat \"$@\" > \"$out\"\n"
+	require.NoError(t, os.WriteFile(llvmProfData, []byte(script), 0o755))
+	cov := &CoverageGenerator{
+		tmpDir:         tmpDir,
+		runfilesFinder: &fakeProfDataFinder{llvmProfData: llvmProfData},
+	}
+	merger := &profileMerger{cov: cov}
+
+	var want []string
+	numProfiles := 3*profileMergeFanIn + 2
+	for i := 0; i < numProfiles; i++ {
+		profile := filepath.Join(tmpDir, "profiles", fmt.Sprintf("fuzz_test_%d.profdata", i))
+		want = append(want, profile)
+		require.NoError(t, os.WriteFile(profile, []byte(profile+"\n"), 0o644))
+		require.NoError(t, merger.add(profile, 1))
+	}
+
+	// Every batch of profileMergeFanIn profiles was merged into an
+	// intermediate one
+	remaining := merger.remaining()
+	assert.Len(t, remaining, 5)
+
+	output := filepath.Join(tmpDir, "merged.profdata")
+	require.NoError(t, cov.mergeProfiles(output, remaining, 1))
+	content, err := os.ReadFile(output)
+	require.NoError(t, err)
+	got := strings.Split(strings.TrimSpace(string(content)), "\n")
+	sort.Strings(got)
+	sort.Strings(want)
+	assert.Equal(t, want, got)
+}
@@ -0,0 +1,10 @@
+#include <cifuzz/cifuzz.h>
+#include <stdio.h>
+
+FUZZ_TEST_SETUP() {}
+
+FUZZ_TEST(const uint8_t *data, size_t size) {
+  if (size > 0 && data[0] == 'A') {
+    printf("starts with A\n");
+  }
+}
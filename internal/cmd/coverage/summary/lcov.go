@@ -2,10 +2,12 @@ package summary
 
 import (
 	"bufio"
+	"bytes"
 	"encoding/json"
 	"io"
 	"strconv"
-	"strings"
+
+	"github.com/spf13/viper"
 
 	"code-intelligence.com/cifuzz/pkg/log"
 )
@@ -27,31 +29,44 @@ func count(c *Coverage, key string, value int) {
 	}
 }
 
+// The longest line of an lcov report which can be parsed. Lines are
+// short except for the paths of source files.
+const maxLcovLineLength = 16 * 1024 * 1024
+
 // ParseLcov takes a lcov tracefile report and turns it into
 // the `CoverageSummary` struct. The parsing is as forgiving
 // as possible. It will output debug/error logs instead of
 // failing, with the goal to gather as much information as
 // possible
+//
+// The report is read line by line and only the counters of each file
+// are kept, so that huge reports with line and branch records for
+// every source file are parsed in constant memory per file.
 func ParseLcov(in io.Reader) *CoverageSummary {
 	summary := &CoverageSummary{
 		Total: &Coverage{},
 	}
 
 	var currentFile *FileCoverage
+	// The line, branch and function records make up almost all of
+	// a full report, so ignored keys are only counted and unknown
+	// keys are only logged once
+	ignoredRecords := 0
+	unknownKeys := make(map[string]bool)
 
 	// The definition of the lcov tracefile format can be viewed
 	// with `man geninfo`
 	scanner := bufio.NewScanner(in)
+	scanner.Buffer(make([]byte, 0, 64*1024), maxLcovLineLength)
 	for scanner.Scan() {
-		parts := strings.Split(scanner.Text(), ":")
-		key := parts[0]
+		key, value, hasValue := bytes.Cut(scanner.Bytes(), []byte{':'})
 
-		switch key {
+		switch string(key) {
 
 		// SF starts a section (for a single file)
 		case "SF":
 			currentFile = &FileCoverage{
-				Filename: parts[1],
+				Filename: string(value),
 				Coverage: &Coverage{},
 			}
 			summary.Files = append(summary.Files, currentFile)
@@ -62,40 +77,48 @@ func ParseLcov(in io.Reader) *CoverageSummary {
 
 			// high level coverage metrics
 		case "FNF", "FNH", "BRF", "BRH", "LF", "LH":
-			if len(parts) == 1 {
+			if !hasValue {
 				log.Debugf("Parsing lcov: no value for key '%s'", key)
 				break
 			}
 
-			value, err := strconv.Atoi(parts[1])
+			n, err := strconv.Atoi(string(value))
 			if err != nil {
-				log.Errorf(err, "Parsing lcov: unable to convert value %s to int", parts[1])
-				value = 0
+				log.Errorf(err, "Parsing lcov: unable to convert value %s to int", value)
+				n = 0
 			}
 
-			count(summary.Total, key, value)
+			count(summary.Total, string(key), n)
 			if currentFile != nil {
-				count(currentFile.Coverage, key, value)
+				count(currentFile.Coverage, string(key), n)
 			}
 
 		// these keys are (currently) not relevant for cifuzz
 		// so we just ignore them
 		case "TN", "FN", "FNDA", "BRDA", "DA":
-			log.Debugf("Parsing lcov: Ignored key '%s'. Not implemented by now. ", key)
+			ignoredRecords++
 
 		// this branch should only be reached if a key shows up
 		// that is not defined in the format specification
 		default:
-			log.Debugf("Parsing lcov: Unknown key '%s'", key)
-
+			if !unknownKeys[string(key)] {
+				unknownKeys[string(key)] = true
+				log.Debugf("Parsing lcov: Unknown key '%s'", key)
+			}
 		}
 	}
-
-	out, err := json.MarshalIndent(summary, "", "    ")
-	if err != nil {
-		log.Error(err, "Parsing lcov: Unable to convert coverage summary to json")
-	} else {
-		log.Debugf("Successfully parsed lcov report : %s", string(out))
+	if err := scanner.Err(); err != nil {
+		log.Errorf(err, "Parsing lcov: unable to read the report")
+	}
+	log.Debugf("Parsing lcov: Ignored %d TN, FN, FNDA, BRDA and DA records", ignoredRecords)
+
+	if viper.GetBool("verbose") {
+		out, err := json.MarshalIndent(summary, "", "    ")
+		if err != nil {
+			log.Error(err, "Parsing lcov: Unable to convert coverage summary to json")
+		} else {
+			log.Debugf("Successfully parsed lcov report : %s", string(out))
+		}
 	}
 
 	return summary
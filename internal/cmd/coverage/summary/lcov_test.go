@@ -1,6 +1,7 @@
 package summary
 
 import (
+	"fmt"
 	"strings"
 	"testing"
 
@@ -115,3 +116,28 @@ func TestParseLcov_Empty(t *testing.T) {
 	assert.Empty(t, summary.Total.LinesFound)
 	assert.Empty(t, summary.Total.FunctionsFound)
 }
+
+func TestParseLcov_FilenameWithColon(t *testing.T) {
+	report := `SF:C:\src\foo.cpp
+LH:1
+LF:2
+end_of_record
+`
+
+	summary := ParseLcov(strings.NewReader(report))
+	assert.Equal(t, `C:\src\foo.cpp`, summary.Files[0].Filename)
+	assert.Equal(t, 2, summary.Files[0].Coverage.LinesFound)
+}
+
+func TestParseLcov_LineRecords(t *testing.T) {
+	var report strings.Builder
+	report.WriteString("SF:foo.cpp\n")
+	for i := 1; i <= 100000; i++ {
+		fmt.Fprintf(&report, "DA:%d,1\n", i)
+	}
+	report.WriteString("LH:100000\nLF:100000\nend_of_record\n")
+
+	summary := ParseLcov(strings.NewReader(report.String()))
+	assert.Equal(t, 100000, summary.Total.LinesHit)
+	assert.Equal(t, 100000, summary.Files[0].Coverage.LinesFound)
+}
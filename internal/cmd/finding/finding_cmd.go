@@ -74,12 +74,11 @@ func (cmd *findingCmd) run(args []string) error {
 	if len(args) == 0 {
 		// If called without arguments, `cifuzz findings` lists short
 		// descriptions of all findings
-		findings, err := finding.ListFindings(cmd.opts.ProjectDir)
-		if err != nil {
-			return err
-		}
-
 		if cmd.opts.PrintJSON {
+			findings, err := finding.ListFindings(cmd.opts.ProjectDir)
+			if err != nil {
+				return err
+			}
 			s, err := stringutil.ToJSONString(findings)
 			if err != nil {
 				return err
@@ -88,6 +87,12 @@ func (cmd *findingCmd) run(args []string) error {
 			return nil
 		}
 
+		// The table only needs the summaries from the index
+		findings, err := finding.ListFindingSummaries(cmd.opts.ProjectDir)
+		if err != nil {
+			return err
+		}
+
 		if len(findings) == 0 {
 			log.Print("This project doesn't have any findings yet")
 			return nil
@@ -99,26 +104,26 @@ func (cmd *findingCmd) run(args []string) error {
 			{"Severity", "Name", "Description", "FuzzTest", "Location"},
 		}
 		for _, f := range findings {
-			if f.MoreDetails != nil {
-				colorFunc := getColorFunctionForSeverity(f.MoreDetails.Severity.Score)
+			if f.Severity != nil {
+				colorFunc := getColorFunctionForSeverity(f.Severity.Score)
 
 				data = append(data, []string{
-					colorFunc(fmt.Sprintf("%.1f", f.MoreDetails.Severity.Score)),
+					colorFunc(fmt.Sprintf("%.1f", f.Severity.Score)),
 					f.Name,
-					// FIXME: replace f.ShortDescriptionColumns()[0] with
+					// FIXME: replace f.ShortDescriptionColumns[0] with
 					// f.MoreDetails.Name once we cover all bugs with our
 					// error-details.json
-					f.ShortDescriptionColumns()[0],
+					f.ShortDescriptionColumns[0],
 					f.FuzzTest,
-					f.ShortDescriptionColumns()[1],
+					f.ShortDescriptionColumns[1],
 				})
 			} else {
 				data = append(data, []string{
 					"n/a",
 					f.Name,
-					f.ShortDescriptionColumns()[0],
+					f.ShortDescriptionColumns[0],
 					f.FuzzTest,
-					f.ShortDescriptionColumns()[1],
+					f.ShortDescriptionColumns[1],
 				})
 			}
 		}
@@ -5,6 +5,7 @@ import (
 	"io"
 	"os"
 	"strings"
+	"sync/atomic"
 	"time"
 
 	"github.com/mitchellh/ioprogress"
@@ -42,3 +43,55 @@ func DrawProgressBar(w io.Writer, drawFormatBar ioprogress.DrawTextFormatFunc, s
 		return err
 	}
 }
+
+// Counter draws the progress of an operation whose parts complete in
+// any order, like the chunks of an upload which are sent in parallel.
+type Counter struct {
+	size     int64
+	progress atomic.Int64
+	draw     ioprogress.DrawFunc
+	done     chan struct{}
+	stopped  chan struct{}
+}
+
+func NewCounter(size int64, successMessage string) *Counter {
+	c := &Counter{
+		size:    size,
+		draw:    DrawProgressBar(os.Stdout, ioprogress.DrawTextFormatBar(60), successMessage),
+		done:    make(chan struct{}),
+		stopped: make(chan struct{}),
+	}
+	go func() {
+		defer close(c.stopped)
+		ticker := time.NewTicker(100 * time.Millisecond)
+		defer ticker.Stop()
+		for {
+			select {
+			case <-ticker.C:
+				_ = c.draw(c.progress.Load(), c.size)
+			case <-c.done:
+				return
+			}
+		}
+	}()
+	return c
+}
+
+// Add adds n completed bytes.
+func (c *Counter) Add(n int64) {
+	c.progress.Add(n)
+}
+
+// Stop stops drawing the progress bar and prints the success message if
+// the operation completed.
+func (c *Counter) Stop() {
+	close(c.done)
+	<-c.stopped
+	progress := c.progress.Load()
+	_ = c.draw(progress, c.size)
+	if progress == c.size {
+		_ = c.draw(-1, -1)
+	} else {
+		fmt.Println()
+	}
+}
@@ -16,6 +16,7 @@ import (
 
 	"code-intelligence.com/cifuzz/internal/api"
 	"code-intelligence.com/cifuzz/internal/bundler"
+	"code-intelligence.com/cifuzz/internal/bundler/archive"
 	"code-intelligence.com/cifuzz/internal/cmdutils"
 	"code-intelligence.com/cifuzz/internal/cmdutils/login"
 	"code-intelligence.com/cifuzz/internal/cmdutils/resolve"
@@ -29,11 +30,12 @@ import (
 )
 
 type remoteRunOpts struct {
-	bundler.Opts `mapstructure:",squash"`
-	Interactive  bool   `mapstructure:"interactive"`
-	PrintJSON    bool   `mapstructure:"print-json"`
-	ProjectName  string `mapstructure:"project"`
-	Server       string `mapstructure:"server"`
+	bundler.Opts  `mapstructure:",squash"`
+	ChunkedUpload bool   `mapstructure:"chunked-upload"`
+	Interactive   bool   `mapstructure:"interactive"`
+	PrintJSON     bool   `mapstructure:"print-json"`
+	ProjectName   string `mapstructure:"project"`
+	Server        string `mapstructure:"server"`
 
 	// Fields which are not configurable via viper (i.e. via cifuzz.yaml
 	// and CIFUZZ_* environment variables), by setting
@@ -206,17 +208,22 @@ https://github.com/CodeIntelligenceTesting/cifuzz/issues`, system)
 		cmdutils.AddBuildCommandFlag,
 		cmdutils.AddCleanCommandFlag,
 		cmdutils.AddBuildJobsFlag,
+		cmdutils.AddBuildProfileFlag,
+		cmdutils.AddChunkedUploadFlag,
 		cmdutils.AddCommitFlag,
+		cmdutils.AddCompilerLauncherFlag,
 		cmdutils.AddDictFlag,
 		cmdutils.AddDockerImageFlag,
 		cmdutils.AddEngineArgFlag,
 		cmdutils.AddEnvFlag,
 		cmdutils.AddInteractiveFlag,
 		cmdutils.AddPrintJSONFlag,
+		cmdutils.AddPGOProfileFlag,
 		cmdutils.AddProjectDirFlag,
 		cmdutils.AddProjectFlag,
 		cmdutils.AddSeedCorpusFlag,
 		cmdutils.AddServerFlag,
+		cmdutils.AddThinLTOFlag,
 		cmdutils.AddTimeoutFlag,
 		cmdutils.AddResolveSourceFileFlag,
 	)
@@ -339,26 +346,70 @@ func (c *runRemoteCmd) run() error {
 		}
 	}
 
-	artifact, err := apiClient.UploadBundle(c.opts.BundlePath, c.opts.ProjectName, token)
-	if err != nil {
-		var apiErr *api.APIError
-		if !errors.As(err, &apiErr) {
+	// Don't upload the bundle again if it didn't change since the last
+	// upload, e.g. because nothing was changed since the last nightly
+	// run
+	var digest string
+	if c.opts.ProjectDir != "" {
+		digest, err = archive.ContentDigest(c.opts.BundlePath)
+		if err != nil {
+			log.Debugf("Failed to compute the digest of the bundle: %v", err)
+			digest = ""
+		}
+	}
+
+	var artifact *api.Artifact
+	var campaignRunName string
+	if digest != "" {
+		artifact, err = findUploadedBundle(c.opts.ProjectDir, c.opts.Server, c.opts.ProjectName, digest)
+		if err != nil {
+			log.Debugf("Failed to read the uploaded bundles: %v", err)
+		}
+	}
+	if artifact != nil {
+		log.Infof("The bundle was already uploaded as %s, skipping the upload", artifact.DisplayName)
+		campaignRunName, err = apiClient.StartRemoteFuzzingRun(artifact, token)
+		if err != nil {
+			// The artifact might have been deleted on the server, so we
+			// upload the bundle again
+			log.Debugf("Failed to start a run with the uploaded artifact %s: %v", artifact.ResourceName, err)
+			artifact = nil
+		}
+	}
+
+	if artifact == nil {
+		if c.opts.ChunkedUpload {
+			artifact, err = c.uploadBundleInChunks(apiClient, token, digest)
+		} else {
+			artifact, err = apiClient.UploadBundle(c.opts.BundlePath, c.opts.ProjectName, token)
+		}
+		if err != nil {
+			var apiErr *api.APIError
+			if !errors.As(err, &apiErr) {
+				// API calls might fail due to network issues, invalid server
+				// responses or similar. We don't want to print a stack trace
+				// in those cases.
+				log.Error(err)
+				return cmdutils.WrapSilentError(err)
+			}
+			return err
+		}
+
+		if digest != "" {
+			err = rememberUploadedBundle(c.opts.ProjectDir, c.opts.Server, c.opts.ProjectName, digest, artifact)
+			if err != nil {
+				log.Debugf("Failed to remember the uploaded bundle: %v", err)
+			}
+		}
+
+		campaignRunName, err = apiClient.StartRemoteFuzzingRun(artifact, token)
+		if err != nil {
 			// API calls might fail due to network issues, invalid server
 			// responses or similar. We don't want to print a stack trace
 			// in those cases.
 			log.Error(err)
 			return cmdutils.WrapSilentError(err)
 		}
-		return err
-	}
-
-	campaignRunName, err := apiClient.StartRemoteFuzzingRun(artifact, token)
-	if err != nil {
-		// API calls might fail due to network issues, invalid server
-		// responses or similar. We don't want to print a stack trace
-		// in those cases.
-		log.Error(err)
-		return cmdutils.WrapSilentError(err)
 	}
 
 	if c.opts.PrintJSON {
@@ -395,6 +446,27 @@ func (c *runRemoteCmd) run() error {
 	return nil
 }
 
+// uploadBundleInChunks uploads the bundle in chunks and resumes the
+// upload of the same bundle if a previous remote run was interrupted.
+func (c *runRemoteCmd) uploadBundleInChunks(apiClient *api.APIClient, token string, digest string) (*api.Artifact, error) {
+	var err error
+	uploadOpts := &api.ChunkedUploadOptions{}
+	if digest != "" {
+		// Resume the upload if it was interrupted before
+		uploadOpts.ResumeUpload, err = findPendingUpload(c.opts.ProjectDir, c.opts.Server, c.opts.ProjectName, digest)
+		if err != nil {
+			log.Debugf("Failed to read the uploaded bundles: %v", err)
+		}
+		uploadOpts.OnUploadCreated = func(name string) {
+			err := rememberPendingUpload(c.opts.ProjectDir, c.opts.Server, c.opts.ProjectName, digest, name)
+			if err != nil {
+				log.Debugf("Failed to remember the pending upload: %v", err)
+			}
+		}
+	}
+	return apiClient.UploadBundleInChunks(c.opts.BundlePath, c.opts.ProjectName, token, uploadOpts)
+}
+
 func (c *runRemoteCmd) selectProject(projects []*api.Project) (string, error) {
 	// Let the user select a project
 	var displayNames []string
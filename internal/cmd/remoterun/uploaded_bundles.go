@@ -0,0 +1,125 @@
+package remoterun
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/api"
+)
+
+// The maximum number of uploaded bundles which are remembered
+const maxUploadedBundles = 20
+
+// uploadedBundle is a bundle which was uploaded to a project on a
+// server before, identified by the digest of its contents, see
+// archive.ContentDigest. If the upload was interrupted, Artifact is
+// nil and Upload is the name of the chunked upload to resume.
+type uploadedBundle struct {
+	Server   string        `json:"server"`
+	Project  string        `json:"project"`
+	Digest   string        `json:"digest"`
+	Artifact *api.Artifact `json:"artifact"`
+	Upload   string        `json:"upload,omitempty"`
+}
+
+func uploadedBundlesPath(projectDir string) string {
+	return filepath.Join(projectDir, ".cifuzz-build", "uploaded-bundles.json")
+}
+
+func readUploadedBundles(projectDir string) ([]*uploadedBundle, error) {
+	content, err := os.ReadFile(uploadedBundlesPath(projectDir))
+	if os.IsNotExist(err) {
+		return nil, nil
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	var bundles []*uploadedBundle
+	err = json.Unmarshal(content, &bundles)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return bundles, nil
+}
+
+func writeUploadedBundles(projectDir string, bundles []*uploadedBundle) error {
+	content, err := json.Marshal(bundles)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	path := uploadedBundlesPath(projectDir)
+	err = os.MkdirAll(filepath.Dir(path), 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(os.WriteFile(path, content, 0o644))
+}
+
+// findUploadedBundle returns the artifact of the bundle with the given
+// digest if it was uploaded to the project before, else nil
+func findUploadedBundle(projectDir, server, project, digest string) (*api.Artifact, error) {
+	bundles, err := readUploadedBundles(projectDir)
+	if err != nil {
+		return nil, err
+	}
+	for _, b := range bundles {
+		if b.Server == server && b.Project == project && b.Digest == digest && b.Artifact != nil {
+			return b.Artifact, nil
+		}
+	}
+	return nil, nil
+}
+
+// findPendingUpload returns the name of the chunked upload of the
+// bundle with the given digest if it was interrupted before, else "".
+func findPendingUpload(projectDir, server, project, digest string) (string, error) {
+	bundles, err := readUploadedBundles(projectDir)
+	if err != nil {
+		return "", err
+	}
+	for _, b := range bundles {
+		if b.Server == server && b.Project == project && b.Digest == digest && b.Artifact == nil {
+			return b.Upload, nil
+		}
+	}
+	return "", nil
+}
+
+// rememberUploadedBundle records the artifact of an uploaded bundle,
+// replacing any previous artifact or pending upload of a bundle with
+// the same digest. If artifact is nil, only the previous artifact is
+// removed.
+func rememberUploadedBundle(projectDir, server, project, digest string, artifact *api.Artifact) error {
+	return rememberBundle(projectDir, &uploadedBundle{Server: server, Project: project, Digest: digest, Artifact: artifact})
+}
+
+// rememberPendingUpload records the name of the chunked upload of a
+// bundle, so that it can be resumed if it is interrupted.
+func rememberPendingUpload(projectDir, server, project, digest, upload string) error {
+	return rememberBundle(projectDir, &uploadedBundle{Server: server, Project: project, Digest: digest, Upload: upload})
+}
+
+func rememberBundle(projectDir string, bundle *uploadedBundle) error {
+	bundles, err := readUploadedBundles(projectDir)
+	if err != nil {
+		return err
+	}
+
+	var res []*uploadedBundle
+	for _, b := range bundles {
+		if b.Server == bundle.Server && b.Project == bundle.Project && b.Digest == bundle.Digest {
+			continue
+		}
+		res = append(res, b)
+	}
+	if bundle.Artifact != nil || bundle.Upload != "" {
+		res = append(res, bundle)
+	}
+	if len(res) > maxUploadedBundles {
+		res = res[len(res)-maxUploadedBundles:]
+	}
+	return writeUploadedBundles(projectDir, res)
+}
@@ -0,0 +1,99 @@
+package run
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"sort"
+	"time"
+
+	"github.com/pkg/errors"
+)
+
+const (
+	// The maximum number of previous runs of a fuzz test from which its
+	// exec/s baseline is computed
+	maxExecsBaselineRuns = 10
+	// The minimum number of previous runs before runs are compared to
+	// the baseline, because the exec/s of single runs vary
+	minExecsBaselineRuns = 3
+	// Runs in which the exec/s were measured for a shorter time are not
+	// added to the baseline
+	minExecsBaselineDuration = 10 * time.Second
+)
+
+// execsBaseline are the exec/s of the last runs of a fuzz test with the
+// same options, see runOptions.variant.
+type execsBaseline struct {
+	FuzzTest       string   `json:"fuzz_test"`
+	Variant        string   `json:"variant"`
+	ExecsPerSecond []uint64 `json:"execs_per_second"`
+}
+
+func execsBaselinesPath(projectDir string) string {
+	return filepath.Join(projectDir, ".cifuzz-build", "execs-baselines.json")
+}
+
+func readExecsBaselines(projectDir string) ([]*execsBaseline, error) {
+	content, err := os.ReadFile(execsBaselinesPath(projectDir))
+	if os.IsNotExist(err) {
+		return nil, nil
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	var baselines []*execsBaseline
+	err = json.Unmarshal(content, &baselines)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return baselines, nil
+}
+
+func writeExecsBaselines(projectDir string, baselines []*execsBaseline) error {
+	content, err := json.Marshal(baselines)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	path := execsBaselinesPath(projectDir)
+	err = os.MkdirAll(filepath.Dir(path), 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(os.WriteFile(path, content, 0o644))
+}
+
+// updateExecsBaseline adds the exec/s of a run to the baseline of the
+// fuzz test and variant. It returns the median exec/s of the previous
+// runs, or 0 if there were too few of them.
+func updateExecsBaseline(projectDir, fuzzTest, variant string, execs uint64) (uint64, error) {
+	baselines, err := readExecsBaselines(projectDir)
+	if err != nil {
+		return 0, err
+	}
+
+	var baseline *execsBaseline
+	for _, b := range baselines {
+		if b.FuzzTest == fuzzTest && b.Variant == variant {
+			baseline = b
+			break
+		}
+	}
+	if baseline == nil {
+		baseline = &execsBaseline{FuzzTest: fuzzTest, Variant: variant}
+		baselines = append(baselines, baseline)
+	}
+
+	var median uint64
+	if len(baseline.ExecsPerSecond) >= minExecsBaselineRuns {
+		sorted := append([]uint64{}, baseline.ExecsPerSecond...)
+		sort.Slice(sorted, func(i, j int) bool { return sorted[i] < sorted[j] })
+		median = sorted[len(sorted)/2]
+	}
+
+	baseline.ExecsPerSecond = append(baseline.ExecsPerSecond, execs)
+	if len(baseline.ExecsPerSecond) > maxExecsBaselineRuns {
+		baseline.ExecsPerSecond = baseline.ExecsPerSecond[len(baseline.ExecsPerSecond)-maxExecsBaselineRuns:]
+	}
+	return median, writeExecsBaselines(projectDir, baselines)
+}
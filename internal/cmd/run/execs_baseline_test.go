@@ -0,0 +1,45 @@
+package run
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestUpdateExecsBaseline(t *testing.T) {
+	projectDir := t.TempDir()
+
+	// There is no baseline before minExecsBaselineRuns runs
+	for _, execs := range []uint64{1000, 1200, 900} {
+		baseline, err := updateExecsBaseline(projectDir, "my_fuzz_test", "engine=libfuzzer", execs)
+		require.NoError(t, err)
+		assert.Zero(t, baseline)
+	}
+
+	// The baseline is the median of the previous runs
+	baseline, err := updateExecsBaseline(projectDir, "my_fuzz_test", "engine=libfuzzer", 500)
+	require.NoError(t, err)
+	assert.EqualValues(t, 1000, baseline)
+
+	// Other fuzz tests and variants have their own baselines
+	baseline, err = updateExecsBaseline(projectDir, "my_fuzz_test", "engine=libfuzzer,sandbox", 500)
+	require.NoError(t, err)
+	assert.Zero(t, baseline)
+	baseline, err = updateExecsBaseline(projectDir, "other_fuzz_test", "engine=libfuzzer", 500)
+	require.NoError(t, err)
+	assert.Zero(t, baseline)
+
+	// Only the last maxExecsBaselineRuns runs are kept
+	for i := 0; i < maxExecsBaselineRuns; i++ {
+		_, err = updateExecsBaseline(projectDir, "my_fuzz_test", "engine=libfuzzer", 2000)
+		require.NoError(t, err)
+	}
+	baselines, err := readExecsBaselines(projectDir)
+	require.NoError(t, err)
+	require.Len(t, baselines, 3)
+	assert.Len(t, baselines[0].ExecsPerSecond, maxExecsBaselineRuns)
+	baseline, err = updateExecsBaseline(projectDir, "my_fuzz_test", "engine=libfuzzer", 2000)
+	require.NoError(t, err)
+	assert.EqualValues(t, 2000, baseline)
+}
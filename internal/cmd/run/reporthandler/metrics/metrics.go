@@ -38,7 +38,7 @@ func MetricsToString(metrics *report.FuzzingMetric) string {
 		executionsPerSecond = strconv.FormatInt(int64(metrics.ExecutionsPerSecond), 10)
 	}
 
-	return fmt.Sprint(DescString("paths: "),
+	s := fmt.Sprint(DescString("paths: "),
 		NumberString("%s", paths),
 		DelimString(" - "),
 		DescString("last new path: "),
@@ -47,4 +47,13 @@ func MetricsToString(metrics *report.FuzzingMetric) string {
 		DescString("exec/s: "),
 		NumberString("%s", executionsPerSecond),
 	)
+	// The memory usage is only known if the fuzzer runs in a sandbox
+	// with resource limits
+	if metrics != nil && metrics.MemoryBytes != 0 {
+		s += fmt.Sprint(DelimString(" - "),
+			DescString("mem: "),
+			NumberString("%dMiB", metrics.MemoryBytes>>20),
+		)
+	}
+	return s
 }
@@ -44,6 +44,9 @@ type ReportHandler struct {
 	LastMetrics  *report.FuzzingMetric
 	FirstMetrics *report.FuzzingMetric
 	ErrorDetails *[]finding.ErrorDetails
+	// The resources used by the fuzzer, which are reported when it
+	// exited
+	ResourceUsage *report.ResourceUsage
 
 	numSeedsAtInit uint
 
@@ -51,6 +54,10 @@ type ReportHandler struct {
 
 	FuzzTest string
 	Findings []*finding.Finding
+	// The stack hashes of the Findings, see finding.StackHash
+	stackHashes map[string]bool
+	// The number of findings which were skipped as duplicates
+	numDuplicateFindings int
 }
 
 func NewReportHandler(fuzzTest string, options *ReportHandlerOptions) (*ReportHandler, error) {
@@ -112,7 +119,27 @@ func (h *ReportHandler) Handle(r *report.Report) error {
 		h.printer.PrintMetrics(r.Metric)
 	}
 
+	if r.ResourceUsage != nil {
+		h.ResourceUsage = r.ResourceUsage
+	}
+
 	if r.Finding != nil {
+		// Fuzz tests which don't stop at the first finding can report
+		// the same bug over and over, with different inputs. Only the
+		// first one is saved.
+		stackHash := r.Finding.StackHash()
+		if stackHash != "" && h.stackHashes[stackHash] {
+			h.numDuplicateFindings++
+			log.Debugf("Skipping duplicate finding: %s", r.Finding.ShortDescription())
+			return nil
+		}
+		if stackHash != "" {
+			if h.stackHashes == nil {
+				h.stackHashes = make(map[string]bool)
+			}
+			h.stackHashes[stackHash] = true
+		}
+
 		// save finding
 		h.Findings = append(h.Findings, r.Finding)
 
@@ -253,6 +280,26 @@ regression tests. For more information on regression tests, see:
 `, strings.Join(crashingInputs, "\n    "))
 }
 
+// AverageExecsPerSecond returns the average exec/s between the first
+// and the last metrics and the duration between them. It returns false
+// if no metrics were reported.
+func (h *ReportHandler) AverageExecsPerSecond() (uint64, time.Duration, bool) {
+	if h.FirstMetrics == nil {
+		return 0, 0, false
+	}
+	metricsDuration := h.LastMetrics.Timestamp.Sub(h.FirstMetrics.Timestamp)
+	if metricsDuration.Milliseconds() == 0 {
+		// The first and last metrics are either the same or were
+		// printed too fast one after the other to calculate a
+		// meaningful average, so we just use the exec/s from the
+		// current metrics as the average.
+		return uint64(h.LastMetrics.ExecutionsPerSecond), metricsDuration, true
+	}
+	// We use milliseconds here to calculate a more accurate average
+	execs := h.LastMetrics.TotalExecutions - h.FirstMetrics.TotalExecutions
+	return uint64(float64(execs) / (float64(metricsDuration.Milliseconds()) / 1000)), metricsDuration, true
+}
+
 func (h *ReportHandler) PrintFinalMetrics(numCorpusEntries uint) error {
 	// We don't want to print colors to stderr unless it's a TTY
 	if !term.IsTerminal(int(os.Stderr.Fd())) {
@@ -279,34 +326,25 @@ func (h *ReportHandler) PrintFinalMetrics(numCorpusEntries uint) error {
 	newCorpusEntries := totalCorpusEntries - h.numSeedsAtInit
 
 	var averageExecsStr string
-
-	if h.FirstMetrics == nil {
-		averageExecsStr = metrics.NumberString("n/a")
-	} else {
-		var averageExecs uint64
-		metricsDuration := h.LastMetrics.Timestamp.Sub(h.FirstMetrics.Timestamp)
-		if metricsDuration.Milliseconds() == 0 {
-			// The first and last metrics are either the same or were
-			// printed too fast one after the other to calculate a
-			// meaningful average, so we just use the exec/s from the
-			// current metrics as the average.
-			averageExecs = uint64(h.LastMetrics.ExecutionsPerSecond)
-		} else {
-			// We use milliseconds here to calculate a more accurate average
-			execs := h.LastMetrics.TotalExecutions - h.FirstMetrics.TotalExecutions
-			averageExecs = uint64(float64(execs) / (float64(metricsDuration.Milliseconds()) / 1000))
-		}
+	if averageExecs, _, ok := h.AverageExecsPerSecond(); ok {
 		averageExecsStr = metrics.NumberString("%d", averageExecs)
+	} else {
+		averageExecsStr = metrics.NumberString("n/a")
 	}
 
 	// Round towards the next larger second to avoid that very short
 	// runs show "Ran for 0s".
 	durationStr := (duration.Truncate(time.Second) + time.Second).String()
 
+	findingsStr := metrics.NumberString("%d", len(h.Findings))
+	if h.numDuplicateFindings > 0 {
+		findingsStr += metrics.DescString(" (%s duplicates skipped)", metrics.NumberString("%d", h.numDuplicateFindings))
+	}
+
 	lines := []string{
 		metrics.DescString("Execution time:\t") + metrics.NumberString(durationStr),
 		metrics.DescString("Average exec/s:\t") + averageExecsStr,
-		metrics.DescString("Findings:\t") + metrics.NumberString("%d", len(h.Findings)),
+		metrics.DescString("Findings:\t") + findingsStr,
 		metrics.DescString("Corpus entries:\t") + metrics.NumberString("%d", totalCorpusEntries) +
 			metrics.DescString(" (+%s)", metrics.NumberString("%d", newCorpusEntries)),
 	}
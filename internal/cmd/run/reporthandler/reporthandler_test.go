@@ -15,6 +15,7 @@ import (
 	"code-intelligence.com/cifuzz/internal/testutil"
 	"code-intelligence.com/cifuzz/pkg/finding"
 	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/parser/libfuzzer/stacktrace"
 	"code-intelligence.com/cifuzz/pkg/report"
 )
 
@@ -148,6 +149,29 @@ func TestReportHandler_GenerateName(t *testing.T) {
 	assert.Equal(t, "adoring_orangutan", findingReport.Finding.Name)
 }
 
+func TestReportHandler_DuplicateFinding(t *testing.T) {
+	h, err := NewReportHandler("", &ReportHandlerOptions{ProjectDir: testDir, PrintJSON: true})
+	require.NoError(t, err)
+
+	newFindingReport := func(input string) *report.Report {
+		return &report.Report{
+			Status: report.RunStatusRunning,
+			Finding: &finding.Finding{
+				Type:      finding.ErrorTypeRuntimeError,
+				Details:   "undefined behavior: signed integer overflow",
+				InputData: []byte(input),
+				StackTrace: []*stacktrace.StackFrame{
+					{SourceFile: "src/explore_me.cpp", Line: 18, Column: 11, Function: "exploreMe"},
+				},
+			},
+		}
+	}
+	require.NoError(t, h.Handle(newFindingReport("1")))
+	require.NoError(t, h.Handle(newFindingReport("2")))
+	assert.Len(t, h.Findings, 1)
+	assert.Equal(t, 1, h.numDuplicateFindings)
+}
+
 func checkOutput(t *testing.T, r io.Reader, s ...string) {
 	output, err := io.ReadAll(r)
 	require.NoError(t, err)
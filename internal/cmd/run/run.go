@@ -41,7 +41,10 @@ import (
 	"code-intelligence.com/cifuzz/pkg/finding"
 	"code-intelligence.com/cifuzz/pkg/log"
 	"code-intelligence.com/cifuzz/pkg/messaging"
+	"code-intelligence.com/cifuzz/pkg/minijail"
 	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/pkg/runner/aflpp"
+	"code-intelligence.com/cifuzz/pkg/runner/centipede"
 	"code-intelligence.com/cifuzz/pkg/runner/jazzer"
 	"code-intelligence.com/cifuzz/pkg/runner/libfuzzer"
 	"code-intelligence.com/cifuzz/util/fileutil"
@@ -49,24 +52,48 @@ import (
 )
 
 type runOptions struct {
-	BuildSystem           string        `mapstructure:"build-system"`
-	BuildCommand          string        `mapstructure:"build-command"`
-	CleanCommand          string        `mapstructure:"clean-command"`
-	NumBuildJobs          uint          `mapstructure:"build-jobs"`
-	Dictionary            string        `mapstructure:"dict"`
-	EngineArgs            []string      `mapstructure:"engine-args"`
-	SeedCorpusDirs        []string      `mapstructure:"seed-corpus-dirs"`
-	Timeout               time.Duration `mapstructure:"timeout"`
-	Interactive           bool          `mapstructure:"interactive"`
-	Server                string        `mapstructure:"server"`
-	Project               string        `mapstructure:"project"`
-	UseSandbox            bool          `mapstructure:"use-sandbox"`
-	PrintJSON             bool          `mapstructure:"print-json"`
-	BuildOnly             bool          `mapstructure:"build-only"`
-	ResolveSourceFilePath bool
+	BuildSystem              string        `mapstructure:"build-system"`
+	BuildCache               bool          `mapstructure:"build-cache"`
+	BuildCommand             string        `mapstructure:"build-command"`
+	CleanCommand             string        `mapstructure:"clean-command"`
+	NumBuildJobs             uint          `mapstructure:"build-jobs"`
+	BuildProfile             string        `mapstructure:"build-profile"`
+	ThinLTO                  bool          `mapstructure:"thinlto"`
+	CompilerLauncher         string        `mapstructure:"compiler-launcher"`
+	CorpusTmpfsSize          string        `mapstructure:"corpus-tmpfs-size"`
+	CorpusMergeThreshold     uint          `mapstructure:"merge-corpus-above"`
+	CorpusMergeInterval      time.Duration `mapstructure:"merge-corpus-every"`
+	DeferSymbolization       bool          `mapstructure:"defer-symbolization"`
+	AutoDictionary           bool          `mapstructure:"auto-dict"`
+	Dictionary               string        `mapstructure:"dict"`
+	Engine                   string        `mapstructure:"engine"`
+	EngineArgs               []string      `mapstructure:"engine-args"`
+	ExecsRegressionThreshold uint          `mapstructure:"execs-regression-threshold"`
+	FuzzingFocusDirs         []string      `mapstructure:"fuzzing-focus-dirs"`
+	FuzzingIgnoreDirs        []string      `mapstructure:"fuzzing-ignore-dirs"`
+	PlateauMinNewFeatures    uint          `mapstructure:"plateau-min-new-features"`
+	PlateauTimeout           time.Duration `mapstructure:"plateau-timeout"`
+	SeedCorpusDirs           []string      `mapstructure:"seed-corpus-dirs"`
+	Timeout                  time.Duration `mapstructure:"timeout"`
+	TimeSlice                time.Duration `mapstructure:"time-slice"`
+	Interactive              bool          `mapstructure:"interactive"`
+	Server                   string        `mapstructure:"server"`
+	Project                  string        `mapstructure:"project"`
+	SandboxCPUWeight         uint          `mapstructure:"sandbox-cpu-weight"`
+	SandboxMemoryMax         uint          `mapstructure:"sandbox-memory-max"`
+	SanitizerProfile         string        `mapstructure:"sanitizer-profile"`
+	SyncCorpus               bool          `mapstructure:"sync-corpus"`
+	UseSandbox               bool          `mapstructure:"use-sandbox"`
+	Watch                    bool          `mapstructure:"watch"`
+	Workers                  uint          `mapstructure:"workers"`
+	WorkersMemoryBudget      uint          `mapstructure:"workers-memory-budget"`
+	PrintJSON                bool          `mapstructure:"print-json"`
+	BuildOnly                bool          `mapstructure:"build-only"`
+	ResolveSourceFilePath    bool
 
 	ProjectDir   string
 	fuzzTest     string
+	fuzzTests    []string
 	targetMethod string
 	argsToPass   []string
 
@@ -77,6 +104,11 @@ type runOptions struct {
 func (opts *runOptions) validate() error {
 	var err error
 
+	err = cmdutils.ValidateBuildProfile(opts.BuildProfile)
+	if err != nil {
+		return err
+	}
+
 	opts.SeedCorpusDirs, err = cmdutils.ValidateSeedCorpusDirs(opts.SeedCorpusDirs)
 	if err != nil {
 		log.Error(err, err.Error())
@@ -105,6 +137,49 @@ func (opts *runOptions) validate() error {
 		}
 	}
 
+	for _, flag := range []struct {
+		name string
+		set  bool
+		// Whether the flag only has an effect in the sandbox
+		sandbox bool
+	}{
+		{"auto-dict", opts.AutoDictionary, false},
+		{"corpus-tmpfs-size", opts.CorpusTmpfsSize != "", true},
+		{"merge-corpus-above", opts.CorpusMergeThreshold != 0, false},
+		{"merge-corpus-every", opts.CorpusMergeInterval != 0, false},
+		{"sandbox-cpu-weight", opts.SandboxCPUWeight != 0, true},
+		{"sandbox-memory-max", opts.SandboxMemoryMax != 0, true},
+		{"sanitizer-profile", opts.SanitizerProfile == libfuzzer.SanitizerProfileThroughput, false},
+		{"workers", opts.Workers != 1, false},
+	} {
+		if flag.set && (opts.BuildSystem == config.BuildSystemMaven || opts.BuildSystem == config.BuildSystemGradle) {
+			msg := fmt.Sprintf("Flag %q is only supported for C/C++ fuzz tests", flag.name)
+			return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+		}
+		if flag.set && flag.sandbox && !opts.UseSandbox {
+			msg := fmt.Sprintf("Flag %q requires the sandbox, see \"use-sandbox\"", flag.name)
+			return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+		}
+	}
+	err = libfuzzer.ValidateSanitizerProfile(opts.SanitizerProfile)
+	if err != nil {
+		return cmdutils.WrapIncorrectUsageError(err)
+	}
+	if opts.Engine != "" && opts.Engine != build.EngineLibFuzzer {
+		err = opts.validateEngine()
+		if err != nil {
+			return err
+		}
+	}
+	if opts.Watch && (len(opts.fuzzTests) > 1 || opts.BuildOnly) {
+		msg := "Flag \"watch\" can't be used with multiple fuzz tests or \"build-only\""
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+	if opts.SandboxCPUWeight > 10000 {
+		msg := "Flag \"sandbox-cpu-weight\" must be between 1 and 10000"
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+
 	// To build with other build systems, a build command must be provided
 	if opts.BuildSystem == config.BuildSystemOther && opts.BuildCommand == "" {
 		msg := "Flag \"build-command\" must be set when using build system type \"other\""
@@ -115,16 +190,92 @@ func (opts *runOptions) validate() error {
 		msg := fmt.Sprintf("invalid argument %q for \"--timeout\" flag: timeout can't be less than a second", opts.Timeout)
 		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
 	}
+	if opts.WorkersMemoryBudget != 0 && opts.Workers != 0 {
+		msg := "Flag \"workers-memory-budget\" requires \"--workers=0\""
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+	if opts.PlateauTimeout != 0 && opts.PlateauTimeout < time.Second {
+		msg := fmt.Sprintf("invalid argument %q for \"--plateau-timeout\" flag: timeout can't be less than a second", opts.PlateauTimeout)
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+	if opts.PlateauMinNewFeatures != 0 && opts.PlateauTimeout == 0 {
+		msg := "Flag \"plateau-min-new-features\" requires \"plateau-timeout\""
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+	if len(opts.fuzzTests) > 1 && opts.TimeSlice < time.Second {
+		msg := fmt.Sprintf("invalid argument %q for \"--time-slice\" flag: time slice can't be less than a second", opts.TimeSlice)
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
 
 	return nil
 }
 
+// variant returns the options which affect the exec/s of the fuzz test,
+// see checkExecsRegression.
+func (opts *runOptions) variant() string {
+	variant := fmt.Sprintf("engine=%s,profile=%s,workers=%d", opts.Engine, opts.BuildProfile, opts.Workers)
+	if opts.ThinLTO {
+		variant += ",thinlto"
+	}
+	if opts.UseSandbox {
+		variant += ",sandbox"
+	}
+	return variant
+}
+
+// validateEngine checks that the flags are supported by the engine,
+// which is only called for engines other than libFuzzer.
+func (opts *runOptions) validateEngine() error {
+	err := cmdutils.ValidateEngine(opts.Engine)
+	if err != nil {
+		return err
+	}
+	if opts.BuildSystem != config.BuildSystemCMake {
+		msg := fmt.Sprintf("Flag \"engine\" is only supported for CMake fuzz tests, got build system %q", opts.BuildSystem)
+		return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+	}
+	for _, flag := range []struct {
+		name string
+		set  bool
+	}{
+		{"auto-dict", opts.AutoDictionary},
+		{"corpus-tmpfs-size", opts.CorpusTmpfsSize != ""},
+		{"merge-corpus-above", opts.CorpusMergeThreshold != 0},
+		{"merge-corpus-every", opts.CorpusMergeInterval != 0},
+		{"plateau-timeout", opts.PlateauTimeout != 0},
+		{"sandbox-cpu-weight", opts.SandboxCPUWeight != 0},
+		{"sandbox-memory-max", opts.SandboxMemoryMax != 0},
+		{"sanitizer-profile", opts.SanitizerProfile == libfuzzer.SanitizerProfileThroughput},
+		// afl-clang-lto instruments the fuzz tests in a full LTO link
+		{"thinlto", opts.ThinLTO && opts.Engine == build.EngineAFLPlusPlus},
+		// Centipede shards the corpus across its own workers
+		// The number of workers is only chosen automatically for
+		// libFuzzer
+		{"workers", (opts.Workers > 1 && opts.Engine != build.EngineCentipede) || opts.Workers == 0},
+	} {
+		if flag.set {
+			msg := fmt.Sprintf("Flag %q is not supported with engine %q", flag.name, opts.Engine)
+			return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+		}
+	}
+	if opts.UseSandbox {
+		// The sandbox is enabled by default on Linux, so this is not
+		// an error
+		log.Infof("The %s engine doesn't support the sandbox, running the fuzz test without it", opts.Engine)
+		opts.UseSandbox = false
+	}
+	return nil
+}
+
 type runCmd struct {
 	*cobra.Command
 	opts *runOptions
 
 	reportHandler *reporthandler.ReportHandler
 	tempDir       string
+	// replayFirst are the inputs which are run before fuzzing, see
+	// runWatch
+	replayFirst []string
 }
 
 type runner interface {
@@ -137,11 +288,16 @@ func New() *cobra.Command {
 	var bindFlags func()
 
 	cmd := &cobra.Command{
-		Use:   "run [flags] <fuzz test> [--] [<build system arg>...] ",
+		Use:   "run [flags] <fuzz test>... [--] [<build system arg>...] ",
 		Short: "Build and run a fuzz test",
 		Long: `This command builds and executes a fuzz test. The usage of this command
 depends on the build system configured for the project.
 
+If multiple fuzz tests are specified, they are run one after the other
+in time slices of --time-slice, each using all --workers. Fuzz tests
+which still find new coverage get more time slices than saturated ones.
+The --timeout applies to all fuzz tests together.
+
 ` + pterm.Style{pterm.Reset, pterm.Bold}.Sprint("CMake") + `
   <fuzz test> is the name of the fuzz test defined in the add_fuzz_test
   command in your CMakeLists.txt.
@@ -225,7 +381,7 @@ depends on the build system configured for the project.
 			// were bound to the flags of other commands before.
 			bindFlags()
 
-			// Check correct number of fuzz test args (exactly one)
+			// Check correct number of fuzz test args (at least one)
 			var lenFuzzTestArgs int
 			var argsToPass []string
 			if cmd.ArgsLenAtDash() != -1 {
@@ -235,8 +391,8 @@ depends on the build system configured for the project.
 			} else {
 				lenFuzzTestArgs = len(args)
 			}
-			if lenFuzzTestArgs != 1 {
-				msg := fmt.Sprintf("Exactly one <fuzz test> argument must be provided, got %d", lenFuzzTestArgs)
+			if lenFuzzTestArgs == 0 {
+				msg := "At least one <fuzz test> argument must be provided"
 				return cmdutils.WrapIncorrectUsageError(errors.New(msg))
 			}
 
@@ -249,6 +405,10 @@ depends on the build system configured for the project.
 			// Check if the fuzz test is a method of a class
 			// And remove method from fuzz test argument
 			if strings.Contains(args[0], "::") {
+				if len(args) > 1 {
+					msg := "A fuzz test method can only be selected when running a single fuzz test"
+					return cmdutils.WrapIncorrectUsageError(errors.New(msg))
+				}
 				split := strings.Split(args[0], "::")
 				args[0], opts.targetMethod = split[0], split[1]
 			}
@@ -259,13 +419,14 @@ depends on the build system configured for the project.
 				return cmdutils.WrapSilentError(err)
 			}
 			opts.fuzzTest = fuzzTests[0]
+			opts.fuzzTests = fuzzTests
 
 			opts.argsToPass = argsToPass
 
 			opts.buildStdout = cmd.OutOrStdout()
 			opts.buildStderr = cmd.OutOrStderr()
 			if cmdutils.ShouldLogBuildToFile() {
-				opts.buildStdout, err = cmdutils.BuildOutputToFile(opts.ProjectDir, []string{opts.fuzzTest})
+				opts.buildStdout, err = cmdutils.BuildOutputToFile(opts.ProjectDir, opts.fuzzTests)
 				if err != nil {
 					log.Errorf(err, "Failed to setup logging: %v", err.Error())
 					return cmdutils.WrapSilentError(err)
@@ -284,20 +445,41 @@ depends on the build system configured for the project.
 	// Note: If a flag should be configurable via cifuzz.yaml as well,
 	// bind it to viper in the PreRunE function.
 	funcs := []func(cmd *cobra.Command) func(){
+		cmdutils.AddAutoDictFlag,
+		cmdutils.AddBuildCacheFlag,
 		cmdutils.AddBuildCommandFlag,
 		cmdutils.AddCleanCommandFlag,
 		cmdutils.AddBuildJobsFlag,
 		cmdutils.AddBuildOnlyFlag,
+		cmdutils.AddBuildProfileFlag,
+		cmdutils.AddCompilerLauncherFlag,
+		cmdutils.AddCorpusTmpfsSizeFlag,
+		cmdutils.AddDeferSymbolizationFlag,
 		cmdutils.AddDictFlag,
+		cmdutils.AddEngineFlag,
 		cmdutils.AddEngineArgFlag,
+		cmdutils.AddExecsRegressionThresholdFlag,
 		cmdutils.AddInteractiveFlag,
+		cmdutils.AddMergeCorpusAboveFlag,
+		cmdutils.AddMergeCorpusEveryFlag,
+		cmdutils.AddPlateauMinNewFeaturesFlag,
+		cmdutils.AddPlateauTimeoutFlag,
 		cmdutils.AddPrintJSONFlag,
 		cmdutils.AddProjectFlag,
 		cmdutils.AddProjectDirFlag,
+		cmdutils.AddSandboxCPUWeightFlag,
+		cmdutils.AddSandboxMemoryMaxFlag,
+		cmdutils.AddSanitizerProfileFlag,
 		cmdutils.AddSeedCorpusFlag,
 		cmdutils.AddServerFlag,
+		cmdutils.AddSyncCorpusFlag,
+		cmdutils.AddThinLTOFlag,
+		cmdutils.AddTimeSliceFlag,
 		cmdutils.AddTimeoutFlag,
 		cmdutils.AddUseSandboxFlag,
+		cmdutils.AddWatchFlag,
+		cmdutils.AddWorkersFlag,
+		cmdutils.AddWorkersMemoryBudgetFlag,
 		cmdutils.AddResolveSourceFileFlag,
 	}
 	bindFlags = cmdutils.AddFlags(cmd, funcs...)
@@ -334,17 +516,16 @@ func (c *runCmd) run() error {
 	}
 	defer fileutil.Cleanup(c.tempDir)
 
+	if len(c.opts.fuzzTests) > 1 {
+		return c.runScheduled(authenticatedUser, errorDetails)
+	}
+	if c.opts.Watch {
+		return c.runWatch(errorDetails)
+	}
+
 	buildResult, err := c.buildFuzzTest()
 	if err != nil {
-		var execErr *cmdutils.ExecError
-		if errors.As(err, &execErr) {
-			// It is expected that some commands might fail due to user
-			// configuration so we print the error without the stack trace
-			// (in non-verbose mode) and silence it
-			log.Error(err)
-			return cmdutils.ErrSilent
-		}
-		return err
+		return silenceBuildError(err)
 	}
 
 	if c.opts.BuildOnly {
@@ -366,13 +547,17 @@ func (c *runCmd) run() error {
 	}
 	c.reportHandler.ErrorDetails = errorDetails
 
-	err = c.runFuzzTest(buildResult)
+	// Start from the inputs found by other runs of the fuzz test and
+	// share the ones found by this run afterwards
+	if c.opts.SyncCorpus {
+		c.syncCorpus(authenticatedUser, buildResult)
+	}
+	err = c.runFuzzTest(context.Background(), buildResult)
 	if err != nil {
-		var exitErr *exec.ExitError
-		if errors.As(err, &exitErr) && c.opts.UseSandbox {
-			return cmdutils.WrapCouldBeSandboxError(err)
-		}
-		return err
+		return c.wrapRunError(err)
+	}
+	if c.opts.SyncCorpus {
+		c.syncCorpus(authenticatedUser, buildResult)
 	}
 
 	c.reportHandler.PrintCrashingInputNote()
@@ -382,6 +567,11 @@ func (c *runCmd) run() error {
 		return err
 	}
 
+	err = c.checkExecsRegression()
+	if err != nil {
+		return err
+	}
+
 	// We need this check, otherwise we might hang forever in CI
 	if c.opts.Project == "" && !c.opts.Interactive {
 		log.Info("Skipping upload of findings because no project was specified and running in non-interactive mode.")
@@ -390,7 +580,7 @@ func (c *runCmd) run() error {
 
 	// check if there are findings that should be uploaded
 	if authenticatedUser && len(c.reportHandler.Findings) > 0 {
-		err = c.uploadFindings(c.opts.fuzzTest, c.reportHandler.FirstMetrics, c.reportHandler.LastMetrics, c.opts.NumBuildJobs)
+		err = c.uploadFindings(c.opts.fuzzTest, c.reportHandler.FirstMetrics, c.reportHandler.LastMetrics, c.reportHandler.ResourceUsage, c.opts.NumBuildJobs)
 		if err != nil {
 			return err
 		}
@@ -399,6 +589,28 @@ func (c *runCmd) run() error {
 	return nil
 }
 
+// silenceBuildError prints errors of the build commands, which are
+// expected to fail due to user configuration, without the stack trace
+// (in non-verbose mode) and silences them.
+func silenceBuildError(err error) error {
+	var execErr *cmdutils.ExecError
+	if errors.As(err, &execErr) {
+		log.Error(err)
+		return cmdutils.ErrSilent
+	}
+	return err
+}
+
+// wrapRunError points out that the fuzz test could have failed because
+// of the sandbox.
+func (c *runCmd) wrapRunError(err error) error {
+	var exitErr *exec.ExitError
+	if errors.As(err, &exitErr) && c.opts.UseSandbox {
+		return cmdutils.WrapCouldBeSandboxError(err)
+	}
+	return err
+}
+
 func (c *runCmd) buildFuzzTest() (*build.Result, error) {
 	var err error
 
@@ -484,10 +696,26 @@ func (c *runCmd) buildFuzzTest() (*build.Result, error) {
 			Stdout:    c.opts.buildStdout,
 			Stderr:    c.opts.buildStderr,
 			BuildOnly: c.opts.BuildOnly,
+			Engine:    c.opts.Engine,
+			Profile:   c.opts.BuildProfile,
+			ThinLTO:   c.opts.ThinLTO,
+
+			CompilerLauncher:  c.opts.CompilerLauncher,
+			FuzzingFocusDirs:  c.opts.FuzzingFocusDirs,
+			FuzzingIgnoreDirs: c.opts.FuzzingIgnoreDirs,
 		})
 		if err != nil {
 			return nil, err
 		}
+
+		useCache := c.opts.BuildCache && !c.opts.BuildOnly
+		if useCache {
+			if cachedResults, ok := builder.CachedBuild([]string{c.opts.fuzzTest}); ok {
+				log.Debugf("Nothing changed since %s was built, skipping the build", c.opts.fuzzTest)
+				return cachedResults[0], nil
+			}
+		}
+
 		err = builder.Configure()
 		if err != nil {
 			return nil, err
@@ -502,6 +730,9 @@ func (c *runCmd) buildFuzzTest() (*build.Result, error) {
 		if c.opts.BuildOnly {
 			return nil, nil
 		}
+		if useCache {
+			builder.CacheBuild(buildResults)
+		}
 		return buildResults[0], nil
 
 	case config.BuildSystemMaven:
@@ -592,7 +823,7 @@ func (c *runCmd) buildFuzzTest() (*build.Result, error) {
 	return nil, errors.Errorf("Unsupported build system \"%s\"", c.opts.BuildSystem)
 }
 
-func (c *runCmd) runFuzzTest(buildResult *build.Result) error {
+func (c *runCmd) runFuzzTest(ctx context.Context, buildResult *build.Result) error {
 	if c.opts.targetMethod != "" {
 		log.Infof("Running %s", pterm.Style{pterm.Reset, pterm.FgLightBlue}.Sprintf(c.opts.fuzzTest+"::"+c.opts.targetMethod))
 	} else {
@@ -656,29 +887,67 @@ func (c *runCmd) runFuzzTest(buildResult *build.Result) error {
 		}
 	}
 
+	envVars := []string{"NO_CIFUZZ=1"}
+	if buildResult.RegisteredTest != "" {
+		envVars = append(envVars, "CIFUZZ_TEST="+buildResult.RegisteredTest)
+	}
+
+	var sandboxResources *minijail.Resources
+	if c.opts.SandboxCPUWeight != 0 || c.opts.SandboxMemoryMax != 0 {
+		sandboxResources = &minijail.Resources{
+			CPUWeight: uint64(c.opts.SandboxCPUWeight),
+			MemoryMax: uint64(c.opts.SandboxMemoryMax) << 20,
+		}
+	}
+
 	runnerOpts := &libfuzzer.RunnerOptions{
-		Dictionary:         c.opts.Dictionary,
-		EngineArgs:         c.opts.EngineArgs,
-		EnvVars:            []string{"NO_CIFUZZ=1"},
-		FuzzTarget:         buildResult.Executable,
-		LibraryDirs:        libraryPaths,
-		GeneratedCorpusDir: buildResult.GeneratedCorpus,
-		KeepColor:          !c.opts.PrintJSON,
-		ProjectDir:         c.opts.ProjectDir,
-		ReadOnlyBindings:   []string{buildResult.BuildDir},
-		ReportHandler:      c.reportHandler,
-		SeedCorpusDirs:     seedCorpusDirs,
-		Timeout:            c.opts.Timeout,
-		UseMinijail:        c.opts.UseSandbox,
-		Verbose:            viper.GetBool("verbose"),
+		AutoDictionary:        c.opts.AutoDictionary,
+		AutoWorkers:           c.opts.Workers == 0,
+		CorpusMergeInterval:   c.opts.CorpusMergeInterval,
+		CorpusMergeThreshold:  c.opts.CorpusMergeThreshold,
+		CorpusTmpfsSize:       c.opts.CorpusTmpfsSize,
+		Dictionary:            c.opts.Dictionary,
+		EngineArgs:            c.opts.EngineArgs,
+		EnvVars:               envVars,
+		FuzzTarget:            buildResult.Executable,
+		LibraryDirs:           libraryPaths,
+		GeneratedCorpusDir:    buildResult.GeneratedCorpus,
+		KeepColor:             !c.opts.PrintJSON,
+		PlateauMinNewFeatures: c.opts.PlateauMinNewFeatures,
+		PlateauTimeout:        c.opts.PlateauTimeout,
+		ProjectDir:            c.opts.ProjectDir,
+		ReadOnlyBindings:      []string{buildResult.BuildDir},
+		ReplayFirst:           c.replayFirst,
+		ReportHandler:         c.reportHandler,
+		SandboxResources:      sandboxResources,
+		SanitizerProfile:      c.opts.SanitizerProfile,
+		SeedCorpusDirs:        seedCorpusDirs,
+		Timeout:               c.opts.Timeout,
+		UseMinijail:           c.opts.UseSandbox,
+		Verbose:               viper.GetBool("verbose"),
+		Workers:               c.opts.Workers,
+		WorkersMemoryBudget:   uint64(c.opts.WorkersMemoryBudget) << 20,
 	}
 
 	var runner runner
 
 	switch c.opts.BuildSystem {
 	case config.BuildSystemCMake, config.BuildSystemBazel, config.BuildSystemOther:
-		runner = libfuzzer.NewRunner(runnerOpts)
+		runnerOpts.DeferSymbolization = c.opts.DeferSymbolization
+		switch c.opts.Engine {
+		case build.EngineAFLPlusPlus:
+			runner = aflpp.NewRunner(&aflpp.RunnerOptions{LibfuzzerOptions: runnerOpts})
+		case build.EngineCentipede:
+			runner = centipede.NewRunner(&centipede.RunnerOptions{
+				LibfuzzerOptions: runnerOpts,
+				WorkDir:          filepath.Join(buildResult.BuildDir, ".cifuzz-centipede", c.opts.fuzzTest),
+			})
+		default:
+			runner = libfuzzer.NewRunner(runnerOpts)
+		}
 	case config.BuildSystemMaven, config.BuildSystemGradle:
+		// DeferSymbolization isn't passed on, because the JVM prints the
+		// Java stack traces on its own
 		runnerOpts := &jazzer.RunnerOptions{
 			TargetClass:      c.opts.fuzzTest,
 			TargetMethod:     c.opts.targetMethod,
@@ -688,7 +957,7 @@ func (c *runCmd) runFuzzTest(buildResult *build.Result) error {
 		runner = jazzer.NewRunner(runnerOpts)
 	}
 
-	return executeRunner(runner)
+	return executeRunner(ctx, runner)
 }
 
 func (c *runCmd) printFinalMetrics(generatedCorpus, seedCorpus string) error {
@@ -700,6 +969,37 @@ func (c *runCmd) printFinalMetrics(generatedCorpus, seedCorpus string) error {
 	return c.reportHandler.PrintFinalMetrics(numCorpusEntries)
 }
 
+// checkExecsRegression warns if the average exec/s of the run dropped
+// below the baseline of the previous runs of the fuzz test with the
+// same options, and adds the run to the baseline.
+func (c *runCmd) checkExecsRegression() error {
+	if c.opts.ExecsRegressionThreshold == 0 {
+		return nil
+	}
+	execs, duration, ok := c.reportHandler.AverageExecsPerSecond()
+	if !ok || execs == 0 || duration < minExecsBaselineDuration {
+		// The exec/s of short runs are dominated by the startup of
+		// the fuzzer
+		log.Debugf("Not updating the exec/s baseline, because the exec/s were only measured for %s", duration)
+		return nil
+	}
+
+	baseline, err := updateExecsBaseline(c.opts.ProjectDir, c.opts.fuzzTest, c.opts.variant(), execs)
+	if err != nil {
+		return err
+	}
+	if baseline == 0 {
+		return nil
+	}
+	drop := 100 * (1 - float64(execs)/float64(baseline))
+	log.Debugf("Average exec/s: %d, baseline: %d", execs, baseline)
+	if drop > float64(c.opts.ExecsRegressionThreshold) {
+		log.Warnf(`The average exec/s dropped by %.0f%% to %d, compared to %d in the previous runs.
+This can be caused by a performance regression in the code under test.`, drop, execs, baseline)
+	}
+	return nil
+}
+
 func (c *runCmd) checkDependencies() error {
 	var deps []dependencies.Key
 	switch c.opts.BuildSystem {
@@ -853,7 +1153,30 @@ func (c *runCmd) errorDetails() (*[]finding.ErrorDetails, error) {
 	return &errorDetails, nil
 }
 
-func (c *runCmd) uploadFindings(fuzzTarget string, firstMetrics *report.FuzzingMetric, lastMetrics *report.FuzzingMetric, numBuildJobs uint) error {
+// syncCorpus exchanges the inputs of the generated and the seed corpus
+// with the corpus of the fuzz test on the server, see api.SyncCorpus.
+// New inputs from the server are added to the generated corpus. The
+// fuzzing run doesn't depend on the server, so errors are only logged.
+func (c *runCmd) syncCorpus(authenticatedUser bool, buildResult *build.Result) {
+	if !authenticatedUser || c.opts.Project == "" {
+		log.Warn("Skipping corpus sync because it requires authentication and the 'project' option.")
+		return
+	}
+
+	corpusDirs := []string{buildResult.GeneratedCorpus}
+	corpusDirs = append(corpusDirs, c.opts.SeedCorpusDirs...)
+	corpusDirs = append(corpusDirs, buildResult.SeedCorpus)
+	apiClient := api.APIClient{Server: c.opts.Server}
+	token := login.GetToken(c.opts.Server)
+	result, err := apiClient.SyncCorpus("projects/"+c.opts.Project, c.opts.fuzzTest, corpusDirs, token)
+	if err != nil {
+		log.Warnf("Failed to sync the corpus with %s: %v", c.opts.Server, err)
+		return
+	}
+	log.Infof("Synced corpus with %s: received %d and sent %d inputs", c.opts.Server, result.Received, result.Sent)
+}
+
+func (c *runCmd) uploadFindings(fuzzTarget string, firstMetrics *report.FuzzingMetric, lastMetrics *report.FuzzingMetric, resourceUsage *report.ResourceUsage, numBuildJobs uint) error {
 	// get projects from server
 	apiClient := api.APIClient{Server: c.opts.Server}
 	token := login.GetToken(c.opts.Server)
@@ -901,17 +1224,15 @@ Findings have *not* been uploaded. Please check the 'project' entry in your cifu
 	}
 
 	// create campaign run on server for selected project
-	campaignRunName, fuzzingRunName, err := apiClient.CreateCampaignRun(project, token, fuzzTarget, firstMetrics, lastMetrics, numBuildJobs)
+	campaignRunName, fuzzingRunName, err := apiClient.CreateCampaignRun(project, token, fuzzTarget, firstMetrics, lastMetrics, resourceUsage, numBuildJobs)
 	if err != nil {
 		return err
 	}
 
 	// upload findings
-	for _, finding := range c.reportHandler.Findings {
-		err = apiClient.UploadFinding(project, fuzzTarget, campaignRunName, fuzzingRunName, finding, token)
-		if err != nil {
-			return err
-		}
+	err = apiClient.UploadFindings(project, fuzzTarget, campaignRunName, fuzzingRunName, c.reportHandler.Findings, token)
+	if err != nil {
+		return err
 	}
 	log.Notef("Uploaded %d findings to CI Fuzz Server at: %s", len(c.reportHandler.Findings), c.opts.Server)
 	log.Infof("You can view the findings at %s/dashboard/%s/findings?origin=cli", c.opts.Server, campaignRunName)
@@ -919,10 +1240,10 @@ Findings have *not* been uploaded. Please check the 'project' entry in your cifu
 	return nil
 }
 
-func executeRunner(runner runner) error {
+func executeRunner(ctx context.Context, runner runner) error {
 	// Handle cleanup (terminating the fuzzer process) when receiving
 	// termination signals
-	signalHandlerCtx, cancelSignalHandler := context.WithCancel(context.Background())
+	signalHandlerCtx, cancelSignalHandler := context.WithCancel(ctx)
 	routines, routinesCtx := errgroup.WithContext(signalHandlerCtx)
 	sigs := make(chan os.Signal, 1)
 	signal.Notify(sigs, os.Interrupt, syscall.SIGTERM, syscall.SIGINT, syscall.SIGQUIT)
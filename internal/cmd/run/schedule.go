@@ -0,0 +1,109 @@
+package run
+
+import (
+	"context"
+	"time"
+
+	"code-intelligence.com/cifuzz/internal/build"
+	"code-intelligence.com/cifuzz/internal/cmd/run/reporthandler"
+	"code-intelligence.com/cifuzz/internal/cmd/run/scheduler"
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// runScheduled builds multiple fuzz tests and runs them one after the
+// other in time slices of --time-slice, in which each of them uses all
+// workers. Which fuzz test runs in the next slice is chosen based on
+// how much new coverage the fuzz tests found in their previous slices,
+// see scheduler.Scheduler. A fuzz test which found a crashing input is
+// not run again. The --timeout applies to all slices together.
+func (c *runCmd) runScheduled(authenticatedUser bool, errorDetails *[]finding.ErrorDetails) error {
+	var fuzzTests []string
+	buildResults := make(map[string]*build.Result)
+	for _, fuzzTest := range c.opts.fuzzTests {
+		c.opts.fuzzTest = fuzzTest
+		buildResult, err := c.buildFuzzTest()
+		if err != nil {
+			return silenceBuildError(err)
+		}
+		// The build can change the name of the fuzz test, see
+		// buildFuzzTest
+		fuzzTests = append(fuzzTests, c.opts.fuzzTest)
+		buildResults[c.opts.fuzzTest] = buildResult
+	}
+
+	if c.opts.BuildOnly {
+		return nil
+	}
+
+	var deadline time.Time
+	if c.opts.Timeout != 0 {
+		deadline = time.Now().Add(c.opts.Timeout)
+	}
+	sched := scheduler.New(fuzzTests)
+	for {
+		fuzzTest, ok := sched.Next()
+		if !ok {
+			break
+		}
+		timeout := c.opts.TimeSlice
+		if !deadline.IsZero() {
+			remaining := time.Until(deadline).Truncate(time.Second)
+			if remaining < time.Second {
+				break
+			}
+			if remaining < timeout {
+				timeout = remaining
+			}
+		}
+
+		buildResult := buildResults[fuzzTest]
+		c.opts.fuzzTest = fuzzTest
+		c.opts.Timeout = timeout
+		var err error
+		c.reportHandler, err = reporthandler.NewReportHandler(
+			fuzzTest,
+			&reporthandler.ReportHandlerOptions{
+				ProjectDir:    c.opts.ProjectDir,
+				SeedCorpusDir: buildResult.SeedCorpus,
+				PrintJSON:     c.opts.PrintJSON,
+			})
+		if err != nil {
+			return err
+		}
+		c.reportHandler.ErrorDetails = errorDetails
+
+		start := time.Now()
+		err = c.runFuzzTest(context.Background(), buildResult)
+		if err != nil {
+			return c.wrapRunError(err)
+		}
+		sched.Update(fuzzTest, c.reportHandler.FirstMetrics, c.reportHandler.LastMetrics, start, time.Now())
+
+		err = c.printFinalMetrics(buildResult.GeneratedCorpus, buildResult.SeedCorpus)
+		if err != nil {
+			return err
+		}
+
+		if len(c.reportHandler.Findings) == 0 {
+			continue
+		}
+		c.reportHandler.PrintCrashingInputNote()
+		sched.Done(fuzzTest)
+
+		// We need the project check, otherwise we might hang forever
+		// in CI
+		if authenticatedUser && (c.opts.Project != "" || c.opts.Interactive) {
+			err = c.uploadFindings(fuzzTest, c.reportHandler.FirstMetrics, c.reportHandler.LastMetrics, c.reportHandler.ResourceUsage, c.opts.NumBuildJobs)
+			if err != nil {
+				return err
+			}
+		}
+	}
+
+	log.Info("Time given to the fuzz tests:")
+	for _, a := range sched.Allocations() {
+		log.Infof("  %s: %d slices, %s, productivity %.2f", a.FuzzTest, a.NumSlices, a.Duration.Round(time.Second), a.Productivity)
+	}
+	return nil
+}
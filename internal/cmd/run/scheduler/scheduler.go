@@ -0,0 +1,158 @@
+package scheduler
+
+import (
+	"math"
+	"time"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+const (
+	// The weight of the previous slices of a fuzz test in its
+	// productivity. Smaller values make the scheduler react faster to
+	// fuzz tests which saturate or start finding new coverage again.
+	discount = 0.8
+	// The weight of the uncertainty about the productivity of a fuzz
+	// test, which makes the scheduler give fuzz tests which didn't run
+	// for a while another slice.
+	exploration = 0.5
+)
+
+// Scheduler decides which of multiple fuzz tests runs in the next time
+// slice, based on how much new coverage they found in their previous
+// slices. It's a discounted UCB bandit: Each fuzz test is scored by the
+// discounted average of the rewards of its slices plus a bonus which
+// grows the less it ran recently, so that fuzz tests which still find
+// new coverage get most of the slices while saturated ones are retried
+// occasionally.
+type Scheduler struct {
+	fuzzTests []*fuzzTest
+}
+
+type fuzzTest struct {
+	name string
+	// The discounted sums of the rewards and of the number of slices
+	reward float64
+	slices float64
+
+	numSlices int
+	duration  time.Duration
+	done      bool
+}
+
+// Allocation is the time which a fuzz test was given by the scheduler.
+type Allocation struct {
+	FuzzTest  string
+	NumSlices int
+	Duration  time.Duration
+	// The discounted average reward of the slices of the fuzz test,
+	// between 0 (saturated) and 1 (found new coverage until the end
+	// of each slice)
+	Productivity float64
+}
+
+// New creates a scheduler for the fuzz tests, which are each run once
+// in the order they are passed before the scheduler starts to prefer
+// the more productive ones.
+func New(fuzzTests []string) *Scheduler {
+	s := &Scheduler{}
+	for _, name := range fuzzTests {
+		s.fuzzTests = append(s.fuzzTests, &fuzzTest{name: name})
+	}
+	return s
+}
+
+// Next returns the fuzz test which should run in the next slice, or
+// false if all fuzz tests are done.
+func (s *Scheduler) Next() (string, bool) {
+	var total float64
+	for _, t := range s.fuzzTests {
+		total += t.slices
+	}
+
+	var next *fuzzTest
+	var nextScore float64
+	for _, t := range s.fuzzTests {
+		if t.done {
+			continue
+		}
+		if t.numSlices == 0 {
+			return t.name, true
+		}
+		score := t.reward/t.slices + exploration*math.Sqrt(math.Log(math.Max(total, 1))/t.slices)
+		if next == nil || score > nextScore {
+			next, nextScore = t, score
+		}
+	}
+	if next == nil {
+		return "", false
+	}
+	return next.name, true
+}
+
+// Update records the metrics which the fuzz test reported in the slice
+// which ran from start to end.
+func (s *Scheduler) Update(name string, first, last *report.FuzzingMetric, start, end time.Time) {
+	r := Reward(first, last, start, end)
+	for _, t := range s.fuzzTests {
+		t.reward *= discount
+		t.slices *= discount
+		if t.name == name {
+			t.reward += r
+			t.slices++
+			t.numSlices++
+			t.duration += end.Sub(start)
+		}
+	}
+}
+
+// Done excludes the fuzz test from the next slices, e.g. because it
+// found a crashing input.
+func (s *Scheduler) Done(name string) {
+	for _, t := range s.fuzzTests {
+		if t.name == name {
+			t.done = true
+		}
+	}
+}
+
+// Allocations returns the time which each fuzz test was given so far.
+func (s *Scheduler) Allocations() []*Allocation {
+	var allocations []*Allocation
+	for _, t := range s.fuzzTests {
+		a := &Allocation{FuzzTest: t.name, NumSlices: t.numSlices, Duration: t.duration}
+		if t.slices > 0 {
+			a.Productivity = t.reward / t.slices
+		}
+		allocations = append(allocations, a)
+	}
+	return allocations
+}
+
+// Reward rates a slice between 0 if the fuzz test didn't find new
+// features or edges during the slice and 1 if it still found some at
+// the end of it. In between, the reward decreases with the time since
+// the last new feature or edge was found, which libFuzzer reports via
+// SecondsSinceLastFeature and SecondsSinceLastEdge.
+func Reward(first, last *report.FuzzingMetric, start, end time.Time) float64 {
+	duration := end.Sub(start).Seconds()
+	if first == nil || last == nil || duration <= 0 {
+		return 0
+	}
+	if last.Features <= first.Features && last.Edges <= first.Edges {
+		return 0
+	}
+
+	sinceLast := last.SecondsSinceLastFeature
+	if last.SecondsSinceLastEdge < sinceLast {
+		sinceLast = last.SecondsSinceLastEdge
+	}
+	// libFuzzer only prints its stats when it finds new coverage or
+	// the number of executions reaches a power of two, so the last
+	// metric can be from long before the end of the slice
+	idle := float64(sinceLast)
+	if !last.Timestamp.IsZero() && end.After(last.Timestamp) {
+		idle += end.Sub(last.Timestamp).Seconds()
+	}
+	return math.Max(0, 1-idle/duration)
+}
@@ -0,0 +1,127 @@
+package scheduler
+
+import (
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+var start = time.Date(2023, 1, 1, 0, 0, 0, 0, time.UTC)
+
+const slice = 5 * time.Minute
+
+// sliceMetrics returns the first and last metric of a slice in which
+// the fuzz test found its last new feature idle seconds before the end.
+func sliceMetrics(newFeatures int32, idle uint64) (*report.FuzzingMetric, *report.FuzzingMetric) {
+	first := &report.FuzzingMetric{Timestamp: start, Features: 100, Edges: 50}
+	last := &report.FuzzingMetric{
+		Timestamp:               start.Add(slice),
+		Features:                100 + newFeatures,
+		Edges:                   50 + newFeatures,
+		SecondsSinceLastFeature: idle,
+		SecondsSinceLastEdge:    idle,
+	}
+	return first, last
+}
+
+func TestReward(t *testing.T) {
+	first, last := sliceMetrics(0, 300)
+	assert.Equal(t, 0.0, Reward(first, last, start, start.Add(slice)))
+
+	first, last = sliceMetrics(10, 0)
+	assert.Equal(t, 1.0, Reward(first, last, start, start.Add(slice)))
+
+	first, last = sliceMetrics(10, 150)
+	assert.InDelta(t, 0.5, Reward(first, last, start, start.Add(slice)), 0.001)
+
+	// The time between the last metric and the end of the slice
+	// counts as time without new coverage
+	first, last = sliceMetrics(10, 0)
+	last.Timestamp = start.Add(slice / 2)
+	assert.InDelta(t, 0.5, Reward(first, last, start, start.Add(slice)), 0.001)
+
+	assert.Equal(t, 0.0, Reward(nil, nil, start, start.Add(slice)))
+}
+
+func TestScheduler_RunsEachFuzzTestFirst(t *testing.T) {
+	s := New([]string{"a", "b", "c"})
+	for _, expected := range []string{"a", "b", "c"} {
+		next, ok := s.Next()
+		require.True(t, ok)
+		assert.Equal(t, expected, next)
+		first, last := sliceMetrics(0, 300)
+		s.Update(next, first, last, start, start.Add(slice))
+	}
+}
+
+func TestScheduler_PrefersProductiveFuzzTests(t *testing.T) {
+	s := New([]string{"saturated", "productive"})
+	numSlices := map[string]int{}
+	for i := 0; i < 50; i++ {
+		next, ok := s.Next()
+		require.True(t, ok)
+		numSlices[next]++
+		first, last := sliceMetrics(0, 300)
+		if next == "productive" {
+			first, last = sliceMetrics(10, 30)
+		}
+		s.Update(next, first, last, start, start.Add(slice))
+	}
+
+	assert.Greater(t, numSlices["productive"], 3*numSlices["saturated"])
+	// The saturated fuzz test is still retried occasionally
+	assert.Greater(t, numSlices["saturated"], 1)
+
+	allocations := s.Allocations()
+	require.Len(t, allocations, 2)
+	assert.Equal(t, "saturated", allocations[0].FuzzTest)
+	assert.Equal(t, numSlices["saturated"], allocations[0].NumSlices)
+	assert.Equal(t, time.Duration(numSlices["saturated"])*slice, allocations[0].Duration)
+	assert.Equal(t, 0.0, allocations[0].Productivity)
+	assert.InDelta(t, 0.9, allocations[1].Productivity, 0.001)
+}
+
+func TestScheduler_AdaptsWhenFuzzTestSaturates(t *testing.T) {
+	s := New([]string{"a", "b"})
+	var lastSlices []string
+	for i := 0; i < 60; i++ {
+		next, ok := s.Next()
+		require.True(t, ok)
+		if i >= 50 {
+			lastSlices = append(lastSlices, next)
+		}
+		// "a" saturates after 20 slices, after which "b" starts finding
+		// new coverage
+		first, last := sliceMetrics(0, 300)
+		if (next == "a" && i < 20) || (next == "b" && i >= 20) {
+			first, last = sliceMetrics(10, 0)
+		}
+		s.Update(next, first, last, start, start.Add(slice))
+	}
+	assert.Contains(t, lastSlices, "a")
+	assert.Contains(t, lastSlices, "b")
+
+	numB := 0
+	for _, name := range lastSlices {
+		if name == "b" {
+			numB++
+		}
+	}
+	assert.Greater(t, numB, len(lastSlices)/2)
+}
+
+func TestScheduler_Done(t *testing.T) {
+	s := New([]string{"a", "b"})
+	s.Done("a")
+	next, ok := s.Next()
+	require.True(t, ok)
+	assert.Equal(t, "b", next)
+
+	s.Done("b")
+	_, ok = s.Next()
+	assert.False(t, ok)
+}
@@ -0,0 +1,201 @@
+package run
+
+import (
+	"context"
+	"crypto/sha256"
+	"encoding/hex"
+	"fmt"
+	"io/fs"
+	"path/filepath"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/cmd/run/reporthandler"
+	"code-intelligence.com/cifuzz/internal/cmdutils"
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/sliceutil"
+)
+
+const (
+	// The interval in which the source tree is checked for changes
+	watchPollInterval = time.Second
+	// The number of the newest findings of the fuzz test whose inputs
+	// are run after every rebuild
+	watchNumRecentFindings = 10
+)
+
+// The files which are part of the source tree watched by runWatch, by
+// their extension and by their name
+var (
+	watchedExtensions = []string{
+		".c", ".cc", ".cpp", ".cxx", ".c++", ".h", ".hh", ".hpp", ".hxx", ".h++", ".inc", ".ipp",
+		".cmake", ".bazel", ".bzl", ".java", ".kt", ".gradle", ".kts",
+	}
+	watchedNames = []string{"CMakeLists.txt", "BUILD", "WORKSPACE", "Makefile", "pom.xml", "cifuzz.yaml"}
+)
+
+// runWatch builds and runs the fuzz test and starts over whenever one
+// of its source files changes. The builders build incrementally, so
+// that only the translation units which changed are compiled again,
+// and the fuzz test continues with the generated corpus of the previous
+// run. Before fuzzing, the inputs of the recent findings of the fuzz
+// test are run, so that regressions and fixes are reported right after
+// the build. If the build fails or fuzzing stops, e.g. because of a
+// finding, it waits for the next change.
+func (c *runCmd) runWatch(errorDetails *[]finding.ErrorDetails) error {
+	fingerprint, err := sourceTreeFingerprint(c.opts.ProjectDir)
+	if err != nil {
+		return err
+	}
+	log.Infof("Watching %s for changes", c.opts.ProjectDir)
+
+	for {
+		// Stop fuzzing once the source tree changes
+		ctx, cancel := context.WithCancel(context.Background())
+		type change struct {
+			fingerprint string
+			err         error
+		}
+		changes := make(chan change, 1)
+		go func() {
+			defer cancel()
+			fingerprint, err := waitForSourceChange(ctx, c.opts.ProjectDir, fingerprint)
+			changes <- change{fingerprint, err}
+		}()
+
+		err = c.watchIteration(ctx, errorDetails)
+		if err != nil && ctx.Err() == nil {
+			cancel()
+			return err
+		}
+		if ctx.Err() == nil {
+			log.Infof("Waiting for changes to %s", c.opts.ProjectDir)
+		}
+
+		res := <-changes
+		cancel()
+		if res.err != nil {
+			return res.err
+		}
+		fingerprint = res.fingerprint
+		log.Infof("Source files changed, rebuilding %s", c.opts.fuzzTest)
+	}
+}
+
+// watchIteration builds the fuzz test and runs it until ctx is done or
+// fuzzing stops. Build errors are logged but don't stop runWatch.
+func (c *runCmd) watchIteration(ctx context.Context, errorDetails *[]finding.ErrorDetails) error {
+	buildResult, err := c.buildFuzzTest()
+	if err != nil {
+		err = silenceBuildError(err)
+		if errors.Is(err, cmdutils.ErrSilent) {
+			return nil
+		}
+		return err
+	}
+	if ctx.Err() != nil {
+		return nil
+	}
+
+	c.replayFirst, err = finding.RecentInputs(c.opts.ProjectDir, c.opts.fuzzTest, watchNumRecentFindings)
+	if err != nil {
+		return err
+	}
+	c.reportHandler, err = reporthandler.NewReportHandler(
+		c.opts.fuzzTest,
+		&reporthandler.ReportHandlerOptions{
+			ProjectDir:    c.opts.ProjectDir,
+			SeedCorpusDir: buildResult.SeedCorpus,
+			PrintJSON:     c.opts.PrintJSON,
+		})
+	if err != nil {
+		return err
+	}
+	c.reportHandler.ErrorDetails = errorDetails
+
+	err = c.runFuzzTest(ctx, buildResult)
+	if err != nil {
+		var signalErr *cmdutils.SignalError
+		if ctx.Err() != nil && !errors.As(err, &signalErr) {
+			// Fuzzing was stopped because of a change
+			return nil
+		}
+		return c.wrapRunError(err)
+	}
+	c.reportHandler.PrintCrashingInputNote()
+	return c.printFinalMetrics(buildResult.GeneratedCorpus, buildResult.SeedCorpus)
+}
+
+// waitForSourceChange polls the source tree in dir until its
+// fingerprint differs from the given one and then until it stays the
+// same for one interval, so that a change to multiple files, e.g. by
+// "git checkout", only causes a single rebuild. It returns the new
+// fingerprint.
+func waitForSourceChange(ctx context.Context, dir string, fingerprint string) (string, error) {
+	changed := false
+	ticker := time.NewTicker(watchPollInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return fingerprint, ctx.Err()
+		case <-ticker.C:
+		}
+		current, err := sourceTreeFingerprint(dir)
+		if err != nil {
+			return "", err
+		}
+		if current != fingerprint {
+			changed = true
+			fingerprint = current
+		} else if changed {
+			return fingerprint, nil
+		}
+	}
+}
+
+// sourceTreeFingerprint returns a hash of the paths, sizes and
+// modification times of the watched files in dir, which changes when
+// any of them is modified, added or removed. Hidden directories are
+// skipped, which includes the build directories, the corpora and the
+// findings of cifuzz as well as .git.
+func sourceTreeFingerprint(dir string) (string, error) {
+	h := sha256.New()
+	err := filepath.WalkDir(dir, func(path string, d fs.DirEntry, err error) error {
+		if errors.Is(err, fs.ErrNotExist) {
+			// Editors create and remove temporary files all the time
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+		if d.IsDir() {
+			if path != dir && (strings.HasPrefix(d.Name(), ".") || strings.HasPrefix(d.Name(), "bazel-")) {
+				return filepath.SkipDir
+			}
+			return nil
+		}
+		if !d.Type().IsRegular() {
+			return nil
+		}
+		if !sliceutil.Contains(watchedNames, d.Name()) && !sliceutil.Contains(watchedExtensions, strings.ToLower(filepath.Ext(path))) {
+			return nil
+		}
+		info, err := d.Info()
+		if errors.Is(err, fs.ErrNotExist) {
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+		fmt.Fprintf(h, "%s\x00%d\x00%d\x00", path, info.Size(), info.ModTime().UnixNano())
+		return nil
+	})
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return hex.EncodeToString(h.Sum(nil)), nil
+}
@@ -0,0 +1,39 @@
+package run
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestSourceTreeFingerprint(t *testing.T) {
+	projectDir := t.TempDir()
+	require.NoError(t, os.MkdirAll(filepath.Join(projectDir, "src"), 0o755))
+	require.NoError(t, os.MkdirAll(filepath.Join(projectDir, ".cifuzz-build"), 0o755))
+	source := filepath.Join(projectDir, "src", "parser.cpp")
+	require.NoError(t, os.WriteFile(source, []byte("int parse();"), 0o644))
+
+	fingerprint, err := sourceTreeFingerprint(projectDir)
+	require.NoError(t, err)
+
+	// Build outputs, corpora and files which aren't sources don't
+	// change the fingerprint
+	require.NoError(t, os.WriteFile(filepath.Join(projectDir, ".cifuzz-build", "parser.cpp"), []byte("x"), 0o644))
+	require.NoError(t, os.WriteFile(filepath.Join(projectDir, "src", "parser.o"), []byte("x"), 0o644))
+	unchanged, err := sourceTreeFingerprint(projectDir)
+	require.NoError(t, err)
+	assert.Equal(t, fingerprint, unchanged)
+
+	require.NoError(t, os.WriteFile(source, []byte("int parse(int);"), 0o644))
+	changed, err := sourceTreeFingerprint(projectDir)
+	require.NoError(t, err)
+	assert.NotEqual(t, fingerprint, changed)
+
+	require.NoError(t, os.WriteFile(filepath.Join(projectDir, "CMakeLists.txt"), nil, 0o644))
+	added, err := sourceTreeFingerprint(projectDir)
+	require.NoError(t, err)
+	assert.NotEqual(t, changed, added)
+}
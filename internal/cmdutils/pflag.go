@@ -2,6 +2,7 @@ package cmdutils
 
 import (
 	"runtime"
+	"time"
 
 	"github.com/spf13/cobra"
 	"github.com/spf13/pflag"
@@ -12,12 +13,16 @@ var BundleFlags = []string{
 	"branch",
 	"build-command",
 	"build-jobs",
+	"build-profile",
 	"commit",
+	"compiler-launcher",
 	"dict",
 	"docker-image",
 	"engine-arg",
 	"env",
+	"pgo-profile",
 	"seed-corpus",
+	"thinlto",
 	"timeout",
 }
 
@@ -62,6 +67,16 @@ func AddAdditionalFilesFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddAutoDictFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("auto-dict", false,
+		"Pass the string literals of the fuzz test which look like tokens of an input format\n"+
+			"(e.g. magic numbers and keywords) to the fuzzer as a dictionary, in addition to \"dict\".\n"+
+			"They are cached per build of the fuzz test. Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("auto-dict", cmd.Flags().Lookup("auto-dict"))
+	}
+}
+
 func AddBranchFlag(cmd *cobra.Command) func() {
 	cmd.Flags().String("branch", "",
 		"Branch name to use in the bundle config.\n"+
@@ -71,6 +86,16 @@ func AddBranchFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddBuildCacheFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("build-cache", false,
+		"Skip building CMake fuzz tests if neither the Git working tree nor the compilers\n"+
+			"changed since they were last built. Changes outside of the Git repository,\n"+
+			"e.g. to installed libraries, are not detected.")
+	return func() {
+		ViperMustBindPFlag("build-cache", cmd.Flags().Lookup("build-cache"))
+	}
+}
+
 func AddBuildCommandFlag(cmd *cobra.Command) func() {
 	cmd.Flags().String("build-command", "",
 		"The `command` to build the fuzz test for other build systems.")
@@ -79,6 +104,16 @@ func AddBuildCommandFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddChunkedUploadFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("chunked-upload", false,
+		"Upload the bundle in parallel chunks, which are retried on their own\n"+
+			"and resumed by the next remote run if the upload is interrupted.\n"+
+			"Requires a CI Fuzz Server which supports chunked uploads.")
+	return func() {
+		ViperMustBindPFlag("chunked-upload", cmd.Flags().Lookup("chunked-upload"))
+	}
+}
+
 func AddCleanCommandFlag(cmd *cobra.Command) func() {
 	cmd.Flags().String("clean-command", "",
 		"The `command` to clean the fuzz test and its dependencies for other build systems.")
@@ -97,6 +132,16 @@ func AddBuildJobsFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddBuildProfileFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("build-profile", "debug",
+		"The build `profile` of CMake fuzz tests. \"debug\" disables optimizations for\n"+
+			"debuggability, \"throughput\" optimizes for more executions per second\n"+
+			"while keeping asserts and frame pointers.")
+	return func() {
+		ViperMustBindPFlag("build-profile", cmd.Flags().Lookup("build-profile"))
+	}
+}
+
 func AddBuildOnlyFlag(cmd *cobra.Command) func() {
 	cmd.Flags().Bool("build-only", false,
 		"Only build the fuzz test and don't execute it.")
@@ -114,6 +159,54 @@ func AddCommitFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddCompilerLauncherFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("compiler-launcher", "",
+		"A compiler launcher such as ccache or sccache to build CMake fuzz tests with.\n"+
+			"Paths in debug info are made relative to the project directory so that\n"+
+			"the cache can be shared between checkouts.")
+	return func() {
+		ViperMustBindPFlag("compiler-launcher", cmd.Flags().Lookup("compiler-launcher"))
+	}
+}
+
+func AddCompressionJobsFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("compression-jobs", 1,
+		"Number of blocks of the bundle to compress in parallel. With more than one job,\n"+
+			"the bundle is written as a sequence of gzip members, which gzip and tar extract\n"+
+			"like a single gzip stream.")
+	return func() {
+		ViperMustBindPFlag("compression-jobs", cmd.Flags().Lookup("compression-jobs"))
+	}
+}
+
+func AddCompressionLevelFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Int("compression-level", 0,
+		"The gzip compression `level` of the bundle, from 1 (fastest) to 9 (smallest).\n"+
+			"The default is gzip's default level.")
+	return func() {
+		ViperMustBindPFlag("compression-level", cmd.Flags().Lookup("compression-level"))
+	}
+}
+
+func AddCorpusTmpfsSizeFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("corpus-tmpfs-size", "",
+		"Write new corpus entries to a tmpfs of the given `size` (e.g. \"512m\") in the sandbox\n"+
+			"and move them to the generated corpus directory periodically, which is faster if\n"+
+			"the corpus is on a slow (e.g. network) file system. Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("corpus-tmpfs-size", cmd.Flags().Lookup("corpus-tmpfs-size"))
+	}
+}
+
+func AddDeferSymbolizationFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("defer-symbolization", false,
+		"Don't let the sanitizers symbolize stack traces, which is slow for large fuzz tests,\n"+
+			"and symbolize the stack traces of findings in batches instead. Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("defer-symbolization", cmd.Flags().Lookup("defer-symbolization"))
+	}
+}
+
 func AddDictFlag(cmd *cobra.Command) func() {
 	// TODO(afl): Also link to https://github.com/AFLplusplus/AFLplusplus/blob/stable/dictionaries/README.md
 	cmd.Flags().String("dict", "",
@@ -136,11 +229,21 @@ func AddDockerImageFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddEngineFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("engine", "libfuzzer",
+		"The fuzzing `engine` to run CMake fuzz tests with, either \"libfuzzer\",\n"+
+			"\"aflpp\" for AFL++ in persistent mode, which requires afl-clang-lto, or\n"+
+			"\"centipede\" for Centipede, which requires CIFUZZ_CENTIPEDE_RUNNER to be set.")
+	return func() {
+		ViperMustBindPFlag("engine", cmd.Flags().Lookup("engine"))
+	}
+}
+
 func AddEngineArgFlag(cmd *cobra.Command) func() {
-	// TODO(afl): Also link to https://www.mankier.com/8/afl-fuzz
 	cmd.Flags().StringArray("engine-arg", nil,
 		"Command-line `argument` to pass to the fuzzing engine.\n"+
-			"See https://llvm.org/docs/LibFuzzer.html#options.\n"+
+			"See https://llvm.org/docs/LibFuzzer.html#options or, with the aflpp\n"+
+			"engine, https://www.mankier.com/8/afl-fuzz.\n"+
 			"This flag can be used multiple times.")
 	return func() {
 		ViperMustBindPFlag("engine-args", cmd.Flags().Lookup("engine-arg"))
@@ -157,6 +260,15 @@ func AddEnvFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddExecsRegressionThresholdFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("execs-regression-threshold", 20,
+		"Warn if the average exec/s of the fuzz test dropped by more than this `percentage`\n"+
+			"compared to its previous runs with the same options. Use 0 to disable the check.")
+	return func() {
+		ViperMustBindPFlag("execs-regression-threshold", cmd.Flags().Lookup("execs-regression-threshold"))
+	}
+}
+
 func AddInteractiveFlag(cmd *cobra.Command) func() {
 	cmd.Flags().Bool("interactive", true, "Toggle interactive prompting in the terminal")
 	return func() {
@@ -164,6 +276,44 @@ func AddInteractiveFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddPackSeedCorpusFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("pack-seed-corpus", false,
+		"Add each seed corpus directory to the bundle as a single packed\n"+
+			"corpus file (.cifuzzpack) instead of one file per seed, which is\n"+
+			"faster to create, extract and replay for large corpora.\n"+
+			"Packed corpora are only understood by the replayer, not by libFuzzer.")
+	return func() {
+		ViperMustBindPFlag("pack-seed-corpus", cmd.Flags().Lookup("pack-seed-corpus"))
+	}
+}
+
+func AddPGOProfileFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("pgo-profile", "",
+		"An indexed `profile` (.profdata) to optimize CMake fuzz tests for the paths\n"+
+			"exercised by the corpus, e.g. created by \"cifuzz coverage --format=profdata\".")
+	return func() {
+		ViperMustBindPFlag("pgo-profile", cmd.Flags().Lookup("pgo-profile"))
+	}
+}
+
+func AddPlateauMinNewFeaturesFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("plateau-min-new-features", 0,
+		"Stop fuzzing once fewer than this `number` of new features were found within the\n"+
+			"--plateau-timeout. The default is to stop once no new features are found anymore.")
+	return func() {
+		ViperMustBindPFlag("plateau-min-new-features", cmd.Flags().Lookup("plateau-min-new-features"))
+	}
+}
+
+func AddPlateauTimeoutFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Duration("plateau-timeout", 0,
+		"Stop fuzzing once the coverage stopped growing for this `duration`, e.g. \"10m\",\n"+
+			"see --plateau-min-new-features. The default is to fuzz until the --timeout.")
+	return func() {
+		ViperMustBindPFlag("plateau-timeout", cmd.Flags().Lookup("plateau-timeout"))
+	}
+}
+
 func AddPresetFlag(cmd *cobra.Command) func() {
 	cmd.Flags().String("preset", "", "Preset for a given environment to execute coverage with necessary flags.\n"+
 		"We recommend not using this flag with '--format' or '--output' because the preset will set these accordingly.\n"+
@@ -173,6 +323,26 @@ func AddPresetFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddMergeCorpusAboveFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("merge-corpus-above", 0,
+		"Before fuzzing, merge the generated corpus into the subset of its inputs which covers the\n"+
+			"same features if it has more than `number` inputs, so that libFuzzer starts faster.\n"+
+			"Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("merge-corpus-above", cmd.Flags().Lookup("merge-corpus-above"))
+	}
+}
+
+func AddMergeCorpusEveryFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Duration("merge-corpus-every", 0,
+		"While fuzzing, merge the generated corpus into the subset of its inputs which covers the\n"+
+			"same features every `duration`, e.g. \"1h\", with a low CPU priority.\n"+
+			"Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("merge-corpus-every", cmd.Flags().Lookup("merge-corpus-every"))
+	}
+}
+
 func AddPrintJSONFlag(cmd *cobra.Command) func() {
 	cmd.Flags().Bool("json", false, "Print output as JSON")
 	return func() {
@@ -209,6 +379,36 @@ e.g. "my-project-c170bc17".`)
 	}
 }
 
+func AddSandboxMemoryMaxFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("sandbox-memory-max", 0,
+		"Limit the memory used by all processes in the sandbox to `MiB` mebibytes via a cgroup v2,\n"+
+			"e.g. to run several fuzz tests in parallel. Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("sandbox-memory-max", cmd.Flags().Lookup("sandbox-memory-max"))
+	}
+}
+
+func AddSandboxCPUWeightFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("sandbox-cpu-weight", 0,
+		"The relative share of CPU time of the sandbox between 1 and 10000 (default 100) via a\n"+
+			"cgroup v2, e.g. to prioritize some of several fuzz tests run in parallel.\n"+
+			"Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("sandbox-cpu-weight", cmd.Flags().Lookup("sandbox-cpu-weight"))
+	}
+}
+
+func AddSanitizerProfileFlag(cmd *cobra.Command) func() {
+	cmd.Flags().String("sanitizer-profile", "triage",
+		"The `profile` of the sanitizer options. \"triage\" produces complete reports,\n"+
+			"\"throughput\" records shorter allocation stacks, keeps less freed memory\n"+
+			"poisoned and checks for leaks only at exit, and runs the crashing inputs\n"+
+			"of findings again with \"triage\". Only supported for libFuzzer C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("sanitizer-profile", cmd.Flags().Lookup("sanitizer-profile"))
+	}
+}
+
 func AddSeedCorpusFlag(cmd *cobra.Command) func() {
 	// TODO(afl): Also link to https://aflplus.plus/docs/fuzzing_in_depth/#a-collecting-inputs
 	cmd.Flags().StringArrayP("seed-corpus", "s", nil,
@@ -229,6 +429,34 @@ func AddServerFlag(cmd *cobra.Command) func() {
 	}
 }
 
+func AddSyncCorpusFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("sync-corpus", false,
+		"Exchange new inputs with the corpus of the fuzz test on the CI Fuzz Server\n"+
+			"before and after fuzzing. Only the inputs which either side is missing are\n"+
+			"transferred. Requires authentication and the \"project\" option.")
+	return func() {
+		ViperMustBindPFlag("sync-corpus", cmd.Flags().Lookup("sync-corpus"))
+	}
+}
+
+func AddThinLTOFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("thinlto", false,
+		"Build CMake fuzz tests with ThinLTO, which speeds up incremental links\n"+
+			"and optimizes across translation units. Requires clang and lld.")
+	return func() {
+		ViperMustBindPFlag("thinlto", cmd.Flags().Lookup("thinlto"))
+	}
+}
+
+func AddTimeSliceFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Duration("time-slice", 5*time.Minute,
+		"When running multiple fuzz tests, the time for which each of them runs before the\n"+
+			"next one is chosen. Fuzz tests which find new coverage get more time slices.")
+	return func() {
+		ViperMustBindPFlag("time-slice", cmd.Flags().Lookup("time-slice"))
+	}
+}
+
 func AddTimeoutFlag(cmd *cobra.Command) func() {
 	cmd.Flags().Duration("timeout", 0,
 		"Maximum time to run the fuzz test, e.g. \"30m\", \"1h\". The default is to run indefinitely.")
@@ -247,3 +475,33 @@ func AddUseSandboxFlag(cmd *cobra.Command) func() {
 		ViperMustBindPFlag("use-sandbox", cmd.Flags().Lookup("use-sandbox"))
 	}
 }
+
+func AddWatchFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Bool("watch", false,
+		"Keep running: Whenever a source file changes, stop fuzzing, rebuild the fuzz test\n"+
+			"incrementally and start fuzzing again, from the same generated corpus. The inputs\n"+
+			"of the recent findings of the fuzz test run first (only with libFuzzer).")
+	return func() {
+		ViperMustBindPFlag("watch", cmd.Flags().Lookup("watch"))
+	}
+}
+
+func AddWorkersFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("workers", 1,
+		"The `number` of libFuzzer processes to run in parallel, which share the generated\n"+
+			"corpus. Use 0 to choose the number from the memory usage of the fuzz test, which is\n"+
+			"measured in a short calibration run, see --workers-memory-budget.\n"+
+			"Only supported for C/C++ fuzz tests.")
+	return func() {
+		ViperMustBindPFlag("workers", cmd.Flags().Lookup("workers"))
+	}
+}
+
+func AddWorkersMemoryBudgetFlag(cmd *cobra.Command) func() {
+	cmd.Flags().Uint("workers-memory-budget", 0,
+		"The memory in `MB` which the workers may use together with --workers=0. The RSS and\n"+
+			"malloc limits of each worker are set to its share. The default is the available memory.")
+	return func() {
+		ViperMustBindPFlag("workers-memory-budget", cmd.Flags().Lookup("workers-memory-budget"))
+	}
+}
@@ -5,8 +5,28 @@ import (
 	"path/filepath"
 
 	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/build"
 )
 
+// ValidateBuildProfile checks if profile is a supported build profile
+func ValidateBuildProfile(profile string) error {
+	if profile != build.ProfileDebug && profile != build.ProfileThroughput {
+		return WrapIncorrectUsageError(errors.Errorf(
+			"Invalid build profile %q, must be %q or %q", profile, build.ProfileDebug, build.ProfileThroughput))
+	}
+	return nil
+}
+
+// ValidateEngine checks if engine is a supported fuzzing engine
+func ValidateEngine(engine string) error {
+	if engine != build.EngineLibFuzzer && engine != build.EngineAFLPlusPlus && engine != build.EngineCentipede {
+		return WrapIncorrectUsageError(errors.Errorf(
+			"Invalid engine %q, must be %q, %q or %q", engine, build.EngineLibFuzzer, build.EngineAFLPlusPlus, build.EngineCentipede))
+	}
+	return nil
+}
+
 // ValidateSeedCorpusDirs checks if the seed dirs exist and can be
 // accessed and ensures that the paths are absolute
 func ValidateSeedCorpusDirs(seedCorpusDirs []string) ([]string, error) {
@@ -12,6 +12,7 @@ import (
 	"github.com/pkg/errors"
 	"github.com/spf13/cobra"
 
+	"code-intelligence.com/cifuzz/internal/build/cmake"
 	"code-intelligence.com/cifuzz/internal/cmdutils"
 	"code-intelligence.com/cifuzz/internal/config"
 	"code-intelligence.com/cifuzz/pkg/log"
@@ -152,6 +153,17 @@ func relativeBazelFuzzTestLabels(toComplete string) ([]string, cobra.ShellCompDi
 }
 
 func validCMakeFuzzTests(projectDir string) ([]string, cobra.ShellCompDirective) {
+	fuzzTests, err := cmake.IndexedFuzzTests(projectDir)
+	if err == nil {
+		return fuzzTests, cobra.ShellCompDirectiveNoFileComp
+	}
+	if !errors.Is(err, os.ErrNotExist) {
+		log.Error(err, err.Error())
+		return nil, cobra.ShellCompDirectiveError
+	}
+
+	// The project wasn't configured with a CMake version which writes
+	// the fuzz test index, so we fall back to the info directories
 	matches, err := zglob.Glob(projectDir + "/.cifuzz-build/**/.cifuzz/fuzz_tests/*")
 	if err != nil {
 		log.Error(err, err.Error())
@@ -5,11 +5,13 @@ import "code-intelligence.com/cifuzz/internal/config"
 const FormatHTML = "html"
 const FormatLCOV = "lcov"
 const FormatJacocoXML = "jacocoxml"
+const FormatProfdata = "profdata"
+const FormatImpactMap = "impact-map"
 
 var ValidOutputFormats = map[string][]string{
-	config.BuildSystemCMake:  {FormatHTML, FormatLCOV},
+	config.BuildSystemCMake:  {FormatHTML, FormatLCOV, FormatProfdata, FormatImpactMap},
 	config.BuildSystemBazel:  {FormatHTML, FormatLCOV},
-	config.BuildSystemOther:  {FormatHTML, FormatLCOV},
+	config.BuildSystemOther:  {FormatHTML, FormatLCOV, FormatProfdata, FormatImpactMap},
 	config.BuildSystemMaven:  {FormatHTML, FormatJacocoXML},
 	config.BuildSystemGradle: {FormatHTML, FormatJacocoXML},
 }
@@ -0,0 +1,238 @@
+//go:build freebsd || linux
+
+package ldd
+
+import (
+	"debug/elf"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"sync"
+
+	"github.com/pkg/errors"
+)
+
+// dynamicInfo is the part of the dynamic section of an ELF file which
+// is needed to find its dependencies.
+type dynamicInfo struct {
+	class   elf.Class
+	machine elf.Machine
+	needed  []string
+	rpath   []string
+	runpath []string
+}
+
+// The dynamic sections of the ELF files which were read before, by
+// path. Fuzz tests of the same project typically link the same
+// libraries, so each of them is only parsed once.
+var (
+	dynamicInfoCache = make(map[string]*dynamicInfo)
+	dynamicInfoMutex sync.Mutex
+)
+
+func readDynamicInfo(path string) (*dynamicInfo, error) {
+	dynamicInfoMutex.Lock()
+	info, ok := dynamicInfoCache[path]
+	dynamicInfoMutex.Unlock()
+	if ok {
+		return info, nil
+	}
+
+	f, err := elf.Open(path)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	defer f.Close()
+
+	info = &dynamicInfo{class: f.Class, machine: f.Machine}
+	// Statically linked files don't have a dynamic section, in which
+	// case DynString returns nil
+	info.needed, err = f.DynString(elf.DT_NEEDED)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	rpath, err := f.DynString(elf.DT_RPATH)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	runpath, err := f.DynString(elf.DT_RUNPATH)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	info.rpath = splitSearchPath(rpath)
+	info.runpath = splitSearchPath(runpath)
+
+	dynamicInfoMutex.Lock()
+	dynamicInfoCache[path] = info
+	dynamicInfoMutex.Unlock()
+	return info, nil
+}
+
+func splitSearchPath(values []string) []string {
+	var dirs []string
+	for _, value := range values {
+		for _, dir := range strings.Split(value, ":") {
+			if dir != "" {
+				dirs = append(dirs, dir)
+			}
+		}
+	}
+	return dirs
+}
+
+// The directories which the dynamic loader searches after the ones
+// from LD_LIBRARY_PATH and the dynamic section
+var (
+	systemSearchDirs     []string
+	systemSearchDirsOnce sync.Once
+)
+
+func getSystemSearchDirs() []string {
+	systemSearchDirsOnce.Do(func() {
+		systemSearchDirs = append(readLdSoConf("/etc/ld.so.conf", make(map[string]bool)),
+			"/lib64", "/usr/lib64", "/lib", "/usr/lib")
+	})
+	return systemSearchDirs
+}
+
+// readLdSoConf returns the directories listed in the ld.so.conf file
+// and the files included by it.
+func readLdSoConf(path string, seen map[string]bool) []string {
+	if seen[path] {
+		return nil
+	}
+	seen[path] = true
+	content, err := os.ReadFile(path)
+	if err != nil {
+		return nil
+	}
+
+	var dirs []string
+	for _, line := range strings.Split(string(content), "\n") {
+		if i := strings.IndexByte(line, '#'); i != -1 {
+			line = line[:i]
+		}
+		line = strings.TrimSpace(line)
+		if line == "" || strings.HasPrefix(line, "hwcap ") {
+			continue
+		}
+		if strings.HasPrefix(line, "include ") {
+			pattern := strings.TrimSpace(strings.TrimPrefix(line, "include "))
+			if !filepath.IsAbs(pattern) {
+				pattern = filepath.Join(filepath.Dir(path), pattern)
+			}
+			matches, _ := filepath.Glob(pattern)
+			sort.Strings(matches)
+			for _, match := range matches {
+				dirs = append(dirs, readLdSoConf(match, seen)...)
+			}
+			continue
+		}
+		dirs = append(dirs, line)
+	}
+	return dirs
+}
+
+// dependencyResolver finds the transitive dependencies of an ELF file
+// the same way as the dynamic loader, see ld.so(8). It only supports
+// the common cases and reports if it couldn't find a dependency, e.g.
+// because it's only listed in the ld.so.cache.
+type dependencyResolver struct {
+	libraryPath []string
+	found       map[string]bool
+	deps        []string
+}
+
+func newDependencyResolver() *dependencyResolver {
+	return &dependencyResolver{
+		libraryPath: splitSearchPath([]string{os.Getenv("LD_LIBRARY_PATH")}),
+		found:       make(map[string]bool),
+	}
+}
+
+// resolve adds the dependencies of the ELF file to r.deps. It returns
+// false if a dependency couldn't be found. inheritedRPath is the
+// DT_RPATH of the files which loaded this one, which the dynamic loader
+// also searches unless a DT_RUNPATH is set.
+func (r *dependencyResolver) resolve(path string, inheritedRPath []string) (bool, error) {
+	info, err := readDynamicInfo(path)
+	if err != nil {
+		return false, err
+	}
+
+	origin := filepath.Dir(path)
+	var rpath []string
+	if len(info.runpath) == 0 {
+		rpath = append(expandOrigin(info.rpath, origin), inheritedRPath...)
+	}
+	runpath := expandOrigin(info.runpath, origin)
+
+	for _, name := range info.needed {
+		dep := r.find(name, info, rpath, runpath)
+		if dep == "" {
+			return false, nil
+		}
+		if r.found[dep] {
+			continue
+		}
+		r.found[dep] = true
+		r.deps = append(r.deps, dep)
+		ok, err := r.resolve(dep, rpath)
+		if err != nil || !ok {
+			return ok, err
+		}
+	}
+	return true, nil
+}
+
+func (r *dependencyResolver) find(name string, loader *dynamicInfo, rpath, runpath []string) string {
+	if strings.Contains(name, "/") {
+		if r.isCompatible(name, loader) {
+			return name
+		}
+		return ""
+	}
+
+	var dirs []string
+	dirs = append(dirs, rpath...)
+	dirs = append(dirs, r.libraryPath...)
+	dirs = append(dirs, runpath...)
+	dirs = append(dirs, getSystemSearchDirs()...)
+	for _, dir := range dirs {
+		path := filepath.Join(dir, name)
+		if r.isCompatible(path, loader) {
+			return path
+		}
+	}
+	return ""
+}
+
+// isCompatible returns true if path is an ELF file which can be loaded
+// by the loader, i.e. which was built for the same architecture
+func (r *dependencyResolver) isCompatible(path string, loader *dynamicInfo) bool {
+	if _, err := os.Stat(path); err != nil {
+		return false
+	}
+	info, err := readDynamicInfo(path)
+	if err != nil {
+		return false
+	}
+	return info.class == loader.class && info.machine == loader.machine
+}
+
+// expandOrigin replaces $ORIGIN in the search path of an ELF file with
+// its directory. Directories containing other variables, e.g. $LIB, are
+// dropped.
+func expandOrigin(dirs []string, origin string) []string {
+	var res []string
+	for _, dir := range dirs {
+		dir = strings.ReplaceAll(dir, "${ORIGIN}", origin)
+		dir = strings.ReplaceAll(dir, "$ORIGIN", origin)
+		if strings.Contains(dir, "$") {
+			continue
+		}
+		res = append(res, dir)
+	}
+	return res
+}
@@ -3,12 +3,62 @@
 package ldd
 
 import (
+	"path/filepath"
+
 	"github.com/u-root/u-root/pkg/ldd"
 
+	"code-intelligence.com/cifuzz/pkg/log"
 	"code-intelligence.com/cifuzz/util/fileutil"
 )
 
+// NonSystemSharedLibraries returns the shared libraries outside of the
+// system library directories which the executable depends on, directly
+// or transitively, and the targets of those which are symlinks.
+//
+// The dependencies are found by reading the dynamic sections of the ELF
+// files, which are cached, so that resolving the dependencies of many
+// fuzz tests doesn't parse the same libraries over and over. Only if
+// that doesn't find all dependencies, we ask the dynamic loader.
 func NonSystemSharedLibraries(executable string) ([]string, error) {
+	r := newDependencyResolver()
+	ok, err := r.resolve(executable, nil)
+	if err != nil {
+		return nil, err
+	}
+	if !ok {
+		log.Debugf("Failed to find all shared libraries of %s, using the dynamic loader", executable)
+		return lddNonSystemSharedLibraries(executable)
+	}
+
+	var sharedObjects []string
+	seen := make(map[string]bool)
+	add := func(path string) {
+		if seen[path] {
+			return
+		}
+		seen[path] = true
+		if fileutil.IsSharedLibrary(path) && !fileutil.IsSystemLibrary(path) {
+			sharedObjects = append(sharedObjects, path)
+		}
+	}
+	for _, dep := range r.deps {
+		path, err := filepath.Abs(dep)
+		if err != nil {
+			return nil, err
+		}
+		add(path)
+		if fileutil.IsSymlink(path) {
+			target, err := filepath.EvalSymlinks(path)
+			if err != nil {
+				return nil, err
+			}
+			add(target)
+		}
+	}
+	return sharedObjects, nil
+}
+
+func lddNonSystemSharedLibraries(executable string) ([]string, error) {
 	var sharedObjects []string
 
 	// ldd provides the complete list of dynamic dependencies of a dynamically linked file.
@@ -1,7 +1,6 @@
 package dependencies
 
 import (
-	"bytes"
 	"fmt"
 	"os"
 	"os/exec"
@@ -174,17 +173,14 @@ func visualStudioVersion() (*semver.Version, error) {
 	return vsVersion, nil
 }
 
-// takes a command + args and parses the output for a semver
+// takes a command + args and parses the output for a semver. The output
+// is cached as long as the executable doesn't change, see versionCache.
 func getVersionFromCommand(cmdPath string, args []string, re *regexp.Regexp, key Key) (*semver.Version, error) {
-	output := bytes.Buffer{}
-	cmd := exec.Command(cmdPath, args...)
-	cmd.Stdout = &output
-	cmd.Stderr = &output
-	err := cmd.Run()
+	output, err := getVersionCache().commandOutput(cmdPath, args)
 	if err != nil {
-		return nil, errors.WithStack(err)
+		return nil, err
 	}
-	return extractVersion(output.String(), re, key)
+	return extractVersion(output, re, key)
 }
 
 func extractVersion(output string, re *regexp.Regexp, key Key) (*semver.Version, error) {
@@ -0,0 +1,179 @@
+package dependencies
+
+import (
+	"bytes"
+	"encoding/json"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// versionCache stores the output of the version commands of the
+// dependencies in the user cache directory, so that the commands are
+// only run again if the executable was replaced, e.g. by an update.
+// Other than that, checking the dependencies only stats the
+// executables.
+type versionCache struct {
+	path string
+
+	mutex   sync.Mutex
+	loaded  bool
+	entries map[string]*versionCacheEntry
+}
+
+type versionCacheEntry struct {
+	// The modification time and size of the resolved executable when
+	// the command was run
+	ModTime time.Time `json:"mod_time"`
+	Size    int64     `json:"size"`
+	Output  string    `json:"output"`
+}
+
+var (
+	defaultVersionCache     *versionCache
+	defaultVersionCacheOnce sync.Once
+)
+
+func getVersionCache() *versionCache {
+	defaultVersionCacheOnce.Do(func() {
+		cacheDir, err := os.UserCacheDir()
+		if err != nil {
+			log.Debugf("Not caching the versions of the dependencies: %v", err)
+			return
+		}
+		defaultVersionCache = newVersionCache(filepath.Join(cacheDir, "cifuzz", "dependency_versions.json"))
+	})
+	return defaultVersionCache
+}
+
+func newVersionCache(path string) *versionCache {
+	return &versionCache{path: path}
+}
+
+// commandOutput returns the combined output of the command, from the
+// cache if the executable didn't change since it was cached.
+func (c *versionCache) commandOutput(cmdPath string, args []string) (string, error) {
+	if c == nil {
+		return runVersionCommand(cmdPath, args)
+	}
+	resolvedPath, info, err := statExecutable(cmdPath)
+	if err != nil {
+		// Let running the command report the error
+		log.Debugf("Not caching the version of %s: %v", cmdPath, err)
+		return runVersionCommand(cmdPath, args)
+	}
+	key := strings.Join(append([]string{resolvedPath}, args...), " ")
+
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	c.load()
+	entry, ok := c.entries[key]
+	if ok && entry.ModTime.Equal(info.ModTime()) && entry.Size == info.Size() {
+		return entry.Output, nil
+	}
+
+	output, err := runVersionCommand(cmdPath, args)
+	if err != nil {
+		return "", err
+	}
+	c.entries[key] = &versionCacheEntry{ModTime: info.ModTime(), Size: info.Size(), Output: output}
+	err = c.save()
+	if err != nil {
+		log.Debugf("Failed to save the versions of the dependencies: %v", err)
+	}
+	return output, nil
+}
+
+// load reads the cache file once. A missing or invalid cache file
+// results in an empty cache.
+func (c *versionCache) load() {
+	if c.loaded {
+		return
+	}
+	c.loaded = true
+	c.entries = make(map[string]*versionCacheEntry)
+	data, err := os.ReadFile(c.path)
+	if err != nil {
+		if !os.IsNotExist(err) {
+			log.Debugf("Failed to read the versions of the dependencies: %v", err)
+		}
+		return
+	}
+	err = json.Unmarshal(data, &c.entries)
+	if err != nil {
+		log.Debugf("Ignoring invalid versions of the dependencies in %s: %v", c.path, err)
+		c.entries = make(map[string]*versionCacheEntry)
+	}
+}
+
+// save writes the cache file atomically, so that concurrent cifuzz
+// processes never read a partially written file.
+func (c *versionCache) save() error {
+	data, err := json.MarshalIndent(c.entries, "", "  ")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	err = os.MkdirAll(filepath.Dir(c.path), 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	tmpFile, err := os.CreateTemp(filepath.Dir(c.path), filepath.Base(c.path)+".*.tmp")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer os.Remove(tmpFile.Name())
+	_, err = tmpFile.Write(data)
+	if err != nil {
+		_ = tmpFile.Close()
+		return errors.WithStack(err)
+	}
+	err = tmpFile.Close()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(os.Rename(tmpFile.Name(), c.path))
+}
+
+// statExecutable returns the path of the executable which running
+// cmdPath executes, with all symlinks resolved, and its file info.
+// Compilers are commonly symlinks to the executable of a specific
+// version, e.g. /usr/bin/clang to clang-15, which is what changes when
+// a different version is installed.
+func statExecutable(cmdPath string) (string, os.FileInfo, error) {
+	path, err := exec.LookPath(cmdPath)
+	if err != nil {
+		return "", nil, errors.WithStack(err)
+	}
+	path, err = filepath.Abs(path)
+	if err != nil {
+		return "", nil, errors.WithStack(err)
+	}
+	path, err = filepath.EvalSymlinks(path)
+	if err != nil {
+		return "", nil, errors.WithStack(err)
+	}
+	info, err := os.Stat(path)
+	if err != nil {
+		return "", nil, errors.WithStack(err)
+	}
+	return path, info, nil
+}
+
+func runVersionCommand(cmdPath string, args []string) (string, error) {
+	output := bytes.Buffer{}
+	cmd := exec.Command(cmdPath, args...)
+	cmd.Stdout = &output
+	cmd.Stderr = &output
+	err := cmd.Run()
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return output.String(), nil
+}
@@ -0,0 +1,56 @@
+package dependencies
+
+import (
+	"os"
+	"path/filepath"
+	"runtime"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestVersionCache(t *testing.T) {
+	if runtime.GOOS == "windows" {
+		t.Skip("The fake cmake is a shell script")
+	}
+	dir := t.TempDir()
+	calls := filepath.Join(dir, "calls")
+	cmake := filepath.Join(dir, "cmake-3.24")
+	writeScript := func(version string) {
+		script := "#!/bin/sh\necho run >> " + calls + "\necho 'cmake version " + version + "'\n"
+		require.NoError(t, os.WriteFile(cmake, []byte(script), 0o755))
+	}
+	writeScript("3.24.1")
+	// The cache is keyed by the resolved executable
+	link := filepath.Join(dir, "cmake")
+	require.NoError(t, os.Symlink(cmake, link))
+	numCalls := func() int {
+		data, err := os.ReadFile(calls)
+		require.NoError(t, err)
+		return len(strings.Split(strings.TrimSpace(string(data)), "\n"))
+	}
+
+	cachePath := filepath.Join(dir, "cache", "dependency_versions.json")
+	output, err := newVersionCache(cachePath).commandOutput(link, []string{"--version"})
+	require.NoError(t, err)
+	assert.Equal(t, "cmake version 3.24.1\n", output)
+
+	// A new cache, like in the next cifuzz process, uses the cached
+	// output of the command
+	output, err = newVersionCache(cachePath).commandOutput(cmake, []string{"--version"})
+	require.NoError(t, err)
+	assert.Equal(t, "cmake version 3.24.1\n", output)
+	assert.Equal(t, 1, numCalls())
+
+	// The command is run again when the executable changed
+	writeScript("3.25.10")
+	future := time.Now().Add(time.Minute)
+	require.NoError(t, os.Chtimes(cmake, future, future))
+	output, err = newVersionCache(cachePath).commandOutput(link, []string{"--version"})
+	require.NoError(t, err)
+	assert.Equal(t, "cmake version 3.25.10\n", output)
+	assert.Equal(t, 2, numCalls())
+}
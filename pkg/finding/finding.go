@@ -1,6 +1,8 @@
 package finding
 
 import (
+	"crypto/sha256"
+	"encoding/hex"
 	"encoding/json"
 	"fmt"
 	"os"
@@ -111,6 +113,24 @@ func (f *Finding) GetSeedPath() string {
 	return ""
 }
 
+// StackHash identifies the bug behind a finding by its error type and
+// stack trace, unlike the name, which also depends on the input. Two
+// findings with the same stack hash are most likely duplicates. It's
+// empty if there is no stack trace, in which case we can't tell.
+func (f *Finding) StackHash() string {
+	if len(f.StackTrace) == 0 {
+		return ""
+	}
+	h := sha256.New()
+	// The details of sanitizer findings contain addresses, so only the
+	// error type is used
+	fmt.Fprintf(h, "%s\x00%s\x00", f.Type, f.ShortDescriptionColumns()[0])
+	for _, frame := range f.StackTrace {
+		fmt.Fprintf(h, "%s\x00%s\x00%d\x00%d\x00", frame.Function, frame.SourceFile, frame.Line, frame.Column)
+	}
+	return hex.EncodeToString(h.Sum(nil))
+}
+
 // Exists returns whether the JSON file of this finding already exists
 func (f *Finding) Exists(projectDir string) (bool, error) {
 	jsonPath := filepath.Join(projectDir, nameFindingsDir, f.Name, nameJSONFile)
@@ -131,7 +151,7 @@ func (f *Finding) Save(projectDir string) error {
 		return err
 	}
 
-	return nil
+	return f.appendToIndex(projectDir)
 }
 
 func (f *Finding) saveJSON(jsonPath string) error {
@@ -293,6 +313,10 @@ func ListFindings(projectDir string) ([]*Finding, error) {
 
 	var res []*Finding
 	for _, e := range entries {
+		// Skip the index and the lock file
+		if !e.IsDir() {
+			continue
+		}
 		f, err := LoadFinding(projectDir, e.Name())
 		if err != nil {
 			return nil, err
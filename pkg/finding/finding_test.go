@@ -9,6 +9,7 @@ import (
 	"github.com/stretchr/testify/require"
 
 	"code-intelligence.com/cifuzz/internal/testutil"
+	"code-intelligence.com/cifuzz/pkg/parser/libfuzzer/stacktrace"
 	"code-intelligence.com/cifuzz/util/stringutil"
 )
 
@@ -98,6 +99,35 @@ func TestListFindings(t *testing.T) {
 	require.Equal(t, finding, findings[0])
 }
 
+func TestFinding_StackHash(t *testing.T) {
+	stackTrace := []*stacktrace.StackFrame{
+		{SourceFile: "parser.cpp", Line: 12, Column: 5, Function: "parse"},
+		{SourceFile: "fuzz_test.cpp", Line: 7, Column: 3, Function: "LLVMFuzzerTestOneInputNoReturn"},
+	}
+	f1 := &Finding{
+		Type:       ErrorTypeCrash,
+		Details:    "heap-buffer-overflow on address 0x602000000011",
+		InputData:  []byte("a"),
+		StackTrace: stackTrace,
+	}
+	f2 := &Finding{
+		Type:       ErrorTypeCrash,
+		Details:    "heap-buffer-overflow on address 0x602000000031",
+		InputData:  []byte("b"),
+		StackTrace: stackTrace,
+	}
+	// Findings with a different input and address are the same bug
+	require.NotEmpty(t, f1.StackHash())
+	require.Equal(t, f1.StackHash(), f2.StackHash())
+
+	// A different error type at the same location is not
+	f2.Details = "use-after-free on address 0x602000000031"
+	require.NotEqual(t, f1.StackHash(), f2.StackHash())
+
+	// Without a stack trace, findings can't be told apart
+	require.Empty(t, testFinding().StackHash())
+}
+
 func testFinding() *Finding {
 	return &Finding{
 		Name: "test-name",
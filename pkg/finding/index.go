@@ -0,0 +1,364 @@
+package finding
+
+import (
+	"bufio"
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"time"
+
+	"github.com/alexflint/go-filemutex"
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// The index file in the findings directory to which a line is appended
+// whenever a finding is saved, so that findings can be listed without
+// loading all of their JSON files.
+const nameIndexFile = "index.jsonl"
+
+// The file in the findings directory which lists the names of the
+// maxRecentInputs newest findings, newest first, one per line. The
+// inputs of findings are copied to the seed corpus under their name, so
+// the replayer runs them before all other inputs when passed this file
+// via -run_first.
+const nameRecentInputsFile = "recent_inputs"
+
+const maxRecentInputs = 100
+
+// The number of lines per finding above which the index is compacted
+// when it's read, because saving a finding again appends another line
+const maxIndexLinesPerFinding = 4
+
+// Summary is the part of a finding which is stored in the index, which
+// is enough to list findings and to look them up by stack hash.
+type Summary struct {
+	Name      string    `json:"name"`
+	StackHash string    `json:"stack_hash,omitempty"`
+	CreatedAt time.Time `json:"created_at,omitempty"`
+	FuzzTest  string    `json:"fuzz_test,omitempty"`
+	Severity  *Severity `json:"severity,omitempty"`
+	// See Finding.ShortDescriptionColumns
+	ShortDescriptionColumns []string `json:"short_description_columns,omitempty"`
+}
+
+func (s *Summary) ShortDescription() string {
+	return strings.Join(s.ShortDescriptionColumns, " ")
+}
+
+func (f *Finding) summary() *Summary {
+	s := &Summary{
+		Name:                    f.Name,
+		StackHash:               f.StackHash(),
+		CreatedAt:               f.CreatedAt,
+		FuzzTest:                f.FuzzTest,
+		ShortDescriptionColumns: f.ShortDescriptionColumns(),
+	}
+	if f.MoreDetails != nil {
+		s.Severity = f.MoreDetails.Severity
+	}
+	return s
+}
+
+// appendToIndex adds the summary of the finding to the index and its
+// name to the front of the recent inputs. Findings are saved again when
+// they are found again, so the index can contain multiple lines per
+// finding, of which the last one is used.
+func (f *Finding) appendToIndex(projectDir string) error {
+	line, err := json.Marshal(f.summary())
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	return withFindingsLock(projectDir, func() error {
+		indexPath := filepath.Join(projectDir, nameFindingsDir, nameIndexFile)
+		file, err := os.OpenFile(indexPath, os.O_WRONLY|os.O_CREATE|os.O_APPEND, 0o644)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		_, err = file.Write(append(line, '\n'))
+		if err != nil {
+			file.Close()
+			return errors.WithStack(err)
+		}
+		err = file.Close()
+		if err != nil {
+			return errors.WithStack(err)
+		}
+
+		names, err := readRecentInputs(projectDir)
+		if err != nil {
+			return err
+		}
+		recent := []string{f.Name}
+		for _, name := range names {
+			if len(recent) == maxRecentInputs {
+				break
+			}
+			if name != f.Name {
+				recent = append(recent, name)
+			}
+		}
+		return writeRecentInputs(projectDir, recent)
+	})
+}
+
+// ListFindingSummaries returns the summaries of all findings, starting
+// with the newest. They are read from the index, which is rebuilt from
+// the JSON files of the findings if it doesn't match the finding
+// directories, e.g. because they were created by an older version of
+// cifuzz or deleted manually.
+func ListFindingSummaries(projectDir string) ([]*Summary, error) {
+	findingsDir := filepath.Join(projectDir, nameFindingsDir)
+	entries, err := os.ReadDir(findingsDir)
+	if os.IsNotExist(err) {
+		return []*Summary{}, nil
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	findingDirs := make(map[string]bool)
+	for _, e := range entries {
+		if e.IsDir() {
+			findingDirs[e.Name()] = true
+		}
+	}
+
+	summaries, numLines, err := readIndex(projectDir)
+	if err != nil {
+		return nil, err
+	}
+	upToDate := len(summaries) == len(findingDirs)
+	for name := range summaries {
+		if !findingDirs[name] {
+			upToDate = false
+			break
+		}
+	}
+	if !upToDate {
+		log.Debugf("Rebuilding the findings index in %s", findingsDir)
+		summaries, err = rebuildIndex(projectDir)
+		if err != nil {
+			return nil, err
+		}
+	} else if numLines > maxIndexLinesPerFinding*len(summaries) {
+		log.Debugf("Compacting the findings index in %s", findingsDir)
+		err = compactIndex(projectDir)
+		if err != nil {
+			return nil, err
+		}
+	}
+
+	return sortedSummaries(summaries), nil
+}
+
+// RecentInputs returns the paths of the crashing inputs of the at most
+// max newest findings of the fuzz test.
+func RecentInputs(projectDir string, fuzzTest string, max int) ([]string, error) {
+	summaries, err := ListFindingSummaries(projectDir)
+	if err != nil {
+		return nil, err
+	}
+	var inputs []string
+	for _, s := range summaries {
+		if len(inputs) == max {
+			break
+		}
+		if s.FuzzTest != fuzzTest {
+			continue
+		}
+		path := filepath.Join(projectDir, nameFindingsDir, s.Name, nameCrashingInput)
+		_, err = os.Stat(path)
+		if os.IsNotExist(err) {
+			continue
+		}
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		inputs = append(inputs, path)
+	}
+	return inputs, nil
+}
+
+// sortedSummaries returns the summaries starting with the newest
+func sortedSummaries(summaries map[string]*Summary) []*Summary {
+	res := make([]*Summary, 0, len(summaries))
+	for _, s := range summaries {
+		res = append(res, s)
+	}
+	sort.SliceStable(res, func(i, j int) bool {
+		if res[i].CreatedAt.Equal(res[j].CreatedAt) {
+			return res[i].Name < res[j].Name
+		}
+		return res[i].CreatedAt.After(res[j].CreatedAt)
+	})
+	return res
+}
+
+// readRecentInputs returns the names in the recent inputs file. Must
+// be called while holding the findings lock.
+func readRecentInputs(projectDir string) ([]string, error) {
+	content, err := os.ReadFile(filepath.Join(projectDir, nameFindingsDir, nameRecentInputsFile))
+	if os.IsNotExist(err) {
+		return nil, nil
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return strings.Fields(string(content)), nil
+}
+
+// writeRecentInputs replaces the names in the recent inputs file. Must
+// be called while holding the findings lock.
+func writeRecentInputs(projectDir string, names []string) error {
+	var content strings.Builder
+	for _, name := range names {
+		content.WriteString(name)
+		content.WriteByte('\n')
+	}
+	path := filepath.Join(projectDir, nameFindingsDir, nameRecentInputsFile)
+	tmpPath := path + ".tmp"
+	err := os.WriteFile(tmpPath, []byte(content.String()), 0o644)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(os.Rename(tmpPath, path))
+}
+
+// readIndex returns the last summary of each finding in the index and
+// the number of lines of the index
+func readIndex(projectDir string) (map[string]*Summary, int, error) {
+	summaries := make(map[string]*Summary)
+
+	file, err := os.Open(filepath.Join(projectDir, nameFindingsDir, nameIndexFile))
+	if os.IsNotExist(err) {
+		return summaries, 0, nil
+	}
+	if err != nil {
+		return nil, 0, errors.WithStack(err)
+	}
+	defer file.Close()
+
+	numLines := 0
+	scanner := bufio.NewScanner(file)
+	scanner.Buffer(make([]byte, 0, 64*1024), 1024*1024)
+	for scanner.Scan() {
+		numLines++
+		var s Summary
+		err = json.Unmarshal(scanner.Bytes(), &s)
+		if err != nil {
+			// A line is only incomplete if cifuzz was killed while
+			// writing it, which causes the index to be rebuilt.
+			log.Debugf("Ignoring invalid line in the findings index: %v", err)
+			continue
+		}
+		summaries[s.Name] = &s
+	}
+	if err := scanner.Err(); err != nil {
+		return nil, 0, errors.WithStack(err)
+	}
+	return summaries, numLines, nil
+}
+
+// rebuildIndex replaces the index with the summaries of all findings
+// and returns them.
+func rebuildIndex(projectDir string) (map[string]*Summary, error) {
+	findings, err := ListFindings(projectDir)
+	if err != nil {
+		return nil, err
+	}
+
+	summaries := make(map[string]*Summary)
+	for _, f := range findings {
+		s := f.summary()
+		summaries[s.Name] = s
+	}
+
+	err = withFindingsLock(projectDir, func() error {
+		err := writeIndex(projectDir, summaries)
+		if err != nil {
+			return err
+		}
+		var names []string
+		for _, s := range sortedSummaries(summaries) {
+			if len(names) == maxRecentInputs {
+				break
+			}
+			names = append(names, s.Name)
+		}
+		return writeRecentInputs(projectDir, names)
+	})
+	if err != nil {
+		return nil, err
+	}
+	return summaries, nil
+}
+
+// compactIndex replaces the index with the last summary of each
+// finding in it. The index is read again while holding the findings
+// lock, so that no summaries appended in the meantime are lost.
+func compactIndex(projectDir string) error {
+	return withFindingsLock(projectDir, func() error {
+		summaries, _, err := readIndex(projectDir)
+		if err != nil {
+			return err
+		}
+		return writeIndex(projectDir, summaries)
+	})
+}
+
+// writeIndex replaces the index with one line per summary, oldest
+// first. Must be called while holding the findings lock.
+func writeIndex(projectDir string, summaries map[string]*Summary) error {
+	sorted := sortedSummaries(summaries)
+	var content []byte
+	for i := len(sorted) - 1; i >= 0; i-- {
+		line, err := json.Marshal(sorted[i])
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		content = append(content, line...)
+		content = append(content, '\n')
+	}
+
+	indexPath := filepath.Join(projectDir, nameFindingsDir, nameIndexFile)
+	tmpPath := indexPath + ".tmp"
+	err := os.WriteFile(tmpPath, content, 0o644)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	return errors.WithStack(os.Rename(tmpPath, indexPath))
+}
+
+// withFindingsLock runs fn while holding a file lock on the findings
+// directory, to avoid races with other cifuzz processes updating the
+// index in parallel.
+func withFindingsLock(projectDir string, fn func() error) error {
+	findingsDir := filepath.Join(projectDir, nameFindingsDir)
+	err := os.MkdirAll(findingsDir, 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	mutex, err := filemutex.New(filepath.Join(findingsDir, lockFile))
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	err = mutex.Lock()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	err = fn()
+
+	unlockErr := mutex.Unlock()
+	if err == nil {
+		return errors.WithStack(unlockErr)
+	}
+	if unlockErr != nil {
+		log.Error(unlockErr)
+	}
+	return err
+}
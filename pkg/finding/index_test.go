@@ -0,0 +1,108 @@
+package finding
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+)
+
+func TestListFindingSummaries(t *testing.T) {
+	projectDir, err := os.MkdirTemp(testBaseDir, "index-test-")
+	require.NoError(t, err)
+
+	older := testFinding()
+	older.Name = "older"
+	older.CreatedAt = time.Now().Add(-time.Hour)
+	newer := testFinding()
+	newer.Name = "newer"
+	newer.CreatedAt = time.Now()
+	newer.MoreDetails = &ErrorDetails{Severity: &Severity{Score: 7}}
+	require.NoError(t, older.Save(projectDir))
+	require.NoError(t, newer.Save(projectDir))
+	// Saving a finding again doesn't list it twice
+	require.NoError(t, newer.Save(projectDir))
+
+	summaries, err := ListFindingSummaries(projectDir)
+	require.NoError(t, err)
+	require.Len(t, summaries, 2)
+	require.Equal(t, "newer", summaries[0].Name)
+	require.Equal(t, float32(7), summaries[0].Severity.Score)
+	require.Equal(t, newer.ShortDescription(), summaries[0].ShortDescription())
+	require.Equal(t, "older", summaries[1].Name)
+	recentInputs, err := os.ReadFile(filepath.Join(projectDir, nameFindingsDir, nameRecentInputsFile))
+	require.NoError(t, err)
+	require.Equal(t, "newer\nolder\n", string(recentInputs))
+
+	// The index is rebuilt if a finding was deleted
+	require.NoError(t, os.RemoveAll(filepath.Join(projectDir, nameFindingsDir, "older")))
+	summaries, err = ListFindingSummaries(projectDir)
+	require.NoError(t, err)
+	require.Len(t, summaries, 1)
+	require.Equal(t, "newer", summaries[0].Name)
+	recentInputs, err = os.ReadFile(filepath.Join(projectDir, nameFindingsDir, nameRecentInputsFile))
+	require.NoError(t, err)
+	require.Equal(t, "newer\n", string(recentInputs))
+
+	// ... and if it doesn't exist, e.g. because the findings were saved
+	// by an older version
+	require.NoError(t, os.Remove(filepath.Join(projectDir, nameFindingsDir, nameIndexFile)))
+	summaries, err = ListFindingSummaries(projectDir)
+	require.NoError(t, err)
+	require.Len(t, summaries, 1)
+	require.FileExists(t, filepath.Join(projectDir, nameFindingsDir, nameIndexFile))
+}
+
+func TestIndexIsCompacted(t *testing.T) {
+	projectDir, err := os.MkdirTemp(testBaseDir, "index-test-")
+	require.NoError(t, err)
+	indexPath := filepath.Join(projectDir, nameFindingsDir, nameIndexFile)
+	recentInputsPath := filepath.Join(projectDir, nameFindingsDir, nameRecentInputsFile)
+
+	start := time.Now().Add(-time.Hour)
+	for i := 0; i <= maxRecentInputs; i++ {
+		f := testFinding()
+		f.Name = fmt.Sprintf("finding-%03d", i)
+		f.CreatedAt = start.Add(time.Duration(i) * time.Second)
+		require.NoError(t, f.Save(projectDir))
+	}
+
+	// The recent inputs only list the newest findings
+	recentInputs, err := os.ReadFile(recentInputsPath)
+	require.NoError(t, err)
+	names := strings.Fields(string(recentInputs))
+	require.Len(t, names, maxRecentInputs)
+	require.Equal(t, fmt.Sprintf("finding-%03d", maxRecentInputs), names[0])
+	require.Equal(t, "finding-001", names[len(names)-1])
+
+	// Saving a finding again moves it to the front of the recent inputs
+	// and appends another line to the index
+	found := testFinding()
+	found.Name = "finding-000"
+	found.CreatedAt = time.Now()
+	for i := 0; i < maxIndexLinesPerFinding*(maxRecentInputs+1); i++ {
+		require.NoError(t, found.Save(projectDir))
+	}
+	recentInputs, err = os.ReadFile(recentInputsPath)
+	require.NoError(t, err)
+	names = strings.Fields(string(recentInputs))
+	require.Len(t, names, maxRecentInputs)
+	require.Equal(t, "finding-000", names[0])
+	require.Equal(t, "finding-002", names[len(names)-1])
+
+	// The index is compacted once it's read
+	summaries, err := ListFindingSummaries(projectDir)
+	require.NoError(t, err)
+	require.Len(t, summaries, maxRecentInputs+1)
+	require.Equal(t, "finding-000", summaries[0].Name)
+	index, err := os.ReadFile(indexPath)
+	require.NoError(t, err)
+	require.Equal(t, maxRecentInputs+1, strings.Count(string(index), "\n"))
+	summaries, err = ListFindingSummaries(projectDir)
+	require.NoError(t, err)
+	require.Len(t, summaries, maxRecentInputs+1)
+}
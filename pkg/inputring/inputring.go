@@ -0,0 +1,97 @@
+// Package inputring reads the ring of the last inputs which fuzz tests
+// linked against src/inputring.c write to a memory-mapped file, so that
+// the inputs can be recovered after the fuzz test was killed.
+package inputring
+
+import (
+	"bytes"
+	"encoding/binary"
+	"os"
+	"sort"
+
+	"github.com/pkg/errors"
+)
+
+// EnvVar is the environment variable which enables the input ring of a
+// fuzz test, set to the path of the file to create.
+const EnvVar = "CIFUZZ_INPUT_RING"
+
+// The layout of the file, see src/inputring.c. The integers are in the
+// native byte order, which is little endian on all platforms on which
+// the input ring is supported.
+const (
+	magic          = "CIFZRNG1"
+	headerSize     = 64
+	slotHeaderSize = 16
+
+	stateRunning = 1
+)
+
+// Input is one of the inputs in the ring.
+type Input struct {
+	// Seq is the number of the input, counting from one in the order in
+	// which they were executed
+	Seq uint64
+	// Data is the input, which is truncated to the slot size of the ring
+	// if it was longer
+	Data []byte
+	// Size is the length of the input before it was truncated
+	Size uint32
+	// Running is true if the fuzz test didn't return from the input,
+	// which means that it was being executed when the fuzz test exited
+	Running bool
+}
+
+// Truncated returns true if the input was longer than the slot size of
+// the ring.
+func (i *Input) Truncated() bool {
+	return uint32(len(i.Data)) < i.Size
+}
+
+// Read returns the inputs in the ring at path, oldest first. It returns
+// no inputs and no error if the file does not exist or wasn't
+// completely initialized, which is the case if the fuzz test wasn't
+// linked against the input ring or exited before the first input.
+func Read(path string) ([]*Input, error) {
+	content, err := os.ReadFile(path)
+	if os.IsNotExist(err) {
+		return nil, nil
+	}
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	if len(content) < headerSize || !bytes.Equal(content[:len(magic)], []byte(magic)) {
+		return nil, nil
+	}
+
+	numSlots := binary.LittleEndian.Uint32(content[8:])
+	slotSize := binary.LittleEndian.Uint32(content[12:])
+	stride := (uint64(slotHeaderSize) + uint64(slotSize) + 7) &^ 7
+	if numSlots == 0 || uint64(len(content)) < headerSize+uint64(numSlots)*stride {
+		return nil, errors.Errorf("Input ring %s is truncated or corrupt", path)
+	}
+
+	var inputs []*Input
+	for i := uint64(0); i < uint64(numSlots); i++ {
+		slot := content[headerSize+i*stride : headerSize+(i+1)*stride]
+		seq := binary.LittleEndian.Uint64(slot)
+		if seq == 0 {
+			// The slot is empty or the fuzz test was killed while it
+			// copied the input
+			continue
+		}
+		size := binary.LittleEndian.Uint32(slot[8:])
+		storedSize := size
+		if storedSize > slotSize {
+			storedSize = slotSize
+		}
+		inputs = append(inputs, &Input{
+			Seq:     seq,
+			Data:    append([]byte(nil), slot[slotHeaderSize:slotHeaderSize+storedSize]...),
+			Size:    size,
+			Running: binary.LittleEndian.Uint32(slot[12:]) == stateRunning,
+		})
+	}
+	sort.Slice(inputs, func(i, j int) bool { return inputs[i].Seq < inputs[j].Seq })
+	return inputs, nil
+}
@@ -0,0 +1,152 @@
+package inputring
+
+import (
+	"encoding/binary"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"syscall"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+// writeRing writes a ring with the given slot size and one slot per
+// input, in the layout of src/inputring.c.
+func writeRing(t *testing.T, slotSize uint32, inputs []*Input) string {
+	stride := (slotHeaderSize + int(slotSize) + 7) &^ 7
+	content := make([]byte, headerSize+len(inputs)*stride)
+	copy(content, magic)
+	binary.LittleEndian.PutUint32(content[8:], uint32(len(inputs)))
+	binary.LittleEndian.PutUint32(content[12:], slotSize)
+	for i, input := range inputs {
+		slot := content[headerSize+i*stride:]
+		binary.LittleEndian.PutUint64(slot, input.Seq)
+		binary.LittleEndian.PutUint32(slot[8:], input.Size)
+		state := uint32(2)
+		if input.Running {
+			state = stateRunning
+		}
+		binary.LittleEndian.PutUint32(slot[12:], state)
+		copy(slot[slotHeaderSize:], input.Data)
+	}
+	path := filepath.Join(t.TempDir(), "ring")
+	require.NoError(t, os.WriteFile(path, content, 0o644))
+	return path
+}
+
+func TestRead(t *testing.T) {
+	path := writeRing(t, 4, []*Input{
+		{Seq: 5, Data: []byte("fuzz"), Size: 6, Running: true},
+		{Seq: 2, Data: []byte("ab"), Size: 2},
+		// An empty slot
+		{},
+		{Seq: 4, Data: []byte{}, Size: 0},
+	})
+
+	inputs, err := Read(path)
+	require.NoError(t, err)
+	require.Len(t, inputs, 3)
+	assert.Equal(t, uint64(2), inputs[0].Seq)
+	assert.Equal(t, []byte("ab"), inputs[0].Data)
+	assert.False(t, inputs[0].Running)
+	assert.Equal(t, uint64(4), inputs[1].Seq)
+	assert.Empty(t, inputs[1].Data)
+	assert.Equal(t, uint64(5), inputs[2].Seq)
+	assert.Equal(t, []byte("fuzz"), inputs[2].Data)
+	assert.True(t, inputs[2].Running)
+	assert.True(t, inputs[2].Truncated())
+}
+
+func TestRead_Missing(t *testing.T) {
+	inputs, err := Read(filepath.Join(t.TempDir(), "ring"))
+	require.NoError(t, err)
+	assert.Empty(t, inputs)
+
+	// A ring whose header wasn't written yet
+	path := filepath.Join(t.TempDir(), "ring")
+	require.NoError(t, os.WriteFile(path, make([]byte, headerSize), 0o644))
+	inputs, err = Read(path)
+	require.NoError(t, err)
+	assert.Empty(t, inputs)
+}
+
+func TestRead_Truncated(t *testing.T) {
+	path := writeRing(t, 16, []*Input{{Seq: 1, Data: []byte("abc"), Size: 3}})
+	require.NoError(t, os.Truncate(path, headerSize+8))
+	_, err := Read(path)
+	require.Error(t, err)
+}
+
+// Tests that the inputs written by src/inputring.c survive a SIGKILL
+func TestRead_Killed(t *testing.T) {
+	if runtime.GOOS != "linux" {
+		t.Skip("The input ring is only supported on Linux")
+	}
+	cc, err := exec.LookPath("cc")
+	if err != nil {
+		t.Skip("No C compiler found")
+	}
+
+	dir := t.TempDir()
+	// The fuzz test is called from another file, like libFuzzer does,
+	// because --wrap only applies to undefined references
+	testSource := filepath.Join(dir, "fuzz_test.c")
+	require.NoError(t, os.WriteFile(testSource, []byte(`
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size > 0 && data[0] == 'K') {
+    raise(SIGKILL);
+  }
+  return 0;
+}
+`), 0o644))
+	mainSource := filepath.Join(dir, "main.c")
+	require.NoError(t, os.WriteFile(mainSource, []byte(`
+#include <stddef.h>
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(void) {
+  char input[2] = {'a', 0};
+  for (int i = 0; i < 10; i++) {
+    input[1] = (char) ('0' + i);
+    LLVMFuzzerTestOneInput((const uint8_t *) input, sizeof(input));
+  }
+  LLVMFuzzerTestOneInput((const uint8_t *) "Kill", 4);
+  return 0;
+}
+`), 0o644))
+	executable := filepath.Join(dir, "fuzz_test")
+	ringSource := filepath.Join("..", "..", "tools", "inputring", "inputring.c")
+	cmd := exec.Command(cc, "-o", executable, mainSource, testSource, ringSource, "-Wl,--wrap=LLVMFuzzerTestOneInput")
+	out, err := cmd.CombinedOutput()
+	require.NoError(t, err, string(out))
+
+	ringPath := filepath.Join(dir, "ring")
+	cmd = exec.Command(executable)
+	cmd.Env = append(os.Environ(), EnvVar+"="+ringPath, "CIFUZZ_INPUT_RING_SLOTS=4", "CIFUZZ_INPUT_RING_SLOT_SIZE=3")
+	err = cmd.Run()
+	var exitErr *exec.ExitError
+	require.ErrorAs(t, err, &exitErr)
+	assert.Equal(t, syscall.SIGKILL, exitErr.Sys().(syscall.WaitStatus).Signal())
+
+	inputs, err := Read(ringPath)
+	require.NoError(t, err)
+	require.Len(t, inputs, 4)
+	for i, input := range inputs[:3] {
+		assert.Equal(t, uint64(8+i), input.Seq)
+		assert.Equal(t, []byte{'a', byte('7' + i)}, input.Data)
+		assert.False(t, input.Running)
+	}
+	assert.Equal(t, uint64(11), inputs[3].Seq)
+	assert.Equal(t, []byte("Kil"), inputs[3].Data)
+	assert.Equal(t, uint32(4), inputs[3].Size)
+	assert.True(t, inputs[3].Running)
+}
@@ -0,0 +1,251 @@
+package minijail
+
+import (
+	"bufio"
+	"os"
+	"path/filepath"
+	"strconv"
+	"strings"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// CgroupParentEnvVarName is an environment variable which users can use
+// to specify the cgroup v2 directory below which the cgroups of the
+// sandboxes are created. It must be writable and not contain any
+// processes, e.g. an empty child of a cgroup delegated by systemd. By
+// default, they are created below the cgroup of the cifuzz process,
+// which only works if the required controllers are enabled in it
+// already.
+const CgroupParentEnvVarName = "CIFUZZ_MINIJAIL_CGROUP_PARENT"
+
+// Resources are the limits of a sandbox which are enforced by a cgroup
+// v2 created for it. Zero values, or no IOMax entries, mean no limit.
+type Resources struct {
+	// MemoryMax is the maximum memory usage of all processes in the
+	// sandbox in bytes, see memory.max in the cgroup v2 documentation.
+	MemoryMax uint64
+	// CPUWeight is the relative share of CPU time between 1 and 10000,
+	// the default is 100, see cpu.weight.
+	CPUWeight uint64
+	// IOMax are lines in the format of io.max, e.g.
+	// "8:0 rbps=1048576 wiops=120".
+	IOMax []string
+}
+
+func (r *Resources) controllers() []string {
+	var controllers []string
+	if r.MemoryMax != 0 {
+		controllers = append(controllers, "memory")
+	}
+	if r.CPUWeight != 0 {
+		controllers = append(controllers, "cpu")
+	}
+	if len(r.IOMax) != 0 {
+		controllers = append(controllers, "io")
+	}
+	return controllers
+}
+
+// Cgroup is a cgroup v2 which contains the processes of one sandbox.
+type Cgroup struct {
+	Path string
+}
+
+// CgroupStats are the resources used by the processes of a cgroup.
+type CgroupStats struct {
+	// CPUSeconds is the CPU time used so far, in user and system mode.
+	CPUSeconds float64
+	// MemoryBytes is the current memory usage.
+	MemoryBytes uint64
+	// PeakMemoryBytes is the maximum memory usage so far, which is only
+	// reported by Linux 5.19 and later.
+	PeakMemoryBytes uint64
+}
+
+// NewCgroup creates a cgroup with the given limits below the
+// directory specified via CgroupParentEnvVarName or the cgroup of the
+// current process.
+func NewCgroup(res *Resources) (*Cgroup, error) {
+	parent := os.Getenv(CgroupParentEnvVarName)
+	if parent == "" {
+		var err error
+		parent, err = ownCgroup()
+		if err != nil {
+			return nil, err
+		}
+	}
+
+	// Controllers can only be used in a cgroup if they are enabled in
+	// the subtree_control of its parent, which requires that the
+	// parent doesn't contain any processes itself. That's not the case
+	// for the cgroup of the current process, unless it's a delegated
+	// one, so we suggest to use one.
+	for _, controller := range res.controllers() {
+		err := enableController(parent, controller)
+		if err != nil {
+			return nil, errors.Wrapf(err, "Failed to enable the %s controller in %s, set %s to a delegated cgroup",
+				controller, parent, CgroupParentEnvVarName)
+		}
+	}
+
+	path, err := os.MkdirTemp(parent, "cifuzz-minijail-")
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	cgroup := &Cgroup{Path: path}
+
+	var settings [][2]string
+	if res.MemoryMax != 0 {
+		settings = append(settings, [2]string{"memory.max", strconv.FormatUint(res.MemoryMax, 10)})
+		// Don't swap out the memory above the limit, which would slow
+		// down the fuzz test instead of letting it run out of memory.
+		settings = append(settings, [2]string{"memory.swap.max", "0"})
+	}
+	if res.CPUWeight != 0 {
+		settings = append(settings, [2]string{"cpu.weight", strconv.FormatUint(res.CPUWeight, 10)})
+	}
+	for _, line := range res.IOMax {
+		settings = append(settings, [2]string{"io.max", line})
+	}
+	for _, setting := range settings {
+		err = os.WriteFile(filepath.Join(path, setting[0]), []byte(setting[1]), 0)
+		if errors.Is(err, os.ErrNotExist) && setting[0] == "memory.swap.max" {
+			// The kernel was built without swap support
+			continue
+		}
+		if err != nil {
+			cgroup.Remove()
+			return nil, errors.Wrapf(err, "Failed to set %s to %q", setting[0], setting[1])
+		}
+	}
+
+	log.Debugf("Created cgroup %s", path)
+	return cgroup, nil
+}
+
+// ProcsPath is the file to which the PIDs of processes have to be
+// written to move them into the cgroup.
+func (c *Cgroup) ProcsPath() string {
+	return filepath.Join(c.Path, "cgroup.procs")
+}
+
+// Stats returns the resources used by the processes of the cgroup,
+// including those which already exited.
+func (c *Cgroup) Stats() (*CgroupStats, error) {
+	stats := &CgroupStats{}
+
+	f, err := os.Open(filepath.Join(c.Path, "cpu.stat"))
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	defer f.Close()
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		key, value, found := strings.Cut(scanner.Text(), " ")
+		if !found || key != "usage_usec" {
+			continue
+		}
+		usec, err := strconv.ParseUint(value, 10, 64)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		stats.CPUSeconds = float64(usec) / 1e6
+	}
+	if err := scanner.Err(); err != nil {
+		return nil, errors.WithStack(err)
+	}
+
+	// The memory files only exist if the memory controller is enabled
+	stats.MemoryBytes, err = readCgroupUint(filepath.Join(c.Path, "memory.current"))
+	if err != nil && !errors.Is(err, os.ErrNotExist) {
+		return nil, err
+	}
+	stats.PeakMemoryBytes, err = readCgroupUint(filepath.Join(c.Path, "memory.peak"))
+	if err != nil && !errors.Is(err, os.ErrNotExist) {
+		return nil, err
+	}
+
+	return stats, nil
+}
+
+// Remove removes the cgroup, which fails if it still contains
+// processes, so it should only be called after the sandbox exited.
+func (c *Cgroup) Remove() {
+	err := os.Remove(c.Path)
+	if err != nil {
+		log.Debugf("Failed to remove cgroup %s: %v", c.Path, err)
+	}
+}
+
+// ownCgroup returns the directory of the cgroup v2 of the current
+// process.
+func ownCgroup() (string, error) {
+	mountPoint, err := cgroup2MountPoint()
+	if err != nil {
+		return "", err
+	}
+	content, err := os.ReadFile("/proc/self/cgroup")
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	// The cgroup v2 is the one with hierarchy ID 0 and no controllers
+	for _, line := range strings.Split(string(content), "\n") {
+		if strings.HasPrefix(line, "0::") {
+			return filepath.Join(mountPoint, strings.TrimPrefix(line, "0::")), nil
+		}
+	}
+	return "", errors.New("The current process is not in a cgroup v2")
+}
+
+// cgroup2MountPoint returns where the cgroup v2 hierarchy is mounted,
+// which is /sys/fs/cgroup on most systems, but /sys/fs/cgroup/unified
+// on those which still use cgroup v1 for the controllers.
+func cgroup2MountPoint() (string, error) {
+	f, err := os.Open("/proc/self/mountinfo")
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer f.Close()
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		// The fields after the optional ones, which are terminated by
+		// a "-", are the filesystem type, the source and the options.
+		// See proc(5).
+		fields := strings.Fields(scanner.Text())
+		for i, field := range fields {
+			if field == "-" && i+1 < len(fields) && fields[i+1] == "cgroup2" && i > 4 {
+				return fields[4], nil
+			}
+		}
+	}
+	if err := scanner.Err(); err != nil {
+		return "", errors.WithStack(err)
+	}
+	return "", errors.New("No cgroup v2 hierarchy is mounted")
+}
+
+func enableController(parent, controller string) error {
+	content, err := os.ReadFile(filepath.Join(parent, "cgroup.subtree_control"))
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	for _, enabled := range strings.Fields(string(content)) {
+		if enabled == controller {
+			return nil
+		}
+	}
+	err = os.WriteFile(filepath.Join(parent, "cgroup.subtree_control"), []byte("+"+controller), 0)
+	return errors.WithStack(err)
+}
+
+func readCgroupUint(path string) (uint64, error) {
+	content, err := os.ReadFile(path)
+	if err != nil {
+		return 0, errors.WithStack(err)
+	}
+	value, err := strconv.ParseUint(strings.TrimSpace(string(content)), 10, 64)
+	return value, errors.WithStack(err)
+}
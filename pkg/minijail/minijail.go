@@ -1,13 +1,21 @@
 package minijail
 
 import (
+	"bufio"
+	"crypto/sha256"
+	"encoding/hex"
 	"fmt"
+	"io"
 	"os"
+	"os/exec"
 	"path/filepath"
+	"runtime"
+	"sort"
 	"strconv"
 	"strings"
 
 	"github.com/pkg/errors"
+	"github.com/spf13/viper"
 
 	"code-intelligence.com/cifuzz/pkg/log"
 	"code-intelligence.com/cifuzz/pkg/runfiles"
@@ -23,6 +31,20 @@ const (
 	// path and <writeable> is either 0 or 1.
 	BindingsEnvVarName = "CIFUZZ_MINIJAIL_BINDINGS"
 
+	// SeccompPolicyEnvVarName is an environment variable which users
+	// can use to specify a minijail seccomp policy file, see
+	// minijail0(5), which restricts the syscalls of the fuzz test. The
+	// policy is compiled once and the BPF program is cached, so that
+	// runs don't have to compile it again.
+	SeccompPolicyEnvVarName = "CIFUZZ_MINIJAIL_SECCOMP_POLICY"
+
+	// SeccompProfileEnvVarName is an environment variable which users
+	// can use to specify a file to which minijail writes a seccomp
+	// policy allowing all syscalls the fuzz test made, ordered by how
+	// often they were made. It takes precedence over
+	// SeccompPolicyEnvVarName.
+	SeccompProfileEnvVarName = "CIFUZZ_MINIJAIL_SECCOMP_PROFILE"
+
 	// Mount flags as defined in golang.org/x/sys/unix. We're not using
 	// that package because it's not available on macOS.
 	MS_RDONLY      = 0x1       //nolint:all
@@ -134,47 +156,56 @@ var defaultBindings = []*Binding{
 	{Source: "/dev/urandom", Writable: ReadWrite},
 }
 
+// WriteBackDir is a writable directory which the sandboxed command
+// writes to via a size-limited tmpfs, e.g. to avoid slow synchronous
+// writes to a network file system. The process wrapper moves the files
+// created in the tmpfs to the directory every few seconds and when the
+// command exits.
+type WriteBackDir struct {
+	// Dir is the directory which receives the files.
+	Dir string
+	// Path is the existing directory on which the tmpfs is mounted in
+	// the sandbox.
+	Path string
+	// Size is the size limit of the tmpfs in the format of the size
+	// option of tmpfs(5), e.g. "512m".
+	Size string
+}
+
 type Options struct {
-	Args      []string
-	Bindings  []*Binding
-	OutputDir string
+	Args          []string
+	Bindings      []*Binding
+	OutputDir     string
+	WriteBackDirs []*WriteBackDir
+	// Resources, if set, limit the resources of the sandbox via a
+	// cgroup v2, see NewCgroup.
+	Resources *Resources
 }
 
 type minijail struct {
 	*Options
-	Args      []string
-	chrootDir string
+	Args []string
+	// Cgroup is the cgroup of the sandbox if Options.Resources are set
+	Cgroup *Cgroup
 }
 
 func NewMinijail(opts *Options) (*minijail, error) {
-	// Evaluate symlinks in the executable path
-	path, err := filepath.EvalSymlinks(opts.Args[0])
-	if err != nil {
-		return nil, errors.WithStack(err)
-	}
-	opts.Args[0] = path
-
-	// --------------------------
-	// --- Create directories ---
-	// --------------------------
-	// Create chroot directory
-	chrootDir, err := os.MkdirTemp("", "minijail-chroot-")
-	if err != nil {
-		return nil, err
-	}
+	return newMinijail(opts, false)
+}
 
-	// Create /tmp, /proc directories.
-	for _, dir := range []string{"/proc", "/tmp"} {
-		err = os.MkdirAll(filepath.Join(chrootDir, dir), 0o755)
+// newMinijail returns the minijail0 command which runs opts.Args in
+// the sandbox or, if serve is true, the process wrapper in --serve
+// mode, which runs the commands sent to it by a Pool.
+func newMinijail(opts *Options, serve bool) (*minijail, error) {
+	var path string
+	var err error
+	if !serve {
+		// Evaluate symlinks in the executable path
+		path, err = filepath.EvalSymlinks(opts.Args[0])
 		if err != nil {
 			return nil, errors.WithStack(err)
 		}
-	}
-
-	// Create /dev/shm which is required to allow using shared memory
-	err = os.MkdirAll(filepath.Join(chrootDir, "dev", "shm"), 0o755)
-	if err != nil {
-		return nil, errors.WithStack(err)
+		opts.Args[0] = path
 	}
 
 	// ----------------------------
@@ -206,8 +237,29 @@ func NewMinijail(opts *Options) (*minijail, error) {
 	// perfect.
 	minijailArgs = append(minijailArgs, "-T", "static", "--ambient")
 
-	// Change root filesystem to the chroot directory. See pivot_root(2).
-	minijailArgs = append(minijailArgs, "-P", chrootDir)
+	// In verbose mode, minijail logs how long the phases of launching
+	// the sandbox take, which are printed as debug output by the
+	// OutputFilter
+	if viper.GetBool("verbose") {
+		minijailArgs = append(minijailArgs, "--log-timing")
+	}
+
+	// -----------------------------
+	// --- Set up seccomp filter ---
+	// -----------------------------
+	if profile := os.Getenv(SeccompProfileEnvVarName); profile != "" {
+		profile, err = filepath.Abs(profile)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		minijailArgs = append(minijailArgs, "--seccomp-profile="+profile)
+	} else if policy := os.Getenv(SeccompPolicyEnvVarName); policy != "" {
+		filterPath, err := compiledSeccompFilter(minijailPath, policy)
+		if err != nil {
+			return nil, err
+		}
+		minijailArgs = append(minijailArgs, "--seccomp-bpf-binary="+filterPath)
+	}
 
 	// -----------------------
 	// --- Set up bindings ---
@@ -219,6 +271,18 @@ func NewMinijail(opts *Options) (*minijail, error) {
 		bindings = append(bindings, &Binding{Source: opts.OutputDir, Writable: ReadWrite})
 	}
 
+	if serve && len(opts.WriteBackDirs) > 0 {
+		return nil, errors.New("Write-back directories are not supported by pools")
+	}
+	var writeBackArgs []string
+	var writeBackMounts []string
+	for _, dir := range opts.WriteBackDirs {
+		bindings = append(bindings, &Binding{Source: dir.Dir, Writable: ReadWrite})
+		writeBackMounts = append(writeBackMounts, "-k", fmt.Sprintf("tmpfs,%s,tmpfs,%d,size=%s,mode=1777",
+			dir.Path, MS_NOSUID|MS_NODEV|MS_STRICTATIME, dir.Size))
+		writeBackArgs = append(writeBackArgs, "--write-back", dir.Path, dir.Dir)
+	}
+
 	// We expect the current working directory to be the artifacts
 	// directory, which should be accessible to the fuzz target, so we
 	// add a binding for it.
@@ -231,16 +295,26 @@ func NewMinijail(opts *Options) (*minijail, error) {
 	}
 	bindings = append(bindings, &Binding{Source: workdir, Writable: ReadWrite})
 
-	// Add binding for the executable
-	bindings = append(bindings, &Binding{Source: path})
+	// Add binding for the executable. A Pool's bindings include the
+	// executables of its commands.
+	if !serve {
+		bindings = append(bindings, &Binding{Source: path})
+	}
 
-	// Add binding for process_wrapper. process_wrapper changes the
-	// working directory and then executes the specified command.
-	processWrapperPath, err := runfiles.Finder.ProcessWrapperPath()
-	if err != nil {
-		return nil, err
+	// The process wrapper is only needed to serve the commands of a
+	// Pool and to move the files written to the write-back dirs.
+	// Otherwise, minijail changes the working directory itself and
+	// executes the command directly, which saves an execve and a pass
+	// of the dynamic loader per run.
+	useProcessWrapper := serve || len(opts.WriteBackDirs) > 0
+	var processWrapperPath string
+	if useProcessWrapper {
+		processWrapperPath, err = runfiles.Finder.ProcessWrapperPath()
+		if err != nil {
+			return nil, err
+		}
+		bindings = append(bindings, &Binding{Source: processWrapperPath})
 	}
-	bindings = append(bindings, &Binding{Source: processWrapperPath})
 
 	// Add additional bindings from the environment variable
 	additionalBindingsEnv := os.Getenv(BindingsEnvVarName)
@@ -266,7 +340,9 @@ func NewMinijail(opts *Options) (*minijail, error) {
 		bindings = append(bindings, binding)
 	}
 
-	// Create the bindings
+	// Collect the mount points of the bindings
+	var mountPoints []mountPoint
+	var bindingArgs []string
 	for _, binding := range bindings {
 		if binding.Target == "" {
 			binding.Target = binding.Source
@@ -280,46 +356,67 @@ func NewMinijail(opts *Options) (*minijail, error) {
 			continue
 		}
 
-		// Create the destination
-		if fileutil.IsDir(binding.Source) {
-			err = os.MkdirAll(filepath.Join(chrootDir, binding.Target), 0o755)
-			if err != nil {
-				return nil, errors.WithStack(err)
-			}
-		} else {
-			err = os.MkdirAll(filepath.Join(chrootDir, filepath.Dir(binding.Target)), 0o755)
-			if err != nil {
-				return nil, errors.WithStack(err)
-			}
-			err = fileutil.Touch(filepath.Join(chrootDir, binding.Target))
-			if err != nil {
-				return nil, err
-			}
-		}
+		mountPoints = append(mountPoints, mountPoint{path: binding.Target, isDir: fileutil.IsDir(binding.Source)})
+		bindingArgs = append(bindingArgs, "-b", binding.String())
+	}
+	for _, dir := range opts.WriteBackDirs {
+		mountPoints = append(mountPoints, mountPoint{path: dir.Path, isDir: true})
+	}
 
-		minijailArgs = append(minijailArgs, "-b", binding.String())
+	chrootDir, err := prepareChrootDir(mountPoints)
+	if err != nil {
+		return nil, err
 	}
 
+	// Change root filesystem to the chroot directory. See pivot_root(2).
+	minijailArgs = append(minijailArgs, "-P", chrootDir)
+	minijailArgs = append(minijailArgs, bindingArgs...)
+	minijailArgs = append(minijailArgs, writeBackMounts...)
+
 	// -----------------------------------
 	// --- Set up process wrapper args ---
 	// -----------------------------------
 	// The process wrapper changes the working directory inside the
 	// sandbox to the first argument
-	processWrapperArgs := []string{processWrapperPath, workdir}
+	var processWrapperArgs []string
+	if serve {
+		processWrapperArgs = []string{processWrapperPath, "--serve", workdir}
+	} else if useProcessWrapper {
+		processWrapperArgs = append([]string{processWrapperPath}, writeBackArgs...)
+		processWrapperArgs = append(processWrapperArgs, workdir)
+	} else {
+		minijailArgs = append(minijailArgs, "--chdir="+workdir)
+	}
+
+	// ----------------------
+	// --- Set up cgroup ---
+	// ----------------------
+	// The cgroup is created last, so that it doesn't have to be
+	// removed if any of the above fails.
+	var cgroup *Cgroup
+	if opts.Resources != nil {
+		cgroup, err = NewCgroup(opts.Resources)
+		if err != nil {
+			return nil, err
+		}
+		minijailArgs = append(minijailArgs, "--add-to-cgroup="+cgroup.ProcsPath())
+	}
 
 	// --------------------
 	// --- Run minijail ---
 	// --------------------
 	args := append(minijailArgs, "--")
 	args = append(args, processWrapperArgs...)
-	args = append(args, opts.Args...)
+	if !serve {
+		args = append(args, opts.Args...)
+	}
 
 	// When DEBUG_MINIJAIL is set, we don't execute the actual libFuzzer
 	// command but only print it and start a shell instead. When used
 	// together with SKIP_CLEANUP, this allows to copy the Minijail
 	// command from the logs to open a shell in the sandbox environment
 	// to debug issues interactively.
-	if os.Getenv("DEBUG_MINIJAIL") != "" {
+	if os.Getenv("DEBUG_MINIJAIL") != "" && !serve {
 		log.Print("libFuzzer command: ", strings.Join(opts.Args, " "))
 		args = append(minijailArgs, "--")
 		args = append(args, processWrapperArgs...)
@@ -327,12 +424,208 @@ func NewMinijail(opts *Options) (*minijail, error) {
 	}
 
 	return &minijail{
-		Options:   opts,
-		chrootDir: chrootDir,
-		Args:      args,
+		Options: opts,
+		Args:    args,
+		Cgroup:  cgroup,
 	}, nil
 }
 
+// Cleanup removes the cgroup of the sandbox, if any, so it must only be
+// called after the sandbox exited. The chroot directory only contains
+// mount points and is shared with other runs, see prepareChrootDir.
 func (m *minijail) Cleanup() {
-	fileutil.Cleanup(m.chrootDir)
+	if m.Cgroup != nil {
+		m.Cgroup.Remove()
+	}
+}
+
+type mountPoint struct {
+	path  string
+	isDir bool
+}
+
+// prepareChrootDir returns a chroot directory which contains the
+// mount points required by minijail itself and the given ones.
+//
+// The directory is only written to when it is created, all files in it
+// are empty and bind-mounted over in the sandbox. It is therefore
+// shared by all runs with the same mount points, including concurrent
+// ones, and named after the hash of them. It is kept in a directory of
+// the current user in the temp directory, see privateTempDir, from
+// where it may be removed at any time, so missing mount points are
+// recreated on every run. Since directories and files are created
+// idempotently, concurrent runs can do this safely.
+func prepareChrootDir(mountPoints []mountPoint) (string, error) {
+	// /tmp and /proc are mounted by fixedMinijailArgs, /dev/shm is
+	// required to allow using shared memory.
+	mountPoints = append([]mountPoint{
+		{path: "/proc", isDir: true},
+		{path: "/tmp", isDir: true},
+		{path: "/dev/shm", isDir: true},
+	}, mountPoints...)
+
+	sorted := make([]string, 0, len(mountPoints))
+	for _, m := range mountPoints {
+		sorted = append(sorted, fmt.Sprintf("%t:%s", m.isDir, m.path))
+	}
+	sort.Strings(sorted)
+	hash := sha256.New()
+	for _, m := range sorted {
+		// Separate the entries by a byte that can't be part of a path
+		hash.Write([]byte(m))
+		hash.Write([]byte{0})
+	}
+
+	// Only the current user can use the chroot directories, so keep
+	// them separate per user.
+	parentDir, err := privateTempDir("cifuzz-minijail-chroot")
+	if err != nil {
+		return "", err
+	}
+	chrootDir := filepath.Join(parentDir, hex.EncodeToString(hash.Sum(nil))[:16])
+
+	for _, m := range mountPoints {
+		path := filepath.Join(chrootDir, m.path)
+		_, err := os.Lstat(path)
+		if err == nil {
+			continue
+		}
+		if !errors.Is(err, os.ErrNotExist) {
+			return "", errors.WithStack(err)
+		}
+
+		if m.isDir {
+			err = os.MkdirAll(path, 0o755)
+			if err != nil {
+				return "", errors.WithStack(err)
+			}
+		} else {
+			err = os.MkdirAll(filepath.Dir(path), 0o755)
+			if err != nil {
+				return "", errors.WithStack(err)
+			}
+			err = fileutil.Touch(path)
+			if err != nil {
+				return "", err
+			}
+		}
+	}
+
+	return chrootDir, nil
+}
+
+// privateTempDir returns the directory <name>-<uid> in the temp
+// directory, creating it if it doesn't exist yet. Since its path is
+// predictable, another user could create it first or make it writable
+// for others and plant files in it, which would then end up in the
+// sandbox. It is therefore created accessible only by the current user
+// and an existing path is rejected unless it is a directory owned by
+// the current user that only the owner can write to.
+func privateTempDir(name string) (string, error) {
+	dir := filepath.Join(os.TempDir(), fmt.Sprintf("%s-%d", name, os.Getuid()))
+	err := os.Mkdir(dir, 0o700)
+	if err != nil && !errors.Is(err, os.ErrExist) {
+		return "", errors.WithStack(err)
+	}
+	// Lstat, so that a symlink to a directory of another user is
+	// rejected as well
+	info, err := os.Lstat(dir)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	if !info.IsDir() || !isOwnedByCurrentUser(info) || info.Mode().Perm()&0o022 != 0 {
+		return "", errors.Errorf("%s is not a directory owned by and only writable by the current user", dir)
+	}
+	return dir, nil
+}
+
+// compiledSeccompFilter returns the path of the BPF program compiled
+// from the seccomp policy file by minijail0, compiling it if it's not
+// cached yet.
+//
+// The cached programs are named after the hash of the policy, including
+// the files it includes, the architecture and the minijail0 binary.
+// Like the chroot directories, they are kept in a directory of the
+// current user in the temp directory, see privateTempDir, and are
+// written to a temporary file first, so that concurrent runs don't see
+// partially written programs.
+func compiledSeccompFilter(minijailPath string, policy string) (string, error) {
+	minijailInfo, err := os.Stat(minijailPath)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	hash := sha256.New()
+	fmt.Fprintf(hash, "%s:%d:%d", runtime.GOARCH, minijailInfo.Size(), minijailInfo.ModTime().UnixNano())
+	hash.Write([]byte{0})
+	err = hashSeccompPolicy(hash, policy, 0)
+	if err != nil {
+		return "", err
+	}
+
+	cacheDir, err := privateTempDir("cifuzz-minijail-seccomp")
+	if err != nil {
+		return "", err
+	}
+	filterPath := filepath.Join(cacheDir, fmt.Sprintf("%s-%s.bpf", hex.EncodeToString(hash.Sum(nil))[:16], runtime.GOARCH))
+	exists, err := fileutil.Exists(filterPath)
+	if err != nil {
+		return "", err
+	}
+	if exists {
+		log.Debugf("Using cached seccomp filter %s", filterPath)
+		return filterPath, nil
+	}
+
+	tmpFile, err := os.CreateTemp(cacheDir, "*.bpf.tmp")
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	err = tmpFile.Close()
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(tmpFile.Name())
+
+	cmd := exec.Command(minijailPath, "--logging=stderr", "-S", policy, "--dump-seccomp-bpf="+tmpFile.Name())
+	log.Debugf("Command: %s", cmd.String())
+	out, err := cmd.CombinedOutput()
+	if err != nil {
+		return "", errors.Errorf("Failed to compile seccomp policy %s: %v\n%s", policy, err, out)
+	}
+	err = os.Rename(tmpFile.Name(), filterPath)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return filterPath, nil
+}
+
+// hashSeccompPolicy writes the policy file and the files it includes
+// via @include statements to w.
+func hashSeccompPolicy(w io.Writer, policy string, includeLevel int) error {
+	// Minijail rejects deeper nesting, so stop at some point to not
+	// loop forever on include cycles.
+	if includeLevel > 16 {
+		return nil
+	}
+	content, err := os.ReadFile(policy)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	_, _ = w.Write(content)
+	_, _ = w.Write([]byte{0})
+
+	scanner := bufio.NewScanner(strings.NewReader(string(content)))
+	for scanner.Scan() {
+		line := strings.TrimSpace(scanner.Text())
+		if !strings.HasPrefix(line, "@include ") {
+			continue
+		}
+		// Minijail resolves included paths relative to the working
+		// directory, just like os.ReadFile.
+		err = hashSeccompPolicy(w, strings.TrimSpace(strings.TrimPrefix(line, "@include ")), includeLevel+1)
+		if err != nil {
+			return err
+		}
+	}
+	return errors.WithStack(scanner.Err())
 }
@@ -4,46 +4,149 @@ import (
 	"bytes"
 	"io"
 	"regexp"
+	"strings"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/regexutil"
 )
 
-var ignoredPattern = regexp.MustCompile(`^libminijail\[\d+]: child process \d+ exited with status \d+`)
+var (
+	ignoredPattern = regexp.MustCompile(`^libminijail\[\d+]: child process \d+ exited with status \d+`)
+	// timingPattern matches the durations of the launch phases which
+	// minijail logs with --log-timing, see newMinijail
+	timingPattern = regexp.MustCompile(`^libminijail\[\d+]: timing: (?P<phase>\S+) (?P<duration>\d+)us$`)
+
+	minijailPrefix = []byte("libminijail[")
+)
 
+// OutputFilter removes the lines logged by minijail which are not
+// shown to the user from the output written to it. It passes the
+// output on in a single pass without copying it, in as few writes as
+// possible: Only a line which isn't complete at the end of a write is
+// kept until the next one, in a buffer which is reused, so that it
+// doesn't allocate once the buffer fits the longest line.
 type OutputFilter struct {
 	nextWriter io.Writer
-	buf        *bytes.Buffer
+	// The beginning of the line which was incomplete at the end of the
+	// previous write
+	pending []byte
 }
 
 func NewOutputFilter(nextWriter io.Writer) *OutputFilter {
-	return &OutputFilter{nextWriter: nextWriter, buf: bytes.NewBuffer([]byte{})}
+	return &OutputFilter{nextWriter: nextWriter}
 }
 
 func (w *OutputFilter) Write(p []byte) (int, error) {
-	// To be able to match lines, we only print up to the last newline
-	// and store everything not printed in the buffer
-	index := bytes.LastIndexByte(p, '\n')
-	if index == -1 {
-		w.buf.Write(p)
-		return len(p), nil
-	}
+	n := len(p)
 
-	toPrint, toStore := p[:index+1], p[index+1:]
-
-	// Prepend the bytes stored in the buffer to the bytes we're about
-	// to print
-	toPrint = append(w.buf.Bytes(), toPrint...)
+	// Complete the pending line first
+	if len(w.pending) > 0 {
+		index := bytes.IndexByte(p, '\n')
+		if index == -1 {
+			w.pending = append(w.pending, p...)
+			return n, nil
+		}
+		w.pending = append(w.pending, p[:index+1]...)
+		p = p[index+1:]
+		if !filterLine(w.pending[:len(w.pending)-1], true) {
+			_, err := w.nextWriter.Write(w.pending)
+			if err != nil {
+				return 0, err
+			}
+		}
+		w.pending = w.pending[:0]
+	}
 
-	w.buf.Reset()
-	w.buf.Write(toStore)
+	// p now starts at the beginning of a line. Most of the output is
+	// from the fuzzer, so the lines are only split where minijail
+	// logged something.
+	start := 0
+	for {
+		index := bytes.Index(p[start:], minijailPrefix)
+		if index == -1 {
+			break
+		}
+		lineStart := start + index
+		if lineStart > 0 && p[lineStart-1] != '\n' {
+			// Not at the beginning of a line
+			end := bytes.IndexByte(p[lineStart:], '\n')
+			if end == -1 {
+				break
+			}
+			err := w.writeUpTo(p, lineStart+end+1, &start)
+			if err != nil {
+				return 0, err
+			}
+			continue
+		}
+		end := bytes.IndexByte(p[lineStart:], '\n')
+		if end == -1 {
+			break
+		}
+		lineEnd := lineStart + end
+		if filterLine(p[lineStart:lineEnd], true) {
+			err := w.writeUpTo(p, lineStart, &start)
+			if err != nil {
+				return 0, err
+			}
+			start = lineEnd + 1
+			continue
+		}
+		err := w.writeUpTo(p, lineEnd+1, &start)
+		if err != nil {
+			return 0, err
+		}
+	}
 
-	if ignoredPattern.Match(toPrint) {
-		return len(p), nil
+	// Pass on all complete lines and keep the incomplete one
+	index := bytes.LastIndexByte(p[start:], '\n')
+	err := w.writeUpTo(p, start+index+1, &start)
+	if err != nil {
+		return 0, err
 	}
+	w.pending = append(w.pending, p[start:]...)
+	return n, nil
+}
 
-	written, err := w.nextWriter.Write(toPrint)
-	numBytesNotWritten := len(toPrint) - written
-	return len(p) - numBytesNotWritten, err
+// writeUpTo passes on p[*start:end] and advances start to end. Lines
+// which are passed on are only written once the next line is filtered
+// or the end of p is reached.
+func (w *OutputFilter) writeUpTo(p []byte, end int, start *int) error {
+	if end <= *start {
+		return nil
+	}
+	_, err := w.nextWriter.Write(p[*start:end])
+	*start = end
+	return err
 }
 
+// IsIgnoredLine returns whether the line is output of minijail which
+// is not shown to the user.
 func IsIgnoredLine(line string) bool {
-	return ignoredPattern.MatchString(line)
+	// Most lines aren't output of minijail, which is cheaper to check
+	// than the patterns
+	if !strings.HasPrefix(line, string(minijailPrefix)) {
+		return false
+	}
+	return ignoredPattern.MatchString(line) || timingPattern.MatchString(line)
+}
+
+// filterLine returns whether the line, without its newline, is output
+// of minijail which is not shown to the user. If logTiming is true, the
+// launch phase durations are printed as debug output instead.
+func filterLine(line []byte, logTiming bool) bool {
+	if !bytes.HasPrefix(line, minijailPrefix) {
+		return false
+	}
+	if ignoredPattern.Match(line) {
+		return true
+	}
+	if !timingPattern.Match(line) {
+		return false
+	}
+	if logTiming {
+		matches, _ := regexutil.FindNamedGroupsMatch(timingPattern, string(line))
+		log.Debugf("Sandbox launch phase %s took %sus", matches["phase"], matches["duration"])
+	}
+	return true
 }
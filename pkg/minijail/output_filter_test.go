@@ -0,0 +1,79 @@
+package minijail
+
+import (
+	"bytes"
+	"io"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestOutputFilter(t *testing.T) {
+	var out bytes.Buffer
+	w := NewOutputFilter(&out)
+
+	chunks := []string{
+		"libminijail[1]: timing: clone 75us\nlibminijail[1]: timing: mou",
+		"nts 38us\nINFO: Seed: 1234\n",
+		"#2\tINITED cov: 2 ft: 2 corp: 1/1b exec/s: 0 rss: 30Mb\n",
+		"libminijail[1]: child process 2 exited with status 0\n",
+		"Done",
+		" 2 runs in 0 second(s)\n",
+	}
+	for _, chunk := range chunks {
+		n, err := w.Write([]byte(chunk))
+		require.NoError(t, err)
+		assert.Equal(t, len(chunk), n)
+	}
+
+	assert.Equal(t,
+		"INFO: Seed: 1234\n"+
+			"#2\tINITED cov: 2 ft: 2 corp: 1/1b exec/s: 0 rss: 30Mb\n"+
+			"Done 2 runs in 0 second(s)\n",
+		out.String())
+}
+
+func TestOutputFilter_LinesNotFiltered(t *testing.T) {
+	var out bytes.Buffer
+	w := NewOutputFilter(&out)
+
+	chunks := []string{
+		"INFO: libminijail[1]: timing: clone 75us\n",
+		"libminijail[1]: cannot bind-remount: Operation not permitted\nlibmini",
+		"jail[1]: timing: launch 281us\nlibminijail[1]: timing: launch 281us and more\n",
+		"no newline",
+	}
+	for _, chunk := range chunks {
+		_, err := w.Write([]byte(chunk))
+		require.NoError(t, err)
+	}
+
+	assert.Equal(t,
+		"INFO: libminijail[1]: timing: clone 75us\n"+
+			"libminijail[1]: cannot bind-remount: Operation not permitted\n"+
+			"libminijail[1]: timing: launch 281us and more\n",
+		out.String())
+}
+
+func TestOutputFilter_Allocs(t *testing.T) {
+	w := NewOutputFilter(io.Discard)
+	chunks := [][]byte{
+		[]byte("#2\tINITED cov: 2 ft: 2 corp: 1/1b exec/s: 0 rss: 30Mb\n#3\tNEW cov: 3 ft: 3 corp: 2/2b"),
+		[]byte(" lim: 4 exec/s: 0 rss: 30Mb L: 1/1 MS: 1 ChangeBit-\nlibminijail[1]: child process 2 exited with status 0\n"),
+	}
+	allocs := testing.AllocsPerRun(100, func() {
+		for _, chunk := range chunks {
+			_, err := w.Write(chunk)
+			require.NoError(t, err)
+		}
+	})
+	assert.Zero(t, allocs)
+}
+
+func TestIsIgnoredLine(t *testing.T) {
+	assert.True(t, IsIgnoredLine("libminijail[1]: timing: launch 281us"))
+	assert.True(t, IsIgnoredLine("libminijail[1]: child process 2 exited with status 1"))
+	assert.False(t, IsIgnoredLine("libminijail[1]: cannot bind-remount: Operation not permitted"))
+	assert.False(t, IsIgnoredLine("==1==ERROR: AddressSanitizer: heap-buffer-overflow"))
+}
@@ -0,0 +1,15 @@
+//go:build aix || darwin || dragonfly || freebsd || linux || netbsd || openbsd || solaris
+
+package minijail
+
+import (
+	"os"
+	"syscall"
+)
+
+// isOwnedByCurrentUser returns true if the file described by info is
+// owned by the user running this process.
+func isOwnedByCurrentUser(info os.FileInfo) bool {
+	stat, ok := info.Sys().(*syscall.Stat_t)
+	return ok && int(stat.Uid) == os.Getuid()
+}
@@ -0,0 +1,152 @@
+package minijail
+
+import (
+	"bufio"
+	"bytes"
+	"io"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/executil"
+)
+
+// Pool runs commands in a single sandbox which stays alive until Close
+// is called, so that only the first command pays for setting up the
+// namespaces, the pivot_root and the mounts of the sandbox. The
+// commands are run one after another and share the environment, the
+// working directory and the stdout and stderr of the sandbox, which
+// are set via PoolOptions.
+type Pool struct {
+	mj           *minijail
+	cmd          *executil.Cmd
+	requests     *os.File
+	statusesFile *os.File
+	statuses     *bufio.Reader
+	mutex        sync.Mutex
+}
+
+type PoolOptions struct {
+	// Options of the sandbox. Args are ignored, the executables of the
+	// commands have to be accessible via the Bindings instead.
+	*Options
+	Env    []string
+	Stdout io.Writer
+	Stderr io.Writer
+}
+
+// ExitError is returned by Pool.Run if the command exited with a
+// non-zero exit code. Commands killed by a signal have an exit code of
+// 128 plus the signal number.
+type ExitError struct {
+	ExitCode int
+}
+
+func (e *ExitError) Error() string {
+	return "exit status " + strconv.Itoa(e.ExitCode)
+}
+
+// NewPool starts the sandbox of a pool.
+func NewPool(opts *PoolOptions) (*Pool, error) {
+	mj, err := newMinijail(opts.Options, true)
+	if err != nil {
+		return nil, err
+	}
+
+	// The process wrapper reads the commands from fd 3 and writes
+	// their exit statuses to fd 4, which minijail0 passes through to
+	// it.
+	requestsReader, requestsWriter, err := os.Pipe()
+	if err != nil {
+		mj.Cleanup()
+		return nil, errors.WithStack(err)
+	}
+	defer requestsReader.Close()
+	statusesReader, statusesWriter, err := os.Pipe()
+	if err != nil {
+		requestsWriter.Close()
+		mj.Cleanup()
+		return nil, errors.WithStack(err)
+	}
+	defer statusesWriter.Close()
+
+	cmd := executil.Command(mj.Args[0], mj.Args[1:]...)
+	cmd.Env = opts.Env
+	cmd.Stdout = opts.Stdout
+	cmd.Stderr = opts.Stderr
+	cmd.ExtraFiles = []*os.File{requestsReader, statusesWriter}
+	log.Debugf("Command: %s", strings.Join(cmd.Args, " "))
+	err = cmd.Start()
+	if err != nil {
+		requestsWriter.Close()
+		statusesReader.Close()
+		mj.Cleanup()
+		return nil, errors.WithStack(err)
+	}
+
+	return &Pool{
+		mj:           mj,
+		cmd:          cmd,
+		requests:     requestsWriter,
+		statusesFile: statusesReader,
+		statuses:     bufio.NewReader(statusesReader),
+	}, nil
+}
+
+// Run runs args in the sandbox and waits for it to exit.
+func (p *Pool) Run(args []string) error {
+	if len(args) == 0 {
+		return errors.New("Empty command")
+	}
+
+	var request bytes.Buffer
+	for _, arg := range args {
+		if strings.IndexByte(arg, 0) != -1 {
+			return errors.Errorf("Argument contains a NUL byte: %q", arg)
+		}
+		request.WriteString(arg)
+		request.WriteByte(0)
+	}
+	request.WriteByte(0)
+
+	p.mutex.Lock()
+	defer p.mutex.Unlock()
+
+	log.Debugf("Running in sandbox: %s", strings.Join(args, " "))
+	_, err := p.requests.Write(request.Bytes())
+	if err != nil {
+		return errors.Wrap(err, "Sandbox exited unexpectedly")
+	}
+	status, err := p.statuses.ReadString('\n')
+	if err != nil {
+		return errors.Wrap(err, "Sandbox exited unexpectedly")
+	}
+	exitCode, err := strconv.Atoi(strings.TrimSpace(status))
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	if exitCode != 0 {
+		return &ExitError{ExitCode: exitCode}
+	}
+	return nil
+}
+
+// Close stops the sandbox after the running command exited.
+func (p *Pool) Close() error {
+	p.mutex.Lock()
+	defer p.mutex.Unlock()
+
+	// The process wrapper exits once there are no more commands
+	err := p.requests.Close()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	err = p.cmd.Wait()
+	p.statusesFile.Close()
+	p.mj.Cleanup()
+	return errors.WithStack(err)
+}
@@ -1,15 +1,340 @@
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+// The file descriptors from which --serve reads commands and to which it
+// writes their exit statuses.
+#define REQUEST_FD 3
+#define STATUS_FD 4
+
+// How often --write-back moves files while the command is running, and how long
+// a file must not have been modified before it is moved, because the command
+// could still be writing it.
+#define WRITE_BACK_INTERVAL_SECONDS 30
+#define WRITE_BACK_MIN_AGE_SECONDS 2
+#define MAX_WRITE_BACK_DIRS 8
+
+struct write_back_dir {
+  const char *src;
+  const char *dest;
+};
+
+static struct write_back_dir write_back_dirs[MAX_WRITE_BACK_DIRS];
+static int num_write_back_dirs = 0;
+static volatile sig_atomic_t write_back_due = 0;
+static volatile pid_t command_pid = 0;
+
+// Reads a command from |requests| into a NULL-terminated argv array allocated
+// with malloc. A command is a sequence of NUL-terminated arguments followed by
+// an empty one. Returns NULL on EOF.
+static char **read_command(FILE *requests) {
+  char **argv = NULL;
+  size_t argc = 0;
+  char *arg = NULL;
+  size_t arg_capacity = 0;
+
+  for (;;) {
+    ssize_t len = getdelim(&arg, &arg_capacity, '\0', requests);
+    if (len <= 0) {
+      free(arg);
+      for (size_t i = 0; i < argc; i++) {
+        free(argv[i]);
+      }
+      free(argv);
+      return NULL;
+    }
+    char **new_argv = realloc(argv, (argc + 2) * sizeof(*argv));
+    if (new_argv == NULL) {
+      fprintf(stderr, "realloc failed: %s\n", strerror(errno));
+      exit(1);
+    }
+    argv = new_argv;
+    if (len == 1) {
+      // The empty argument ends the command.
+      free(arg);
+      argv[argc] = NULL;
+      return argv;
+    }
+    argv[argc++] = arg;
+    arg = NULL;
+    arg_capacity = 0;
+  }
+}
+
+// Runs |argv| in a child process and returns its exit code, or 128 plus the
+// signal number if it was killed by a signal.
+static int run_command(char **argv) {
+  pid_t pid = fork();
+  if (pid == -1) {
+    fprintf(stderr, "fork failed: %s\n", strerror(errno));
+    return 1;
+  }
+  if (pid == 0) {
+    close(REQUEST_FD);
+    close(STATUS_FD);
+    execv(argv[0], argv);
+    fprintf(stderr, "execv(%s) failed: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+
+  int status;
+  pid_t exited;
+  // We usually run as the init process of the sandbox, so also reap orphaned
+  // grandchildren while waiting.
+  while ((exited = wait(&status)) != pid) {
+    if (exited == -1 && errno != EINTR) {
+      fprintf(stderr, "wait failed: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return WEXITSTATUS(status);
+}
+
+// Copies |src| to |dest| via a temporary file, so that |dest| is never seen
+// partially written. Returns 0 on success.
+static int copy_file(const char *src, const char *dest) {
+  char tmp[4096];
+  char buf[65536];
+  int ret = -1;
+
+  if (snprintf(tmp, sizeof(tmp), "%s.%d.tmp", dest, (int) getpid()) >= (int) sizeof(tmp)) {
+    return -1;
+  }
+  int in = open(src, O_RDONLY | O_CLOEXEC);
+  if (in == -1) {
+    return -1;
+  }
+  int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (out == -1) {
+    close(in);
+    return -1;
+  }
+  for (;;) {
+    ssize_t len = read(in, buf, sizeof(buf));
+    if (len == 0) {
+      ret = 0;
+      break;
+    }
+    if (len == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (ssize_t written = 0; written < len;) {
+      ssize_t n = write(out, buf + written, len - written);
+      if (n == -1 && errno != EINTR) {
+        len = -1;
+        break;
+      }
+      if (n > 0) {
+        written += n;
+      }
+    }
+    if (len == -1) {
+      break;
+    }
+  }
+  close(in);
+  if (close(out) != 0) {
+    ret = -1;
+  }
+  if (ret == 0 && rename(tmp, dest) != 0) {
+    ret = -1;
+  }
+  if (ret != 0) {
+    unlink(tmp);
+  }
+  return ret;
+}
+
+// Moves the regular files in |dir->src| to |dir->dest|. Unless |all| is set,
+// files which were modified recently are skipped. Files which exist in
+// |dir->dest| already are only removed, which is fine for corpus entries,
+// which are named after the hash of their contents.
+static void write_back(const struct write_back_dir *dir, int all) {
+  DIR *d = opendir(dir->src);
+  if (d == NULL) {
+    fprintf(stderr, "opendir(%s) failed: %s\n", dir->src, strerror(errno));
+    return;
+  }
+
+  time_t now = time(NULL);
+  struct dirent *entry;
+  while ((entry = readdir(d)) != NULL) {
+    char src[4096];
+    char dest[4096];
+    struct stat info;
+
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    if (snprintf(src, sizeof(src), "%s/%s", dir->src, entry->d_name) >= (int) sizeof(src) ||
+        snprintf(dest, sizeof(dest), "%s/%s", dir->dest, entry->d_name) >= (int) sizeof(dest)) {
+      continue;
+    }
+    if (lstat(src, &info) != 0 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+    if (!all && now - info.st_mtime < WRITE_BACK_MIN_AGE_SECONDS) {
+      continue;
+    }
+    if (access(dest, F_OK) != 0 && copy_file(src, dest) != 0) {
+      fprintf(stderr, "failed to copy %s to %s: %s\n", src, dest, strerror(errno));
+      continue;
+    }
+    unlink(src);
+  }
+  closedir(d);
+}
+
+static void write_back_all(int all) {
+  for (int i = 0; i < num_write_back_dirs; i++) {
+    write_back(&write_back_dirs[i], all);
+  }
+}
+
+static void forward_signal(int sig) {
+  if (command_pid > 0) {
+    kill(command_pid, sig);
+  }
+}
+
+static void schedule_write_back(int sig) {
+  (void) sig;
+  write_back_due = 1;
+}
+
+// Runs |argv| in a child process, moves the files in the write-back dirs every
+// WRITE_BACK_INTERVAL_SECONDS and once more after it exited, and returns its
+// exit code, or 128 plus the signal number if it was killed by a signal.
+// Termination signals are forwarded to it, because we usually run as the init
+// process of the sandbox, which doesn't receive signals it doesn't handle.
+static int run_with_write_back(char **argv) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = forward_signal;
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGHUP, &action, NULL);
+  // waitpid has to be interrupted by the alarm, so don't set SA_RESTART.
+  action.sa_handler = schedule_write_back;
+  sigaction(SIGALRM, &action, NULL);
+
+  pid_t pid = fork();
+  if (pid == -1) {
+    fprintf(stderr, "fork failed: %s\n", strerror(errno));
+    return 1;
+  }
+  if (pid == 0) {
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGALRM, SIG_DFL);
+    execv(argv[0], argv);
+    fprintf(stderr, "execv(%s) failed: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+  command_pid = pid;
+
+  int status;
+  pid_t exited;
+  alarm(WRITE_BACK_INTERVAL_SECONDS);
+  // Also reap orphaned grandchildren while waiting.
+  while ((exited = wait(&status)) != pid) {
+    if (exited == -1 && errno != EINTR) {
+      fprintf(stderr, "wait failed: %s\n", strerror(errno));
+      return 1;
+    }
+    if (write_back_due) {
+      write_back_due = 0;
+      write_back_all(0);
+      alarm(WRITE_BACK_INTERVAL_SECONDS);
+    }
+  }
+  alarm(0);
+  write_back_all(1);
+
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return WEXITSTATUS(status);
+}
+
+// Runs the commands read from REQUEST_FD one after another and writes their
+// exit statuses to STATUS_FD, one per line, until REQUEST_FD is closed. This
+// allows to run many commands in the same sandbox.
+static int serve(void) {
+  FILE *requests = fdopen(REQUEST_FD, "r");
+  FILE *statuses = fdopen(STATUS_FD, "w");
+  if (requests == NULL || statuses == NULL) {
+    fprintf(stderr, "fdopen failed: %s\n", strerror(errno));
+    return 1;
+  }
+
+  char **argv;
+  while ((argv = read_command(requests)) != NULL) {
+    int status = argv[0] == NULL ? 1 : run_command(argv);
+    for (char **arg = argv; *arg != NULL; arg++) {
+      free(*arg);
+    }
+    free(argv);
+    if (fprintf(statuses, "%d\n", status) < 0 || fflush(statuses) != 0) {
+      fprintf(stderr, "failed to write exit status: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+  return 0;
+}
+
 // Executes argv[2] with argv[3..argc-1] as arguments after changing the
 // working directory to argv[1].
+//
+// With --serve as argv[1], changes the working directory to argv[2] and runs
+// the commands read from file descriptor 3 instead, see serve.
+//
+// Each leading "--write-back <src> <dest>" makes it run the executable in a
+// child process instead and move the files it creates in <src>, usually a
+// tmpfs, to <dest>, see run_with_write_back.
 int main(int argc, char **argv) {
+  while (argc >= 4 && strcmp(argv[1], "--write-back") == 0) {
+    if (num_write_back_dirs == MAX_WRITE_BACK_DIRS) {
+      fprintf(stderr, "Too many --write-back directories\n");
+      return 1;
+    }
+    write_back_dirs[num_write_back_dirs].src = argv[2];
+    write_back_dirs[num_write_back_dirs].dest = argv[3];
+    num_write_back_dirs++;
+    argv[3] = argv[0];
+    argv += 3;
+    argc -= 3;
+  }
+
+  if (argc == 3 && strcmp(argv[1], "--serve") == 0) {
+    if (chdir(argv[2]) == -1) {
+      fprintf(stderr, "chdir(%s) failed: %s\n", argv[2], strerror(errno));
+      return 1;
+    }
+    return serve();
+  }
+
   if (argc < 3) {
     fprintf(stderr,
-            "Usage: %s <directory> <executable_path> <executable_arg1> ...\n",
-            argv[0]);
+            "Usage: %s [--write-back <src> <dest>]... <directory> <executable_path> <executable_arg1> ...\n"
+            "       %s --serve <directory>\n",
+            argv[0], argv[0]);
     return 1;
   }
 
@@ -19,6 +344,9 @@ int main(int argc, char **argv) {
   }
 
   // Skip over both the process wrapper's own argv[0] and the directory.
+  if (num_write_back_dirs > 0) {
+    return run_with_write_back(argv + 2);
+  }
   if (execv(argv[2], argv + 2) == -1) {
     fprintf(stderr, "execv(%s) failed: %s\n", argv[2], strerror(errno));
     return 1;
@@ -0,0 +1,104 @@
+package aflpp
+
+import (
+	"bufio"
+	"io"
+	"math"
+	"strconv"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// ParseFuzzerStats parses the fuzzer_stats file which afl-fuzz writes
+// to its output directory into the metrics of a fuzzing run. The file
+// consists of "<key> : <value>" lines, see
+// https://aflplus.plus/docs/status_screen/#fuzzer_stats-file.
+func ParseFuzzerStats(r io.Reader) (*report.FuzzingMetric, error) {
+	stats := make(map[string]string)
+	scanner := bufio.NewScanner(r)
+	for scanner.Scan() {
+		key, value, ok := strings.Cut(scanner.Text(), ":")
+		if !ok {
+			continue
+		}
+		stats[strings.TrimSpace(key)] = strings.TrimSpace(value)
+	}
+	if err := scanner.Err(); err != nil {
+		return nil, errors.WithStack(err)
+	}
+	// afl-fuzz writes all keys at once, so a file without this one is
+	// either empty or not a fuzzer_stats file
+	if _, ok := stats["execs_done"]; !ok {
+		return nil, errors.New("Invalid fuzzer_stats file: execs_done is missing")
+	}
+
+	// The average over the last minute is more meaningful during long
+	// runs, but older versions of AFL++ only report the overall average
+	execsPerSecond := parseFloatStat(stats, "execs_ps_last_min")
+	if execsPerSecond == 0 {
+		execsPerSecond = parseFloatStat(stats, "execs_per_sec")
+	}
+
+	// AFL++ counts the edges of the coverage map, which is the closest
+	// equivalent of libFuzzer's features
+	edges := clampInt32(parseUintStat(stats, "edges_found"))
+
+	lastUpdate := parseUintStat(stats, "last_update")
+	var secondsSinceLastFind uint64
+	if _, ok := stats["time_wo_finds"]; ok {
+		secondsSinceLastFind = parseUintStat(stats, "time_wo_finds")
+	} else if lastFind := parseUintStat(stats, "last_find"); lastFind != 0 && lastFind <= lastUpdate {
+		secondsSinceLastFind = lastUpdate - lastFind
+	} else {
+		secondsSinceLastFind = parseUintStat(stats, "run_time")
+	}
+
+	return &report.FuzzingMetric{
+		Timestamp:               time.Unix(int64(lastUpdate), 0),
+		ExecutionsPerSecond:     int32(math.Min(execsPerSecond, math.MaxInt32)),
+		Features:                edges,
+		CorpusSize:              clampInt32(parseUintStat(stats, "corpus_count")),
+		SecondsSinceLastFeature: secondsSinceLastFind,
+		TotalExecutions:         parseUintStat(stats, "execs_done"),
+		Edges:                   edges,
+		SecondsSinceLastEdge:    secondsSinceLastFind,
+	}, nil
+}
+
+func parseUintStat(stats map[string]string, key string) uint64 {
+	value, ok := stats[key]
+	if !ok {
+		return 0
+	}
+	res, err := strconv.ParseUint(value, 10, 64)
+	if err != nil {
+		log.Debugf("Ignoring invalid value of %s in fuzzer_stats: %q", key, value)
+		return 0
+	}
+	return res
+}
+
+func parseFloatStat(stats map[string]string, key string) float64 {
+	value, ok := stats[key]
+	if !ok {
+		return 0
+	}
+	res, err := strconv.ParseFloat(value, 64)
+	if err != nil || res < 0 {
+		log.Debugf("Ignoring invalid value of %s in fuzzer_stats: %q", key, value)
+		return 0
+	}
+	return res
+}
+
+func clampInt32(n uint64) int32 {
+	if n > math.MaxInt32 {
+		return math.MaxInt32
+	}
+	return int32(n)
+}
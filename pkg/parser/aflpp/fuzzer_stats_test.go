@@ -0,0 +1,77 @@
+package aflpp
+
+import (
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+func TestParseFuzzerStats(t *testing.T) {
+	stats := `start_time        : 1700000000
+last_update       : 1700000120
+run_time          : 120
+fuzzer_pid        : 4242
+cycles_done       : 3
+execs_done        : 1234567
+execs_per_sec     : 10288.06
+execs_ps_last_min : 11002.50
+corpus_count      : 321
+corpus_found      : 300
+bitmap_cvg        : 1.58%
+saved_crashes     : 0
+last_find         : 1700000100
+time_wo_finds     : 20
+edges_found       : 1035
+total_edges       : 65536
+command_line      : afl-fuzz -i in -o out -- ./my_fuzz_test
+`
+	metric, err := ParseFuzzerStats(strings.NewReader(stats))
+	require.NoError(t, err)
+	assert.Equal(t, &report.FuzzingMetric{
+		Timestamp:               time.Unix(1700000120, 0),
+		ExecutionsPerSecond:     11002,
+		Features:                1035,
+		CorpusSize:              321,
+		SecondsSinceLastFeature: 20,
+		TotalExecutions:         1234567,
+		Edges:                   1035,
+		SecondsSinceLastEdge:    20,
+	}, metric)
+}
+
+func TestParseFuzzerStats_OlderVersion(t *testing.T) {
+	// Older versions of AFL++ don't report the executions per second of
+	// the last minute and the time without finds
+	stats := `last_update       : 1700000120
+run_time          : 120
+execs_done        : 5000
+execs_per_sec     : 41.67
+corpus_count      : 12
+last_find         : 1700000090
+edges_found       : 87
+`
+	metric, err := ParseFuzzerStats(strings.NewReader(stats))
+	require.NoError(t, err)
+	assert.Equal(t, int32(41), metric.ExecutionsPerSecond)
+	assert.Equal(t, uint64(30), metric.SecondsSinceLastFeature)
+
+	// Without any finds, the time since the start is reported
+	stats = `last_update       : 1700000120
+run_time          : 120
+execs_done        : 5000
+last_find         : 0
+`
+	metric, err = ParseFuzzerStats(strings.NewReader(stats))
+	require.NoError(t, err)
+	assert.Equal(t, uint64(120), metric.SecondsSinceLastFeature)
+}
+
+func TestParseFuzzerStats_Invalid(t *testing.T) {
+	_, err := ParseFuzzerStats(strings.NewReader(""))
+	require.Error(t, err)
+}
@@ -0,0 +1,73 @@
+package centipede
+
+import (
+	"regexp"
+	"strconv"
+)
+
+// Centipede logs the state of each shard in lines like
+//
+//	[S0.18874] new-feature: ft: 456 cov: 78 cnt: 234 cmp: 144 corp: 79/79 fr: 32 max/avg: 60 12 d: 3/4 exec/s: 6328 mb: 87
+//
+// possibly prefixed by the log level, time and source location, where
+// 0 is the shard and 18874 the number of inputs it executed.
+var (
+	statsLinePattern  = regexp.MustCompile(`\[S(\d+)\.(\d+)\] [\w-]+:(.*)$`)
+	statsFieldPattern = regexp.MustCompile(`([\w/]+): (\d+)`)
+)
+
+// ShardStats are the stats which Centipede logs for a shard
+type ShardStats struct {
+	Shard int
+	// The number of inputs the shard executed
+	Runs uint64
+	// The number of features, i.e. the edges, counters and comparison
+	// operands, and of covered edges of the shard's corpus
+	Features int32
+	Coverage int32
+	// The number of inputs of the shard's corpus
+	CorpusSize int32
+	// The executions per second since the shard started
+	ExecutionsPerSecond int32
+}
+
+// ParseStatsLine parses a line in which Centipede logs the stats of a
+// shard. It returns false if the line doesn't contain stats.
+func ParseStatsLine(line string) (*ShardStats, bool) {
+	match := statsLinePattern.FindStringSubmatch(line)
+	if match == nil {
+		return nil, false
+	}
+	shard, err := strconv.Atoi(match[1])
+	if err != nil {
+		return nil, false
+	}
+	runs, err := strconv.ParseUint(match[2], 10, 64)
+	if err != nil {
+		return nil, false
+	}
+
+	fields := make(map[string]int32)
+	for _, field := range statsFieldPattern.FindAllStringSubmatch(match[3], -1) {
+		// Only the first number of fields like "corp: 79/79" is used
+		value, err := strconv.ParseInt(field[2], 10, 32)
+		if err != nil {
+			continue
+		}
+		if _, ok := fields[field[1]]; !ok {
+			fields[field[1]] = int32(value)
+		}
+	}
+	if _, ok := fields["ft"]; !ok {
+		return nil, false
+	}
+
+	return &ShardStats{
+		Shard:               shard,
+		Runs:                runs,
+		Features:            fields["ft"],
+		Coverage:            fields["cov"],
+		CorpusSize:          fields["corp"],
+		ExecutionsPerSecond: fields["exec/s"],
+	}, true
+}
@@ -0,0 +1,39 @@
+package centipede
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestParseStatsLine(t *testing.T) {
+	line := "I0522 10:03:23.123456  4242 centipede.cc:321] [S3.18874] new-feature: ft: 456 cov: 78 cnt: 234 " +
+		"cmp: 144 corp: 79/81 fr: 32 max/avg: 60 12 d: 3/4 exec/s: 6328 mb: 87"
+	stats, ok := ParseStatsLine(line)
+	require.True(t, ok)
+	assert.Equal(t, &ShardStats{
+		Shard:               3,
+		Runs:                18874,
+		Features:            456,
+		Coverage:            78,
+		CorpusSize:          79,
+		ExecutionsPerSecond: 6328,
+	}, stats)
+
+	// Older versions of Centipede don't log the coverage
+	stats, ok = ParseStatsLine("[S0.1] begin-fuzz: ft: 59 corp: 2/2 max/avg: 4 4 exec/s: 0 mb: 35")
+	require.True(t, ok)
+	assert.Equal(t, int32(59), stats.Features)
+	assert.Equal(t, int32(0), stats.Coverage)
+	assert.Equal(t, int32(2), stats.CorpusSize)
+
+	for _, line := range []string{
+		"",
+		"I0522 10:03:23.123456  4242 centipede_interface.cc:85] Starting Centipede",
+		"[S0.1] end-fuzz: corp: 2/2",
+	} {
+		_, ok = ParseStatsLine(line)
+		assert.False(t, ok, line)
+	}
+}
@@ -47,8 +47,17 @@ var (
 	// #2	INITED cov: 10 ft: 11 corp: 1/1b exec/s: 0 rss: 30Mb
 	// #670	REDUCE cov: 13 ft: 15 corp: 4/5b lim: 8 exec/s: 0 rss: 31Mb L: 1/2 MS: 2 CopyPart-EraseBytes-
 	statsPattern = regexp.MustCompile(
-		`#(?P<total_execs>\d+)\s+(?P<status>\S*)\s+(cov:\s+(?P<edges>\d+)\s+)?ft:\s+(?P<features>\d+)\s+corp:\s+(?P<corpus_size>\d+)/.*exec/s:\s+(?P<executions_per_second>\d+)\s+`)
-	testInputFilePattern = regexp.MustCompile(
+		`#(?P<total_execs>\d+)\s+(?P<status>\S*)\s+(cov:\s+(?P<edges>\d+)\s+)?ft:\s+(?P<features>\d+)\s+corp:\s+(?P<corpus_size>\d+)/.*exec/s:\s+(?P<executions_per_second>\d+)\s+(rss:\s+(?P<rss_mb>\d+)Mb)?`)
+	// The indices of the groups of statsPattern, which are looked up
+	// once because metrics are parsed from a lot of lines
+	statsTotalExecsIndex          = statsPattern.SubexpIndex("total_execs")
+	statsStatusIndex              = statsPattern.SubexpIndex("status")
+	statsEdgesIndex               = statsPattern.SubexpIndex("edges")
+	statsFeaturesIndex            = statsPattern.SubexpIndex("features")
+	statsCorpusSizeIndex          = statsPattern.SubexpIndex("corpus_size")
+	statsExecutionsPerSecondIndex = statsPattern.SubexpIndex("executions_per_second")
+	statsRSSIndex                 = statsPattern.SubexpIndex("rss_mb")
+	testInputFilePattern          = regexp.MustCompile(
 		`Test unit written to\s*(?P<test_input_file>.*)`)
 	slowInputPattern = regexp.MustCompile(
 		`\s*Slowest unit: (?P<duration>\d+) s.*`)
@@ -87,7 +96,8 @@ type Options struct {
 	SupportJazzer bool
 	KeepColor     bool
 	// The parser writes all parsed lines to StartupOutputWriter up to
-	// the point where the fuzzer has completed initialization.
+	// the point where the fuzzer has completed initialization, except
+	// for the output of minijail which is not shown to the user.
 	StartupOutputWriter io.Writer
 	// The directory to which paths in the stack trace are made relative to
 	ProjectDir string
@@ -132,7 +142,7 @@ func (p *parser) sendReport(ctx context.Context, report *report.Report) error {
 }
 
 func (p *parser) parseLine(ctx context.Context, line string) error {
-	if !p.KeepColor {
+	if !p.KeepColor && strings.IndexByte(line, '\x1b') != -1 {
 		// Sanitizer reports can be colorized, but the ANSI escapes used
 		// for colors should not be included in logs.
 		line = pterm.RemoveColorFromString(line)
@@ -152,11 +162,14 @@ func (p *parser) parseLine(ctx context.Context, line string) error {
 				return err
 			}
 
-			if p.StartupOutputWriter != nil {
+			if p.StartupOutputWriter != nil && !minijail.IsIgnoredLine(line) {
 				// Store all lines printed before the fuzzer has been initialized
 				// so that they can be printed in case of a startup error (e.g.
 				// a missing shared library dependency).
-				_, err := p.StartupOutputWriter.Write(append([]byte(line), '\n'))
+				_, err := io.WriteString(p.StartupOutputWriter, line)
+				if err == nil {
+					_, err = io.WriteString(p.StartupOutputWriter, "\n")
+				}
 				if err != nil {
 					return errors.WithStack(err)
 				}
@@ -261,6 +274,10 @@ func (p *parser) parseLine(ctx context.Context, line string) error {
 }
 
 func (p *parser) parseAsNewFinding(line string) *finding.Finding {
+	if !mayStartFinding(line) {
+		return nil
+	}
+
 	if p.SupportJazzer {
 		finding := p.parseAsJazzerFinding(line)
 		if finding != nil {
@@ -291,6 +308,20 @@ func (p *parser) parseAsNewFinding(line string) *finding.Finding {
 	return nil
 }
 
+// mayStartFinding is a cheap check for the literals of the patterns
+// which mark the beginning of a finding, so that the patterns are only
+// tried on the few lines which contain one of them. Fuzz tests which
+// log a lot would otherwise spend most of the parsing time there.
+func mayStartFinding(line string) bool {
+	// The sanitizer, libFuzzer and Java error patterns all contain a
+	// "=="
+	return strings.Contains(line, "==") ||
+		strings.HasPrefix(line, "panic:") ||
+		strings.Contains(line, "ALARM: ") ||
+		strings.Contains(line, " runtime error: ") ||
+		strings.Contains(line, "Slowest unit: ")
+}
+
 func parseAsTestInputFilePath(logLine string) (string, bool) {
 	result, found := regexutil.FindNamedGroupsMatch(testInputFilePattern, logLine)
 	if found {
@@ -419,34 +450,46 @@ func (p *parser) parseAsJazzerFinding(line string) *finding.Finding {
 }
 
 func (p *parser) parseAsFuzzingMetric(line string) *report.FuzzingMetric {
-	if result, found := regexutil.FindNamedGroupsMatch(statsPattern, line); found {
-		totalExecs, err := strconv.ParseUint(result["total_execs"], 10, 64)
+	// Most lines are no metrics lines, which is much cheaper to check
+	// via the literals of statsPattern than with the regex itself.
+	if !strings.Contains(line, "ft:") || !strings.Contains(line, "exec/s:") {
+		return nil
+	}
+	if result := statsPattern.FindStringSubmatch(line); result != nil {
+		totalExecs, err := strconv.ParseUint(result[statsTotalExecsIndex], 10, 64)
 		if err != nil {
 			return nil
 		}
-		features, err := strconv.Atoi(result["features"])
+		features, err := strconv.Atoi(result[statsFeaturesIndex])
 		if err != nil {
 			return nil
 		}
 
 		var edges int
-		if result["edges"] == "" {
+		if result[statsEdgesIndex] == "" {
 			edges = 0
 		} else {
-			edges, err = strconv.Atoi(result["edges"])
+			edges, err = strconv.Atoi(result[statsEdgesIndex])
 			if err != nil {
 				return nil
 			}
 		}
 
-		execsPerSec, err := strconv.Atoi(result["executions_per_second"])
+		execsPerSec, err := strconv.Atoi(result[statsExecutionsPerSecondIndex])
 		if err != nil {
 			return nil
 		}
-		corpusSize, err := strconv.Atoi(result["corpus_size"])
+		corpusSize, err := strconv.Atoi(result[statsCorpusSizeIndex])
 		if err != nil {
 			return nil
 		}
+		var rssMB uint64
+		if result[statsRSSIndex] != "" {
+			rssMB, err = strconv.ParseUint(result[statsRSSIndex], 10, 64)
+			if err != nil {
+				return nil
+			}
+		}
 		now := time.Now()
 		var secondsSinceLastFeature uint64
 		if !p.lastNewFeatureTime.IsZero() {
@@ -468,7 +511,7 @@ func (p *parser) parseAsFuzzingMetric(line string) *report.FuzzingMetric {
 			secondsSinceLastEdge = 0
 		}
 
-		if !p.initFinished && result["status"] == "INITED" {
+		if !p.initFinished && result[statsStatusIndex] == "INITED" {
 			p.initFinished = true
 		}
 
@@ -481,12 +524,18 @@ func (p *parser) parseAsFuzzingMetric(line string) *report.FuzzingMetric {
 			TotalExecutions:         totalExecs,
 			SecondsSinceLastFeature: secondsSinceLastFeature,
 			SecondsSinceLastEdge:    secondsSinceLastEdge,
+			PeakRSSBytes:            rssMB << 20,
 		}
 	}
 	return nil
 }
 
 func parseAsSlowInput(log string) *finding.Finding {
+	// slowInputPattern has no literal prefix, so the regex would be
+	// run on every line
+	if !strings.Contains(log, "Slowest unit: ") {
+		return nil
+	}
 	if res, ok := regexutil.FindNamedGroupsMatch(slowInputPattern, log); ok {
 		return &finding.Finding{
 			Type:    finding.ErrorTypeWarning,
@@ -506,6 +555,10 @@ func parseAsSlowInput(log string) *finding.Finding {
 }
 
 func parseAsSeedCorpusMessage(line string) (numSeeds uint, err error) { //nolint:nonamedreturns
+	// Both corpus messages start with "INFO: "
+	if !strings.Contains(line, "INFO: ") {
+		return 0, errNotFound
+	}
 	numSeeds, err = parseAsNonEmptyCorpusMessage(line)
 	if err == nil {
 		return numSeeds, nil
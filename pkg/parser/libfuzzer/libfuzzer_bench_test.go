@@ -0,0 +1,267 @@
+package libfuzzer
+
+import (
+	"bytes"
+	"context"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"runtime"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/minijail"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// BenchmarkParse measures the throughput of Parse on logs modeled on
+// recorded libFuzzer output, as a baseline for optimizations of the
+// parser. Besides the time and allocations per log, it reports lines/s
+// and allocs/line.
+//
+// Run with:
+//
+//	go test ./pkg/parser/libfuzzer -run=^$ -bench=BenchmarkParse -benchmem
+func BenchmarkParse(b *testing.B) {
+	crashFile := filepath.Join(b.TempDir(), "crash-da39a3ee5e6b4b0d3255bfef95601890afd80709")
+	err := os.WriteFile(crashFile, []byte("FUZZ"), 0o644)
+	require.NoError(b, err)
+
+	benchmarks := []struct {
+		name string
+		log  []byte
+	}{
+		// A long run which only prints stats lines
+		{"stats", statsLog(1_000_000)},
+		// Findings one after the other, like with -fork and
+		// -ignore_crashes
+		{"crash_storm", crashStormLog(2_000, crashFile)},
+		// A fuzz test which prints a lot of colored output
+		{"color_output", colorOutputLog(500_000)},
+	}
+	for _, bm := range benchmarks {
+		bm := bm
+		b.Run(bm.name, func(b *testing.B) {
+			benchmarkParse(b, bm.log, parseLog)
+		})
+	}
+}
+
+// BenchmarkParseJailed compares the throughput of parsing the output of
+// a fuzz test run in minijail with that of one run without it. Like in
+// the libFuzzer runner in verbose mode, the output is written in chunks
+// of the size of a pipe buffer to a tee of a pipe to the parser and of
+// the minijail.OutputFilter in front of the terminal, which is replaced
+// by io.Discard. The difference between the two is the overhead of the
+// filter.
+//
+// Run with:
+//
+//	go test ./pkg/parser/libfuzzer -run=^$ -bench=BenchmarkParseJailed -benchmem
+func BenchmarkParseJailed(b *testing.B) {
+	log := statsLog(1_000_000)
+	b.Run("unjailed", func(b *testing.B) {
+		benchmarkParse(b, log, func(b *testing.B, log []byte) int {
+			return parseTeedLog(b, log, io.Discard)
+		})
+	})
+	jailedLog := minijailLog(log)
+	b.Run("jailed", func(b *testing.B) {
+		benchmarkParse(b, jailedLog, func(b *testing.B, log []byte) int {
+			return parseTeedLog(b, log, minijail.NewOutputFilter(io.Discard))
+		})
+	})
+}
+
+// benchmarkParse runs parse on the log b.N times and reports lines/s
+// and allocs/line.
+func benchmarkParse(b *testing.B, log []byte, parse func(*testing.B, []byte) int) {
+	numLines := bytes.Count(log, []byte{'\n'})
+	b.ReportAllocs()
+	b.SetBytes(int64(len(log)))
+
+	var memStats runtime.MemStats
+	runtime.ReadMemStats(&memStats)
+	mallocs := memStats.Mallocs
+	b.ResetTimer()
+	start := time.Now()
+	var numReports int
+	for i := 0; i < b.N; i++ {
+		numReports = parse(b, log)
+	}
+	elapsed := time.Since(start)
+	b.StopTimer()
+	runtime.ReadMemStats(&memStats)
+	require.Greater(b, numReports, 1)
+
+	totalLines := float64(numLines) * float64(b.N)
+	b.ReportMetric(totalLines/elapsed.Seconds(), "lines/s")
+	b.ReportMetric(float64(memStats.Mallocs-mallocs)/totalLines, "allocs/line")
+}
+
+// parseLog parses the log and returns the number of reports, which are
+// discarded like by a report handler which keeps up with the parser.
+func parseLog(b *testing.B, log []byte) int {
+	return parseReader(b, bytes.NewReader(log))
+}
+
+func parseReader(b *testing.B, log io.Reader) int {
+	reportsCh := make(chan *report.Report, maxBufferedReports)
+	done := make(chan struct{})
+	var numReports int
+	go func() {
+		defer close(done)
+		for range reportsCh {
+			numReports++
+		}
+	}()
+	parser := NewLibfuzzerOutputParser(&Options{ProjectDir: "/src/project"})
+	err := parser.Parse(context.Background(), log, reportsCh)
+	<-done
+	if err != nil {
+		b.Fatal(err)
+	}
+	return numReports
+}
+
+// parseTeedLog parses the log like parseLog, but writes it to the
+// parser through a tee to stderrOutput, like executil.StderrTeePipe.
+func parseTeedLog(b *testing.B, log []byte, stderrOutput io.Writer) int {
+	pr, pw := io.Pipe()
+	go func() {
+		// The size of a pipe buffer on Linux
+		const chunkSize = 64 * 1024
+		w := io.MultiWriter(stderrOutput, pw)
+		for len(log) > 0 {
+			n := minInt(chunkSize, len(log))
+			_, err := w.Write(log[:n])
+			if err != nil {
+				pw.CloseWithError(err)
+				return
+			}
+			log = log[n:]
+		}
+		pw.Close()
+	}()
+	return parseReader(b, pr)
+}
+
+func minInt(a, b int) int {
+	if a < b {
+		return a
+	}
+	return b
+}
+
+// startupLog is the output of libFuzzer until it starts fuzzing.
+func startupLog(buf *bytes.Buffer) {
+	buf.WriteString("INFO: Running with entropic power schedule (0xFF, 100).\n")
+	buf.WriteString("INFO: Seed: 1337\n")
+	buf.WriteString("INFO: Loaded 1 modules   (1234 inline 8-bit counters): 1234 [0x5a1b40, 0x5a2012),\n")
+	buf.WriteString("INFO: Loaded 1 PC tables (1234 PCs): 1234 [0x5a2018,0x5a6d38),\n")
+	buf.WriteString("INFO: -max_len is not provided; libFuzzer will not generate inputs larger than 4096 bytes\n")
+	buf.WriteString("INFO: seed corpus: files: 120 min: 1b max: 3412b total: 40231b rss: 31Mb\n")
+	buf.WriteString("#121\tINITED cov: 312 ft: 540 corp: 98/30Kb exec/s: 0 rss: 36Mb\n")
+}
+
+// writeStatsLine writes a stats line of execution n, in which the
+// status and the counters change like in a real run.
+func writeStatsLine(buf *bytes.Buffer, n int) {
+	switch {
+	case n%64 == 0:
+		fmt.Fprintf(buf, "#%d\tpulse  cov: %d ft: %d corp: %d/%dKb lim: 4096 exec/s: %d rss: %dMb\n",
+			n*128, 312+n/1000, 540+n/500, 98+n/200, 30+n/100, 4000+n%977, 36+n/20000)
+	case n%3 == 0:
+		fmt.Fprintf(buf, "#%d\tREDUCE cov: %d ft: %d corp: %d/%dKb lim: 4096 exec/s: %d rss: %dMb L: %d/%d MS: 2 ShuffleBytes-EraseBytes-\n",
+			n*128, 312+n/1000, 540+n/500, 98+n/200, 30+n/100, 4000+n%977, 36+n/20000, n%512, 4096)
+	default:
+		fmt.Fprintf(buf, "#%d\tNEW    cov: %d ft: %d corp: %d/%dKb lim: 4096 exec/s: %d rss: %dMb L: %d/%d MS: 4 ChangeBit-InsertByte-CopyPart-CMP- DE: \"\\x01\\x00\"-\n",
+			n*128, 312+n/1000, 540+n/500, 98+n/200, 30+n/100, 4000+n%977, 36+n/20000, n%512, 4096)
+	}
+}
+
+func statsLog(numLines int) []byte {
+	var buf bytes.Buffer
+	startupLog(&buf)
+	for n := 1; n <= numLines; n++ {
+		writeStatsLine(&buf, n)
+	}
+	buf.WriteString("Done 128000000 runs in 3600 second(s)\n")
+	return buf.Bytes()
+}
+
+// minijailLog returns the log as printed by a fuzz test run in
+// minijail, which logs the durations of its launch phases before the
+// fuzz test starts and the exit status of the fuzz test when it exits.
+func minijailLog(log []byte) []byte {
+	var buf bytes.Buffer
+	for _, phase := range []string{"clone", "mounts", "cgroups", "uid_gid", "launch"} {
+		fmt.Fprintf(&buf, "libminijail[2]: timing: %s 75us\n", phase)
+	}
+	buf.Write(log)
+	buf.WriteString("libminijail[2]: child process 3 exited with status 0\n")
+	return buf.Bytes()
+}
+
+func crashStormLog(numCrashes int, crashFile string) []byte {
+	var buf bytes.Buffer
+	startupLog(&buf)
+	for n := 1; n <= numCrashes; n++ {
+		writeStatsLine(&buf, n)
+		pid := 1000 + n
+		fmt.Fprintf(&buf, "=================================================================\n")
+		fmt.Fprintf(&buf, "==%d==ERROR: AddressSanitizer: heap-buffer-overflow on address 0x60200000%04x at pc 0x55d4c3 bp 0x7ffd2f1e sp 0x7ffd2f10\n", pid, n%0x10000)
+		fmt.Fprintf(&buf, "READ of size 4 at 0x60200000%04x thread T0\n", n%0x10000)
+		for frame := 0; frame < 12; frame++ {
+			fmt.Fprintf(&buf, "    #%d 0x55d4%02x in parse_level_%d(char const*, unsigned long) /src/project/src/parser.cpp:%d:%d\n",
+				frame, frame, frame, 10+frame*7, 3+frame%5)
+		}
+		buf.WriteString("    #12 0x55d401 in LLVMFuzzerTestOneInput /src/project/fuzz_test.cpp:12:3\n")
+		buf.WriteString("    #13 0x4f8e5c in fuzzer::Fuzzer::ExecuteCallback(unsigned char const*, unsigned long) (/src/project/.cifuzz-build/fuzz_test+0x4f8e5c)\n")
+		buf.WriteString("    #14 0x7f3a1c29d8f in __libc_start_call_main csu/../sysdeps/nptl/libc_start_call_main.h:58:16\n")
+		buf.WriteString("\n")
+		fmt.Fprintf(&buf, "0x60200000%04x is located 0 bytes after 4-byte region [0x60200000%04x,0x60200000%04x)\n", n%0x10000, n%0x10000, n%0x10000)
+		buf.WriteString("allocated by thread T0 here:\n")
+		buf.WriteString("    #0 0x55d3a1 in malloc (/src/project/.cifuzz-build/fuzz_test+0x55d3a1)\n")
+		buf.WriteString("    #1 0x55d4c9 in LLVMFuzzerTestOneInput /src/project/fuzz_test.cpp:10:17\n")
+		buf.WriteString("\n")
+		buf.WriteString("SUMMARY: AddressSanitizer: heap-buffer-overflow /src/project/src/parser.cpp:10:3 in parse_level_0(char const*, unsigned long)\n")
+		buf.WriteString("Shadow bytes around the buggy address:\n")
+		for row := 0; row < 8; row++ {
+			fmt.Fprintf(&buf, "  0x0c047fff%04x: fa fa 04 fa fa fa 04 fa fa fa 04 fa fa fa 04 fa\n", row*16)
+		}
+		fmt.Fprintf(&buf, "==%d==ABORTING\n", pid)
+		buf.WriteString("MS: 2 InsertByte-ChangeBit-; base unit: adc83b19e793491b1c6ea0fd8b46cd9f32e592fc\n")
+		buf.WriteString("0x46,0x55,0x5a,0x5a,\n")
+		buf.WriteString("FUZZ\n")
+		fmt.Fprintf(&buf, "artifact_prefix='./'; Test unit written to %s\n", crashFile)
+		buf.WriteString("Base64: RlVaWg==\n")
+	}
+	return buf.Bytes()
+}
+
+func colorOutputLog(numLines int) []byte {
+	var buf bytes.Buffer
+	startupLog(&buf)
+	for n := 1; n <= numLines; n++ {
+		if n%100 == 0 {
+			writeStatsLine(&buf, n/100)
+			continue
+		}
+		switch n % 4 {
+		case 0:
+			fmt.Fprintf(&buf, "\x1b[32m[INFO]\x1b[0m 2023-03-01 12:00:%02d handling request %d: \x1b[1mGET\x1b[0m /api/v1/items?id=%d\n", n%60, n, n*7)
+		case 1:
+			fmt.Fprintf(&buf, "\x1b[33m[WARN]\x1b[0m unexpected token \x1b[1;31m'%c'\x1b[0m at offset %d\n", 'a'+n%26, n%4096)
+		case 2:
+			fmt.Fprintf(&buf, "\x1b[2m[DEBUG] parser state: depth=%d tokens=%d buffer=%d\x1b[0m\n", n%32, n%1000, n%4096)
+		default:
+			fmt.Fprintf(&buf, "[TRACE] input %d bytes, checksum %08x\n", n%4096, n*2654435761)
+		}
+	}
+	buf.WriteString("Done 640000 runs in 60 second(s)\n")
+	return buf.Bytes()
+}
@@ -74,6 +74,7 @@ some invalid logs`,
 						Edges:                   6,
 						CorpusSize:              3,
 						TotalExecutions:         4749,
+						PeakRSSBytes:            47 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -86,6 +87,7 @@ some invalid logs`,
 						Edges:                   6,
 						CorpusSize:              3,
 						TotalExecutions:         4805,
+						PeakRSSBytes:            47 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -98,6 +100,7 @@ some invalid logs`,
 						Edges:               7,
 						CorpusSize:          4,
 						TotalExecutions:     22045,
+						PeakRSSBytes:        81 << 20,
 					},
 				},
 			},
@@ -120,6 +123,7 @@ error info 2`,
 						Edges:                   6,
 						CorpusSize:              3,
 						TotalExecutions:         4805,
+						PeakRSSBytes:            47 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -162,6 +166,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   2,
 						CorpusSize:              1,
 						TotalExecutions:         2,
+						PeakRSSBytes:            28 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -174,6 +179,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   2,
 						CorpusSize:              1,
 						TotalExecutions:         4194304,
+						PeakRSSBytes:            359 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -204,6 +210,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   2,
 						CorpusSize:              1,
 						TotalExecutions:         8388608,
+						PeakRSSBytes:            590 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -229,6 +236,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   4,
 						CorpusSize:              27,
 						TotalExecutions:         128,
+						PeakRSSBytes:            905 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -241,6 +249,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   4,
 						CorpusSize:              41,
 						TotalExecutions:         256,
+						PeakRSSBytes:            941 << 20,
 						SecondsSinceLastFeature: 0,
 					},
 				},
@@ -252,6 +261,7 @@ SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior fuzz_targets/manual.cpp:
 						Edges:                   4,
 						CorpusSize:              59,
 						TotalExecutions:         512,
+						PeakRSSBytes:            981 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -349,6 +359,7 @@ error info 2`,
 						Edges:                   6,
 						CorpusSize:              3,
 						TotalExecutions:         4805,
+						PeakRSSBytes:            47 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -605,6 +616,7 @@ Base64: J3JycnJiYXJycnJycnJycmZvb3IAcgAAAXJyAAAAAHJycnJycnJycnJycnJycnJycnJycnJy
 						Edges:                   15,
 						CorpusSize:              8,
 						TotalExecutions:         38,
+						PeakRSSBytes:            44 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -710,6 +722,7 @@ SUMMARY: libFuzzer: timeout`,
 						Edges:                   3,
 						CorpusSize:              1,
 						TotalExecutions:         2,
+						PeakRSSBytes:            30 << 20,
 						SecondsSinceLastFeature: 0,
 						SecondsSinceLastEdge:    0,
 					},
@@ -895,3 +908,26 @@ func removeTimestamps(r *report.Report) {
 		r.Metric.Timestamp = time.Time{}
 	}
 }
+
+func TestMayStartFinding(t *testing.T) {
+	for _, line := range []string{
+		"==8141==ERROR: AddressSanitizer: global-buffer-overflow on address 0x00",
+		"==18== ERROR: libFuzzer: out-of-memory (used: 251Mb; limit: 250Mb)",
+		"==1==LeakSanitizer has encountered a fatal error.",
+		"fuzz_targets/manual.cpp:6:5: runtime error: signed integer overflow",
+		"ALARM: working on the last Unit for 1 seconds",
+		"panic: runtime error: index out of range [3] with length 3",
+		"== Java Exception: java.lang.ArrayIndexOutOfBoundsException: Index 22 out of bounds for length 8",
+		"== Java Assertion Error",
+		"Slowest unit: 26 s: ",
+	} {
+		assert.True(t, mayStartFinding(line), line)
+	}
+	for _, line := range []string{
+		"#2	INITED cov: 10 ft: 11 corp: 1/1b exec/s: 0 rss: 30Mb",
+		"INFO: Seed: 3287409164",
+		"parsing input of 12 bytes",
+	} {
+		assert.False(t, mayStartFinding(line), line)
+	}
+}
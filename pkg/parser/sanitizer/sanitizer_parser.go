@@ -2,6 +2,7 @@ package sanitizer
 
 import (
 	"regexp"
+	"strings"
 
 	"code-intelligence.com/cifuzz/pkg/finding"
 	"code-intelligence.com/cifuzz/util/regexutil"
@@ -59,6 +60,11 @@ func parseAsFatalErrorReport(log string) *finding.Finding {
 }
 
 func parseAsRuntimeReport(log string) *finding.Finding {
+	// runtimeErrorStartPattern has no literal prefix, so check for the
+	// literal first to not run the regex on every line
+	if !strings.Contains(log, " runtime error: ") {
+		return nil
+	}
 	result, found := regexutil.FindNamedGroupsMatch(runtimeErrorStartPattern, log)
 	if !found {
 		return nil
@@ -15,6 +15,8 @@ type Report struct {
 	Metric   *FuzzingMetric   `json:"metric,omitempty"`
 	Finding  *finding.Finding `json:"finding,omitempty"`
 	NumSeeds uint             `json:"num_seeds,omitempty"`
+	// ResourceUsage is only set in the final report of a fuzzing run
+	ResourceUsage *ResourceUsage `json:"resource_usage,omitempty"`
 }
 
 func (x *Report) GetFinding() *finding.Finding {
@@ -52,4 +54,58 @@ type FuzzingMetric struct {
 	TotalExecutions         uint64    `json:"total_executions,omitempty"`
 	Edges                   int32     `json:"edges,omitempty"`
 	SecondsSinceLastEdge    uint64    `json:"seconds_since_last_edge,omitempty"`
+	// The resources used by the fuzzer so far, which are only known if
+	// it runs in a sandbox with resource limits, see minijail.Resources.
+	CPUSeconds      float64 `json:"cpu_seconds,omitempty"`
+	MemoryBytes     uint64  `json:"memory_bytes,omitempty"`
+	PeakMemoryBytes uint64  `json:"peak_memory_bytes,omitempty"`
+
+	// The peak RSS of the fuzzer process as reported by libFuzzer
+	PeakRSSBytes uint64 `json:"peak_rss_bytes,omitempty"`
+}
+
+// ResourceUsage are the resources used by the fuzzer process during
+// the whole run, including the child processes it waited for, like the
+// fuzzer itself if it was run via minijail.
+type ResourceUsage struct {
+	UserCPUSeconds             float64 `json:"user_cpu_seconds,omitempty"`
+	SystemCPUSeconds           float64 `json:"system_cpu_seconds,omitempty"`
+	MaxRSSBytes                uint64  `json:"max_rss_bytes,omitempty"`
+	MajorPageFaults            uint64  `json:"major_page_faults,omitempty"`
+	VoluntaryContextSwitches   uint64  `json:"voluntary_context_switches,omitempty"`
+	InvoluntaryContextSwitches uint64  `json:"involuntary_context_switches,omitempty"`
+	// The resources used by the sandbox, which are only known if it
+	// has resource limits, see minijail.Resources.
+	SandboxCPUSeconds      float64 `json:"sandbox_cpu_seconds,omitempty"`
+	SandboxPeakMemoryBytes uint64  `json:"sandbox_peak_memory_bytes,omitempty"`
+}
+
+// Add adds the resources used by another process, e.g. another worker
+// of the same fuzzing run.
+func (u *ResourceUsage) Add(other *ResourceUsage) {
+	u.UserCPUSeconds += other.UserCPUSeconds
+	u.SystemCPUSeconds += other.SystemCPUSeconds
+	u.MaxRSSBytes += other.MaxRSSBytes
+	u.MajorPageFaults += other.MajorPageFaults
+	u.VoluntaryContextSwitches += other.VoluntaryContextSwitches
+	u.InvoluntaryContextSwitches += other.InvoluntaryContextSwitches
+	u.SandboxCPUSeconds += other.SandboxCPUSeconds
+	u.SandboxPeakMemoryBytes += other.SandboxPeakMemoryBytes
+}
+
+// AddSequential adds the resources used by a process which ran before
+// this one, so that the peak memory is the maximum of both instead of
+// the sum.
+func (u *ResourceUsage) AddSequential(other *ResourceUsage) {
+	maxRSS := u.MaxRSSBytes
+	if other.MaxRSSBytes > maxRSS {
+		maxRSS = other.MaxRSSBytes
+	}
+	sandboxPeakMemory := u.SandboxPeakMemoryBytes
+	if other.SandboxPeakMemoryBytes > sandboxPeakMemory {
+		sandboxPeakMemory = other.SandboxPeakMemoryBytes
+	}
+	u.Add(other)
+	u.MaxRSSBytes = maxRSS
+	u.SandboxPeakMemoryBytes = sandboxPeakMemory
 }
@@ -94,6 +94,10 @@ func (f RunfilesFinderImpl) DumperSourcePath() (string, error) {
 	return f.findFollowSymlinks("src/dumper.c")
 }
 
+func (f RunfilesFinderImpl) InputRingSourcePath() (string, error) {
+	return f.findFollowSymlinks("src/inputring.c")
+}
+
 func (f RunfilesFinderImpl) VisualStudioPath() (string, error) {
 	path, found := os.LookupEnv("VSINSTALLDIR")
 	if !found {
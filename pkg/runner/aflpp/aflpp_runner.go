@@ -0,0 +1,455 @@
+package aflpp
+
+import (
+	"context"
+	"crypto/sha1"
+	"encoding/hex"
+	"fmt"
+	"io"
+	"io/fs"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/cmdutils"
+	"code-intelligence.com/cifuzz/pkg/log"
+	aflpp_parser "code-intelligence.com/cifuzz/pkg/parser/aflpp"
+	"code-intelligence.com/cifuzz/pkg/report"
+	fuzzer_runner "code-intelligence.com/cifuzz/pkg/runner"
+	"code-intelligence.com/cifuzz/pkg/runner/libfuzzer"
+	"code-intelligence.com/cifuzz/util/envutil"
+	"code-intelligence.com/cifuzz/util/executil"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+const (
+	// How often the output directory of afl-fuzz is checked for new
+	// stats, corpus entries and crashes. afl-fuzz updates its stats
+	// about once per second.
+	pollInterval = time.Second
+	// The amount of afl-fuzz output which is printed if it fails
+	maxOutputTail = 64 * 1024
+)
+
+// RunnerOptions are the options of the libFuzzer runner, of which the
+// aflpp runner supports all but the sandbox, multiple workers and
+// corpus merges.
+type RunnerOptions struct {
+	LibfuzzerOptions *libfuzzer.RunnerOptions
+}
+
+func (options *RunnerOptions) ValidateOptions() error {
+	err := options.LibfuzzerOptions.ValidateOptions()
+	if err != nil {
+		return err
+	}
+
+	if options.LibfuzzerOptions.UseMinijail {
+		return errors.New("The aflpp engine doesn't support the sandbox")
+	}
+	if options.LibfuzzerOptions.Workers > 1 {
+		return errors.New("The aflpp engine doesn't support multiple workers")
+	}
+	if options.LibfuzzerOptions.CorpusMergeThreshold != 0 || options.LibfuzzerOptions.CorpusMergeInterval != 0 {
+		return errors.New("The aflpp engine doesn't support merging the generated corpus")
+	}
+
+	return nil
+}
+
+// Runner runs a fuzz test built with the aflpp engine via afl-fuzz.
+// afl-fuzz reports its progress and results in files in its output
+// directory instead of its output, so they are polled periodically.
+// Crashes are reproduced by running the fuzz test on the crashing
+// input outside of afl-fuzz, which yields the same sanitizer reports as
+// with libFuzzer, and are parsed by the libFuzzer parser.
+type Runner struct {
+	*RunnerOptions
+	*libfuzzer.Runner
+
+	started chan struct{}
+	cmd     *executil.Cmd
+}
+
+func NewRunner(options *RunnerOptions) *Runner {
+	return &Runner{
+		RunnerOptions: options,
+		Runner:        libfuzzer.NewRunner(options.LibfuzzerOptions),
+		started:       make(chan struct{}, 1),
+	}
+}
+
+func (r *Runner) Run(ctx context.Context) error {
+	err := r.ValidateOptions()
+	if err != nil {
+		return err
+	}
+	// The symbolizer is created when the first crash is reproduced
+	defer r.Runner.CloseSymbolizer()
+
+	aflFuzz, err := exec.LookPath("afl-fuzz")
+	if err != nil {
+		return errors.Wrap(err, "The aflpp engine requires afl-fuzz, see https://github.com/AFLplusplus/AFLplusplus")
+	}
+
+	// afl-fuzz only supports a single input directory
+	inputDir, err := os.MkdirTemp("", "aflpp-in-")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(inputDir)
+	numSeeds, err := r.linkInputs(inputDir)
+	if err != nil {
+		return err
+	}
+
+	outputDir, err := os.MkdirTemp("", "aflpp-out-")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(outputDir)
+
+	args := []string{aflFuzz, "-i", inputDir, "-o", outputDir}
+
+	// Tell afl-fuzz to exit after the timeout
+	if r.Timeout > 0 {
+		args = append(args, "-V", strconv.FormatInt(int64(r.Timeout.Seconds()), 10))
+	}
+
+	// Tell afl-fuzz which dictionary it should use, in addition to the
+	// one afl-clang-lto extracts from the fuzz test
+	if r.Dictionary != "" {
+		args = append(args, "-x", r.Dictionary)
+	}
+
+	// Add user-specified afl-fuzz options
+	args = append(args, r.EngineArgs...)
+
+	args = append(args, "--", r.FuzzTarget)
+	args = append(args, r.FuzzTestArgs...)
+
+	env, err := r.aflFuzzEnvironment()
+	if err != nil {
+		return err
+	}
+
+	// Like libFuzzer, afl-fuzz is expected to exit on its own after
+	// the timeout, else it's terminated a bit later
+	var cmdCtx context.Context
+	var cancelCmdCtx context.CancelFunc
+	if r.Timeout > 0 {
+		cmdCtx, cancelCmdCtx = context.WithTimeout(ctx, r.Timeout+libfuzzer.ExitGracePeriod)
+	} else {
+		cmdCtx, cancelCmdCtx = context.WithCancel(ctx)
+	}
+	defer cancelCmdCtx()
+	r.cmd = executil.CommandContext(cmdCtx, args[0], args[1:]...)
+	r.cmd.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return err
+	}
+	output := &tailBuffer{max: maxOutputTail}
+	if r.Verbose {
+		// Print the output via pterm to avoid that it messes with the
+		// pterm output, see libfuzzer.Runner.RunLibfuzzerAndReport
+		ptermWriter := log.NewPTermWriter(r.LogOutput)
+		r.cmd.Stdout = io.MultiWriter(ptermWriter, output)
+		r.cmd.Stderr = r.cmd.Stdout
+	} else {
+		r.cmd.Stdout = output
+		r.cmd.Stderr = output
+	}
+
+	log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(r.cmd.Args, env))
+	err = r.cmd.Start()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	r.started <- struct{}{}
+
+	err = r.ReportHandler.Handle(&report.Report{Status: report.RunStatusInitializing, NumSeeds: numSeeds})
+	if err != nil {
+		return err
+	}
+
+	waitErrCh := make(chan error, 1)
+	go func() {
+		waitErrCh <- r.cmd.Wait()
+	}()
+
+	poller := &outputPoller{
+		runner:    r,
+		outputDir: filepath.Join(outputDir, "default"),
+		seen:      make(map[string]bool),
+	}
+	ticker := time.NewTicker(pollInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case err := <-waitErrCh:
+			// Pick up the results of the last interval
+			_, pollErr := poller.poll(ctx)
+			if pollErr != nil {
+				return pollErr
+			}
+			if r.cmd.TerminatedAfterContextDone() {
+				// afl-fuzz was stopped after a finding or because the
+				// timeout exceeded, which is not an error
+				return nil
+			}
+			if err != nil {
+				if !r.Verbose {
+					log.Print(output.String())
+				}
+				return cmdutils.WrapExecError(errors.WithStack(err), r.cmd.Cmd)
+			}
+			return nil
+		case <-ticker.C:
+			found, err := poller.poll(ctx)
+			if err != nil {
+				cancelCmdCtx()
+				<-waitErrCh
+				return err
+			}
+			if found {
+				// Like libFuzzer, stop after the first finding
+				cancelCmdCtx()
+			}
+		}
+	}
+}
+
+// linkInputs links the inputs of the seed corpus directories and the
+// generated corpus into inputDir and returns their number. If there
+// are none, it creates a single input, because afl-fuzz requires at
+// least one.
+func (r *Runner) linkInputs(inputDir string) (uint, error) {
+	var numInputs uint
+	for _, dir := range append([]string{r.GeneratedCorpusDir}, r.SeedCorpusDirs...) {
+		err := filepath.WalkDir(dir, func(path string, d fs.DirEntry, err error) error {
+			if err != nil {
+				return err
+			}
+			if !d.Type().IsRegular() {
+				return nil
+			}
+			absPath, err := filepath.Abs(path)
+			if err != nil {
+				return errors.WithStack(err)
+			}
+			numInputs++
+			return errors.WithStack(os.Symlink(absPath, filepath.Join(inputDir, fmt.Sprintf("input-%d", numInputs))))
+		})
+		if err != nil {
+			return 0, errors.WithStack(err)
+		}
+	}
+	if numInputs == 0 {
+		err := os.WriteFile(filepath.Join(inputDir, "default-input"), []byte{0}, 0o644)
+		if err != nil {
+			return 0, errors.WithStack(err)
+		}
+	}
+	return numInputs, nil
+}
+
+// aflFuzzEnvironment returns the environment for running the fuzz test
+// via afl-fuzz, which requires sanitizers to abort on errors, so that
+// it detects them as crashes, and to not symbolize, which is slow. The
+// crashes are symbolized when they are reproduced.
+func (r *Runner) aflFuzzEnvironment() ([]string, error) {
+	env, err := r.FuzzerEnvironment()
+	if err != nil {
+		return nil, err
+	}
+
+	env, err = fuzzer_runner.SetASANOptions(env, nil, map[string]string{
+		"abort_on_error": "1",
+		"symbolize":      "0",
+	})
+	if err != nil {
+		return nil, err
+	}
+	ubsanOptions := fuzzer_runner.SetSanitizerOptions(envutil.Getenv(env, "UBSAN_OPTIONS"), nil, map[string]string{
+		"halt_on_error":  "1",
+		"abort_on_error": "1",
+		"symbolize":      "0",
+	})
+	env, err = envutil.Setenv(env, "UBSAN_OPTIONS", ubsanOptions)
+	if err != nil {
+		return nil, err
+	}
+
+	defaults := map[string]string{
+		// The status screen would mess with the output of cifuzz
+		"AFL_NO_UI": "1",
+		// These checks of the system configuration fail in most
+		// containers and only affect the performance
+		"AFL_SKIP_CPUFREQ":                      "1",
+		"AFL_I_DONT_CARE_ABOUT_MISSING_CRASHES": "1",
+	}
+	for key, value := range defaults {
+		if os.Getenv(key) != "" {
+			continue
+		}
+		env, err = envutil.Setenv(env, key, value)
+		if err != nil {
+			return nil, err
+		}
+	}
+	return env, nil
+}
+
+func (r *Runner) Cleanup(ctx context.Context) {
+	// Wait until the command has been started, else we can't terminate it
+	select {
+	case <-ctx.Done():
+		return
+	case <-r.started:
+		err := r.cmd.TerminateProcessGroup()
+		if err != nil {
+			log.Error(err, err.Error())
+		}
+	}
+}
+
+// outputPoller passes on the results of afl-fuzz, which it writes to
+// the following files in its output directory:
+//   - fuzzer_stats: The metrics of the run
+//   - queue/: The corpus, including the initial inputs
+//   - crashes/: The crashing inputs and a README.txt
+type outputPoller struct {
+	runner    *Runner
+	outputDir string
+	// The names of the corpus entries and crashes which were handled
+	// already
+	seen map[string]bool
+	// The time of the last stats update which was reported
+	lastUpdate time.Time
+}
+
+// poll reports the new metrics and the first new crash, if any, and
+// copies new corpus entries to the generated corpus. It returns
+// whether a crash was reported.
+func (p *outputPoller) poll(ctx context.Context) (bool, error) {
+	err := p.copyNewCorpusEntries()
+	if err != nil {
+		return false, err
+	}
+
+	err = p.reportMetrics()
+	if err != nil {
+		return false, err
+	}
+
+	return p.reportNewCrash(ctx)
+}
+
+func (p *outputPoller) reportMetrics() error {
+	file, err := os.Open(filepath.Join(p.outputDir, "fuzzer_stats"))
+	if os.IsNotExist(err) {
+		// afl-fuzz is still initializing
+		return nil
+	}
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer file.Close()
+
+	metric, err := aflpp_parser.ParseFuzzerStats(file)
+	if err != nil {
+		// The file may be read while afl-fuzz is writing it
+		log.Debugf("Failed to parse the stats of afl-fuzz: %v", err)
+		return nil
+	}
+	if !metric.Timestamp.After(p.lastUpdate) {
+		return nil
+	}
+	p.lastUpdate = metric.Timestamp
+	return p.runner.ReportHandler.Handle(&report.Report{Status: report.RunStatusRunning, Metric: metric})
+}
+
+// copyNewCorpusEntries copies the corpus entries found by afl-fuzz to
+// the generated corpus, named after the SHA1 of their contents like
+// the entries libFuzzer creates. The initial inputs are skipped, since
+// they are in the corpus already.
+func (p *outputPoller) copyNewCorpusEntries() error {
+	queueDir := filepath.Join(p.outputDir, "queue")
+	entries, err := os.ReadDir(queueDir)
+	if os.IsNotExist(err) {
+		return nil
+	}
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	for _, e := range entries {
+		if !e.Type().IsRegular() || !strings.HasPrefix(e.Name(), "id:") || p.seen[e.Name()] {
+			continue
+		}
+		p.seen[e.Name()] = true
+		if strings.Contains(e.Name(), ",orig:") {
+			continue
+		}
+		data, err := os.ReadFile(filepath.Join(queueDir, e.Name()))
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		hash := sha1.Sum(data)
+		err = os.WriteFile(filepath.Join(p.runner.GeneratedCorpusDir, hex.EncodeToString(hash[:])), data, 0o644)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+	}
+	return nil
+}
+
+func (p *outputPoller) reportNewCrash(ctx context.Context) (bool, error) {
+	crashesDir := filepath.Join(p.outputDir, "crashes")
+	entries, err := os.ReadDir(crashesDir)
+	if os.IsNotExist(err) {
+		return false, nil
+	}
+	if err != nil {
+		return false, errors.WithStack(err)
+	}
+	for _, e := range entries {
+		if !strings.HasPrefix(e.Name(), "id:") || p.seen[e.Name()] {
+			continue
+		}
+		p.seen[e.Name()] = true
+
+		f, err := p.runner.ReproduceCrash(ctx, filepath.Join(crashesDir, e.Name()))
+		if err != nil {
+			return false, err
+		}
+		err = p.runner.ReportHandler.Handle(&report.Report{Status: report.RunStatusRunning, Finding: f})
+		if err != nil {
+			return false, err
+		}
+		return true, nil
+	}
+	return false, nil
+}
+
+// tailBuffer keeps the last max bytes written to it.
+type tailBuffer struct {
+	max int
+	buf []byte
+}
+
+func (b *tailBuffer) Write(p []byte) (int, error) {
+	b.buf = append(b.buf, p...)
+	if len(b.buf) > b.max {
+		b.buf = append(b.buf[:0], b.buf[len(b.buf)-b.max:]...)
+	}
+	return len(p), nil
+}
+
+func (b *tailBuffer) String() string {
+	return string(b.buf)
+}
@@ -0,0 +1,98 @@
+package aflpp
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/pkg/runner/libfuzzer"
+)
+
+type collectingHandler struct {
+	reports []*report.Report
+}
+
+func (h *collectingHandler) Handle(r *report.Report) error {
+	h.reports = append(h.reports, r)
+	return nil
+}
+
+func TestLinkInputs(t *testing.T) {
+	generatedCorpus := t.TempDir()
+	seedCorpus := t.TempDir()
+	require.NoError(t, os.WriteFile(filepath.Join(generatedCorpus, "a"), []byte("a"), 0o644))
+	require.NoError(t, os.MkdirAll(filepath.Join(seedCorpus, "sub"), 0o755))
+	require.NoError(t, os.WriteFile(filepath.Join(seedCorpus, "sub", "b"), []byte("b"), 0o644))
+
+	r := NewRunner(&RunnerOptions{LibfuzzerOptions: &libfuzzer.RunnerOptions{
+		GeneratedCorpusDir: generatedCorpus,
+		SeedCorpusDirs:     []string{seedCorpus},
+	}})
+	inputDir := t.TempDir()
+	numInputs, err := r.linkInputs(inputDir)
+	require.NoError(t, err)
+	assert.Equal(t, uint(2), numInputs)
+	entries, err := os.ReadDir(inputDir)
+	require.NoError(t, err)
+	require.Len(t, entries, 2)
+
+	// Without any inputs, a single one is created
+	r.SeedCorpusDirs = nil
+	r.GeneratedCorpusDir = t.TempDir()
+	inputDir = t.TempDir()
+	numInputs, err = r.linkInputs(inputDir)
+	require.NoError(t, err)
+	assert.Equal(t, uint(0), numInputs)
+	entries, err = os.ReadDir(inputDir)
+	require.NoError(t, err)
+	require.Len(t, entries, 1)
+}
+
+func TestOutputPoller(t *testing.T) {
+	outputDir := t.TempDir()
+	queueDir := filepath.Join(outputDir, "queue")
+	require.NoError(t, os.MkdirAll(queueDir, 0o755))
+	generatedCorpus := t.TempDir()
+	handler := &collectingHandler{}
+	r := NewRunner(&RunnerOptions{LibfuzzerOptions: &libfuzzer.RunnerOptions{
+		GeneratedCorpusDir: generatedCorpus,
+		ReportHandler:      handler,
+	}})
+	p := &outputPoller{runner: r, outputDir: outputDir, seen: make(map[string]bool)}
+
+	// Nothing is reported while afl-fuzz is initializing
+	found, err := p.poll(context.Background())
+	require.NoError(t, err)
+	assert.False(t, found)
+	assert.Empty(t, handler.reports)
+
+	// Only the new corpus entries are copied to the generated corpus
+	require.NoError(t, os.WriteFile(filepath.Join(queueDir, "id:000000,time:0,execs:0,orig:input-1"), []byte("seed"), 0o644))
+	require.NoError(t, os.WriteFile(filepath.Join(queueDir, "id:000001,src:000000,time:12,execs:34,op:havoc,rep:2,+cov"), []byte("new"), 0o644))
+	require.NoError(t, os.MkdirAll(filepath.Join(queueDir, ".state"), 0o755))
+	stats := "last_update : 1700000120\nexecs_done : 1000\ncorpus_count : 2\nedges_found : 10\n"
+	require.NoError(t, os.WriteFile(filepath.Join(outputDir, "fuzzer_stats"), []byte(stats), 0o644))
+	found, err = p.poll(context.Background())
+	require.NoError(t, err)
+	assert.False(t, found)
+	entries, err := os.ReadDir(generatedCorpus)
+	require.NoError(t, err)
+	require.Len(t, entries, 1)
+	// The SHA1 of "new"
+	assert.Equal(t, "c2a6b03f190dfb2b4aa91f8af8d477a9bc3401dc", entries[0].Name())
+
+	require.Len(t, handler.reports, 1)
+	assert.Equal(t, report.RunStatusRunning, handler.reports[0].Status)
+	assert.Equal(t, uint64(1000), handler.reports[0].Metric.TotalExecutions)
+
+	// Unchanged stats aren't reported again
+	found, err = p.poll(context.Background())
+	require.NoError(t, err)
+	assert.False(t, found)
+	require.Len(t, handler.reports, 1)
+}
@@ -0,0 +1,390 @@
+package centipede
+
+import (
+	"bufio"
+	"context"
+	"io"
+	"io/fs"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/internal/cmdutils"
+	"code-intelligence.com/cifuzz/pkg/log"
+	centipede_parser "code-intelligence.com/cifuzz/pkg/parser/centipede"
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/pkg/runner/libfuzzer"
+	"code-intelligence.com/cifuzz/util/envutil"
+	"code-intelligence.com/cifuzz/util/executil"
+)
+
+const (
+	// How often the metrics are reported and the work directory is
+	// checked for new crashes
+	pollInterval = time.Second
+	// The number of output lines which are printed if centipede fails
+	numOutputLines = 20
+)
+
+type RunnerOptions struct {
+	LibfuzzerOptions *libfuzzer.RunnerOptions
+	// WorkDir is the directory in which Centipede stores the corpus
+	// shards and the features of their inputs. It's kept between runs,
+	// so that the corpus doesn't have to be executed again as long as
+	// the fuzz test didn't change.
+	WorkDir string
+}
+
+func (options *RunnerOptions) ValidateOptions() error {
+	err := options.LibfuzzerOptions.ValidateOptions()
+	if err != nil {
+		return err
+	}
+
+	if options.WorkDir == "" {
+		return errors.New("WorkDir is not set")
+	}
+	if options.LibfuzzerOptions.UseMinijail {
+		return errors.New("The centipede engine doesn't support the sandbox")
+	}
+	if options.LibfuzzerOptions.CorpusMergeThreshold != 0 || options.LibfuzzerOptions.CorpusMergeInterval != 0 {
+		return errors.New("The centipede engine doesn't support merging the generated corpus")
+	}
+
+	return nil
+}
+
+// Runner runs a fuzz test built with the centipede engine. Unlike
+// libFuzzer, Centipede runs the fuzz test in separate processes, which
+// execute batches of inputs and pass their features back via shared
+// memory, and shards the corpus across its Workers. Crashes are stored
+// in the work directory, from which they are reproduced like the ones
+// found by AFL++.
+type Runner struct {
+	*RunnerOptions
+	*libfuzzer.Runner
+
+	started chan struct{}
+	cmd     *executil.Cmd
+}
+
+func NewRunner(options *RunnerOptions) *Runner {
+	return &Runner{
+		RunnerOptions: options,
+		Runner:        libfuzzer.NewRunner(options.LibfuzzerOptions),
+		started:       make(chan struct{}, 1),
+	}
+}
+
+func (r *Runner) Run(ctx context.Context) error {
+	err := r.ValidateOptions()
+	if err != nil {
+		return err
+	}
+	// The symbolizer is created when the first crash is reproduced
+	defer r.Runner.CloseSymbolizer()
+
+	centipede, err := exec.LookPath("centipede")
+	if err != nil {
+		return errors.Wrap(err, "The centipede engine requires centipede, see https://github.com/google/fuzztest/tree/main/centipede")
+	}
+
+	err = os.MkdirAll(r.WorkDir, 0o755)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	// Only the crashes of this run are reported
+	crashes, err := r.findCrashes(nil)
+	if err != nil {
+		return err
+	}
+	seenCrashes := make(map[string]bool)
+	for _, crash := range crashes {
+		seenCrashes[crash] = true
+	}
+
+	// Centipede imports the inputs of all corpus directories and writes
+	// the new ones to the first
+	corpusDirs := append([]string{r.GeneratedCorpusDir}, r.SeedCorpusDirs...)
+	args := []string{
+		centipede,
+		"--binary=" + r.FuzzTarget,
+		"--workdir=" + r.WorkDir,
+		"--corpus_dir=" + strings.Join(corpusDirs, ","),
+		// Like libFuzzer, stop after the first finding
+		"--exit_on_crash=1",
+	}
+	if r.Workers > 1 {
+		args = append(args, "--j="+strconv.FormatUint(uint64(r.Workers), 10))
+	}
+	if r.Timeout > 0 {
+		args = append(args, "--stop_after="+strconv.FormatInt(int64(r.Timeout.Seconds()), 10)+"s")
+	}
+	if r.Dictionary != "" {
+		args = append(args, "--dictionary="+r.Dictionary)
+	}
+	// Add user-specified centipede options
+	args = append(args, r.EngineArgs...)
+
+	env, err := r.FuzzerEnvironment()
+	if err != nil {
+		return err
+	}
+
+	var cmdCtx context.Context
+	var cancelCmdCtx context.CancelFunc
+	if r.Timeout > 0 {
+		cmdCtx, cancelCmdCtx = context.WithTimeout(ctx, r.Timeout+libfuzzer.ExitGracePeriod)
+	} else {
+		cmdCtx, cancelCmdCtx = context.WithCancel(ctx)
+	}
+	defer cancelCmdCtx()
+	r.cmd = executil.CommandContext(cmdCtx, args[0], args[1:]...)
+	r.cmd.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return err
+	}
+	var output io.Writer = io.Discard
+	if r.Verbose {
+		// See libfuzzer.Runner.RunLibfuzzerAndReport
+		output = log.NewPTermWriter(r.LogOutput)
+	}
+	r.cmd.Stdout = output
+	stderrPipe, err := r.cmd.StderrTeePipe(output)
+	if err != nil {
+		return err
+	}
+
+	log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(r.cmd.Args, env))
+	err = r.cmd.Start()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	r.started <- struct{}{}
+
+	err = r.ReportHandler.Handle(&report.Report{Status: report.RunStatusInitializing, NumSeeds: countInputs(corpusDirs)})
+	if err != nil {
+		return err
+	}
+
+	aggregator := newShardAggregator()
+	var lastLines []string
+	parsed := make(chan struct{})
+	go func() {
+		defer close(parsed)
+		scanner := bufio.NewScanner(stderrPipe)
+		scanner.Buffer(make([]byte, 0, 64*1024), 1024*1024)
+		for scanner.Scan() {
+			line := scanner.Text()
+			if stats, ok := centipede_parser.ParseStatsLine(line); ok {
+				aggregator.update(stats)
+			}
+			lastLines = append(lastLines, line)
+			if len(lastLines) > numOutputLines {
+				lastLines = lastLines[1:]
+			}
+		}
+		// Keep reading after an overlong line, else centipede blocks
+		// when the pipe is full
+		_, _ = io.Copy(io.Discard, stderrPipe)
+	}()
+
+	waitErrCh := make(chan error, 1)
+	go func() {
+		waitErrCh <- r.cmd.Wait()
+	}()
+
+	poll := func() (bool, error) {
+		if metric, ok := aggregator.metric(); ok {
+			err := r.ReportHandler.Handle(&report.Report{Status: report.RunStatusRunning, Metric: metric})
+			if err != nil {
+				return false, err
+			}
+		}
+		return r.reportNewCrash(ctx, seenCrashes)
+	}
+
+	ticker := time.NewTicker(pollInterval)
+	defer ticker.Stop()
+	findingReported := false
+	for {
+		select {
+		case err := <-waitErrCh:
+			<-parsed
+			closeErr := stderrPipe.Close()
+			if closeErr != nil {
+				return errors.WithStack(closeErr)
+			}
+			// Pick up the results of the last interval
+			found, pollErr := poll()
+			if pollErr != nil {
+				return pollErr
+			}
+			if found || findingReported || r.cmd.TerminatedAfterContextDone() {
+				return nil
+			}
+			if err != nil {
+				if !r.Verbose {
+					log.Print(strings.Join(lastLines, "\n"))
+				}
+				return cmdutils.WrapExecError(errors.WithStack(err), r.cmd.Cmd)
+			}
+			return nil
+		case <-ticker.C:
+			found, err := poll()
+			if err != nil {
+				cancelCmdCtx()
+				<-waitErrCh
+				return err
+			}
+			if found {
+				findingReported = true
+				cancelCmdCtx()
+			}
+		}
+	}
+}
+
+// findCrashes returns the crashing inputs which Centipede stored in the
+// crashes.<shard> directories of the work directory and which are not
+// in seen.
+func (r *Runner) findCrashes(seen map[string]bool) ([]string, error) {
+	var crashes []string
+	err := filepath.WalkDir(r.WorkDir, func(path string, d fs.DirEntry, err error) error {
+		if err != nil {
+			return err
+		}
+		if !d.Type().IsRegular() || !strings.HasPrefix(filepath.Base(filepath.Dir(path)), "crashes") || seen[path] {
+			return nil
+		}
+		crashes = append(crashes, path)
+		return nil
+	})
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return crashes, nil
+}
+
+// reportNewCrash reproduces and reports the first crash which is not in
+// seen and returns whether there was one.
+func (r *Runner) reportNewCrash(ctx context.Context, seen map[string]bool) (bool, error) {
+	crashes, err := r.findCrashes(seen)
+	if err != nil {
+		return false, err
+	}
+	if len(crashes) == 0 {
+		return false, nil
+	}
+	seen[crashes[0]] = true
+
+	f, err := r.ReproduceCrash(ctx, crashes[0])
+	if err != nil {
+		return false, err
+	}
+	err = r.ReportHandler.Handle(&report.Report{Status: report.RunStatusRunning, Finding: f})
+	if err != nil {
+		return false, err
+	}
+	return true, nil
+}
+
+func (r *Runner) Cleanup(ctx context.Context) {
+	// Wait until the command has been started, else we can't terminate it
+	select {
+	case <-ctx.Done():
+		return
+	case <-r.started:
+		err := r.cmd.TerminateProcessGroup()
+		if err != nil {
+			log.Error(err, err.Error())
+		}
+	}
+}
+
+func countInputs(dirs []string) uint {
+	var n uint
+	for _, dir := range dirs {
+		entries, err := os.ReadDir(dir)
+		if err != nil {
+			log.Debugf("Failed to read corpus directory: %v", err)
+			continue
+		}
+		for _, e := range entries {
+			if e.Type().IsRegular() {
+				n++
+			}
+		}
+	}
+	return n
+}
+
+// shardAggregator merges the stats of the shards into the metrics of
+// the run, like the metrics of multiple libFuzzer workers are merged.
+type shardAggregator struct {
+	mutex   sync.Mutex
+	shards  map[int]*centipede_parser.ShardStats
+	changed bool
+	// The time at which the number of features of any shard increased
+	lastNewFeature time.Time
+	maxFeatures    int32
+}
+
+func newShardAggregator() *shardAggregator {
+	return &shardAggregator{
+		shards:         make(map[int]*centipede_parser.ShardStats),
+		lastNewFeature: time.Now(),
+	}
+}
+
+func (a *shardAggregator) update(stats *centipede_parser.ShardStats) {
+	a.mutex.Lock()
+	defer a.mutex.Unlock()
+	a.shards[stats.Shard] = stats
+	a.changed = true
+	if stats.Features > a.maxFeatures {
+		a.maxFeatures = stats.Features
+		a.lastNewFeature = time.Now()
+	}
+}
+
+// metric returns the merged metrics if any shard reported new stats
+// since the last call. The throughput is the sum of the shards, the
+// coverage and corpus size the maximum, because the shards exchange
+// their corpora.
+func (a *shardAggregator) metric() (*report.FuzzingMetric, bool) {
+	a.mutex.Lock()
+	defer a.mutex.Unlock()
+	if !a.changed {
+		return nil, false
+	}
+	a.changed = false
+
+	now := time.Now()
+	sinceLastFeature := uint64(now.Sub(a.lastNewFeature).Seconds())
+	metric := &report.FuzzingMetric{
+		Timestamp:               now,
+		SecondsSinceLastFeature: sinceLastFeature,
+		SecondsSinceLastEdge:    sinceLastFeature,
+	}
+	for _, s := range a.shards {
+		metric.ExecutionsPerSecond += s.ExecutionsPerSecond
+		metric.TotalExecutions += s.Runs
+		if s.Features > metric.Features {
+			metric.Features = s.Features
+		}
+		if s.Coverage > metric.Edges {
+			metric.Edges = s.Coverage
+		}
+		if s.CorpusSize > metric.CorpusSize {
+			metric.CorpusSize = s.CorpusSize
+		}
+	}
+	return metric, true
+}
@@ -0,0 +1,55 @@
+package centipede
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	centipede_parser "code-intelligence.com/cifuzz/pkg/parser/centipede"
+	"code-intelligence.com/cifuzz/pkg/runner/libfuzzer"
+)
+
+func TestShardAggregator(t *testing.T) {
+	a := newShardAggregator()
+	_, ok := a.metric()
+	assert.False(t, ok)
+
+	a.update(&centipede_parser.ShardStats{Shard: 0, Runs: 1000, Features: 50, Coverage: 20, CorpusSize: 10, ExecutionsPerSecond: 100})
+	a.update(&centipede_parser.ShardStats{Shard: 1, Runs: 3000, Features: 40, Coverage: 25, CorpusSize: 12, ExecutionsPerSecond: 300})
+	// Only the last stats of each shard are used
+	a.update(&centipede_parser.ShardStats{Shard: 0, Runs: 2000, Features: 60, Coverage: 22, CorpusSize: 11, ExecutionsPerSecond: 200})
+	metric, ok := a.metric()
+	require.True(t, ok)
+	assert.Equal(t, uint64(5000), metric.TotalExecutions)
+	assert.Equal(t, int32(500), metric.ExecutionsPerSecond)
+	assert.Equal(t, int32(60), metric.Features)
+	assert.Equal(t, int32(25), metric.Edges)
+	assert.Equal(t, int32(12), metric.CorpusSize)
+
+	// Nothing changed since the last call
+	_, ok = a.metric()
+	assert.False(t, ok)
+}
+
+func TestFindCrashes(t *testing.T) {
+	workDir := t.TempDir()
+	require.NoError(t, os.MkdirAll(filepath.Join(workDir, "crashes.000001"), 0o755))
+	require.NoError(t, os.MkdirAll(filepath.Join(workDir, "my_fuzz_test-1234", "crashes.000000"), 0o755))
+	crash1 := filepath.Join(workDir, "crashes.000001", "0123abcd")
+	crash2 := filepath.Join(workDir, "my_fuzz_test-1234", "crashes.000000", "4567cdef")
+	require.NoError(t, os.WriteFile(crash1, []byte("a"), 0o644))
+	require.NoError(t, os.WriteFile(crash2, []byte("b"), 0o644))
+	require.NoError(t, os.WriteFile(filepath.Join(workDir, "corpus.000000"), []byte("c"), 0o644))
+
+	r := NewRunner(&RunnerOptions{LibfuzzerOptions: &libfuzzer.RunnerOptions{}, WorkDir: workDir})
+	crashes, err := r.findCrashes(nil)
+	require.NoError(t, err)
+	assert.ElementsMatch(t, []string{crash1, crash2}, crashes)
+
+	crashes, err = r.findCrashes(map[string]bool{crash1: true})
+	require.NoError(t, err)
+	assert.Equal(t, []string{crash2}, crashes)
+}
@@ -0,0 +1,204 @@
+package libfuzzer
+
+import (
+	"context"
+	"fmt"
+	"runtime"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+const (
+	// The time for which a single libFuzzer process runs to measure its
+	// memory usage before the number of workers is chosen
+	workersCalibrationTime = 30 * time.Second
+	// The factor by which the memory usage of a worker is assumed to
+	// grow after the calibration, because ASan's quarantine and the
+	// corpus keep growing
+	workerMemoryHeadroom = 1.5
+)
+
+// calibrateWorkers runs a single libFuzzer process for a short time to
+// measure its peak RSS, and then sets Workers to the number of
+// processes which fit into the WorkersMemoryBudget, but not more than
+// there are cores. The -rss_limit_mb and -malloc_limit_mb of the
+// workers are set to their share of the budget. It returns true if the
+// calibration run ended the fuzzing run already, e.g. because it found
+// a crash.
+func (r *Runner) calibrateWorkers(ctx context.Context) (bool, error) {
+	budget := r.WorkersMemoryBudget
+	if budget == 0 {
+		var err error
+		budget, err = availableMemory()
+		if err != nil {
+			return false, errors.WithMessage(err, "Failed to determine the available memory, please specify a memory budget for the workers")
+		}
+	}
+
+	calibrationTime := workersCalibrationTime
+	if r.Timeout > 0 && r.Timeout/4 < calibrationTime {
+		calibrationTime = (r.Timeout / 4).Truncate(time.Second)
+	}
+	if calibrationTime < time.Second {
+		// The run is too short to be worth calibrating
+		r.Workers = 1
+		return false, nil
+	}
+
+	// The options are changed below for the rest of the run, which
+	// must not affect the caller
+	runOpts := *r.RunnerOptions
+	r.RunnerOptions = &runOpts
+
+	opts := *r.RunnerOptions
+	opts.AutoWorkers = false
+	// The inputs were replayed before the calibration run
+	opts.ReplayFirst = nil
+	opts.Workers = 1
+	opts.Timeout = calibrationTime
+	opts.PlateauTimeout = 0
+	recorder := &calibrationRecorder{handler: r.ReportHandler}
+	opts.ReportHandler = recorder
+	calibration := NewRunner(&opts)
+	calibration.SupportJazzer = r.SupportJazzer
+	calibration.symbolizer = r.symbolizer
+
+	r.workersMutex.Lock()
+	r.workers = []*Runner{calibration}
+	r.workersMutex.Unlock()
+
+	log.Infof("Measuring the memory usage of the fuzz test for %s to choose the number of workers", calibrationTime)
+	start := time.Now()
+	err := calibration.Run(ctx)
+
+	r.workersMutex.Lock()
+	r.workers = nil
+	r.workersMutex.Unlock()
+
+	finished := err != nil || recorder.crashed() || ctx.Err() != nil
+	if r.Timeout > 0 {
+		remaining := (r.Timeout - time.Since(start)).Truncate(time.Second)
+		if remaining < time.Second {
+			finished = true
+		}
+		r.Timeout = remaining
+	}
+	if finished {
+		if err == nil && recorder.usage != nil {
+			err = r.ReportHandler.Handle(&report.Report{ResourceUsage: recorder.usage})
+		}
+		return true, err
+	}
+	if recorder.usage != nil {
+		r.ReportHandler = &calibrationUsageHandler{handler: r.ReportHandler, usage: recorder.usage}
+	}
+
+	rss := recorder.peakRSS()
+	workers := chooseNumWorkers(budget, rss, uint(runtime.NumCPU()))
+	limitMB := (budget / uint64(workers)) >> 20
+	log.Infof("Running %d workers, with a peak RSS of %d MB per worker and a memory budget of %d MB", workers, rss>>20, budget>>20)
+
+	// The limits are passed before the user-specified arguments, so
+	// that those take precedence
+	r.EngineArgs = append([]string{
+		fmt.Sprintf("-rss_limit_mb=%d", limitMB),
+		fmt.Sprintf("-malloc_limit_mb=%d", limitMB),
+	}, r.EngineArgs...)
+	r.Workers = workers
+	return false, nil
+}
+
+// chooseNumWorkers returns the number of workers which each use rss
+// bytes plus a headroom and fit into the budget, between one and the
+// number of cores.
+func chooseNumWorkers(budget uint64, rss uint64, numCores uint) uint {
+	if numCores == 0 {
+		numCores = 1
+	}
+	if rss == 0 {
+		return numCores
+	}
+	workers := uint(float64(budget) / (float64(rss) * workerMemoryHeadroom))
+	if workers > numCores {
+		workers = numCores
+	}
+	if workers == 0 {
+		workers = 1
+	}
+	return workers
+}
+
+// calibrationRecorder passes the reports of the calibration run on to
+// its handler and records its memory usage. The resource usage of the
+// calibration run is not passed on, because it's added to that of the
+// rest of the run, see calibrationUsageHandler.
+type calibrationRecorder struct {
+	handler report.Handler
+
+	mutex      sync.Mutex
+	lastMetric *report.FuzzingMetric
+	usage      *report.ResourceUsage
+	// Whether a finding was reported which made libFuzzer exit, which
+	// slow inputs don't
+	crash bool
+}
+
+func (c *calibrationRecorder) Handle(r *report.Report) error {
+	c.mutex.Lock()
+	if r.Metric != nil {
+		c.lastMetric = r.Metric
+	}
+	if r.Finding != nil && r.Finding.Type != finding.ErrorTypeWarning {
+		c.crash = true
+	}
+	if r.ResourceUsage != nil {
+		c.usage = r.ResourceUsage
+		c.mutex.Unlock()
+		return nil
+	}
+	c.mutex.Unlock()
+	return c.handler.Handle(r)
+}
+
+func (c *calibrationRecorder) crashed() bool {
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	return c.crash
+}
+
+// peakRSS returns the peak RSS reported by libFuzzer, or else the
+// one measured by the OS once the process exited.
+func (c *calibrationRecorder) peakRSS() uint64 {
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	var rss uint64
+	if c.lastMetric != nil {
+		rss = c.lastMetric.PeakRSSBytes
+	}
+	if rss == 0 && c.usage != nil {
+		rss = c.usage.MaxRSSBytes
+	}
+	return rss
+}
+
+// calibrationUsageHandler adds the resource usage of the calibration
+// run to that of the rest of the run.
+type calibrationUsageHandler struct {
+	handler report.Handler
+	usage   *report.ResourceUsage
+}
+
+func (h *calibrationUsageHandler) Handle(r *report.Report) error {
+	if r.ResourceUsage != nil {
+		usage := *r.ResourceUsage
+		usage.AddSequential(h.usage)
+		r = &report.Report{ResourceUsage: &usage}
+	}
+	return h.handler.Handle(r)
+}
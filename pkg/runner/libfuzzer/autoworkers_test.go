@@ -0,0 +1,66 @@
+package libfuzzer
+
+import (
+	"runtime"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+func TestChooseNumWorkers(t *testing.T) {
+	for _, tc := range []struct {
+		budget   uint64
+		rss      uint64
+		numCores uint
+		expected uint
+	}{
+		// 8 GB fit 5 workers of 1 GB plus the headroom
+		{8 << 30, 1 << 30, 16, 5},
+		// The number of cores limits the workers
+		{64 << 30, 1 << 30, 16, 16},
+		// At least one worker runs, even if it exceeds the budget
+		{1 << 30, 2 << 30, 16, 1},
+		// Without a measured RSS, all cores are used
+		{8 << 30, 0, 4, 4},
+	} {
+		assert.Equal(t, tc.expected, chooseNumWorkers(tc.budget, tc.rss, tc.numCores))
+	}
+}
+
+func TestCalibrationRecorder(t *testing.T) {
+	handler := &collectingHandler{}
+	recorder := &calibrationRecorder{handler: handler}
+
+	require.NoError(t, recorder.Handle(&report.Report{Metric: &report.FuzzingMetric{PeakRSSBytes: 100 << 20}}))
+	require.NoError(t, recorder.Handle(&report.Report{Metric: &report.FuzzingMetric{PeakRSSBytes: 300 << 20}}))
+	assert.Equal(t, uint64(300<<20), recorder.peakRSS())
+
+	// Slow inputs don't end the run
+	require.NoError(t, recorder.Handle(&report.Report{Finding: &finding.Finding{Type: finding.ErrorTypeWarning}}))
+	assert.False(t, recorder.crashed())
+	require.NoError(t, recorder.Handle(&report.Report{Finding: &finding.Finding{Type: finding.ErrorTypeCrash}}))
+	assert.True(t, recorder.crashed())
+
+	// The resource usage is added to that of the rest of the run
+	require.NoError(t, recorder.Handle(&report.Report{ResourceUsage: &report.ResourceUsage{UserCPUSeconds: 10, MaxRSSBytes: 300 << 20}}))
+	require.Len(t, handler.reports, 4)
+
+	usageHandler := &calibrationUsageHandler{handler: handler, usage: recorder.usage}
+	require.NoError(t, usageHandler.Handle(&report.Report{ResourceUsage: &report.ResourceUsage{UserCPUSeconds: 50, MaxRSSBytes: 200 << 20}}))
+	require.Len(t, handler.reports, 5)
+	assert.Equal(t, 60.0, handler.reports[4].ResourceUsage.UserCPUSeconds)
+	assert.Equal(t, uint64(300<<20), handler.reports[4].ResourceUsage.MaxRSSBytes)
+}
+
+func TestAvailableMemory(t *testing.T) {
+	if runtime.GOOS != "linux" {
+		t.Skip("Only implemented on Linux")
+	}
+	memory, err := availableMemory()
+	require.NoError(t, err)
+	assert.Greater(t, memory, uint64(0))
+}
@@ -0,0 +1,164 @@
+package libfuzzer
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+const (
+	// How often the inboxes of the workers are checked for new inputs
+	corpusExchangeInterval = time.Second
+	// The time after which an input which wasn't modified anymore is
+	// considered to be completely written by libFuzzer
+	corpusExchangeSettleTime = time.Second
+	// The time for which an input stays in the inbox of a worker to
+	// which it was passed on. libFuzzer reloads its first corpus
+	// directory every second by default (see -reload).
+	corpusExchangeRetention = 10 * time.Second
+)
+
+// corpusExchange passes the new inputs of each worker on to the other
+// workers. Without it, all workers would use the generated corpus as
+// their first corpus directory, which each of them reads completely
+// every time libFuzzer reloads it. Instead, each worker gets a small
+// inbox as its first corpus directory, to which libFuzzer writes the
+// inputs it finds and which it reloads. The exchange moves the inputs
+// found by a worker to the generated corpus and links them into the
+// inboxes of the other workers, from which it removes them once they
+// were reloaded.
+type corpusExchange struct {
+	corpusDir string
+	inboxes   []string
+	// The inputs which the exchange added to each inbox and when
+	imported []map[string]time.Time
+}
+
+func newCorpusExchange(corpusDir string, workers uint) (*corpusExchange, error) {
+	e := &corpusExchange{corpusDir: filepath.Clean(corpusDir)}
+	for i := uint(0); i < workers; i++ {
+		// The inboxes are created next to the generated corpus, so that
+		// inputs can be moved and linked between them
+		inbox, err := os.MkdirTemp(filepath.Dir(e.corpusDir), filepath.Base(e.corpusDir)+".worker-")
+		if err != nil {
+			e.cleanup()
+			return nil, errors.WithStack(err)
+		}
+		e.inboxes = append(e.inboxes, inbox)
+		e.imported = append(e.imported, make(map[string]time.Time))
+	}
+	return e, nil
+}
+
+// run exchanges the inputs of the workers until the context is done
+func (e *corpusExchange) run(ctx context.Context) {
+	ticker := time.NewTicker(corpusExchangeInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return
+		case now := <-ticker.C:
+			err := e.exchange(now, false)
+			if err != nil {
+				log.Debugf("Failed to exchange the corpus of the workers: %v", err)
+			}
+		}
+	}
+}
+
+// exchange passes on the inputs which the workers added to their
+// inboxes. If flush is true, all remaining inputs of the workers are
+// moved to the generated corpus and the other inputs are removed from
+// the inboxes, which must only be done once the workers exited.
+func (e *corpusExchange) exchange(now time.Time, flush bool) error {
+	for i, inbox := range e.inboxes {
+		entries, err := os.ReadDir(inbox)
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		for _, entry := range entries {
+			name := entry.Name()
+			path := filepath.Join(inbox, name)
+
+			if addedAt, ok := e.imported[i][name]; ok {
+				if flush || now.Sub(addedAt) >= corpusExchangeRetention {
+					err = os.Remove(path)
+					if err != nil && !os.IsNotExist(err) {
+						return errors.WithStack(err)
+					}
+					delete(e.imported[i], name)
+				}
+				continue
+			}
+
+			if !flush {
+				info, err := entry.Info()
+				if os.IsNotExist(err) {
+					continue
+				}
+				if err != nil {
+					return errors.WithStack(err)
+				}
+				if now.Sub(info.ModTime()) < corpusExchangeSettleTime {
+					continue
+				}
+				err = e.share(i, path, now)
+				if err != nil {
+					return err
+				}
+			}
+
+			err = os.Rename(path, filepath.Join(e.corpusDir, name))
+			if err != nil {
+				return errors.WithStack(err)
+			}
+		}
+	}
+	return nil
+}
+
+// share links the input of the given worker into the inboxes of the
+// other workers
+func (e *corpusExchange) share(worker int, path string, now time.Time) error {
+	// libFuzzer only reloads inputs which were modified after the newest
+	// input it read before
+	err := os.Chtimes(path, now, now)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	name := filepath.Base(path)
+	for j, inbox := range e.inboxes {
+		if j == worker {
+			continue
+		}
+		err = os.Link(path, filepath.Join(inbox, name))
+		if os.IsExist(err) {
+			// The other worker found the same input
+			continue
+		}
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		e.imported[j][name] = now
+	}
+	return nil
+}
+
+// cleanup moves the remaining inputs of the workers to the generated
+// corpus and removes the inboxes
+func (e *corpusExchange) cleanup() {
+	err := e.exchange(time.Now(), true)
+	if err != nil {
+		log.Warnf("Failed to move the inputs of the workers to the generated corpus: %v", err)
+	}
+	for _, inbox := range e.inboxes {
+		fileutil.Cleanup(inbox)
+	}
+}
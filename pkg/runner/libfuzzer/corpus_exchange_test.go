@@ -0,0 +1,61 @@
+package libfuzzer
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestCorpusExchange(t *testing.T) {
+	corpusDir := filepath.Join(t.TempDir(), "corpus")
+	require.NoError(t, os.Mkdir(corpusDir, 0o755))
+	exchange, err := newCorpusExchange(corpusDir, 3)
+	require.NoError(t, err)
+	defer exchange.cleanup()
+
+	now := time.Now()
+	writeInput := func(worker int, name string, modTime time.Time) {
+		path := filepath.Join(exchange.inboxes[worker], name)
+		require.NoError(t, os.WriteFile(path, []byte(name), 0o644))
+		require.NoError(t, os.Chtimes(path, modTime, modTime))
+	}
+	names := func(dir string) []string {
+		entries, err := os.ReadDir(dir)
+		require.NoError(t, err)
+		var res []string
+		for _, e := range entries {
+			res = append(res, e.Name())
+		}
+		return res
+	}
+
+	// An input which may still be written is left alone
+	writeInput(0, "found", now.Add(-2*corpusExchangeSettleTime))
+	writeInput(1, "writing", now)
+	require.NoError(t, exchange.exchange(now, false))
+
+	assert.Equal(t, []string{"found"}, names(corpusDir))
+	assert.Empty(t, names(exchange.inboxes[0]))
+	assert.Equal(t, []string{"found", "writing"}, names(exchange.inboxes[1]))
+	assert.Equal(t, []string{"found"}, names(exchange.inboxes[2]))
+
+	// Inputs which were passed on are removed after the retention time
+	later := now.Add(corpusExchangeRetention)
+	require.NoError(t, exchange.exchange(later, false))
+	assert.Equal(t, []string{"found", "writing"}, names(corpusDir))
+	assert.Empty(t, names(exchange.inboxes[1]))
+	assert.Equal(t, []string{"writing"}, names(exchange.inboxes[0]))
+	assert.Equal(t, []string{"writing"}, names(exchange.inboxes[2]))
+
+	// Flushing empties all inboxes
+	writeInput(2, "last", later)
+	require.NoError(t, exchange.exchange(later, true))
+	assert.Equal(t, []string{"found", "last", "writing"}, names(corpusDir))
+	for _, inbox := range exchange.inboxes {
+		assert.Empty(t, names(inbox))
+	}
+}
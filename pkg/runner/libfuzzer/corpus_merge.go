@@ -0,0 +1,288 @@
+package libfuzzer
+
+import (
+	"context"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"strings"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/minijail"
+	"code-intelligence.com/cifuzz/util/envutil"
+	"code-intelligence.com/cifuzz/util/executil"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+// mergeGeneratedCorpusIfLarge replaces the generated corpus with the
+// subset of its inputs which covers the same features, if it has more
+// than CorpusMergeThreshold entries. libFuzzer reads and executes every
+// corpus entry before it starts fuzzing, so this speeds up the startup
+// of all following runs. The inputs are merged by libFuzzer's -merge=1
+// mode, which names them after the SHA1 of their contents, the same way
+// libFuzzer names new corpus entries.
+//
+// Errors are only logged, because fuzzing can continue with the
+// unmerged corpus.
+func (r *Runner) mergeGeneratedCorpusIfLarge(ctx context.Context) {
+	entries, err := os.ReadDir(r.GeneratedCorpusDir)
+	if err != nil {
+		log.Debugf("Failed to read the generated corpus: %v", err)
+		return
+	}
+	if uint(len(entries)) <= r.CorpusMergeThreshold {
+		return
+	}
+
+	log.Infof("Merging the generated corpus of %d inputs", len(entries))
+	err = r.mergeGeneratedCorpus(ctx)
+	if err != nil {
+		log.Warnf("Failed to merge the generated corpus: %v", err)
+	}
+}
+
+func (r *Runner) mergeGeneratedCorpus(ctx context.Context) error {
+	// The merged corpus is created next to the generated corpus, so that
+	// it can be renamed to it
+	corpusDir := filepath.Clean(r.GeneratedCorpusDir)
+	mergedDir, err := os.MkdirTemp(filepath.Dir(corpusDir), filepath.Base(corpusDir)+".merged-")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(mergedDir)
+
+	merged, err := r.runCorpusMerge(ctx, corpusDir, mergedDir, false)
+	if err != nil {
+		return err
+	}
+
+	// Swap the directories, so that the generated corpus is never
+	// missing or incomplete
+	oldDir := mergedDir + ".old"
+	err = os.Rename(corpusDir, oldDir)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	err = os.Rename(mergedDir, corpusDir)
+	if err != nil {
+		// Restore the original corpus
+		if restoreErr := os.Rename(oldDir, corpusDir); restoreErr != nil {
+			log.Error(restoreErr)
+		}
+		return errors.WithStack(err)
+	}
+	fileutil.Cleanup(oldDir)
+
+	log.Infof("Merged the generated corpus into %d inputs", len(merged))
+	return nil
+}
+
+// startCorpusMergeScheduler merges the generated corpus every
+// CorpusMergeInterval while libFuzzer is fuzzing, so that it stays
+// small during long runs. It returns a function which stops the
+// scheduler and waits until a running merge was aborted.
+func (r *Runner) startCorpusMergeScheduler(ctx context.Context) func() {
+	ctx, cancel := context.WithCancel(ctx)
+	done := make(chan struct{})
+	go func() {
+		defer close(done)
+		// The interval is measured from the end of the previous merge,
+		// so that merges of a large corpus don't run back to back
+		timer := time.NewTimer(r.CorpusMergeInterval)
+		defer timer.Stop()
+		for {
+			select {
+			case <-ctx.Done():
+				return
+			case <-timer.C:
+			}
+			err := r.mergeGeneratedCorpusInPlace(ctx)
+			if err != nil && ctx.Err() == nil {
+				log.Warnf("Failed to merge the generated corpus: %v", err)
+			}
+			timer.Reset(r.CorpusMergeInterval)
+		}
+	}()
+	return func() {
+		cancel()
+		<-done
+	}
+}
+
+// mergeGeneratedCorpusInPlace removes the inputs from the generated
+// corpus which don't add any features. Unlike mergeGeneratedCorpus, it
+// doesn't replace the directory, because it's in use by the running
+// libFuzzer process (and bound into its sandbox). Instead, the inputs
+// selected by the merge are moved into it and the other inputs which
+// existed when the merge started are removed. Inputs which libFuzzer
+// added in the meantime are kept.
+func (r *Runner) mergeGeneratedCorpusInPlace(ctx context.Context) error {
+	corpusDir := filepath.Clean(r.GeneratedCorpusDir)
+	inputs, err := os.ReadDir(corpusDir)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	mergedDir, err := os.MkdirTemp(filepath.Dir(corpusDir), filepath.Base(corpusDir)+".merged-")
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(mergedDir)
+
+	log.Debugf("Merging the generated corpus of %d inputs", len(inputs))
+	merged, err := r.runCorpusMerge(ctx, corpusDir, mergedDir, true)
+	if err != nil {
+		return err
+	}
+
+	removed, err := replaceMergedInputs(corpusDir, mergedDir, inputs, merged)
+	if err != nil {
+		return err
+	}
+	log.Infof("Merged the generated corpus, removed %d of %d inputs", removed, len(inputs))
+	return nil
+}
+
+// replaceMergedInputs moves the merged inputs from mergedDir to
+// corpusDir and removes the inputs which existed in corpusDir before
+// the merge but weren't selected by it. It returns the number of
+// removed inputs.
+func replaceMergedInputs(corpusDir, mergedDir string, inputs, merged []os.DirEntry) (int, error) {
+	// Add the merged inputs first, so that nothing is removed if that
+	// fails. They are named after the SHA1 of their contents, so an
+	// existing file with the same name is the same input.
+	keep := make(map[string]bool, len(merged))
+	for _, e := range merged {
+		keep[e.Name()] = true
+		path := filepath.Join(corpusDir, e.Name())
+		exists, err := fileutil.Exists(path)
+		if err != nil {
+			return 0, err
+		}
+		if exists {
+			continue
+		}
+		err = os.Rename(filepath.Join(mergedDir, e.Name()), path)
+		if err != nil {
+			return 0, errors.WithStack(err)
+		}
+	}
+
+	removed := 0
+	for _, e := range inputs {
+		if e.IsDir() || keep[e.Name()] {
+			continue
+		}
+		err := os.Remove(filepath.Join(corpusDir, e.Name()))
+		if err != nil && !os.IsNotExist(err) {
+			return removed, errors.WithStack(err)
+		}
+		removed++
+	}
+	return removed, nil
+}
+
+// runCorpusMerge runs libFuzzer's -merge=1 mode to add the inputs of
+// corpusDir which add new features to mergedDir and returns the merged
+// inputs. If lowPriority is true, the merge is run with the lowest CPU
+// priority, so that it doesn't slow down fuzzing.
+func (r *Runner) runCorpusMerge(ctx context.Context, corpusDir, mergedDir string, lowPriority bool) ([]os.DirEntry, error) {
+	outputDir, err := os.MkdirTemp("", "libfuzzer-out-")
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	defer fileutil.Cleanup(outputDir)
+
+	// libFuzzer creates a control file in which it tracks the progress
+	// of the merge. Its default location is the temp dir, where it's
+	// left behind if the merge is killed, so we create it in the output
+	// directory, which is always removed.
+	controlFile := filepath.Join(outputDir, "merge_control_file")
+	args := []string{
+		r.FuzzTarget,
+		"-merge=1",
+		"-merge_control_file=" + controlFile,
+		"-artifact_prefix=" + outputDir + "/",
+		mergedDir,
+		corpusDir,
+	}
+	if len(r.FuzzTestArgs) > 0 {
+		args = append(args, "--")
+		args = append(args, r.FuzzTestArgs...)
+	}
+
+	env, err := r.FuzzerEnvironment()
+	if err != nil {
+		return nil, err
+	}
+
+	if r.UseMinijail {
+		bindings := []*minijail.Binding{
+			{Source: r.FuzzTarget},
+			{Source: corpusDir},
+			{Source: mergedDir, Writable: minijail.ReadWrite},
+		}
+		for _, dir := range r.ReadOnlyBindings {
+			bindings = append(bindings, &minijail.Binding{Source: dir})
+		}
+		mj, err := minijail.NewMinijail(&minijail.Options{
+			Args:      args,
+			Bindings:  bindings,
+			OutputDir: outputDir,
+		})
+		if err != nil {
+			return nil, err
+		}
+		defer mj.Cleanup()
+		args = mj.Args
+	}
+
+	if lowPriority {
+		args = lowPriorityArgs(args)
+	}
+
+	cmd := executil.CommandContext(ctx, args[0], args[1:]...)
+	cmd.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return nil, err
+	}
+	log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(cmd.Args, env))
+	out, err := cmd.CombinedOutput()
+	if err != nil {
+		return nil, errors.Errorf("%v\n%s", err, lastLines(string(out), 20))
+	}
+
+	merged, err := os.ReadDir(mergedDir)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	if len(merged) == 0 {
+		// An empty result means that the fuzz test doesn't report
+		// coverage, so keep the corpus as it is
+		return nil, errors.New("The merged corpus is empty")
+	}
+	return merged, nil
+}
+
+// lowPriorityArgs prefixes the command with nice, if it's available.
+// The priority is inherited by all child processes, i.e. by the
+// sandbox and the processes which libFuzzer runs the merge in.
+func lowPriorityArgs(args []string) []string {
+	nice, err := exec.LookPath("nice")
+	if err != nil {
+		log.Debugf("Running the corpus merge with normal priority: %v", err)
+		return args
+	}
+	return append([]string{nice, "-n", "19"}, args...)
+}
+
+func lastLines(s string, n int) string {
+	lines := strings.Split(strings.TrimRight(s, "\n"), "\n")
+	if len(lines) > n {
+		lines = lines[len(lines)-n:]
+	}
+	return strings.Join(lines, "\n")
+}
@@ -0,0 +1,44 @@
+package libfuzzer
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestReplaceMergedInputs(t *testing.T) {
+	corpusDir := t.TempDir()
+	mergedDir := t.TempDir()
+	writeFiles := func(dir string, names ...string) {
+		for _, name := range names {
+			require.NoError(t, os.WriteFile(filepath.Join(dir, name), []byte(name), 0o644))
+		}
+	}
+
+	writeFiles(corpusDir, "kept", "redundant", "seed")
+	inputs, err := os.ReadDir(corpusDir)
+	require.NoError(t, err)
+
+	// The merge renamed "seed" after its SHA1 and dropped "redundant"
+	writeFiles(mergedDir, "kept", "seed-sha1")
+	merged, err := os.ReadDir(mergedDir)
+	require.NoError(t, err)
+
+	// An input which libFuzzer added during the merge
+	writeFiles(corpusDir, "new")
+
+	removed, err := replaceMergedInputs(corpusDir, mergedDir, inputs, merged)
+	require.NoError(t, err)
+	assert.Equal(t, 2, removed)
+
+	entries, err := os.ReadDir(corpusDir)
+	require.NoError(t, err)
+	var names []string
+	for _, e := range entries {
+		names = append(names, e.Name())
+	}
+	assert.Equal(t, []string{"kept", "new", "seed-sha1"}, names)
+}
@@ -0,0 +1,296 @@
+package libfuzzer
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"debug/elf"
+	"debug/macho"
+	"debug/pe"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+const (
+	// The maximum number of entries of an automatic dictionary. More
+	// entries make libFuzzer pick each of them less often.
+	maxAutoDictionaryEntries = 1000
+	// The length limits of the entries of an automatic dictionary.
+	// libFuzzer ignores entries longer than 64 bytes.
+	minAutoDictionaryEntryLen = 3
+	maxAutoDictionaryEntryLen = 64
+)
+
+// prepareAutoDictionary sets the Dictionary to the tokens extracted
+// from the fuzz target, appended to the user-specified Dictionary, if
+// any. The tokens are cached per build of the fuzz target. The returned
+// function removes the files created for this run only.
+func (r *Runner) prepareAutoDictionary() (func(), error) {
+	autoDict, err := r.autoDictionary()
+	if err != nil {
+		// The dictionary is best-effort, e.g. the fuzz target could be
+		// a script which runs the actual binary
+		log.Warnf("Failed to extract a dictionary from %s: %v", r.FuzzTarget, err)
+		return func() {}, nil
+	}
+
+	// The options are changed below for the rest of the run, which
+	// must not affect the caller
+	runOpts := *r.RunnerOptions
+	r.RunnerOptions = &runOpts
+	r.AutoDictionary = false
+
+	if r.Dictionary == "" {
+		r.Dictionary = autoDict
+		return func() {}, nil
+	}
+
+	// libFuzzer only accepts a single dictionary
+	merged, err := os.CreateTemp("", "libfuzzer-dict-")
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	cleanup := func() { fileutil.Cleanup(merged.Name()) }
+	for _, path := range []string{r.Dictionary, autoDict} {
+		err = appendFile(merged, path)
+		if err != nil {
+			merged.Close()
+			cleanup()
+			return nil, err
+		}
+	}
+	err = merged.Close()
+	if err != nil {
+		cleanup()
+		return nil, errors.WithStack(err)
+	}
+	r.Dictionary = merged.Name()
+	return cleanup, nil
+}
+
+func appendFile(w io.Writer, path string) error {
+	content, err := os.ReadFile(path)
+	if err != nil {
+		return errors.WithStack(err)
+	}
+	if len(content) > 0 && content[len(content)-1] != '\n' {
+		content = append(content, '\n')
+	}
+	_, err = w.Write(content)
+	return errors.WithStack(err)
+}
+
+// autoDictionary returns the path of the dictionary extracted from the
+// fuzz target, which is only extracted if the fuzz target changed since
+// the last run.
+func (r *Runner) autoDictionary() (string, error) {
+	hash, err := fileHash(r.FuzzTarget)
+	if err != nil {
+		return "", err
+	}
+	baseDir := filepath.Join(os.TempDir(), "cifuzz-dictionaries")
+	if r.ProjectDir != "" {
+		baseDir = filepath.Join(r.ProjectDir, ".cifuzz-build", "dictionaries")
+	}
+	path := filepath.Join(baseDir, fmt.Sprintf("%s-%x.dict", filepath.Base(r.FuzzTarget), hash[:8]))
+	exists, err := fileutil.Exists(path)
+	if err != nil || exists {
+		return path, err
+	}
+
+	tokens, err := extractDictionaryTokens(r.FuzzTarget)
+	if err != nil {
+		return "", err
+	}
+	log.Debugf("Extracted %d dictionary entries from %s to %s", len(tokens), r.FuzzTarget, path)
+
+	err = os.MkdirAll(baseDir, 0o755)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	// Write to a temporary file first, so that concurrent runs never
+	// read a partial dictionary
+	tmpFile, err := os.CreateTemp(baseDir, filepath.Base(path)+".tmp-")
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	_, err = tmpFile.WriteString(formatDictionary(tokens))
+	closeErr := tmpFile.Close()
+	if err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(tmpFile.Name(), path)
+	}
+	if err != nil {
+		fileutil.Cleanup(tmpFile.Name())
+		return "", errors.WithStack(err)
+	}
+	return path, nil
+}
+
+func fileHash(path string) ([]byte, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	defer f.Close()
+	h := sha256.New()
+	_, err = io.Copy(h, f)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return h.Sum(nil), nil
+}
+
+// extractDictionaryTokens returns the NUL-terminated strings in the
+// read-only data of the binary which look like tokens of an input
+// format, e.g. magic numbers and keywords the fuzz test compares the
+// input with, ranked by how likely that is.
+func extractDictionaryTokens(binary string) ([]string, error) {
+	sections, err := readOnlyData(binary)
+	if err != nil {
+		return nil, err
+	}
+	counts := make(map[string]int)
+	for _, data := range sections {
+		for _, s := range bytes.Split(data, []byte{0}) {
+			if isDictionaryToken(s) {
+				counts[string(s)]++
+			}
+		}
+	}
+	return rankDictionaryTokens(counts, maxAutoDictionaryEntries), nil
+}
+
+// readOnlyData returns the contents of the sections of the binary which
+// hold the string literals.
+func readOnlyData(binary string) ([][]byte, error) {
+	var sections [][]byte
+	if f, err := elf.Open(binary); err == nil {
+		defer f.Close()
+		for _, s := range f.Sections {
+			if s.Type == elf.SHT_PROGBITS && (s.Name == ".rodata" || strings.HasPrefix(s.Name, ".rodata.")) {
+				data, err := s.Data()
+				if err != nil {
+					return nil, errors.WithStack(err)
+				}
+				sections = append(sections, data)
+			}
+		}
+		return sections, nil
+	}
+	if f, err := macho.Open(binary); err == nil {
+		defer f.Close()
+		for _, s := range f.Sections {
+			if s.Seg == "__TEXT" && (s.Name == "__cstring" || s.Name == "__const") {
+				data, err := s.Data()
+				if err != nil {
+					return nil, errors.WithStack(err)
+				}
+				sections = append(sections, data)
+			}
+		}
+		return sections, nil
+	}
+	if f, err := pe.Open(binary); err == nil {
+		defer f.Close()
+		for _, s := range f.Sections {
+			if s.Name == ".rdata" {
+				data, err := s.Data()
+				if err != nil {
+					return nil, errors.WithStack(err)
+				}
+				sections = append(sections, data)
+			}
+		}
+		return sections, nil
+	}
+	return nil, errors.Errorf("%s is not an ELF, Mach-O or PE file", binary)
+}
+
+// isDictionaryToken returns whether s could be a token of an input
+// format. Strings with spaces are mostly messages, strings with % are
+// format strings.
+func isDictionaryToken(s []byte) bool {
+	if len(s) < minAutoDictionaryEntryLen || len(s) > maxAutoDictionaryEntryLen {
+		return false
+	}
+	for _, c := range s {
+		if c <= ' ' || c > '~' || c == '%' {
+			return false
+		}
+	}
+	// The runtimes of the sanitizers are linked into the fuzz test
+	lower := strings.ToLower(string(s))
+	for _, runtime := range []string{"sanitizer", "asan", "ubsan", "lsan", "msan", "fuzzer"} {
+		if strings.Contains(lower, runtime) {
+			return false
+		}
+	}
+	return true
+}
+
+// rankDictionaryTokens returns at most max of the tokens, starting with
+// those with upper case letters, digits or punctuation, which are
+// typical of magic numbers and other format tokens, and ending with
+// those with underscores, which are typical of the names of functions
+// and runtime flags. Tokens in the same class are ranked by how often
+// they occur and then by their length.
+func rankDictionaryTokens(counts map[string]int, max int) []string {
+	class := func(token string) int {
+		if strings.Contains(token, "_") {
+			return 2
+		}
+		if strings.Trim(token, "abcdefghijklmnopqrstuvwxyz") == "" {
+			return 1
+		}
+		return 0
+	}
+	tokens := make([]string, 0, len(counts))
+	for token := range counts {
+		tokens = append(tokens, token)
+	}
+	sort.Slice(tokens, func(i, j int) bool {
+		a, b := tokens[i], tokens[j]
+		if class(a) != class(b) {
+			return class(a) < class(b)
+		}
+		if counts[a] != counts[b] {
+			return counts[a] > counts[b]
+		}
+		if len(a) != len(b) {
+			return len(a) < len(b)
+		}
+		return a < b
+	})
+	if len(tokens) > max {
+		tokens = tokens[:max]
+	}
+	return tokens
+}
+
+// formatDictionary returns the tokens in the format of libFuzzer and
+// AFL dictionaries.
+func formatDictionary(tokens []string) string {
+	var b strings.Builder
+	for _, token := range tokens {
+		b.WriteByte('"')
+		for i := 0; i < len(token); i++ {
+			if token[i] == '"' || token[i] == '\\' {
+				b.WriteByte('\\')
+			}
+			b.WriteByte(token[i])
+		}
+		b.WriteString("\"\n")
+	}
+	return b.String()
+}
@@ -0,0 +1,80 @@
+package libfuzzer
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestIsDictionaryToken(t *testing.T) {
+	for token, expected := range map[string]bool{
+		"HTTP/1.1":         true,
+		"<?xml":            true,
+		"while":            true,
+		"GE":               false,
+		"failed to parse":  false,
+		"%s: %d":           false,
+		"AddressSanitizer": false,
+		"detect_leaks\xff": false,
+	} {
+		assert.Equal(t, expected, isDictionaryToken([]byte(token)), token)
+	}
+}
+
+func TestRankDictionaryTokens(t *testing.T) {
+	counts := map[string]int{
+		"halt_on_error": 5,
+		"while":         3,
+		"IHDR":          1,
+		"PNG":           1,
+		"<?xml":         2,
+	}
+	assert.Equal(t, []string{"<?xml", "PNG", "IHDR", "while", "halt_on_error"}, rankDictionaryTokens(counts, 10))
+	assert.Equal(t, []string{"<?xml", "PNG"}, rankDictionaryTokens(counts, 2))
+}
+
+func TestFormatDictionary(t *testing.T) {
+	assert.Equal(t, "\"GET\"\n\"a\\\"b\\\\c\"\n", formatDictionary([]string{"GET", `a"b\c`}))
+}
+
+func TestPrepareAutoDictionary(t *testing.T) {
+	// The test binary itself is the fuzz target
+	fuzzTarget, err := os.Executable()
+	require.NoError(t, err)
+	projectDir := t.TempDir()
+	userDict := filepath.Join(projectDir, "user.dict")
+	err = os.WriteFile(userDict, []byte(`"user"`), 0o644)
+	require.NoError(t, err)
+
+	opts := &RunnerOptions{AutoDictionary: true, Dictionary: userDict, FuzzTarget: fuzzTarget, ProjectDir: projectDir}
+	r := NewRunner(opts)
+	cleanup, err := r.prepareAutoDictionary()
+	require.NoError(t, err)
+	defer cleanup()
+
+	// The options of the caller are unchanged
+	assert.True(t, opts.AutoDictionary)
+	assert.Equal(t, userDict, opts.Dictionary)
+	assert.False(t, r.AutoDictionary)
+
+	cached, err := filepath.Glob(filepath.Join(projectDir, ".cifuzz-build", "dictionaries", filepath.Base(fuzzTarget)+"-*.dict"))
+	require.NoError(t, err)
+	require.Len(t, cached, 1)
+	autoDict, err := os.ReadFile(cached[0])
+	require.NoError(t, err)
+	merged, err := os.ReadFile(r.Dictionary)
+	require.NoError(t, err)
+	assert.Equal(t, "\"user\"\n"+string(autoDict), string(merged))
+
+	// The dictionary is only extracted once per build of the fuzz target
+	err = os.WriteFile(cached[0], []byte(`"cached"`+"\n"), 0o644)
+	require.NoError(t, err)
+	r = NewRunner(&RunnerOptions{AutoDictionary: true, FuzzTarget: fuzzTarget, ProjectDir: projectDir})
+	cleanup, err = r.prepareAutoDictionary()
+	require.NoError(t, err)
+	defer cleanup()
+	assert.Equal(t, cached[0], r.Dictionary)
+}
@@ -0,0 +1,95 @@
+package libfuzzer
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"runtime"
+	"time"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/inputring"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/util/envutil"
+)
+
+// enableInputRing makes the fuzz test write its last inputs to a ring
+// in the output directory, if it was linked against src/inputring.c,
+// so that they can be recovered if it's killed, see recoverInputs.
+func (r *Runner) enableInputRing(env []string, outputDir string) ([]string, error) {
+	if runtime.GOOS != "linux" || r.SupportJazzer {
+		return env, nil
+	}
+	r.inputRing = filepath.Join(outputDir, "input-ring")
+	return envutil.Setenv(env, inputring.EnvVar, r.inputRing)
+}
+
+// recoverInputs saves the inputs in the ring of the exited fuzz test to
+// the .cifuzz-build directory of the project and logs a warning, if
+// there are any. It's called when libFuzzer exited without reporting a
+// finding, in which case the input which was being executed would be
+// lost otherwise, e.g. when the OOM killer killed the fuzz test.
+func (r *Runner) recoverInputs(reason string) {
+	if r.inputRing == "" {
+		return
+	}
+	inputs, err := inputring.Read(r.inputRing)
+	if err != nil {
+		log.Warnf("Failed to recover the last inputs of the fuzz test: %v", err)
+		return
+	}
+	if len(inputs) == 0 {
+		return
+	}
+
+	dir, err := r.saveRecoveredInputs(inputs)
+	if err != nil {
+		log.Warnf("Failed to save the last inputs of the fuzz test: %v", err)
+		return
+	}
+	running := inputs[len(inputs)-1]
+	if running.Running {
+		log.Warnf("%s while it executed the input %s. The last %d inputs were saved to %s",
+			reason, recoveredInputName(running), len(inputs), dir)
+	} else {
+		log.Warnf("%s. The last %d inputs were saved to %s", reason, len(inputs), dir)
+	}
+}
+
+func (r *Runner) saveRecoveredInputs(inputs []*inputring.Input) (string, error) {
+	baseDir := os.TempDir()
+	if r.ProjectDir != "" {
+		baseDir = filepath.Join(r.ProjectDir, ".cifuzz-build", "recovered-inputs")
+	}
+	err := os.MkdirAll(baseDir, 0o755)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	prefix := fmt.Sprintf("%s-%s-", filepath.Base(r.FuzzTarget), time.Now().Format("20060102-150405"))
+	dir, err := os.MkdirTemp(baseDir, prefix)
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	for _, input := range inputs {
+		if input.Truncated() {
+			log.Debugf("Recovered input %d was truncated from %d to %d bytes", input.Seq, input.Size, len(input.Data))
+		}
+		err = os.WriteFile(filepath.Join(dir, recoveredInputName(input)), input.Data, 0o644)
+		if err != nil {
+			return "", errors.WithStack(err)
+		}
+	}
+	return dir, nil
+}
+
+// recoveredInputName returns the file name of a recovered input, which
+// sorts in the order in which the inputs were executed and marks the
+// input which was running when the fuzz test exited.
+func recoveredInputName(input *inputring.Input) string {
+	name := fmt.Sprintf("input-%010d", input.Seq)
+	if input.Running {
+		name += "-running"
+	}
+	return name
+}
@@ -0,0 +1,32 @@
+package libfuzzer
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/inputring"
+)
+
+func TestSaveRecoveredInputs(t *testing.T) {
+	projectDir := t.TempDir()
+	r := NewRunner(&RunnerOptions{ProjectDir: projectDir, FuzzTarget: "/build/my_fuzz_test"})
+
+	dir, err := r.saveRecoveredInputs([]*inputring.Input{
+		{Seq: 9, Data: []byte("done"), Size: 4},
+		{Seq: 10, Data: []byte("running"), Size: 7, Running: true},
+	})
+	require.NoError(t, err)
+	assert.Equal(t, filepath.Join(projectDir, ".cifuzz-build", "recovered-inputs"), filepath.Dir(dir))
+	assert.Contains(t, filepath.Base(dir), "my_fuzz_test-")
+
+	content, err := os.ReadFile(filepath.Join(dir, "input-0000000009"))
+	require.NoError(t, err)
+	assert.Equal(t, []byte("done"), content)
+	content, err = os.ReadFile(filepath.Join(dir, "input-0000000010-running"))
+	require.NoError(t, err)
+	assert.Equal(t, []byte("running"), content)
+}
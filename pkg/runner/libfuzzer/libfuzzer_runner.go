@@ -3,12 +3,16 @@ package libfuzzer
 import (
 	"bytes"
 	"context"
+	"fmt"
 	"io"
 	"os"
 	"os/exec"
 	"path/filepath"
+	"regexp"
 	"runtime"
 	"strconv"
+	"strings"
+	"sync"
 	"time"
 
 	"github.com/pkg/errors"
@@ -20,6 +24,7 @@ import (
 	libfuzzer_parser "code-intelligence.com/cifuzz/pkg/parser/libfuzzer"
 	"code-intelligence.com/cifuzz/pkg/report"
 	fuzzer_runner "code-intelligence.com/cifuzz/pkg/runner"
+	"code-intelligence.com/cifuzz/pkg/symbolizer"
 	"code-intelligence.com/cifuzz/util/envutil"
 	"code-intelligence.com/cifuzz/util/executil"
 	"code-intelligence.com/cifuzz/util/fileutil"
@@ -36,7 +41,39 @@ const (
 	ExitGracePeriod = time.Second * 5
 )
 
+var tmpfsSizePattern = regexp.MustCompile(`^[0-9]+[kKmMgG%]?$`)
+
 type RunnerOptions struct {
+	// AutoDictionary makes the runner pass the strings in the read-only
+	// data of the FuzzTarget which look like tokens of an input format
+	// to libFuzzer as a dictionary, in addition to the Dictionary.
+	AutoDictionary bool
+	// AutoWorkers makes the runner choose the number of Workers from
+	// the peak RSS of a single libFuzzer process, which is measured in
+	// a short calibration run, so that they fit into the
+	// WorkersMemoryBudget.
+	AutoWorkers bool
+	// CorpusMergeThreshold is the number of entries of the
+	// GeneratedCorpusDir above which it is merged before fuzzing, so
+	// that libFuzzer starts faster. Zero means never.
+	CorpusMergeThreshold uint
+	// CorpusMergeInterval is the time after which the GeneratedCorpusDir
+	// is merged again while fuzzing, with a low CPU priority. Zero means
+	// never.
+	CorpusMergeInterval time.Duration
+	// CorpusTmpfsSize is the size limit of a tmpfs in the sandbox to
+	// which libFuzzer writes new corpus entries instead of the
+	// GeneratedCorpusDir, which they are moved to periodically.
+	CorpusTmpfsSize string
+
+	// DeferSymbolization disables the symbolization of stack traces by
+	// the sanitizers, which starts llvm-symbolizer in every crashing
+	// process and is slow for large fuzz tests. Instead, the stack
+	// traces of findings are symbolized before they are reported, with
+	// one llvm-symbolizer process per stack trace and every address of
+	// the run only once.
+	DeferSymbolization bool
+
 	Dictionary         string
 	EngineArgs         []string
 	EnvVars            []string
@@ -46,13 +83,40 @@ type RunnerOptions struct {
 	KeepColor          bool
 	LibraryDirs        []string
 	LogOutput          io.Writer
-	ProjectDir         string
-	ReadOnlyBindings   []string
-	ReportHandler      report.Handler
-	SeedCorpusDirs     []string
-	Timeout            time.Duration
-	UseMinijail        bool
-	Verbose            bool
+	// PlateauTimeout stops fuzzing like when the Timeout is reached,
+	// once fewer than PlateauMinNewFeatures new features were found
+	// within this time. Zero means never.
+	PlateauTimeout time.Duration
+	// PlateauMinNewFeatures is the number of new features which must be
+	// found within the PlateauTimeout to keep fuzzing. Zero means one,
+	// so that fuzzing stops once no new features are found anymore.
+	PlateauMinNewFeatures uint
+	ProjectDir            string
+	ReadOnlyBindings      []string
+	// ReplayFirst are inputs, usually those of recent findings, which
+	// are run before fuzzing starts. If one of them still crashes, its
+	// finding is reported instead of fuzzing.
+	ReplayFirst   []string
+	ReportHandler report.Handler
+	// SanitizerProfile selects the options of the sanitizers, see
+	// SanitizerProfiles. Empty means SanitizerProfileTriage.
+	SanitizerProfile string
+	// SandboxResources are the resource limits of the sandbox. The
+	// resources used by it are added to the reported metrics.
+	SandboxResources *minijail.Resources
+	SeedCorpusDirs   []string
+	Timeout          time.Duration
+	UseMinijail      bool
+	Verbose          bool
+	// Workers is the number of libFuzzer processes which fuzz in
+	// parallel and share the generated corpus. Their metrics are merged
+	// and duplicate findings are dropped. Zero or one means a single
+	// process.
+	Workers uint
+	// WorkersMemoryBudget is the memory in bytes which the workers may
+	// use together if AutoWorkers is set. Zero means the memory which
+	// is currently available.
+	WorkersMemoryBudget uint64
 }
 
 func (options *RunnerOptions) ValidateOptions() error {
@@ -74,6 +138,34 @@ func (options *RunnerOptions) ValidateOptions() error {
 		}
 	}
 
+	if options.CorpusTmpfsSize != "" {
+		if !options.UseMinijail {
+			return errors.New("A corpus tmpfs is only supported in the sandbox")
+		}
+		if !tmpfsSizePattern.MatchString(options.CorpusTmpfsSize) {
+			return errors.Errorf("Invalid tmpfs size %q, expected e.g. \"512m\" or \"10%%\"", options.CorpusTmpfsSize)
+		}
+	}
+
+	err := ValidateSanitizerProfile(options.SanitizerProfile)
+	if err != nil {
+		return err
+	}
+
+	if options.SandboxResources != nil && !options.UseMinijail {
+		return errors.New("Resource limits are only supported in the sandbox")
+	}
+
+	if options.Workers > 1 {
+		for _, arg := range options.EngineArgs {
+			for _, flag := range []string{"-fork=", "-jobs=", "-workers="} {
+				if strings.HasPrefix(arg, flag) {
+					return errors.Errorf("The libFuzzer flag %s can't be used with multiple workers", strings.TrimSuffix(flag, "="))
+				}
+			}
+		}
+	}
+
 	if options.LogOutput == nil {
 		options.LogOutput = os.Stderr
 	}
@@ -87,6 +179,25 @@ type Runner struct {
 
 	started chan struct{}
 	cmd     *executil.Cmd
+	// The cgroup of the sandbox, if SandboxResources are set
+	cgroup *minijail.Cgroup
+	// The runners of the libFuzzer processes, if Workers is more than one
+	workers      []*Runner
+	workersMutex sync.Mutex
+	// The inbox of this worker in the corpus exchange of its parent, if
+	// any, see corpusExchange
+	corpusInbox string
+	// The symbolizer of the stack traces of findings, if
+	// DeferSymbolization is set. It's shared with the workers.
+	symbolizer *symbolizer.Symbolizer
+	// Whether the symbolizer was created by this runner, which closes it
+	ownsSymbolizer bool
+	// The resources used by the libFuzzer process, which are known
+	// once it exited
+	resourceUsage *report.ResourceUsage
+	// The path of the ring of the last inputs of the fuzz test, if
+	// enabled, see enableInputRing
+	inputRing string
 }
 
 func NewRunner(options *RunnerOptions) *Runner {
@@ -103,6 +214,45 @@ func (r *Runner) Run(ctx context.Context) error {
 		return err
 	}
 
+	err = r.initSymbolizer()
+	if err != nil {
+		return err
+	}
+	defer r.CloseSymbolizer()
+
+	finished, err := r.replayFirst(ctx)
+	if err != nil || finished {
+		return err
+	}
+
+	if r.CorpusMergeThreshold > 0 {
+		r.mergeGeneratedCorpusIfLarge(ctx)
+	}
+
+	if r.CorpusMergeInterval > 0 {
+		stopCorpusMerges := r.startCorpusMergeScheduler(ctx)
+		defer stopCorpusMerges()
+	}
+
+	if r.AutoDictionary {
+		cleanup, err := r.prepareAutoDictionary()
+		if err != nil {
+			return err
+		}
+		defer cleanup()
+	}
+
+	if r.AutoWorkers {
+		finished, err := r.calibrateWorkers(ctx)
+		if err != nil || finished {
+			return err
+		}
+	}
+
+	if r.Workers > 1 {
+		return r.runWorkers(ctx)
+	}
+
 	args := []string{r.FuzzTarget}
 
 	// Tell libfuzzer to exit after the timeout
@@ -114,10 +264,27 @@ func (r *Runner) Run(ctx context.Context) error {
 		args = append(args, "-dict="+r.Dictionary)
 	}
 
-	// Add user-specified libfuzzer options
+	// Add user-specified libfuzzer options, which can override those of
+	// the sanitizer profile
+	if r.SanitizerProfile == SanitizerProfileThroughput {
+		args = append(args, throughputLibfuzzerArgs...)
+	}
 	args = append(args, r.EngineArgs...)
 
-	// Tell libfuzzer which corpus directory it should use
+	// Tell libfuzzer which corpus directory it should use. With a
+	// corpus tmpfs, libfuzzer writes new inputs to the tmpfs and only
+	// reads the generated corpus.
+	var liveCorpusDir string
+	if r.CorpusTmpfsSize != "" {
+		liveCorpusDir, err = os.MkdirTemp("", "libfuzzer-corpus-")
+		if err != nil {
+			return errors.WithStack(err)
+		}
+		defer fileutil.Cleanup(liveCorpusDir)
+		args = append(args, liveCorpusDir)
+	} else if r.corpusInbox != "" {
+		args = append(args, r.corpusInbox)
+	}
 	args = append(args, r.GeneratedCorpusDir)
 
 	// Add any seed corpus directories as further positional arguments
@@ -145,6 +312,10 @@ func (r *Runner) Run(ctx context.Context) error {
 	if err != nil {
 		return err
 	}
+	env, err = r.enableInputRing(env, outputDir)
+	if err != nil {
+		return err
+	}
 
 	if r.UseMinijail {
 		libfuzzerArgs := args
@@ -156,6 +327,12 @@ func (r *Runner) Run(ctx context.Context) error {
 			// libfuzzer writes new test inputs to it
 			{Source: r.GeneratedCorpusDir, Writable: minijail.ReadWrite},
 		}
+		if r.corpusInbox != "" {
+			bindings = append(bindings, &minijail.Binding{Source: r.corpusInbox, Writable: minijail.ReadWrite})
+		}
+		if r.Dictionary != "" {
+			bindings = append(bindings, &minijail.Binding{Source: r.Dictionary})
+		}
 
 		for _, dir := range r.ReadOnlyBindings {
 			bindings = append(bindings, &minijail.Binding{Source: dir})
@@ -165,16 +342,28 @@ func (r *Runner) Run(ctx context.Context) error {
 			bindings = append(bindings, &minijail.Binding{Source: dir})
 		}
 
+		var writeBackDirs []*minijail.WriteBackDir
+		if liveCorpusDir != "" {
+			writeBackDirs = append(writeBackDirs, &minijail.WriteBackDir{
+				Dir:  r.GeneratedCorpusDir,
+				Path: liveCorpusDir,
+				Size: r.CorpusTmpfsSize,
+			})
+		}
+
 		// Set up Minijail
 		mj, err := minijail.NewMinijail(&minijail.Options{
-			Args:      libfuzzerArgs,
-			Bindings:  bindings,
-			OutputDir: outputDir,
+			Args:          libfuzzerArgs,
+			Bindings:      bindings,
+			OutputDir:     outputDir,
+			WriteBackDirs: writeBackDirs,
+			Resources:     r.SandboxResources,
 		})
 		if err != nil {
 			return err
 		}
 		defer mj.Cleanup()
+		r.cgroup = mj.Cgroup
 
 		// Use the command which runs libfuzzer via minijail
 		args = mj.Args
@@ -202,6 +391,16 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 		cmdCtx, cancelCmdCtx = context.WithCancel(ctx)
 	}
 	defer cancelCmdCtx()
+
+	var handler report.Handler = r.ReportHandler
+	if r.PlateauTimeout > 0 {
+		// Cancelling the command context terminates libfuzzer like when
+		// the timeout is reached, which is not an error
+		detector := newPlateauDetector(handler, r.PlateauTimeout, r.PlateauMinNewFeatures)
+		handler = detector
+		go detector.watch(cmdCtx, cancelCmdCtx)
+	}
+
 	r.cmd = executil.CommandContext(cmdCtx, args[0], args[1:]...)
 	r.cmd.Env, err = envutil.Copy(os.Environ(), env)
 	if err != nil {
@@ -252,20 +451,19 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 	}
 	r.started <- struct{}{}
 
+	// The parser leaves out the output of minijail itself, so the
+	// startup output doesn't have to be filtered again
 	var startupOutput bytes.Buffer
-	var startupOutputWriter io.Writer
-	if r.UseMinijail {
-		startupOutputWriter = minijail.NewOutputFilter(&startupOutput)
-	} else {
-		startupOutputWriter = &startupOutput
-	}
 	reporter := libfuzzer_parser.NewLibfuzzerOutputParser(&libfuzzer_parser.Options{
 		SupportJazzer:       r.SupportJazzer,
 		KeepColor:           r.KeepColor,
-		StartupOutputWriter: startupOutputWriter,
+		StartupOutputWriter: &startupOutput,
 		ProjectDir:          r.ProjectDir,
 	})
-	reportsCh := make(chan *report.Report, MaxBufferedReports)
+	parsedReportsCh := make(chan *report.Report, MaxBufferedReports)
+	reportsCh := make(chan *report.Report)
+	senderDone := make(chan struct{})
+	go coalesceReports(parsedReportsCh, reportsCh, senderDone)
 
 	// Start a go routine which waits for the command to exit and
 	// continuously parses the output
@@ -281,7 +479,7 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 
 		// Wait until the reporter has finished parsing stderr, so that
 		// we can check below whether the reporter has found something
-		err := reporter.Parse(routinesCtx, stderrPipe, reportsCh)
+		err := reporter.Parse(routinesCtx, stderrPipe, parsedReportsCh)
 		if err != nil {
 			return err
 		}
@@ -294,9 +492,15 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 
 		select {
 		case err := <-waitErrCh:
+			r.resourceUsage = r.collectResourceUsage()
+
 			if r.cmd.TerminatedAfterContextDone() {
 				// The command was terminated because the timeout exceeded. We
-				// don't return an error in that case.
+				// don't return an error in that case. If libFuzzer didn't
+				// exit on its own, an input probably hangs.
+				if ctx.Err() == nil && errors.Is(cmdCtx.Err(), context.DeadlineExceeded) {
+					r.recoverInputs(fmt.Sprintf("libFuzzer didn't exit within %s after the timeout", ExitGracePeriod))
+				}
 				return nil
 			}
 
@@ -307,6 +511,7 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 			}
 
 			if !IsExpectedExitError(err) {
+				r.recoverInputs(fmt.Sprintf("The fuzz test exited unexpectedly (%s)", exitErr))
 				// Print the stderr output of the fuzzer up to the point where
 				// it has been successfully initialized to provide users with
 				// the context of this abnormal exit even without verbose mode.
@@ -317,6 +522,7 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 			}
 
 			if !reporter.FindingReported {
+				r.recoverInputs(fmt.Sprintf("libFuzzer exited with exit code %d but no finding was reported", exitErr.ExitCode()))
 				return errors.WithMessagef(err, "libFuzzer exited with expected exit code %d but no finding was reported", exitErr.ExitCode())
 			}
 
@@ -329,15 +535,23 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 	})
 
 	// Continuously send reports from the reports channel to the
-	// receiver. By doing this in a separate go routine and using a
-	// buffered reports channel, this allows the LibfuzzerOutputParser
-	// function above to not block when creating a report (as long as
-	// the buffer is not full).
+	// receiver. By doing this in a separate go routine and coalescing
+	// the metrics which the receiver didn't handle yet, this allows the
+	// LibfuzzerOutputParser function above to not block when creating
+	// a report, even if the receiver is slow.
 	routines.Go(func() error {
 		senderErrCh := make(chan error, 1)
 
 		go func() {
-			senderErrCh <- sendReports(r.ReportHandler, reportsCh)
+			defer close(senderDone)
+			handler := handler
+			if r.symbolizer != nil {
+				handler = &symbolizingHandler{ctx: ctx, runner: r, handler: handler}
+			}
+			if r.SanitizerProfile == SanitizerProfileThroughput {
+				handler = &triagingHandler{ctx: ctx, runner: r, handler: handler}
+			}
+			senderErrCh <- sendReports(handler, reportsCh, r.cgroup)
 		}()
 
 		select {
@@ -356,10 +570,51 @@ func (r *Runner) RunLibfuzzerAndReport(ctx context.Context, args []string, env [
 		}
 	})
 
-	return errors.WithStack(routines.Wait())
+	err = routines.Wait()
+	if err != nil {
+		return errors.WithStack(err)
+	}
+
+	// The resource usage is passed on in a final report, after all
+	// other reports were handled
+	if r.resourceUsage != nil {
+		err = r.ReportHandler.Handle(&report.Report{ResourceUsage: r.resourceUsage})
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// collectResourceUsage returns the resources used by the exited
+// libFuzzer process and by its sandbox, if it has resource limits.
+func (r *Runner) collectResourceUsage() *report.ResourceUsage {
+	if r.cmd.ProcessState == nil {
+		return nil
+	}
+	usage := processResourceUsage(r.cmd.ProcessState)
+	if r.cgroup != nil {
+		stats, err := r.cgroup.Stats()
+		if err != nil {
+			log.Debugf("Failed to get resource usage of the sandbox: %v", err)
+		} else {
+			usage.SandboxCPUSeconds = stats.CPUSeconds
+			usage.SandboxPeakMemoryBytes = stats.PeakMemoryBytes
+		}
+	}
+	log.Debugf("Resource usage of libFuzzer: %.2fs user, %.2fs system, %d bytes max RSS, %d major page faults, %d/%d voluntary/involuntary context switches",
+		usage.UserCPUSeconds, usage.SystemCPUSeconds, usage.MaxRSSBytes, usage.MajorPageFaults,
+		usage.VoluntaryContextSwitches, usage.InvoluntaryContextSwitches)
+	return usage
 }
 
 func (r *Runner) FuzzerEnvironment() ([]string, error) {
+	return r.fuzzerEnvironment(r.SanitizerProfile)
+}
+
+// fuzzerEnvironment returns the environment to run the fuzz test in
+// with the options of the given sanitizer profile.
+func (r *Runner) fuzzerEnvironment(sanitizerProfile string) ([]string, error) {
 	env, err := fuzzer_runner.FuzzerEnvironment()
 	if err != nil {
 		return nil, err
@@ -407,7 +662,19 @@ func (r *Runner) FuzzerEnvironment() ([]string, error) {
 		// we are setting this explicitly to false
 		"abort_on_error": "0",
 	}
-	env, err = fuzzer_runner.SetASANOptions(env, nil, overrideOptions)
+	if r.DeferSymbolization {
+		overrideOptions["symbolize"] = "0"
+		ubsanOptions := fuzzer_runner.SetSanitizerOptions(envutil.Getenv(env, "UBSAN_OPTIONS"), nil, map[string]string{"symbolize": "0"})
+		env, err = envutil.Setenv(env, "UBSAN_OPTIONS", ubsanOptions)
+		if err != nil {
+			return nil, err
+		}
+	}
+	var defaultOptions map[string]string
+	if sanitizerProfile == SanitizerProfileThroughput {
+		defaultOptions = throughputASANOptions
+	}
+	env, err = fuzzer_runner.SetASANOptions(env, defaultOptions, overrideOptions)
 	if err != nil {
 		return nil, err
 	}
@@ -416,6 +683,22 @@ func (r *Runner) FuzzerEnvironment() ([]string, error) {
 }
 
 func (r *Runner) Cleanup(ctx context.Context) {
+	r.workersMutex.Lock()
+	workers := r.workers
+	r.workersMutex.Unlock()
+	if len(workers) > 0 {
+		var wg sync.WaitGroup
+		for _, worker := range workers {
+			wg.Add(1)
+			go func(worker *Runner) {
+				defer wg.Done()
+				worker.Cleanup(ctx)
+			}(worker)
+		}
+		wg.Wait()
+		return
+	}
+
 	// Wait until the command has been started, else we can't terminate it
 	select {
 	case <-ctx.Done():
@@ -428,8 +711,64 @@ func (r *Runner) Cleanup(ctx context.Context) {
 	}
 }
 
-func sendReports(handler report.Handler, reportsCh <-chan *report.Report) error {
+// coalesceReports forwards the reports from in to out until in is
+// closed, and then closes out. It never blocks reading from in: reports
+// which out isn't ready to receive are queued. A queued metrics report
+// is replaced by the next one, so that a slow receiver only gets the
+// latest metrics, but findings and status changes are never dropped.
+// It returns early once done is closed, because nobody reads from out
+// anymore.
+func coalesceReports(in <-chan *report.Report, out chan<- *report.Report, done <-chan struct{}) {
+	defer close(out)
+
+	var pending []*report.Report
+	for in != nil || len(pending) > 0 {
+		// A nil channel blocks forever, which disables the case
+		var next *report.Report
+		var sendCh chan<- *report.Report
+		if len(pending) > 0 {
+			next = pending[0]
+			sendCh = out
+		}
+
+		select {
+		case r, ok := <-in:
+			if !ok {
+				in = nil
+				continue
+			}
+			last := len(pending) - 1
+			if last >= 0 && isMetricOnly(r) && isMetricOnly(pending[last]) && pending[last].Status == r.Status {
+				pending[last] = r
+			} else {
+				pending = append(pending, r)
+			}
+		case sendCh <- next:
+			pending = pending[1:]
+		case <-done:
+			return
+		}
+	}
+}
+
+func isMetricOnly(r *report.Report) bool {
+	return r.Metric != nil && r.Finding == nil && r.NumSeeds == 0
+}
+
+// sendReports passes the reports to the handler. If cgroup is not nil,
+// the resources used by it are added to the metrics.
+func sendReports(handler report.Handler, reportsCh <-chan *report.Report, cgroup *minijail.Cgroup) error {
 	for r := range reportsCh {
+		if r.Metric != nil && cgroup != nil {
+			stats, err := cgroup.Stats()
+			if err != nil {
+				log.Debugf("Failed to get resource usage of the sandbox: %v", err)
+			} else {
+				r.Metric.CPUSeconds = stats.CPUSeconds
+				r.Metric.MemoryBytes = stats.MemoryBytes
+				r.Metric.PeakMemoryBytes = stats.PeakMemoryBytes
+			}
+		}
 		err := handler.Handle(r)
 		if err != nil {
 			return err
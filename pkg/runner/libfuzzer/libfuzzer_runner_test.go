@@ -0,0 +1,38 @@
+package libfuzzer
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+func TestCoalesceReports(t *testing.T) {
+	in := make(chan *report.Report)
+	out := make(chan *report.Report)
+	done := make(chan struct{})
+	go coalesceReports(in, out, done)
+
+	metric := func(execs uint64) *report.Report {
+		return &report.Report{Status: report.RunStatusRunning, Metric: &report.FuzzingMetric{TotalExecutions: execs}}
+	}
+	crash := &report.Report{Finding: &finding.Finding{Type: finding.ErrorTypeCrash}}
+
+	// Nothing is read from out while sending these, which must not
+	// block
+	in <- metric(1)
+	in <- metric(2)
+	in <- crash
+	in <- metric(3)
+	in <- metric(4)
+	close(in)
+
+	var received []*report.Report
+	for r := range out {
+		received = append(received, r)
+	}
+	assert.Equal(t, []*report.Report{metric(2), crash, metric(4)}, received)
+	close(done)
+}
@@ -0,0 +1,43 @@
+package libfuzzer
+
+import (
+	"bufio"
+	"os"
+	"runtime"
+	"strconv"
+	"strings"
+
+	"github.com/pkg/errors"
+)
+
+// availableMemory returns the memory in bytes which is available for
+// new processes without swapping. It's only implemented on Linux.
+func availableMemory() (uint64, error) {
+	if runtime.GOOS != "linux" {
+		return 0, errors.Errorf("Determining the available memory is not supported on %s", runtime.GOOS)
+	}
+
+	f, err := os.Open("/proc/meminfo")
+	if err != nil {
+		return 0, errors.WithStack(err)
+	}
+	defer f.Close()
+
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		// The line looks like "MemAvailable:   12345678 kB"
+		fields := strings.Fields(scanner.Text())
+		if len(fields) != 3 || fields[0] != "MemAvailable:" || fields[2] != "kB" {
+			continue
+		}
+		kb, err := strconv.ParseUint(fields[1], 10, 64)
+		if err != nil {
+			return 0, errors.WithStack(err)
+		}
+		return kb << 10, nil
+	}
+	if err := scanner.Err(); err != nil {
+		return 0, errors.WithStack(err)
+	}
+	return 0, errors.New("MemAvailable not found in /proc/meminfo")
+}
@@ -0,0 +1,101 @@
+package libfuzzer
+
+import (
+	"context"
+	"sync"
+	"time"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// The interval in which the plateau detector checks the features,
+// which is independent of the metrics, because libFuzzer doesn't print
+// any while it doesn't find new features
+var plateauCheckInterval = time.Second
+
+// plateauDetector passes the reports on to its handler and records the
+// number of features over time, to stop fuzzing once they stopped
+// growing, see RunnerOptions.PlateauTimeout.
+type plateauDetector struct {
+	handler        report.Handler
+	timeout        time.Duration
+	minNewFeatures int32
+
+	mutex sync.Mutex
+	// The number of features over time, oldest first. Only the last
+	// sample before the timeout is kept, which is the number of
+	// features at its start.
+	samples []featureSample
+}
+
+type featureSample struct {
+	time     time.Time
+	features int32
+}
+
+func newPlateauDetector(handler report.Handler, timeout time.Duration, minNewFeatures uint) *plateauDetector {
+	d := &plateauDetector{
+		handler:        handler,
+		timeout:        timeout,
+		minNewFeatures: int32(minNewFeatures),
+	}
+	if d.minNewFeatures == 0 {
+		d.minNewFeatures = 1
+	}
+	return d
+}
+
+func (d *plateauDetector) Handle(r *report.Report) error {
+	if r.Metric != nil {
+		d.add(time.Now(), r.Metric.Features)
+	}
+	return d.handler.Handle(r)
+}
+
+func (d *plateauDetector) add(now time.Time, features int32) {
+	d.mutex.Lock()
+	defer d.mutex.Unlock()
+	d.samples = append(d.samples, featureSample{time: now, features: features})
+}
+
+// newFeatures returns the number of features which were found within
+// the timeout before now, or false if the first metrics were reported
+// less than the timeout ago.
+func (d *plateauDetector) newFeatures(now time.Time) (int32, bool) {
+	d.mutex.Lock()
+	defer d.mutex.Unlock()
+	if len(d.samples) == 0 || now.Sub(d.samples[0].time) < d.timeout {
+		return 0, false
+	}
+	start := now.Add(-d.timeout)
+	for len(d.samples) > 1 && !d.samples[1].time.After(start) {
+		d.samples = d.samples[1:]
+	}
+	return d.samples[len(d.samples)-1].features - d.samples[0].features, true
+}
+
+// watch calls stop once fewer than the minimum number of new features
+// were found within the timeout, or returns when ctx is done.
+func (d *plateauDetector) watch(ctx context.Context, stop func()) {
+	ticker := time.NewTicker(plateauCheckInterval)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return
+		case now := <-ticker.C:
+			newFeatures, ok := d.newFeatures(now)
+			if !ok || newFeatures >= d.minNewFeatures {
+				continue
+			}
+			if newFeatures == 0 {
+				log.Infof("No new features were found in the last %s, stopping the fuzz test", d.timeout)
+			} else {
+				log.Infof("Only %d new features were found in the last %s, stopping the fuzz test", newFeatures, d.timeout)
+			}
+			stop()
+			return
+		}
+	}
+}
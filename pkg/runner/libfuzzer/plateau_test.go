@@ -0,0 +1,73 @@
+package libfuzzer
+
+import (
+	"context"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+func TestPlateauDetector_NewFeatures(t *testing.T) {
+	d := newPlateauDetector(&collectingHandler{}, time.Minute, 0)
+	start := time.Date(2023, 1, 1, 0, 0, 0, 0, time.UTC)
+
+	d.add(start, 100)
+	// The features aren't checked before a full timeout passed
+	_, ok := d.newFeatures(start.Add(30 * time.Second))
+	assert.False(t, ok)
+
+	d.add(start.Add(40*time.Second), 110)
+	newFeatures, ok := d.newFeatures(start.Add(time.Minute))
+	require.True(t, ok)
+	assert.Equal(t, int32(10), newFeatures)
+
+	// The features found 40 seconds after the start are still within
+	// the timeout
+	newFeatures, ok = d.newFeatures(start.Add(90 * time.Second))
+	require.True(t, ok)
+	assert.Equal(t, int32(10), newFeatures)
+
+	d.add(start.Add(100*time.Second), 112)
+	newFeatures, ok = d.newFeatures(start.Add(120 * time.Second))
+	require.True(t, ok)
+	assert.Equal(t, int32(2), newFeatures)
+
+	newFeatures, ok = d.newFeatures(start.Add(200 * time.Second))
+	require.True(t, ok)
+	assert.Equal(t, int32(0), newFeatures)
+}
+
+func TestPlateauDetector_Watch(t *testing.T) {
+	oldInterval := plateauCheckInterval
+	plateauCheckInterval = 10 * time.Millisecond
+	defer func() { plateauCheckInterval = oldInterval }()
+
+	handler := &collectingHandler{}
+	d := newPlateauDetector(handler, 100*time.Millisecond, 5)
+	require.NoError(t, d.Handle(&report.Report{Metric: &report.FuzzingMetric{Features: 100}}))
+	require.Len(t, handler.reports, 1)
+
+	stopped := make(chan struct{})
+	go d.watch(context.Background(), func() { close(stopped) })
+
+	// Fuzzing continues while enough new features are found
+	for i := int32(1); i <= 10; i++ {
+		time.Sleep(20 * time.Millisecond)
+		require.NoError(t, d.Handle(&report.Report{Metric: &report.FuzzingMetric{Features: 100 + 10*i}}))
+	}
+	select {
+	case <-stopped:
+		require.Fail(t, "Stopped although new features were found")
+	default:
+	}
+
+	select {
+	case <-stopped:
+	case <-time.After(5 * time.Second):
+		require.Fail(t, "Not stopped after the features stopped growing")
+	}
+}
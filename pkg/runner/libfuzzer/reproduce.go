@@ -0,0 +1,135 @@
+package libfuzzer
+
+import (
+	"bytes"
+	"context"
+	"os"
+	"path/filepath"
+	"strings"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+	libfuzzer_parser "code-intelligence.com/cifuzz/pkg/parser/libfuzzer"
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/util/envutil"
+	"code-intelligence.com/cifuzz/util/executil"
+	"code-intelligence.com/cifuzz/util/fileutil"
+)
+
+// ReproduceCrash runs the fuzz test on a crashing input found by an
+// engine which runs it out of process, e.g. AFL++, and returns the
+// finding parsed from its output. This requires that the fuzz test
+// runs the inputs passed as arguments when it's run outside of the
+// engine. If the crash doesn't reproduce, the finding only contains
+// the input and the output.
+func (r *Runner) ReproduceCrash(ctx context.Context, input string) (*finding.Finding, error) {
+	data, err := os.ReadFile(input)
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	f, output, err := r.reproduce(ctx, input, SanitizerProfileTriage)
+	if err != nil {
+		return nil, err
+	}
+	if f == nil {
+		log.Debugf("The crash didn't reproduce outside of the fuzzing engine:\n%s", output)
+		f = &finding.Finding{
+			Type:    finding.ErrorTypeCrash,
+			Details: "Crash which didn't reproduce outside of the fuzzing engine",
+			Logs:    strings.Split(strings.TrimRight(string(output), "\n"), "\n"),
+		}
+	}
+	f.InputData = data
+	f.InputFile = input
+	return f, nil
+}
+
+// replayFirst runs the ReplayFirst inputs and reports the finding of
+// the first one which still crashes, in which case it returns true.
+func (r *Runner) replayFirst(ctx context.Context) (bool, error) {
+	for _, input := range r.ReplayFirst {
+		f, _, err := r.reproduce(ctx, input, SanitizerProfileTriage)
+		if err != nil {
+			return false, err
+		}
+		if ctx.Err() != nil {
+			return true, nil
+		}
+		if f == nil {
+			log.Debugf("%s doesn't crash anymore", input)
+			continue
+		}
+
+		// The report handler copies the input file to the finding
+		// directory, which the input usually is in already, so it's
+		// passed a copy of it
+		data, err := os.ReadFile(input)
+		if err != nil {
+			return false, errors.WithStack(err)
+		}
+		tmpDir, err := os.MkdirTemp("", "libfuzzer-replay-")
+		if err != nil {
+			return false, errors.WithStack(err)
+		}
+		defer fileutil.Cleanup(tmpDir)
+		f.InputData = data
+		f.InputFile = filepath.Join(tmpDir, filepath.Base(input))
+		err = os.WriteFile(f.InputFile, data, 0o644)
+		if err != nil {
+			return false, errors.WithStack(err)
+		}
+		log.Infof("%s still crashes", input)
+		return true, r.ReportHandler.Handle(&report.Report{Status: report.RunStatusRunning, Finding: f})
+	}
+	return false, nil
+}
+
+// reproduce runs the fuzz test on the input with the options of the
+// given sanitizer profile and returns the symbolized finding parsed
+// from its output, which is nil if there is none, and the output.
+func (r *Runner) reproduce(ctx context.Context, input string, sanitizerProfile string) (*finding.Finding, []byte, error) {
+	err := r.initSymbolizer()
+	if err != nil {
+		return nil, nil, err
+	}
+
+	env, err := r.fuzzerEnvironment(sanitizerProfile)
+	if err != nil {
+		return nil, nil, err
+	}
+	cmd := executil.CommandContext(ctx, r.FuzzTarget, input)
+	cmd.Env, err = envutil.Copy(os.Environ(), env)
+	if err != nil {
+		return nil, nil, err
+	}
+	log.Debugf("Command: %s", envutil.QuotedCommandWithEnv(cmd.Args, env))
+	// The fuzz test is expected to fail
+	output, _ := cmd.CombinedOutput()
+
+	parser := libfuzzer_parser.NewLibfuzzerOutputParser(&libfuzzer_parser.Options{
+		KeepColor:  r.KeepColor,
+		ProjectDir: r.ProjectDir,
+	})
+	reportsCh := make(chan *report.Report)
+	var f *finding.Finding
+	parsed := make(chan struct{})
+	go func() {
+		defer close(parsed)
+		for rep := range reportsCh {
+			if rep.Finding != nil && f == nil {
+				f = rep.Finding
+			}
+		}
+	}()
+	err = parser.Parse(ctx, bytes.NewReader(output), reportsCh)
+	<-parsed
+	if err != nil {
+		return nil, nil, err
+	}
+	if f != nil {
+		r.symbolizeFinding(ctx, f)
+	}
+	return f, output, nil
+}
@@ -0,0 +1,33 @@
+//go:build aix || darwin || dragonfly || freebsd || linux || netbsd || openbsd || solaris
+
+package libfuzzer
+
+import (
+	"os"
+	"runtime"
+	"syscall"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// processResourceUsage returns the resources used by the exited process
+// and the children it waited for, as reported by wait4.
+func processResourceUsage(state *os.ProcessState) *report.ResourceUsage {
+	usage := &report.ResourceUsage{
+		UserCPUSeconds:   state.UserTime().Seconds(),
+		SystemCPUSeconds: state.SystemTime().Seconds(),
+	}
+	rusage, ok := state.SysUsage().(*syscall.Rusage)
+	if !ok {
+		return usage
+	}
+	// ru_maxrss is in kilobytes on Linux, but in bytes on macOS
+	usage.MaxRSSBytes = uint64(rusage.Maxrss)
+	if runtime.GOOS != "darwin" {
+		usage.MaxRSSBytes <<= 10
+	}
+	usage.MajorPageFaults = uint64(rusage.Majflt)
+	usage.VoluntaryContextSwitches = uint64(rusage.Nvcsw)
+	usage.InvoluntaryContextSwitches = uint64(rusage.Nivcsw)
+	return usage
+}
@@ -0,0 +1,24 @@
+//go:build aix || darwin || dragonfly || freebsd || linux || netbsd || openbsd || solaris
+
+package libfuzzer
+
+import (
+	"os/exec"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestProcessResourceUsage(t *testing.T) {
+	// The shell waits for the command it runs, so its resources are
+	// included, like those of the fuzzer when it's run via minijail
+	cmd := exec.Command("sh", "-c", "i=0; while [ $i -lt 10000 ]; do i=$((i+1)); done; true")
+	require.NoError(t, cmd.Run())
+
+	usage := processResourceUsage(cmd.ProcessState)
+	assert.Greater(t, usage.UserCPUSeconds+usage.SystemCPUSeconds, 0.0)
+	// Any process has a few pages resident, so this also checks that
+	// the unit is bytes, not kilobytes
+	assert.Greater(t, usage.MaxRSSBytes, uint64(64<<10))
+}
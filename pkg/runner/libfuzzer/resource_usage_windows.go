@@ -0,0 +1,16 @@
+package libfuzzer
+
+import (
+	"os"
+
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// processResourceUsage returns the resources used by the exited
+// process. Only the CPU times are known on Windows.
+func processResourceUsage(state *os.ProcessState) *report.ResourceUsage {
+	return &report.ResourceUsage{
+		UserCPUSeconds:   state.UserTime().Seconds(),
+		SystemCPUSeconds: state.SystemTime().Seconds(),
+	}
+}
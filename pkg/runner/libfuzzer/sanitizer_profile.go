@@ -0,0 +1,108 @@
+package libfuzzer
+
+import (
+	"context"
+	"strings"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// The sanitizer profiles, which trade the completeness of the reports
+// of the sanitizers for the speed of fuzzing.
+const (
+	// SanitizerProfileTriage uses the options of the sanitizers which
+	// produce complete reports. It's the default.
+	SanitizerProfileTriage = "triage"
+	// SanitizerProfileThroughput uses the options of the sanitizers
+	// which make fuzzing faster at the cost of less complete reports.
+	// The crashing inputs of findings are run again with the
+	// SanitizerProfileTriage before they are reported.
+	SanitizerProfileThroughput = "throughput"
+)
+
+var SanitizerProfiles = []string{SanitizerProfileTriage, SanitizerProfileThroughput}
+
+// The ASan options set by SanitizerProfileThroughput unless the user
+// sets them. They only affect the allocation and deallocation stacks in
+// reports and how long freed memory stays poisoned.
+var throughputASANOptions = map[string]string{
+	// Every allocation stores a stack trace of this many frames, 30 by
+	// default
+	"malloc_context_size": "5",
+	// Unwind the stacks of allocations via frame pointers instead of
+	// the slower unwind tables
+	"fast_unwind_on_malloc": "1",
+	// Freed memory is reused sooner, 256 MB by default, which makes
+	// fewer uses after free detectable but is faster on large
+	// allocations
+	"quarantine_size_mb": "16",
+}
+
+// throughputLibfuzzerArgs are passed to libFuzzer before the EngineArgs
+// with SanitizerProfileThroughput. libFuzzer then checks for leaks only
+// when it exits instead of after every input which allocated more than
+// it freed.
+var throughputLibfuzzerArgs = []string{"-detect_leaks=0"}
+
+func ValidateSanitizerProfile(profile string) error {
+	if profile == "" {
+		return nil
+	}
+	for _, p := range SanitizerProfiles {
+		if profile == p {
+			return nil
+		}
+	}
+	return errors.Errorf("Invalid sanitizer profile %q, must be one of %s", profile, strings.Join(SanitizerProfiles, ", "))
+}
+
+// triageFinding replaces the report of the finding by the one of its
+// crashing input run with the SanitizerProfileTriage. Only sanitizer
+// reports are affected by the profile. If the crash doesn't reproduce
+// with the same error type, the finding is reported as it is.
+func (r *Runner) triageFinding(ctx context.Context, f *finding.Finding) {
+	if f.InputFile == "" || !hasSanitizerReport(f.Logs) {
+		return
+	}
+	triaged, _, err := r.reproduce(ctx, f.InputFile, SanitizerProfileTriage)
+	if err != nil {
+		log.Warnf("Failed to run the input of the finding with the %s sanitizer profile: %v", SanitizerProfileTriage, err)
+		return
+	}
+	if triaged == nil || triaged.Type != f.Type {
+		log.Debugf("The finding didn't reproduce with the %s sanitizer profile", SanitizerProfileTriage)
+		return
+	}
+	f.Details = triaged.Details
+	f.Logs = triaged.Logs
+	f.StackTrace = triaged.StackTrace
+}
+
+func hasSanitizerReport(logs []string) bool {
+	for _, line := range logs {
+		if strings.Contains(line, "Sanitizer:") {
+			return true
+		}
+	}
+	return false
+}
+
+// triagingHandler triages the findings before they are passed on to
+// the handler, i.e. before they are deduplicated by their stack hash
+// and saved.
+type triagingHandler struct {
+	ctx     context.Context
+	runner  *Runner
+	handler report.Handler
+}
+
+func (h *triagingHandler) Handle(r *report.Report) error {
+	if r.Finding != nil {
+		h.runner.triageFinding(h.ctx, r.Finding)
+	}
+	return h.handler.Handle(r)
+}
@@ -0,0 +1,30 @@
+package libfuzzer
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+
+	fuzzer_runner "code-intelligence.com/cifuzz/pkg/runner"
+)
+
+func TestValidateSanitizerProfile(t *testing.T) {
+	assert.NoError(t, ValidateSanitizerProfile(""))
+	assert.NoError(t, ValidateSanitizerProfile(SanitizerProfileTriage))
+	assert.NoError(t, ValidateSanitizerProfile(SanitizerProfileThroughput))
+	assert.Error(t, ValidateSanitizerProfile("fast"))
+}
+
+func TestThroughputASANOptions(t *testing.T) {
+	// Options set by the user take precedence
+	options := fuzzer_runner.SetSanitizerOptions("malloc_context_size=20", throughputASANOptions, nil)
+	assert.Contains(t, options, "malloc_context_size=20")
+	assert.NotContains(t, options, "malloc_context_size=5")
+	assert.Contains(t, options, "quarantine_size_mb=16")
+}
+
+func TestHasSanitizerReport(t *testing.T) {
+	assert.True(t, hasSanitizerReport([]string{"==1==ERROR: AddressSanitizer: heap-use-after-free on address 0x602000000010"}))
+	assert.True(t, hasSanitizerReport([]string{"SUMMARY: UndefinedBehaviorSanitizer: undefined-behavior main.cpp:3:5"}))
+	assert.False(t, hasSanitizerReport([]string{"==1== ERROR: libFuzzer: timeout after 1 seconds"}))
+}
@@ -0,0 +1,81 @@
+package libfuzzer
+
+import (
+	"context"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/parser/libfuzzer/stacktrace"
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/pkg/runfiles"
+	"code-intelligence.com/cifuzz/pkg/symbolizer"
+)
+
+// initSymbolizer creates the symbolizer of the stack traces of findings
+// if DeferSymbolization is set, unless this is a worker, which uses the
+// symbolizer of its parent.
+func (r *Runner) initSymbolizer() error {
+	if !r.DeferSymbolization || r.symbolizer != nil {
+		return nil
+	}
+	path, err := runfiles.Finder.LLVMSymbolizerPath()
+	if err != nil {
+		return err
+	}
+	r.symbolizer = symbolizer.New(path)
+	r.ownsSymbolizer = true
+	return nil
+}
+
+// CloseSymbolizer stops the llvm-symbolizer processes of the symbolizer
+// created by initSymbolizer, if any. The runs of the runner which use
+// it have to be done.
+func (r *Runner) CloseSymbolizer() {
+	if !r.ownsSymbolizer {
+		return
+	}
+	r.symbolizer.Close()
+	r.symbolizer = nil
+	r.ownsSymbolizer = false
+}
+
+// symbolizeFinding symbolizes the stack trace of the finding, which the
+// sanitizers didn't symbolize because of DeferSymbolization, and parses
+// it again. If that fails, the finding is reported with the raw stack
+// trace, so that it's not lost.
+func (r *Runner) symbolizeFinding(ctx context.Context, f *finding.Finding) {
+	if r.symbolizer == nil || !symbolizer.HasRawFrames(f.Logs) {
+		return
+	}
+	logs, err := r.symbolizer.SymbolizeLogs(ctx, f.Logs)
+	if err != nil {
+		log.Warnf("Failed to symbolize the stack trace of the finding: %v", err)
+		return
+	}
+	stackTrace, err := stacktrace.NewParser(&stacktrace.ParserOptions{
+		ProjectDir:    r.ProjectDir,
+		SupportJazzer: r.SupportJazzer,
+	}).Parse(logs)
+	if err != nil {
+		log.Warnf("Failed to parse the symbolized stack trace of the finding: %v", err)
+		return
+	}
+	f.Logs = logs
+	f.StackTrace = stackTrace
+}
+
+// symbolizingHandler symbolizes the findings before they are passed on
+// to the handler, i.e. before they are deduplicated by their stack hash
+// and saved.
+type symbolizingHandler struct {
+	ctx     context.Context
+	runner  *Runner
+	handler report.Handler
+}
+
+func (h *symbolizingHandler) Handle(r *report.Report) error {
+	if r.Finding != nil {
+		h.runner.symbolizeFinding(h.ctx, r.Finding)
+	}
+	return h.handler.Handle(r)
+}
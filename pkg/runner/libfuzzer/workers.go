@@ -0,0 +1,236 @@
+package libfuzzer
+
+import (
+	"context"
+	"sync"
+	"time"
+
+	"github.com/pkg/errors"
+	"golang.org/x/sync/errgroup"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+	"code-intelligence.com/cifuzz/pkg/report"
+)
+
+// The interval in which the merged metrics of the workers are reported
+var workerMetricsInterval = time.Second
+
+// runWorkers runs r.Workers libFuzzer processes which share the
+// generated corpus, each in its own sandbox if minijail is used. The
+// new inputs of each worker are passed on to the others by a
+// corpusExchange. Like a single libFuzzer process, all of them are
+// stopped once one of them exits, e.g. because it found a crash.
+func (r *Runner) runWorkers(ctx context.Context) error {
+	workersCtx, cancelWorkers := context.WithCancel(ctx)
+	defer cancelWorkers()
+
+	aggregator := &workerReportAggregator{
+		handler: r.ReportHandler,
+		metrics: make([]*report.FuzzingMetric, r.Workers),
+		seen:    make(map[string]bool),
+	}
+	if r.PlateauTimeout > 0 {
+		// The plateau is detected in the merged metrics, so that the
+		// workers are stopped together
+		detector := newPlateauDetector(r.ReportHandler, r.PlateauTimeout, r.PlateauMinNewFeatures)
+		aggregator.handler = detector
+		go detector.watch(workersCtx, cancelWorkers)
+	}
+
+	// With a corpus tmpfs, libFuzzer's first corpus directory is the
+	// tmpfs, so the workers only share the inputs found before they
+	// started
+	var exchange *corpusExchange
+	if r.CorpusTmpfsSize == "" {
+		var err error
+		exchange, err = newCorpusExchange(r.GeneratedCorpusDir, r.Workers)
+		if err != nil {
+			return err
+		}
+	}
+
+	r.workersMutex.Lock()
+	for i := uint(0); i < r.Workers; i++ {
+		opts := *r.RunnerOptions
+		// The number of workers was chosen already, if necessary
+		opts.AutoWorkers = false
+		opts.Workers = 1
+		// The corpus was merged already, if necessary
+		opts.CorpusMergeThreshold = 0
+		// The inputs were replayed before the workers were started
+		opts.ReplayFirst = nil
+		// The corpus is merged periodically by this runner, not by each
+		// of the workers
+		opts.CorpusMergeInterval = 0
+		opts.PlateauTimeout = 0
+		opts.ReportHandler = &workerReportHandler{aggregator: aggregator, worker: int(i)}
+		worker := NewRunner(&opts)
+		worker.SupportJazzer = r.SupportJazzer
+		// Addresses symbolized for one worker don't have to be
+		// symbolized again for the others
+		worker.symbolizer = r.symbolizer
+		if exchange != nil {
+			worker.corpusInbox = exchange.inboxes[i]
+		}
+		r.workers = append(r.workers, worker)
+	}
+	r.workersMutex.Unlock()
+
+	exchangeDone := make(chan struct{})
+	if exchange != nil {
+		go func() {
+			exchange.run(workersCtx)
+			close(exchangeDone)
+		}()
+	} else {
+		close(exchangeDone)
+	}
+
+	routines := errgroup.Group{}
+	for i, worker := range r.workers {
+		i, worker := i, worker
+		routines.Go(func() error {
+			err := worker.Run(workersCtx)
+			// The other workers are stopped by cancelling their context,
+			// which is not an error.
+			if errors.Is(err, context.Canceled) && ctx.Err() == nil {
+				err = nil
+			}
+			log.Debugf("libFuzzer worker %d exited: %v", i, err)
+			cancelWorkers()
+			return err
+		})
+	}
+	err := routines.Wait()
+
+	// All workers exited, so the exchange can move their remaining
+	// inputs to the generated corpus
+	cancelWorkers()
+	<-exchangeDone
+	if exchange != nil {
+		exchange.cleanup()
+	}
+	if err != nil {
+		return err
+	}
+
+	if aggregator.resourceUsage != nil {
+		return r.ReportHandler.Handle(&report.Report{ResourceUsage: aggregator.resourceUsage})
+	}
+	return nil
+}
+
+// workerReportAggregator merges the reports of the workers into the
+// reports of a single fuzzing run.
+type workerReportAggregator struct {
+	handler report.Handler
+	mutex   sync.Mutex
+	// The last metrics reported by each worker
+	metrics []*report.FuzzingMetric
+	// When the merged metrics were reported last
+	lastMetricsReport time.Time
+	// The findings which were reported already, by stack hash
+	seen map[string]bool
+	// The resources used by the workers which exited so far
+	resourceUsage *report.ResourceUsage
+}
+
+type workerReportHandler struct {
+	aggregator *workerReportAggregator
+	worker     int
+}
+
+func (h *workerReportHandler) Handle(r *report.Report) error {
+	return h.aggregator.handle(h.worker, r)
+}
+
+func (a *workerReportAggregator) handle(worker int, r *report.Report) error {
+	a.mutex.Lock()
+	defer a.mutex.Unlock()
+
+	if r.Finding != nil {
+		// Workers which fuzz the same code likely run into the same bug,
+		// possibly with different inputs, so only the first finding per
+		// stack hash is reported. Findings without a stack trace are
+		// identified by their error type and location.
+		key := r.Finding.StackHash()
+		if key == "" {
+			key = r.Finding.ShortDescription()
+		}
+		if a.seen[key] {
+			log.Debugf("Skipping duplicate finding of worker %d: %s", worker, r.Finding.ShortDescription())
+			return nil
+		}
+		a.seen[key] = true
+		return a.handler.Handle(&report.Report{Status: r.Status, Finding: r.Finding})
+	}
+
+	if r.ResourceUsage != nil {
+		// The resource usage is reported once all workers exited, see
+		// runWorkers
+		if a.resourceUsage == nil {
+			a.resourceUsage = &report.ResourceUsage{}
+		}
+		a.resourceUsage.Add(r.ResourceUsage)
+		return nil
+	}
+
+	if r.Metric != nil {
+		a.metrics[worker] = r.Metric
+		// The merged metrics are reported with the metrics of whichever
+		// worker reports next once the interval passed, else they would
+		// be reported once per worker. They are still reported when
+		// some of the workers stall.
+		now := time.Now()
+		if now.Sub(a.lastMetricsReport) < workerMetricsInterval {
+			return nil
+		}
+		a.lastMetricsReport = now
+		return a.handler.Handle(&report.Report{Status: r.Status, Metric: a.mergedMetrics()})
+	}
+
+	// The status reports of all workers are the same
+	if worker != 0 {
+		return nil
+	}
+	return a.handler.Handle(r)
+}
+
+// mergedMetrics adds up the throughput and resource usage of the
+// workers. The coverage and corpus metrics are the maximum of the
+// workers, because they share the corpus.
+func (a *workerReportAggregator) mergedMetrics() *report.FuzzingMetric {
+	merged := &report.FuzzingMetric{}
+	first := true
+	for _, m := range a.metrics {
+		if m == nil {
+			continue
+		}
+		if m.Timestamp.After(merged.Timestamp) {
+			merged.Timestamp = m.Timestamp
+		}
+		merged.ExecutionsPerSecond += m.ExecutionsPerSecond
+		merged.TotalExecutions += m.TotalExecutions
+		merged.CPUSeconds += m.CPUSeconds
+		merged.MemoryBytes += m.MemoryBytes
+		merged.PeakMemoryBytes += m.PeakMemoryBytes
+		merged.PeakRSSBytes += m.PeakRSSBytes
+		if m.Features > merged.Features {
+			merged.Features = m.Features
+		}
+		if m.Edges > merged.Edges {
+			merged.Edges = m.Edges
+		}
+		if m.CorpusSize > merged.CorpusSize {
+			merged.CorpusSize = m.CorpusSize
+		}
+		if first || m.SecondsSinceLastFeature < merged.SecondsSinceLastFeature {
+			merged.SecondsSinceLastFeature = m.SecondsSinceLastFeature
+		}
+		if first || m.SecondsSinceLastEdge < merged.SecondsSinceLastEdge {
+			merged.SecondsSinceLastEdge = m.SecondsSinceLastEdge
+		}
+		first = false
+	}
+	return merged
+}
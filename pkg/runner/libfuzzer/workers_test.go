@@ -0,0 +1,208 @@
+package libfuzzer
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/pkg/finding"
+	"code-intelligence.com/cifuzz/pkg/mocks"
+	"code-intelligence.com/cifuzz/pkg/report"
+	"code-intelligence.com/cifuzz/pkg/runfiles"
+)
+
+type collectingHandler struct {
+	reports []*report.Report
+}
+
+func (h *collectingHandler) Handle(r *report.Report) error {
+	h.reports = append(h.reports, r)
+	return nil
+}
+
+func TestWorkerReportAggregator(t *testing.T) {
+	defaultInterval := workerMetricsInterval
+	workerMetricsInterval = time.Hour
+	t.Cleanup(func() { workerMetricsInterval = defaultInterval })
+
+	handler := &collectingHandler{}
+	aggregator := &workerReportAggregator{
+		handler: handler,
+		metrics: make([]*report.FuzzingMetric, 2),
+		seen:    make(map[string]bool),
+	}
+	worker0 := &workerReportHandler{aggregator: aggregator, worker: 0}
+	worker1 := &workerReportHandler{aggregator: aggregator, worker: 1}
+
+	// Status reports are only passed on once
+	require.NoError(t, worker0.Handle(&report.Report{Status: report.RunStatusInitializing, NumSeeds: 3}))
+	require.NoError(t, worker1.Handle(&report.Report{Status: report.RunStatusInitializing, NumSeeds: 3}))
+	require.Len(t, handler.reports, 1)
+
+	// The metrics of the worker which reports first are passed on
+	// right away, those of the other worker only once the interval
+	// passed
+	require.NoError(t, worker1.Handle(&report.Report{
+		Status: report.RunStatusRunning,
+		Metric: &report.FuzzingMetric{
+			ExecutionsPerSecond:     100,
+			TotalExecutions:         1000,
+			Features:                20,
+			Edges:                   10,
+			CorpusSize:              5,
+			SecondsSinceLastFeature: 3,
+		},
+	}))
+	require.Len(t, handler.reports, 2)
+	require.NoError(t, worker0.Handle(&report.Report{
+		Status: report.RunStatusRunning,
+		Metric: &report.FuzzingMetric{
+			ExecutionsPerSecond:     200,
+			TotalExecutions:         3000,
+			Features:                15,
+			Edges:                   12,
+			CorpusSize:              4,
+			SecondsSinceLastFeature: 7,
+		},
+	}))
+	require.Len(t, handler.reports, 2)
+
+	// Once the interval passed, the next metrics of any worker are
+	// reported merged with the last ones of the others
+	aggregator.lastMetricsReport = time.Now().Add(-workerMetricsInterval)
+	require.NoError(t, worker1.Handle(&report.Report{
+		Status: report.RunStatusRunning,
+		Metric: &report.FuzzingMetric{
+			ExecutionsPerSecond:     100,
+			TotalExecutions:         2000,
+			Features:                20,
+			Edges:                   10,
+			CorpusSize:              5,
+			SecondsSinceLastFeature: 3,
+		},
+	}))
+	require.Len(t, handler.reports, 3)
+	assert.Equal(t, &report.FuzzingMetric{
+		ExecutionsPerSecond:     300,
+		TotalExecutions:         5000,
+		Features:                20,
+		Edges:                   12,
+		CorpusSize:              5,
+		SecondsSinceLastFeature: 3,
+	}, handler.reports[2].Metric)
+
+	// The same crash found by both workers is only reported once
+	crash := func(input string) *report.Report {
+		return &report.Report{Finding: &finding.Finding{
+			Type:      finding.ErrorTypeCrash,
+			Details:   "heap-buffer-overflow",
+			InputData: []byte(input),
+		}}
+	}
+	require.NoError(t, worker1.Handle(crash("a")))
+	require.NoError(t, worker0.Handle(crash("b")))
+	require.Len(t, handler.reports, 4)
+	assert.Equal(t, []byte("a"), handler.reports[3].Finding.InputData)
+
+	// The resource usage is added up and not passed on before all
+	// workers exited
+	require.NoError(t, worker0.Handle(&report.Report{ResourceUsage: &report.ResourceUsage{UserCPUSeconds: 1.5, MajorPageFaults: 2}}))
+	require.NoError(t, worker1.Handle(&report.Report{ResourceUsage: &report.ResourceUsage{UserCPUSeconds: 2, MajorPageFaults: 3}}))
+	require.Len(t, handler.reports, 4)
+	assert.Equal(t, &report.ResourceUsage{UserCPUSeconds: 3.5, MajorPageFaults: 5}, aggregator.resourceUsage)
+}
+
+func TestRunWorkers_WorkersDontCalibrate(t *testing.T) {
+	fuzzTarget, corpusDir := newFakeFuzzTest(t)
+
+	r := NewRunner(&RunnerOptions{
+		AutoWorkers:        true,
+		FuzzTarget:         fuzzTarget,
+		GeneratedCorpusDir: corpusDir,
+		ReportHandler:      &collectingHandler{},
+		Workers:            2,
+		// If a worker calibrated anyway, it would choose a single
+		// worker with this budget instead of starting workers itself
+		WorkersMemoryBudget: 1,
+	})
+	err := r.runWorkers(context.Background())
+	require.NoError(t, err)
+
+	runs := fakeFuzzTestRuns(t, fuzzTarget)
+	require.Len(t, runs, 2)
+	for _, run := range runs {
+		assert.NotContains(t, run, "-rss_limit_mb")
+	}
+}
+
+func TestRun_ReplayFirstInputsOnce(t *testing.T) {
+	for name, opts := range map[string]*RunnerOptions{
+		// The input is replayed before the calibration run
+		"auto workers": {AutoWorkers: true, WorkersMemoryBudget: 1},
+		// The input is replayed before the workers are started
+		"workers": {Workers: 2},
+	} {
+		opts := opts
+		t.Run(name, func(t *testing.T) {
+			fuzzTarget, corpusDir := newFakeFuzzTest(t)
+			input := filepath.Join(t.TempDir(), "crash-123")
+			err := os.WriteFile(input, []byte("crash"), 0o644)
+			require.NoError(t, err)
+
+			opts.FuzzTarget = fuzzTarget
+			opts.GeneratedCorpusDir = corpusDir
+			opts.ReplayFirst = []string{input}
+			opts.ReportHandler = &collectingHandler{}
+			err = NewRunner(opts).Run(context.Background())
+			require.NoError(t, err)
+
+			runs := fakeFuzzTestRuns(t, fuzzTarget)
+			require.Len(t, runs, 3)
+			assert.Equal(t, input, runs[0])
+			for _, run := range runs[1:] {
+				assert.NotContains(t, run, input)
+			}
+		})
+	}
+}
+
+// newFakeFuzzTest creates a fuzz test which records the arguments of
+// every run and exits like libFuzzer after the timeout, and returns it
+// and an empty generated corpus directory.
+func newFakeFuzzTest(t *testing.T) (string, string) {
+	if runtime.GOOS == "windows" {
+		t.Skip("The fake fuzz test is a shell script")
+	}
+	tempDir := t.TempDir()
+
+	fuzzTarget := filepath.Join(tempDir, "fuzz_test")
+	script := "#!/bin/sh\necho \"$*\" >> '" + fuzzTarget + ".args'\n"
+	err := os.WriteFile(fuzzTarget, []byte(script), 0o755)
+	require.NoError(t, err)
+
+	finder := &mocks.RunfilesFinderMock{}
+	finder.On("LLVMSymbolizerPath").Return(fuzzTarget, nil)
+	defaultFinder := runfiles.Finder
+	runfiles.Finder = finder
+	t.Cleanup(func() { runfiles.Finder = defaultFinder })
+
+	corpusDir := filepath.Join(tempDir, "corpus")
+	err = os.Mkdir(corpusDir, 0o755)
+	require.NoError(t, err)
+	return fuzzTarget, corpusDir
+}
+
+// fakeFuzzTestRuns returns the arguments of the runs of the fake fuzz
+// test, one string per run.
+func fakeFuzzTestRuns(t *testing.T, fuzzTarget string) []string {
+	args, err := os.ReadFile(fuzzTarget + ".args")
+	require.NoError(t, err)
+	return strings.Split(strings.TrimSpace(string(args)), "\n")
+}
@@ -0,0 +1,55 @@
+package symbolizer
+
+import (
+	"container/list"
+	"sync"
+)
+
+// frameCache is an LRU cache of the frames of symbolized addresses.
+type frameCache struct {
+	size  int
+	mutex sync.Mutex
+	// The most recently used entries are at the front
+	order   *list.List
+	entries map[address]*list.Element
+}
+
+type cacheEntry struct {
+	addr   address
+	frames []frame
+}
+
+func newFrameCache(size int) *frameCache {
+	return &frameCache{
+		size:    size,
+		order:   list.New(),
+		entries: make(map[address]*list.Element),
+	}
+}
+
+func (c *frameCache) get(addr address) ([]frame, bool) {
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	e, ok := c.entries[addr]
+	if !ok {
+		return nil, false
+	}
+	c.order.MoveToFront(e)
+	return e.Value.(*cacheEntry).frames, true
+}
+
+func (c *frameCache) add(addr address, frames []frame) {
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	if e, ok := c.entries[addr]; ok {
+		e.Value.(*cacheEntry).frames = frames
+		c.order.MoveToFront(e)
+		return
+	}
+	c.entries[addr] = c.order.PushFront(&cacheEntry{addr: addr, frames: frames})
+	if c.order.Len() > c.size {
+		oldest := c.order.Back()
+		c.order.Remove(oldest)
+		delete(c.entries, oldest.Value.(*cacheEntry).addr)
+	}
+}
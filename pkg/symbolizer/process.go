@@ -0,0 +1,219 @@
+package symbolizer
+
+import (
+	"bufio"
+	"bytes"
+	"context"
+	"fmt"
+	"io"
+	"os/exec"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/pkg/errors"
+
+	"code-intelligence.com/cifuzz/pkg/log"
+)
+
+// process is a running llvm-symbolizer which reads the addresses to
+// symbolize from stdin, like the sanitizers use it.
+type process struct {
+	cmd    *exec.Cmd
+	stdin  io.WriteCloser
+	stdout *bufio.Reader
+	stderr bytes.Buffer
+
+	killOnce sync.Once
+}
+
+func startProcess(path string) (*process, error) {
+	// Like the sanitizers, print inlined frames and source paths as
+	// passed to the compiler, see runner.FuzzerEnvironment
+	p := &process{cmd: exec.Command(path, "--inlines", "--relativenames")}
+	var err error
+	p.stdin, err = p.cmd.StdinPipe()
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	stdout, err := p.cmd.StdoutPipe()
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	p.stdout = bufio.NewReader(stdout)
+	p.cmd.Stderr = &p.stderr
+	log.Debugf("Command: %s", p.cmd.String())
+	err = p.cmd.Start()
+	if err != nil {
+		return nil, errors.WithStack(err)
+	}
+	return p, nil
+}
+
+// symbolize returns the frames of each of the addresses.
+func (p *process) symbolize(ctx context.Context, addrs []address) ([][]frame, error) {
+	// llvm-symbolizer can't be interrupted while it symbolizes, so it's
+	// killed if the context is done
+	done := make(chan struct{})
+	defer close(done)
+	go func() {
+		select {
+		case <-ctx.Done():
+			p.kill()
+		case <-done:
+		}
+	}()
+
+	// The addresses are written while the output is read, else both
+	// processes could block on full pipes
+	writeErrCh := make(chan error, 1)
+	go func() {
+		var input bytes.Buffer
+		for _, addr := range addrs {
+			module := addr.module
+			if strings.ContainsAny(module, " \t") {
+				module = strconv.Quote(module)
+			}
+			fmt.Fprintf(&input, "%s 0x%x\n", module, addr.offset)
+		}
+		_, err := p.stdin.Write(input.Bytes())
+		writeErrCh <- errors.WithStack(err)
+	}()
+
+	// For each address, llvm-symbolizer prints pairs of lines with the
+	// function and the source location of the frame and, if it was
+	// inlined, of its callers, followed by an empty line.
+	result := make([][]frame, len(addrs))
+	for i := range addrs {
+		var frames []frame
+		for {
+			function, err := p.readLine()
+			if err != nil {
+				return nil, p.error(ctx, err)
+			}
+			if function == "" {
+				break
+			}
+			location, err := p.readLine()
+			if err != nil {
+				return nil, p.error(ctx, err)
+			}
+			if strings.HasPrefix(location, "??") {
+				if function == "??" {
+					continue
+				}
+				location = ""
+			}
+			frames = append(frames, frame{function: function, location: location})
+		}
+		result[i] = frames
+	}
+
+	err := <-writeErrCh
+	if err != nil {
+		return nil, p.error(ctx, err)
+	}
+	return result, nil
+}
+
+func (p *process) readLine() (string, error) {
+	line, err := p.stdout.ReadString('\n')
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return strings.TrimSuffix(line, "\n"), nil
+}
+
+func (p *process) error(ctx context.Context, err error) error {
+	if ctx.Err() != nil {
+		return ctx.Err()
+	}
+	// stderr is only written by the process, which is killed first
+	p.kill()
+	return errors.Wrapf(err, "llvm-symbolizer failed: %s", p.stderr.String())
+}
+
+// kill stops the process and waits for it to exit.
+func (p *process) kill() {
+	p.killOnce.Do(func() {
+		_ = p.stdin.Close()
+		_ = p.cmd.Process.Kill()
+		_ = p.cmd.Wait()
+	})
+}
+
+// processPool runs up to max llvm-symbolizer processes, which are
+// reused for the addresses of the same binary, so that each process
+// only parses its debug info once.
+type processPool struct {
+	path string
+	// The processes which are not in use
+	idle chan *process
+	// Holds a slot for every running process
+	slots chan struct{}
+
+	mutex  sync.Mutex
+	closed bool
+}
+
+func newProcessPool(path string, max int) *processPool {
+	return &processPool{
+		path:  path,
+		idle:  make(chan *process, max),
+		slots: make(chan struct{}, max),
+	}
+}
+
+// acquire returns an idle process or starts a new one, if there are
+// less than the maximum number of processes. Otherwise, it waits until
+// one is released.
+func (pool *processPool) acquire(ctx context.Context) (*process, error) {
+	select {
+	case p := <-pool.idle:
+		return p, nil
+	default:
+	}
+	select {
+	case p := <-pool.idle:
+		return p, nil
+	case pool.slots <- struct{}{}:
+		p, err := startProcess(pool.path)
+		if err != nil {
+			<-pool.slots
+			return nil, err
+		}
+		return p, nil
+	case <-ctx.Done():
+		return nil, ctx.Err()
+	}
+}
+
+// release returns the process to the pool if it can be reused, else it
+// stops it.
+func (pool *processPool) release(p *process, reuse bool) {
+	pool.mutex.Lock()
+	defer pool.mutex.Unlock()
+	if reuse && !pool.closed {
+		pool.idle <- p
+		return
+	}
+	p.kill()
+	<-pool.slots
+}
+
+// close stops the idle processes. The ones in use are stopped when they
+// are released.
+func (pool *processPool) close() {
+	pool.mutex.Lock()
+	defer pool.mutex.Unlock()
+	pool.closed = true
+	for {
+		select {
+		case p := <-pool.idle:
+			p.kill()
+			<-pool.slots
+		default:
+			return
+		}
+	}
+}
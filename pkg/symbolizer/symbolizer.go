@@ -0,0 +1,240 @@
+package symbolizer
+
+import (
+	"context"
+	"fmt"
+	"regexp"
+	"runtime"
+	"strconv"
+	"sync"
+
+	"github.com/pkg/errors"
+	"golang.org/x/sync/errgroup"
+
+	"code-intelligence.com/cifuzz/util/regexutil"
+)
+
+// The number of addresses whose frames are cached
+const defaultCacheSize = 1 << 16
+
+// rawFramePattern matches the frames of the stack traces which the
+// sanitizers print with symbolize=0, for example:
+//
+//	#0 0x55d4c3 in (/path/to/fuzz_test+0x55d4c3) (BuildId: 1a2b3c)
+//	#1 0x7f3a1c29d8f  (/lib/x86_64-linux-gnu/libc.so.6+0x29d8f)
+var rawFramePattern = regexp.MustCompile(
+	`^(?P<indent>\s*)#(?P<frame_number>\d+)\s+(?P<pc>0x[0-9a-fA-F]+)\s+(in\s+)?\((?P<module>[^()]+)\+(?P<offset>0x[0-9a-fA-F]+)\)`)
+
+type address struct {
+	module string
+	offset uint64
+}
+
+// A frame is a function and its source location, if known, one of
+// possibly several for an address with inlined calls
+type frame struct {
+	function string
+	location string
+}
+
+// Symbolizer resolves the raw frames of sanitizer stack traces to
+// functions and source locations with llvm-symbolizer. Compared to the
+// symbolization by the sanitizers, which start llvm-symbolizer in every
+// crashing process, the llvm-symbolizer processes are kept running, so
+// that each of them only loads the debug info of a binary once, and the
+// frames of recently symbolized addresses are cached, so that they
+// aren't symbolized again for the stack traces of other findings.
+type Symbolizer struct {
+	path string
+	// The maximum number of llvm-symbolizer processes per binary
+	maxProcesses int
+
+	mutex  sync.Mutex
+	pools  map[string]*processPool
+	closed bool
+
+	cache *frameCache
+}
+
+// New returns a Symbolizer which uses the llvm-symbolizer at path. It
+// has to be closed to stop the llvm-symbolizer processes.
+func New(path string) *Symbolizer {
+	// Findings of the same fuzz test are usually symbolized one after
+	// the other, so a few processes per binary suffice
+	maxProcesses := runtime.NumCPU() / 2
+	if maxProcesses < 1 {
+		maxProcesses = 1
+	} else if maxProcesses > 4 {
+		maxProcesses = 4
+	}
+	return &Symbolizer{
+		path:         path,
+		maxProcesses: maxProcesses,
+		pools:        make(map[string]*processPool),
+		cache:        newFrameCache(defaultCacheSize),
+	}
+}
+
+// HasRawFrames returns whether the logs contain frames which were not
+// symbolized.
+func HasRawFrames(logs []string) bool {
+	for _, line := range logs {
+		if rawFramePattern.MatchString(line) {
+			return true
+		}
+	}
+	return false
+}
+
+// SymbolizeLogs returns the logs with each raw frame replaced by the
+// frames of its address, in the format the sanitizers use for
+// symbolized frames. Since an address may expand to multiple inlined
+// frames, the frames of each stack trace are renumbered. It's safe to
+// call SymbolizeLogs concurrently.
+func (s *Symbolizer) SymbolizeLogs(ctx context.Context, logs []string) ([]string, error) {
+	type rawFrame struct {
+		indent      string
+		frameNumber uint64
+		pc          string
+		addr        address
+	}
+	rawFrames := make(map[int]*rawFrame)
+	resolved := make(map[address][]frame)
+	// The addresses which are not cached, by module
+	missing := make(map[string][]address)
+	for i, line := range logs {
+		matches, found := regexutil.FindNamedGroupsMatch(rawFramePattern, line)
+		if !found {
+			continue
+		}
+		frameNumber, err := strconv.ParseUint(matches["frame_number"], 10, 32)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		offset, err := strconv.ParseUint(matches["offset"], 0, 64)
+		if err != nil {
+			return nil, errors.WithStack(err)
+		}
+		f := &rawFrame{
+			indent:      matches["indent"],
+			frameNumber: frameNumber,
+			pc:          matches["pc"],
+			addr:        address{module: matches["module"], offset: offset},
+		}
+		rawFrames[i] = f
+		if _, ok := resolved[f.addr]; ok {
+			continue
+		}
+		if frames, ok := s.cache.get(f.addr); ok {
+			resolved[f.addr] = frames
+			continue
+		}
+		resolved[f.addr] = nil
+		missing[f.addr.module] = append(missing[f.addr.module], f.addr)
+	}
+	if len(rawFrames) == 0 {
+		return logs, nil
+	}
+
+	// Each module is symbolized by its own processes, so the modules
+	// can be symbolized in parallel
+	var resolvedMutex sync.Mutex
+	routines, routinesCtx := errgroup.WithContext(ctx)
+	for module, addrs := range missing {
+		module, addrs := module, addrs
+		routines.Go(func() error {
+			frames, err := s.symbolize(routinesCtx, module, addrs)
+			if err != nil {
+				return err
+			}
+			resolvedMutex.Lock()
+			defer resolvedMutex.Unlock()
+			for i, addr := range addrs {
+				resolved[addr] = frames[i]
+				s.cache.add(addr, frames[i])
+			}
+			return nil
+		})
+	}
+	err := routines.Wait()
+	if err != nil {
+		return nil, err
+	}
+
+	var result []string
+	var frameNumber int
+	for i, line := range logs {
+		f, ok := rawFrames[i]
+		if !ok {
+			result = append(result, line)
+			continue
+		}
+		if f.frameNumber == 0 {
+			// A new stack trace
+			frameNumber = 0
+		}
+		// Frames without a source location keep the module and offset,
+		// like the sanitizers print them for code without debug info
+		moduleOffset := fmt.Sprintf("(%s+0x%x)", f.addr.module, f.addr.offset)
+		frames := resolved[f.addr]
+		if len(frames) == 0 {
+			// Keep the frames which couldn't be symbolized, so that the
+			// numbering of the stack trace stays intact
+			result = append(result, fmt.Sprintf("%s#%d %s %s", f.indent, frameNumber, f.pc, moduleOffset))
+			frameNumber++
+			continue
+		}
+		for _, fr := range frames {
+			location := fr.location
+			if location == "" {
+				location = moduleOffset
+			}
+			result = append(result, fmt.Sprintf("%s#%d %s in %s %s", f.indent, frameNumber, f.pc, fr.function, location))
+			frameNumber++
+		}
+	}
+	return result, nil
+}
+
+// symbolize returns the frames of the addresses of the module, which
+// are resolved by one of the llvm-symbolizer processes of the module.
+func (s *Symbolizer) symbolize(ctx context.Context, module string, addrs []address) ([][]frame, error) {
+	pool, err := s.pool(module)
+	if err != nil {
+		return nil, err
+	}
+	p, err := pool.acquire(ctx)
+	if err != nil {
+		return nil, err
+	}
+	frames, err := p.symbolize(ctx, addrs)
+	// A process which failed may be in an unknown state, so it's
+	// replaced by a new one
+	pool.release(p, err == nil)
+	return frames, err
+}
+
+func (s *Symbolizer) pool(module string) (*processPool, error) {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	if s.closed {
+		return nil, errors.New("The symbolizer was closed")
+	}
+	pool, ok := s.pools[module]
+	if !ok {
+		pool = newProcessPool(s.path, s.maxProcesses)
+		s.pools[module] = pool
+	}
+	return pool, nil
+}
+
+// Close stops the llvm-symbolizer processes. The ones which are in use
+// are stopped once they are done.
+func (s *Symbolizer) Close() {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	s.closed = true
+	for _, pool := range s.pools {
+		pool.close()
+	}
+}
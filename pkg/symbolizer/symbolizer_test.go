@@ -0,0 +1,109 @@
+package symbolizer
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+// fakeSymbolizer creates a script which symbolizes the offset 0x10 to
+// an inlined and a regular frame, like llvm-symbolizer reading from
+// stdin, and records the processes it runs in calls.
+func fakeSymbolizer(t *testing.T) (path string, calls string) {
+	if runtime.GOOS == "windows" {
+		t.Skip("The fake llvm-symbolizer is a shell script")
+	}
+	dir := t.TempDir()
+	path = filepath.Join(dir, "llvm-symbolizer")
+	calls = filepath.Join(dir, "calls")
+	script := `#!/bin/sh
+echo "$@" >> "` + calls + `"
+while read -r module offset; do
+  case "$offset" in
+    0x10) printf 'parse_header\nsrc/parser.h:3:5\nLLVMFuzzerTestOneInputNoReturn\nsrc/parser_fuzz_test.cpp:10:3\n\n' ;;
+    0x20) printf '__libc_start_main\n??:0:0\n\n' ;;
+    *) printf '??\n??:0:0\n\n' ;;
+  esac
+done
+`
+	require.NoError(t, os.WriteFile(path, []byte(script), 0o755))
+	return path, calls
+}
+
+func TestSymbolizeLogs(t *testing.T) {
+	path, calls := fakeSymbolizer(t)
+	s := New(path)
+
+	logs := []string{
+		"==1==ERROR: AddressSanitizer: heap-buffer-overflow on address 0x602000000011",
+		"READ of size 1 at 0x602000000011 thread T0",
+		"    #0 0x55d4c3 in (/build/parser_fuzz_test+0x10) (BuildId: 1a2b3c)",
+		"    #1 0x7f3a1c20  (/lib/x86_64-linux-gnu/libc.so.6+0x20) (BuildId: 4d5e6f)",
+		"    #2 0x55d4d0  (/build/parser_fuzz_test+0x30) (BuildId: 1a2b3c)",
+		"",
+		"0x602000000011 is located 0 bytes after 1-byte region",
+		"    #0 0x4a5b6c in (/build/parser_fuzz_test+0x10)",
+	}
+	symbolized, err := s.SymbolizeLogs(context.Background(), logs)
+	require.NoError(t, err)
+	assert.Equal(t, []string{
+		"==1==ERROR: AddressSanitizer: heap-buffer-overflow on address 0x602000000011",
+		"READ of size 1 at 0x602000000011 thread T0",
+		"    #0 0x55d4c3 in parse_header src/parser.h:3:5",
+		"    #1 0x55d4c3 in LLVMFuzzerTestOneInputNoReturn src/parser_fuzz_test.cpp:10:3",
+		"    #2 0x7f3a1c20 in __libc_start_main (/lib/x86_64-linux-gnu/libc.so.6+0x20)",
+		"    #3 0x55d4d0 (/build/parser_fuzz_test+0x30)",
+		"",
+		"0x602000000011 is located 0 bytes after 1-byte region",
+		"    #0 0x4a5b6c in parse_header src/parser.h:3:5",
+		"    #1 0x4a5b6c in LLVMFuzzerTestOneInputNoReturn src/parser_fuzz_test.cpp:10:3",
+	}, symbolized)
+	assert.True(t, HasRawFrames(logs))
+
+	// The process of the binary is reused for addresses which aren't
+	// cached yet
+	symbolized, err = s.SymbolizeLogs(context.Background(), []string{"    #0 0x55d4c3 in (/build/parser_fuzz_test+0x20)"})
+	require.NoError(t, err)
+	assert.Equal(t, []string{"    #0 0x55d4c3 in __libc_start_main (/build/parser_fuzz_test+0x20)"}, symbolized)
+	invocations, err := os.ReadFile(calls)
+	require.NoError(t, err)
+	// One process for the fuzz test and one for libc
+	assert.Len(t, strings.Split(strings.TrimSpace(string(invocations)), "\n"), 2)
+
+	// No process is used for cached addresses, even after the
+	// processes were stopped
+	s.Close()
+	_, err = s.SymbolizeLogs(context.Background(), logs[2:3])
+	require.NoError(t, err)
+}
+
+func TestFrameCache(t *testing.T) {
+	c := newFrameCache(2)
+	a, b, d := address{module: "m", offset: 1}, address{module: "m", offset: 2}, address{module: "m", offset: 3}
+	c.add(a, []frame{{function: "a"}})
+	c.add(b, nil)
+	// Using a makes b the least recently used entry
+	_, ok := c.get(a)
+	require.True(t, ok)
+	c.add(d, nil)
+	_, ok = c.get(b)
+	assert.False(t, ok)
+	frames, ok := c.get(a)
+	require.True(t, ok)
+	assert.Equal(t, []frame{{function: "a"}}, frames)
+}
+
+func TestSymbolizeLogs_NoRawFrames(t *testing.T) {
+	// Stack traces which were symbolized by the sanitizers are kept
+	logs := []string{"    #0 0x55d4c3 in parse_header src/parser.h:3:5"}
+	symbolized, err := New("/does/not/exist").SymbolizeLogs(context.Background(), logs)
+	require.NoError(t, err)
+	assert.Equal(t, logs, symbolized)
+	assert.False(t, HasRawFrames(logs))
+}
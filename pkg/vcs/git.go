@@ -1,7 +1,9 @@
 package vcs
 
 import (
+	"os"
 	"os/exec"
+	"path/filepath"
 	"strings"
 
 	"github.com/pkg/errors"
@@ -31,6 +33,18 @@ func GitBranch() (string, error) {
 	return strings.TrimSpace(string(branch)), nil
 }
 
+// GitTopLevel returns the top-level directory of the Git repository
+// containing dir.
+func GitTopLevel(dir string) (string, error) {
+	cmd := exec.Command("git", "rev-parse", "--show-toplevel")
+	cmd.Dir = dir
+	out, err := cmd.Output()
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	return filepath.FromSlash(strings.TrimSpace(string(out))), nil
+}
+
 // GitIsDirty returns true if and only if the current working directory is contained in a Git repository that has
 // uncommitted changes and/or untracked files.
 func GitIsDirty() bool {
@@ -41,3 +55,69 @@ func GitIsDirty() bool {
 	}
 	return len(strings.TrimSpace(string(commit))) != 0
 }
+
+// GitWorkingTreeHash returns the hash of a Git tree object which
+// contains the current content of all files in the Git repository
+// containing dir, including uncommitted changes and untracked files
+// which are not ignored. Files matching one of the excluded glob
+// patterns, which are relative to the top-level directory of the
+// repository, are left out. The hash only changes if the content of
+// the working tree changes.
+//
+// The files are added to a copy of the index, so that Git only has to
+// read the files which changed since they were last added to it. This
+// writes the blobs of changed files to the object database, like
+// "git stash" does.
+func GitWorkingTreeHash(dir string, excludes ...string) (string, error) {
+	cmd := exec.Command("git", "rev-parse", "--git-path", "index")
+	cmd.Dir = dir
+	out, err := cmd.Output()
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	indexPath := strings.TrimSpace(string(out))
+	if !filepath.IsAbs(indexPath) {
+		indexPath = filepath.Join(dir, indexPath)
+	}
+	index, err := os.ReadFile(indexPath)
+	if err != nil && !os.IsNotExist(err) {
+		return "", errors.WithStack(err)
+	}
+
+	tmpIndex, err := os.CreateTemp("", "cifuzz-git-index-")
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	defer os.Remove(tmpIndex.Name())
+	_, err = tmpIndex.Write(index)
+	closeErr := tmpIndex.Close()
+	if err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	env := append(os.Environ(), "GIT_INDEX_FILE="+tmpIndex.Name())
+
+	args := []string{"add", "--all", "--", ":(top)"}
+	for _, exclude := range excludes {
+		args = append(args, ":(top,exclude,glob)"+exclude)
+	}
+	cmd = exec.Command("git", args...)
+	cmd.Dir = dir
+	cmd.Env = env
+	out, err = cmd.CombinedOutput()
+	if err != nil {
+		return "", errors.Wrapf(err, "git add failed: %s", strings.TrimSpace(string(out)))
+	}
+
+	cmd = exec.Command("git", "write-tree")
+	cmd.Dir = dir
+	cmd.Env = env
+	tree, err := cmd.Output()
+	if err != nil {
+		return "", errors.WithStack(err)
+	}
+	log.Debugf("Current Git working tree: %s", string(tree))
+	return strings.TrimSpace(string(tree)), nil
+}
@@ -72,6 +72,48 @@ func TestGitIsDirty(t *testing.T) {
 	require.True(t, vcs.GitIsDirty())
 }
 
+func TestGitWorkingTreeHash(t *testing.T) {
+	repo := createGitRepoWithCommits(t)
+	defer os.RemoveAll(repo)
+
+	hash1, err := vcs.GitWorkingTreeHash(repo, "**/build/**")
+	require.NoError(t, err)
+
+	// Excluded files don't change the hash
+	err = os.MkdirAll(filepath.Join(repo, "sub", "build"), 0o755)
+	require.NoError(t, err)
+	err = fileutil.Touch(filepath.Join(repo, "sub", "build", "output"))
+	require.NoError(t, err)
+	hash2, err := vcs.GitWorkingTreeHash(filepath.Join(repo, "sub"), "**/build/**")
+	require.NoError(t, err)
+	require.Equal(t, hash1, hash2)
+
+	// Modified and untracked files do, without changing the index
+	err = os.WriteFile(filepath.Join(repo, "empty_file"), []byte("changed"), 0o644)
+	require.NoError(t, err)
+	hash3, err := vcs.GitWorkingTreeHash(repo, "**/build/**")
+	require.NoError(t, err)
+	require.NotEqual(t, hash1, hash3)
+
+	err = fileutil.Touch(filepath.Join(repo, "third_file"))
+	require.NoError(t, err)
+	hash4, err := vcs.GitWorkingTreeHash(repo, "**/build/**")
+	require.NoError(t, err)
+	require.NotEqual(t, hash3, hash4)
+
+	cmd := exec.Command("git", "diff", "--cached", "--quiet")
+	cmd.Dir = repo
+	require.NoError(t, cmd.Run())
+
+	// Reverting the changes restores the hash
+	runGit(t, repo, "checkout", "--", ".")
+	err = os.Remove(filepath.Join(repo, "third_file"))
+	require.NoError(t, err)
+	hash5, err := vcs.GitWorkingTreeHash(repo, "**/build/**")
+	require.NoError(t, err)
+	require.Equal(t, hash1, hash5)
+}
+
 func createGitRepoWithCommits(t *testing.T) string {
 	t.Helper()
 
@@ -13,8 +13,10 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <inttypes.h>
 #include <linux/capability.h>
 #include <linux/filter.h>
+#include <poll.h>
 #include <sched.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -23,22 +25,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/capability.h>
+#include <sys/ioctl.h>
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/select.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
 #include <sys/user.h>
 #include <sys/wait.h>
 #include <syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "libminijail.h"
 #include "libminijail-private.h"
 
+#include "arch.h"
 #include "signal_handler.h"
 #include "syscall_filter.h"
 #include "syscall_wrapper.h"
@@ -152,6 +158,7 @@ struct minijail {
 		int new_session_keyring : 1;
 		int forward_signals : 1;
 		int setsid : 1;
+		int log_timing : 1;
 	} flags;
 	uid_t uid;
 	gid_t gid;
@@ -172,7 +179,11 @@ struct minijail {
 	char *preload_path;
 	size_t filter_len;
 	struct sock_fprog *filter_prog;
+	char *seccomp_profile_path;
+	/* The user notification listener of the profiled program. */
+	int seccomp_profile_fd;
 	char *alt_syscall_table;
+	char *working_dir;
 	struct mountpoint *mounts_head;
 	struct mountpoint *mounts_tail;
 	size_t mounts_count;
@@ -194,6 +205,27 @@ struct minijail {
 static void run_hooks_or_die(const struct minijail *j,
 			     minijail_hook_event_t event);
 
+/*
+ * Returns the current time of the monotonic clock in microseconds if phase
+ * timing is enabled by minijail_log_timing(), else 0, so that the clock is
+ * only read when the result is logged.
+ */
+static uint64_t timing_start(const struct minijail *j)
+{
+	struct timespec ts;
+	if (!j->flags.log_timing || clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Logs how long |phase| took since |start| was returned by timing_start(). */
+static void log_timing(const struct minijail *j, const char *phase,
+		       uint64_t start)
+{
+	uint64_t now = timing_start(j);
+	if (start && now)
+		info("timing: %s %" PRIu64 "us", phase, now - start);
+}
 
 static bool seccomp_is_logging_allowed(const struct minijail *j)
 {
@@ -295,6 +327,7 @@ void minijail_preexec(struct minijail *j)
 	int uts = j->flags.uts;
 	int remount_proc_ro = j->flags.remount_proc_ro;
 	int userns = j->flags.userns;
+	int log_timing = j->flags.log_timing;
 	if (j->user)
 		free(j->user);
 	j->user = NULL;
@@ -314,6 +347,7 @@ void minijail_preexec(struct minijail *j)
 	j->flags.uts = uts;
 	j->flags.remount_proc_ro = remount_proc_ro;
 	j->flags.userns = userns;
+	j->flags.log_timing = log_timing;
 	/* Note, |pids| will already have been used before this call. */
 }
 
@@ -473,6 +507,17 @@ void API minijail_log_seccomp_filter_failures(struct minijail *j)
 	}
 }
 
+int API minijail_set_seccomp_profile(struct minijail *j, const char *path)
+{
+	if (j->seccomp_profile_path)
+		return -EINVAL;
+	j->seccomp_profile_path = strdup(path);
+	if (!j->seccomp_profile_path)
+		return -ENOMEM;
+	j->seccomp_profile_fd = -1;
+	return 0;
+}
+
 void API minijail_use_caps(struct minijail *j, uint64_t capmask)
 {
 	/*
@@ -623,6 +668,11 @@ void API minijail_close_open_fds(struct minijail *j)
 	j->flags.close_open_fds = 1;
 }
 
+void API minijail_log_timing(struct minijail *j)
+{
+	j->flags.log_timing = 1;
+}
+
 void API minijail_remount_proc_readonly(struct minijail *j)
 {
 	j->flags.vfs = 1;
@@ -701,6 +751,16 @@ int API minijail_enter_pivot_root(struct minijail *j, const char *dir)
 	return 0;
 }
 
+int API minijail_set_working_dir(struct minijail *j, const char *dir)
+{
+	if (j->working_dir)
+		return -EINVAL;
+	j->working_dir = strdup(dir);
+	if (!j->working_dir)
+		return -ENOMEM;
+	return 0;
+}
+
 char API *minijail_get_original_path(struct minijail *j,
 				     const char *path_inside_chroot)
 {
@@ -1146,6 +1206,12 @@ void API minijail_parse_seccomp_filters(struct minijail *j, const char *path)
 	}
 }
 
+const struct sock_fprog API *
+minijail_get_seccomp_filter(const struct minijail *j)
+{
+	return j->filter_prog;
+}
+
 void API minijail_parse_seccomp_filters_from_fd(struct minijail *j, int fd)
 {
 	char *fd_path, *path;
@@ -1270,6 +1336,8 @@ static void minijail_marshal_helper(struct marshal_state *state,
 		marshal_append(state, j->alt_syscall_table,
 			       strlen(j->alt_syscall_table) + 1);
 	}
+	if (j->working_dir)
+		marshal_append_string(state, j->working_dir);
 	if (j->flags.seccomp_filter && j->filter_prog) {
 		struct sock_fprog *fp = j->filter_prog;
 		marshal_append(state, (char *)fp->filter,
@@ -1320,6 +1388,8 @@ int minijail_unmarshal(struct minijail *j, char *serialized, size_t length)
 	j->remounts_head = NULL;
 	j->remounts_tail = NULL;
 	j->filter_prog = NULL;
+	j->seccomp_profile_path = NULL;
+	j->seccomp_profile_fd = -1;
 	j->hooks_head = NULL;
 	j->hooks_tail = NULL;
 
@@ -1376,6 +1446,15 @@ int minijail_unmarshal(struct minijail *j, char *serialized, size_t length)
 			goto bad_syscall_table;
 	}
 
+	if (j->working_dir) {	/* stale pointer */
+		char *working_dir = consumestr(&serialized, &length);
+		if (!working_dir)
+			goto bad_working_dir;
+		j->working_dir = strdup(working_dir);
+		if (!j->working_dir)
+			goto bad_working_dir;
+	}
+
 	if (j->flags.seccomp_filter && j->filter_len > 0) {
 		size_t ninstrs = j->filter_len;
 		if (ninstrs > (SIZE_MAX / sizeof(struct sock_filter)) ||
@@ -1458,6 +1537,9 @@ bad_filter_prog_instrs:
 	if (j->filter_prog)
 		free(j->filter_prog);
 bad_filters:
+	if (j->working_dir)
+		free(j->working_dir);
+bad_working_dir:
 	if (j->alt_syscall_table)
 		free(j->alt_syscall_table);
 bad_syscall_table:
@@ -1478,6 +1560,7 @@ clear_pointers:
 	j->chrootdir = NULL;
 	j->hostname = NULL;
 	j->alt_syscall_table = NULL;
+	j->working_dir = NULL;
 	j->cgroup_count = 0;
 out:
 	return ret;
@@ -1640,6 +1723,69 @@ static int mount_dev_finalize(const struct minijail *j, char *dev_path)
  *
  * Returns 0 for success.
  */
+/*
+ * Bind mounts with only these flags can be set up with the new mount API, see
+ * bind_mount_attached().
+ */
+#define MS_BIND_ATTR_MASK                                                      \
+	(MS_BIND | MS_REC | MS_RDONLY | MS_NOSUID | MS_NODEV | MS_NOEXEC)
+
+/* Whether the kernel supports the new mount API, until it has failed once. */
+static bool new_mount_api_available = true;
+
+/*
+ * Bind-mounts |m| at |dest| by attaching a detached copy of the source tree
+ * with its flags already applied, which saves the remount that changing the
+ * 'ro' flag requires otherwise. The flags are also applied to all submounts if
+ * MS_REC is set. Returns -ENOSYS if the new mount API isn't available, in which
+ * case nothing was mounted.
+ */
+static int bind_mount_attached(const struct mountpoint *m, const char *dest)
+{
+	unsigned int recursive = (m->flags & MS_REC) ? AT_RECURSIVE : 0;
+	struct minijail_mount_attr attr = {0};
+
+	int tree = sys_open_tree(AT_FDCWD, m->src,
+				 OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | recursive);
+	if (tree < 0) {
+		/*
+		 * Seccomp policies of container runtimes usually block unknown
+		 * syscalls with EPERM.
+		 */
+		if (errno == ENOSYS || errno == EPERM) {
+			new_mount_api_available = false;
+			return -ENOSYS;
+		}
+		return -errno;
+	}
+
+	if (m->flags & MS_RDONLY)
+		attr.attr_set |= MOUNT_ATTR_RDONLY;
+	if (m->flags & MS_NOSUID)
+		attr.attr_set |= MOUNT_ATTR_NOSUID;
+	if (m->flags & MS_NODEV)
+		attr.attr_set |= MOUNT_ATTR_NODEV;
+	if (m->flags & MS_NOEXEC)
+		attr.attr_set |= MOUNT_ATTR_NOEXEC;
+	if (attr.attr_set &&
+	    sys_mount_setattr(tree, "", AT_EMPTY_PATH | recursive, &attr,
+			      sizeof(attr))) {
+		int saved_errno = errno;
+		close(tree);
+		if (saved_errno == ENOSYS || saved_errno == EPERM) {
+			new_mount_api_available = false;
+			return -ENOSYS;
+		}
+		return -saved_errno;
+	}
+
+	int ret = sys_move_mount(tree, "", AT_FDCWD, dest,
+				 MOVE_MOUNT_F_EMPTY_PATH);
+	int saved_errno = errno;
+	close(tree);
+	return ret ? -saved_errno : 0;
+}
+
 static int mount_one(const struct minijail *j, struct mountpoint *m,
 		     const char *dev_path)
 {
@@ -1668,6 +1814,19 @@ static int mount_one(const struct minijail *j, struct mountpoint *m,
 		goto error;
 	}
 
+	if (new_mount_api_available && (m->flags & MS_BIND) &&
+	    (m->flags & ~MS_BIND_ATTR_MASK) == 0) {
+		ret = bind_mount_attached(m, dest);
+		if (ret == 0)
+			goto next;
+		if (ret != -ENOSYS) {
+			errno = -ret;
+			pwarn("cannot bind-mount '%s' as '%s' with flags %#lx",
+			      m->src, dest, m->flags);
+			goto error;
+		}
+	}
+
 	/*
 	 * Bind mounts that change the 'ro' flag have to be remounted since
 	 * 'bind' and other flags can't both be specified in the same command.
@@ -1705,6 +1864,7 @@ static int mount_one(const struct minijail *j, struct mountpoint *m,
 		}
 	}
 
+next:
 	free(dest);
 	if (m->next)
 		return mount_one(j, m->next, dev_path);
@@ -2187,6 +2347,229 @@ static void set_seccomp_filter(const struct minijail *j)
 	}
 }
 
+/* Syscalls with higher numbers are not counted by profile_syscalls(). */
+#define SECCOMP_PROFILE_MAX_NR 1024
+
+/*
+ * bpf.h can't be used here, because <linux/filter.h> defines BPF_H, so load
+ * the low 32 bits of the first argument ourselves.
+ */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+# define SECCOMP_PROFILE_ARG0_LO                                               \
+	(offsetof(struct minijail_seccomp_data, args[0]) + 4)
+#else
+# define SECCOMP_PROFILE_ARG0_LO offsetof(struct minijail_seccomp_data, args[0])
+#endif
+
+#define SECCOMP_IOCTL_NOTIF_RECV                                               \
+	_IOWR('!', 0, struct minijail_seccomp_notif)
+#define SECCOMP_IOCTL_NOTIF_SEND                                               \
+	_IOWR('!', 1, struct minijail_seccomp_notif_resp)
+
+/*
+ * Installs a seccomp filter which notifies a listener of all syscalls of the
+ * native architecture and sends the listener to the parent over |sock_fd|.
+ * Sending it is the only syscall which doesn't have to be handled by the
+ * listener, which would deadlock.
+ */
+static void send_seccomp_listener_or_die(int sock_fd)
+{
+	struct sock_filter filter[] = {
+	    BPF_STMT(BPF_LD + BPF_W + BPF_ABS,
+		     offsetof(struct minijail_seccomp_data, arch)),
+	    BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, MINIJAIL_ARCH_NR, 1, 0),
+	    BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
+	    BPF_STMT(BPF_LD + BPF_W + BPF_ABS,
+		     offsetof(struct minijail_seccomp_data, nr)),
+	    BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_sendmsg, 0, 3),
+	    BPF_STMT(BPF_LD + BPF_W + BPF_ABS, SECCOMP_PROFILE_ARG0_LO),
+	    BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, (unsigned int)sock_fd, 0, 1),
+	    BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
+	    BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_USER_NOTIF),
+	};
+	struct sock_fprog prog = {
+	    .len = ARRAY_SIZE(filter),
+	    .filter = filter,
+	};
+
+	int listener = sys_seccomp(SECCOMP_SET_MODE_FILTER,
+				   SECCOMP_FILTER_FLAG_NEW_LISTENER, &prog);
+	if (listener < 0)
+		pdie("failed to install the seccomp profiling filter");
+
+	char control[CMSG_SPACE(sizeof(listener))];
+	char data = 0;
+	struct iovec iov = {.iov_base = &data, .iov_len = sizeof(data)};
+	struct msghdr msg = {
+	    .msg_iov = &iov,
+	    .msg_iovlen = 1,
+	    .msg_control = control,
+	    .msg_controllen = sizeof(control),
+	};
+	memset(control, 0, sizeof(control));
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(listener));
+	memcpy(CMSG_DATA(cmsg), &listener, sizeof(listener));
+	if (sendmsg(sock_fd, &msg, 0) != sizeof(data))
+		pdie("failed to send the seccomp listener");
+	/* The listener is closed on execve(2), like |sock_fd|. */
+}
+
+/* Returns the listener sent by the child, or -1 if it didn't send it. */
+static int receive_seccomp_listener(int sock_fd)
+{
+	int listener = -1;
+	char control[CMSG_SPACE(sizeof(listener))];
+	char data;
+	struct iovec iov = {.iov_base = &data, .iov_len = sizeof(data)};
+	struct msghdr msg = {
+	    .msg_iov = &iov,
+	    .msg_iovlen = 1,
+	    .msg_control = control,
+	    .msg_controllen = sizeof(control),
+	};
+
+	ssize_t ret;
+	do {
+		ret = recvmsg(sock_fd, &msg, MSG_CMSG_CLOEXEC);
+	} while (ret < 0 && errno == EINTR);
+	struct cmsghdr *cmsg = ret > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+	    cmsg->cmsg_type != SCM_RIGHTS) {
+		warn("child did not send the seccomp listener");
+		return -1;
+	}
+	memcpy(&listener, CMSG_DATA(cmsg), sizeof(listener));
+	return listener;
+}
+
+struct syscall_count {
+	int nr;
+	uint64_t count;
+};
+
+static int compare_syscall_counts(const void *a, const void *b)
+{
+	const struct syscall_count *count_a = a;
+	const struct syscall_count *count_b = b;
+
+	if (count_a->count != count_b->count)
+		return count_a->count < count_b->count ? 1 : -1;
+	return count_a->nr - count_b->nr;
+}
+
+static void write_seccomp_profile(const struct minijail *j,
+				  const uint64_t *counts)
+{
+	struct syscall_count syscalls[SECCOMP_PROFILE_MAX_NR];
+	size_t count = 0;
+
+	for (int nr = 0; nr < SECCOMP_PROFILE_MAX_NR; nr++) {
+		if (counts[nr] > 0) {
+			syscalls[count].nr = nr;
+			syscalls[count].count = counts[nr];
+			count++;
+		}
+	}
+	qsort(syscalls, count, sizeof(syscalls[0]), compare_syscall_counts);
+
+	FILE *f = fopen(j->seccomp_profile_path, "we");
+	if (!f) {
+		pwarn("failed to open %s", j->seccomp_profile_path);
+		return;
+	}
+	fprintf(f, "# Syscalls of a profiled run, the most frequent first.\n");
+	for (size_t i = 0; i < count; i++) {
+		const char *name = lookup_syscall_name(syscalls[i].nr);
+		fprintf(f, "# %" PRIu64 " calls\n", syscalls[i].count);
+		if (name)
+			fprintf(f, "%s: 1\n", name);
+		else
+			fprintf(f, "# unknown syscall %d\n", syscalls[i].nr);
+	}
+	if (fclose(f))
+		pwarn("failed to write %s", j->seccomp_profile_path);
+}
+
+/*
+ * Counts the syscalls notified by j->seccomp_profile_fd, lets them continue
+ * and writes the counts once the jailed program exited.
+ */
+static void profile_syscalls(const struct minijail *j)
+{
+	struct minijail_seccomp_notif_sizes sizes;
+	if (sys_seccomp(SECCOMP_GET_NOTIF_SIZES, 0, &sizes)) {
+		pwarn("seccomp(SECCOMP_GET_NOTIF_SIZES) failed");
+		return;
+	}
+	/* Newer kernels may use larger structs. */
+	size_t req_size =
+	    MAX(sizes.seccomp_notif, sizeof(struct minijail_seccomp_notif));
+	size_t resp_size = MAX(sizes.seccomp_notif_resp,
+			       sizeof(struct minijail_seccomp_notif_resp));
+	struct minijail_seccomp_notif *req = calloc(1, req_size);
+	struct minijail_seccomp_notif_resp *resp = calloc(1, resp_size);
+	uint64_t *counts = calloc(SECCOMP_PROFILE_MAX_NR, sizeof(*counts));
+	if (!req || !resp || !counts)
+		die("failed to allocate seccomp notification buffers");
+
+	struct pollfd pfd = {.fd = j->seccomp_profile_fd, .events = POLLIN};
+	while (true) {
+		int ret = poll(&pfd, 1, 1000);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			pwarn("failed to poll the seccomp listener");
+			break;
+		}
+		if (ret == 0) {
+			/*
+			 * Before Linux 5.8, the listener isn't hung up once
+			 * the program exited, so check whether it did.
+			 */
+			siginfo_t info = {0};
+			if (waitid(P_PID, j->initpid, &info,
+				   WEXITED | WNOHANG | WNOWAIT) == 0 &&
+			    info.si_pid != 0) {
+				break;
+			}
+			continue;
+		}
+		/* The listener is hung up once the program exited. */
+		if (!(pfd.revents & POLLIN))
+			break;
+
+		memset(req, 0, req_size);
+		if (ioctl(j->seccomp_profile_fd, SECCOMP_IOCTL_NOTIF_RECV,
+			  req)) {
+			/* The notifying thread may have been killed. */
+			if (errno == EINTR || errno == ENOENT)
+				continue;
+			pwarn("failed to receive a seccomp notification");
+			break;
+		}
+		if (req->data.nr >= 0 && req->data.nr < SECCOMP_PROFILE_MAX_NR)
+			counts[req->data.nr]++;
+
+		memset(resp, 0, resp_size);
+		resp->id = req->id;
+		resp->flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+		if (ioctl(j->seccomp_profile_fd, SECCOMP_IOCTL_NOTIF_SEND,
+			  resp) &&
+		    errno != ENOENT) {
+			pwarn("failed to continue a notified syscall");
+			break;
+		}
+	}
+
+	write_seccomp_profile(j, counts);
+	free(counts);
+	free(resp);
+	free(req);
+}
+
 static pid_t forward_pid = -1;
 
 static void forward_signal(int sig,
@@ -2284,6 +2667,7 @@ void API minijail_enter(const struct minijail *j)
 	 * so we don't even try. If any of our operations fail, we abort() the
 	 * entire process.
 	 */
+	uint64_t start = timing_start(j);
 	if (j->flags.enter_vfs) {
 		if (setns(j->mountns_fd, CLONE_NEWNS))
 			pdie("setns(CLONE_NEWNS) failed");
@@ -2354,14 +2738,20 @@ void API minijail_enter(const struct minijail *j)
 			pdie("keyctl(KEYCTL_JOIN_SESSION_KEYRING) failed");
 	}
 
+	log_timing(j, "namespaces", start);
+
 	/* We have to process all the mounts before we chroot/pivot_root. */
+	start = timing_start(j);
 	process_mounts_or_die(j);
+	log_timing(j, "mounts", start);
 
 	if (j->flags.chroot && enter_chroot(j))
 		pdie("chroot");
 
+	start = timing_start(j);
 	if (j->flags.pivot_root && enter_pivot_root(j))
 		pdie("pivot_root");
+	log_timing(j, "pivot_root", start);
 
 	if (j->flags.mount_tmp && mount_tmp(j))
 		pdie("mount_tmp");
@@ -2369,6 +2759,14 @@ void API minijail_enter(const struct minijail *j)
 	if (j->flags.remount_proc_ro && remount_proc_readonly(j))
 		pdie("remount");
 
+	/*
+	 * Change the working directory after entering the new root, in which
+	 * the path is resolved, and before seccomp could block chdir(2).
+	 */
+	if (j->working_dir && chdir(j->working_dir))
+		pdie("failed to change the working directory to '%s'",
+		     j->working_dir);
+
 	run_hooks_or_die(j, MINIJAIL_HOOK_EVENT_PRE_DROP_CAPS);
 
 	/*
@@ -2405,7 +2803,9 @@ void API minijail_enter(const struct minijail *j)
 		 */
 		drop_ugid(j);
 		drop_caps(j, last_valid_cap);
+		start = timing_start(j);
 		set_seccomp_filter(j);
+		log_timing(j, "seccomp", start);
 	} else {
 		/*
 		 * If we're not setting no_new_privs,
@@ -2414,7 +2814,9 @@ void API minijail_enter(const struct minijail *j)
 		 * setgroups()/setresgid()/setresuid() for dropping root and
 		 * capget()/capset()/prctl() for dropping caps.
 		 */
+		start = timing_start(j);
 		set_seccomp_filter(j);
+		log_timing(j, "seccomp", start);
 		drop_ugid(j);
 		drop_caps(j, last_valid_cap);
 	}
@@ -2487,8 +2889,16 @@ int API minijail_from_fd(int fd, struct minijail *j)
 		free(buf);
 		return -EINVAL;
 	}
+	/* The flags are only known after unmarshalling. */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 	r = minijail_unmarshal(j, buf, sz);
 	free(buf);
+	if (!r && j->flags.log_timing) {
+		uint64_t start =
+		    (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+		log_timing(j, "unmarshal", start);
+	}
 	return r;
 }
 
@@ -2498,20 +2908,20 @@ int API minijail_to_fd(struct minijail *j, int fd)
 	if (!sz)
 		return -EINVAL;
 
-	char *buf = malloc(sz);
+	/*
+	 * Sends [size][minijail] with a single write(2), so that the child
+	 * blocked in minijail_from_fd() is woken up only once.
+	 */
+	char *buf = malloc(sizeof(sz) + sz);
 	if (!buf)
 		return -ENOMEM;
 
-	int err = minijail_marshal(j, buf, sz);
+	memcpy(buf, &sz, sizeof(sz));
+	int err = minijail_marshal(j, buf + sizeof(sz), sz);
 	if (err)
 		goto error;
 
-	/* Sends [size][minijail]. */
-	err = write_exactly(fd, &sz, sizeof(sz));
-	if (err)
-		goto error;
-
-	err = write_exactly(fd, buf, sz);
+	err = write_exactly(fd, buf, sizeof(sz) + sz);
 
 error:
 	free(buf);
@@ -2577,10 +2987,52 @@ static int setup_pipe(char ***child_env, int fds[2])
 	return minijail_setenv(child_env, kFdEnvVar, fd_buf, 1);
 }
 
+/*
+ * Closes all file descriptors except the |size| ones in |inheritable_fds| with
+ * one close_range(2) call for each range between them, which is much faster
+ * than closing them one by one if many are open.
+ */
+static int close_fd_ranges(const int *inheritable_fds, size_t size)
+{
+	int fds[size + 1];
+	size_t count = 0;
+	unsigned int first = 0;
+
+	/* Sort the fds, there are only a few of them. */
+	for (size_t i = 0; i < size; ++i) {
+		const int fd = inheritable_fds[i];
+		size_t j;
+
+		if (fd < 0)
+			continue;
+		for (j = count++; j > 0 && fds[j - 1] > fd; --j)
+			fds[j] = fds[j - 1];
+		fds[j] = fd;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		unsigned int fd = fds[i];
+		if (fd > first && sys_close_range(first, fd - 1, 0) != 0)
+			return -1;
+		if (fd >= first)
+			first = fd + 1;
+	}
+	return sys_close_range(first, ~0U, 0);
+}
+
 static int close_open_fds(int *inheritable_fds, size_t size)
 {
 	const char *kFdPath = "/proc/self/fd";
 
+	/*
+	 * Fall back to closing the fds listed in /proc/self/fd if
+	 * close_range(2) fails, e.g. because the kernel predates Linux 5.9.
+	 * Since closing is idempotent, it doesn't matter which fds were
+	 * closed already.
+	 */
+	if (close_fd_ranges(inheritable_fds, size) == 0)
+		return 0;
+
 	DIR *d = opendir(kFdPath);
 	struct dirent *dir_entry;
 
@@ -2698,6 +3150,8 @@ struct minijail_run_state {
 	int stdout_fds[2];
 	int stderr_fds[2];
 	int child_sync_pipe_fds[2];
+	/* The socket over which the child sends the seccomp listener. */
+	int seccomp_profile_fds[2];
 	char **child_env;
 };
 
@@ -2709,7 +3163,7 @@ static int avoid_pipe_conflicts(struct minijail_run_state *state,
 	int *pipe_fds[] = {
 	    state->pipe_fds,   state->child_sync_pipe_fds,
 	    state->stdin_fds,  state->stdout_fds,
-	    state->stderr_fds,
+	    state->stderr_fds, state->seccomp_profile_fds,
 	};
 	for (size_t i = 0; i < ARRAY_SIZE(pipe_fds); ++i) {
 		if (pipe_fds[i][0] != -1 &&
@@ -2779,7 +3233,8 @@ static void minijail_free_run_state(struct minijail_run_state *state)
 	state->child_pid = -1;
 
 	int *fd_pairs[] = {state->pipe_fds, state->stdin_fds, state->stdout_fds,
-			   state->stderr_fds, state->child_sync_pipe_fds};
+			   state->stderr_fds, state->child_sync_pipe_fds,
+			   state->seccomp_profile_fds};
 	for (size_t i = 0; i < ARRAY_SIZE(fd_pairs); ++i) {
 		close_and_reset(&fd_pairs[i][0]);
 		close_and_reset(&fd_pairs[i][1]);
@@ -3052,11 +3507,19 @@ static int minijail_run_internal(struct minijail *j,
 	 */
 	int do_init = j->flags.do_init && !j->flags.run_as_init;
 	int use_preload = config->use_preload;
+	/* The child logs how long it took until it executes the program. */
+	uint64_t run_start = timing_start(j);
 
 	if (config->filename != NULL && config->elf_fd != -1) {
 		die("filename and elf_fd cannot be set at the same time");
 	}
 
+	if (j->seccomp_profile_path &&
+	    (use_preload || !config->exec_in_child)) {
+		die("seccomp profiling is not supported with LD_PRELOAD or "
+		    "minijail_fork()");
+	}
+
 	if (use_preload) {
 		if (j->hooks_head != NULL)
 			die("Minijail hooks are not supported with LD_PRELOAD");
@@ -3112,6 +3575,12 @@ static int minijail_run_internal(struct minijail *j,
 			return -EFAULT;
 	}
 
+	if (j->seccomp_profile_path &&
+	    socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0,
+		       state_out->seccomp_profile_fds)) {
+		return -EFAULT;
+	}
+
 	/*
 	 * Use sys_clone() if and only if we're creating a pid namespace.
 	 *
@@ -3154,6 +3623,7 @@ static int minijail_run_internal(struct minijail *j,
 	 * case.
 	 */
 	pid_t child_pid;
+	uint64_t clone_start = timing_start(j);
 	if (pid_namespace) {
 		unsigned long clone_flags = CLONE_NEWPID | SIGCHLD;
 		if (j->flags.userns)
@@ -3204,6 +3674,13 @@ static int minijail_run_internal(struct minijail *j,
 		if (sync_child)
 			parent_setup_complete(state_out->child_sync_pipe_fds);
 
+		if (j->seccomp_profile_path) {
+			close_and_reset(&state_out->seccomp_profile_fds[1]);
+			j->seccomp_profile_fd =
+			    receive_seccomp_listener(state_out->seccomp_profile_fds[0]);
+			close_and_reset(&state_out->seccomp_profile_fds[0]);
+		}
+
 		if (use_preload) {
 			/*
 			 * Add SIGPIPE to the signal mask to avoid getting
@@ -3255,6 +3732,8 @@ static int minijail_run_internal(struct minijail *j,
 	}
 
 	/* Child process. */
+	log_timing(j, "clone", clone_start);
+
 	if (j->flags.reset_signal_mask) {
 		sigset_t signal_mask;
 		if (sigemptyset(&signal_mask) != 0)
@@ -3279,14 +3758,14 @@ static int minijail_run_internal(struct minijail *j,
 	}
 
 	if (j->flags.close_open_fds) {
-		const size_t kMaxInheritableFdsSize = 11 + MAX_PRESERVED_FDS;
+		const size_t kMaxInheritableFdsSize = 13 + MAX_PRESERVED_FDS;
 		int inheritable_fds[kMaxInheritableFdsSize];
 		size_t size = 0;
 
 		int *pipe_fds[] = {
 		    state_out->pipe_fds,   state_out->child_sync_pipe_fds,
 		    state_out->stdin_fds,  state_out->stdout_fds,
-		    state_out->stderr_fds,
+		    state_out->stderr_fds, state_out->seccomp_profile_fds,
 		};
 
 		for (size_t i = 0; i < ARRAY_SIZE(pipe_fds); ++i) {
@@ -3320,8 +3799,10 @@ static int minijail_run_internal(struct minijail *j,
 			inheritable_fds[size++] = config->elf_fd;
 		}
 
+		uint64_t start = timing_start(j);
 		if (close_open_fds(inheritable_fds, size) < 0)
 			die("failed to close open file descriptors");
+		log_timing(j, "close_open_fds", start);
 	}
 
 	/* The set of fds will be replaced. */
@@ -3370,7 +3851,9 @@ static int minijail_run_internal(struct minijail *j,
 	 * If forking, return.
 	 * If not, execve(2) the target.
 	 */
+	uint64_t enter_start = timing_start(j);
 	minijail_enter(j);
+	log_timing(j, "enter", enter_start);
 
 	if (config->exec_in_child && pid_namespace && do_init) {
 		/*
@@ -3403,6 +3886,10 @@ static int minijail_run_internal(struct minijail *j,
 	if (!config->exec_in_child)
 		return 0;
 
+	/* This has to come last, since every further syscall is notified. */
+	if (j->seccomp_profile_path)
+		send_seccomp_listener_or_die(state_out->seccomp_profile_fds[1]);
+
 	/*
 	 * We're going to execve(), so make sure any remaining resources are
 	 * freed. Exceptions are:
@@ -3428,6 +3915,7 @@ static int minijail_run_internal(struct minijail *j,
 	 */
 	if (!child_env)
 		child_env = config->envp ? config->envp : environ;
+	log_timing(j, "launch", run_start);
 	if (elf_fd > -1) {
 		fexecve(elf_fd, config->argv, child_env);
 		pwarn("fexecve(%d) failed", config->elf_fd);
@@ -3451,6 +3939,7 @@ minijail_run_config_internal(struct minijail *j,
 	    .stdout_fds = {-1, -1},
 	    .stderr_fds = {-1, -1},
 	    .child_sync_pipe_fds = {-1, -1},
+	    .seccomp_profile_fds = {-1, -1},
 	    .child_env = NULL,
 	};
 	int ret = minijail_run_internal(j, config, &state);
@@ -3490,6 +3979,11 @@ static int minijail_wait_internal(struct minijail *j, int expected_signal)
 	if (j->initpid <= 0)
 		return -ECHILD;
 
+	if (j->seccomp_profile_path && j->seccomp_profile_fd != -1) {
+		profile_syscalls(j);
+		close_and_reset(&j->seccomp_profile_fd);
+	}
+
 	int st;
 	while (true) {
 		const int ret = waitpid(j->initpid, &st, 0);
@@ -3555,6 +4049,11 @@ void API minijail_destroy(struct minijail *j)
 		free(j->filter_prog->filter);
 		free(j->filter_prog);
 	}
+	if (j->seccomp_profile_path) {
+		free(j->seccomp_profile_path);
+		if (j->seccomp_profile_fd != -1)
+			close(j->seccomp_profile_fd);
+	}
 	free_mounts_list(j);
 	free_remounts_list(j);
 	while (j->hooks_head) {
@@ -3581,6 +4080,8 @@ void API minijail_destroy(struct minijail *j)
 		free(j->preload_path);
 	if (j->alt_syscall_table)
 		free(j->alt_syscall_table);
+	if (j->working_dir)
+		free(j->working_dir);
 	for (i = 0; i < j->cgroup_count; ++i)
 		free(j->cgroups[i]);
 	free(j);
@@ -119,8 +119,26 @@ void minijail_set_seccomp_filter_allow_speculation(struct minijail *j);
 void minijail_set_seccomp_filters(struct minijail *j,
 				  const struct sock_fprog *filter);
 void minijail_parse_seccomp_filters(struct minijail *j, const char *path);
+/*
+ * Returns the seccomp filter set by minijail_parse_seccomp_filters() or
+ * minijail_set_seccomp_filters(), or NULL if there is none. The filter is owned
+ * by |j|.
+ */
+const struct sock_fprog *
+minijail_get_seccomp_filter(const struct minijail *j);
 void minijail_parse_seccomp_filters_from_fd(struct minijail *j, int fd);
 void minijail_log_seccomp_filter_failures(struct minijail *j);
+/*
+ * Counts the syscalls of the jailed program and its children via a seccomp
+ * user notification listener and writes them to |path| when minijail_wait()
+ * returns, in the format of a policy file for minijail_parse_seccomp_filters()
+ * with the most frequent syscalls first. The program is stopped on its first
+ * syscall until minijail_wait() is called, and every syscall is much slower, so
+ * this is only meant to write its policy.
+ * Requires Linux 5.5 and no_new_privs or CAP_SYS_ADMIN in the jail. Not
+ * supported with LD_PRELOAD or minijail_fork().
+ */
+int minijail_set_seccomp_profile(struct minijail *j, const char *path);
 /* 'minijail_use_caps' and 'minijail_capbset_drop' are mutually exclusive. */
 void minijail_use_caps(struct minijail *j, uint64_t capmask);
 void minijail_capbset_drop(struct minijail *j, uint64_t capmask);
@@ -148,6 +166,12 @@ void minijail_namespace_enter_net(struct minijail *j, const char *ns_path);
 void minijail_namespace_cgroups(struct minijail *j);
 /* Closes all open file descriptors after forking. */
 void minijail_close_open_fds(struct minijail *j);
+/*
+ * Logs how long the phases of launching the jailed program take, e.g.
+ * creating the namespaces, processing the mounts and setting the seccomp
+ * filter, as "timing: <phase> <microseconds>us" at the info level.
+ */
+void minijail_log_timing(struct minijail *j);
 /*
  * Implies namespace_vfs and remount_proc_readonly.
  * WARNING: this is NOT THREAD SAFE. See the block comment in </libminijail.c>.
@@ -210,6 +234,16 @@ int minijail_create_session(struct minijail *j);
 int minijail_enter_chroot(struct minijail *j, const char *dir);
 int minijail_enter_pivot_root(struct minijail *j, const char *dir);
 
+/*
+ * minijail_set_working_dir: sets the working directory of the jailed program
+ * @j   minijail to set the working directory of
+ * @dir directory to change to, resolved after entering the chroot or pivot
+ *      root, if any. Owned by caller.
+ *
+ * Returns 0 on success.
+ */
+int minijail_set_working_dir(struct minijail *j, const char *dir);
+
 /*
  * minijail_get_original_path: returns the path of a given file outside of the
  * chroot.
@@ -11,9 +11,11 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/mount.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <gtest/gtest.h>
@@ -22,6 +24,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "libminijail-private.h"
 #include "libminijail.h"
@@ -226,6 +229,12 @@ TEST_F(MarshalTest, copy_empty) {
   ASSERT_EQ(0, minijail_copy_jail(m_, j_));
 }
 
+TEST_F(MarshalTest, working_dir) {
+  ASSERT_EQ(0, minijail_set_working_dir(m_, "/tmp"));
+  EXPECT_EQ(size_ + sizeof("/tmp"), minijail_size(m_));
+  ASSERT_EQ(0, minijail_copy_jail(m_, j_));
+}
+
 TEST(KillTest, running_process) {
   const ScopedMinijail j(minijail_new());
   char* const argv[] = {"sh", "-c", "sleep 1000", nullptr};
@@ -887,6 +896,97 @@ TEST(Test, test_minijail_no_fd_leaks) {
   close(dev_null);
 }
 
+TEST(Test, test_minijail_close_open_fds_keeps_preserved_fds) {
+  pid_t pid;
+  int child_stdout;
+  int mj_run_ret;
+  ssize_t read_ret;
+  char buf[kBufferSize];
+  char script[kBufferSize];
+  int status;
+  char *argv[4];
+
+  // Open fds both between and after the preserved one, which are closed
+  // with separate close_range(2) calls.
+  int dev_null = open("/dev/null", O_RDONLY);
+  ASSERT_NE(dev_null, -1);
+  int preserved = fcntl(dev_null, F_DUPFD, 200);
+  ASSERT_NE(preserved, -1);
+  int unpreserved = fcntl(dev_null, F_DUPFD, preserved + 100);
+  ASSERT_NE(unpreserved, -1);
+  snprintf(script, sizeof(script),
+           "for fd in %d %d %d; do"
+           "  [ -e /proc/self/fd/$fd ] && echo yes || echo no;"
+           "done",
+           dev_null, preserved, unpreserved);
+
+  struct minijail *j = minijail_new();
+  minijail_preserve_fd(j, preserved, preserved);
+  minijail_close_open_fds(j);
+
+  argv[0] = const_cast<char*>(kShellPath);
+  argv[1] = "-c";
+  argv[2] = script;
+  argv[3] = NULL;
+  mj_run_ret = minijail_run_pid_pipes_no_preload(
+      j, argv[0], argv, &pid, NULL, &child_stdout, NULL);
+  EXPECT_EQ(mj_run_ret, 0);
+
+  // The shell writes every line separately, so read until EOF.
+  size_t len = 0;
+  while ((read_ret = read(child_stdout, buf + len, sizeof(buf) - 1 - len)) > 0)
+    len += read_ret;
+  EXPECT_EQ(read_ret, 0);
+  buf[len] = '\0';
+  EXPECT_STREQ(buf, "no\nyes\nno\n");
+
+  waitpid(pid, &status, 0);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  minijail_destroy(j);
+
+  close(unpreserved);
+  close(preserved);
+  close(dev_null);
+}
+
+// Measures the launch latency with many open fds, which close_open_fds()
+// has to close. Run with --gtest_also_run_disabled_tests.
+TEST(Test, DISABLED_benchmark_close_open_fds_launch) {
+  constexpr int kLaunches = 100;
+  struct rlimit limit;
+  ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+  std::vector<int> fds;
+  int dev_null = open("/dev/null", O_RDONLY);
+  ASSERT_NE(dev_null, -1);
+  for (rlim_t i = 0; i + 16 < limit.rlim_cur && i < 65536; ++i) {
+    int fd = dup(dev_null);
+    if (fd == -1)
+      break;
+    fds.push_back(fd);
+  }
+
+  char *argv[] = {"/bin/true", nullptr};
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < kLaunches; ++i) {
+    ScopedMinijail j(minijail_new());
+    minijail_close_open_fds(j.get());
+    ASSERT_EQ(minijail_run_no_preload(j.get(), argv[0], argv), 0);
+    EXPECT_EQ(minijail_wait(j.get()), 0);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double us = (end.tv_sec - start.tv_sec) * 1e6 +
+              (end.tv_nsec - start.tv_nsec) / 1e3;
+  printf("%zu open fds: %.0f us per launch\n", fds.size(), us / kLaunches);
+
+  for (int fd : fds)
+    close(fd);
+  close(dev_null);
+}
+
 TEST(Test, test_minijail_fork) {
   pid_t mj_fork_ret;
   int status;
@@ -1021,6 +1121,26 @@ TEST(Test, test_minijail_reset_signal_mask) {
   minijail_destroy(j);
 }
 
+TEST(Test, test_minijail_set_working_dir) {
+  pid_t pid;
+  char *argv[4];
+
+  struct minijail *j = minijail_new();
+  ASSERT_EQ(0, minijail_set_working_dir(j, "/"));
+  /* The working directory can only be set once. */
+  EXPECT_EQ(-EINVAL, minijail_set_working_dir(j, "/tmp"));
+
+  argv[0] = const_cast<char*>(kShellPath);
+  argv[1] = const_cast<char*>("-c");
+  argv[2] = const_cast<char*>("test \"$(pwd -P)\" = /");
+  argv[3] = NULL;
+  EXPECT_EQ(0, minijail_run_pid_pipes_no_preload(j, argv[0], argv, &pid, NULL,
+                                                 NULL, NULL));
+  EXPECT_EQ(0, minijail_wait(j));
+
+  minijail_destroy(j);
+}
+
 TEST(Test, test_minijail_reset_signal_handlers) {
   struct minijail *j = minijail_new();
 
@@ -1131,6 +1251,55 @@ TEST_F(NamespaceTest, test_tmpfs_userns) {
   minijail_destroy(j);
 }
 
+// Measures the launch throughput with namespaces and mounts like the ones
+// of the cifuzz sandbox, which launches the jail for every fuzzing run. The
+// phases of the last launch are logged, see minijail_log_timing(). Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(NamespaceTest, DISABLED_benchmark_sandbox_launch) {
+  constexpr int kLaunches = 100;
+  char uidmap[kBufferSize], gidmap[kBufferSize];
+
+  if (!userns_supported_)
+    GTEST_SKIP();
+
+  snprintf(uidmap, sizeof(uidmap), "0 %d 1", getuid());
+  snprintf(gidmap, sizeof(gidmap), "0 %d 1", getgid());
+  char *argv[] = {"/bin/true", nullptr};
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < kLaunches; ++i) {
+    ScopedMinijail j(minijail_new());
+    minijail_namespace_user(j.get());
+    ASSERT_EQ(minijail_uidmap(j.get(), uidmap), 0);
+    ASSERT_EQ(minijail_gidmap(j.get(), gidmap), 0);
+    minijail_namespace_user_disable_setgroups(j.get());
+    minijail_use_caps(j.get(), 0);
+    minijail_no_new_privs(j.get());
+    minijail_namespace_vfs(j.get());
+    minijail_namespace_pids(j.get());
+    minijail_namespace_ipc(j.get());
+    minijail_run_as_init(j.get());
+    ASSERT_EQ(minijail_mount(j.get(), "/", "/", "none",
+                             MS_BIND | MS_REC | MS_RDONLY),
+              0);
+    ASSERT_EQ(minijail_mount(j.get(), "proc", "/proc", "proc", MS_RDONLY), 0);
+    ASSERT_EQ(minijail_mount_with_data(j.get(), "tmpfs", "/tmp", "tmpfs",
+                                       MS_NOSUID | MS_NODEV | MS_STRICTATIME,
+                                       "mode=1777"),
+              0);
+    if (i == kLaunches - 1)
+      minijail_log_timing(j.get());
+    ASSERT_EQ(minijail_run_no_preload(j.get(), argv[0], argv), 0);
+    EXPECT_EQ(minijail_wait(j.get()), 0);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double us = (end.tv_sec - start.tv_sec) * 1e6 +
+              (end.tv_nsec - start.tv_nsec) / 1e3;
+  printf("%.0f launches per second, %.0f us per launch\n",
+         kLaunches * 1e6 / us, us / kLaunches);
+}
+
 TEST_F(NamespaceTest, test_namespaces) {
   constexpr char teststr[] = "test\n";
 
@@ -517,6 +517,22 @@ static void read_seccomp_filter(const char *filter_path,
 	}
 }
 
+static void write_seccomp_filter(const char *filter_path,
+				 const struct sock_fprog *filter)
+{
+	attribute_cleanup_fp FILE *f = fopen(filter_path, "we");
+	if (!f) {
+		fprintf(stderr, "failed to open %s: %m", filter_path);
+		exit(1);
+	}
+	if (fwrite(filter->filter, sizeof(struct sock_filter), filter->len,
+		   f) != filter->len ||
+	    fflush(f) != 0) {
+		fprintf(stderr, "failed to write %s: %m", filter_path);
+		exit(1);
+	}
+}
+
 static void usage(const char *progn)
 {
 	size_t i;
@@ -617,6 +633,20 @@ static void usage(const char *progn)
 	       "                Requires -n when not running as root.\n"
 	       "                The user is responsible for ensuring that the binary\n"
 	       "                was compiled for the correct architecture / kernel version.\n"
+	       "  --dump-seccomp-bpf=<f>:Write the seccomp filter compiled from -S to <f>\n"
+	       "                and exit, e.g. to pass it to --seccomp-bpf-binary later.\n"
+	       "                The filter depends on the other seccomp flags (e.g. -L).\n"
+	       "  --seccomp-profile=<f>:Count the syscalls of the program and write them\n"
+	       "                to <f> in the format of a -S policy file, the most\n"
+	       "                frequent first. Makes every syscall much slower.\n"
+	       "                Requires -n when not running as root.\n"
+	       "  --add-to-cgroup=<f>:Write the pid of the jailed process to <f>, e.g.\n"
+	       "                the cgroup.procs file of a cgroup v2.\n"
+	       "                Can be specified multiple times.\n"
+	       "  --log-timing: Log how long the phases of the launch take, e.g.\n"
+	       "                creating namespaces, mounting and setting seccomp.\n"
+	       "  --chdir=<d>:  Change the working directory of the program to <d>,\n"
+	       "                which is resolved inside the chroot with -C or -P.\n"
 	       "  --allow-speculative-execution:Allow speculative execution and disable\n"
 	       "                mitigations for speculative execution attacks.\n");
 	/* clang-format on */
@@ -656,6 +686,7 @@ int parse_args(struct minijail *j, int argc, char *const argv[],
 	int set_uidmap = 0, set_gidmap = 0;
 	size_t tmp_size = 0;
 	const char *filter_path = NULL;
+	const char *dump_filter_path = NULL;
 	int log_to_stderr = -1;
 
 	const char *optstring =
@@ -672,6 +703,11 @@ int parse_args(struct minijail *j, int argc, char *const argv[],
 		{"seccomp-bpf-binary", required_argument, 0, 133},
 		{"add-suppl-group", required_argument, 0, 134},
 		{"allow-speculative-execution", no_argument, 0, 135},
+		{"dump-seccomp-bpf", required_argument, 0, 136},
+		{"add-to-cgroup", required_argument, 0, 137},
+		{"seccomp-profile", required_argument, 0, 138},
+		{"log-timing", no_argument, 0, 139},
+		{"chdir", required_argument, 0, 140},
 		{0, 0, 0, 0},
 	};
 	/* clang-format on */
@@ -959,6 +995,35 @@ int parse_args(struct minijail *j, int argc, char *const argv[],
 		case 135:
 			minijail_set_seccomp_filter_allow_speculation(j);
 			break;
+		case 136: /* Dump compiled seccomp filter. */
+			dump_filter_path = optarg;
+			break;
+		case 137: /* Add to cgroup. */
+			if (minijail_add_to_cgroup(j, optarg)) {
+				fprintf(stderr, "Too many cgroups or out of"
+						" memory: %s\n",
+					optarg);
+				exit(1);
+			}
+			break;
+		case 138: /* Profile syscalls. */
+			if (minijail_set_seccomp_profile(j, optarg)) {
+				fprintf(stderr, "Could not set up seccomp "
+						"profiling\n");
+				exit(1);
+			}
+			break;
+		case 139: /* Log the timing of the launch phases. */
+			minijail_log_timing(j);
+			break;
+		case 140: /* Working directory. */
+			if (minijail_set_working_dir(j, optarg)) {
+				fprintf(stderr, "Could not set the working "
+						"directory to '%s'\n",
+					optarg);
+				exit(1);
+			}
+			break;
 		default:
 			usage(argv[0]);
 			exit(opt == 'h' ? 0 : 1);
@@ -1052,6 +1117,18 @@ int parse_args(struct minijail *j, int argc, char *const argv[],
 		free((void *)filter.filter);
 	}
 
+	if (dump_filter_path) {
+		const struct sock_fprog *filter =
+		    minijail_get_seccomp_filter(j);
+		if (!use_seccomp_filter || !filter) {
+			fprintf(stderr, "--dump-seccomp-bpf requires -S and "
+					"seccomp filter support.\n");
+			exit(1);
+		}
+		write_seccomp_filter(dump_filter_path, filter);
+		exit(0);
+	}
+
 	/* Mount a tmpfs under /tmp and set its size. */
 	if (tmp_size)
 		minijail_mount_tmp_size(j, tmp_size);
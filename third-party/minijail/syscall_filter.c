@@ -16,6 +16,17 @@
 #define ONE_INSTR	1
 #define TWO_INSTRS	2
 
+/*
+ * Policies with more syscalls than this are compiled into a binary search over
+ * the syscall number, with leaves of up to SYSCALL_TREE_LEAF_SIZE syscalls.
+ * The first SYSCALL_TREE_HOT_SYSCALLS syscalls of the policy are still checked
+ * linearly before the search, because policies usually list the most frequent
+ * syscalls first, like the ones written by minijail0 --seccomp-profile.
+ */
+#define SYSCALL_TREE_MIN_SYSCALLS	16
+#define SYSCALL_TREE_LEAF_SIZE		4
+#define SYSCALL_TREE_HOT_SYSCALLS	4
+
 #define compiler_warn(_state, _msg, ...)                                       \
 	warn("%s: %s(%zd): " _msg, __func__, (_state)->filename,               \
 	     (_state)->line_number, ## __VA_ARGS__)
@@ -800,6 +811,170 @@ free_line:
 	return ret;
 }
 
+static int append_default_action(struct filter_block *head,
+				 const struct filter_options *filteropts)
+{
+	switch (filteropts->action) {
+	case ACTION_RET_KILL:
+		append_ret_kill(head);
+		break;
+	case ACTION_RET_KILL_PROCESS:
+		append_ret_kill_process(head);
+		break;
+	case ACTION_RET_TRAP:
+		append_ret_trap(head);
+		break;
+	case ACTION_RET_LOG:
+		if (filteropts->allow_logging) {
+			append_ret_log(head);
+		} else {
+			warn("compile_filter: cannot use RET_LOG without "
+			     "allowing logging");
+			return -1;
+		}
+		break;
+	default:
+		warn("compile_filter: invalid log action %d",
+		     filteropts->action);
+		return -1;
+	}
+	return 0;
+}
+
+struct syscall_comparison {
+	int nr;
+	size_t index;
+	struct sock_filter instrs[ALLOW_SYSCALL_LEN];
+};
+
+static int compare_syscall_comparisons(const void *a, const void *b)
+{
+	const struct syscall_comparison *x = a, *y = b;
+
+	if (x->nr != y->nr)
+		return x->nr < y->nr ? -1 : 1;
+	/* Keep the policy order of duplicates, the first one matches. */
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/*
+ * Appends a binary search over the sorted syscall comparisons in
+ * [|lo|, |hi|) to |head|. Inner nodes jump to their right subtree if the
+ * syscall number is at least the one of its first comparison. Leaves are short
+ * linear chains of comparisons followed by the default action, except for the
+ * last leaf, which falls through to the default action appended by
+ * compile_filter.
+ */
+static int append_syscall_subtree(struct filter_block *head,
+				  const struct syscall_comparison *comps,
+				  size_t lo, size_t hi,
+				  struct bpf_labels *labels,
+				  const struct filter_options *filteropts,
+				  bool is_last)
+{
+	if (hi - lo <= SYSCALL_TREE_LEAF_SIZE) {
+		for (size_t i = lo; i < hi; i++) {
+			struct sock_filter *comp =
+			    new_instr_buf(ALLOW_SYSCALL_LEN);
+			memcpy(comp, comps[i].instrs, sizeof(comps[i].instrs));
+			append_filter_block(head, comp, ALLOW_SYSCALL_LEN);
+		}
+		if (is_last)
+			return 0;
+		return append_default_action(head, filteropts);
+	}
+
+	size_t mid = lo + (hi - lo) / 2;
+	char lbl_str[MAX_BPF_LABEL_LEN];
+	snprintf(lbl_str, MAX_BPF_LABEL_LEN, "%d_subtree", comps[mid].nr);
+	unsigned int id = get_label_id(labels, lbl_str);
+
+	struct sock_filter *node = new_instr_buf(TWO_INSTRS);
+	set_bpf_jump(node, BPF_JMP + BPF_JGE + BPF_K, comps[mid].nr, NEXT,
+		     SKIP);
+	set_bpf_jump_lbl(node + 1, id);
+	append_filter_block(head, node, TWO_INSTRS);
+
+	if (append_syscall_subtree(head, comps, lo, mid, labels, filteropts,
+				   false) != 0)
+		return -1;
+
+	struct sock_filter *right = new_instr_buf(ONE_INSTR);
+	set_bpf_lbl(right, id);
+	append_filter_block(head, right, ONE_INSTR);
+
+	return append_syscall_subtree(head, comps, mid, hi, labels, filteropts,
+				      is_last);
+}
+
+/*
+ * Appends the syscall number comparisons in |syscalls|, which consists of
+ * blocks of ALLOW_SYSCALL_LEN instructions each, to |head|. Short policies stay
+ * a linear chain in policy order. Longer ones are turned into a binary search
+ * so that every syscall only passes O(log n) comparisons, after the first
+ * SYSCALL_TREE_HOT_SYSCALLS ones. Takes ownership of |syscalls|.
+ */
+static int append_syscall_comparisons(struct filter_block *head,
+				      struct filter_block *syscalls,
+				      struct bpf_labels *labels,
+				      const struct filter_options *filteropts)
+{
+	size_t count = syscalls->total_len / ALLOW_SYSCALL_LEN;
+
+	if (syscalls->instrs == NULL) {
+		free_block_list(syscalls);
+		return 0;
+	}
+	if (count <= SYSCALL_TREE_MIN_SYSCALLS) {
+		/* A single block doesn't point to itself as the last one. */
+		if (syscalls->last == NULL)
+			syscalls->last = syscalls;
+		extend_filter_block_list(head, syscalls);
+		return 0;
+	}
+
+	struct syscall_comparison *comps = calloc(count, sizeof(*comps));
+	if (!comps)
+		die("could not allocate syscall comparisons");
+
+	size_t n = 0;
+	for (struct filter_block *curr = syscalls; curr; curr = curr->next) {
+		if (curr->len != ALLOW_SYSCALL_LEN)
+			die("unexpected syscall comparison length %zu",
+			    curr->len);
+		comps[n].nr = curr->instrs[0].k;
+		comps[n].index = n;
+		memcpy(comps[n].instrs, curr->instrs, sizeof(comps[n].instrs));
+		n++;
+	}
+	free_block_list(syscalls);
+
+	for (size_t i = 0; i < SYSCALL_TREE_HOT_SYSCALLS; i++) {
+		struct sock_filter *comp = new_instr_buf(ALLOW_SYSCALL_LEN);
+		memcpy(comp, comps[i].instrs, sizeof(comps[i].instrs));
+		append_filter_block(head, comp, ALLOW_SYSCALL_LEN);
+	}
+
+	qsort(comps, n, sizeof(*comps), compare_syscall_comparisons);
+	/*
+	 * Drop duplicates, which the first comparison shadows anyway, and the
+	 * hot syscalls, which never reach the search.
+	 */
+	size_t unique = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (i > 0 && comps[i - 1].nr == comps[i].nr)
+			continue;
+		if (comps[i].index < SYSCALL_TREE_HOT_SYSCALLS)
+			continue;
+		comps[unique++] = comps[i];
+	}
+
+	int ret = append_syscall_subtree(head, comps, 0, unique, labels,
+					 filteropts, true);
+	free(comps);
+	return ret;
+}
+
 int compile_filter(const char *filename, FILE *initial_file,
 		   struct sock_fprog *prog,
 		   const struct filter_options *filteropts)
@@ -834,18 +1009,31 @@ int compile_filter(const char *filename, FILE *initial_file,
 	len = bpf_load_syscall_nr(load_nr);
 	append_filter_block(head, load_nr, len);
 
+	/*
+	 * The syscall number comparisons are collected separately so that
+	 * they can be arranged for fast lookup once all of them are known.
+	 */
+	struct filter_block *syscalls = new_filter_block();
+
 	/*
 	 * On kernels without SECCOMP_RET_LOG, Minijail can attempt to write the
 	 * first failing syscall to syslog(3). In order for syslog(3) to work,
 	 * some syscalls need to be unconditionally allowed.
 	 */
 	if (filteropts->allow_syscalls_for_logging)
-		allow_logging_syscalls(head);
+		allow_logging_syscalls(syscalls);
 
-	if (compile_file(filename, initial_file, head, &arg_blocks, &labels,
+	if (compile_file(filename, initial_file, syscalls, &arg_blocks, &labels,
 			 filteropts, previous_syscalls,
 			 0 /* include_level */) != 0) {
 		warn("compile_filter: compile_file() failed");
+		free_block_list(syscalls);
+		ret = -1;
+		goto free_filter;
+	}
+
+	if (append_syscall_comparisons(head, syscalls, &labels, filteropts) !=
+	    0) {
 		ret = -1;
 		goto free_filter;
 	}
@@ -854,29 +1042,7 @@ int compile_filter(const char *filename, FILE *initial_file,
 	 * If none of the syscalls match, either fall through to LOG, TRAP, or
 	 * KILL.
 	 */
-	switch (filteropts->action) {
-	case ACTION_RET_KILL:
-		append_ret_kill(head);
-		break;
-	case ACTION_RET_KILL_PROCESS:
-		append_ret_kill_process(head);
-		break;
-	case ACTION_RET_TRAP:
-		append_ret_trap(head);
-		break;
-	case ACTION_RET_LOG:
-		if (filteropts->allow_logging) {
-			append_ret_log(head);
-		} else {
-			warn("compile_filter: cannot use RET_LOG without "
-			     "allowing logging");
-			ret = -1;
-			goto free_filter;
-		}
-		break;
-	default:
-		warn("compile_filter: invalid log action %d",
-		     filteropts->action);
+	if (append_default_action(head, filteropts) != 0) {
 		ret = -1;
 		goto free_filter;
 	}
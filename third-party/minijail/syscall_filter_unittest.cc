@@ -1587,6 +1587,122 @@ TEST(FilterTest, seccomp_read_write) {
   free(actual.filter);
 }
 
+// Runs the compiled |prog| on |data|. Stores the number of executed
+// instructions in |steps|.
+unsigned int run_filter(const struct sock_fprog* prog,
+                        const struct seccomp_data* data,
+                        size_t* steps) {
+  uint32_t a = 0;
+  uint32_t mem[BPF_MEMWORDS] = {};
+  *steps = 0;
+  for (size_t pc = 0; pc < prog->len; pc++) {
+    const struct sock_filter& insn = prog->filter[pc];
+    (*steps)++;
+    switch (BPF_CLASS(insn.code)) {
+      case BPF_LD:
+        if (BPF_MODE(insn.code) == BPF_MEM)
+          a = mem[insn.k];
+        else
+          memcpy(&a, reinterpret_cast<const char*>(data) + insn.k, sizeof(a));
+        break;
+      case BPF_ST:
+        mem[insn.k] = a;
+        break;
+      case BPF_RET:
+        return insn.k;
+      case BPF_JMP: {
+        bool taken;
+        switch (BPF_OP(insn.code)) {
+          case BPF_JA:
+            pc += insn.k;
+            continue;
+          case BPF_JEQ:
+            taken = a == insn.k;
+            break;
+          case BPF_JGE:
+            taken = a >= insn.k;
+            break;
+          case BPF_JGT:
+            taken = a > insn.k;
+            break;
+          case BPF_JSET:
+            taken = (a & insn.k) != 0;
+            break;
+          default:
+            ADD_FAILURE() << "unexpected jump " << insn.code;
+            return 0;
+        }
+        pc += taken ? insn.jt : insn.jf;
+        break;
+      }
+      default:
+        ADD_FAILURE() << "unexpected instruction " << insn.code;
+        return 0;
+    }
+  }
+  ADD_FAILURE() << "ran past the end of the filter";
+  return 0;
+}
+
+TEST(FilterTest, seccomp_many_syscalls) {
+  struct sock_fprog actual;
+  const int allowed[] = {
+      __NR_read,         __NR_write,       __NR_close,      __NR_fstat,
+      __NR_lseek,        __NR_mmap,        __NR_mprotect,   __NR_munmap,
+      __NR_brk,          __NR_rt_sigaction, __NR_rt_sigprocmask,
+      __NR_rt_sigreturn, __NR_ioctl,       __NR_readv,      __NR_writev,
+      __NR_sched_yield,  __NR_madvise,     __NR_dup,        __NR_nanosleep,
+      __NR_getpid,       __NR_exit,        __NR_uname,      __NR_fcntl,
+      __NR_getcwd,       __NR_gettid,      __NR_futex,      __NR_exit_group,
+  };
+  std::string policy = "openat: arg0 == 1\n";
+  for (int nr : allowed) {
+    policy += std::string(lookup_syscall_name(nr)) + ": 1\n";
+  }
+  // Duplicates are shadowed by the first rule for a syscall.
+  policy += "read: arg0 == 1\n";
+
+  FILE* policy_file = write_policy_to_pipe(policy);
+  ASSERT_NE(policy_file, nullptr);
+
+  int res = test_compile_filter("policy", policy_file, &actual);
+  fclose(policy_file);
+  ASSERT_EQ(res, 0);
+
+  EXPECT_ARCH_VALIDATION(actual.filter);
+  EXPECT_EQ_STMT(actual.filter + ARCH_VALIDATION_LEN,
+                 BPF_LD + BPF_W + BPF_ABS,
+                 syscall_nr);
+
+  size_t linear_steps = ARCH_VALIDATION_LEN + 1 +
+                        (sizeof(allowed) / sizeof(allowed[0]) + 1) * 2;
+  struct seccomp_data data = {};
+  data.arch = MINIJAIL_ARCH_NR;
+  size_t steps;
+  for (int nr = 0; nr < 512; nr++) {
+    data.nr = nr;
+    data.args[0] = 0;
+    unsigned int expected = SECCOMP_RET_KILL;
+    for (int allowed_nr : allowed) {
+      if (nr == allowed_nr)
+        expected = SECCOMP_RET_ALLOW;
+    }
+    EXPECT_EQ(run_filter(&actual, &data, &steps), expected) << nr;
+    // Every syscall number passes O(log n) comparisons.
+    EXPECT_LT(steps, linear_steps / 2) << nr;
+  }
+  // The first syscalls of the policy are checked before the search.
+  data.nr = __NR_write;
+  EXPECT_EQ(run_filter(&actual, &data, &steps), SECCOMP_RET_ALLOW);
+  EXPECT_EQ(steps, ARCH_VALIDATION_LEN + 1 + 3);
+  data.nr = __NR_openat;
+  EXPECT_EQ(run_filter(&actual, &data, &steps), SECCOMP_RET_KILL);
+  data.args[0] = 1;
+  EXPECT_EQ(run_filter(&actual, &data, &steps), SECCOMP_RET_ALLOW);
+
+  free(actual.filter);
+}
+
 TEST(FilterTest, misplaced_whitespace) {
   struct sock_fprog actual;
   std::string policy = "read :1\n";
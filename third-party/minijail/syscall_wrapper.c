@@ -6,6 +6,7 @@
 #include "syscall_wrapper.h"
 
 #define _GNU_SOURCE
+#include <errno.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
@@ -28,7 +29,70 @@
 # endif
 #endif
 
+/*
+ * The new mount API and close_range have the same syscall numbers on all
+ * architectures that use the generic syscall table numbering for new syscalls.
+ */
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) ||       \
+    defined(__arm__)
+# ifndef SYS_open_tree
+#  define SYS_open_tree 428
+# endif
+# ifndef SYS_move_mount
+#  define SYS_move_mount 429
+# endif
+# ifndef SYS_mount_setattr
+#  define SYS_mount_setattr 442
+# endif
+# ifndef SYS_close_range
+#  define SYS_close_range 436
+# endif
+#endif
+
 int sys_seccomp(unsigned int operation, unsigned int flags, void *args)
 {
 	return syscall(SYS_seccomp, operation, flags, args);
 }
+
+int sys_open_tree(int dfd, const char *path, unsigned int flags)
+{
+#ifdef SYS_open_tree
+	return syscall(SYS_open_tree, dfd, path, flags);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+int sys_move_mount(int from_dfd, const char *from_path, int to_dfd,
+		   const char *to_path, unsigned int flags)
+{
+#ifdef SYS_move_mount
+	return syscall(SYS_move_mount, from_dfd, from_path, to_dfd, to_path,
+		       flags);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+int sys_mount_setattr(int dfd, const char *path, unsigned int flags,
+		      struct minijail_mount_attr *attr, size_t size)
+{
+#ifdef SYS_mount_setattr
+	return syscall(SYS_mount_setattr, dfd, path, flags, attr, size);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+int sys_close_range(unsigned int first, unsigned int last, unsigned int flags)
+{
+#ifdef SYS_close_range
+	return syscall(SYS_close_range, first, last, flags);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
@@ -6,6 +6,9 @@
 #ifndef _SYSCALL_WRAPPER_H_
 #define _SYSCALL_WRAPPER_H_
 
+#include <fcntl.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -33,10 +36,112 @@ extern "C" {
 #ifndef SECCOMP_FILTER_FLAG_SPEC_ALLOW
 # define SECCOMP_FILTER_FLAG_SPEC_ALLOW (1 << 2)
 #endif
+
+#ifndef SECCOMP_RET_ALLOW
+# define SECCOMP_RET_ALLOW 0x7fff0000U
+#endif
+
+#ifndef SECCOMP_RET_USER_NOTIF
+# define SECCOMP_RET_USER_NOTIF 0x7fc00000U
+#endif
+
+#ifndef SECCOMP_FILTER_FLAG_NEW_LISTENER
+# define SECCOMP_FILTER_FLAG_NEW_LISTENER (1 << 3)
+#endif
+
+#ifndef SECCOMP_GET_NOTIF_SIZES
+# define SECCOMP_GET_NOTIF_SIZES 3
+#endif
+
+#ifndef SECCOMP_USER_NOTIF_FLAG_CONTINUE
+# define SECCOMP_USER_NOTIF_FLAG_CONTINUE (1 << 0)
+#endif
+
+/*
+ * Same layout as the structs of <linux/seccomp.h>, which can't be included
+ * together with bpf.h. See seccomp_unotify(2).
+ */
+struct minijail_seccomp_data {
+	int nr;
+	unsigned int arch;
+	unsigned long long instruction_pointer;
+	unsigned long long args[6];
+};
+
+struct minijail_seccomp_notif_sizes {
+	unsigned short seccomp_notif;
+	unsigned short seccomp_notif_resp;
+	unsigned short seccomp_data;
+};
+
+struct minijail_seccomp_notif {
+	unsigned long long id;
+	unsigned int pid;
+	unsigned int flags;
+	struct minijail_seccomp_data data;
+};
+
+struct minijail_seccomp_notif_resp {
+	unsigned long long id;
+	long long val;
+	int error;
+	unsigned int flags;
+};
 /* End seccomp filter related flags. */
 
+/* New mount API related flags, see open_tree(2) and mount_setattr(2). */
+#ifndef OPEN_TREE_CLONE
+# define OPEN_TREE_CLONE 1
+#endif
+#ifndef OPEN_TREE_CLOEXEC
+# define OPEN_TREE_CLOEXEC O_CLOEXEC
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+# define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef AT_EMPTY_PATH
+# define AT_EMPTY_PATH 0x1000
+#endif
+#ifndef AT_RECURSIVE
+# define AT_RECURSIVE 0x8000
+#endif
+#ifndef MOUNT_ATTR_RDONLY
+# define MOUNT_ATTR_RDONLY 0x00000001
+#endif
+#ifndef MOUNT_ATTR_NOSUID
+# define MOUNT_ATTR_NOSUID 0x00000002
+#endif
+#ifndef MOUNT_ATTR_NODEV
+# define MOUNT_ATTR_NODEV 0x00000004
+#endif
+#ifndef MOUNT_ATTR_NOEXEC
+# define MOUNT_ATTR_NOEXEC 0x00000008
+#endif
+
+/* Same layout as struct mount_attr, which older headers don't provide. */
+struct minijail_mount_attr {
+	unsigned long long attr_set;
+	unsigned long long attr_clr;
+	unsigned long long propagation;
+	unsigned long long userns_fd;
+};
+/* End new mount API related flags. */
+
 int sys_seccomp(unsigned int operation, unsigned int flags, void *args);
 
+/*
+ * These fail with ENOSYS if the kernel or the kernel headers predate the new
+ * mount API (Linux 5.2, and 5.12 for mount_setattr).
+ */
+int sys_open_tree(int dfd, const char *path, unsigned int flags);
+int sys_move_mount(int from_dfd, const char *from_path, int to_dfd,
+		   const char *to_path, unsigned int flags);
+int sys_mount_setattr(int dfd, const char *path, unsigned int flags,
+		      struct minijail_mount_attr *attr, size_t size);
+
+/* Fails with ENOSYS before Linux 5.9. */
+int sys_close_range(unsigned int first, unsigned int last, unsigned int flags);
+
 #ifdef __cplusplus
 }; /* extern "C" */
 #endif
@@ -14,6 +14,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libconstants.h"
@@ -149,12 +150,145 @@ void do_log(int priority, const char *format, ...)
 	dprintf(logging_config.fd, "\n");
 }
 
+/*
+ * An open-addressing hash index from names to the entries of syscall_table or
+ * constant_table, so that compiling a policy doesn't scan the tables for every
+ * syscall and constant it names. The generated tables wrap each entry in an
+ * #ifdef, so the set of entries is only known once they are compiled, which is
+ * why the index is built on the first lookup rather than generated with them.
+ */
+struct name_index {
+	/* A power of two, at least twice the number of entries. */
+	size_t capacity;
+	/* The table index plus one of the entry in each slot, 0 if empty. */
+	uint32_t slots[];
+};
+
+typedef const char *(*entry_name_fn)(size_t i);
+typedef size_t (*count_entries_fn)(void);
+
+/* FNV-1a */
+static size_t hash_name(const char *name)
+{
+	uint32_t hash = 2166136261u;
+	for (; *name; name++) {
+		hash ^= (unsigned char)*name;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*
+ * Returns the table index of the first entry named |name|, or -1 if there is
+ * none.
+ */
+static ssize_t name_index_find(const struct name_index *index,
+			       entry_name_fn entry_name, const char *name)
+{
+	size_t mask = index->capacity - 1;
+	size_t slot = hash_name(name) & mask;
+	for (; index->slots[slot] != 0; slot = (slot + 1) & mask) {
+		size_t i = index->slots[slot] - 1;
+		if (!strcmp(entry_name(i), name))
+			return i;
+	}
+	return -1;
+}
+
+static struct name_index *build_name_index(entry_name_fn entry_name,
+					   size_t count)
+{
+	size_t capacity = 16;
+	while (capacity < 2 * count)
+		capacity *= 2;
+	struct name_index *index =
+	    calloc(1, sizeof(*index) + capacity * sizeof(index->slots[0]));
+	if (!index)
+		return NULL;
+	index->capacity = capacity;
+
+	for (size_t i = 0; i < count; i++) {
+		const char *name = entry_name(i);
+		/* Like a linear scan, find the first of duplicate names. */
+		if (name_index_find(index, entry_name, name) >= 0)
+			continue;
+		size_t slot = hash_name(name) & (capacity - 1);
+		while (index->slots[slot] != 0)
+			slot = (slot + 1) & (capacity - 1);
+		index->slots[slot] = i + 1;
+	}
+	return index;
+}
+
+/*
+ * Returns the index cached in |*cache|, building it first if needed, or NULL if
+ * it couldn't be allocated. Concurrent first lookups may each build an index,
+ * but only one of them is kept.
+ */
+static const struct name_index *
+get_name_index(struct name_index **cache, entry_name_fn entry_name,
+	       count_entries_fn count_entries)
+{
+	struct name_index *index = __atomic_load_n(cache, __ATOMIC_ACQUIRE);
+	if (index)
+		return index;
+
+	index = build_name_index(entry_name, count_entries());
+	if (!index)
+		return NULL;
+	struct name_index *expected = NULL;
+	if (!__atomic_compare_exchange_n(cache, &expected, index, false,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		free(index);
+		return expected;
+	}
+	return index;
+}
+
+static const char *syscall_entry_name(size_t i)
+{
+	return syscall_table[i].name;
+}
+
+static const char *constant_entry_name(size_t i)
+{
+	return constant_table[i].name;
+}
+
+static size_t count_syscall_entries(void)
+{
+	size_t count = 0;
+	while (syscall_table[count].name && syscall_table[count].nr >= 0)
+		count++;
+	return count;
+}
+
+static size_t count_constant_entries(void)
+{
+	size_t count = 0;
+	while (constant_table[count].name)
+		count++;
+	return count;
+}
+
+static struct name_index *syscall_index = NULL;
+static struct name_index *constant_index = NULL;
+
 /*
  * Returns the syscall nr and optionally populates the index in the pointer
  * |ind| if it is non-NULL.
  */
 int lookup_syscall(const char *name, size_t *ind)
 {
+	const struct name_index *index = get_name_index(
+	    &syscall_index, syscall_entry_name, count_syscall_entries);
+	if (index) {
+		ssize_t i = name_index_find(index, syscall_entry_name, name);
+		if (ind != NULL)
+			*ind = i;
+		return i >= 0 ? syscall_table[i].nr : -1;
+	}
+
 	size_t ind_tmp = 0;
 	const struct syscall_entry *entry = syscall_table;
 	for (; entry->name && entry->nr >= 0; ++entry) {
@@ -183,10 +317,21 @@ long int parse_single_constant(char *constant_str, char **endptr)
 {
 	const struct constant_entry *entry = constant_table;
 	long int res = 0;
-	for (; entry->name; ++entry) {
-		if (!strcmp(entry->name, constant_str)) {
+	const struct name_index *index = get_name_index(
+	    &constant_index, constant_entry_name, count_constant_entries);
+	if (index) {
+		ssize_t i =
+		    name_index_find(index, constant_entry_name, constant_str);
+		if (i >= 0) {
 			*endptr = constant_str + strlen(constant_str);
-			return entry->value;
+			return constant_table[i].value;
+		}
+	} else {
+		for (; entry->name; ++entry) {
+			if (!strcmp(entry->name, constant_str)) {
+				*endptr = constant_str + strlen(constant_str);
+				return entry->value;
+			}
 		}
 	}
 
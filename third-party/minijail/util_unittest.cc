@@ -14,6 +14,8 @@
 #include <gtest/gtest.h>
 
 #include "bpf.h"
+#include "libconstants.h"
+#include "libsyscalls.h"
 #include "util.h"
 
 namespace {
@@ -181,6 +183,34 @@ TEST(parse_single_constant, formats) {
   EXPECT_EQ(01234, c);
 }
 
+// Every name in the tables is found, the first of duplicate ones.
+TEST(lookup_syscall, all_entries) {
+  for (const struct syscall_entry *entry = syscall_table;
+       entry->name && entry->nr >= 0; ++entry) {
+    size_t ind = 0;
+    EXPECT_EQ(entry->nr, lookup_syscall(entry->name, &ind)) << entry->name;
+    ASSERT_LT(ind, get_num_syscalls());
+    EXPECT_STREQ(entry->name, syscall_table[ind].name);
+    EXPECT_LE(&syscall_table[ind], entry);
+  }
+
+  size_t ind = 0;
+  EXPECT_EQ(-1, lookup_syscall("not_a_syscall", &ind));
+  EXPECT_EQ(static_cast<size_t>(-1), ind);
+}
+
+TEST(parse_single_constant, all_entries) {
+  for (const struct constant_entry *entry = constant_table; entry->name;
+       ++entry) {
+    std::string constant = entry->name;
+    char *end;
+    long int c = parse_single_constant(const_cast<char*>(constant.data()), &end);
+    EXPECT_EQ(constant.data() + constant.size(), end) << entry->name;
+    // Duplicate names have the same value, the one of the macro.
+    EXPECT_EQ(static_cast<long int>(entry->value), c) << entry->name;
+  }
+}
+
 TEST(parse_constant, unsigned) {
   char *end;
   long int c = 0;
@@ -0,0 +1,112 @@
+/*
+ * main() for fuzz tests built with the aflpp engine, i.e. compiled with AFL++'s afl-clang-lto or afl-clang-fast.
+ *
+ * Under afl-fuzz, the fuzz test runs in persistent mode: LLVMFuzzerInitialize runs once before the fork server starts,
+ * and each forked child then executes up to CIFUZZ_AFLPP_PERSISTENT_ITERATIONS inputs in a loop instead of a single
+ * one, which saves a fork and the fuzz test's initialization per input. The inputs are passed in shared memory instead
+ * of via a file. Each one is copied into a heap buffer of its exact size, so that sanitizers detect reads beyond its
+ * end, as they do with libFuzzer.
+ *
+ * Outside of afl-fuzz, the files passed as arguments are executed once each, which cifuzz uses to reproduce the crashes
+ * found by AFL++ with symbolized sanitizer reports.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __AFL_FUZZ_TESTCASE_LEN
+#error "cifuzz: The aflpp engine requires AFL++'s afl-clang-lto or afl-clang-fast compiler"
+#endif
+
+#ifdef __cplusplus
+#define CIFUZZ_AFLPP_C_LINKAGE extern "C"
+#else
+#define CIFUZZ_AFLPP_C_LINKAGE
+#endif
+
+CIFUZZ_AFLPP_C_LINKAGE int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+CIFUZZ_AFLPP_C_LINKAGE __attribute__((weak)) int LLVMFuzzerInitialize(int *argc, char ***argv);
+
+/* The number of inputs a child executes before the fork server replaces it with a fresh one, which limits how much
+ * state leaking from one input to the next can affect the stability of the coverage. */
+#define CIFUZZ_AFLPP_PERSISTENT_ITERATIONS 10000
+
+__AFL_FUZZ_INIT();
+
+static uint8_t *copy_input(const uint8_t *data, size_t size) {
+  /* malloc(0) may return NULL. */
+  uint8_t *copy = (uint8_t *) malloc(size > 0 ? size : 1);
+  if (copy == NULL) {
+    fprintf(stderr, "cifuzz: failed to allocate %lu bytes\n", (unsigned long) size);
+    abort();
+  }
+  memcpy(copy, data, size);
+  return copy;
+}
+
+static int run_file(const char *path) {
+  FILE *f;
+  long size;
+  uint8_t *data;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "cifuzz: failed to open %s\n", path);
+    return 1;
+  }
+  if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "cifuzz: failed to determine the size of %s\n", path);
+    fclose(f);
+    return 1;
+  }
+  data = (uint8_t *) malloc(size > 0 ? (size_t) size : 1);
+  if (data == NULL) {
+    fprintf(stderr, "cifuzz: failed to allocate %ld bytes\n", size);
+    abort();
+  }
+  if (size > 0 && fread(data, 1, (size_t) size, f) != (size_t) size) {
+    fprintf(stderr, "cifuzz: failed to read %s\n", path);
+    free(data);
+    fclose(f);
+    return 1;
+  }
+  fclose(f);
+
+  fprintf(stderr, "Running: %s\n", path);
+  LLVMFuzzerTestOneInput(data, (size_t) size);
+  free(data);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned char *buf;
+  uint8_t *input;
+  size_t size;
+  int i;
+
+  if (LLVMFuzzerInitialize) {
+    LLVMFuzzerInitialize(&argc, &argv);
+  }
+
+  /* afl-fuzz passes the ID of the shared memory with the coverage map in this variable. */
+  if (getenv("__AFL_SHM_ID") == NULL) {
+    for (i = 1; i < argc; i++) {
+      if (run_file(argv[i]) != 0) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  __AFL_INIT();
+  /* The buffer must only be obtained after __AFL_INIT. */
+  buf = __AFL_FUZZ_TESTCASE_BUF;
+  while (__AFL_LOOP(CIFUZZ_AFLPP_PERSISTENT_ITERATIONS)) {
+    size = __AFL_FUZZ_TESTCASE_LEN;
+    input = copy_input(buf, size);
+    LLVMFuzzerTestOneInput(input, size);
+    free(input);
+  }
+  return 0;
+}
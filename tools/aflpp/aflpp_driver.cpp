@@ -0,0 +1 @@
+aflpp_driver.c
\ No newline at end of file
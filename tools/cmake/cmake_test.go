@@ -306,6 +306,59 @@ func TestIntegration_FuzzTestBinaryLaunchesCIFuzz(t *testing.T) {
 	require.Equal(t, "run\nc_fuzz_test\n", strings.ReplaceAll(string(out), "\r\n", "\n"))
 }
 
+// A project whose fuzz tests use both signatures of target_link_libraries, which CMake only accepts as long as the CMake
+// integration doesn't call target_link_libraries on the fuzz tests itself.
+const linkSignaturesProject = `
+cmake_minimum_required(VERSION 3.16)
+project(LinkSignatures CXX)
+find_package(cifuzz NO_SYSTEM_ENVIRONMENT_PATH)
+enable_fuzz_testing()
+add_library(lib lib.cpp)
+add_fuzz_test(keyword_fuzz_test fuzz_test.cpp)
+target_link_libraries(keyword_fuzz_test PRIVATE lib)
+add_fuzz_test(plain_fuzz_test fuzz_test.cpp DEPENDENCIES lib)
+`
+
+func TestIntegration_Configure_CentipedeLinkSignatures(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("MSVC does not support the centipede engine")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("modules")
+
+	configureLinkSignaturesProject(t, "-DCIFUZZ_ENGINE=centipede", "-DCIFUZZ_CENTIPEDE_RUNNER=/libcentipede_runner.a")
+}
+
+func TestIntegration_Configure_ReplayerLinkSignatures(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("modules")
+
+	configureLinkSignaturesProject(t, "-DCIFUZZ_ENGINE=replayer")
+}
+
+// configureLinkSignaturesProject runs the configure step of linkSignaturesProject with the given arguments, which fails
+// if the CMake integration forces a signature of target_link_libraries on the fuzz tests.
+func configureLinkSignaturesProject(t *testing.T, args ...string) {
+	projectDir, err := os.MkdirTemp(baseTempDir, "project")
+	require.NoError(t, err)
+	err = os.WriteFile(filepath.Join(projectDir, "CMakeLists.txt"), []byte(linkSignaturesProject), 0o644)
+	require.NoError(t, err)
+	for _, source := range []string{"lib.cpp", "fuzz_test.cpp"} {
+		err = fileutil.Touch(filepath.Join(projectDir, source))
+		require.NoError(t, err)
+	}
+	buildDir, err := os.MkdirTemp(baseTempDir, "build")
+	require.NoError(t, err)
+
+	runInDir(t, buildDir, "cmake", append(args, projectDir)...)
+}
+
 func build(t *testing.T, buildType string, cacheVariables map[string]string, additionalBuildArgs ...string) string {
 	buildDir, err := os.MkdirTemp(baseTempDir, "build")
 	require.NoError(t, err)
@@ -3,6 +3,15 @@ include("${CMAKE_CURRENT_LIST_DIR}/cifuzz-functions.cmake")
 set(CIFUZZ_TESTING false CACHE BOOL "Enable general compiler options for fuzzing and regression tests")
 set(CIFUZZ_ENGINE "replayer" CACHE STRING "The fuzzing engine used to run fuzz tests")
 set(CIFUZZ_SANITIZERS "" CACHE STRING "The sanitizers to instrument the code with")
+set(CIFUZZ_BUILD_PROFILE "debug" CACHE STRING "The build profile of fuzz tests, either debug or throughput")
+set(CIFUZZ_THINLTO OFF CACHE BOOL "Whether to build fuzz tests with ThinLTO")
+set(CIFUZZ_PROFILE_USE "" CACHE FILEPATH "The indexed profile to optimize fuzz tests with")
+set(CIFUZZ_CENTIPEDE_RUNNER "$ENV{CIFUZZ_CENTIPEDE_RUNNER}" CACHE FILEPATH "The runner library of Centipede to link fuzz tests against with the centipede engine")
+set(CIFUZZ_COVERAGE_SOURCE_DIRS "" CACHE STRING "The directories whose sources are instrumented in coverage builds, all if empty")
+set(CIFUZZ_FUZZING_FOCUS_DIRS "" CACHE STRING "The directories whose sources are instrumented for the coverage feedback of fuzzing engines, all if empty")
+set(CIFUZZ_FUZZING_IGNORE_DIRS "" CACHE STRING "The directories whose sources are not instrumented for the coverage feedback of fuzzing engines")
+set(CIFUZZ_UNITY_BUILD OFF CACHE BOOL "Whether to batch the sources of all fuzz tests into unity builds")
+set(CIFUZZ_THINLTO_CACHE_DIR "" CACHE PATH "The directory in which the linker caches ThinLTO results")
 set(CIFUZZ_USE_DEPRECATED_MACROS OFF CACHE BOOL "Whether to use the deprecated FUZZ(_INIT) macros instead of FUZZ_TEST(_SETUP)")
 
 if(${CMAKE_VERSION} VERSION_LESS "3.19.0")
@@ -11,8 +20,12 @@ else()
     file(REAL_PATH "${CMAKE_CURRENT_LIST_DIR}" CIFUZZ_CMAKE_DIR)
 endif()
 set(CIFUZZ_INCLUDE_DIR "${CIFUZZ_CMAKE_DIR}/../../include" CACHE INTERNAL "The include directory for the cifuzz headers")
+set(CIFUZZ_AFLPP_DRIVER_C_SRC "${CIFUZZ_CMAKE_DIR}/../../src/aflpp_driver.c" CACHE INTERNAL "The path of the AFL++ driver as a C source file.")
+set(CIFUZZ_AFLPP_DRIVER_CXX_SRC "${CIFUZZ_CMAKE_DIR}/../../src/aflpp_driver.cpp" CACHE INTERNAL "The path of the AFL++ driver as a CXX source file.")
 set(CIFUZZ_DUMPER_C_SRC "${CIFUZZ_CMAKE_DIR}/../../src/dumper.c" CACHE INTERNAL "The path of the dumper as a C source file.")
 set(CIFUZZ_DUMPER_CXX_SRC "${CIFUZZ_CMAKE_DIR}/../../src/dumper.cpp" CACHE INTERNAL "The path of the dumper as a CXX source file.")
+set(CIFUZZ_INPUTRING_C_SRC "${CIFUZZ_CMAKE_DIR}/../../src/inputring.c" CACHE INTERNAL "The path of the input ring as a C source file.")
+set(CIFUZZ_INPUTRING_CXX_SRC "${CIFUZZ_CMAKE_DIR}/../../src/inputring.cpp" CACHE INTERNAL "The path of the input ring as a CXX source file.")
 set(CIFUZZ_LAUNCHER_C_SRC "${CIFUZZ_CMAKE_DIR}/../../src/launcher.c" CACHE INTERNAL "The path of the launcher as a C source file.")
 set(CIFUZZ_LAUNCHER_CXX_SRC "${CIFUZZ_CMAKE_DIR}/../../src/launcher.cpp" CACHE INTERNAL "The path of the launcher as a CXX source file.")
 set(CIFUZZ_REPLAYER_C_SRC "${CIFUZZ_CMAKE_DIR}/../../src/replayer.c" CACHE INTERNAL "The path of the replayer as a C source file.")
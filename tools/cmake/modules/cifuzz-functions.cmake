@@ -9,6 +9,15 @@ function(enable_fuzz_testing)
   # metadata for renamed or removed targets doesn't linger around.
   file(REMOVE_RECURSE "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz")
 
+  # With CMake 3.19 or newer, additionally write a single index of all fuzz tests after the top-level directory has been
+  # processed, so that cifuzz can list and resolve the fuzz tests of large projects with a single file read rather than
+  # one per test and kind of info file (see internal/build/cmake/fuzz_test_index.go).
+  get_property(_index_scheduled GLOBAL PROPERTY CIFUZZ_FUZZ_TEST_INDEX_SCHEDULED)
+  if(NOT _index_scheduled AND CMAKE_VERSION VERSION_GREATER_EQUAL 3.19)
+    set_property(GLOBAL PROPERTY CIFUZZ_FUZZ_TEST_INDEX_SCHEDULED TRUE)
+    cmake_language(DEFER DIRECTORY "${CMAKE_SOURCE_DIR}" CALL _cifuzz_write_fuzz_test_index)
+  endif()
+
   # Conceptually, "building for fuzzing" is similar to a build type such as Release or RelWithDebInfo. We instead use
   # a cache variable that adds flags to a base configuration we assume to be RelWithDebInfo for multiple reasons:
   # 1. Custom build types require defining a potentially unknown set of cache variables and are thus hard to maintain.
@@ -49,8 +58,81 @@ function(enable_fuzz_testing)
           # Undefine NDEBUG, which is explicitly defined by the RelWithDebInfo CMake configuration, so that asserts are
           # kept.
           -UNDEBUG
-          # disable optimizations to ensure high debuggability
-          -O0
+      )
+      if((NOT CIFUZZ_BUILD_PROFILE) OR (CIFUZZ_BUILD_PROFILE STREQUAL debug))
+        # disable optimizations to ensure high debuggability
+        add_compile_options(-O0)
+      elseif(CIFUZZ_BUILD_PROFILE STREQUAL throughput)
+        add_compile_options(
+            # Optimize for executions per second during long fuzzing runs. -O1 is what the sanitizers recommend for
+            # reasonable performance, beyond that they catch fewer bugs as optimizations remove the offending accesses.
+            -O1
+            # Keep every frame in sanitizer stack traces, which tail calls would skip.
+            -fno-optimize-sibling-calls
+        )
+      else()
+        message(FATAL_ERROR "cifuzz: Unsupported value for CIFUZZ_BUILD_PROFILE: ${CIFUZZ_BUILD_PROFILE}")
+      endif()
+      _cifuzz_add_debug_info_options()
+    endif()
+  endif()
+
+  if(CIFUZZ_THINLTO)
+    if(MSVC)
+      message(FATAL_ERROR "cifuzz: MSVC does not support ThinLTO")
+    endif()
+    if(CIFUZZ_ENGINE STREQUAL aflpp)
+      # afl-clang-lto instruments the fuzz tests during a full LTO link, which ThinLTO would replace.
+      message(FATAL_ERROR "cifuzz: The aflpp engine does not support ThinLTO")
+    endif()
+    # ThinLTO inlines across translation units, e.g. small helpers into hot parser loops, while keeping links
+    # incremental: Only the modules affected by a change are optimized again, all others are taken from the cache.
+    # Coverage builds are excluded since their instrumentation has to stay in sync with the source.
+    if(NOT coverage IN_LIST CIFUZZ_SANITIZERS AND NOT gcov IN_LIST CIFUZZ_SANITIZERS)
+      add_compile_options(-flto=thin)
+      add_link_options(-flto=thin)
+      if(NOT APPLE)
+        # ThinLTO requires a linker with LLVM bitcode support, which the system linker usually isn't on Linux.
+        add_link_options(-fuse-ld=lld)
+      endif()
+      if(CIFUZZ_THINLTO_CACHE_DIR)
+        file(MAKE_DIRECTORY "${CIFUZZ_THINLTO_CACHE_DIR}")
+        if(APPLE)
+          add_link_options("LINKER:-cache_path_lto,${CIFUZZ_THINLTO_CACHE_DIR}")
+        else()
+          # lld prunes the cache on its own, by default of entries unused for a week.
+          add_link_options("LINKER:--thinlto-cache-dir=${CIFUZZ_THINLTO_CACHE_DIR}")
+        endif()
+      endif()
+    endif()
+  endif()
+
+  if(CIFUZZ_PROFILE_USE)
+    if(MSVC)
+      message(FATAL_ERROR "cifuzz: MSVC does not support instrumentation profiles")
+    endif()
+    # Optimize the code layout and inlining for the paths the corpus exercises, based on a profile created by replaying
+    # it with a coverage build. Code that changed since then or that the corpus doesn't reach is optimized as usual.
+    if(NOT coverage IN_LIST CIFUZZ_SANITIZERS AND NOT gcov IN_LIST CIFUZZ_SANITIZERS)
+      add_compile_options(
+          "-fprofile-instr-use=${CIFUZZ_PROFILE_USE}"
+          -Wno-profile-instr-unprofiled
+          -Wno-profile-instr-out-of-date
+      )
+    endif()
+  endif()
+
+  if(CMAKE_C_COMPILER_LAUNCHER OR CMAKE_CXX_COMPILER_LAUNCHER)
+    # Compiler caches such as ccache only hit if the same source is compiled with the same flags and paths. Map the
+    # absolute source and build paths embedded into debug info and __FILE__ to relative ones so that checkouts in
+    # different directories share cache entries. Symbolized stack traces then contain paths relative to the project
+    # directory, which cifuzz resolves. Coverage builds are excluded since llvm-cov needs the original paths to find the
+    # sources.
+    if(CMAKE_C_COMPILER_ID MATCHES "Clang" AND NOT coverage IN_LIST CIFUZZ_SANITIZERS)
+      add_compile_options(
+          -fdebug-compilation-dir=.
+          "-fdebug-prefix-map=${CMAKE_SOURCE_DIR}=."
+          "-fmacro-prefix-map=${CMAKE_SOURCE_DIR}=."
       )
     endif()
   endif()
@@ -65,6 +147,31 @@ function(enable_fuzz_testing)
         add_compile_options(-fsanitize=fuzzer)
       endif()
     endif()
+  elseif(CIFUZZ_ENGINE STREQUAL centipede)
+    if(MSVC)
+      message(FATAL_ERROR "cifuzz: MSVC does not support the centipede engine")
+    endif()
+    if(NOT CIFUZZ_CENTIPEDE_RUNNER)
+      message(FATAL_ERROR "cifuzz: The centipede engine requires the path of Centipede's runner library (libcentipede_runner.a) in CIFUZZ_CENTIPEDE_RUNNER")
+    endif()
+    # Centipede collects the coverage through the runner library linked into the fuzz test, which reads the PC table
+    # and the comparison operands from this instrumentation.
+    add_compile_options(-fsanitize-coverage=trace-pc-guard,pc-table,trace-cmp)
+  endif()
+
+  # Focus the coverage feedback of the fuzzing engines on the code of interest: Only the sources in
+  # CIFUZZ_FUZZING_FOCUS_DIRS, if set, and none in CIFUZZ_FUZZING_IGNORE_DIRS are instrumented, so that e.g. vendored
+  # libraries run faster and don't distract the engine. Sanitizer checks are still applied to all sources. The AFL++
+  # compiler wrappers support the same lists.
+  if(NOT MSVC AND NOT coverage IN_LIST CIFUZZ_SANITIZERS AND CIFUZZ_ENGINE MATCHES "^(libfuzzer|aflpp|centipede)$")
+    if(CIFUZZ_FUZZING_FOCUS_DIRS)
+      _cifuzz_write_source_list(_allowlist_file sancov_allowlist ${CIFUZZ_FUZZING_FOCUS_DIRS})
+      add_compile_options("-fsanitize-coverage-allowlist=${_allowlist_file}")
+    endif()
+    if(CIFUZZ_FUZZING_IGNORE_DIRS)
+      _cifuzz_write_source_list(_ignorelist_file sancov_ignorelist ${CIFUZZ_FUZZING_IGNORE_DIRS})
+      add_compile_options("-fsanitize-coverage-ignorelist=${_ignorelist_file}")
+    endif()
   endif()
 
   foreach(sanitizer IN LISTS CIFUZZ_SANITIZERS)
@@ -116,6 +223,16 @@ function(enable_fuzz_testing)
             add_compile_options(-mllvm -runtime-counter-relocation)
           endif()
         endif()
+        if(CIFUZZ_COVERAGE_SOURCE_DIRS)
+          # Only instrument the sources of the project, so that third-party code doesn't slow down the replay of the
+          # corpus and doesn't end up in the raw profiles, which then have to be merged and exported. The profile list
+          # is supported as of clang 13.
+          if (((NOT DEFINED CMAKE_C_COMPILER_VERSION) OR ("${CMAKE_C_COMPILER_VERSION}" VERSION_GREATER_EQUAL 13)) AND
+            ((NOT DEFINED CMAKE_CXX_COMPILER_VERSION) OR ("${CMAKE_CXX_COMPILER_VERSION}" VERSION_GREATER_EQUAL 13)))
+            _cifuzz_write_source_list(_profile_list_file profile_list ${CIFUZZ_COVERAGE_SOURCE_DIRS})
+            add_compile_options("-fprofile-list=${_profile_list_file}")
+          endif()
+        endif()
         add_link_options(-fprofile-instr-generate)
       endif()
     elseif(sanitizer STREQUAL gcov)
@@ -133,12 +250,185 @@ function(enable_fuzz_testing)
       message(FATAL_ERROR "cifuzz: Unsupported value in CIFUZZ_SANITIZERS: ${sanitizer}")
     endif()
   endforeach()
+
+  _cifuzz_add_support_libraries()
+endfunction()
+
+# Reduces the cost of the full debug info of fuzz builds, which makes up most of the size of object files and fuzz tests
+# and which the linker would otherwise have to copy into every fuzz test:
+# * With split DWARF, the debug info stays in a .dwo file next to each object file. add_fuzz_test packages the ones of
+#   each fuzz test into <name>.dwp, which llvm-symbolizer picks up next to the executable and which is bundled with it.
+# * The remaining debug sections are compressed with zstd if both the compiler and the linker support it.
+function(_cifuzz_add_debug_info_options)
+  get_property(_enabled_languages GLOBAL PROPERTY ENABLED_LANGUAGES)
+  if(C IN_LIST _enabled_languages)
+    set(_lang C)
+  else()
+    set(_lang CXX)
+  endif()
+
+  # llvm-dwp resolves the .dwo files relative to the compilation directory, which is "." if a compiler launcher is used
+  # (see enable_fuzz_testing), so it couldn't find them. On macOS, the debug info is linked into a .dSYM instead.
+  if(CMAKE_${_lang}_COMPILER_ID STREQUAL "Clang" AND NOT APPLE AND
+     NOT (CMAKE_C_COMPILER_LAUNCHER OR CMAKE_CXX_COMPILER_LAUNCHER))
+    get_filename_component(_compiler_dir "${CMAKE_${_lang}_COMPILER}" DIRECTORY)
+    find_program(CIFUZZ_LLVM_DWP NAMES llvm-dwp HINTS "${_compiler_dir}")
+    if(CIFUZZ_LLVM_DWP)
+      add_compile_options(-gsplit-dwarf)
+      set_property(GLOBAL PROPERTY CIFUZZ_SPLIT_DWARF TRUE)
+    endif()
+  endif()
+
+  if(_lang STREQUAL C)
+    include(CheckCSourceCompiles)
+    set(CMAKE_REQUIRED_FLAGS -gz=zstd)
+    check_c_source_compiles("int main(void) { return 0; }" CIFUZZ_SUPPORTS_ZSTD_DEBUG_SECTIONS)
+  else()
+    include(CheckCXXSourceCompiles)
+    set(CMAKE_REQUIRED_FLAGS -gz=zstd)
+    check_cxx_source_compiles("int main() { return 0; }" CIFUZZ_SUPPORTS_ZSTD_DEBUG_SECTIONS)
+  endif()
+  if(CIFUZZ_SUPPORTS_ZSTD_DEBUG_SECTIONS)
+    add_compile_options(-gz=zstd)
+    add_link_options(-gz=zstd)
+  endif()
+endfunction()
+
+# Converts path separators to '\' (Windows only) and escapes all backslashes for use of |path| in a C string literal.
+function(_cifuzz_c_string_path out_var path)
+  # In the regex strings below, one level of escaping is for the CMake string and another one to get a literal backslash
+  # in a regex.
+  if(WIN32)
+    string(REGEX REPLACE "/" "\\\\" path "${path}")
+  endif()
+  string(REGEX REPLACE "\\\\" "\\\\\\\\" path "${path}")
+  set("${out_var}" "${path}" PARENT_SCOPE)
+endfunction()
+
+# Defines the object libraries cifuzz::replayer, cifuzz::launcher, cifuzz::dumper, cifuzz::inputring and cifuzz::aflpp_driver
+# for the current engine and sanitizers, which every fuzz test links against. They are defined once by enable_fuzz_testing, so that they are
+# compiled with the fuzzing flags of the project root, or by the first add_fuzz_test. Since every build directory uses a
+# single combination of engine and sanitizers, each variant compiles them exactly once.
+function(_cifuzz_add_support_libraries)
+  get_property(_defined GLOBAL PROPERTY CIFUZZ_SUPPORT_LIBRARIES_DEFINED)
+  if(_defined)
+    return()
+  endif()
+  set_property(GLOBAL PROPERTY CIFUZZ_SUPPORT_LIBRARIES_DEFINED TRUE)
+
+  # The support sources are written so that they can be compiled as both C and C++. Since we do not have control over
+  # the enabled languages, we add them with a source file extension matching the enabled language.
+  get_property(_enabled_languages GLOBAL PROPERTY ENABLED_LANGUAGES)
+  if(C IN_LIST _enabled_languages)
+    set(_lang C)
+  else()
+    if (NOT CXX IN_LIST _enabled_languages)
+      message(FATAL "cifuzz: At least one of C and CXX has to be an enabled language")
+    endif()
+    set(_lang CXX)
+  endif()
+
+  if(CIFUZZ_ENGINE STREQUAL replayer)
+    set(_replayer_src "${CIFUZZ_REPLAYER_${_lang}_SRC}")
+    add_library(cifuzz_replayer OBJECT "${_replayer_src}")
+    add_library(cifuzz::replayer ALIAS cifuzz_replayer)
+    if(coverage IN_LIST CIFUZZ_SANITIZERS)
+      # Never instrument the replayer file for coverage.
+      set_source_files_properties("${_replayer_src}"
+                                  PROPERTIES COMPILE_FLAGS
+                                  "-fno-profile-instr-generate -fno-coverage-mapping")
+    elseif(gcov IN_LIST CIFUZZ_SANITIZERS)
+      # Never instrument the replayer file for coverage.
+      set_source_files_properties("${_replayer_src}"
+                                  PROPERTIES COMPILE_FLAGS
+                                  "-fprofile-exclude-files=.*")
+      # Enables -gcov_shard_dir, which calls into the gcov runtime.
+      target_compile_definitions(cifuzz_replayer PRIVATE CIFUZZ_HAS_GCOV)
+    elseif(CIFUZZ_SANITIZERS)
+      target_compile_definitions(cifuzz_replayer PRIVATE CIFUZZ_HAS_SANITIZER)
+    endif()
+  elseif(CIFUZZ_ENGINE STREQUAL libfuzzer)
+    set(_launcher_src "${CIFUZZ_LAUNCHER_${_lang}_SRC}")
+    add_library(cifuzz_launcher OBJECT "${_launcher_src}")
+    add_library(cifuzz::launcher ALIAS cifuzz_launcher)
+    if (coverage IN_LIST CIFUZZ_SANITIZERS)
+      # Never instrument the launcher file for coverage.
+      set_source_files_properties("${_launcher_src}"
+                                  PROPERTIES COMPILE_FLAGS
+                                  "-fno-profile-instr-generate -fno-coverage-mapping")
+    endif()
+    if((NOT MSVC) AND ((address IN_LIST CIFUZZ_SANITIZERS) OR (undefined IN_LIST CIFUZZ_SANITIZERS)))
+      add_library(cifuzz_dumper OBJECT "${CIFUZZ_DUMPER_${_lang}_SRC}")
+      add_library(cifuzz::dumper ALIAS cifuzz_dumper)
+    endif()
+    if((NOT MSVC) AND (NOT APPLE) AND (NOT coverage IN_LIST CIFUZZ_SANITIZERS))
+      set(_inputring_src "${CIFUZZ_INPUTRING_${_lang}_SRC}")
+      add_library(cifuzz_inputring OBJECT "${_inputring_src}")
+      add_library(cifuzz::inputring ALIAS cifuzz_inputring)
+      # The input ring runs before every input, so it must neither add coverage features nor sanitizer checks.
+      set_source_files_properties("${_inputring_src}" PROPERTIES COMPILE_FLAGS "-fno-sanitize=all")
+    endif()
+  elseif(CIFUZZ_ENGINE STREQUAL aflpp)
+    # The AFL++ compiler wrappers add the coverage instrumentation and define the macros used by the driver for
+    # persistent mode, so they have to compile everything.
+    get_filename_component(_compiler_name "${CMAKE_${_lang}_COMPILER}" NAME)
+    if(NOT _compiler_name MATCHES "^afl-(clang-lto|clang-fast|cc|c\\+\\+)")
+      message(FATAL_ERROR "cifuzz: The aflpp engine requires AFL++'s afl-clang-lto or afl-clang-fast compiler, but "
+        "the ${_lang} compiler is ${CMAKE_${_lang}_COMPILER}.\n"
+        "Specify afl-clang-lto/afl-clang-lto++ in CC/CXX, then remove ${CMAKE_BINARY_DIR} and try again.")
+    endif()
+    add_library(cifuzz_aflpp_driver OBJECT "${CIFUZZ_AFLPP_DRIVER_${_lang}_SRC}")
+    add_library(cifuzz::aflpp_driver ALIAS cifuzz_aflpp_driver)
+  endif()
+
+  # Only build the support libraries as dependencies of fuzz tests.
+  foreach(_target cifuzz_replayer cifuzz_launcher cifuzz_dumper cifuzz_inputring cifuzz_aflpp_driver)
+    if(TARGET "${_target}")
+      set_target_properties("${_target}" PROPERTIES EXCLUDE_FROM_ALL TRUE)
+    endif()
+  endforeach()
+endfunction()
+
+# Writes the index of all fuzz tests collected by add_fuzz_test, with one tab-separated line per fuzz test.
+function(_cifuzz_write_fuzz_test_index)
+  get_property(_entries GLOBAL PROPERTY CIFUZZ_FUZZ_TEST_INDEX)
+  list(JOIN _entries "\n" _content)
+  file(GENERATE
+       OUTPUT "$<SHELL_PATH:${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests.index>"
+       CONTENT "${_content}\n")
+endfunction()
+
+# Writes a list of the sources in the given directories in the format of clang's special case lists, as used by e.g.
+# -fprofile-list, to a file in the build directory and stores its path in out_var. The file is named after its contents so
+# that changing the directories changes the compile commands, which rebuilds the affected sources.
+function(_cifuzz_write_source_list out_var name)
+  set(_list "")
+  foreach(_dir IN LISTS ARGN)
+    string(APPEND _list "src:${_dir}/*\n")
+  endforeach()
+  string(MD5 _hash "${_list}")
+  set(_file "${CMAKE_BINARY_DIR}/.cifuzz/${name}_${_hash}.txt")
+  _cifuzz_write_if_different("${_file}" "${_list}")
+  set("${out_var}" "${_file}" PARENT_SCOPE)
+endfunction()
+
+# Writes the concatenation of the remaining arguments to |path| unless it already has that content, which would trigger
+# a rebuild of everything depending on it.
+function(_cifuzz_write_if_different path)
+  string(CONCAT _content ${ARGN})
+  set(_old_content "")
+  if(EXISTS "${path}")
+    file(READ "${path}" _old_content)
+  endif()
+  if(NOT _old_content STREQUAL _content)
+    file(WRITE "${path}" "${_content}")
+  endif()
 endfunction()
 
 function(add_fuzz_test name)
-  set(_options)
-  set(_one_value_args)
-  set(_multi_value_args DEPENDENCIES INCLUDE_DIRS SOURCES )
+  set(_options UNITY_BUILD)
+  set(_one_value_args UNITY_BUILD_BATCH_SIZE)
+  set(_multi_value_args DEPENDENCIES INCLUDE_DIRS SOURCES TESTS )
   cmake_parse_arguments(PARSE_ARGV 1 _args "${_options}" "${_one_value_args}" "${_multi_value_args}")
 
   if( NOT _args_SOURCES )
@@ -149,9 +439,19 @@ function(add_fuzz_test name)
 
   add_executable("${name}" ${_args_sources})
 
+  # Batch the sources of the fuzz test, including the generated ones, into fewer translation units. Sources that don't
+  # compile when batched can opt out with the SKIP_UNITY_BUILD_INCLUSION source file property.
+  if(_args_UNITY_BUILD OR CIFUZZ_UNITY_BUILD)
+    set_target_properties("${name}" PROPERTIES UNITY_BUILD ON)
+    if(_args_UNITY_BUILD_BATCH_SIZE)
+      set_target_properties("${name}" PROPERTIES UNITY_BUILD_BATCH_SIZE "${_args_UNITY_BUILD_BATCH_SIZE}")
+    endif()
+  endif()
+
   if(CIFUZZ_USE_DEPRECATED_MACROS)
     # The old fuzz macro header is injected via the compile command line. It does not live under the include directory
     # so that is not offered to fuzz tests using the new macros via include path IDE completions.
+    # In a unity build, it is injected only once per batch, which is sufficient since it has an include guard.
     set(_fuzz_macro_header "$<SHELL_PATH:${CIFUZZ_INCLUDE_DIR}/legacy/fuzz_macro.h>")
     if(MSVC)
       target_compile_options("${name}" PRIVATE /FI"${_fuzz_macro_header}")
@@ -167,36 +467,29 @@ function(add_fuzz_test name)
     target_link_libraries( "${name}" ${_args_DEPENDENCIES} )
   endif()
   
-  # This macro is consumed by cifuzz.h and cifuzz_launcher.c.
+  # This macro is consumed by cifuzz.h.
   target_compile_definitions("${name}" PRIVATE CIFUZZ_TEST_NAME="${name}")
 
+  # With TESTS, the executable contains the given fuzz tests registered with FUZZ_TEST_NAMED, which are exposed to
+  # cifuzz as individual fuzz tests. cifuzz/registry.h selects one at runtime via the CIFUZZ_TEST environment variable.
+  if(_args_TESTS)
+    set(_fuzz_tests ${_args_TESTS})
+  else()
+    set(_fuzz_tests "${name}")
+  endif()
+
   get_property(_enabled_languages GLOBAL PROPERTY ENABLED_LANGUAGES)
 
+  # The replayer, launcher and dumper don't depend on the fuzz test and are thus linked in from the object libraries
+  # shared by all fuzz tests. Everything specific to a fuzz test lives in its own sources and, for the launcher, a small
+  # generated source file.
+  _cifuzz_add_support_libraries()
   if(CIFUZZ_ENGINE STREQUAL replayer)
-    # The replayer is written so that it can be compiled as both C and C++.
-    # Since we do not have control over the enabled languages, we add the
-    # replayer with a source file extension matching the enabled language.
-    if(C IN_LIST _enabled_languages)
-      set(_replayer_src "${CIFUZZ_REPLAYER_C_SRC}")
-    else()
-      if (NOT CXX IN_LIST _enabled_languages)
-        message(FATAL "cifuzz: At least one of C and CXX has to be an enabled language")
-      endif()
-      set(_replayer_src "${CIFUZZ_REPLAYER_CXX_SRC}")
-    endif()
-    target_sources("${name}" PRIVATE "${_replayer_src}")
-    if(coverage IN_LIST CIFUZZ_SANITIZERS)
-      # Never instrument the replayer file for coverage.
-      set_source_files_properties("${_replayer_src}"
-                                  PROPERTIES COMPILE_FLAGS
-                                  "-fno-profile-instr-generate -fno-coverage-mapping")
-    elseif(gcov IN_LIST CIFUZZ_SANITIZERS)
-      # Never instrument the replayer file for coverage.
-      set_source_files_properties("${_replayer_src}"
-                                  PROPERTIES COMPILE_FLAGS
-                                  "-fprofile-exclude-files=.*")
-    elseif(CIFUZZ_SANITIZERS)
-      target_compile_definitions("${name}" PRIVATE CIFUZZ_HAS_SANITIZER)
+    target_sources("${name}" PRIVATE $<TARGET_OBJECTS:cifuzz::replayer>)
+    if(NOT WIN32)
+      # The replayer runs the inputs of fuzz tests declared with FUZZ_TEST_THREAD_SAFE on threads with -threads.
+      find_package(Threads REQUIRED)
+      set_property(TARGET "${name}" APPEND PROPERTY LINK_LIBRARIES Threads::Threads)
     endif()
   elseif(CIFUZZ_ENGINE STREQUAL libfuzzer)
     if(MSVC)
@@ -213,24 +506,41 @@ function(add_fuzz_test name)
         "Either specify the full path to ${_clang_description} in CC/CXX or ensure that it is listed before other compilers in your PATH.\n"
         "After that remove ${CMAKE_BINARY_DIR} and try again.")
     endif()
-    # The launcher is written so that it can be compiled as both C and C++.
-    # Since we do not have control over the enabled languages, we add the
-    # launcher with a source file extension matching the enabled language.
+    # The launcher obtains the name of the fuzz test from this source file, which uses the language of the launcher.
     if(C IN_LIST _enabled_languages)
-      set(_launcher_src "${CIFUZZ_LAUNCHER_C_SRC}")
+      set(_launcher_ext .c)
     else()
-      if (NOT CXX IN_LIST _enabled_languages)
-        message(FATAL "CIFuzz: At least one of C and CXX has to be an enabled language")
-      endif()
-      set(_launcher_src "${CIFUZZ_LAUNCHER_CXX_SRC}")
+      set(_launcher_ext .cpp)
+    endif()
+    set(_launcher_info_src "${CMAKE_CURRENT_BINARY_DIR}/.cifuzz/${name}_launcher_info${_launcher_ext}")
+    # The launcher runs before any constructors, so in an executable with several registered fuzz tests (see
+    # cifuzz/registry.h), it can't ask the registry and reads the fuzz test selected by CIFUZZ_TEST itself.
+    list(LENGTH _args_TESTS _num_tests)
+    if(_num_tests EQUAL 1)
+      set(_launcher_test_name "\"${_args_TESTS}\"")
+    elseif(_num_tests GREATER 1)
+      set(_launcher_test_name "NULL")
+    else()
+      set(_launcher_test_name "\"${name}\"")
     endif()
+    _cifuzz_write_if_different("${_launcher_info_src}"
+        "/* Generated by add_fuzz_test. */\n"
+        "#include <stddef.h>\n"
+        "#ifdef __cplusplus\n"
+        "#define CIFUZZ_LAUNCHER_C_LINKAGE extern \"C\"\n"
+        "#else\n"
+        "#define CIFUZZ_LAUNCHER_C_LINKAGE\n"
+        "#endif\n"
+        "CIFUZZ_LAUNCHER_C_LINKAGE const char *cifuzz_launcher_test_name(void) {\n"
+        "  return ${_launcher_test_name}\;\n"
+        "}\n")
     if (coverage IN_LIST CIFUZZ_SANITIZERS)
-      # Never instrument the launcher file for coverage.
-      set_source_files_properties("${_launcher_src}"
+      # Never instrument the launcher files for coverage.
+      set_source_files_properties("${_launcher_info_src}"
                                   PROPERTIES COMPILE_FLAGS
                                   "-fno-profile-instr-generate -fno-coverage-mapping")
     endif()
-    target_sources("${name}" PRIVATE "${_launcher_src}")
+    target_sources("${name}" PRIVATE $<TARGET_OBJECTS:cifuzz::launcher> "${_launcher_info_src}")
     if((NOT MSVC) AND ((address IN_LIST CIFUZZ_SANITIZERS) OR (undefined IN_LIST CIFUZZ_SANITIZERS)))
       # The macOS linker doesn't support --wrap, so we fall back to a different strategy that doesn't require any linker
       # flags.
@@ -238,16 +548,25 @@ function(add_fuzz_test name)
       if(NOT APPLE)
         target_link_options("${name}" PRIVATE -Wl,--wrap=__sanitizer_set_death_callback)
       endif()
-      if(C IN_LIST _enabled_languages)
-        set(_dumper_src "${CIFUZZ_DUMPER_C_SRC}")
-      else()
-        if (NOT CXX IN_LIST _enabled_languages)
-          message(FATAL "CIFuzz: At least one of C and CXX has to be an enabled language")
-        endif()
-        set(_dumper_src "${CIFUZZ_DUMPER_CXX_SRC}")
-      endif()
-      target_sources("${name}" PRIVATE "${_dumper_src}")
+      target_sources("${name}" PRIVATE $<TARGET_OBJECTS:cifuzz::dumper>)
     endif()
+    if(TARGET cifuzz::inputring)
+      # Keeps the last inputs in a memory-mapped file, so that cifuzz can recover them if the fuzz test is killed.
+      # See src/inputring.c for details.
+      target_link_options("${name}" PRIVATE -Wl,--wrap=LLVMFuzzerTestOneInput)
+      target_sources("${name}" PRIVATE $<TARGET_OBJECTS:cifuzz::inputring>)
+    endif()
+  elseif(CIFUZZ_ENGINE STREQUAL aflpp)
+    # The driver provides main() and runs LLVMFuzzerTestOneInput in AFL++'s persistent mode. The fuzz tests are only
+    # run by cifuzz with this engine, so the launcher isn't needed.
+    target_sources("${name}" PRIVATE $<TARGET_OBJECTS:cifuzz::aflpp_driver>)
+  elseif(CIFUZZ_ENGINE STREQUAL centipede)
+    # Centipede's runner library provides main(), which executes batches of inputs it receives from the centipede
+    # process via shared memory, or the files passed as arguments when run on its own.
+    # Appends to the link libraries directly rather than calling target_link_libraries, which would force either its
+    # plain or its keyword signature on all other calls for the fuzz test, including those in the user's project.
+    set_property(TARGET "${name}" APPEND PROPERTY
+                 LINK_LIBRARIES "${CIFUZZ_CENTIPEDE_RUNNER}" ${CMAKE_DL_LIBS} rt pthread)
   else()
     message(FATAL_ERROR "cifuzz: Unsupported value for CIFUZZ_ENGINE: ${CIFUZZ_ENGINE}")
   endif()
@@ -262,75 +581,113 @@ function(add_fuzz_test name)
                        BYPRODUCTS "${name}.dSYM")
   endif()
 
-  set(_seed_corpus_suffix _inputs)
-  set(_source_seed_corpus "${CMAKE_CURRENT_SOURCE_DIR}/${name}${_seed_corpus_suffix}")
-  # Convert path separators to '\' (Windows only) and escape all backslashes for a C string literal.
-  # In the regex strings below, one level of escaping is for the CMake string and another one to get a literal backslash
-  # in a regex.
-  if(WIN32)
-    string(REGEX REPLACE "/" "\\\\" _source_seed_corpus "${_source_seed_corpus}")
+  # With split DWARF, the debug info of the fuzz test has to be packaged next to it, since the .dwo files it refers to
+  # aren't part of bundles and change with every build. See _cifuzz_add_debug_info_options.
+  get_property(_split_dwarf GLOBAL PROPERTY CIFUZZ_SPLIT_DWARF)
+  if(_split_dwarf)
+    add_custom_command(TARGET "${name}"
+                       POST_BUILD
+                       COMMAND "${CIFUZZ_LLVM_DWP}" ARGS -e $<TARGET_FILE:${name}> -o $<TARGET_FILE:${name}>.dwp
+                       BYPRODUCTS "${name}.dwp")
   endif()
-  string(REGEX REPLACE "\\\\" "\\\\\\\\" _source_seed_corpus "${_source_seed_corpus}")
-  # Compile the path to the seed corpus, which lives under the source root, into the fuzz test binary as it is built
-  # out-of-tree. An alternative could be to symlink the seed corpus to a well-known location next to the binary, but
-  # symlinks are not always available on Windows (junctions exist, but may cause issues with tools that are unaware of
-  # them and are not easy to deal with using just POSIX functions).
-  target_compile_definitions("${name}" PRIVATE CIFUZZ_SEED_CORPUS="${_source_seed_corpus}")
-
-  # Coverage builds should always run over the full generated corpus in addition to the seed corpus.
-  if(coverage IN_LIST CIFUZZ_SANITIZERS OR gcov IN_LIST CIFUZZ_SANITIZERS)
-    set(_source_generated_corpus "${CMAKE_SOURCE_DIR}/.cifuzz-corpus/${name}")
-    if(WIN32)
-      string(REGEX REPLACE "/" "\\\\" _source_generated_corpus "${_source_generated_corpus}")
-    endif()
-    string(REGEX REPLACE "\\\\" "\\\\\\\\" _source_generated_corpus "${_source_generated_corpus}")
-    target_compile_definitions("${name}" PRIVATE CIFUZZ_GENERATED_CORPUS="${_source_generated_corpus}")
+
+  set(_seed_corpus_suffix _inputs)
+  if(_args_TESTS)
+    # cifuzz/registry.h appends the name of the selected fuzz test to these directories.
+    _cifuzz_c_string_path(_source_dir "${CMAKE_CURRENT_SOURCE_DIR}")
+    target_compile_definitions("${name}" PRIVATE CIFUZZ_SEED_CORPUS_DIR="${_source_dir}")
+    if(coverage IN_LIST CIFUZZ_SANITIZERS OR gcov IN_LIST CIFUZZ_SANITIZERS)
+      _cifuzz_c_string_path(_generated_corpus_dir "${CMAKE_SOURCE_DIR}/.cifuzz-corpus")
+      target_compile_definitions("${name}" PRIVATE CIFUZZ_GENERATED_CORPUS_DIR="${_generated_corpus_dir}")
+    endif()
+  else()
+    # Compile the path to the seed corpus, which lives under the source root, into the fuzz test binary as it is built
+    # out-of-tree. An alternative could be to symlink the seed corpus to a well-known location next to the binary, but
+    # symlinks are not always available on Windows (junctions exist, but may cause issues with tools that are unaware
+    # of them and are not easy to deal with using just POSIX functions).
+    _cifuzz_c_string_path(_source_seed_corpus "${CMAKE_CURRENT_SOURCE_DIR}/${name}${_seed_corpus_suffix}")
+    target_compile_definitions("${name}" PRIVATE CIFUZZ_SEED_CORPUS="${_source_seed_corpus}")
+
+    # Coverage builds should always run over the full generated corpus in addition to the seed corpus.
+    if(coverage IN_LIST CIFUZZ_SANITIZERS OR gcov IN_LIST CIFUZZ_SANITIZERS)
+      _cifuzz_c_string_path(_source_generated_corpus "${CMAKE_SOURCE_DIR}/.cifuzz-corpus/${name}")
+      target_compile_definitions("${name}" PRIVATE CIFUZZ_GENERATED_CORPUS="${_source_generated_corpus}")
+    endif()
   endif()
 
-  # Collect a mapping from CMake target names to information required by cifuzz. Currently, this includes the path of
-  # the fuzz test executable as well as of its seed corpus.
-  # We don't use add_custom_command here as we want the mapping to exist already after the configure step, not only
-  # after the build step - this way, it is comparatively cheap to update the mapping since the actual build tool doesn't
-  # have to run. IDEs may even refresh the metadata automatically for us.
-  # Note: Removed and renamed targets leave behind their entry in this mapping. Since these files are cheap to
-  #       regenerate, cifuzz can just delete the entire .cifuzz directory before each build (see enable_fuzz_testing).
-  set(_executable_info_file "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests/${name}/executable")
-  file(GENERATE
-       OUTPUT "$<SHELL_PATH:${_executable_info_file}>"
-       CONTENT $<TARGET_FILE:${name}>)
-  set(_seed_corpus_info_file "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests/${name}/seed_corpus")
-  file(GENERATE
-       OUTPUT "$<SHELL_PATH:${_seed_corpus_info_file}>"
-       CONTENT "${_source_seed_corpus}")
-
-  set(_test_name "${name}_regression_test")
-  add_test(NAME "${_test_name}" COMMAND "${name}")
-  set_tests_properties("${_test_name}" PROPERTIES LABELS "cifuzz_regression_test")
-
-  # Define an install component cifuzz_internal_deps_${name} that, when "installed", prints the full paths of the
-  # transitive runtime dependencies, including system libraries, of the fuzz target to stdout in the form:
-  #
-  # -- CIFUZZ RESOLVED /lib/x86_64-linux-gnu/libgcc_s.so.1
-  # -- CIFUZZ RESOLVED /home/user/git/cifuzz/tools/cmake/testdata/build/src/utils/libhelper.so
-  # -- CIFUZZ RESOLVED /lib/x86_64-linux-gnu/libstdc++.so.6
-  #
-  # If any library couldn't be resolved (unambiguously), it is reported with a leading UNRESOLVED or CONFLICTING.
-  install(CODE "
-    file(GET_RUNTIME_DEPENDENCIES
-        RESOLVED_DEPENDENCIES_VAR _resolved_deps
-        UNRESOLVED_DEPENDENCIES_VAR _unresolved_deps
-        CONFLICTING_DEPENDENCIES_PREFIX _conflicting_deps
-        EXECUTABLES \"$<TARGET_FILE:${name}>\"
-    )
-
-    foreach(_resolved_dep IN LISTS _resolved_deps)
-        message(STATUS \"CIFUZZ RESOLVED \${_resolved_dep}\")
-    endforeach()
-    foreach(_unresolved_dep IN LISTS _unresolved_deps)
-        message(STATUS \"CIFUZZ UNRESOLVED \${_unresolved_dep}\")
-    endforeach()
-    foreach(_conflicting_dep IN LISTS _conflicting_deps)
-        message(STATUS \"CIFUZZ CONFLICTING \${_conflicting_dep}\")
-    endforeach()
-  " COMPONENT "cifuzz_internal_deps_${name}")
+  foreach(_fuzz_test IN LISTS _fuzz_tests)
+    if(_args_TESTS)
+      # Allow building a registered fuzz test by its name, which builds the executable containing it.
+      add_custom_target("${_fuzz_test}")
+      add_dependencies("${_fuzz_test}" "${name}")
+    endif()
+    _cifuzz_c_string_path(_source_seed_corpus "${CMAKE_CURRENT_SOURCE_DIR}/${_fuzz_test}${_seed_corpus_suffix}")
+    # Collect a mapping from CMake target names to information required by cifuzz. Currently, this includes the path of
+    # the fuzz test executable as well as of its seed corpus.
+    # We don't use add_custom_command here as we want the mapping to exist already after the configure step, not only
+    # after the build step - this way, it is comparatively cheap to update the mapping since the actual build tool
+    # doesn't have to run. IDEs may even refresh the metadata automatically for us.
+    # Note: Removed and renamed targets leave behind their entry in this mapping. Since these files are cheap to
+    #       regenerate, cifuzz can just delete the entire .cifuzz directory before each build (see enable_fuzz_testing).
+    set(_executable_info_file "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests/${_fuzz_test}/executable")
+    file(GENERATE
+         OUTPUT "$<SHELL_PATH:${_executable_info_file}>"
+         CONTENT $<TARGET_FILE:${name}>)
+    set(_seed_corpus_info_file "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests/${_fuzz_test}/seed_corpus")
+    file(GENERATE
+         OUTPUT "$<SHELL_PATH:${_seed_corpus_info_file}>"
+         CONTENT "${_source_seed_corpus}")
+
+    if(_args_TESTS)
+      set(_registered_test_info_file "${CMAKE_BINARY_DIR}/$<CONFIG>/.cifuzz/fuzz_tests/${_fuzz_test}/registered_test")
+      file(GENERATE
+           OUTPUT "$<SHELL_PATH:${_registered_test_info_file}>"
+           CONTENT "${_fuzz_test}")
+      set(_registered_test "${_fuzz_test}")
+    else()
+      set(_registered_test "")
+    endif()
+    set_property(GLOBAL APPEND PROPERTY CIFUZZ_FUZZ_TEST_INDEX
+                 "${_fuzz_test}\t$<TARGET_FILE:${name}>\t${_source_seed_corpus}\t${_registered_test}")
+
+    set(_test_name "${_fuzz_test}_regression_test")
+    set(_regression_test_args)
+    if(CIFUZZ_ENGINE STREQUAL replayer)
+      # Run the inputs of the most recent findings first and the other inputs by ascending size, so that a regression
+      # fails the test as early as possible.
+      set(_regression_test_args -order=size "-run_first=${CMAKE_SOURCE_DIR}/.cifuzz-findings/recent_inputs")
+    endif()
+    add_test(NAME "${_test_name}" COMMAND "${name}" ${_regression_test_args})
+    set_tests_properties("${_test_name}" PROPERTIES LABELS "cifuzz_regression_test")
+    if(_args_TESTS)
+      set_tests_properties("${_test_name}" PROPERTIES ENVIRONMENT "CIFUZZ_TEST=${_fuzz_test}")
+    endif()
+
+    # Define an install component cifuzz_internal_deps_${_fuzz_test} that, when "installed", prints the full paths of
+    # the transitive runtime dependencies, including system libraries, of the fuzz target to stdout in the form:
+    #
+    # -- CIFUZZ RESOLVED /lib/x86_64-linux-gnu/libgcc_s.so.1
+    # -- CIFUZZ RESOLVED /home/user/git/cifuzz/tools/cmake/testdata/build/src/utils/libhelper.so
+    # -- CIFUZZ RESOLVED /lib/x86_64-linux-gnu/libstdc++.so.6
+    #
+    # If any library couldn't be resolved (unambiguously), it is reported with a leading UNRESOLVED or CONFLICTING.
+    install(CODE "
+      file(GET_RUNTIME_DEPENDENCIES
+          RESOLVED_DEPENDENCIES_VAR _resolved_deps
+          UNRESOLVED_DEPENDENCIES_VAR _unresolved_deps
+          CONFLICTING_DEPENDENCIES_PREFIX _conflicting_deps
+          EXECUTABLES \"$<TARGET_FILE:${name}>\"
+      )
+
+      foreach(_resolved_dep IN LISTS _resolved_deps)
+          message(STATUS \"CIFUZZ RESOLVED \${_resolved_dep}\")
+      endforeach()
+      foreach(_unresolved_dep IN LISTS _unresolved_deps)
+          message(STATUS \"CIFUZZ UNRESOLVED \${_unresolved_dep}\")
+      endforeach()
+      foreach(_conflicting_dep IN LISTS _conflicting_deps)
+          message(STATUS \"CIFUZZ CONFLICTING \${_conflicting_dep}\")
+      endforeach()
+    " COMPONENT "cifuzz_internal_deps_${_fuzz_test}")
+  endforeach()
 endfunction()
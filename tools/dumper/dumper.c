@@ -1,6 +1,9 @@
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unwind.h>
 
 #ifdef __APPLE__
 #include <dlfcn.h>
@@ -15,6 +18,33 @@ static const char UBSAN_SUMMARY_PREFIX[] = "SUMMARY: UndefinedBehaviorSanitizer:
 static const char ASAN_SUMMARY_PREFIX[] = "SUMMARY: AddressSanitizer:";
 static void (*sanitizer_death_callback)(void) = NULL;
 
+/*
+ * The maximum number of buckets of non-fatal findings to dump inputs for. A
+ * target that keeps reporting new findings would otherwise fill the disk.
+ */
+#define MAX_FINDING_BUCKETS 256
+/* The number of innermost stack frames that identify a bucket. */
+#define MAX_BUCKET_FRAMES 32
+
+/*
+ * Non-fatal findings with the same summary and the same innermost stack
+ * frames, i.e. most likely the same bug, share a bucket. Only the first input
+ * per bucket is dumped, the number of findings per bucket is printed at exit.
+ * Sanitizers serialize their reports, so no locking is needed.
+ */
+struct finding_bucket {
+  unsigned long long hash;
+  unsigned long count;
+  char summary[160];
+};
+static struct finding_bucket finding_buckets[MAX_FINDING_BUCKETS];
+static size_t num_finding_buckets = 0;
+static unsigned long num_unbucketed_findings = 0;
+
+/* Whether ASan and UBSan halt on error, or -1 if not parsed yet. */
+static int asan_halt_on_error = -1;
+static int ubsan_halt_on_error = -1;
+
 /*
  * By linking this file into a fuzz test (and adding a linker flag on Linux),
  * non-fatal sanitizer findings will still write an input to disk.
@@ -28,8 +58,123 @@ static void (*sanitizer_death_callback)(void) = NULL;
  *   this hook to also dump the input for non-fatal findings.
  */
 
+/*
+ * Returns the value of the halt_on_error flag in the sanitizer options in the
+ * environment variable |name|, or |default_value| if it isn't set. As with the
+ * sanitizers, flags are separated by colons, commas or whitespace and the last
+ * occurrence wins.
+ */
+static int parse_halt_on_error(const char *name, int default_value) {
+  static const char FLAG[] = "halt_on_error=";
+  const char *options = getenv(name);
+  int result = default_value;
+
+  if (options == NULL) {
+    return result;
+  }
+  while (*options != '\0') {
+    size_t len = strcspn(options, ":, \t\n");
+    if (len >= sizeof(FLAG) - 1 && strncmp(options, FLAG, sizeof(FLAG) - 1) == 0) {
+      const char *value = options + sizeof(FLAG) - 1;
+      size_t value_len = len - (sizeof(FLAG) - 1);
+      if ((value_len == 1 && strncmp(value, "0", 1) == 0) || (value_len == 2 && strncmp(value, "no", 2) == 0) ||
+          (value_len == 5 && strncmp(value, "false", 5) == 0)) {
+        result = 0;
+      } else if ((value_len == 1 && strncmp(value, "1", 1) == 0) ||
+                 (value_len == 3 && strncmp(value, "yes", 3) == 0) ||
+                 (value_len == 4 && strncmp(value, "true", 4) == 0)) {
+        result = 1;
+      }
+    }
+    options += len;
+    if (*options != '\0') {
+      options++;
+    }
+  }
+  return result;
+}
+
+static unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size) {
+  /* FNV-1a */
+  const unsigned char *bytes = (const unsigned char *) data;
+  size_t i;
+
+  for (i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+struct stack_hash_state {
+  unsigned long long hash;
+  int num_frames;
+};
+
+static _Unwind_Reason_Code hash_frame(struct _Unwind_Context *context, void *arg) {
+  struct stack_hash_state *state = (struct stack_hash_state *) arg;
+  uintptr_t pc = (uintptr_t) _Unwind_GetIP(context);
+
+  state->hash = hash_bytes(state->hash, &pc, sizeof(pc));
+  if (++state->num_frames == MAX_BUCKET_FRAMES) {
+    return _URC_END_OF_STACK;
+  }
+  return _URC_NO_REASON;
+}
+
+static void print_finding_buckets(void) {
+  size_t i;
+
+  for (i = 0; i < num_finding_buckets; i++) {
+    /* Leave out the "SUMMARY: " prefix so that this isn't parsed as a new finding. */
+    fprintf(stderr, "INFO: cifuzz: %lu non-fatal finding(s) of: %s\n", finding_buckets[i].count,
+            finding_buckets[i].summary + strlen("SUMMARY: "));
+  }
+  if (num_unbucketed_findings > 0) {
+    fprintf(stderr, "INFO: cifuzz: %lu non-fatal finding(s) in further buckets, no inputs dumped\n",
+            num_unbucketed_findings);
+  }
+}
+
+/*
+ * Calls the death callback for the first finding in the bucket of this
+ * finding, which is identified by its summary and the program counters of the
+ * innermost stack frames. The frames are not symbolized, which keeps this cheap
+ * enough to run on every report.
+ */
+static void dump_input_once_per_bucket(const char *error_summary) {
+  struct stack_hash_state state;
+  size_t i;
+
+  if (sanitizer_death_callback == NULL) {
+    return;
+  }
+  state.hash = hash_bytes(14695981039346656037ULL, error_summary, strlen(error_summary));
+  state.num_frames = 0;
+  _Unwind_Backtrace(hash_frame, &state);
+
+  for (i = 0; i < num_finding_buckets; i++) {
+    if (finding_buckets[i].hash == state.hash) {
+      finding_buckets[i].count++;
+      return;
+    }
+  }
+  if (num_finding_buckets == MAX_FINDING_BUCKETS) {
+    num_unbucketed_findings++;
+    return;
+  }
+  if (num_finding_buckets == 0) {
+    atexit(print_finding_buckets);
+  }
+  finding_buckets[num_finding_buckets].hash = state.hash;
+  finding_buckets[num_finding_buckets].count = 1;
+  strncpy(finding_buckets[num_finding_buckets].summary, error_summary,
+          sizeof(finding_buckets[num_finding_buckets].summary) - 1);
+  num_finding_buckets++;
+  sanitizer_death_callback();
+}
+
 void sanitizer_death_callback_if_non_fatal_finding(const char *error_summary) {
-  if (strncmp(ASAN_SUMMARY_PREFIX, error_summary, strlen(ASAN_SUMMARY_PREFIX)) == 0) {
+  if (strncmp(ASAN_SUMMARY_PREFIX, error_summary, sizeof(ASAN_SUMMARY_PREFIX) - 1) == 0) {
     /*
      * Don't dump the input if this is a memory leak report, because
      * those are dumped by libFuzzer itself even when ASan was
@@ -39,37 +184,36 @@ void sanitizer_death_callback_if_non_fatal_finding(const char *error_summary) {
       return;
     }
 
-
-    char *options = getenv("ASAN_OPTIONS");
     /*
      * The default for ASan is to halt on error, so we check if it was
      * configured to *not* halt on error
      */
-    if (strstr(options, "halt_on_error=0") || \
-        strstr(options, "halt_on_error=no") || \
-        strstr(options, "halt_on_error=false")) {
+    if (asan_halt_on_error == -1) {
+      asan_halt_on_error = parse_halt_on_error("ASAN_OPTIONS", 1);
+    }
+    if (!asan_halt_on_error) {
       /*
        * ASan was configured to not halt, so we dump the input here
        * because it's not dumped by libFuzzer itself
        */
-      sanitizer_death_callback();
+      dump_input_once_per_bucket(error_summary);
     }
   }
 
-  if (strncmp(UBSAN_SUMMARY_PREFIX, error_summary, strlen(ASAN_SUMMARY_PREFIX)) == 0) {
-    char *options = getenv("UBSAN_OPTIONS");
+  if (strncmp(UBSAN_SUMMARY_PREFIX, error_summary, sizeof(UBSAN_SUMMARY_PREFIX) - 1) == 0) {
     /*
     * The default for UBSan is to *not* halt on error, so we check if
     * it was configured to do halt on error
     */
-    if (!strstr(options, "halt_on_error=1") && \
-        !strstr(options, "halt_on_error=yes") && \
-        !strstr(options, "halt_on_error=true")) {
+    if (ubsan_halt_on_error == -1) {
+      ubsan_halt_on_error = parse_halt_on_error("UBSAN_OPTIONS", 0);
+    }
+    if (!ubsan_halt_on_error) {
       /*
       * UBSan was not configured to halt, so we dump the input here
       * because it's not dumped by libFuzzer itself
       */
-      sanitizer_death_callback();
+      dump_input_once_per_bucket(error_summary);
     }
   }
 }
@@ -0,0 +1,103 @@
+//go:build unix
+
+package fuzzeddataprovider
+
+import (
+	"fmt"
+	"os/exec"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/internal/testutil"
+)
+
+const includeDir = "../../include"
+
+// The input sizes of the benchmarks
+var benchInputSizes = []int{64, 4 << 10, 1 << 20}
+
+type buildCase struct {
+	name  string
+	flags []string
+}
+
+var buildCases = []buildCase{
+	{"O2", []string{"-O2"}},
+	{"asan", []string{"-O1", "-g", "-fsanitize=address,undefined", "-fno-sanitize-recover=all"}},
+}
+
+// compileBench compiles the benchmark program, which also checks that
+// the variants of the consumers return the same values, see
+// testdata/fdp_bench.cpp.
+func compileBench(tb testing.TB, compiler string, c buildCase) string {
+	outFile := filepath.Join(tb.TempDir(), "fdp_bench")
+	args := append([]string{"-std=c++20", "-Wall", "-Wextra", "-Werror", "-I", includeDir, "-o", outFile}, c.flags...)
+	args = append(args, filepath.Join("testdata", "fdp_bench.cpp"))
+	cmd := exec.Command(compiler, args...)
+	out, err := cmd.CombinedOutput()
+	require.NoErrorf(tb, err, "Failed to execute %q: %+v\n%s", cmd.String(), err, string(out))
+	return outFile
+}
+
+func TestIntegration_FuzzedDataProvider_VariantsReturnSameValues(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	testutil.RegisterTestDeps(filepath.Join(includeDir, "fuzzer"), "testdata")
+
+	for _, compiler := range []string{"clang++", "g++"} {
+		for _, c := range buildCases {
+			compiler, c := compiler, c
+			t.Run(compiler+"/"+c.name, func(t *testing.T) {
+				t.Parallel()
+				bench := compileBench(t, compiler, c)
+				out, err := exec.Command(bench, "check").CombinedOutput()
+				require.NoError(t, err, string(out))
+				require.Equal(t, "ok\n", string(out))
+			})
+		}
+	}
+}
+
+// BenchmarkFuzzedDataProvider measures the consumers of
+// FuzzedDataProvider, which each consume inputs of several sizes until
+// they are exhausted, with and without sanitizers. The time per input
+// is measured by the benchmark program, so that it doesn't include
+// starting the program. Besides the time per input, it reports the
+// time per call of the consumer and the throughput. Run it with:
+//
+//	go test ./tools/fuzzeddataprovider -run '^$' -bench BenchmarkFuzzedDataProvider
+func BenchmarkFuzzedDataProvider(b *testing.B) {
+	testutil.RegisterTestDeps(filepath.Join(includeDir, "fuzzer"), "testdata")
+
+	for _, c := range buildCases {
+		bench := compileBench(b, "clang++", c)
+		out, err := exec.Command(bench, "list").Output()
+		require.NoError(b, err)
+		consumers := strings.Fields(string(out))
+
+		for _, consumer := range consumers {
+			for _, size := range benchInputSizes {
+				consumer, size := consumer, size
+				b.Run(fmt.Sprintf("%s/%s/size=%d", c.name, consumer, size), func(b *testing.B) {
+					out, err := exec.Command(bench, "bench", consumer, strconv.Itoa(size), strconv.Itoa(b.N)).Output()
+					require.NoError(b, err)
+					fields := strings.Fields(string(out))
+					require.Len(b, fields, 2)
+					nsPerInput, err := strconv.ParseFloat(fields[0], 64)
+					require.NoError(b, err)
+					callsPerInput, err := strconv.ParseFloat(fields[1], 64)
+					require.NoError(b, err)
+
+					b.ReportMetric(nsPerInput, "ns/op")
+					b.ReportMetric(nsPerInput/callsPerInput, "ns/call")
+					b.ReportMetric(float64(size)*1e3/nsPerInput, "MB/s")
+				})
+			}
+		}
+	}
+}
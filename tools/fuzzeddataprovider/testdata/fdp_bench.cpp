@@ -0,0 +1,409 @@
+// Benchmarks the consumers of FuzzedDataProvider and checks that their
+// zero-copy, arena and bulk variants return the same values as the owning and
+// scalar ones.
+//
+// Usage:
+//   fdp_bench check
+//   fdp_bench bench <consumer> <input size> <iterations>
+//
+// In bench mode, it consumes |iterations| inputs of |input size| bytes with
+// the consumer until they are exhausted and prints the nanoseconds per input
+// and the number of calls per input.
+
+#include <fuzzer/FuzzedDataProvider.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// The number of distinct inputs the iterations cycle through.
+constexpr size_t kNumInputs = 16;
+// The number of values the bulk consumers fill per call.
+constexpr size_t kArrayCount = 64;
+
+// Keeps the compiler from optimizing away the computation of |value|.
+template <typename T> void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Returns deterministic pseudo-random inputs. Every 16th byte is a
+// backslash, so that the strings are short and some contain escapes.
+std::vector<std::vector<uint8_t>> MakeInputs(size_t size, size_t count,
+                                             uint64_t seed) {
+  std::vector<std::vector<uint8_t>> inputs(count);
+  uint64_t state = seed * 0x9E3779B97F4A7C15 + 1;
+  for (auto &input : inputs) {
+    input.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      input[i] = (state & 0xF) == 0 ? '\\' : static_cast<uint8_t>(state >> 8);
+    }
+  }
+  return inputs;
+}
+
+// A consumer which consumes the whole input and returns the number of calls.
+using Consumer = std::function<size_t(const uint8_t *data, size_t size)>;
+
+char arena[1 << 16];
+
+const int kPickArray[] = {2,  3,  5,  7,  11, 13, 17, 19,
+                          23, 29, 31, 37, 41, 43, 47, 53};
+
+const std::map<std::string, Consumer> &Consumers() {
+  static const std::map<std::string, Consumer> consumers = {
+      {"ConsumeIntegralInRange",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeIntegralInRange<uint32_t>(0, 100000));
+         return calls;
+       }},
+      {"ConsumeIntegralArrayInRange",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         uint32_t values[kArrayCount];
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls) {
+           fdp.ConsumeIntegralArrayInRange<uint32_t>(values, kArrayCount, 0,
+                                                     100000);
+           DoNotOptimize(values);
+         }
+         return calls;
+       }},
+      {"ConsumeRandomLengthString",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeRandomLengthString(64));
+         return calls;
+       }},
+      {"ConsumeRandomLengthStringView",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size, arena, sizeof(arena));
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeRandomLengthStringView(64));
+         return calls;
+       }},
+      {"ConsumeBytes",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeBytes<uint8_t>(16));
+         return calls;
+       }},
+      {"ConsumeBytesView",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeBytesView<uint8_t>(16));
+         return calls;
+       }},
+      {"ConsumeBytesWithTerminator",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeBytesWithTerminator<char>(16));
+         return calls;
+       }},
+      {"ConsumeBytesWithTerminatorView",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size, arena, sizeof(arena));
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeBytesWithTerminatorView(16));
+         return calls;
+       }},
+      {"ConsumeFloatingPoint",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.ConsumeFloatingPoint<double>());
+         return calls;
+       }},
+      {"ConsumeFloatingPointArray",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         double values[kArrayCount];
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls) {
+           fdp.ConsumeFloatingPointArray<double>(values, kArrayCount);
+           DoNotOptimize(values);
+         }
+         return calls;
+       }},
+      {"PickValueInArray",
+       [](const uint8_t *data, size_t size) {
+         FuzzedDataProvider fdp(data, size);
+         size_t calls = 0;
+         for (; fdp.remaining_bytes() != 0; ++calls)
+           DoNotOptimize(fdp.PickValueInArray(kPickArray));
+         return calls;
+       }},
+  };
+  return consumers;
+}
+
+int Bench(const std::string &name, size_t size, size_t iterations) {
+  auto it = Consumers().find(name);
+  if (it == Consumers().end()) {
+    fprintf(stderr, "unknown consumer: %s\n", name.c_str());
+    return 2;
+  }
+  const Consumer &consume = it->second;
+  std::vector<std::vector<uint8_t>> inputs = MakeInputs(size, kNumInputs, 1);
+  size_t calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    const std::vector<uint8_t> &input = inputs[i % kNumInputs];
+    calls += consume(input.data(), input.size());
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("%f %f\n", elapsed.count() / iterations,
+         static_cast<double>(calls) / iterations);
+  return 0;
+}
+
+int failures = 0;
+
+#define CHECK(condition, ...)                                                  \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      fprintf(stderr, __VA_ARGS__);                                            \
+      fprintf(stderr, "\n");                                                   \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+template <typename T>
+void CheckIntegralArrays(const std::vector<uint8_t> &input, T min, T max) {
+  FuzzedDataProvider scalar(input.data(), input.size());
+  FuzzedDataProvider bulk(input.data(), input.size());
+  for (size_t count : {1, 3, 8, 64}) {
+    std::vector<T> values(count);
+    bulk.ConsumeIntegralArrayInRange<T>(values.data(), count, min, max);
+    for (size_t i = 0; i < count; ++i) {
+      T expected = scalar.ConsumeIntegralInRange<T>(min, max);
+      CHECK(values[i] == expected, "size %zu, count %zu, value %zu",
+            input.size(), count, i);
+    }
+    CHECK(bulk.remaining_bytes() == scalar.remaining_bytes(), "size %zu",
+          input.size());
+  }
+
+  FuzzedDataProvider scalar_full(input.data(), input.size());
+  FuzzedDataProvider bulk_full(input.data(), input.size());
+  std::vector<T> values(kArrayCount);
+  bulk_full.ConsumeIntegralArray<T>(values.data(), values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    CHECK(values[i] == scalar_full.ConsumeIntegral<T>(), "size %zu, value %zu",
+          input.size(), i);
+  CHECK(bulk_full.remaining_bytes() == scalar_full.remaining_bytes(),
+        "size %zu", input.size());
+}
+
+template <typename T>
+void CheckFloatingPointArrays(const std::vector<uint8_t> &input) {
+  FuzzedDataProvider scalar(input.data(), input.size());
+  FuzzedDataProvider bulk(input.data(), input.size());
+  std::vector<T> values(kArrayCount);
+  bulk.ConsumeFloatingPointArray<T>(values.data(), values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    T expected = scalar.ConsumeFloatingPoint<T>();
+    CHECK(std::memcmp(&values[i], &expected, sizeof(T)) == 0,
+          "size %zu, value %zu", input.size(), i);
+  }
+  bulk.ConsumeFloatingPointArrayInRange<T>(values.data(), values.size(), -1,
+                                           1000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    T expected = scalar.ConsumeFloatingPointInRange<T>(-1, 1000);
+    CHECK(std::memcmp(&values[i], &expected, sizeof(T)) == 0,
+          "size %zu, value %zu", input.size(), i);
+  }
+  CHECK(bulk.remaining_bytes() == scalar.remaining_bytes(), "size %zu",
+        input.size());
+}
+
+void CheckViews(const std::vector<uint8_t> &input) {
+  // A tiny arena, so that the copies also spill into heap blocks
+  char small_arena[32];
+  for (size_t arena_size : {size_t{0}, sizeof(small_arena)}) {
+    FuzzedDataProvider owning(input.data(), input.size());
+    FuzzedDataProvider viewing(input.data(), input.size(), small_arena,
+                               arena_size);
+    std::vector<std::string> strings;
+    std::vector<std::string_view> views;
+    while (owning.remaining_bytes() != 0) {
+      switch (owning.remaining_bytes() % 4) {
+      case 0:
+        strings.push_back(owning.ConsumeRandomLengthString(32));
+        views.push_back(viewing.ConsumeRandomLengthStringView(32));
+        break;
+      case 1: {
+        std::vector<char> bytes = owning.ConsumeBytes<char>(7);
+        strings.emplace_back(bytes.begin(), bytes.end());
+        std::span<const char> span = viewing.ConsumeBytesView<char>(7);
+        views.emplace_back(span.data(), span.size());
+        break;
+      }
+      case 2: {
+        std::vector<char> bytes = owning.ConsumeBytesWithTerminator<char>(5);
+        strings.emplace_back(bytes.data());
+        std::string_view view = viewing.ConsumeBytesWithTerminatorView(5);
+        CHECK(view.data()[view.size()] == 0, "size %zu", input.size());
+        views.emplace_back(view.data());
+        break;
+      }
+      default:
+        strings.push_back(owning.ConsumeBytesAsString(3));
+        views.push_back(viewing.ConsumeBytesAsStringView(3));
+      }
+      CHECK(owning.remaining_bytes() == viewing.remaining_bytes(),
+            "size %zu, arena %zu", input.size(), arena_size);
+    }
+    // The views are only compared at the end, to check that they stay valid
+    for (size_t i = 0; i < strings.size(); ++i)
+      CHECK(strings[i] == views[i], "size %zu, arena %zu, piece %zu",
+            input.size(), arena_size, i);
+  }
+}
+
+// The character by character decoding of ConsumeRandomLengthString before
+// it appended whole runs, which existing corpora rely on.
+std::string ReferenceRandomLengthString(const uint8_t *&data, size_t &size,
+                                        size_t max_length) {
+  std::string result;
+  for (size_t i = 0; i < max_length && size != 0; ++i) {
+    char next = static_cast<char>(*data++);
+    --size;
+    if (next == '\\' && size != 0) {
+      next = static_cast<char>(*data++);
+      --size;
+      if (next != '\\')
+        break;
+    }
+    result += next;
+  }
+  return result;
+}
+
+void CheckRandomLengthStrings(const std::vector<uint8_t> &input) {
+  for (size_t max_length : {size_t{0}, size_t{1}, size_t{2}, size_t{5},
+                            size_t{32}, std::numeric_limits<size_t>::max()}) {
+    FuzzedDataProvider owning(input.data(), input.size());
+    FuzzedDataProvider viewing(input.data(), input.size(), arena,
+                               sizeof(arena));
+    const uint8_t *data = input.data();
+    size_t size = input.size();
+    // Nothing is consumed with max length 0, so also bound the pieces
+    for (size_t piece = 0; size != 0 && piece < input.size(); ++piece) {
+      std::string expected = ReferenceRandomLengthString(data, size, max_length);
+      CHECK(owning.ConsumeRandomLengthString(max_length) == expected,
+            "size %zu, max length %zu, piece %zu", input.size(), max_length,
+            piece);
+      CHECK(viewing.ConsumeRandomLengthStringView(max_length) == expected,
+            "size %zu, max length %zu, piece %zu", input.size(), max_length,
+            piece);
+      CHECK(owning.remaining_bytes() == size, "size %zu, max length %zu",
+            input.size(), max_length);
+      CHECK(viewing.remaining_bytes() == size, "size %zu, max length %zu",
+            input.size(), max_length);
+    }
+  }
+}
+
+void CheckRecords(const std::vector<uint8_t> &input) {
+  enum class Kind { kA, kB, kC, kMaxValue = kC };
+  FuzzedDataProvider fields(input.data(), input.size());
+  FuzzedDataProvider records(input.data(), input.size());
+  while (fields.remaining_bytes() != 0) {
+    // Unlike function arguments, the elements of a braced initializer list
+    // are evaluated in order
+    std::tuple<uint16_t, bool, Kind, int64_t, float> expected{
+        fields.ConsumeIntegralInRange<uint16_t>(1, 512), fields.ConsumeBool(),
+        fields.ConsumeEnum<Kind>(), fields.ConsumeIntegral<int64_t>(),
+        fields.ConsumeProbability<float>()};
+    auto record = records.ConsumeRecord<
+        FuzzedIntegralField<uint16_t, 1, 512>, FuzzedBoolField,
+        FuzzedEnumField<Kind>, FuzzedIntegralField<int64_t>,
+        FuzzedProbabilityField<float>>();
+    CHECK(record == expected, "size %zu, remaining %zu", input.size(),
+          fields.remaining_bytes());
+    CHECK(records.remaining_bytes() == fields.remaining_bytes(), "size %zu",
+          input.size());
+  }
+}
+
+int Check() {
+  for (size_t size : {0, 1, 2, 7, 64, 255, 4096}) {
+    for (const std::vector<uint8_t> &input : MakeInputs(size, 8, size)) {
+      CheckIntegralArrays<uint8_t>(input, 0, 255);
+      CheckIntegralArrays<uint8_t>(input, 3, 9);
+      CheckIntegralArrays<int32_t>(input, -1000, 1000);
+      CheckIntegralArrays<uint32_t>(input, 0, 100000);
+      CheckIntegralArrays<int64_t>(input, std::numeric_limits<int64_t>::min(),
+                                   std::numeric_limits<int64_t>::max());
+      CheckIntegralArrays<uint64_t>(input, 1, 1ULL << 40);
+      CheckFloatingPointArrays<float>(input);
+      CheckFloatingPointArrays<double>(input);
+      CheckViews(input);
+      CheckRandomLengthStrings(input);
+      CheckRecords(input);
+    }
+  }
+  // Runs of escapes, escapes split at the end of the input and at the
+  // maximum length
+  for (const char *escapes : {"\\", "\\\\", "a\\\\b\\\\\\", "\\\\\\\\x\\y",
+                              "ab\\\\\\\\cd\\\\\\\\\\"}) {
+    std::vector<uint8_t> input(escapes, escapes + std::strlen(escapes));
+    CheckRandomLengthStrings(input);
+  }
+  if (failures != 0) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc == 2 && std::string(argv[1]) == "check")
+    return Check();
+  if (argc == 5 && std::string(argv[1]) == "bench")
+    return Bench(argv[2], std::strtoull(argv[3], nullptr, 10),
+                 std::strtoull(argv[4], nullptr, 10));
+  if (argc == 2 && std::string(argv[1]) == "list") {
+    for (const auto &consumer : Consumers())
+      printf("%s\n", consumer.first.c_str());
+    return 0;
+  }
+  fprintf(stderr,
+          "usage: %s check | list | bench <consumer> <input size> "
+          "<iterations>\n",
+          argv[0]);
+  return 2;
+}
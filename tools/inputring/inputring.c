@@ -0,0 +1,180 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * By linking this file into a fuzz test (and adding the linker flag
+ * -Wl,--wrap=LLVMFuzzerTestOneInput), every input is copied into a ring of the
+ * last inputs before it is executed. The ring is a file mapped into memory
+ * with MAP_SHARED, so its contents survive a SIGKILL of the fuzz test, e.g. by
+ * the OOM killer or by cifuzz after libFuzzer didn't exit in time, in which
+ * case libFuzzer's death callback doesn't run and the dumper can't save the
+ * input (see src/dumper.c). Copying an input into the page cache is cheap
+ * compared to executing it, so this doesn't noticeably slow down fuzzing.
+ *
+ * The ring is only written if the environment variable CIFUZZ_INPUT_RING is
+ * set to the path of the file to create. CIFUZZ_INPUT_RING_SLOTS is the number
+ * of inputs to keep (8 by default) and CIFUZZ_INPUT_RING_SLOT_SIZE is the
+ * maximum number of bytes stored per input (1 MiB by default), longer inputs
+ * are truncated. The file is read by pkg/inputring after the fuzz test exited.
+ *
+ * The file starts with a header, followed by the slots:
+ *
+ *   header: char magic[8] = "CIFZRNG1", uint32 num_slots, uint32 slot_size,
+ *           uint64 num_inputs, padded to 64 bytes
+ *   slot:   uint64 seq, uint32 size, uint32 state, char data[slot_size],
+ *           padded to a multiple of 8 bytes
+ *
+ * The integers are in the native byte order. The n-th input (counting from 1)
+ * is stored in slot (n - 1) % num_slots with seq n. Its state is RUNNING while
+ * it's executed and DONE once LLVMFuzzerTestOneInput returned, so after an
+ * abnormal exit, the slot with the highest seq in state RUNNING holds the input
+ * which was executed at that time. A seq of 0 marks a slot which is empty or
+ * being written.
+ */
+
+#define INPUT_RING_MAGIC "CIFZRNG1"
+#define INPUT_RING_HEADER_SIZE 64
+#define INPUT_RING_SLOT_HEADER_SIZE 16
+#define INPUT_RING_DEFAULT_SLOTS 8
+#define INPUT_RING_DEFAULT_SLOT_SIZE (1 << 20)
+
+#define INPUT_RING_STATE_RUNNING 1
+#define INPUT_RING_STATE_DONE 2
+
+struct input_ring_header {
+  char magic[8];
+  uint32_t num_slots;
+  uint32_t slot_size;
+  uint64_t num_inputs;
+};
+
+struct input_ring_slot {
+  uint64_t seq;
+  uint32_t size;
+  uint32_t state;
+  unsigned char data[1];
+};
+
+/* The ring, or NULL if it's disabled or couldn't be created. */
+static struct input_ring_header *input_ring = NULL;
+static size_t input_ring_slot_stride = 0;
+/* Whether the environment was checked for the ring already. */
+static int input_ring_initialized = 0;
+
+static unsigned long parse_ring_size(const char *name, unsigned long default_value) {
+  const char *value = getenv(name);
+  char *end;
+  unsigned long result;
+
+  if (value == NULL || *value == '\0') {
+    return default_value;
+  }
+  result = strtoul(value, &end, 10);
+  if (*end != '\0' || result == 0) {
+    fprintf(stderr, "WARNING: cifuzz: ignoring invalid %s=%s\n", name, value);
+    return default_value;
+  }
+  return result;
+}
+
+static void init_input_ring(void) {
+  const char *path = getenv("CIFUZZ_INPUT_RING");
+  unsigned long num_slots;
+  unsigned long slot_size;
+  size_t size;
+  void *mapping;
+  int fd;
+
+  input_ring_initialized = 1;
+  if (path == NULL || *path == '\0') {
+    return;
+  }
+  num_slots = parse_ring_size("CIFUZZ_INPUT_RING_SLOTS", INPUT_RING_DEFAULT_SLOTS);
+  slot_size = parse_ring_size("CIFUZZ_INPUT_RING_SLOT_SIZE", INPUT_RING_DEFAULT_SLOT_SIZE);
+  if (slot_size > UINT32_MAX - 8) {
+    slot_size = UINT32_MAX - 8;
+  }
+  input_ring_slot_stride = (INPUT_RING_SLOT_HEADER_SIZE + slot_size + 7) & ~(size_t) 7;
+  size = INPUT_RING_HEADER_SIZE + num_slots * input_ring_slot_stride;
+
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    perror("WARNING: cifuzz: failed to create the input ring");
+    return;
+  }
+  /* The file is sparse, so only the pages of the inputs stored so far use disk space. */
+  if (ftruncate(fd, (off_t) size) != 0) {
+    perror("WARNING: cifuzz: failed to resize the input ring");
+    close(fd);
+    return;
+  }
+  mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    perror("WARNING: cifuzz: failed to map the input ring");
+    return;
+  }
+
+  input_ring = (struct input_ring_header *) mapping;
+  input_ring->num_slots = (uint32_t) num_slots;
+  input_ring->slot_size = (uint32_t) slot_size;
+  input_ring->num_inputs = 0;
+  /* The magic is written last, so that a partially initialized ring is ignored. */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(input_ring->magic, INPUT_RING_MAGIC, sizeof(input_ring->magic));
+}
+
+static struct input_ring_slot *start_input(const uint8_t *data, size_t size) {
+  struct input_ring_slot *slot;
+  uint64_t seq;
+  size_t stored_size;
+
+  if (!input_ring_initialized) {
+    init_input_ring();
+  }
+  if (input_ring == NULL) {
+    return NULL;
+  }
+
+  seq = input_ring->num_inputs + 1;
+  slot = (struct input_ring_slot *) ((char *) input_ring + INPUT_RING_HEADER_SIZE +
+                                     (size_t) ((seq - 1) % input_ring->num_slots) * input_ring_slot_stride);
+  /*
+   * The stores only have to be ordered with respect to the compiler, because
+   * the file is read after the process exited, when the kernel has all of them.
+   */
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELEASE);
+  stored_size = size < input_ring->slot_size ? size : input_ring->slot_size;
+  memcpy(slot->data, data, stored_size);
+  slot->size = size > UINT32_MAX ? UINT32_MAX : (uint32_t) size;
+  slot->state = INPUT_RING_STATE_RUNNING;
+  __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+  input_ring->num_inputs = seq;
+  return slot;
+}
+
+int __real_LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int __wrap_LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  struct input_ring_slot *slot = start_input(data, size);
+  int result = __real_LLVMFuzzerTestOneInput(data, size);
+
+  if (slot != NULL) {
+    __atomic_store_n(&slot->state, INPUT_RING_STATE_DONE, __ATOMIC_RELEASE);
+  }
+  return result;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1 @@
+inputring.c
\ No newline at end of file
@@ -17,31 +17,74 @@
  * Instead, we set the NO_CIFUZZ environment variable in cifuzz to signal to the fuzz test that it is already
  * running in cifuzz and replace the current process with cifuzz if the variable isn't set.
  *
- * The tricky part is where to execute this logic: -fsanitize=fuzzer provides a main function and the user may use
- * LLVMFuzzerInitialize themselves, so we can't easily use those. We could use constructors in C++, but MSVC requires
- * potentially fragile hacks to get the equivalent of __attribute__((constructor)) in C. Instead, we (ab)use the fact
- * that libFuzzer calls a specific MSan callback very early in its initialization procedure:
- * https://github.com/llvm/llvm-project/blob/2312b747b87300d94e834f257835ce93d36037cf/compiler-rt/lib/fuzzer/FuzzerDriver.cpp#L649
- *
- * This hack will break once we support MemorySanitizer and want to offer the launcher functionality for fuzz tests
- * instrumented with it - unlikely to happen.
- *
- * A downside of this hack is that LLVMFuzzerInitialize is still run - it doesn't matter too much since we replace the
- * process with cifuzz right after, but it may emit output.
+ * This check runs as early as possible, before the user's constructors, static initializers and LLVMFuzzerInitialize,
+ * which may perform expensive setup or emit output:
+ * - On ELF platforms, it is a constructor with the highest priority available to applications, which the linker orders
+ *   before all constructors and static initializers of the executable without a priority. .preinit_array would run
+ *   even earlier, but in dynamically linked executables it runs before libc has been initialized, so getenv and execlp
+ *   don't work yet.
+ * - With MSVC, it is registered as a C initializer in .CRT$XIU, which the CRT runs before all C++ static initializers
+ *   and C constructors in .CRT$XCU.
+ * - On macOS, where constructor priorities are not supported, it is a regular constructor and thus only runs before
+ *   the constructors of objects linked after the launcher.
+ * Constructors of shared libraries the fuzz test depends on still run before.
  */
+
+/* Returns the name of the fuzz test, or NULL if there are several of them and the one to run is selected by the
+ * CIFUZZ_TEST environment variable (see cifuzz/registry.h). It is defined in a source file generated per fuzz test by
+ * add_fuzz_test so that the launcher itself is only compiled once. */
 #ifdef __cplusplus
 extern "C"
 #endif
-void __msan_scoped_disable_interceptor_checks() {
+const char *cifuzz_launcher_test_name(void);
+
+static void cifuzz_launch(void) {
+  const char *name;
+
   if (getenv("NO_CIFUZZ")) {
     /* Running within cifuzz, behave like a regular libFuzzer fuzz target. */
     return;
   }
+  name = cifuzz_launcher_test_name();
+  if (name == NULL) {
+    name = getenv("CIFUZZ_TEST");
+  }
+  if (name == NULL || name[0] == '\0') {
+    printf("Set CIFUZZ_TEST to select the fuzz test to run.\n");
+    exit(1);
+  }
   /* Not running within cifuzz, replace the process with cifuzz running this fuzz test. */
-  POSIX_EXECLP("cifuzz", /*argv[0]=*/ "cifuzz", "run", CIFUZZ_TEST_NAME, NULL);
+  POSIX_EXECLP("cifuzz", /*argv[0]=*/ "cifuzz", "run", name, NULL);
   /* Only reached if execl failed. */
   perror("Failed to execute cifuzz");
-  printf("To start fuzzing, ensure that cifuzz is contained in PATH and execute:\n\n    cifuzz run %s\n\n", CIFUZZ_TEST_NAME);
+  printf("To start fuzzing, ensure that cifuzz is contained in PATH and execute:\n\n    cifuzz run %s\n\n", name);
   printf("If you really want to start the raw fuzzer binary, set NO_CIFUZZ=1.\n");
   exit(1);
 }
+
+#if defined(_MSC_VER)
+#ifdef _WIN64
+#define CIFUZZ_LAUNCHER_SYMBOL_PREFIX ""
+#else
+#define CIFUZZ_LAUNCHER_SYMBOL_PREFIX "_"
+#endif
+static int cifuzz_launch_initializer(void) {
+  cifuzz_launch();
+  return 0;
+}
+#pragma section(".CRT$XIU", long, read)
+/* Referenced via /include to keep the linker from discarding the unreferenced initializer. */
+#ifdef __cplusplus
+extern "C"
+#endif
+__declspec(allocate(".CRT$XIU")) int (*cifuzz_launch_initializer_ptr)(void) = cifuzz_launch_initializer;
+#pragma comment(linker, "/include:" CIFUZZ_LAUNCHER_SYMBOL_PREFIX "cifuzz_launch_initializer_ptr")
+#elif defined(__APPLE__)
+__attribute__((constructor)) static void cifuzz_launch_constructor(void) {
+  cifuzz_launch();
+}
+#else
+__attribute__((constructor(101))) static void cifuzz_launch_constructor(void) {
+  cifuzz_launch();
+}
+#endif
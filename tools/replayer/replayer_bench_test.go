@@ -0,0 +1,206 @@
+//go:build unix
+
+package replayer
+
+import (
+	"bytes"
+	_ "embed"
+	"encoding/binary"
+	"fmt"
+	"math/rand"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"syscall"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/require"
+
+	"code-intelligence.com/cifuzz/internal/bundler/corpuspack"
+	"code-intelligence.com/cifuzz/internal/testutil"
+)
+
+//go:embed testdata/trivial_fuzz_target.c
+var trivialFuzzTargetSrc []byte
+
+type benchCorpus struct {
+	name string
+	// The directory with the inputs, a packed corpus of it and a file
+	// with the inputs as records for -stream_inputs
+	dir        string
+	packPath   string
+	streamPath string
+	numInputs  int
+}
+
+type replayerMode struct {
+	name string
+	args func(c *benchCorpus) []string
+}
+
+var replayerModes = []replayerMode{
+	{"mmap", func(c *benchCorpus) []string {
+		return []string{c.dir}
+	}},
+	{"reuse_input_buffer", func(c *benchCorpus) []string {
+		return []string{"-reuse_input_buffer=1", c.dir}
+	}},
+	{"jobs", func(c *benchCorpus) []string {
+		return []string{"-jobs=" + strconv.Itoa(runtime.NumCPU()), c.dir}
+	}},
+	{"packed", func(c *benchCorpus) []string {
+		return []string{c.packPath}
+	}},
+	{"stream", func(c *benchCorpus) []string {
+		return []string{"-stream_inputs=" + c.streamPath}
+	}},
+}
+
+// BenchmarkReplayer measures the throughput of the replayer in each of
+// its modes on synthetic corpora, running a fuzz test which does
+// nothing. Besides the time per run of the whole corpus, it reports the
+// inputs per second, the time per input, which is the overhead of the
+// replayer, and the peak RSS of the replayer. Run it with:
+//
+//	go test ./tools/replayer -run '^$' -bench BenchmarkReplayer -benchtime 3x
+func BenchmarkReplayer(b *testing.B) {
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "bench")
+	require.NoError(b, err)
+	replayerPath := compileBenchReplayer(b, tempDir)
+
+	rng := rand.New(rand.NewSource(1))
+	tinyInput := func() []byte {
+		input := make([]byte, 1+rng.Intn(16))
+		rng.Read(input)
+		return input
+	}
+	corpora := []struct {
+		name      string
+		inputFunc func(i int) (string, []byte)
+		numInputs int
+	}{
+		{"100k_tiny_files", func(i int) (string, []byte) {
+			return fmt.Sprintf("%06d", i), tinyInput()
+		}, 100_000},
+		{"1k_large_files", func(i int) (string, []byte) {
+			input := make([]byte, 256<<10)
+			rng.Read(input)
+			return fmt.Sprintf("%04d", i), input
+		}, 1000},
+		{"10k_files_in_nested_dirs", func(i int) (string, []byte) {
+			return filepath.Join(strconv.Itoa(i/1000), strconv.Itoa(i/100%10), strconv.Itoa(i/10%10), strconv.Itoa(i%10)), tinyInput()
+		}, 10_000},
+	}
+
+	for _, corpus := range corpora {
+		corpus := corpus
+		var c *benchCorpus
+		b.Run(corpus.name, func(b *testing.B) {
+			if c == nil {
+				c = createBenchCorpus(b, tempDir, corpus.name, corpus.numInputs, corpus.inputFunc)
+			}
+			for _, mode := range replayerModes {
+				mode := mode
+				b.Run(mode.name, func(b *testing.B) {
+					runReplayerBenchmark(b, replayerPath, c, mode.args(c))
+				})
+			}
+		})
+	}
+}
+
+func runReplayerBenchmark(b *testing.B, replayerPath string, c *benchCorpus, args []string) {
+	var elapsed time.Duration
+	var peakRSS int64
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		cmd := exec.Command(replayerPath, append([]string{"-quiet=1"}, args...)...)
+		var stderr bytes.Buffer
+		cmd.Stderr = &stderr
+		start := time.Now()
+		err := cmd.Run()
+		elapsed += time.Since(start)
+		require.NoError(b, err, stderr.String())
+
+		if rss := maxRSS(cmd.ProcessState); rss > peakRSS {
+			peakRSS = rss
+		}
+	}
+	b.StopTimer()
+
+	numInputs := float64(b.N * c.numInputs)
+	b.ReportMetric(numInputs/elapsed.Seconds(), "inputs/s")
+	b.ReportMetric(float64(elapsed.Nanoseconds())/numInputs, "ns/input")
+	b.ReportMetric(float64(peakRSS)/(1<<20), "peak-RSS-MB")
+}
+
+// maxRSS returns the peak resident set size of the exited process and
+// the children it waited for in bytes.
+func maxRSS(state *os.ProcessState) int64 {
+	rusage, ok := state.SysUsage().(*syscall.Rusage)
+	if !ok {
+		return 0
+	}
+	// ru_maxrss is in kilobytes on Linux, but in bytes on macOS
+	if runtime.GOOS == "darwin" {
+		return int64(rusage.Maxrss)
+	}
+	return int64(rusage.Maxrss) << 10
+}
+
+// compileBenchReplayer builds the replayer with optimizations and
+// without sanitizers, which would dominate the overhead per input.
+func compileBenchReplayer(b *testing.B, tempDir string) string {
+	srcDir, err := os.MkdirTemp(tempDir, "src")
+	require.NoError(b, err)
+	replayerSrcFile := filepath.Join(srcDir, "replayer.c")
+	require.NoError(b, os.WriteFile(replayerSrcFile, replayerSrc, 0o644))
+	fuzzTargetSrcFile := filepath.Join(srcDir, "trivial_fuzz_target.c")
+	require.NoError(b, os.WriteFile(fuzzTargetSrcFile, trivialFuzzTargetSrc, 0o644))
+
+	outFile := filepath.Join(srcDir, "replayer")
+	c := exec.Command(clang.compiler, "-O2", "-ansi", "-o", outFile, replayerSrcFile, fuzzTargetSrcFile)
+	c.Dir = srcDir
+	out, err := c.CombinedOutput()
+	require.NoErrorf(b, err, "Failed to execute %q: %+v\n%s", c.String(), err, string(out))
+	return outFile
+}
+
+// createBenchCorpus writes the inputs returned by inputFunc to a corpus
+// directory and creates the packed corpus and the input stream of it.
+func createBenchCorpus(b *testing.B, tempDir, name string, numInputs int, inputFunc func(i int) (string, []byte)) *benchCorpus {
+	c := &benchCorpus{
+		name:       name,
+		dir:        filepath.Join(tempDir, name),
+		packPath:   filepath.Join(tempDir, name+corpuspack.Suffix),
+		streamPath: filepath.Join(tempDir, name+".stream"),
+		numInputs:  numInputs,
+	}
+
+	stream, err := os.Create(c.streamPath)
+	require.NoError(b, err)
+	defer stream.Close()
+	for i := 0; i < numInputs; i++ {
+		relPath, input := inputFunc(i)
+		path := filepath.Join(c.dir, relPath)
+		require.NoError(b, os.MkdirAll(filepath.Dir(path), 0o755))
+		require.NoError(b, os.WriteFile(path, input, 0o644))
+
+		require.NoError(b, binary.Write(stream, binary.LittleEndian, uint32(len(input))))
+		_, err = stream.Write(input)
+		require.NoError(b, err)
+	}
+	require.NoError(b, stream.Close())
+
+	pack, err := os.Create(c.packPath)
+	require.NoError(b, err)
+	defer pack.Close()
+	require.NoError(b, corpuspack.WriteDir(pack, c.dir))
+	require.NoError(b, pack.Close())
+	return c
+}
@@ -3,6 +3,8 @@ package replayer
 import (
 	"bytes"
 	_ "embed"
+	"encoding/binary"
+	"encoding/json"
 	"fmt"
 	"log"
 	"os"
@@ -10,6 +12,7 @@ import (
 	"path/filepath"
 	"reflect"
 	"runtime"
+	"sort"
 	"strings"
 	"testing"
 
@@ -17,6 +20,7 @@ import (
 	"github.com/stretchr/testify/assert"
 	"github.com/stretchr/testify/require"
 
+	"code-intelligence.com/cifuzz/internal/bundler/corpuspack"
 	"code-intelligence.com/cifuzz/internal/testutil"
 	"code-intelligence.com/cifuzz/util/fileutil"
 )
@@ -147,6 +151,11 @@ var baseRunCases = []runCase{
 		[]any{"foo", "bar"},
 		true,
 	},
+	{
+		"empty file",
+		[]any{""},
+		true,
+	},
 	{
 		"single empty directory",
 		[]any{[]string{}},
@@ -343,6 +352,873 @@ func TestIntegration_Replayer_WithoutArgsRunsSeedCorpus(t *testing.T) {
 	)
 }
 
+func TestIntegration_Replayer_ReuseInputBuffer(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	flags := []string{"-reuse_input_buffer=1"}
+
+	// Inputs shrinking in size must not observe the contents of previous, larger inputs.
+	stdoutLines, _, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "a_much_longer_input", "foo", "")
+	require.NoError(t, err)
+	assert.Equal(t, []string{fmt.Sprintf("init(5,%s)", replayerPath), "'a_much_longer_input'", "'foo'", "''"}, stdoutLines)
+
+	// Reads past the end of an input still have to be detected by ASan even though the buffer is larger.
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "a_much_longer_input", "asan")
+	require.Error(t, err)
+	assert.Contains(t, stderr, "AddressSanitizer")
+	assert.Contains(t, stderr, "failed on input")
+}
+
+func TestIntegration_Replayer_ReadAhead(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("-read_ahead is not supported on Windows")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+
+	var inputs []string
+	expectedStdoutLines := []string{fmt.Sprintf("init(3,%s)", replayerPath)}
+	for i := 0; i < 50; i++ {
+		input := fmt.Sprintf("input%02d", i)
+		inputs = append(inputs, input)
+		expectedStdoutLines = append(expectedStdoutLines, fmt.Sprintf("'%s'", input))
+	}
+	// Every input runs exactly once, however far the thread reads ahead.
+	for _, flag := range []string{"-read_ahead=0", "-read_ahead=1", "-read_ahead=100"} {
+		stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, []string{flag}, inputs)
+		require.NoError(t, err, flag)
+		assert.ElementsMatch(t, expectedStdoutLines, stdoutLines, flag)
+		assert.Contains(t, stderr, fmt.Sprintf("Ran fuzz test on %d inputs - passed", len(inputs)), flag)
+	}
+
+	// Entries of packed corpora are paged in rather than read.
+	corpusDir := filepath.Join(tempDir, "corpus")
+	require.NoError(t, os.Mkdir(corpusDir, 0755))
+	for _, input := range inputs {
+		require.NoError(t, os.WriteFile(filepath.Join(corpusDir, input), []byte(input), 0644))
+	}
+	packPath := filepath.Join(tempDir, "corpus"+corpuspack.Suffix)
+	pack, err := os.Create(packPath)
+	require.NoError(t, err)
+	require.NoError(t, corpuspack.WriteDir(pack, corpusDir))
+	require.NoError(t, pack.Close())
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, []string{"-read_ahead=4", packPath})
+	require.NoError(t, err)
+	assert.Equal(t, append([]string{fmt.Sprintf("init(3,%s)", replayerPath)}, expectedStdoutLines[1:]...), stdoutLines)
+	assert.Contains(t, stderr, fmt.Sprintf("Ran fuzz test on %d inputs - passed", len(inputs)))
+
+	// The replayer still stops at the first failing input, even though the following ones were already read.
+	stdoutLines, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{"-read_ahead=4"}, "foo", "assert", "bar")
+	require.Error(t, err)
+	assert.Equal(t, []string{fmt.Sprintf("init(5,%s)", replayerPath), "'foo'"}, stdoutLines)
+	assert.Contains(t, stderr, "failed on input")
+}
+
+func TestIntegration_Replayer_LeakCheck(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS != "linux" {
+		t.Skip("LeakSanitizer is only enabled by default on Linux")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+
+	var inputs []string
+	for i := 0; i < 20; i++ {
+		inputs = append(inputs, fmt.Sprintf("input%02d", i))
+	}
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, []string{"-leak_check_inputs=8"}, inputs)
+	require.NoError(t, err)
+	assert.Contains(t, stderr, fmt.Sprintf("Ran fuzz test on %d inputs - passed", len(inputs)))
+
+	// The leak is attributed to the input that caused it, within a batch as well as with workers.
+	inputs[13] = "leak"
+	for _, flags := range [][]string{{"-leak_check_inputs=8"}, {"-leak_check_inputs=3", "-jobs=2"}} {
+		_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, inputs)
+		var exitErr *exec.ExitError
+		require.ErrorAs(t, err, &exitErr, flags)
+		assert.Equal(t, 23, exitErr.ExitCode(), flags)
+		assert.Equal(t, 1, strings.Count(stderr, "ERROR: LeakSanitizer: detected memory leaks"), flags)
+		assert.Contains(t, stderr, "Reason: Memory leak\n", flags)
+		_, failingInput, found := strings.Cut(stderr, "Fuzz test failed on input '")
+		require.True(t, found, flags)
+		failingInput, _, _ = strings.Cut(failingInput, "'")
+		content, err := os.ReadFile(failingInput)
+		require.NoError(t, err, flags)
+		assert.Equal(t, "leak", string(content), flags)
+	}
+}
+
+func TestIntegration_Replayer_Jobs(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("-jobs is not supported on Windows")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	flags := []string{"-jobs=3"}
+
+	inputs := []string{"foo", "bar", "baz", "bob", "alice", "eve", "mallory"}
+	expectedStdoutLines := []string{fmt.Sprintf("init(3,%s)", replayerPath)}
+	for _, input := range inputs {
+		expectedStdoutLines = append(expectedStdoutLines, fmt.Sprintf("'%s'", input))
+	}
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, inputs)
+	require.NoError(t, err)
+	// LLVMFuzzerInitialize runs only once, before the workers are forked.
+	assert.ElementsMatch(t, expectedStdoutLines, stdoutLines)
+	assert.Contains(t, stderr, fmt.Sprintf("Ran fuzz test on %d inputs - passed", len(inputs)))
+
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, append(inputs, "assert"))
+	require.Error(t, err)
+	assert.Contains(t, stderr, "failed on input")
+	assert.Contains(t, stderr, "Reason: Aborted")
+}
+
+func TestIntegration_Replayer_Threads(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("-threads is not supported on Windows")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	flags := []string{"-threads=3"}
+	inputs := []string{"foo", "bar", "baz", "bob", "alice", "eve", "mallory"}
+
+	// Fuzz tests which aren't declared thread-safe are rejected.
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, inputs)
+	require.Error(t, err)
+	assert.Contains(t, stderr, "FUZZ_TEST_THREAD_SAFE")
+
+	replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, append([]string{"-DDECLARE_THREAD_SAFE"}, clang.flags...)...)
+	expectedStdoutLines := []string{fmt.Sprintf("init(3,%s)", replayerPath)}
+	for _, input := range inputs {
+		expectedStdoutLines = append(expectedStdoutLines, fmt.Sprintf("'%s'", input))
+	}
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, inputs)
+	require.NoError(t, err)
+	// LLVMFuzzerInitialize runs only once, before the threads are started.
+	assert.ElementsMatch(t, expectedStdoutLines, stdoutLines)
+	assert.Contains(t, stderr, fmt.Sprintf("Ran fuzz test on %d inputs - passed", len(inputs)))
+
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, append(inputs, "assert"))
+	require.Error(t, err)
+	assert.Contains(t, stderr, "failed on input")
+	assert.Contains(t, stderr, "Reason: Aborted")
+
+	// The watchdog reports the input of the thread which hangs.
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, append(flags, "-timeout=1"), append(inputs, "hang"))
+	var exitErr *exec.ExitError
+	require.ErrorAs(t, err, &exitErr)
+	assert.Equal(t, 70, exitErr.ExitCode())
+	assert.Contains(t, stderr, "Reason: Timeout after")
+}
+
+func TestIntegration_Replayer_KeepGoing(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("-keep_going is not supported on Windows")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+
+	for _, flags := range [][]string{
+		{"-keep_going=1"},
+		{"-keep_going=1", "-jobs=2"},
+		{"-keep_going=1", "-inputs_per_fork=3"},
+		{"-keep_going=1", "-inputs_per_fork=2", "-jobs=2"},
+	} {
+		stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "assert", "bar", "return", "baz")
+		require.Error(t, err)
+		// All inputs run, including those after the failing ones.
+		assert.ElementsMatch(t, []string{fmt.Sprintf("init(%d,%s)", len(flags)+6, replayerPath), "'foo'", "'bar'", "'baz'"}, stdoutLines)
+		assert.Contains(t, stderr, "Fuzz test failed on 2 inputs, 3 inputs passed")
+		assert.Equal(t, 2, strings.Count(stderr, "Reason: Aborted"))
+	}
+
+	// The server keeps serving after a failing input.
+	foo := createInputFile(t, tempDir, "foo")
+	failing := createInputFile(t, tempDir, "assert")
+	c := exec.Command(replayerPath, "-server=1", "-keep_going=1")
+	c.Stdin = strings.NewReader(strings.Join([]string{foo, failing, foo}, "\n") + "\n")
+	_, stderr, err := outputWithStderr(c)
+	require.Error(t, err)
+	var replies []string
+	for _, line := range strings.Split(string(stderr), "\n") {
+		if strings.HasPrefix(line, "PASS\t") || strings.HasPrefix(line, "FAIL\t") {
+			replies = append(replies, line)
+		}
+	}
+	assert.Equal(t, []string{"PASS\t" + foo, "FAIL\tAborted\t" + failing, "PASS\t" + foo}, replies)
+}
+
+func TestIntegration_Replayer_Server(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+
+	foo := createInputFile(t, tempDir, "foo")
+	bar := createInputFile(t, tempDir, "bar")
+	failing := createInputFile(t, tempDir, "return")
+	c := exec.Command(replayerPath, "-server=1")
+	c.Stdin = strings.NewReader(strings.Join([]string{foo, bar, failing, foo}, "\n") + "\n")
+	stdout, stderr, err := outputWithStderr(c)
+	require.Error(t, err)
+
+	// LLVMFuzzerInitialize runs only once for all inputs and the server stops at the first failing input.
+	assert.Equal(t, fmt.Sprintf("init(2,%s)\n'foo'\n'bar'\n", replayerPath), strings.ReplaceAll(string(stdout), "\r\n", "\n"))
+	var replies []string
+	for _, line := range strings.Split(strings.ReplaceAll(string(stderr), "\r\n", "\n"), "\n") {
+		if strings.HasPrefix(line, "PASS\t") || strings.HasPrefix(line, "FAIL\t") {
+			replies = append(replies, line)
+		}
+	}
+	require.Len(t, replies, 3)
+	assert.Equal(t, "PASS\t"+foo, replies[0])
+	assert.Equal(t, "PASS\t"+bar, replies[1])
+	assert.True(t, strings.HasPrefix(replies[2], "FAIL\t"), replies[2])
+	assert.True(t, strings.HasSuffix(replies[2], "\t"+failing), replies[2])
+}
+
+func TestIntegration_Replayer_StreamInputs(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+
+	var records bytes.Buffer
+	for _, input := range []string{"foo", "", "a longer input that grows the buffer", "return", "bar"} {
+		require.NoError(t, binary.Write(&records, binary.LittleEndian, uint32(len(input))))
+		records.WriteString(input)
+	}
+	c := exec.Command(replayerPath, "-stream_inputs=-")
+	c.Dir = tempDir
+	c.Stdin = &records
+	stdout, stderr, err := outputWithStderr(c)
+	require.Error(t, err)
+
+	// Inputs are run until the first failing one, which is saved for reproduction.
+	assert.Equal(t, fmt.Sprintf("init(2,%s)\n'foo'\n''\n'a longer input that grows the buffer'\n", replayerPath),
+		strings.ReplaceAll(string(stdout), "\r\n", "\n"))
+	assert.Contains(t, string(stderr), "Fuzz test failed on input 'crash-stream-record-3'")
+	content, err := os.ReadFile(filepath.Join(tempDir, "crash-stream-record-3"))
+	require.NoError(t, err)
+	assert.Equal(t, "return", string(content))
+
+	// A truncated record is reported instead of being run.
+	c = exec.Command(replayerPath, "-stream_inputs=-")
+	c.Stdin = bytes.NewReader([]byte{5, 0, 0, 0, 'f', 'o', 'o'})
+	_, stderr, err = outputWithStderr(c)
+	require.Error(t, err)
+	assert.Contains(t, string(stderr), "Input stream ended within a record of 5 bytes")
+}
+
+func TestIntegration_Replayer_TimeoutAndRSSLimit(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+
+	// Like libFuzzer, the replayer exits with 70 on timeouts and 71 if the RSS limit is exceeded.
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, []string{"-timeout=1"}, "foo", "hang")
+	var exitErr *exec.ExitError
+	require.ErrorAs(t, err, &exitErr)
+	assert.Equal(t, 70, exitErr.ExitCode())
+	assert.Contains(t, stderr, "ERROR: libFuzzer: timeout after")
+	assert.Contains(t, stderr, "Reason: Timeout after")
+
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{"-rss_limit_mb=128"}, "foo", "oom")
+	require.ErrorAs(t, err, &exitErr)
+	assert.Equal(t, 71, exitErr.ExitCode())
+	assert.Contains(t, stderr, "ERROR: libFuzzer: out-of-memory")
+	assert.Contains(t, stderr, "Reason: Out of memory")
+
+	// Inputs within the limits pass.
+	_, _, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{"-timeout=10", "-rss_limit_mb=2048"}, "foo", "oom")
+	require.NoError(t, err)
+}
+
+func TestIntegration_Replayer_Quiet(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	flags := []string{"-quiet=1"}
+
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "bar", "baz")
+	require.NoError(t, err)
+	assert.NotContains(t, stderr, "Running:")
+	assert.NotContains(t, stderr, "Done:")
+	assert.Contains(t, stderr, "#2\tinputs passed")
+	assert.NotContains(t, stderr, "#3\tinputs passed")
+	assert.Contains(t, stderr, "Ran fuzz test on 3 inputs - passed")
+
+	// The summary still names the failing input.
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "assert")
+	require.Error(t, err)
+	assert.Contains(t, stderr, "failed on input")
+}
+
+func TestIntegration_Replayer_Sharding(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+
+	corpusDir, err := os.MkdirTemp(tempDir, "corpus")
+	require.NoError(t, err)
+	contentByPath := map[string]string{}
+	for _, content := range []string{"foo", "bar", "baz", "bob", "alice", "eve", "mallory"} {
+		contentByPath[createInputFile(t, corpusDir, content)] = content
+	}
+	var sortedPaths []string
+	for path := range contentByPath {
+		sortedPaths = append(sortedPaths, path)
+	}
+	sort.Strings(sortedPaths)
+
+	const totalShards = 3
+	for shardIndex := 0; shardIndex < totalShards; shardIndex++ {
+		flags := []string{fmt.Sprintf("-shard_index=%d", shardIndex), fmt.Sprintf("-total_shards=%d", totalShards)}
+		c := exec.Command(replayerPath, append(flags, corpusDir)...)
+		stdout, stderr, err := outputWithStderr(c)
+		require.NoError(t, err, string(stderr))
+
+		// Every shard runs a disjoint round-robin slice of the inputs in sorted order.
+		expectedStdoutLines := []string{fmt.Sprintf("init(4,%s)", replayerPath)}
+		for i := shardIndex; i < len(sortedPaths); i += totalShards {
+			expectedStdoutLines = append(expectedStdoutLines, fmt.Sprintf("'%s'", contentByPath[sortedPaths[i]]))
+		}
+		assert.Equal(t, expectedStdoutLines, strings.Split(strings.ReplaceAll(strings.TrimSpace(string(stdout)), "\r\n", "\n"), "\n"))
+	}
+
+	_, _, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{"-shard_index=3", "-total_shards=3"}, "foo")
+	require.Error(t, err)
+}
+
+func TestIntegration_Replayer_DedupInputs(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	flags := []string{"-dedup_inputs=1"}
+
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", []string{"foo", "bar", ""}, "bar", "", "baz")
+	require.NoError(t, err)
+	assert.ElementsMatch(t, []string{fmt.Sprintf("init(7,%s)", replayerPath), "'foo'", "'bar'", "''", "'baz'"}, stdoutLines)
+	assert.Contains(t, stderr, "Skipped 3 duplicate inputs")
+	assert.Contains(t, stderr, "Ran fuzz test on 4 inputs - passed")
+}
+
+func TestIntegration_Replayer_Order(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	inputsDir := filepath.Join(tempDir, "inputs")
+	require.NoError(t, os.Mkdir(inputsDir, 0o755))
+	for name, content := range map[string]string{"a": "aaaa", "b": "b", "c": "ccc", "d": "dd"} {
+		require.NoError(t, os.WriteFile(filepath.Join(inputsDir, name), []byte(content), 0o644))
+	}
+	runFirst := filepath.Join(tempDir, "recent_inputs")
+	require.NoError(t, os.WriteFile(runFirst, []byte("d\nunknown\n"+filepath.Join(inputsDir, "c")+"\nd\n"), 0o644))
+
+	for _, tc := range []struct {
+		flags    []string
+		expected []string
+	}{
+		{nil, []string{"'aaaa'", "'b'", "'ccc'", "'dd'"}},
+		{[]string{"-order=size"}, []string{"'b'", "'dd'", "'ccc'", "'aaaa'"}},
+		{[]string{"-run_first=" + runFirst}, []string{"'dd'", "'ccc'", "'aaaa'", "'b'"}},
+		{[]string{"-order=size", "-run_first=" + runFirst}, []string{"'dd'", "'ccc'", "'b'", "'aaaa'"}},
+		// A missing file doesn't list any inputs
+		{[]string{"-run_first=" + filepath.Join(tempDir, "missing")}, []string{"'aaaa'", "'b'", "'ccc'", "'dd'"}},
+	} {
+		c := exec.Command(replayerPath, append(tc.flags, inputsDir)...)
+		stdout, stderr, err := outputWithStderr(c)
+		require.NoError(t, err, string(stderr))
+		stdoutLines := strings.Split(strings.ReplaceAll(strings.TrimSpace(string(stdout)), "\r\n", "\n"), "\n")
+		assert.Equal(t, append([]string{fmt.Sprintf("init(%d,%s)", len(tc.flags)+2, replayerPath)}, tc.expected...), stdoutLines, tc.flags)
+	}
+}
+
+func TestIntegration_Replayer_ImpactMap(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	inputsDir := filepath.Join(tempDir, "inputs")
+	require.NoError(t, os.Mkdir(inputsDir, 0o755))
+	for name, content := range map[string]string{"a": "aaaa", "b": "b", "c": "ccc", "d": "dd"} {
+		require.NoError(t, os.WriteFile(filepath.Join(inputsDir, name), []byte(content), 0o644))
+	}
+	// "d" isn't in the map, e.g. because it was added after the map
+	// was created, so it always runs
+	impactMap := filepath.Join(tempDir, "my_fuzz_test.impact")
+	require.NoError(t, os.WriteFile(impactMap, []byte("# cifuzz impact map\na\tsrc/parser.c\tsrc/util.c\nb\tsrc/util.c\nc\tsrc/lexer.c\n"), 0o644))
+	changedFiles := filepath.Join(tempDir, "changed_files")
+
+	for _, tc := range []struct {
+		changed  string
+		expected []string
+	}{
+		{"src/parser.c\n", []string{"'aaaa'", "'dd'"}},
+		{"README.md\nsrc/util.c\n", []string{"'aaaa'", "'b'", "'dd'"}},
+		{"", []string{"'dd'"}},
+	} {
+		require.NoError(t, os.WriteFile(changedFiles, []byte(tc.changed), 0o644))
+		flags := []string{"-impact_map=" + impactMap, "-changed_files=" + changedFiles, "-impact_sample_percent=0"}
+		c := exec.Command(replayerPath, append(flags, inputsDir)...)
+		stdout, stderr, err := outputWithStderr(c)
+		require.NoError(t, err, string(stderr))
+		stdoutLines := strings.Split(strings.ReplaceAll(strings.TrimSpace(string(stdout)), "\r\n", "\n"), "\n")
+		assert.Equal(t, append([]string{fmt.Sprintf("init(%d,%s)", len(flags)+2, replayerPath)}, tc.expected...), stdoutLines, tc.changed)
+		assert.Contains(t, string(stderr), fmt.Sprintf("Skipped %d inputs that don't cover any of the changed files", 4-len(tc.expected)))
+	}
+
+	// All inputs run if they are all sampled
+	flags := []string{"-impact_map=" + impactMap, "-changed_files=" + changedFiles, "-impact_sample_percent=100"}
+	c := exec.Command(replayerPath, append(flags, inputsDir)...)
+	stdout, stderr, err := outputWithStderr(c)
+	require.NoError(t, err, string(stderr))
+	assert.Len(t, strings.Split(strings.TrimSpace(string(stdout)), "\n"), 5)
+}
+
+func TestIntegration_Replayer_PassCache(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	flags := []string{"-pass_cache=" + filepath.Join(tempDir, "pass_cache")}
+
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "bar")
+	require.NoError(t, err)
+	assert.Contains(t, stderr, "Ran fuzz test on 2 inputs - passed")
+
+	// Inputs that passed before are skipped, even if they are stored in different files.
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "bar", "baz")
+	require.NoError(t, err)
+	assert.Equal(t, []string{fmt.Sprintf("init(5,%s)", replayerPath), "'baz'"}, stdoutLines)
+	assert.Contains(t, stderr, "Skipped 2 inputs that passed in a previous run")
+
+	// Failing inputs are never recorded.
+	_, _, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, "assert")
+	require.Error(t, err)
+	_, _, err = runReplayerWithFlags(t, tempDir, replayerPath, flags, "assert")
+	require.Error(t, err)
+
+	// A different build invalidates the cache.
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, append(flags, "-pass_cache_key=other"), "foo", "bar")
+	require.NoError(t, err)
+	assert.Contains(t, stderr, "Ran fuzz test on 2 inputs - passed")
+}
+
+func TestIntegration_Replayer_Timing(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+	timingOutput := filepath.Join(tempDir, "timing.jsonl")
+	flags := []string{"-print_timing=1", "-slowest_inputs=2", "-timing_output=" + timingOutput}
+
+	_, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, flags, "foo", "bar", []string{"baz", "bob"})
+	require.NoError(t, err)
+	assert.Contains(t, stderr, "Time per input: total ")
+	assert.Contains(t, stderr, "Slowest inputs:")
+
+	content, err := os.ReadFile(timingOutput)
+	require.NoError(t, err)
+	lines := strings.Split(strings.TrimSpace(string(content)), "\n")
+	require.Len(t, lines, 5)
+	for _, line := range lines[:4] {
+		var entry struct {
+			Type    string
+			Input   string
+			Size    int
+			Seconds float64
+		}
+		require.NoError(t, json.Unmarshal([]byte(line), &entry), line)
+		assert.Equal(t, "input", entry.Type)
+		assert.Equal(t, 3, entry.Size)
+		assert.GreaterOrEqual(t, entry.Seconds, 0.0)
+	}
+	var summary struct {
+		Type   string
+		Passed bool
+		Inputs int
+	}
+	require.NoError(t, json.Unmarshal([]byte(lines[4]), &summary), lines[4])
+	assert.Equal(t, "summary", summary.Type)
+	assert.True(t, summary.Passed)
+	assert.Equal(t, 4, summary.Inputs)
+}
+
+func TestIntegration_Replayer_PackedCorpus(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	var replayerPath string
+	if runtime.GOOS == "windows" {
+		replayerPath = compileReplayer(t, tempDir, msvc.compiler, msvc.outputFlags, msvc.flags...)
+	} else {
+		replayerPath = compileReplayer(t, tempDir, clang.compiler, clang.outputFlags, clang.flags...)
+	}
+
+	corpusDir := filepath.Join(tempDir, "corpus")
+	require.NoError(t, os.MkdirAll(filepath.Join(corpusDir, "sub"), 0755))
+	for name, content := range map[string]string{"foo": "foo", "empty": "", filepath.Join("sub", "asan"): "asan"} {
+		require.NoError(t, os.WriteFile(filepath.Join(corpusDir, name), []byte(content), 0644))
+	}
+	packPath := filepath.Join(tempDir, "corpus"+corpuspack.Suffix)
+	pack, err := os.Create(packPath)
+	require.NoError(t, err)
+	require.NoError(t, corpuspack.WriteDir(pack, corpusDir))
+	require.NoError(t, pack.Close())
+
+	// All entries are run in order of their names and the reproducer command refers to the failing entry.
+	stdoutLines, stderr, err := runReplayerWithFlags(t, tempDir, replayerPath, []string{packPath}, "bar")
+	require.Error(t, err)
+	assert.Equal(t, []string{fmt.Sprintf("init(3,%s)", replayerPath), "''", "'foo'"}, stdoutLines)
+	assert.Contains(t, stderr, "ERROR: AddressSanitizer")
+	assert.Contains(t, stderr, fmt.Sprintf("Fuzz test failed on input '%s/sub/asan'", packPath))
+
+	// Single entries can be run by their path.
+	stdoutLines, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{packPath + "/foo"})
+	require.NoError(t, err)
+	assert.Equal(t, []string{fmt.Sprintf("init(2,%s)", replayerPath), "'foo'"}, stdoutLines)
+	assert.Contains(t, stderr, "Ran fuzz test on 1 inputs - passed")
+
+	_, stderr, err = runReplayerWithFlags(t, tempDir, replayerPath, []string{packPath + "/missing"})
+	require.Error(t, err)
+	assert.Contains(t, stderr, "Failed to find 'missing' in packed corpus")
+}
+
+func TestIntegration_Replayer_CoverageMode(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS != "linux" {
+		// The LLVM profile runtime hides its counters from dlsym on macOS and MSVC doesn't support coverage builds.
+		t.Skip("-minimize_to is only supported on Linux")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags,
+		"-Wall", "-Wextra", "-Werror", "-ansi", "-fprofile-instr-generate", "-fcoverage-mapping")
+	outDir := filepath.Join(tempDir, "minimized")
+	require.NoError(t, os.Mkdir(outDir, 0755))
+	inputDir, err := os.MkdirTemp(tempDir, "input-dir")
+	require.NoError(t, err)
+	for _, input := range []string{"foo", "bar", "asXX", "asaX", "ubsaX", "ubXXX", "asaX"} {
+		createInputFile(t, inputDir, input)
+	}
+
+	report := filepath.Join(tempDir, "coverage.jsonl")
+	c := exec.Command(replayerPath, "-minimize_to="+outDir, "-coverage_report="+report, "-jobs=2", inputDir)
+	c.Env = append(os.Environ(), "LLVM_PROFILE_FILE="+filepath.Join(tempDir, "default.profraw"))
+	_, stderr, err := outputWithStderr(c)
+	require.NoError(t, err, string(stderr))
+	assert.Contains(t, string(stderr), "Minimized 7 inputs to 2 inputs")
+
+	// "asaX" and "ubsaX" each get further in one of the comparisons of the fuzz target than any other input and
+	// together cover all others.
+	var minimized []string
+	entries, err := os.ReadDir(outDir)
+	require.NoError(t, err)
+	for _, entry := range entries {
+		content, err := os.ReadFile(filepath.Join(outDir, entry.Name()))
+		require.NoError(t, err)
+		minimized = append(minimized, string(content))
+	}
+	assert.ElementsMatch(t, []string{"asaX", "ubsaX"}, minimized)
+
+	// Only "ubsaX" hits counters no other input hits, since "asaX" occurs twice.
+	content, err := os.ReadFile(report)
+	require.NoError(t, err)
+	lines := strings.Split(strings.TrimSpace(string(content)), "\n")
+	require.Len(t, lines, 7)
+	type coverageRank struct {
+		Input          string
+		Size           int
+		Counters       int
+		UniqueCounters int `json:"unique_counters"`
+	}
+	var ranks []coverageRank
+	for _, line := range lines {
+		var rank coverageRank
+		require.NoError(t, json.Unmarshal([]byte(line), &rank), line)
+		ranks = append(ranks, rank)
+	}
+	top, err := os.ReadFile(ranks[0].Input)
+	require.NoError(t, err)
+	assert.Equal(t, "ubsaX", string(top))
+	assert.Greater(t, ranks[0].UniqueCounters, 0)
+	for _, rank := range ranks[1:] {
+		assert.Equal(t, 0, rank.UniqueCounters)
+		assert.Greater(t, rank.Counters, 0)
+	}
+}
+
+func TestIntegration_Replayer_ProfileFlush(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("MSVC doesn't support coverage builds")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, clang.compiler, clang.outputFlags,
+		"-Wall", "-Wextra", "-Werror", "-ansi", "-fprofile-instr-generate", "-fcoverage-mapping")
+	inputDir, err := os.MkdirTemp(tempDir, "input-dir")
+	require.NoError(t, err)
+	for _, input := range []string{"foo", "bar", "asXX", "asaX", "ubsaX"} {
+		createInputFile(t, inputDir, input)
+	}
+
+	profileDir := filepath.Join(tempDir, "profiles")
+	c := exec.Command(replayerPath, "-profile_flush_inputs=2",
+		"-profile_flush_file="+filepath.Join(profileDir, "profile-%i.profraw"), inputDir)
+	c.Env = append(os.Environ(), "LLVM_PROFILE_FILE="+filepath.Join(tempDir, "default.profraw"))
+	_, stderr, err := outputWithStderr(c)
+	require.NoError(t, err, string(stderr))
+
+	// Two profiles are flushed after two inputs each, the runtime writes the last one at exit.
+	entries, err := os.ReadDir(profileDir)
+	require.NoError(t, err)
+	var profiles []string
+	for _, entry := range entries {
+		profiles = append(profiles, entry.Name())
+	}
+	assert.ElementsMatch(t, []string{"profile-0.profraw", "profile-1.profraw", "profile-2.profraw"}, profiles)
+	assert.NoFileExists(t, filepath.Join(tempDir, "default.profraw"))
+
+	c = exec.Command(replayerPath, "-profile_flush_inputs=2",
+		"-profile_flush_file="+filepath.Join(profileDir, "profile.profraw"), inputDir)
+	_, stderr, err = outputWithStderr(c)
+	require.Error(t, err)
+	assert.Contains(t, string(stderr), "require -profile_flush_file with %i or %m")
+}
+
+func TestIntegration_Replayer_GcovShards(t *testing.T) {
+	if testing.Short() {
+		t.Skip()
+	}
+	if runtime.GOOS == "windows" {
+		t.Skip("-gcov_shard_dir is not supported on Windows")
+	}
+	gcovPath, err := exec.LookPath("gcov")
+	if err != nil {
+		t.Skip("gcov is not installed")
+	}
+	t.Parallel()
+	testutil.RegisterTestDeps("src", "testdata")
+
+	tempDir, err := os.MkdirTemp(baseTempDir, "")
+	require.NoError(t, err)
+	replayerPath := compileReplayer(t, tempDir, gcc.compiler, gcc.outputFlags,
+		append([]string{"--coverage", "-DCIFUZZ_HAS_GCOV"}, mingw.flags...)...)
+	buildDir := filepath.Dir(replayerPath)
+	inputDir, err := os.MkdirTemp(tempDir, "input-dir")
+	require.NoError(t, err)
+	for _, input := range []string{"foo", "bar", "asXX", "asaX", "ubsaX", "ubXXX", "baz"} {
+		createInputFile(t, inputDir, input)
+	}
+	shardDir := filepath.Join(tempDir, "shards")
+
+	// Returns the line counts of the fuzz target and deletes the .gcda files for the next run.
+	replayWithCoverage := func(flags ...string) string {
+		c := exec.Command(replayerPath, append(flags, inputDir)...)
+		_, stderr, err := outputWithStderr(c)
+		require.NoError(t, err, string(stderr))
+		assert.NotContains(t, string(stderr), "WARNING")
+
+		gcdaFiles, err := filepath.Glob(filepath.Join(buildDir, "*.gcda"))
+		require.NoError(t, err)
+		c = exec.Command(gcovPath, "--stdout", filepath.Join(buildDir, "replayer-fuzz_target.gcda"))
+		c.Dir = buildDir
+		out, err := c.Output()
+		require.NoError(t, err)
+		for _, gcdaFile := range gcdaFiles {
+			require.NoError(t, os.Remove(gcdaFile))
+		}
+
+		// Every worker counts as a run of its own.
+		var lines []string
+		for _, line := range strings.Split(string(out), "\n") {
+			if !strings.Contains(line, ":Runs:") {
+				lines = append(lines, line)
+			}
+		}
+		return strings.Join(lines, "\n")
+	}
+
+	sequential := replayWithCoverage()
+	require.Contains(t, sequential, "init(")
+	// LLVMFuzzerInitialize is only counted once although every worker inherits its counters.
+	assert.Equal(t, sequential, replayWithCoverage("-jobs=3", "-gcov_shard_dir="+shardDir))
+	assert.Equal(t, sequential, replayWithCoverage("-keep_going=1", "-jobs=2", "-inputs_per_fork=2",
+		"-gcov_flush_inputs=1", "-gcov_shard_dir="+shardDir))
+	entries, err := os.ReadDir(shardDir)
+	require.NoError(t, err)
+	assert.Empty(t, entries)
+}
+
 func subtestCompileAndRunWithFuzzerInitialize(t *testing.T, cc *compilerCase, rcs []runCase) {
 	t.Run("WithFuzzerInitialize", func(t *testing.T) {
 		t.Parallel()
@@ -495,6 +1371,11 @@ func compileReplayer(t *testing.T, tempDir string, compiler string, outputFlags
 }
 
 func runReplayer(t *testing.T, baseTempDir string, replayerPath string, inputs ...any) ([]string, string, error) {
+	return runReplayerWithFlags(t, baseTempDir, replayerPath, nil, inputs...)
+}
+
+// runReplayerWithFlags behaves like runReplayer, but passes the given flags to the replayer before the inputs.
+func runReplayerWithFlags(t *testing.T, baseTempDir string, replayerPath string, flags []string, inputs ...any) ([]string, string, error) {
 	var inputPaths []string
 	for _, input := range inputs {
 		if fileContent, ok := input.(string); ok {
@@ -511,7 +1392,7 @@ func runReplayer(t *testing.T, baseTempDir string, replayerPath string, inputs .
 		}
 	}
 
-	c := exec.Command(replayerPath, inputPaths...)
+	c := exec.Command(replayerPath, append(flags, inputPaths...)...)
 
 	// FIXME we add this env var here because there is a bug in replayer.c
 	// that does not set "halt_on_error=1" correctly
@@ -17,6 +17,8 @@
  *   - disabled dialog boxes for aborts or failed asserts on Windows
  *   - emit summary and follow-up suggestions at the end
  *   - automatically execute a <name>_inputs dir adjacent to the target
+ *   - map regular input files into memory instead of copying them into a heap buffer
+ *   - avoid a stat call and a path allocation per directory entry
  */
 /*===- StandaloneFuzzTargetMain.c - standalone main() for fuzz targets. ---===//
 //
@@ -36,6 +38,8 @@
 #if defined(__linux__)
 /* Using S_IFDIR with gcc's -ansi requires this define. */
 #define _XOPEN_SOURCE 700
+/* Using the d_type constants (DT_DIR etc.) with gcc's -ansi requires this define. */
+#define _DEFAULT_SOURCE
 #endif
 #include <assert.h>
 #include <errno.h>
@@ -45,6 +49,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #if defined(_WIN32)
 #define POSIX_STAT _stat
@@ -52,11 +57,29 @@
 #define POSIX_S_IFREG _S_IFREG
 #include <windows.h>
 #include <crtdbg.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+/* GetProcessMemoryInfo is only provided by kernel32 with recent Windows SDKs. */
+#pragma comment(lib, "psapi.lib")
+#endif
+#include <fcntl.h>
+#include <io.h>
 #else
 #define POSIX_STAT stat
 #define POSIX_S_IFDIR S_IFDIR
 #define POSIX_S_IFREG S_IFREG
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#endif
 #endif
 
 #ifdef __cplusplus
@@ -78,6 +101,224 @@ static int num_passing_inputs = 0;
 static int in_user_callback = 0;
 static const char *current_input = NULL;
 
+/* Replayer options, passed libFuzzer-style as -name=value arguments so that they can't be confused with inputs. */
+enum flag_type {
+  FLAG_INT,
+  FLAG_STRING
+};
+
+struct flag {
+  const char *name;
+  enum flag_type type;
+  /* Points to an int for FLAG_INT and to a const char * for FLAG_STRING. */
+  void *value;
+  const char *description;
+};
+
+static const char *flag_changed_files = NULL;
+static const char *flag_coverage_report = NULL;
+static int flag_dedup_inputs = 0;
+static int flag_gcov_flush_inputs = 0;
+static const char *flag_gcov_shard_dir = NULL;
+static int flag_help = 0;
+static const char *flag_impact_map = NULL;
+static int flag_impact_sample_percent = 5;
+static int flag_inputs_per_fork = 1;
+static int flag_jobs = 1;
+static int flag_keep_going = 0;
+static int flag_leak_check_inputs = 0;
+static const char *flag_minimize_to = NULL;
+static const char *flag_order = "path";
+static const char *flag_pass_cache = NULL;
+static const char *flag_pass_cache_key = NULL;
+static int flag_print_timing = 0;
+static const char *flag_profile_flush_file = NULL;
+static int flag_profile_flush_inputs = 0;
+static int flag_profile_flush_seconds = 0;
+static int flag_quiet = 0;
+static int flag_read_ahead = 0;
+static int flag_reuse_input_buffer = 0;
+static int flag_rss_limit_mb = 0;
+static const char *flag_run_first = NULL;
+static int flag_server = 0;
+static int flag_server_reply_fd = 2;
+static int flag_shard_index = 0;
+static int flag_slowest_inputs = 10;
+static const char *flag_stream_inputs = NULL;
+static int flag_threads = 1;
+static int flag_timeout = 0;
+static const char *flag_timing_output = NULL;
+static int flag_total_shards = 1;
+
+static const struct flag FLAGS[] = {
+    {"changed_files", FLAG_STRING, &flag_changed_files,
+        "The file listing the source files that changed, one per line, for -impact_map, e.g. the output of"
+        " 'git diff --name-only <base revision>'."},
+    {"coverage_report", FLAG_STRING, &flag_coverage_report,
+        "If set, write the number of coverage counters each input hits and how many of those no other input hits to"
+        " this file as JSON lines, ranked by the latter, instead of only running the inputs. Has the same requirements"
+        " as -minimize_to, with which it can be combined to collect the coverage only once."},
+    {"dedup_inputs", FLAG_INT, &flag_dedup_inputs,
+        "If 1, skip inputs whose contents are identical to those of an earlier input, e.g. copies of seed corpus"
+        " entries in the generated corpus. Costs an additional pass over the inputs."},
+    {"gcov_flush_inputs", FLAG_INT, &flag_gcov_flush_inputs,
+        "If larger than 0, workers write their gcov counters to their shard of -gcov_shard_dir and reset them after"
+        " this many inputs instead of only at exit, so that a worker stopped after another one failed only loses the"
+        " coverage of the inputs since."},
+    {"gcov_shard_dir", FLAG_STRING, &flag_gcov_shard_dir,
+        "If set in a gcov build (CIFUZZ_SANITIZERS=gcov), every worker forked with -jobs or -keep_going writes its"
+        " .gcda files to a directory of its own below this one instead of locking and merging the .gcda files of the"
+        " build, which the workers would otherwise contend for. The shards are merged into the .gcda files of the"
+        " build in parallel after all workers exited. Not supported on Windows."},
+    {"help", FLAG_INT, &flag_help, "Print this list of options and exit."},
+    {"impact_map", FLAG_STRING, &flag_impact_map,
+        "If set, only run the inputs that cover any of the -changed_files according to this file, which lists the"
+        " name of an input and the source files it covers per line, separated by tabs, as written by 'cifuzz coverage"
+        " --format=impact-map'. Inputs that aren't listed in it always run, as do -impact_sample_percent percent of"
+        " the others."},
+    {"impact_sample_percent", FLAG_INT, &flag_impact_sample_percent,
+        "The percentage of the inputs skipped by -impact_map that run anyway. The sample depends on the"
+        " -changed_files, so that it is reproducible for the same changes."},
+    {"inputs_per_fork", FLAG_INT, &flag_inputs_per_fork,
+        "The number of consecutive inputs a child forked with -keep_going=1 runs. Larger batches amortize the cost of"
+        " forking, the inputs of a batch after a failing one are run by a new child."},
+    {"jobs", FLAG_INT, &flag_jobs,
+        "Number of worker processes to distribute the inputs across. Workers are forked after LLVMFuzzerInitialize"
+        " and the first failing input stops all of them. Not supported on Windows."},
+    {"keep_going", FLAG_INT, &flag_keep_going,
+        "If 1, run the inputs in child processes forked from the replayer after LLVMFuzzerInitialize and report all"
+        " failing inputs at the end instead of stopping at the first one. Combine with -jobs to run multiple children"
+        " at a time and with -server=1 to keep serving after a failing input. Not supported on Windows."},
+    {"leak_check_inputs", FLAG_INT, &flag_leak_check_inputs,
+        "If larger than 0, check for memory leaks after this many inputs instead of only at exit and, if there are"
+        " any, find the input that leaked by running the inputs since the last check again, split in halves, from"
+        " copies of the process forked before them. Requires an ASan build, can't be combined with -threads,"
+        " -keep_going, -server and -stream_inputs. Not supported on Windows."},
+    {"minimize_to", FLAG_STRING, &flag_minimize_to,
+        "If set, copy a minimal subset of the inputs that hits the same coverage counters as all of them to this"
+        " existing directory instead of only running them. Requires a coverage build (CIFUZZ_SANITIZERS=coverage) and"
+        " an LLVM_PROFILE_FILE without %c. Combine with -jobs to collect the coverage of the inputs in parallel. Not"
+        " supported on macOS and Windows."},
+    {"order", FLAG_STRING, &flag_order,
+        "The order in which the inputs run after those listed in -run_first: 'path' to run the inputs of a directory"
+        " sorted by path and the given files and directories in the order of the arguments, or 'size' to run smaller"
+        " inputs first. Sharding is always based on the order by path."},
+    {"pass_cache", FLAG_STRING, &flag_pass_cache,
+        "If set, skip inputs recorded as passing in this file by a previous run of the same fuzz test binary, and"
+        " record the inputs of this run in it if all of them pass."},
+    {"pass_cache_key", FLAG_STRING, &flag_pass_cache_key,
+        "Identifies the fuzz test build for -pass_cache, e.g. the sha256 of the binary and its shared libraries."
+        " Defaults to a hash of the executable of the process."},
+    {"print_timing", FLAG_INT, &flag_print_timing,
+        "If 1, print the total, mean and 99th percentile time spent per input as well as the slowest inputs at the"
+        " end."},
+    {"profile_flush_file", FLAG_STRING, &flag_profile_flush_file,
+        "The file name pattern of the coverage profiles written by -profile_flush_inputs and -profile_flush_seconds."
+        " Every %i is replaced by the number of profiles flushed before, all other patterns such as %p and %m are"
+        " expanded by the LLVM profile runtime. Must contain %i or %m, and %p if combined with -jobs or -keep_going."},
+    {"profile_flush_inputs", FLAG_INT, &flag_profile_flush_inputs,
+        "If larger than 0, write the coverage profile to the next file of -profile_flush_file and reset the coverage"
+        " counters after this many inputs, so that long replays produce a sequence of bounded profiles that can be"
+        " merged while the replay is still running. Requires a coverage build and an LLVM_PROFILE_FILE without %c."},
+    {"profile_flush_seconds", FLAG_INT, &flag_profile_flush_seconds,
+        "Like -profile_flush_inputs, but flushes the profile after the first input that finishes at least this many"
+        " seconds after the previous flush. Both can be combined."},
+    {"quiet", FLAG_INT, &flag_quiet,
+        "If 1, don't print a line before and after every input, but only the number of passing inputs whenever it"
+        " reaches a power of two."},
+    {"read_ahead", FLAG_INT, &flag_read_ahead,
+        "The number of inputs whose files a background thread reads while the current input runs, so that waiting for"
+        " a cold disk or a network file system overlaps with running the fuzz test. 0 (the default) disables reading"
+        " ahead. Not supported on Windows."},
+    {"reuse_input_buffer", FLAG_INT, &flag_reuse_input_buffer,
+        "If 1, read all inputs into a single buffer that is reused across inputs instead of mapping each file."
+        " Speeds up replaying corpora consisting of many small inputs."},
+    {"rss_limit_mb", FLAG_INT, &flag_rss_limit_mb,
+        "If larger than 0, fail with 'out-of-memory' and exit with code 71 as soon as the peak resident set size of the"
+        " process exceeds this many megabytes, checked after every input and once per second while one runs. Matches"
+        " libFuzzer's -rss_limit_mb, but is disabled by default."},
+    {"run_first", FLAG_STRING, &flag_run_first,
+        "If set, run the inputs listed by path or file name in this file, one per line, before all others in the order"
+        " of the lines, e.g. the inputs that failed most recently. A missing file is ignored. cifuzz lists its findings"
+        " in .cifuzz-findings/recent_inputs in the project directory, newest first."},
+    {"server", FLAG_INT, &flag_server,
+        "If 1, run as a persistent replay server: Read input paths line by line from stdin instead of the command line"
+        " and reply with 'PASS\\t<path>' after each passing input and 'FAIL\\t<reason>\\t<path>' before terminating on"
+        " a failing one. LLVMFuzzerInitialize only runs once for all inputs."},
+    {"server_reply_fd", FLAG_INT, &flag_server_reply_fd,
+        "The file descriptor the replies of -server=1 are written to. Defaults to stderr (2)."},
+    {"shard_index", FLAG_INT, &flag_shard_index,
+        "The 0-based index of the shard of the inputs to run, see -total_shards."},
+    {"slowest_inputs", FLAG_INT, &flag_slowest_inputs,
+        "The number of slowest inputs listed by -print_timing=1."},
+    {"stream_inputs", FLAG_STRING, &flag_stream_inputs,
+        "If set, read inputs from this file, e.g. a named pipe, or from stdin if set to '-', instead of the command"
+        " line. Every input is a record consisting of its size as a 32-bit little-endian integer followed by its"
+        " contents. A failing input is saved to crash-stream-record-<index> in the working directory."},
+    {"threads", FLAG_INT, &flag_threads,
+        "Number of threads to distribute the inputs across in this process, which unlike the workers of -jobs share"
+        " the state set up by LLVMFuzzerInitialize. Threads steal inputs from each other once they ran their own and"
+        " the first failing input stops all of them. Requires a fuzz test declared thread-safe with"
+        " FUZZ_TEST_THREAD_SAFE, can't be combined with -jobs, -keep_going, -server, -stream_inputs,"
+        " -reuse_input_buffer and the coverage flags. Not supported on Windows."},
+    {"timeout", FLAG_INT, &flag_timeout,
+        "If larger than 0, fail with 'timeout' and exit with code 70 if a single input runs for longer than this many"
+        " seconds. Matches libFuzzer's -timeout, but is disabled by default."},
+    {"timing_output", FLAG_STRING, &flag_timing_output,
+        "If set, write the time spent on every passing input and a final summary to this file as JSON lines."},
+    {"total_shards", FLAG_INT, &flag_total_shards,
+        "If larger than 1, split the inputs into this many shards and only run the one selected by -shard_index."
+        " Inputs are assigned to shards round-robin in a reproducible order, so running every shard index with the"
+        " same arguments runs every input exactly once."},
+};
+static const int NUM_FLAGS = sizeof(FLAGS) / sizeof(struct flag);
+
+/* Returns a non-zero value if arg should be treated as an option rather than an input path. */
+static int is_flag(const char *arg) {
+  return arg[0] == '-' && arg[1] != '\0';
+}
+
+static void parse_flag(const char *arg) {
+  const char *name;
+  const char *value;
+  char *end;
+  long int_value;
+  int i;
+
+  name = arg + 1;
+  value = strchr(name, '=');
+  if (value != NULL) {
+    for (i = 0; i < NUM_FLAGS; i++) {
+      if (strlen(FLAGS[i].name) != (size_t) (value - name) || strncmp(FLAGS[i].name, name, strlen(FLAGS[i].name))) {
+        continue;
+      }
+      value++;
+      if (FLAGS[i].type == FLAG_STRING) {
+        *((const char**) FLAGS[i].value) = value;
+        return;
+      }
+      int_value = strtol(value, &end, 10);
+      if (end == value || *end != '\0') {
+        fprintf(stderr, "Invalid value for flag -%s: '%s'\n", FLAGS[i].name, value);
+        exit(1);
+      }
+      *((int*) FLAGS[i].value) = (int) int_value;
+      return;
+    }
+  }
+  /* Mimic libFuzzer, which ignores unknown flags. */
+  fprintf(stderr, "WARNING: unrecognized flag '%s'; use -help=1 to list all flags\n", arg);
+}
+
+static void print_help(void) {
+  int i;
+
+  fprintf(stderr, "Usage: %s [-flag=value ...] [file_or_dir ...]\n\nFlags:\n", argv0);
+  for (i = 0; i < NUM_FLAGS; i++) {
+    fprintf(stderr, "  -%s\n      %s\n", FLAGS[i].name, FLAGS[i].description);
+  }
+}
+
 /* Keep in sync with strsignal below. */
 static const int TERMINATING_SIGNALS[] = {
     SIGABRT,
@@ -190,201 +431,4467 @@ static ret name##Default args
 #define DEFINE_DEFAULT(ret, name, args) C_LINKAGE __attribute__((weak)) ret name args
 #define WITH_DEFAULT(name) name
 
-#endif
+#endif
+
+DEFINE_DEFAULT(int, LLVMFuzzerInitialize, (int *argc, char ***argv)) {
+  (void)argc;
+  (void)argv;
+  return 0;
+}
+
+/* Set by the FUZZ_TEST macro defined in cifuzz.h. */
+DEFINE_DEFAULT(const char*, cifuzz_test_name, (void)) {
+  return NULL;
+}
+
+DEFINE_DEFAULT(const char*, cifuzz_seed_corpus, (void)) {
+  return NULL;
+}
+
+DEFINE_DEFAULT(const char*, cifuzz_generated_corpus, (void)) {
+  return NULL;
+}
+
+/* Set by FUZZ_TEST_THREAD_SAFE, required by -threads. */
+DEFINE_DEFAULT(int, cifuzz_test_thread_safe, (void)) {
+  return 0;
+}
+
+/* Provided by the LLVM profile runtime in coverage builds (-fprofile-instr-generate), used by -minimize_to and
+ * -coverage_report. The counters are 64-bit integers. Counters of instrumented shared libraries are not included. */
+DEFINE_DEFAULT(char*, __llvm_profile_begin_counters, (void)) {
+  return NULL;
+}
+
+DEFINE_DEFAULT(char*, __llvm_profile_end_counters, (void)) {
+  return NULL;
+}
+
+/* Provided by the LLVM profile runtime in coverage builds, used by -profile_flush_inputs and -profile_flush_seconds.
+ * The defaults only record that the runtime is missing. */
+static int have_profile_runtime = 1;
+
+DEFINE_DEFAULT(void, __llvm_profile_set_filename, (const char *filename)) {
+  (void) filename;
+  have_profile_runtime = 0;
+}
+
+DEFINE_DEFAULT(int, __llvm_profile_write_file, (void)) {
+  have_profile_runtime = 0;
+  return 0;
+}
+
+DEFINE_DEFAULT(void, __llvm_profile_reset_counters, (void)) {
+  have_profile_runtime = 0;
+}
+
+/* Commonly called from LLVMFuzzerCustomMutator. We define it here to prevent linker errors. */
+C_LINKAGE size_t LLVMFuzzerMutate(uint8_t *Data, size_t Size, size_t MaxSize);
+size_t LLVMFuzzerMutate(uint8_t *Data, size_t Size, size_t MaxSize) {
+  (void) Data;
+  (void) Size;
+  (void) MaxSize;
+  assert(0 && "LLVMFuzzerMutate should only be called from LLVMFuzzerCustomMutator");
+  return 0;
+}
+
+/* Set by the CMake integration if a sanitizer is linked in.
+ * Detecting this via compiler macros isn't possible since gcc does not define a macro for UBSan.
+ * Using DEFINE_DEFAULT/WITH_DEFAULT isn't possible since sanitizer runtimes are usually linked dynamically and thus
+ * don't override weak symbols.
+ * TODO: If this ever becomes an issue with other build systems, replace the compile-time check with a dynamic lookup
+ *       at runtime. */
+#ifdef CIFUZZ_HAS_SANITIZER
+C_LINKAGE void __sanitizer_set_death_callback(void (*callback)(void));
+C_LINKAGE void __sanitizer_print_stack_trace(void);
+#endif
+
+/* Unlike UBSan, ASan can be detected at compile time with all supported compilers. */
+#if defined(__SANITIZE_ADDRESS__)
+#define CIFUZZ_HAS_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CIFUZZ_HAS_ASAN
+#endif
+#endif
+
+/* Set by the CMake integration in gcov builds (CIFUZZ_SANITIZERS=gcov), used by -gcov_shard_dir. Both libgcov (gcc)
+ * and the compiler-rt profile runtime (clang) provide these functions. Weak defaults can't be used since libgcov
+ * defines them in archive members of their own, which the linker doesn't pull in if a weak definition exists. */
+#ifdef CIFUZZ_HAS_GCOV
+C_LINKAGE void __gcov_dump(void);
+C_LINKAGE void __gcov_reset(void);
+#endif
+
+#ifdef CIFUZZ_HAS_ASAN
+C_LINKAGE void __asan_poison_memory_region(void const volatile *addr, size_t size);
+C_LINKAGE void __asan_unpoison_memory_region(void const volatile *addr, size_t size);
+#endif
+
+/* Provided by LeakSanitizer, which is part of ASan on Linux and macOS, used by -leak_check_inputs. */
+#if defined(CIFUZZ_HAS_ASAN) && !defined(_WIN32)
+#define CIFUZZ_HAS_LEAK_CHECK
+C_LINKAGE int __lsan_do_recoverable_leak_check(void);
+#endif
+
+/* Like sprintf(buf, format, value), but uses the variant that isn't deprecated on the current platform. */
+static void format_ulong(char *buf, size_t size, const char *format, unsigned long value) {
+#ifdef _WIN32
+  sprintf_s(buf, size, format, value);
+#elif __APPLE__
+  snprintf(buf, size, format, value);
+#else
+  (void) size;
+  sprintf(buf, format, value);
+#endif
+}
+
+/* Returns a monotonic timestamp in seconds with at least microsecond resolution. */
+static double now_seconds(void) {
+#ifdef _WIN32
+  LARGE_INTEGER counter;
+  LARGE_INTEGER frequency;
+
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+}
+
+/* Per-input durations are kept in a histogram with log-linear buckets rather than individually, so that the percentiles
+ * can be computed without allocating from a signal handler and merged across -jobs workers. Bucket 0 holds durations
+ * below 1us, the following buckets split each power of two microseconds into LATENCY_SUB_BUCKETS equally sized
+ * buckets, which bounds the relative error of a percentile by 1 / LATENCY_SUB_BUCKETS. */
+#define LATENCY_OCTAVES 32
+#define LATENCY_SUB_BUCKETS 8
+#define NUM_LATENCY_BUCKETS (1 + LATENCY_OCTAVES * LATENCY_SUB_BUCKETS)
+
+/* An input that is among the -slowest_inputs slowest ones seen so far. */
+struct slow_input {
+  double seconds;
+  size_t size;
+  char *path;
+};
+
+/* Timing is only recorded if -print_timing=1 or -timing_output is given. */
+static int timing_enabled = 0;
+static FILE *timing_output_file = NULL;
+static int num_timed_inputs = 0;
+static double total_input_seconds = 0;
+static double max_input_seconds = 0;
+static int latency_histogram[NUM_LATENCY_BUCKETS];
+/* Sorted by descending duration. */
+static struct slow_input *slowest_inputs = NULL;
+static int num_slowest_inputs = 0;
+
+static int latency_bucket(double seconds) {
+  double micros;
+  double lower;
+  int octave;
+  int sub_bucket;
+
+  micros = seconds * 1e6;
+  if (micros < 1) {
+    return 0;
+  }
+  lower = 1;
+  for (octave = 0; octave < LATENCY_OCTAVES - 1 && micros >= 2 * lower; octave++) {
+    lower *= 2;
+  }
+  sub_bucket = (int) ((micros - lower) / lower * LATENCY_SUB_BUCKETS);
+  if (sub_bucket >= LATENCY_SUB_BUCKETS) {
+    sub_bucket = LATENCY_SUB_BUCKETS - 1;
+  }
+  return 1 + octave * LATENCY_SUB_BUCKETS + sub_bucket;
+}
+
+/* Returns the exclusive upper bound of the durations in the given bucket in seconds. */
+static double latency_bucket_upper_bound(int bucket) {
+  double lower;
+  int octave;
+
+  if (bucket == 0) {
+    return 1e-6;
+  }
+  lower = 1e-6;
+  for (octave = 0; octave < (bucket - 1) / LATENCY_SUB_BUCKETS; octave++) {
+    lower *= 2;
+  }
+  return lower + lower * ((bucket - 1) % LATENCY_SUB_BUCKETS + 1) / LATENCY_SUB_BUCKETS;
+}
+
+/* Returns an upper bound for the given percentile of the recorded durations, which is exact up to the bucket size. */
+static double latency_percentile(double percentile) {
+  double rank;
+  double bound;
+  int count;
+  int i;
+
+  rank = percentile / 100 * num_timed_inputs;
+  count = 0;
+  for (i = 0; i < NUM_LATENCY_BUCKETS - 1; i++) {
+    count += latency_histogram[i];
+    if (count >= rank && count > 0) {
+      break;
+    }
+  }
+  bound = latency_bucket_upper_bound(i);
+  return bound < max_input_seconds ? bound : max_input_seconds;
+}
+
+static void record_slow_input(const char *path, size_t size, double seconds) {
+  size_t path_size;
+  int i;
+
+  if (flag_slowest_inputs <= 0) {
+    return;
+  }
+  if (slowest_inputs == NULL) {
+    slowest_inputs = (struct slow_input*) malloc((size_t) flag_slowest_inputs * sizeof(struct slow_input));
+    assert(slowest_inputs != NULL);
+  }
+  if (num_slowest_inputs == flag_slowest_inputs) {
+    if (seconds <= slowest_inputs[num_slowest_inputs - 1].seconds) {
+      return;
+    }
+    free(slowest_inputs[--num_slowest_inputs].path);
+  }
+  for (i = num_slowest_inputs; i > 0 && slowest_inputs[i - 1].seconds < seconds; i--) {
+    slowest_inputs[i] = slowest_inputs[i - 1];
+  }
+  path_size = strlen(path) + 1;
+  slowest_inputs[i].path = (char*) malloc(path_size);
+  assert(slowest_inputs[i].path != NULL);
+  memcpy(slowest_inputs[i].path, path, path_size);
+  slowest_inputs[i].seconds = seconds;
+  slowest_inputs[i].size = size;
+  num_slowest_inputs++;
+}
+
+/* Writes str as a JSON string literal. Bytes that are not valid UTF-8 are written as is. */
+static void write_json_string(FILE *f, const char *str) {
+  const unsigned char *c;
+
+  fputc('"', f);
+  for (c = (const unsigned char*) str; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(f, "\\%c", *c);
+    } else if (*c < 0x20) {
+      fprintf(f, "\\u%04x", *c);
+    } else {
+      fputc(*c, f);
+    }
+  }
+  fputc('"', f);
+}
+
+static void record_input_timing(const char *path, size_t size, double seconds) {
+  num_timed_inputs++;
+  total_input_seconds += seconds;
+  if (seconds > max_input_seconds) {
+    max_input_seconds = seconds;
+  }
+  latency_histogram[latency_bucket(seconds)]++;
+  record_slow_input(path, size, seconds);
+  if (timing_output_file != NULL) {
+    fprintf(timing_output_file, "{\"type\":\"input\",\"input\":");
+    write_json_string(timing_output_file, path);
+    fprintf(timing_output_file, ",\"size\":%lu,\"seconds\":%.9f}\n", (unsigned long) size, seconds);
+    /* -jobs workers share the file, so every line has to be written in one piece. */
+    fflush(timing_output_file);
+  }
+}
+
+static void open_timing_output(void) {
+  if (flag_timing_output == NULL) {
+    return;
+  }
+#ifdef _WIN32
+  /* fopen is deprecated in the Microsoft CRT. */
+  fopen_s(&timing_output_file, flag_timing_output, "w");
+#else
+  timing_output_file = fopen(flag_timing_output, "w");
+#endif
+  if (timing_output_file == NULL) {
+    fprintf(stderr, "Failed to open timing output file '%s': ", flag_timing_output);
+    perror("");
+    exit(1);
+  }
+}
+
+/* The expanded flag_profile_flush_file the LLVM profile runtime currently writes to. */
+static char *profile_flush_path = NULL;
+static size_t profile_flush_path_size = 0;
+static unsigned long num_profile_flushes = 0;
+static int num_inputs_since_profile_flush = 0;
+static double last_profile_flush_seconds = 0;
+
+/* Points the LLVM profile runtime at the file the next flush, or its final write at exit, goes to. */
+static void set_profile_flush_path(void) {
+  const char *pattern;
+  char *out;
+
+  if (profile_flush_path == NULL) {
+    return;
+  }
+  pattern = flag_profile_flush_file;
+  out = profile_flush_path;
+  while (*pattern != '\0') {
+    if (pattern[0] == '%' && pattern[1] == 'i') {
+      format_ulong(out, profile_flush_path_size - (size_t) (out - profile_flush_path), "%lu", num_profile_flushes);
+      out += strlen(out);
+      pattern += 2;
+    } else {
+      *out++ = *pattern++;
+    }
+  }
+  *out = '\0';
+  WITH_DEFAULT(__llvm_profile_set_filename)(profile_flush_path);
+}
+
+/* Returns a non-zero value if pattern contains %i or one of the %m and %<N>m patterns of the LLVM profile runtime,
+ * which merges into existing profiles, so that flushes don't overwrite the profiles written by earlier ones. */
+static int is_distinct_profile_pattern(const char *pattern) {
+  const char *p;
+  const char *specifier;
+
+  for (p = strchr(pattern, '%'); p != NULL; p = strchr(p + 1, '%')) {
+    specifier = p + 1;
+    if (*specifier == 'i') {
+      return 1;
+    }
+    while (*specifier >= '0' && *specifier <= '9') {
+      specifier++;
+    }
+    if (*specifier == 'm') {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void init_profile_flush(void) {
+  const char *profile_file;
+  const char *p;
+  size_t num_placeholders;
+
+  if (flag_profile_flush_inputs <= 0 && flag_profile_flush_seconds <= 0) {
+    return;
+  }
+  if (flag_profile_flush_file == NULL || !is_distinct_profile_pattern(flag_profile_flush_file)) {
+    fprintf(stderr, "-profile_flush_inputs and -profile_flush_seconds require -profile_flush_file with %%i or %%m\n");
+    exit(1);
+  }
+  if (flag_minimize_to != NULL || flag_coverage_report != NULL) {
+    fprintf(stderr, "-profile_flush_inputs and -profile_flush_seconds can't be combined with -minimize_to and"
+                    " -coverage_report\n");
+    exit(1);
+  }
+  /* In continuous mode, the counters are mapped to the file named by LLVM_PROFILE_FILE at startup and the runtime
+   * ignores later changes of the file name. */
+  profile_file = getenv("LLVM_PROFILE_FILE");
+  if ((profile_file != NULL && strstr(profile_file, "%c") != NULL) || strstr(flag_profile_flush_file, "%c") != NULL) {
+    fprintf(stderr, "Continuous mode (%%c in LLVM_PROFILE_FILE) is not supported with -profile_flush_inputs and"
+                    " -profile_flush_seconds\n");
+    exit(1);
+  }
+
+  num_placeholders = 0;
+  for (p = strstr(flag_profile_flush_file, "%i"); p != NULL; p = strstr(p + 2, "%i")) {
+    num_placeholders++;
+  }
+  /* Every %i expands to at most 20 digits. */
+  profile_flush_path_size = strlen(flag_profile_flush_file) + 18 * num_placeholders + 1;
+  profile_flush_path = (char*) malloc(profile_flush_path_size);
+  assert(profile_flush_path != NULL);
+  set_profile_flush_path();
+  if (!have_profile_runtime) {
+    fprintf(stderr, "-profile_flush_inputs and -profile_flush_seconds require a coverage build"
+                    " (CIFUZZ_SANITIZERS=coverage)\n");
+    exit(1);
+  }
+  last_profile_flush_seconds = now_seconds();
+}
+
+/* Writes the counters of the inputs run since the last flush to the current profile file and starts the next one. */
+static void maybe_flush_profile(void) {
+  double now;
+
+  if (profile_flush_path == NULL) {
+    return;
+  }
+  num_inputs_since_profile_flush++;
+  now = now_seconds();
+  if ((flag_profile_flush_inputs <= 0 || num_inputs_since_profile_flush < flag_profile_flush_inputs)
+      && (flag_profile_flush_seconds <= 0 || now - last_profile_flush_seconds < (double) flag_profile_flush_seconds)) {
+    return;
+  }
+  if (WITH_DEFAULT(__llvm_profile_write_file)() != 0) {
+    fprintf(stderr, "Failed to flush the coverage profile to '%s'\n", profile_flush_path);
+    exit(1);
+  }
+  WITH_DEFAULT(__llvm_profile_reset_counters)();
+  num_profile_flushes++;
+  num_inputs_since_profile_flush = 0;
+  last_profile_flush_seconds = now;
+  set_profile_flush_path();
+}
+
+/* Non-zero in a worker whose gcov counters are written to its shard of -gcov_shard_dir. */
+static int gcov_shard_active = 0;
+static int num_inputs_since_gcov_flush = 0;
+
+/* Writes the gcov counters to the .gcda files below the current GCOV_PREFIX, merging them with the counters of
+ * previous dumps, and resets them so that they aren't written again at exit. */
+static void dump_gcov_counters(void) {
+#ifdef CIFUZZ_HAS_GCOV
+  __gcov_dump();
+  __gcov_reset();
+#endif
+}
+
+static void maybe_flush_gcov(void) {
+  if (!gcov_shard_active || flag_gcov_flush_inputs <= 0) {
+    return;
+  }
+  num_inputs_since_gcov_flush++;
+  if (num_inputs_since_gcov_flush < flag_gcov_flush_inputs) {
+    return;
+  }
+  dump_gcov_counters();
+  num_inputs_since_gcov_flush = 0;
+}
+
+static void print_summary(const char *failure_reason);
+
+/* libFuzzer's exit codes for -timeout and -rss_limit_mb, so that findings are reported consistently across engines. */
+#define TIMEOUT_EXIT_CODE 70
+#define OOM_EXIT_CODE 71
+
+/* Whether -timeout or -rss_limit_mb are set. */
+static int watchdog_enabled = 0;
+/* The start of the current input for -timeout. */
+static double input_start_seconds = 0;
+#ifdef _WIN32
+static int watchdog_started = 0;
+#else
+/* Timers aren't inherited by forked children, so the watchdog is started again in every process that runs inputs. */
+static pid_t watchdog_pid = 0;
+#endif
+
+#if !defined(_WIN32)
+/* A thread that runs inputs with -threads. The fields read by the watchdog and the crash handlers, which can run on any
+ * thread, replace the globals of the same name. */
+struct replay_thread {
+  pthread_t thread;
+  /* The 1-based number of the thread. */
+  int number;
+  /* Guards next and end, which other threads shrink when they steal inputs. */
+  pthread_mutex_t mutex;
+  /* The indices of the inputs the thread still has to run are [next, end). */
+  size_t next;
+  size_t end;
+  const char *volatile current_input;
+  volatile int in_user_callback;
+  volatile double input_start_seconds;
+  int num_passing_inputs;
+  int next_progress_line;
+};
+
+/* Non-NULL while the inputs are run with -threads. */
+static struct replay_thread *replay_threads = NULL;
+static int num_replay_threads = 0;
+/* The replay thread the current thread is, NULL on the main thread. */
+static __thread struct replay_thread *this_replay_thread = NULL;
+/* The thread whose input the watchdog reports, which runs on an arbitrary thread. */
+static struct replay_thread *volatile watchdog_failing_thread = NULL;
+/* Set by the first thread that prints the summary, see claim_thread_summary. */
+static volatile int thread_summary_claimed = 0;
+#endif
+
+static unsigned long current_pid(void) {
+#ifdef _WIN32
+  return (unsigned long) GetCurrentProcessId();
+#else
+  return (unsigned long) getpid();
+#endif
+}
+
+/* Returns the peak resident set size of the process in megabytes. */
+static unsigned long peak_rss_mb(void) {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return (unsigned long) (counters.PeakWorkingSetSize >> 20);
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  /* ru_maxrss is in bytes on macOS. */
+  return (unsigned long) usage.ru_maxrss >> 20;
+#else
+  return (unsigned long) usage.ru_maxrss >> 10;
+#endif
+#endif
+}
+
+/* Reports a timeout or out-of-memory finding on the current input like libFuzzer and terminates the process. */
+static void report_watchdog_finding(const char *kind, const char *failure_reason, int exit_code) {
+#ifdef CIFUZZ_HAS_SANITIZER
+  __sanitizer_print_stack_trace();
+#endif
+  fprintf(stderr, "SUMMARY: libFuzzer: %s\n", kind);
+  print_summary(failure_reason);
+  fflush(stderr);
+  _exit(exit_code);
+}
+
+static void check_rss_limit(void) {
+  unsigned long rss_mb;
+  char reason[64];
+
+  rss_mb = peak_rss_mb();
+  if (flag_rss_limit_mb <= 0 || rss_mb <= (unsigned long) flag_rss_limit_mb) {
+    return;
+  }
+  fprintf(stderr, "==%lu== ERROR: libFuzzer: out-of-memory (used: %luMb; exceeds: %dMb)\n", current_pid(), rss_mb,
+          flag_rss_limit_mb);
+  format_ulong(reason, sizeof(reason), "Out of memory (used: %luMb)", rss_mb);
+  report_watchdog_finding("out-of-memory", reason, OOM_EXIT_CODE);
+}
+
+static void check_timeout(double start_seconds) {
+  unsigned long seconds;
+  char reason[64];
+
+  if (flag_timeout <= 0) {
+    return;
+  }
+  seconds = (unsigned long) (now_seconds() - start_seconds);
+  if (seconds >= (unsigned long) flag_timeout) {
+    fprintf(stderr, "==%lu== ERROR: libFuzzer: timeout after %lu seconds\n", current_pid(), seconds);
+    format_ulong(reason, sizeof(reason), "Timeout after %lu seconds", seconds);
+    report_watchdog_finding("timeout", reason, TIMEOUT_EXIT_CODE);
+  }
+}
+
+#if !defined(_WIN32)
+/* Checks the inputs of all threads run with -threads. The RSS is shared by all threads and thus attributed to any
+ * thread that is running an input. */
+static void watchdog_tick_threads(void) {
+  struct replay_thread *running = NULL;
+  int i;
+
+  for (i = 0; i < num_replay_threads; i++) {
+    if (!replay_threads[i].in_user_callback) {
+      continue;
+    }
+    running = &replay_threads[i];
+    if (flag_timeout > 0 && now_seconds() - running->input_start_seconds >= (double) flag_timeout) {
+      watchdog_failing_thread = running;
+      check_timeout(running->input_start_seconds);
+    }
+  }
+  if (running != NULL && flag_rss_limit_mb > 0 && peak_rss_mb() > (unsigned long) flag_rss_limit_mb) {
+    watchdog_failing_thread = running;
+    check_rss_limit();
+  }
+}
+#endif
+
+/* Runs once per second while inputs are being run, either as a SIGALRM handler or on a thread on Windows. */
+static void watchdog_tick(void) {
+#if !defined(_WIN32)
+  if (replay_threads != NULL) {
+    watchdog_tick_threads();
+    return;
+  }
+#endif
+  if (!in_user_callback) {
+    return;
+  }
+  check_timeout(input_start_seconds);
+  check_rss_limit();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI watchdog_thread(LPVOID param) {
+  (void) param;
+  for (;;) {
+    Sleep(1000);
+    watchdog_tick();
+  }
+}
+#else
+static void watchdog_signal_handler(int sig) {
+  (void) sig;
+  watchdog_tick();
+}
+#endif
+
+/* Starts the watchdog in the current process if it isn't running yet. */
+static void start_watchdog(void) {
+#if !defined(_WIN32)
+  struct sigaction action;
+  struct itimerval timer;
+#endif
+
+#ifdef _WIN32
+  if (watchdog_started) {
+    return;
+  }
+  watchdog_started = 1;
+  if (CreateThread(NULL, 0, watchdog_thread, NULL, 0, NULL) == NULL) {
+    fprintf(stderr, "Failed to start the watchdog thread for -timeout and -rss_limit_mb: error %lu\n",
+            (unsigned long) GetLastError());
+    exit(1);
+  }
+#else
+  if (watchdog_pid == getpid()) {
+    return;
+  }
+  watchdog_pid = getpid();
+  /* Restart interrupted system calls so that the ticks don't affect the replayer or the fuzz test. */
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = watchdog_signal_handler;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  timer.it_interval.tv_sec = 1;
+  timer.it_interval.tv_usec = 0;
+  timer.it_value = timer.it_interval;
+  if (sigaction(SIGALRM, &action, NULL) != 0 || setitimer(ITIMER_REAL, &timer, NULL) != 0) {
+    perror("Failed to start the watchdog for -timeout and -rss_limit_mb");
+    exit(1);
+  }
+#endif
+}
+
+static void run_one_input(const unsigned char *data, size_t size) {
+  int res;
+  double start = 0;
+
+  if (timing_enabled) {
+    start = now_seconds();
+  }
+  if (watchdog_enabled) {
+    start_watchdog();
+    input_start_seconds = now_seconds();
+  }
+  in_user_callback = 1;
+  res = LLVMFuzzerTestOneInput(data, size);
+  /* Avoid "unused but set variable" warnings if asserts are compiled out with NDEBUG. */
+  (void)res;
+  assert(res == 0);
+  if (watchdog_enabled) {
+    /* Attribute the RSS growth to the input that caused it even if it finished before the next tick. */
+    check_rss_limit();
+  }
+  in_user_callback = 0;
+  num_passing_inputs++;
+  if (timing_enabled) {
+    record_input_timing(current_input != NULL ? current_input : "<empty input>", size, now_seconds() - start);
+  }
+  maybe_flush_profile();
+  maybe_flush_gcov();
+}
+
+/* Where the data of a loaded input lives, which determines how it is released. */
+enum input_storage {
+  INPUT_EMPTY,
+  INPUT_MAPPED,
+  INPUT_HEAP,
+  INPUT_REUSABLE_BUFFER,
+  INPUT_PACKED
+};
+
+/* The contents of an input file, which are always handed to the fuzz test with their exact size. */
+struct input {
+  const unsigned char *data;
+  size_t size;
+  enum input_storage storage;
+  /* The page-aligned size of the memory mapping if storage is INPUT_MAPPED. */
+  size_t mapping_size;
+};
+
+/* Used as the data of empty inputs, which can't be mapped. */
+static const unsigned char empty_input[1] = {0};
+
+/* High-water-mark buffer that inputs are read into with -reuse_input_buffer=1. It only ever grows, so replaying many
+ * small inputs requires a constant number of allocations rather than one per input. */
+static unsigned char *reusable_buf = NULL;
+static size_t reusable_buf_capacity = 0;
+
+static void set_empty_input(struct input *in) {
+  in->data = empty_input;
+  in->size = 0;
+  in->storage = INPUT_EMPTY;
+}
+
+static size_t page_size(void) {
+#ifdef _WIN32
+  SYSTEM_INFO system_info;
+
+  GetSystemInfo(&system_info);
+  return (size_t) system_info.dwPageSize;
+#else
+  return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/* Without sanitizer support, reads past the end of an input that doesn't occupy all of its underlying memory (a
+ * page-granular mapping or the reusable buffer) would go unnoticed. With ASan, we poison the slack so that such
+ * overreads are reported just as they are for heap buffers of the exact size. */
+static void poison_slack(const unsigned char *data, size_t size, size_t capacity) {
+#ifdef CIFUZZ_HAS_ASAN
+  __asan_poison_memory_region(data + size, capacity - size);
+#else
+  (void) data;
+  (void) size;
+  (void) capacity;
+#endif
+}
+
+static void unpoison(const unsigned char *data, size_t capacity) {
+#ifdef CIFUZZ_HAS_ASAN
+  __asan_unpoison_memory_region(data, capacity);
+#else
+  (void) data;
+  (void) capacity;
+#endif
+}
+
+static void finish_mapping(struct input *in, void *addr, size_t size) {
+  size_t page = page_size();
+
+  in->data = (const unsigned char*) addr;
+  in->size = size;
+  in->storage = INPUT_MAPPED;
+  in->mapping_size = (size + page - 1) / page * page;
+  poison_slack(in->data, in->size, in->mapping_size);
+}
+
+/* Maps the regular file at path into memory. Returns a non-zero value if the file can't be mapped, in which case the
+ * caller should fall back to read_file. */
+static int map_file(const char *path, struct input *in) {
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+  LARGE_INTEGER size;
+  void *addr;
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    /* TODO: Include the stringified last error in the message. */
+    fprintf(stderr, "Failed to open file '%s'\n", path);
+    exit(1);
+  }
+  if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return 1;
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    set_empty_input(in);
+    return 0;
+  }
+  /* Both the mapping object and the view keep a reference to the underlying file, so the handles can be closed as
+   * soon as they have been used. */
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) {
+    return 1;
+  }
+  addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (addr == NULL) {
+    return 1;
+  }
+  finish_mapping(in, addr, (size_t) size.QuadPart);
+  return 0;
+#else
+  int fd;
+  struct stat stat_info;
+  void *addr;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("Failed to open file");
+    exit(1);
+  }
+  if (fstat(fd, &stat_info) != 0 || !S_ISREG(stat_info.st_mode)) {
+    close(fd);
+    return 1;
+  }
+  if (stat_info.st_size == 0) {
+    close(fd);
+    set_empty_input(in);
+    return 0;
+  }
+  addr = mmap(NULL, (size_t) stat_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping remains valid after the file descriptor has been closed. */
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return 1;
+  }
+  finish_mapping(in, addr, (size_t) stat_info.st_size);
+  return 0;
+#endif
+}
+
+static FILE *open_input_file(const char *path) {
+  FILE *f;
+
+#ifdef _WIN32
+  /* fopen is deprecated in the Microsoft CRT. */
+  fopen_s(&f, path, "rb");
+#else
+  /* fopen_s is not available in Unix C90 system headers. */
+  f = fopen(path, "rb");
+#endif
+  if (f == NULL) {
+    perror("Failed to open file");
+    exit(1);
+  }
+  return f;
+}
+
+/* Reads f until EOF into *buf, growing it as needed, and returns the number of bytes read. */
+static size_t read_until_eof(FILE *f, unsigned char **buf, size_t *capacity) {
+  unsigned char *new_buf;
+  size_t len;
+
+  if (*capacity == 0) {
+    *capacity = 4096;
+    *buf = (unsigned char*) malloc(*capacity);
+    assert(*buf != NULL);
+  }
+  len = 0;
+  for (;;) {
+    len += fread(*buf + len, 1, *capacity - len, f);
+    if (len < *capacity) {
+      break;
+    }
+    *capacity *= 2;
+    new_buf = (unsigned char*) realloc(*buf, *capacity);
+    assert(new_buf != NULL);
+    *buf = new_buf;
+  }
+  if (ferror(f)) {
+    perror("Failed to read file");
+    exit(1);
+  }
+  return len;
+}
+
+/* Reads the file at path into a heap buffer of the exact size of the contents. Unlike map_file, this also works for
+ * files that are neither mappable nor seekable, such as pipes. */
+static void read_file(const char *path, struct input *in) {
+  FILE *f;
+  unsigned char *buf = NULL;
+  unsigned char *new_buf;
+  size_t capacity = 0;
+  size_t len;
+
+  f = open_input_file(path);
+  len = read_until_eof(f, &buf, &capacity);
+  fclose(f);
+  if (len == 0) {
+    free(buf);
+    set_empty_input(in);
+    return;
+  }
+  /* Shrink the buffer to the exact input size so that ASan catches reads past its end. */
+  new_buf = (unsigned char*) realloc(buf, len);
+  assert(new_buf != NULL);
+  in->data = new_buf;
+  in->size = len;
+  in->storage = INPUT_HEAP;
+}
+
+/* Reads the file at path into the reusable buffer, which is left in place for the next input on release. */
+static void read_file_into_reusable_buffer(const char *path, struct input *in) {
+  FILE *f;
+
+  f = open_input_file(path);
+  in->size = read_until_eof(f, &reusable_buf, &reusable_buf_capacity);
+  fclose(f);
+  in->data = reusable_buf;
+  in->storage = INPUT_REUSABLE_BUFFER;
+  poison_slack(in->data, in->size, reusable_buf_capacity);
+}
+
+static uint32_t rotate_left(uint32_t x, int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+/* MurmurHash3 (x86, 32-bit). */
+static uint32_t hash_bytes(const unsigned char *data, size_t size, uint32_t seed) {
+  const uint32_t c1 = 0xcc9e2d51;
+  const uint32_t c2 = 0x1b873593;
+  uint32_t h;
+  uint32_t k;
+  size_t i;
+
+  h = seed;
+  for (i = 0; i + 4 <= size; i += 4) {
+    /* Avoids unaligned and endianness-dependent reads. */
+    k = (uint32_t) data[i] | (uint32_t) data[i + 1] << 8 | (uint32_t) data[i + 2] << 16 | (uint32_t) data[i + 3] << 24;
+    k *= c1;
+    k = rotate_left(k, 15);
+    k *= c2;
+    h ^= k;
+    h = rotate_left(h, 13);
+    h = h * 5 + 0xe6546b64;
+  }
+  k = 0;
+  switch (size & 3) {
+  case 3:
+    k ^= (uint32_t) data[i + 2] << 16;
+    /* fall through */
+  case 2:
+    k ^= (uint32_t) data[i + 1] << 8;
+    /* fall through */
+  case 1:
+    k ^= (uint32_t) data[i];
+    k *= c1;
+    k = rotate_left(k, 15);
+    k *= c2;
+    h ^= k;
+  }
+  h ^= (uint32_t) size;
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+#ifdef _WIN32
+static const char PATH_SEPARATOR = '\\';
+#else
+static const char PATH_SEPARATOR = '/';
+#endif
+
+/*
+ * A packed corpus bundles many inputs into a single file with the suffix PACKED_CORPUS_SUFFIX, which avoids the
+ * per-file cost of opening, mapping and listing loose files. It is mapped once and its entries are addressed as if it
+ * were a directory, e.g. corpus.cifuzzpack/some/input. The format, with all integers as 32-bit little endian:
+ *
+ *   header:   "CIFZPACK", version (1), number of entries, offset of the payloads, reserved (0)
+ *   index:    for every entry: offset and size of its payload, offset and size of its name
+ *   names:    the names of all entries, not null-terminated
+ *   payloads: the contents of all entries, each starting at an offset that is a multiple of 8
+ *
+ * Keep in sync with internal/bundler/corpuspack.
+ */
+static const char *PACKED_CORPUS_SUFFIX = ".cifuzzpack";
+static const char PACKED_CORPUS_MAGIC[8] = {'C', 'I', 'F', 'Z', 'P', 'A', 'C', 'K'};
+#define PACKED_CORPUS_VERSION 1
+#define PACKED_CORPUS_HEADER_SIZE 24
+#define PACKED_CORPUS_INDEX_ENTRY_SIZE 16
+
+struct packed_corpus {
+  char *path;
+  struct input file;
+  uint32_t num_entries;
+  uint32_t payloads_offset;
+  /* Open addressing hash table mapping entry names to entry indices plus one, with 0 marking empty slots. */
+  uint32_t *name_table;
+  size_t name_table_capacity;
+  /* The paths <path><separator><name> of all entries in index order, allocated at once when the entries are first
+   * added to an input list. Input lists refer to these strings rather than copies, so that the entry of an input is
+   * found from the address of its path when it is run, without parsing the path or accessing the file system. */
+  char *entry_paths;
+  size_t entry_paths_size;
+  size_t *entry_path_offsets;
+};
+
+/* All packed corpora loaded so far. They stay mapped until the process exits. */
+static struct packed_corpus **packed_corpora = NULL;
+static size_t num_packed_corpora = 0;
+
+static uint32_t read_le32(const unsigned char *p) {
+  return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+struct packed_entry {
+  uint32_t payload_offset;
+  uint32_t payload_size;
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+static void read_packed_entry(const struct packed_corpus *corpus, uint32_t index, struct packed_entry *entry) {
+  const unsigned char *p;
+
+  p = corpus->file.data + PACKED_CORPUS_HEADER_SIZE + (size_t) index * PACKED_CORPUS_INDEX_ENTRY_SIZE;
+  entry->payload_offset = read_le32(p);
+  entry->payload_size = read_le32(p + 4);
+  entry->name_offset = read_le32(p + 8);
+  entry->name_size = read_le32(p + 12);
+}
+
+static void invalid_packed_corpus(const char *path, const char *reason) {
+  fprintf(stderr, "Invalid packed corpus '%s': %s\n", path, reason);
+  exit(1);
+}
+
+/* Maps and validates the packed corpus at path, or returns the already loaded one. */
+static struct packed_corpus *load_packed_corpus(const char *path) {
+  struct packed_corpus *corpus;
+  struct packed_corpus **new_packed_corpora;
+  struct packed_entry entry;
+  const unsigned char *data;
+  size_t size;
+  size_t index_end;
+  size_t slot;
+  uint32_t i;
+
+  for (i = 0; i < num_packed_corpora; i++) {
+    if (strcmp(packed_corpora[i]->path, path) == 0) {
+      return packed_corpora[i];
+    }
+  }
+
+  corpus = (struct packed_corpus*) malloc(sizeof(struct packed_corpus));
+  assert(corpus != NULL);
+  corpus->path = (char*) malloc(strlen(path) + 1);
+  assert(corpus->path != NULL);
+  strcpy(corpus->path, path);
+  corpus->entry_paths = NULL;
+  corpus->entry_paths_size = 0;
+  corpus->entry_path_offsets = NULL;
+  if (map_file(path, &corpus->file) != 0 || corpus->file.storage != INPUT_MAPPED) {
+    invalid_packed_corpus(path, "not a regular, non-empty file");
+  }
+  data = corpus->file.data;
+  size = corpus->file.size;
+  if (size < PACKED_CORPUS_HEADER_SIZE || memcmp(data, PACKED_CORPUS_MAGIC, sizeof(PACKED_CORPUS_MAGIC)) != 0) {
+    invalid_packed_corpus(path, "missing header");
+  }
+  if (read_le32(data + 8) != PACKED_CORPUS_VERSION) {
+    invalid_packed_corpus(path, "unsupported version");
+  }
+  corpus->num_entries = read_le32(data + 12);
+  corpus->payloads_offset = read_le32(data + 16);
+  if (corpus->num_entries > (size - PACKED_CORPUS_HEADER_SIZE) / PACKED_CORPUS_INDEX_ENTRY_SIZE) {
+    invalid_packed_corpus(path, "truncated index");
+  }
+  index_end = PACKED_CORPUS_HEADER_SIZE + (size_t) corpus->num_entries * PACKED_CORPUS_INDEX_ENTRY_SIZE;
+  if (corpus->payloads_offset < index_end || corpus->payloads_offset > size) {
+    invalid_packed_corpus(path, "invalid payload offset");
+  }
+
+  corpus->name_table_capacity = 16;
+  while (corpus->name_table_capacity < 2 * (size_t) corpus->num_entries) {
+    corpus->name_table_capacity *= 2;
+  }
+  corpus->name_table = (uint32_t*) calloc(corpus->name_table_capacity, sizeof(uint32_t));
+  assert(corpus->name_table != NULL);
+  for (i = 0; i < corpus->num_entries; i++) {
+    read_packed_entry(corpus, i, &entry);
+    if (entry.name_offset < index_end || entry.name_offset > corpus->payloads_offset
+        || entry.name_size > corpus->payloads_offset - entry.name_offset || entry.name_size == 0
+        || memchr(data + entry.name_offset, '\0', entry.name_size) != NULL) {
+      invalid_packed_corpus(path, "invalid entry name");
+    }
+    if (entry.payload_offset < corpus->payloads_offset || entry.payload_offset % 8 != 0
+        || entry.payload_offset > size || entry.payload_size > size - entry.payload_offset) {
+      invalid_packed_corpus(path, "invalid entry payload");
+    }
+    slot = hash_bytes(data + entry.name_offset, entry.name_size, 0) & (corpus->name_table_capacity - 1);
+    while (corpus->name_table[slot] != 0) {
+      slot = (slot + 1) & (corpus->name_table_capacity - 1);
+    }
+    corpus->name_table[slot] = i + 1;
+  }
+  /* Each payload is made accessible only while it is the current input, so that ASan catches reads beyond it. The
+   * payloads are 8-byte aligned to match ASan's shadow granularity. */
+  poison_slack(data, corpus->payloads_offset, corpus->file.mapping_size);
+
+  new_packed_corpora = (struct packed_corpus**) realloc(packed_corpora,
+                                                        (num_packed_corpora + 1) * sizeof(struct packed_corpus*));
+  assert(new_packed_corpora != NULL);
+  packed_corpora = new_packed_corpora;
+  packed_corpora[num_packed_corpora++] = corpus;
+  return corpus;
+}
+
+/* Returns a non-zero value if path has the form <packed corpus><separator><entry name>. In that case, the packed
+ * corpus is loaded and *name is set to the start of the entry name within path. */
+static int split_packed_entry_path(const char *path, struct packed_corpus **corpus, const char **name) {
+  const char *pos;
+  const char *end;
+  char *corpus_path;
+  struct POSIX_STAT stat_info;
+  size_t corpus_path_len;
+
+  for (pos = strstr(path, PACKED_CORPUS_SUFFIX); pos != NULL; pos = strstr(end, PACKED_CORPUS_SUFFIX)) {
+    end = pos + strlen(PACKED_CORPUS_SUFFIX);
+#ifdef _WIN32
+    if (*end != '/' && *end != '\\') {
+#else
+    if (*end != '/') {
+#endif
+      continue;
+    }
+    corpus_path_len = (size_t) (end - path);
+    corpus_path = (char*) malloc(corpus_path_len + 1);
+    assert(corpus_path != NULL);
+    memcpy(corpus_path, path, corpus_path_len);
+    corpus_path[corpus_path_len] = '\0';
+    if (POSIX_STAT(corpus_path, &stat_info) == 0 && (stat_info.st_mode & POSIX_S_IFREG)) {
+      *corpus = load_packed_corpus(corpus_path);
+      *name = end + 1;
+      free(corpus_path);
+      return 1;
+    }
+    free(corpus_path);
+  }
+  return 0;
+}
+
+/* Looks up the entry with the given name. Returns zero if the packed corpus doesn't contain it and the index of the
+ * entry plus one otherwise. */
+static uint32_t find_packed_entry(const struct packed_corpus *corpus, const char *name, struct packed_entry *entry) {
+  size_t name_size;
+  size_t slot;
+  uint32_t index;
+
+  name_size = strlen(name);
+  slot = hash_bytes((const unsigned char*) name, name_size, 0) & (corpus->name_table_capacity - 1);
+  for (; (index = corpus->name_table[slot]) != 0; slot = (slot + 1) & (corpus->name_table_capacity - 1)) {
+    read_packed_entry(corpus, index - 1, entry);
+    if (entry->name_size == name_size && memcmp(corpus->file.data + entry->name_offset, name, name_size) == 0) {
+      return index;
+    }
+  }
+  return 0;
+}
+
+/* Returns the path of the entry with the given index as stored in entry_paths, which are created on first use. */
+static char *packed_entry_path(struct packed_corpus *corpus, uint32_t index) {
+  struct packed_entry entry;
+  size_t path_len;
+  size_t offset;
+  uint32_t i;
+
+  if (corpus->entry_paths == NULL) {
+    path_len = strlen(corpus->path);
+    corpus->entry_paths_size = 0;
+    for (i = 0; i < corpus->num_entries; i++) {
+      read_packed_entry(corpus, i, &entry);
+      corpus->entry_paths_size += path_len + 1 + entry.name_size + 1;
+    }
+    corpus->entry_paths = (char*) malloc(corpus->entry_paths_size);
+    assert(corpus->entry_paths != NULL);
+    corpus->entry_path_offsets = (size_t*) malloc((corpus->num_entries + 1) * sizeof(size_t));
+    assert(corpus->entry_path_offsets != NULL);
+    offset = 0;
+    for (i = 0; i < corpus->num_entries; i++) {
+      read_packed_entry(corpus, i, &entry);
+      corpus->entry_path_offsets[i] = offset;
+      memcpy(corpus->entry_paths + offset, corpus->path, path_len);
+      corpus->entry_paths[offset + path_len] = PATH_SEPARATOR;
+      memcpy(corpus->entry_paths + offset + path_len + 1, corpus->file.data + entry.name_offset, entry.name_size);
+      offset += path_len + 1 + entry.name_size;
+      corpus->entry_paths[offset++] = '\0';
+    }
+    corpus->entry_path_offsets[corpus->num_entries] = offset;
+  }
+  return corpus->entry_paths + corpus->entry_path_offsets[index];
+}
+
+/* Returns a non-zero value if path is one of the entry paths returned by packed_entry_path, in which case *corpus and
+ * *index are set to its packed corpus and entry index if they are not NULL. Only compares addresses. */
+static int find_entry_of_packed_path(const char *path, struct packed_corpus **corpus, uint32_t *index) {
+  struct packed_corpus *candidate;
+  size_t offset;
+  uint32_t lo;
+  uint32_t hi;
+  uint32_t mid;
+  size_t i;
+
+  for (i = 0; i < num_packed_corpora; i++) {
+    candidate = packed_corpora[i];
+    if (candidate->entry_paths == NULL || path < candidate->entry_paths
+        || path >= candidate->entry_paths + candidate->entry_paths_size) {
+      continue;
+    }
+    offset = (size_t) (path - candidate->entry_paths);
+    /* Find the last entry path that starts at or before path. */
+    lo = 0;
+    hi = candidate->num_entries;
+    while (hi - lo > 1) {
+      mid = lo + (hi - lo) / 2;
+      if (candidate->entry_path_offsets[mid] <= offset) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    if (candidate->entry_path_offsets[lo] != offset) {
+      return 0;
+    }
+    if (corpus != NULL) {
+      *corpus = candidate;
+    }
+    if (index != NULL) {
+      *index = lo;
+    }
+    return 1;
+  }
+  return 0;
+}
+
+/* Looks up the packed corpus entry at path, which is cheap for paths collected into an input list. Returns zero if path
+ * doesn't refer to a packed corpus entry and exits if the packed corpus doesn't contain it. */
+static int lookup_packed_input(const char *path, struct packed_corpus **corpus, struct packed_entry *entry) {
+  const char *name;
+  uint32_t index;
+
+  if (find_entry_of_packed_path(path, corpus, &index)) {
+    read_packed_entry(*corpus, index, entry);
+    return 1;
+  }
+  if (!split_packed_entry_path(path, corpus, &name)) {
+    return 0;
+  }
+  if (!find_packed_entry(*corpus, name, entry)) {
+    fprintf(stderr, "Failed to find '%s' in packed corpus '%s'\n", name, (*corpus)->path);
+    exit(1);
+  }
+  return 1;
+}
+
+/* Loads the input at path if it is an entry of a packed corpus. Returns zero if path doesn't refer to a packed corpus
+ * entry. */
+static int load_packed_input(const char *path, struct input *in) {
+  struct packed_corpus *corpus;
+  struct packed_entry entry;
+
+  if (!lookup_packed_input(path, &corpus, &entry)) {
+    return 0;
+  }
+  if (entry.payload_size == 0) {
+    set_empty_input(in);
+    return 1;
+  }
+  in->data = corpus->file.data + entry.payload_offset;
+  in->size = entry.payload_size;
+  in->storage = INPUT_PACKED;
+  unpoison(in->data, in->size);
+  return 1;
+}
+
+/* Like map_file, but also supports entries of packed corpora. */
+static int map_input(const char *path, struct input *in) {
+  if (load_packed_input(path, in)) {
+    return 0;
+  }
+  return map_file(path, in);
+}
+
+static void load_input(const char *path, struct input *in) {
+  if (load_packed_input(path, in)) {
+    return;
+  }
+  if (flag_reuse_input_buffer) {
+    read_file_into_reusable_buffer(path, in);
+  } else if (map_file(path, in) != 0) {
+    read_file(path, in);
+  }
+}
+
+static void release_input(struct input *in) {
+  switch (in->storage) {
+  case INPUT_EMPTY:
+    break;
+  case INPUT_MAPPED:
+    unpoison(in->data, in->mapping_size);
+#ifdef _WIN32
+    UnmapViewOfFile(in->data);
+#else
+    munmap((void*) in->data, in->mapping_size);
+#endif
+    break;
+  case INPUT_HEAP:
+    free((void*) in->data);
+    break;
+  case INPUT_REUSABLE_BUFFER:
+    /* The buffer has to be fully accessible again before it is grown by realloc or overwritten by fread. */
+    unpoison(in->data, reusable_buf_capacity);
+    break;
+  case INPUT_PACKED:
+    poison_slack(in->data, 0, in->size);
+    break;
+  }
+  in->data = NULL;
+}
+
+/* The 1-based index of this process if it is a worker forked with -jobs, 0 otherwise. */
+static int worker_number = 0;
+
+/* Non-zero in a child forked to run a single input with -keep_going=1. Its parent logs the progress instead. */
+static int running_isolated = 0;
+
+/* With -quiet=1, prints the number of passing inputs. Like libFuzzer's status lines, the number of lines is logarithmic
+ * in the number of inputs. The summary includes the failing input, so the crash report doesn't rely on any of the
+ * omitted lines. */
+static void log_progress(void) {
+  static int next_progress_line = 1;
+
+  if (!flag_quiet || running_isolated || num_passing_inputs < next_progress_line) {
+    return;
+  }
+  while (next_progress_line <= num_passing_inputs) {
+    next_progress_line *= 2;
+  }
+  if (worker_number != 0) {
+    fprintf(stderr, "#%d\tinputs passed in worker %d\n", num_passing_inputs, worker_number);
+  } else {
+    fprintf(stderr, "#%d\tinputs passed\n", num_passing_inputs);
+  }
+}
+
+static void log_input_started(const char *name) {
+  if (!flag_quiet) {
+    fprintf(stderr, "Running: %s\n", name);
+  }
+}
+
+static void log_input_done(const char *name, size_t size) {
+  if (!flag_quiet) {
+    fprintf(stderr, "Done:    %s (%ld bytes)\n", name, (unsigned long) size);
+    return;
+  }
+  log_progress();
+}
+
+/* Runs the input at path and returns its size. */
+static size_t run_file(const char *path) {
+  struct input in;
+  size_t size;
+
+  log_input_started(path);
+  load_input(path, &in);
+  current_input = path;
+  run_one_input(in.data, in.size);
+  current_input = NULL;
+  size = in.size;
+  log_input_done(path, size);
+  release_input(&in);
+  return size;
+}
+
+/* The paths of all input files to run, collected from the given files and directories before any input is run. */
+struct input_list {
+  char **paths;
+  size_t len;
+  size_t capacity;
+};
+
+static char *copy_string(const char *str) {
+  char *copy;
+  size_t size;
+
+  size = strlen(str) + 1;
+  copy = (char*) malloc(size);
+  assert(copy != NULL);
+  memcpy(copy, str, size);
+  return copy;
+}
+
+/* Appends path without copying it. It is either owned by the list or, for entries of packed corpora, by the corpus. */
+static void append_input_path(struct input_list *list, char *path) {
+  char **new_paths;
+
+  if (list->len == list->capacity) {
+    list->capacity = list->capacity == 0 ? 64 : 2 * list->capacity;
+    new_paths = (char**) realloc(list->paths, list->capacity * sizeof(char*));
+    assert(new_paths != NULL);
+    list->paths = new_paths;
+  }
+  list->paths[list->len++] = path;
+}
+
+static void append_input(struct input_list *list, const char *path) {
+  append_input_path(list, copy_string(path));
+}
+
+/* Frees a path of an input list unless it is owned by a packed corpus. */
+static void free_input_path(char *path) {
+  if (!find_entry_of_packed_path(path, NULL, NULL)) {
+    free(path);
+  }
+}
+
+static void free_input_list(struct input_list *list) {
+  size_t i;
+
+  for (i = 0; i < list->len; i++) {
+    free_input_path(list->paths[i]);
+  }
+  free(list->paths);
+  list->paths = NULL;
+  list->len = 0;
+  list->capacity = 0;
+}
+
+/* A path that is extended and truncated in place while traversing directories, so that no allocation is required per
+ * directory entry. */
+struct path_buffer {
+  char *str;
+  size_t len;
+  size_t capacity;
+};
+
+static void path_buffer_append(struct path_buffer *path, const char *str, size_t len) {
+  char *new_str;
+
+  if (path->len + len + 1 > path->capacity) {
+    while (path->len + len + 1 > path->capacity) {
+      path->capacity = path->capacity == 0 ? 256 : 2 * path->capacity;
+    }
+    new_str = (char*) realloc(path->str, path->capacity);
+    assert(new_str != NULL);
+    path->str = new_str;
+  }
+  memcpy(path->str + path->len, str, len);
+  path->len += len;
+  path->str[path->len] = '\0';
+}
+
+/* Appends a path separator followed by component. */
+static void path_buffer_push(struct path_buffer *path, const char *component) {
+  path_buffer_append(path, &PATH_SEPARATOR, 1);
+  path_buffer_append(path, component, strlen(component));
+}
+
+static void path_buffer_truncate(struct path_buffer *path, size_t len) {
+  path->len = len;
+  path->str[len] = '\0';
+}
+
+/* The type of a file as far as it is known from the directory listing. */
+enum entry_type {
+  /* The type has to be determined with stat, e.g. because the entry is a symlink. */
+  ENTRY_UNKNOWN,
+  ENTRY_DIR,
+  ENTRY_FILE
+};
+
+static void collect_path(struct path_buffer *path, enum entry_type type, struct input_list *list);
+
+static void collect_dir_entry(struct path_buffer *dir, const char *file, enum entry_type type,
+                              struct input_list *list) {
+  size_t dir_len;
+
+  /* Skip hidden files as well as "." and "..". File names can't be empty. */
+  if (file[0] == '.') {
+    return;
+  }
+
+  dir_len = dir->len;
+  path_buffer_push(dir, file);
+  collect_path(dir, type, list);
+  path_buffer_truncate(dir, dir_len);
+}
+
+#if !defined(_WIN32)
+/* Resets errno before calling readdir to ensure that previous errors aren't taken for readdir failures. */
+static struct dirent* clear_errno_readdir(DIR *dirp) {
+  errno = 0;
+  return readdir(dirp);
+}
+
+static enum entry_type dirent_type(const struct dirent *dir_entry) {
+  /* d_type is a widely supported extension that saves a stat call per entry. Symlinks and file systems that don't
+   * provide it (DT_UNKNOWN) fall back to stat. */
+#ifdef DT_DIR
+  switch (dir_entry->d_type) {
+  case DT_DIR:
+    return ENTRY_DIR;
+  case DT_REG:
+  case DT_FIFO:
+  case DT_CHR:
+    return ENTRY_FILE;
+  default:
+    return ENTRY_UNKNOWN;
+  }
+#else
+  (void) dir_entry;
+  return ENTRY_UNKNOWN;
+#endif
+}
+#endif
+
+static void traverse_dir(struct path_buffer *path, struct input_list *list) {
+#if defined(_WIN32)
+  WIN32_FIND_DATA fd;
+  HANDLE h_find;
+  size_t path_len;
+  enum entry_type type;
+
+  path_len = path->len;
+  path_buffer_push(path, "*");
+  /* FindExInfoBasic skips looking up short names and FIND_FIRST_EX_LARGE_FETCH fetches entries in larger batches, both
+   * of which speed up listing large directories, in particular on network drives. */
+  h_find = FindFirstFileEx(path->str, FindExInfoBasic, &fd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  path_buffer_truncate(path, path_len);
+  if (h_find == INVALID_HANDLE_VALUE) {
+    /* TODO: Include the stringified last error in the message. */
+    fprintf(stderr, "Failed to list files in '%s'\n", path->str);
+    exit(1);
+  }
+  do {
+    if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+      type = ENTRY_UNKNOWN;
+    } else if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      type = ENTRY_DIR;
+    } else {
+      type = ENTRY_FILE;
+    }
+    collect_dir_entry(path, fd.cFileName, type, list);
+  } while (FindNextFile(h_find, &fd) != 0);
+  if (GetLastError() != ERROR_NO_MORE_FILES) {
+    /* TODO: Include the stringified last error in the message. */
+    fprintf(stderr, "Failed to list files in '%s'\n", path->str);
+    exit(1);
+  }
+  FindClose(h_find);
+#else
+  DIR *dir;
+  struct dirent *dir_entry;
+
+  dir = opendir(path->str);
+  if (dir == NULL) {
+    fprintf(stderr, "Failed to open directory '%s': %s\n", path->str, strerror(errno));
+    exit(1);
+  }
+  while ((dir_entry = clear_errno_readdir(dir)) != NULL) {
+    collect_dir_entry(path, dir_entry->d_name, dirent_type(dir_entry), list);
+  }
+  if (errno != 0) {
+    fprintf(stderr, "Failed to list files in '%s': %s\n", path->str, strerror(errno));
+    exit(1);
+  }
+  closedir(dir);
+#endif
+}
+
+static int has_packed_corpus_suffix(const char *path) {
+  size_t len = strlen(path);
+  size_t suffix_len = strlen(PACKED_CORPUS_SUFFIX);
+
+  return len > suffix_len && strcmp(path + len - suffix_len, PACKED_CORPUS_SUFFIX) == 0;
+}
+
+/* Adds all entries of the packed corpus at path as if it were a directory. */
+static void collect_packed_corpus(struct path_buffer *path, struct input_list *list) {
+  struct packed_corpus *corpus;
+  uint32_t i;
+
+  corpus = load_packed_corpus(path->str);
+  for (i = 0; i < corpus->num_entries; i++) {
+    append_input_path(list, packed_entry_path(corpus, i));
+  }
+}
+
+static void collect_path(struct path_buffer *path, enum entry_type type, struct input_list *list) {
+  int res;
+  struct POSIX_STAT stat_info;
+
+  if (type == ENTRY_UNKNOWN) {
+    res = POSIX_STAT(path->str, &stat_info);
+    if (res != 0) {
+      fprintf(stderr, "Failed to access '%s': ", path->str);
+      /* strerror is deprecated in the Microsoft CRT. */
+      perror("");
+      exit(1);
+    }
+    if (stat_info.st_mode & POSIX_S_IFDIR) {
+      type = ENTRY_DIR;
+    } else if (stat_info.st_mode & POSIX_S_IFREG) {
+      type = ENTRY_FILE;
+#if !defined(_WIN32)
+    } else if (S_ISFIFO(stat_info.st_mode) || S_ISCHR(stat_info.st_mode)) {
+      /* Pipes and character devices (e.g. /dev/stdin) can't be mapped and are read via the buffered fallback. */
+      type = ENTRY_FILE;
+#endif
+    } else {
+      fprintf(stderr, "File type of '%s' is unsupported: %d\n", path->str, stat_info.st_mode);
+      exit(1);
+    }
+  }
+  if (type == ENTRY_DIR) {
+    traverse_dir(path, list);
+  } else if (has_packed_corpus_suffix(path->str)) {
+    collect_packed_corpus(path, list);
+  } else {
+    append_input(list, path->str);
+  }
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+static void collect_file_or_dir(const char *path, struct input_list *list) {
+  struct path_buffer path_buf = {NULL, 0, 0};
+  struct packed_corpus *corpus;
+  struct packed_entry entry;
+  const char *name;
+  uint32_t index;
+  size_t first;
+
+  /* A single entry of a packed corpus, e.g. as printed in the reproducer command of a failing input. */
+  if (split_packed_entry_path(path, &corpus, &name)) {
+    index = find_packed_entry(corpus, name, &entry);
+    if (index == 0) {
+      fprintf(stderr, "Failed to find '%s' in packed corpus '%s'\n", name, corpus->path);
+      exit(1);
+    }
+    append_input_path(list, packed_entry_path(corpus, index - 1));
+    return;
+  }
+  first = list->len;
+  path_buffer_append(&path_buf, path, strlen(path));
+  collect_path(&path_buf, ENTRY_UNKNOWN, list);
+  free(path_buf.str);
+  /* Directories are listed in no particular order, so sort the inputs found below path to make the order in which
+   * they run, and thus the assignment of inputs to shards, reproducible. Inputs given as separate arguments still run
+   * in the order of the arguments. */
+  if (list->len > first) {
+    qsort(list->paths + first, list->len - first, sizeof(char*), compare_paths);
+  }
+}
+
+/* Drops all inputs that don't belong to the shard selected with -shard_index and -total_shards. */
+static void select_shard(struct input_list *list) {
+  size_t i;
+  size_t len;
+
+  if (flag_total_shards <= 1) {
+    return;
+  }
+  len = 0;
+  for (i = 0; i < list->len; i++) {
+    if (i % (size_t) flag_total_shards == (size_t) flag_shard_index) {
+      list->paths[len++] = list->paths[i];
+    } else {
+      free_input_path(list->paths[i]);
+    }
+  }
+  list->len = len;
+}
+
+/* The number of inputs skipped with -dedup_inputs=1. */
+static int num_duplicate_inputs = 0;
+
+/* An entry of the open addressing hash table of distinct inputs used by dedup_inputs. */
+struct content_entry {
+  uint32_t hash;
+  size_t size;
+  /* Index into the input list of the first input with these contents, or (size_t) -1 if the slot is empty. */
+  size_t index;
+};
+
+/* Returns a non-zero value if the regular file at path contains exactly the given bytes. */
+static int file_has_contents(const char *path, const unsigned char *data, size_t size) {
+  struct input other;
+  int equal;
+
+  if (map_input(path, &other) != 0) {
+    return 0;
+  }
+  equal = other.size == size && (size == 0 || memcmp(other.data, data, size) == 0);
+  release_input(&other);
+  return equal;
+}
+
+/* Removes inputs with the same contents as an earlier input. Only regular files are considered, since reading pipes
+ * and devices would consume their contents. */
+static void dedup_inputs(struct input_list *list) {
+  struct content_entry *table;
+  struct content_entry *entry;
+  struct input in;
+  size_t capacity;
+  size_t len;
+  size_t i;
+  size_t slot;
+  uint32_t hash;
+  int duplicate;
+
+  capacity = 16;
+  while (capacity < 2 * list->len) {
+    capacity *= 2;
+  }
+  table = (struct content_entry*) malloc(capacity * sizeof(struct content_entry));
+  assert(table != NULL);
+  for (slot = 0; slot < capacity; slot++) {
+    table[slot].index = (size_t) -1;
+  }
+
+  len = 0;
+  for (i = 0; i < list->len; i++) {
+    if (map_input(list->paths[i], &in) != 0) {
+      list->paths[len++] = list->paths[i];
+      continue;
+    }
+    /* Hash collisions are resolved by comparing contents, so a 32-bit hash suffices. */
+    hash = hash_bytes(in.data, in.size, 0);
+    duplicate = 0;
+    for (slot = hash & (capacity - 1); table[slot].index != (size_t) -1; slot = (slot + 1) & (capacity - 1)) {
+      entry = &table[slot];
+      if (entry->hash == hash && entry->size == in.size
+          && file_has_contents(list->paths[entry->index], in.data, in.size)) {
+        duplicate = 1;
+        break;
+      }
+    }
+    release_input(&in);
+    if (duplicate) {
+      free_input_path(list->paths[i]);
+      num_duplicate_inputs++;
+      continue;
+    }
+    table[slot].hash = hash;
+    table[slot].size = in.size;
+    table[slot].index = len;
+    list->paths[len++] = list->paths[i];
+  }
+  list->len = len;
+  free(table);
+}
+
+/* Reads a line of arbitrary length from f and returns it without the trailing newline, or NULL on EOF. */
+static char *read_line(FILE *f) {
+  char *line;
+  char *new_line;
+  size_t len;
+  size_t capacity;
+  int c;
+
+  capacity = 256;
+  len = 0;
+  line = (char*) malloc(capacity);
+  assert(line != NULL);
+  while ((c = fgetc(f)) != EOF && c != '\n') {
+    if (len + 1 == capacity) {
+      capacity *= 2;
+      new_line = (char*) realloc(line, capacity);
+      assert(new_line != NULL);
+      line = new_line;
+    }
+    line[len++] = (char) c;
+  }
+  if (c == EOF && len == 0) {
+    free(line);
+    return NULL;
+  }
+  line[len] = '\0';
+  return line;
+}
+
+/* Identifies the contents of an input in the -pass_cache. Two independently seeded hashes make collisions between
+ * different inputs negligible even for large corpora, since the contents can't be compared. */
+struct content_key {
+  unsigned long size;
+  uint32_t hash1;
+  uint32_t hash2;
+};
+
+static const char *PASS_CACHE_HEADER = "cifuzz-replayer-pass-cache-v1";
+
+/* Inputs recorded as passing in the -pass_cache, sorted with compare_content_keys. */
+static struct content_key *cached_keys = NULL;
+static size_t num_cached_keys = 0;
+/* The keys of the inputs that run in this process, which are added to the -pass_cache if all of them pass. */
+static struct content_key *new_keys = NULL;
+static size_t num_new_keys = 0;
+/* The number of inputs skipped because they are recorded as passing in the -pass_cache. */
+static int num_cached_inputs = 0;
+
+static void compute_content_key(const unsigned char *data, size_t size, struct content_key *key) {
+  key->size = (unsigned long) size;
+  key->hash1 = hash_bytes(data, size, 0);
+  key->hash2 = hash_bytes(data, size, 0x9e3779b9);
+}
+
+static int compare_content_keys(const void *a, const void *b) {
+  const struct content_key *key_a = (const struct content_key*) a;
+  const struct content_key *key_b = (const struct content_key*) b;
+
+  if (key_a->size != key_b->size) {
+    return key_a->size < key_b->size ? -1 : 1;
+  }
+  if (key_a->hash1 != key_b->hash1) {
+    return key_a->hash1 < key_b->hash1 ? -1 : 1;
+  }
+  if (key_a->hash2 != key_b->hash2) {
+    return key_a->hash2 < key_b->hash2 ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Three 32-bit values in hex, two separators and the terminator. */
+#define BUILD_KEY_SIZE (3 * 8 + 3)
+
+/* Returns the path of the executable of the current process as a newly allocated string, or NULL if it can't be
+ * determined. Unlike argv[0], this is also correct if the executable was found via PATH. */
+static char *executable_path(void) {
+#if defined(_WIN32)
+  char *path = NULL;
+  char *new_path;
+  DWORD size = MAX_PATH;
+  DWORD len;
+
+  for (;;) {
+    new_path = (char*) realloc(path, size);
+    assert(new_path != NULL);
+    path = new_path;
+    len = GetModuleFileNameA(NULL, path, size);
+    if (len == 0) {
+      free(path);
+      return NULL;
+    }
+    /* The path is truncated if the buffer is too small. */
+    if (len < size) {
+      return path;
+    }
+    size *= 2;
+  }
+#elif defined(__APPLE__)
+  char *path;
+  uint32_t size = 0;
+
+  /* Fails and sets size to the required buffer size. */
+  _NSGetExecutablePath(NULL, &size);
+  path = (char*) malloc(size);
+  assert(path != NULL);
+  if (_NSGetExecutablePath(path, &size) != 0) {
+    free(path);
+    return NULL;
+  }
+  return path;
+#elif defined(__linux__)
+  /* Opening the link opens the executable, even if it has been replaced or deleted since. */
+  return copy_string("/proc/self/exe");
+#else
+  /* argv[0] only refers to the executable if it wasn't looked up in PATH. */
+  return strchr(argv0, '/') != NULL ? copy_string(argv0) : NULL;
+#endif
+}
+
+/* Returns the key identifying the fuzz test build in the -pass_cache as a newly allocated string, or NULL if it can't
+ * be determined. */
+static char *pass_cache_build_key(void) {
+  struct input binary;
+  struct content_key key;
+  char *binary_path;
+  char *build_key;
+  size_t len;
+  int res;
+
+  if (flag_pass_cache_key != NULL) {
+    return copy_string(flag_pass_cache_key);
+  }
+  binary_path = executable_path();
+  if (binary_path == NULL) {
+    return NULL;
+  }
+  res = map_file(binary_path, &binary);
+  free(binary_path);
+  if (res != 0) {
+    return NULL;
+  }
+  compute_content_key(binary.data, binary.size, &key);
+  release_input(&binary);
+  build_key = (char*) malloc(BUILD_KEY_SIZE);
+  assert(build_key != NULL);
+  format_ulong(build_key, BUILD_KEY_SIZE, "%lx-", key.size & 0xffffffffUL);
+  len = strlen(build_key);
+  format_ulong(build_key + len, BUILD_KEY_SIZE - len, "%lx-", (unsigned long) key.hash1);
+  len = strlen(build_key);
+  format_ulong(build_key + len, BUILD_KEY_SIZE - len, "%lx", (unsigned long) key.hash2);
+  return build_key;
+}
+
+static void append_content_key(struct content_key **keys, size_t *len, size_t *capacity,
+                               const struct content_key *key) {
+  struct content_key *new_keys_buf;
+
+  if (*len == *capacity) {
+    *capacity = *capacity == 0 ? 64 : 2 * *capacity;
+    new_keys_buf = (struct content_key*) realloc(*keys, *capacity * sizeof(struct content_key));
+    assert(new_keys_buf != NULL);
+    *keys = new_keys_buf;
+  }
+  (*keys)[(*len)++] = *key;
+}
+
+static FILE *open_pass_cache(const char *path, const char *mode) {
+  FILE *f;
+
+#ifdef _WIN32
+  /* fopen is deprecated in the Microsoft CRT. */
+  fopen_s(&f, path, mode);
+#else
+  f = fopen(path, mode);
+#endif
+  return f;
+}
+
+/* Loads the -pass_cache if it was written for the same build. A missing or outdated cache is treated as empty. */
+static void load_pass_cache(const char *build_key) {
+  FILE *f;
+  char *line;
+  struct content_key key;
+  unsigned long hash1;
+  unsigned long hash2;
+  size_t capacity = 0;
+  size_t header_len;
+
+  f = open_pass_cache(flag_pass_cache, "r");
+  if (f == NULL) {
+    return;
+  }
+  header_len = strlen(PASS_CACHE_HEADER);
+  line = read_line(f);
+  if (line == NULL || strncmp(line, PASS_CACHE_HEADER, header_len) != 0 || line[header_len] != ' '
+      || strcmp(line + header_len + 1, build_key) != 0) {
+    free(line);
+    fclose(f);
+    return;
+  }
+  free(line);
+  while ((line = read_line(f)) != NULL) {
+    if (sscanf(line, "%lu %lx %lx", &key.size, &hash1, &hash2) == 3) {
+      key.hash1 = (uint32_t) hash1;
+      key.hash2 = (uint32_t) hash2;
+      append_content_key(&cached_keys, &num_cached_keys, &capacity, &key);
+    }
+    free(line);
+  }
+  fclose(f);
+  if (num_cached_keys > 0) {
+    qsort(cached_keys, num_cached_keys, sizeof(struct content_key), compare_content_keys);
+  }
+}
+
+/* Drops the inputs recorded as passing in the -pass_cache and remembers the keys of the others. Inputs that can't be
+ * mapped, such as pipes, are always run and never cached. */
+static void skip_cached_inputs(struct input_list *list, const char *build_key) {
+  struct input in;
+  struct content_key key;
+  size_t capacity = 0;
+  size_t len;
+  size_t i;
+
+  load_pass_cache(build_key);
+  len = 0;
+  for (i = 0; i < list->len; i++) {
+    if (map_input(list->paths[i], &in) != 0) {
+      list->paths[len++] = list->paths[i];
+      continue;
+    }
+    compute_content_key(in.data, in.size, &key);
+    release_input(&in);
+    if (num_cached_keys > 0
+        && bsearch(&key, cached_keys, num_cached_keys, sizeof(struct content_key), compare_content_keys) != NULL) {
+      free_input_path(list->paths[i]);
+      num_cached_inputs++;
+      continue;
+    }
+    append_content_key(&new_keys, &num_new_keys, &capacity, &key);
+    list->paths[len++] = list->paths[i];
+  }
+  list->len = len;
+}
+
+static void write_content_key(FILE *f, const struct content_key *key) {
+  fprintf(f, "%lu %lx %lx\n", key->size, (unsigned long) key->hash1, (unsigned long) key->hash2);
+}
+
+/* Records the previously cached and the newly passed inputs in the -pass_cache. The cache is replaced atomically so
+ * that concurrent or interrupted runs can't leave a truncated file behind. Each process writes to a temporary file of
+ * its own, so that concurrent runs don't write to the same file. */
+static void write_pass_cache(const char *build_key) {
+  FILE *f;
+  char *tmp_path;
+  size_t tmp_path_size;
+  size_t len;
+  size_t i;
+
+  /* ".<pid>.tmp", with the pid taking up to 20 digits. */
+  tmp_path_size = strlen(flag_pass_cache) + 1 + 20 + strlen(".tmp") + 1;
+  tmp_path = (char*) malloc(tmp_path_size);
+  assert(tmp_path != NULL);
+  strcpy(tmp_path, flag_pass_cache);
+  len = strlen(tmp_path);
+  format_ulong(tmp_path + len, tmp_path_size - len, ".%lu.tmp", current_pid());
+  f = open_pass_cache(tmp_path, "w");
+  if (f == NULL) {
+    fprintf(stderr, "WARNING: Failed to write pass cache '%s': ", tmp_path);
+    perror("");
+    free(tmp_path);
+    return;
+  }
+  fprintf(f, "%s %s\n", PASS_CACHE_HEADER, build_key);
+  /* Duplicate inputs result in duplicate keys, which are only written once. */
+  if (num_new_keys > 0) {
+    qsort(new_keys, num_new_keys, sizeof(struct content_key), compare_content_keys);
+  }
+  for (i = 0; i < num_cached_keys; i++) {
+    write_content_key(f, &cached_keys[i]);
+  }
+  for (i = 0; i < num_new_keys; i++) {
+    if (i == 0 || compare_content_keys(&new_keys[i - 1], &new_keys[i]) != 0) {
+      write_content_key(f, &new_keys[i]);
+    }
+  }
+  if (fclose(f) != 0) {
+    fprintf(stderr, "WARNING: Failed to write pass cache '%s'\n", tmp_path);
+    remove(tmp_path);
+    free(tmp_path);
+    return;
+  }
+#ifdef _WIN32
+  /* Unlike on POSIX, rename fails if the destination exists. */
+  remove(flag_pass_cache);
+#endif
+  if (rename(tmp_path, flag_pass_cache) != 0) {
+    fprintf(stderr, "WARNING: Failed to replace pass cache '%s': ", flag_pass_cache);
+    perror("");
+    remove(tmp_path);
+  }
+  free(tmp_path);
+}
+
+/* An input name listed in the -run_first file, ranked by its line. */
+struct run_first_name {
+  char *name;
+  size_t rank;
+};
+
+/* The keys by which order_inputs sorts the inputs. */
+struct input_order_key {
+  char *path;
+  /* The rank of the input in the -run_first file, or (size_t) -1 if it isn't listed there. */
+  size_t run_first_rank;
+  /* The size of the input with -order=size, or (size_t) -1 if it is unknown, e.g. for pipes. */
+  size_t size;
+  /* The position of the input before sorting, which breaks ties so that the order stays reproducible. */
+  size_t index;
+};
+
+static int compare_run_first_names(const void *a, const void *b) {
+  const struct run_first_name *x = (const struct run_first_name*) a;
+  const struct run_first_name *y = (const struct run_first_name*) b;
+  int cmp;
+
+  cmp = strcmp(x->name, y->name);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return x->rank < y->rank ? -1 : x->rank > y->rank;
+}
+
+static int compare_input_order_keys(const void *a, const void *b) {
+  const struct input_order_key *x = (const struct input_order_key*) a;
+  const struct input_order_key *y = (const struct input_order_key*) b;
+
+  if (x->run_first_rank != y->run_first_rank) {
+    return x->run_first_rank < y->run_first_rank ? -1 : 1;
+  }
+  if (x->size != y->size) {
+    return x->size < y->size ? -1 : 1;
+  }
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/* Reads the names listed in the -run_first file, sorted by name for lookups with bsearch. A missing file lists no
+ * names, so that build system integrations can always pass the file of the findings directory. */
+static struct run_first_name *load_run_first_names(size_t *num_names) {
+  struct run_first_name *names = NULL;
+  struct run_first_name *new_names;
+  size_t capacity = 0;
+  size_t len;
+  size_t i;
+  char *line;
+  FILE *f;
+
+  *num_names = 0;
+  f = fopen(flag_run_first, "rb");
+  if (f == NULL) {
+    if (errno != ENOENT) {
+      fprintf(stderr, "WARNING: Failed to open -run_first file '%s': ", flag_run_first);
+      perror("");
+    }
+    return NULL;
+  }
+  while ((line = read_line(f)) != NULL) {
+    len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+      line[--len] = '\0';
+    }
+    if (len == 0) {
+      free(line);
+      continue;
+    }
+    if (*num_names == capacity) {
+      capacity = capacity == 0 ? 64 : 2 * capacity;
+      new_names = (struct run_first_name*) realloc(names, capacity * sizeof(struct run_first_name));
+      assert(new_names != NULL);
+      names = new_names;
+    }
+    names[*num_names].name = line;
+    names[*num_names].rank = *num_names;
+    (*num_names)++;
+  }
+  fclose(f);
+  if (*num_names == 0) {
+    return names;
+  }
+
+  /* Only the first line listing a name counts. */
+  qsort(names, *num_names, sizeof(struct run_first_name), compare_run_first_names);
+  len = 1;
+  for (i = 1; i < *num_names; i++) {
+    if (strcmp(names[len - 1].name, names[i].name) == 0) {
+      free(names[i].name);
+    } else {
+      names[len++] = names[i];
+    }
+  }
+  *num_names = len;
+  return names;
+}
+
+static int compare_name_with_run_first_name(const void *name, const void *entry) {
+  return strcmp((const char*) name, ((const struct run_first_name*) entry)->name);
+}
+
+/* Returns the file name of the input at path, which is the entry name for entries of packed corpora. */
+static const char *input_file_name(const char *path) {
+  const char *base;
+  const char *p;
+
+  base = path;
+  for (p = path; *p != '\0'; p++) {
+    if (*p == '/' || *p == PATH_SEPARATOR) {
+      base = p + 1;
+    }
+  }
+  return base;
+}
+
+/* Returns the rank of the input in the -run_first file, in which it can be listed by its path or its file name. */
+static size_t run_first_rank(const struct run_first_name *names, size_t num_names, const char *path) {
+  const struct run_first_name *found;
+  const char *base;
+
+  found = (const struct run_first_name*) bsearch(path, names, num_names, sizeof(struct run_first_name),
+                                                 compare_name_with_run_first_name);
+  base = input_file_name(path);
+  if (found == NULL && base != path) {
+    found = (const struct run_first_name*) bsearch(base, names, num_names, sizeof(struct run_first_name),
+                                                   compare_name_with_run_first_name);
+  }
+  return found == NULL ? (size_t) -1 : found->rank;
+}
+
+/* Returns the size of the input without reading it, or (size_t) -1 if it isn't a regular file or a packed corpus
+ * entry. */
+static size_t input_size_on_disk(const char *path) {
+  struct POSIX_STAT stat_info;
+  struct packed_corpus *corpus;
+  struct packed_entry entry;
+
+  if (lookup_packed_input(path, &corpus, &entry)) {
+    return (size_t) entry.payload_size;
+  }
+  if (POSIX_STAT(path, &stat_info) != 0 || !(stat_info.st_mode & POSIX_S_IFREG)) {
+    return (size_t) -1;
+  }
+  return (size_t) stat_info.st_size;
+}
+
+/* Moves the inputs listed in the -run_first file to the front, in the order in which they are listed, and sorts the
+ * others by ascending size with -order=size, so that a regression shows up early when the replayer stops at the first
+ * failing input. Inputs that compare equal keep their order. */
+static void order_inputs(struct input_list *list) {
+  struct run_first_name *names = NULL;
+  struct input_order_key *keys;
+  size_t num_names = 0;
+  size_t i;
+  int by_size;
+
+  by_size = strcmp(flag_order, "size") == 0;
+  if (flag_run_first != NULL) {
+    names = load_run_first_names(&num_names);
+  }
+  if ((!by_size && num_names == 0) || list->len <= 1) {
+    for (i = 0; i < num_names; i++) {
+      free(names[i].name);
+    }
+    free(names);
+    return;
+  }
+
+  keys = (struct input_order_key*) malloc(list->len * sizeof(struct input_order_key));
+  assert(keys != NULL);
+  for (i = 0; i < list->len; i++) {
+    keys[i].path = list->paths[i];
+    keys[i].run_first_rank = num_names > 0 ? run_first_rank(names, num_names, list->paths[i]) : (size_t) -1;
+    keys[i].size = by_size ? input_size_on_disk(list->paths[i]) : 0;
+    keys[i].index = i;
+  }
+  qsort(keys, list->len, sizeof(struct input_order_key), compare_input_order_keys);
+  for (i = 0; i < list->len; i++) {
+    list->paths[i] = keys[i].path;
+  }
+  free(keys);
+  for (i = 0; i < num_names; i++) {
+    free(names[i].name);
+  }
+  free(names);
+}
+
+/* The number of inputs skipped with -impact_map because they don't cover any of the -changed_files. */
+static int num_unaffected_inputs = 0;
+
+/* Appends the non-empty lines of the file at path to list. */
+static void read_lines_into_list(const char *path, struct input_list *list) {
+  char *line;
+  size_t len;
+  FILE *f;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to open '%s': ", path);
+    perror("");
+    exit(1);
+  }
+  while ((line = read_line(f)) != NULL) {
+    len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+      line[--len] = '\0';
+    }
+    if (len > 0) {
+      append_input(list, line);
+    }
+    free(line);
+  }
+  fclose(f);
+}
+
+static int sorted_list_contains(const struct input_list *list, const char *str) {
+  return list->len > 0 && bsearch(&str, list->paths, list->len, sizeof(char*), compare_paths) != NULL;
+}
+
+/* Returns a non-zero value if the input is listed in the sorted list by its path or its file name. */
+static int sorted_list_contains_input(const struct input_list *list, const char *path) {
+  return sorted_list_contains(list, path) || sorted_list_contains(list, input_file_name(path));
+}
+
+/* Drops the inputs that are listed in the -impact_map, but don't cover any of the -changed_files, except for a sample
+ * of -impact_sample_percent percent of them. */
+static void select_affected_inputs(struct input_list *list) {
+  struct input_list changed = {NULL, 0, 0};
+  struct input_list known = {NULL, 0, 0};
+  struct input_list affected = {NULL, 0, 0};
+  const char *name;
+  char *line;
+  char *file;
+  char *tab;
+  size_t len;
+  size_t i;
+  uint32_t seed;
+  int is_affected;
+  FILE *f;
+
+  read_lines_into_list(flag_changed_files, &changed);
+  qsort(changed.paths, changed.len, sizeof(char*), compare_paths);
+  seed = 0;
+  for (i = 0; i < changed.len; i++) {
+    seed = hash_bytes((const unsigned char*) changed.paths[i], strlen(changed.paths[i]), seed);
+  }
+
+  f = fopen(flag_impact_map, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to open -impact_map file '%s': ", flag_impact_map);
+    perror("");
+    exit(1);
+  }
+  while ((line = read_line(f)) != NULL) {
+    len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') {
+      line[--len] = '\0';
+    }
+    tab = strchr(line, '\t');
+    if (len == 0 || line[0] == '#' || tab == NULL) {
+      free(line);
+      continue;
+    }
+    *tab = '\0';
+    is_affected = 0;
+    for (file = tab + 1; file != NULL && !is_affected; file = tab == NULL ? NULL : tab + 1) {
+      tab = strchr(file, '\t');
+      if (tab != NULL) {
+        *tab = '\0';
+      }
+      is_affected = sorted_list_contains(&changed, file);
+    }
+    append_input(&known, line);
+    if (is_affected) {
+      append_input(&affected, line);
+    }
+    free(line);
+  }
+  fclose(f);
+  qsort(known.paths, known.len, sizeof(char*), compare_paths);
+  qsort(affected.paths, affected.len, sizeof(char*), compare_paths);
+
+  len = 0;
+  for (i = 0; i < list->len; i++) {
+    name = input_file_name(list->paths[i]);
+    if (!sorted_list_contains_input(&known, list->paths[i])
+        || sorted_list_contains_input(&affected, list->paths[i])
+        || hash_bytes((const unsigned char*) name, strlen(name), seed) % 100 < (uint32_t) flag_impact_sample_percent) {
+      list->paths[len++] = list->paths[i];
+    } else {
+      free_input_path(list->paths[i]);
+      num_unaffected_inputs++;
+    }
+  }
+  list->len = len;
+  free_input_list(&changed);
+  free_input_list(&known);
+  free_input_list(&affected);
+}
+
+/* The stream replies are written to with -server=1. */
+static FILE *server_reply_stream = NULL;
+
+#if !defined(_WIN32)
+/* The state shared with the thread started by -read_ahead. The thread only reads the files into the page cache instead
+ * of into buffers handed to the main thread, so that the inputs are still mapped by run_file and ASan keeps catching
+ * reads beyond them. Both positions count the inputs of the slice, i.e. in steps of stride. */
+struct read_ahead {
+  const struct input_list *list;
+  size_t first;
+  size_t stride;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  /* The next input the thread reads and the input the main thread runs. */
+  size_t next_read;
+  size_t next_run;
+  int stop;
+};
+
+static void read_ahead_file(const char *path) {
+  /* Only used by the single read-ahead thread. */
+  static char discard_buf[64 * 1024];
+  struct packed_corpus *corpus;
+  struct packed_entry entry;
+  uint32_t index;
+  size_t page;
+  size_t start;
+  int fd;
+
+  /* Entries of packed corpora are already mapped, so only ask the kernel to page in their payload. This only reads the
+   * packed corpora loaded while collecting the inputs, which aren't modified while inputs run. */
+  if (find_entry_of_packed_path(path, &corpus, &index)) {
+    read_packed_entry(corpus, index, &entry);
+    if (entry.payload_size > 0) {
+      page = page_size();
+      start = entry.payload_offset - entry.payload_offset % page;
+      madvise((void*) (corpus->file.data + start), entry.payload_offset + entry.payload_size - start, MADV_WILLNEED);
+    }
+    return;
+  }
+  fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return;
+  }
+  while (read(fd, discard_buf, sizeof(discard_buf)) > 0) {
+  }
+  close(fd);
+}
+
+static void *read_ahead_main(void *arg) {
+  struct read_ahead *ra = (struct read_ahead*) arg;
+  size_t index;
+
+  pthread_mutex_lock(&ra->mutex);
+  for (;;) {
+    while (!ra->stop && ra->next_read > ra->next_run + (size_t) flag_read_ahead) {
+      pthread_cond_wait(&ra->cond, &ra->mutex);
+    }
+    /* Skip the inputs the main thread already got to, it has read them itself. */
+    if (ra->next_read <= ra->next_run) {
+      ra->next_read = ra->next_run + 1;
+    }
+    index = ra->first + ra->next_read * ra->stride;
+    if (ra->stop || index >= ra->list->len) {
+      break;
+    }
+    ra->next_read++;
+    pthread_mutex_unlock(&ra->mutex);
+    read_ahead_file(ra->list->paths[index]);
+    pthread_mutex_lock(&ra->mutex);
+  }
+  pthread_mutex_unlock(&ra->mutex);
+  return NULL;
+}
+
+/* Starts reading ahead of the inputs of the slice and returns a non-zero value, or returns zero if there is nothing to
+ * read ahead. */
+static int start_read_ahead(struct read_ahead *ra, const struct input_list *list, size_t first, size_t stride) {
+  sigset_t all_signals;
+  sigset_t old_signals;
+  int err;
+
+  if (flag_read_ahead <= 0 || first + stride >= list->len) {
+    return 0;
+  }
+  ra->list = list;
+  ra->first = first;
+  ra->stride = stride;
+  ra->next_read = 1;
+  ra->next_run = 0;
+  ra->stop = 0;
+  pthread_mutex_init(&ra->mutex, NULL);
+  pthread_cond_init(&ra->cond, NULL);
+  /* The thread inherits the blocked signals, so that the watchdog's SIGALRM and the terminating signals
+   * are always delivered to the thread running the fuzz test. */
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+  err = pthread_create(&ra->thread, NULL, read_ahead_main, ra);
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+  if (err != 0) {
+    fprintf(stderr, "WARNING: Failed to start thread for -read_ahead: %s\n", strerror(err));
+    pthread_cond_destroy(&ra->cond);
+    pthread_mutex_destroy(&ra->mutex);
+    return 0;
+  }
+  return 1;
+}
+
+/* Called by the main thread before it runs the input at position next_run of the slice. */
+static void advance_read_ahead(struct read_ahead *ra, size_t next_run) {
+  pthread_mutex_lock(&ra->mutex);
+  ra->next_run = next_run;
+  pthread_cond_signal(&ra->cond);
+  pthread_mutex_unlock(&ra->mutex);
+}
+
+static void stop_read_ahead(struct read_ahead *ra) {
+  pthread_mutex_lock(&ra->mutex);
+  ra->stop = 1;
+  pthread_cond_signal(&ra->cond);
+  pthread_mutex_unlock(&ra->mutex);
+  pthread_join(ra->thread, NULL);
+  pthread_cond_destroy(&ra->cond);
+  pthread_mutex_destroy(&ra->mutex);
+}
+#endif
+
+/* Runs the inputs with indices first, first + stride, first + 2 * stride, ... */
+static void run_input_slice(const struct input_list *list, size_t first, size_t stride) {
+  size_t i;
+#if !defined(_WIN32)
+  struct read_ahead ra;
+  int reading_ahead = start_read_ahead(&ra, list, first, stride);
+#endif
+
+  for (i = first; i < list->len; i += stride) {
+#if !defined(_WIN32)
+    if (reading_ahead) {
+      advance_read_ahead(&ra, (i - first) / stride);
+    }
+#endif
+    run_file(list->paths[i]);
+  }
+#if !defined(_WIN32)
+  if (reading_ahead) {
+    stop_read_ahead(&ra);
+  }
+#endif
+}
+
+#if !defined(_WIN32)
+/* The write end of the pipe to the parent if this process is a worker forked with -jobs. Workers report their result
+ * through it instead of printing a summary. */
+static FILE *worker_result_pipe = NULL;
+
+/* Set in the parent if a worker failed. */
+static const char *worker_failure_reason = NULL;
+
+/* Discards the timing recorded so far, e.g. the timing a forked worker inherited from its parent. */
+static void reset_timing(void) {
+  int i;
+
+  num_timed_inputs = 0;
+  total_input_seconds = 0;
+  max_input_seconds = 0;
+  memset(latency_histogram, 0, sizeof(latency_histogram));
+  for (i = 0; i < num_slowest_inputs; i++) {
+    free(slowest_inputs[i].path);
+  }
+  num_slowest_inputs = 0;
+}
+
+static void report_timing_to_parent(void) {
+  int i;
+
+  fprintf(worker_result_pipe, "%d %.9f %.9f %d\n", num_timed_inputs, total_input_seconds, max_input_seconds,
+          num_slowest_inputs);
+  for (i = 0; i < NUM_LATENCY_BUCKETS; i++) {
+    fprintf(worker_result_pipe, "%d%c", latency_histogram[i], i == NUM_LATENCY_BUCKETS - 1 ? '\n' : ' ');
+  }
+  for (i = 0; i < num_slowest_inputs; i++) {
+    fprintf(worker_result_pipe, "%.9f %lu %s\n", slowest_inputs[i].seconds, (unsigned long) slowest_inputs[i].size,
+            slowest_inputs[i].path);
+  }
+}
+
+/* Sends the information the parent needs to print the summary in place of this worker. */
+static void report_to_parent(const char *failure_reason) {
+  fprintf(worker_result_pipe, "%d %d %d\n%s\n%s\n", num_passing_inputs, all_inputs_passed, in_user_callback,
+          failure_reason != NULL ? failure_reason : "", current_input != NULL ? current_input : "");
+  report_timing_to_parent();
+  fflush(worker_result_pipe);
+}
+
+/* The result a worker reported through its pipe. */
+struct worker_result {
+  int num_passing_inputs;
+  int all_inputs_passed;
+  int in_user_callback;
+  char *failure_reason;
+  char *failing_input;
+};
+
+/* Returns a non-zero value if the worker reported a result before exiting. */
+static int read_worker_result(FILE *f, struct worker_result *result) {
+  char *line;
+  int num_fields;
+
+  line = read_line(f);
+  if (line == NULL) {
+    return 0;
+  }
+  num_fields = sscanf(line, "%d %d %d", &result->num_passing_inputs, &result->all_inputs_passed,
+                      &result->in_user_callback);
+  free(line);
+  if (num_fields != 3) {
+    return 0;
+  }
+  result->failure_reason = read_line(f);
+  result->failing_input = read_line(f);
+  return result->failure_reason != NULL && result->failing_input != NULL;
+}
+
+/* Adds the timing reported by a worker after its result to the timing of this process. */
+static void merge_worker_timing(FILE *f) {
+  char *line;
+  char *pos;
+  char *end;
+  int num_inputs;
+  double total;
+  double max;
+  int num_slow;
+  double seconds;
+  unsigned long size;
+  int i;
+
+  line = read_line(f);
+  if (line == NULL) {
+    return;
+  }
+  if (sscanf(line, "%d %lf %lf %d", &num_inputs, &total, &max, &num_slow) == 4) {
+    num_timed_inputs += num_inputs;
+    total_input_seconds += total;
+    if (max > max_input_seconds) {
+      max_input_seconds = max;
+    }
+  } else {
+    num_slow = 0;
+  }
+  free(line);
+  line = read_line(f);
+  if (line == NULL) {
+    return;
+  }
+  pos = line;
+  for (i = 0; i < NUM_LATENCY_BUCKETS; i++) {
+    latency_histogram[i] += (int) strtol(pos, &end, 10);
+    pos = end;
+  }
+  free(line);
+  for (i = 0; i < num_slow && (line = read_line(f)) != NULL; i++) {
+    seconds = strtod(line, &end);
+    size = strtoul(end, &pos, 10);
+    if (*pos == ' ') {
+      record_slow_input(pos + 1, (size_t) size, seconds);
+    }
+    free(line);
+  }
+}
+
+#define COLOR_RED "\x1b[31m"
+#define COLOR_YELLOW "\x1b[93m"
+#define COLOR_RESET "\x1b[0m"
+
+/* Forks a worker that inherits the state set up by LLVMFuzzerInitialize. Returns 0 in the worker, which reports its
+ * result through a pipe via print_summary, and the pid of the worker in the parent, which reads the result from
+ * *result_pipe. */
+static pid_t fork_worker(int number, FILE **result_pipe) {
+  int fds[2];
+  pid_t pid;
+
+  if (pipe(fds) != 0) {
+    perror("Failed to create pipe");
+    exit(1);
+  }
+  /* Prevent output buffered so far from being emitted by every worker. */
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  if (pid < 0) {
+    perror("Failed to fork worker");
+    exit(1);
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    worker_result_pipe = fdopen(fds[1], "w");
+    assert(worker_result_pipe != NULL);
+    num_passing_inputs = 0;
+    worker_number = number;
+    reset_timing();
+    return 0;
+  }
+  close(fds[1]);
+  *result_pipe = fdopen(fds[0], "r");
+  assert(*result_pipe != NULL);
+  return pid;
+}
+
+/* Waits for any of the given workers to exit and returns its index. Exited workers are marked by a pid of 0. */
+static int wait_for_worker(pid_t *pids, int num_workers, int *status) {
+  pid_t pid;
+  int i;
+
+  for (;;) {
+    pid = waitpid(-1, status, 0);
+    if (pid < 0) {
+      perror("Failed to wait for worker");
+      exit(1);
+    }
+    for (i = 0; i < num_workers; i++) {
+      if (pids[i] == pid) {
+        pids[i] = 0;
+        return i;
+      }
+    }
+    /* Not one of our workers, e.g. a process forked by the fuzz test. */
+  }
+}
+
+/* Reads the result of an exited worker and closes its pipe. The timing the worker reported is only merged into that of
+ * this process if merge_timing is non-zero. Returns zero if the worker exited without reporting a result, in which
+ * case a result is derived from its exit status. */
+static int collect_worker_result(FILE *result_pipe, int status, int merge_timing, struct worker_result *result) {
+  int reported;
+
+  reported = read_worker_result(result_pipe, result);
+  if (!reported) {
+    result->num_passing_inputs = 0;
+    result->all_inputs_passed = 0;
+    result->in_user_callback = 0;
+    result->failure_reason = copy_string(WIFSIGNALED(status) ? strsignal(WTERMSIG(status)) : "Worker exited");
+    result->failing_input = copy_string("");
+  } else if (merge_timing) {
+    merge_worker_timing(result_pipe);
+  }
+  fclose(result_pipe);
+  return reported;
+}
+
+static int worker_passed(const struct worker_result *result, int status) {
+  return result->all_inputs_passed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int worker_exit_code(int status) {
+  int exit_code;
+
+  exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  return exit_code != 0 ? exit_code : 1;
+}
+
+static void free_worker_result(struct worker_result *result) {
+  free(result->failure_reason);
+  free(result->failing_input);
+}
+
+/* The absolute path of -gcov_shard_dir. Every worker writes its .gcda files below a directory of its own in it, named
+ * after the worker's index, by pointing GCOV_PREFIX there. */
+static char *gcov_shard_root = NULL;
+/* The GCOV_PREFIX the replayer was started with, if any, which the shards are merged into. */
+static char *gcov_target_prefix = NULL;
+
+#ifdef CIFUZZ_HAS_GCOV
+static void init_gcov_shard_root(void) {
+  const char *prefix;
+
+  if (mkdir(flag_gcov_shard_dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Failed to create -gcov_shard_dir '%s': %s\n", flag_gcov_shard_dir, strerror(errno));
+    exit(1);
+  }
+  /* The fuzz test may change the working directory, which a relative GCOV_PREFIX is resolved against. */
+  gcov_shard_root = realpath(flag_gcov_shard_dir, NULL);
+  if (gcov_shard_root == NULL) {
+    fprintf(stderr, "Failed to resolve -gcov_shard_dir '%s': %s\n", flag_gcov_shard_dir, strerror(errno));
+    exit(1);
+  }
+  prefix = getenv("GCOV_PREFIX");
+  if (prefix != NULL && prefix[0] != '\0') {
+    gcov_target_prefix = copy_string(prefix);
+  }
+}
+#endif
+
+/* Called in a forked worker to make it write its gcov counters to the shard with the given index. */
+static void start_gcov_shard(int index) {
+  struct path_buffer prefix = {NULL, 0, 0};
+  char index_str[24];
+
+  if (gcov_shard_root == NULL) {
+    return;
+  }
+  path_buffer_append(&prefix, gcov_shard_root, strlen(gcov_shard_root));
+  format_ulong(index_str, sizeof(index_str), "%lu", (unsigned long) index);
+  path_buffer_push(&prefix, index_str);
+  setenv("GCOV_PREFIX", prefix.str, 1);
+  free(prefix.str);
+  /* GCOV_PREFIX_STRIP only applies together with GCOV_PREFIX, so the shards have to mirror the unstripped paths if
+   * the replayer was started without the latter. */
+  if (gcov_target_prefix == NULL) {
+    unsetenv("GCOV_PREFIX_STRIP");
+  }
+#ifdef CIFUZZ_HAS_GCOV
+  /* Drop the counters inherited from the parent, e.g. those of LLVMFuzzerInitialize, which the parent writes itself
+   * at exit. Otherwise, they would be counted once per worker. */
+  __gcov_reset();
+#endif
+  gcov_shard_active = 1;
+  num_inputs_since_gcov_flush = 0;
+}
+
+/* Record tags of the gcov data format, see gcc/gcov-io.h. */
+static const uint32_t GCDA_MAGIC = 0x67636461;
+static const uint32_t GCDA_TAG_FUNCTION = 0x01000000;
+static const uint32_t GCDA_TAG_ARCS = 0x01a10000;
+static const uint32_t GCDA_TAG_OBJECT_SUMMARY = 0xa1000000;
+static const uint32_t GCDA_TAG_PROGRAM_SUMMARY = 0xa3000000;
+
+/* A .gcda file read into memory. All values are 32-bit words in the byte order of the machine that wrote it, 64-bit
+ * counters are stored as their low word followed by their high word. */
+struct gcda_file {
+  unsigned char *data;
+  size_t size;
+  /* The magic, version and stamp words, followed by a checksum as of gcc 12. */
+  size_t header_size;
+  /* Non-zero if the lengths of records are given in bytes (as of gcc 12) rather than in words. */
+  int byte_lengths;
+};
+
+/* A record of a .gcda file: a tag word, a length word and the payload. */
+struct gcda_record {
+  uint32_t tag;
+  size_t offset;
+  size_t payload_size;
+  /* The number of counters of an arcs record. gcc 12 and later omit the payload if all of them are zero. */
+  size_t num_counters;
+};
+
+static uint32_t gcda_word(const struct gcda_file *file, size_t offset) {
+  uint32_t word;
+
+  memcpy(&word, file->data + offset, sizeof(word));
+  return word;
+}
+
+static void put_gcda_word(unsigned char *out, size_t *size, uint32_t word) {
+  memcpy(out + *size, &word, sizeof(word));
+  *size += sizeof(word);
+}
+
+/* Validates the header of file and determines the layout of its records from the version. Returns zero if file isn't
+ * a .gcda file written on a machine with the same byte order. */
+static int parse_gcda_header(struct gcda_file *file) {
+  uint32_t version;
+  unsigned int c3;
+  unsigned int c2;
+  unsigned int c1;
+  unsigned int gcov_version;
+  uint32_t word;
+
+  if (file->size < 12 || gcda_word(file, 0) != GCDA_MAGIC) {
+    return 0;
+  }
+  /* The version consists of the characters of e.g. "408*" (gcc 4.8) or "B22*" (gcc 12.2), most significant first. */
+  version = gcda_word(file, 4);
+  c3 = (version >> 24) & 0xff;
+  c2 = (version >> 16) & 0xff;
+  c1 = (version >> 8) & 0xff;
+  gcov_version = c3 >= 'A' ? (c3 - 'A') * 100 + (c2 - '0') * 10 + c1 - '0' : (c3 - '0') * 10 + c1 - '0';
+  file->byte_lengths = gcov_version >= 120;
+  file->header_size = 12;
+  /* gcc 12 added a checksum to the header, which clang doesn't write for the same version. Every file that contains
+   * records starts with a summary or a function record. */
+  if (file->size >= 16) {
+    word = gcda_word(file, 12);
+    if (word != GCDA_TAG_OBJECT_SUMMARY && word != GCDA_TAG_PROGRAM_SUMMARY && word != GCDA_TAG_FUNCTION) {
+      file->header_size = 16;
+    }
+  }
+  return 1;
+}
+
+/* Reads the record at *offset and advances the offset past it. Returns zero if the file ends or is malformed. */
+static int read_gcda_record(const struct gcda_file *file, size_t *offset, struct gcda_record *record) {
+  uint32_t length;
+
+  if (*offset + 8 > file->size) {
+    return 0;
+  }
+  record->tag = gcda_word(file, *offset);
+  length = gcda_word(file, *offset + 4);
+  record->offset = *offset;
+  if (record->tag == GCDA_TAG_ARCS && file->byte_lengths && (length & 0x80000000) != 0) {
+    /* A negative length marks counters that are all zero. */
+    record->payload_size = 0;
+    record->num_counters = (size_t) (0 - length) / 8;
+  } else {
+    record->payload_size = file->byte_lengths ? (size_t) length : 4 * (size_t) length;
+    record->num_counters = record->payload_size / 8;
+  }
+  if (record->payload_size > file->size - *offset - 8) {
+    return 0;
+  }
+  *offset += 8 + record->payload_size;
+  return 1;
+}
+
+static void copy_gcda_record(const struct gcda_file *file, const struct gcda_record *record, unsigned char *out,
+                             size_t *size) {
+  memcpy(out + *size, file->data + record->offset, 8 + record->payload_size);
+  *size += 8 + record->payload_size;
+}
+
+/* Adds the word at offset of both records, if they have a payload, and the carry of the previous word. */
+static uint32_t add_gcda_words(const struct gcda_file *a, const struct gcda_record *ra, const struct gcda_file *b,
+                               const struct gcda_record *rb, size_t offset, uint32_t *carry) {
+  uint32_t x;
+  uint32_t y;
+  uint32_t sum;
+
+  x = ra->payload_size > 0 ? gcda_word(a, ra->offset + 8 + offset) : 0;
+  y = rb->payload_size > 0 ? gcda_word(b, rb->offset + 8 + offset) : 0;
+  sum = x + y + *carry;
+  *carry = sum < x || (sum == x && *carry != 0) ? 1 : 0;
+  return sum;
+}
+
+/* Merges the counters of src into those of dst like libgcov merges the counters of a process into an existing .gcda
+ * file: Arc counters are summed up, the number of runs is summed up and the largest counter of a run is the maximum of
+ * both. Other records are kept as they are in dst. The merged file is written to out, which has to be large enough to
+ * hold both files. Returns its size, or 0 if the files don't belong to the same build of the object file. */
+static size_t merge_gcda(const struct gcda_file *dst, const struct gcda_file *src, unsigned char *out) {
+  struct gcda_record a;
+  struct gcda_record b;
+  size_t dst_offset;
+  size_t src_offset;
+  size_t size;
+  size_t i;
+  uint32_t carry;
+  uint32_t runs;
+  uint32_t src_sum_max;
+
+  if (dst->header_size != src->header_size || memcmp(dst->data, src->data, dst->header_size) != 0) {
+    return 0;
+  }
+  memcpy(out, dst->data, dst->header_size);
+  size = dst->header_size;
+  dst_offset = dst->header_size;
+  src_offset = src->header_size;
+  /* gcc terminates the records with a zero word, which clang doesn't write. */
+  while (dst_offset + 8 <= dst->size && src_offset + 8 <= src->size) {
+    if (!read_gcda_record(dst, &dst_offset, &a) || !read_gcda_record(src, &src_offset, &b) || a.tag != b.tag) {
+      return 0;
+    }
+    if (a.tag == GCDA_TAG_ARCS) {
+      if (a.num_counters != b.num_counters) {
+        return 0;
+      }
+      if (a.payload_size == 0 && b.payload_size == 0) {
+        copy_gcda_record(dst, &a, out, &size);
+        continue;
+      }
+      put_gcda_word(out, &size, a.tag);
+      put_gcda_word(out, &size, (uint32_t) (dst->byte_lengths ? 8 * a.num_counters : 2 * a.num_counters));
+      for (i = 0; i < a.num_counters; i++) {
+        carry = 0;
+        put_gcda_word(out, &size, add_gcda_words(dst, &a, src, &b, 8 * i, &carry));
+        put_gcda_word(out, &size, add_gcda_words(dst, &a, src, &b, 8 * i + 4, &carry));
+      }
+    } else if (a.tag == GCDA_TAG_OBJECT_SUMMARY && a.payload_size == 8 && b.payload_size == 8) {
+      runs = gcda_word(dst, a.offset + 8) + gcda_word(src, b.offset + 8);
+      src_sum_max = gcda_word(src, b.offset + 12);
+      put_gcda_word(out, &size, a.tag);
+      put_gcda_word(out, &size, gcda_word(dst, a.offset + 4));
+      put_gcda_word(out, &size, runs);
+      put_gcda_word(out, &size, gcda_word(dst, a.offset + 12) > src_sum_max ? gcda_word(dst, a.offset + 12)
+                                                                            : src_sum_max);
+    } else {
+      if (a.payload_size != b.payload_size) {
+        return 0;
+      }
+      copy_gcda_record(dst, &a, out, &size);
+    }
+  }
+  if (dst->size - dst_offset != src->size - src_offset) {
+    return 0;
+  }
+  memcpy(out + size, dst->data + dst_offset, dst->size - dst_offset);
+  return size + dst->size - dst_offset;
+}
+
+/* Creates the missing parent directories of path, like libgcov does for the .gcda files it writes. */
+static void create_parent_dirs(const char *path) {
+  char *dir;
+  char *sep;
+
+  dir = copy_string(path);
+  for (sep = strchr(dir + 1, '/'); sep != NULL; sep = strchr(sep + 1, '/')) {
+    *sep = '\0';
+    mkdir(dir, 0755);
+    *sep = '/';
+  }
+  free(dir);
+}
+
+/* Merges the .gcda file at src_path into the one at dst_path, which is created if it doesn't exist. The file is locked
+ * like libgcov locks it, so that other processes writing it concurrently don't lose their counters. Returns a non-zero
+ * value on success. */
+static int merge_gcda_file(const char *src_path, const char *dst_path) {
+  struct gcda_file src = {NULL, 0, 0, 0};
+  struct gcda_file dst = {NULL, 0, 0, 0};
+  size_t capacity;
+  unsigned char *merged = NULL;
+  size_t merged_size = 0;
+  struct flock lock;
+  FILE *f;
+  int fd;
+  int ok;
+
+  f = fopen(src_path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "WARNING: Failed to open '%s': %s\n", src_path, strerror(errno));
+    return 0;
+  }
+  capacity = 0;
+  src.size = read_until_eof(f, &src.data, &capacity);
+  fclose(f);
+  if (!parse_gcda_header(&src)) {
+    fprintf(stderr, "WARNING: '%s' is not a .gcda file\n", src_path);
+    free(src.data);
+    return 0;
+  }
+
+  create_parent_dirs(dst_path);
+  fd = open(dst_path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "WARNING: Failed to open '%s': %s\n", dst_path, strerror(errno));
+    free(src.data);
+    return 0;
+  }
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  while (fcntl(fd, F_SETLKW, &lock) != 0 && errno == EINTR) {
+  }
+  f = fdopen(fd, "r+b");
+  assert(f != NULL);
+  capacity = 0;
+  dst.size = read_until_eof(f, &dst.data, &capacity);
+  if (dst.size > 0 && parse_gcda_header(&dst)) {
+    merged = (unsigned char*) malloc(dst.size + src.size);
+    assert(merged != NULL);
+    merged_size = merge_gcda(&dst, &src, merged);
+  }
+  if (merged_size == 0) {
+    /* Like libgcov, replace the counters of a different build of the object file. */
+    if (dst.size > 0) {
+      fprintf(stderr, "WARNING: Overwriting '%s', which belongs to a different build\n", dst_path);
+    }
+    free(merged);
+    merged = src.data;
+    merged_size = src.size;
+    src.data = NULL;
+  }
+  ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(merged, 1, merged_size, f) == merged_size && fflush(f) == 0
+       && ftruncate(fd, (off_t) merged_size) == 0;
+  if (!ok) {
+    fprintf(stderr, "WARNING: Failed to write '%s': %s\n", dst_path, strerror(errno));
+  }
+  /* Also releases the lock. */
+  fclose(f);
+  free(merged);
+  free(src.data);
+  free(dst.data);
+  return ok;
+}
+
+static int has_gcda_suffix(const char *path) {
+  size_t len = strlen(path);
+
+  return len > 5 && strcmp(path + len - 5, ".gcda") == 0;
+}
+
+/* Adds the .gcda files below path to list. Unlike traverse_dir, this includes hidden directories such as
+ * .cifuzz-build. */
+static void collect_gcda_files(struct path_buffer *path, struct input_list *list) {
+  DIR *dir;
+  struct dirent *dir_entry;
+  struct stat stat_info;
+  enum entry_type type;
+  size_t path_len;
+
+  dir = opendir(path->str);
+  if (dir == NULL) {
+    return;
+  }
+  path_len = path->len;
+  while ((dir_entry = readdir(dir)) != NULL) {
+    if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+      continue;
+    }
+    path_buffer_push(path, dir_entry->d_name);
+    type = dirent_type(dir_entry);
+    if (type == ENTRY_UNKNOWN && stat(path->str, &stat_info) == 0) {
+      type = S_ISDIR(stat_info.st_mode) ? ENTRY_DIR : ENTRY_FILE;
+    }
+    if (type == ENTRY_DIR) {
+      collect_gcda_files(path, list);
+    } else if (has_gcda_suffix(path->str)) {
+      append_input(list, path->str);
+    }
+    path_buffer_truncate(path, path_len);
+  }
+  closedir(dir);
+}
+
+/* Removes the directories below path that are left empty after merging the shards. */
+static void remove_empty_dirs(struct path_buffer *path) {
+  DIR *dir;
+  struct dirent *dir_entry;
+  size_t path_len;
+
+  dir = opendir(path->str);
+  if (dir == NULL) {
+    return;
+  }
+  path_len = path->len;
+  while ((dir_entry = readdir(dir)) != NULL) {
+    if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+      continue;
+    }
+    path_buffer_push(path, dir_entry->d_name);
+    if (dirent_type(dir_entry) != ENTRY_FILE) {
+      remove_empty_dirs(path);
+      /* Fails if the directory isn't empty or not a directory at all. */
+      rmdir(path->str);
+    }
+    path_buffer_truncate(path, path_len);
+  }
+  closedir(dir);
+}
+
+/* Returns the path of a .gcda file in a shard relative to the directory of the shard, which is the path the file has
+ * below GCOV_PREFIX. It starts with a separator, or is empty for files that aren't in a shard. */
+static const char *gcda_shard_relative_path(const char *path) {
+  const char *relative_path;
+
+  if (gcov_shard_root == NULL) {
+    return "";
+  }
+  relative_path = strchr(path + strlen(gcov_shard_root) + 1, '/');
+  return relative_path != NULL ? relative_path : "";
+}
+
+static int compare_gcda_shard_paths(const void *a, const void *b) {
+  const char *path_a = *(char* const*) a;
+  const char *path_b = *(char* const*) b;
+  int res;
+
+  res = strcmp(gcda_shard_relative_path(path_a), gcda_shard_relative_path(path_b));
+  return res != 0 ? res : strcmp(path_a, path_b);
+}
+
+/* Merges the shards of the .gcda files with indices first, first + stride, first + 2 * stride, ... into the .gcda
+ * files of the build and deletes them. files is sorted by compare_gcda_shard_paths, so that the shards of a .gcda file
+ * are adjacent and always merged by the same process. Returns the number of shards that failed to merge. */
+static int merge_gcda_shards(const struct input_list *files, size_t first, size_t stride) {
+  struct path_buffer target = {NULL, 0, 0};
+  const char *relative_path;
+  size_t prefix_len = 0;
+  size_t file_index = 0;
+  size_t i;
+  int num_failed = 0;
+
+  if (gcov_target_prefix != NULL) {
+    prefix_len = strlen(gcov_target_prefix);
+    path_buffer_append(&target, gcov_target_prefix, prefix_len);
+  }
+  for (i = 0; i < files->len; i++) {
+    relative_path = gcda_shard_relative_path(files->paths[i]);
+    if (i > 0 && strcmp(relative_path, gcda_shard_relative_path(files->paths[i - 1])) != 0) {
+      file_index++;
+    }
+    if (relative_path[0] == '\0' || file_index % stride != first) {
+      continue;
+    }
+    path_buffer_append(&target, relative_path, strlen(relative_path));
+    if (merge_gcda_file(files->paths[i], target.str)) {
+      unlink(files->paths[i]);
+    } else {
+      num_failed++;
+    }
+    path_buffer_truncate(&target, prefix_len);
+  }
+  free(target.str);
+  return num_failed;
+}
+
+/* Merges the shards written by the workers with -gcov_shard_dir into the .gcda files of the build once all workers
+ * exited. The .gcda files are distributed across up to flag_jobs processes. Shards left behind by an interrupted run
+ * are merged as well. */
+static void merge_gcov_shards(void) {
+  struct path_buffer path = {NULL, 0, 0};
+  struct input_list files = {NULL, 0, 0};
+  pid_t *pids;
+  pid_t pid;
+  size_t num_files;
+  size_t i;
+  int num_mergers;
+  int status;
+  int failed = 0;
+
+  if (gcov_shard_root == NULL || gcov_shard_active) {
+    return;
+  }
+  path_buffer_append(&path, gcov_shard_root, strlen(gcov_shard_root));
+  collect_gcda_files(&path, &files);
+  qsort(files.paths, files.len, sizeof(char*), compare_gcda_shard_paths);
+  num_files = 0;
+  for (i = 0; i < files.len; i++) {
+    if (i == 0 || strcmp(gcda_shard_relative_path(files.paths[i]), gcda_shard_relative_path(files.paths[i - 1]))) {
+      num_files++;
+    }
+  }
+
+  num_mergers = (size_t) flag_jobs < num_files ? flag_jobs : (int) num_files;
+  if (num_mergers <= 1) {
+    failed = merge_gcda_shards(&files, 0, 1) > 0;
+  } else {
+    pids = (pid_t*) malloc((size_t) num_mergers * sizeof(pid_t));
+    assert(pids != NULL);
+    fflush(stdout);
+    fflush(stderr);
+    for (i = 0; i < (size_t) num_mergers; i++) {
+      pids[i] = fork();
+      if (pids[i] < 0) {
+        perror("Failed to fork gcov merge process");
+        exit(1);
+      }
+      if (pids[i] == 0) {
+        /* Skip the exit handler, which would print a summary, and libgcov, which would write the counters this
+         * process inherited. */
+        _exit(merge_gcda_shards(&files, i, (size_t) num_mergers) > 0 ? 1 : 0);
+      }
+    }
+    for (i = 0; i < (size_t) num_mergers; i++) {
+      while ((pid = waitpid(pids[i], &status, 0)) < 0 && errno == EINTR) {
+      }
+      if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        failed = 1;
+      }
+    }
+    free(pids);
+  }
+
+  remove_empty_dirs(&path);
+  if (failed) {
+    fprintf(stderr, "WARNING: Failed to merge all .gcda files in '%s', the remaining ones are merged by the next run"
+                    " with the same -gcov_shard_dir\n", flag_gcov_shard_dir);
+  }
+  free_input_list(&files);
+  free(path.str);
+}
+
+/* The number of workers run_inputs_in_workers forks for the given inputs. */
+static int num_workers_for(const struct input_list *list) {
+  return (size_t) flag_jobs > list->len ? (int) list->len : flag_jobs;
+}
+
+/* Forks flag_jobs workers and distributes the inputs across them round-robin by calling run_slice, e.g.
+ * run_input_slice, in each. The first failing worker stops all others, and its result is reported via print_summary as
+ * if the input had been run in this process. */
+static void run_inputs_in_workers(const struct input_list *list,
+                                  void (*run_slice)(const struct input_list *list, size_t first, size_t stride)) {
+  pid_t *pids;
+  FILE **result_pipes;
+  struct worker_result result;
+  int num_workers;
+  int num_running;
+  int status;
+  int i;
+  int failed = 0;
+  int failure_exit_code = 0;
+
+  num_workers = num_workers_for(list);
+  pids = (pid_t*) malloc((size_t) num_workers * sizeof(pid_t));
+  assert(pids != NULL);
+  result_pipes = (FILE**) malloc((size_t) num_workers * sizeof(FILE*));
+  assert(result_pipes != NULL);
+
+  for (i = 0; i < num_workers; i++) {
+    pids[i] = fork_worker(i + 1, &result_pipes[i]);
+    if (pids[i] == 0) {
+      start_gcov_shard(i);
+      run_slice(list, (size_t) i, (size_t) num_workers);
+      all_inputs_passed = 1;
+      /* Reports the result to the parent via the exit handler. */
+      exit(0);
+    }
+  }
+
+  for (num_running = num_workers; num_running > 0; num_running--) {
+    i = wait_for_worker(pids, num_workers, &status);
+    collect_worker_result(result_pipes[i], status, !failed, &result);
+    if (failed) {
+      /* Results of workers we stopped after the first failure are not meaningful. */
+      free_worker_result(&result);
+      continue;
+    }
+    num_passing_inputs += result.num_passing_inputs;
+    if (worker_passed(&result, status)) {
+      free_worker_result(&result);
+      continue;
+    }
+
+    failed = 1;
+    failure_exit_code = worker_exit_code(status);
+    in_user_callback = result.in_user_callback;
+    worker_failure_reason = result.failure_reason;
+    current_input = result.failing_input[0] != '\0' ? result.failing_input : NULL;
+    for (i = 0; i < num_workers; i++) {
+      if (pids[i] != 0) {
+        kill(pids[i], SIGKILL);
+      }
+    }
+  }
+  free(pids);
+  free(result_pipes);
+  merge_gcov_shards();
+  if (failed) {
+    /* Prints the summary with the failure reported by the worker via the exit handler. */
+    exit(failure_exit_code);
+  }
+}
+
+/* Serializes record_input_timing across the threads of -threads. */
+static pthread_mutex_t timing_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* The inputs run with -threads. */
+static const struct input_list *replay_thread_inputs = NULL;
+
+static void log_thread_input_done(struct replay_thread *thread, const char *name, size_t size) {
+  if (!flag_quiet) {
+    log_input_done(name, size);
+    return;
+  }
+  /* Like log_progress, but per thread. */
+  if (thread->num_passing_inputs < thread->next_progress_line) {
+    return;
+  }
+  while (thread->next_progress_line <= thread->num_passing_inputs) {
+    thread->next_progress_line *= 2;
+  }
+  fprintf(stderr, "#%d\tinputs passed in thread %d\n", thread->num_passing_inputs, thread->number);
+}
+
+/* Like run_file, but records the state of the input in the given thread instead of the globals. */
+static void run_file_on_thread(struct replay_thread *thread, const char *path) {
+  struct input in;
+  double start;
+  int res;
+
+  log_input_started(path);
+  load_input(path, &in);
+  thread->current_input = path;
+  start = now_seconds();
+  thread->input_start_seconds = start;
+  thread->in_user_callback = 1;
+  res = LLVMFuzzerTestOneInput(in.data, in.size);
+  /* Avoid "unused but set variable" warnings if asserts are compiled out with NDEBUG. */
+  (void)res;
+  assert(res == 0);
+  if (watchdog_enabled) {
+    check_rss_limit();
+  }
+  thread->in_user_callback = 0;
+  thread->num_passing_inputs++;
+  if (timing_enabled) {
+    pthread_mutex_lock(&timing_mutex);
+    record_input_timing(path, in.size, now_seconds() - start);
+    pthread_mutex_unlock(&timing_mutex);
+  }
+  thread->current_input = NULL;
+  log_thread_input_done(thread, path, in.size);
+  release_input(&in);
+}
+
+/* Stores the index of the next input the thread should run in *index and returns a non-zero value, or returns 0 if all
+ * inputs have been taken. Once its own range is exhausted, the thread steals the second half of the remaining range of
+ * the next thread that has any left, which keeps the inputs a thread runs mostly contiguous. */
+static int next_thread_input(struct replay_thread *thread, size_t *index) {
+  struct replay_thread *victim;
+  size_t remaining;
+  size_t stolen_first = 0;
+  size_t stolen_end = 0;
+  int i;
+
+  pthread_mutex_lock(&thread->mutex);
+  if (thread->next < thread->end) {
+    *index = thread->next++;
+    pthread_mutex_unlock(&thread->mutex);
+    return 1;
+  }
+  pthread_mutex_unlock(&thread->mutex);
+
+  for (i = 1; i < num_replay_threads && stolen_end == 0; i++) {
+    victim = &replay_threads[(thread->number - 1 + i) % num_replay_threads];
+    pthread_mutex_lock(&victim->mutex);
+    remaining = victim->end - victim->next;
+    if (remaining > 0) {
+      stolen_end = victim->end;
+      stolen_first = stolen_end - (remaining + 1) / 2;
+      victim->end = stolen_first;
+    }
+    pthread_mutex_unlock(&victim->mutex);
+  }
+  if (stolen_end == 0) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&thread->mutex);
+  *index = stolen_first;
+  thread->next = stolen_first + 1;
+  thread->end = stolen_end;
+  pthread_mutex_unlock(&thread->mutex);
+  return 1;
+}
+
+static void *replay_thread_main(void *arg) {
+  struct replay_thread *thread;
+  size_t index;
+
+  thread = (struct replay_thread*) arg;
+  this_replay_thread = thread;
+  while (next_thread_input(thread, &index)) {
+    run_file_on_thread(thread, replay_thread_inputs->paths[index]);
+  }
+  return NULL;
+}
+
+/* Runs the inputs on flag_threads threads of this process, which share the state set up by LLVMFuzzerInitialize. Every
+ * thread starts with a contiguous range of the inputs and steals from the others when done, see next_thread_input. The
+ * first failing input terminates the process, and print_summary reports it as if it had been run on the main thread. */
+static void run_inputs_in_threads(const struct input_list *list) {
+  struct replay_thread *threads;
+  pthread_attr_t attr;
+  struct rlimit stack_limit;
+  int num_threads;
+  int err;
+  int i;
+
+  num_threads = (size_t) flag_threads > list->len ? (int) list->len : flag_threads;
+  threads = (struct replay_thread*) calloc((size_t) num_threads, sizeof(struct replay_thread));
+  assert(threads != NULL);
+  for (i = 0; i < num_threads; i++) {
+    threads[i].number = i + 1;
+    threads[i].next = list->len * (size_t) i / (size_t) num_threads;
+    threads[i].end = list->len * (size_t) (i + 1) / (size_t) num_threads;
+    threads[i].next_progress_line = 1;
+    pthread_mutex_init(&threads[i].mutex, NULL);
+  }
+
+  /* Give the threads the stack size of the main thread, which fuzz tests with deep recursion may rely on. glibc already
+   * does so by default, but e.g. musl and macOS use much smaller stacks for threads. */
+  pthread_attr_init(&attr);
+  if (getrlimit(RLIMIT_STACK, &stack_limit) == 0 && stack_limit.rlim_cur != RLIM_INFINITY) {
+    pthread_attr_setstacksize(&attr, (size_t) stack_limit.rlim_cur);
+  }
+
+  replay_thread_inputs = list;
+  if (watchdog_enabled) {
+    start_watchdog();
+  }
+  /* Published before the threads start, so that the watchdog and print_summary see all of them. */
+  num_replay_threads = num_threads;
+  replay_threads = threads;
+  for (i = 0; i < num_threads; i++) {
+    err = pthread_create(&threads[i].thread, &attr, replay_thread_main, &threads[i]);
+    if (err != 0) {
+      fprintf(stderr, "Failed to start thread for -threads: %s\n", strerror(err));
+      exit(1);
+    }
+  }
+  pthread_attr_destroy(&attr);
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(threads[i].thread, NULL);
+  }
+}
+
+/* Called by print_summary while the inputs are run with -threads. Only the first thread to fail prints the summary,
+ * any other one blocks until the process terminates, so that its reason doesn't end up in the summary of the first
+ * one. Adds up the passing inputs of all threads and takes the state of the failing input from the thread it ran on. */
+static void claim_thread_summary(void) {
+  struct replay_thread *failing_thread;
+  int i;
+
+  if (__sync_lock_test_and_set(&thread_summary_claimed, 1)) {
+    for (;;) {
+      pause();
+    }
+  }
+  for (i = 0; i < num_replay_threads; i++) {
+    num_passing_inputs += replay_threads[i].num_passing_inputs;
+  }
+  failing_thread = watchdog_failing_thread != NULL ? watchdog_failing_thread : this_replay_thread;
+  if (failing_thread != NULL) {
+    in_user_callback = failing_thread->in_user_callback;
+    current_input = failing_thread->current_input;
+  }
+}
+
+/* A failing input recorded with -keep_going=1. */
+struct failure {
+  char *input;
+  char *reason;
+};
+
+static struct failure *failures = NULL;
+static int num_failures = 0;
+/* The exit code of the first failing child, which the replayer exits with after all inputs have run. */
+static int first_failure_exit_code = 0;
+
+static void record_failure(const char *input, const char *reason, int status) {
+  struct failure *new_failures;
+
+  new_failures = (struct failure*) realloc(failures, (size_t) (num_failures + 1) * sizeof(struct failure));
+  assert(new_failures != NULL);
+  failures = new_failures;
+  failures[num_failures].input = copy_string(input);
+  failures[num_failures].reason = copy_string(reason[0] != '\0' ? reason : "Unknown");
+  if (num_failures == 0) {
+    first_failure_exit_code = worker_exit_code(status);
+  }
+  num_failures++;
+}
+
+/* Runs the given inputs in a child forked by fork_worker and reports the result to the parent. */
+static void run_in_isolated_child(char *const *paths, size_t num_paths) {
+  size_t i;
+
+  running_isolated = 1;
+  for (i = 0; i < num_paths; i++) {
+    run_file(paths[i]);
+  }
+  all_inputs_passed = 1;
+  /* libgcov writes the counters from an exit handler, which is skipped below. */
+  if (gcov_shard_active) {
+    dump_gcov_counters();
+  }
+  print_summary(NULL);
+  fflush(stdout);
+  fflush(stderr);
+  /* Skip the exit handler, which would report a second time, and the teardown of stdio, which could reset the offset
+   * of a stdin shared with the parent. */
+  _exit(0);
+}
+
+/* The range of inputs a -keep_going child slot still has to run. */
+struct isolated_batch {
+  size_t first;
+  size_t end;
+  /* Set after a child died without reporting which of its inputs failed, so that the culprit is found by running the
+   * remaining inputs of the batch one per child. */
+  int one_per_child;
+  /* The end of the inputs passed to the currently running child. */
+  size_t child_end;
+};
+
+/* Runs the inputs in child processes forked from this process after LLVMFuzzerInitialize, so that it serves as a fork
+ * server and the setup cost is only paid once. Every child runs a batch of up to flag_inputs_per_fork consecutive
+ * inputs, with up to flag_jobs children running at a time. Failing inputs are recorded instead of ending the run,
+ * the rest of a failing child's batch is run by a new child, and all failures are reported together via print_summary
+ * once all inputs have run. */
+static void run_inputs_isolated(const struct input_list *list) {
+  pid_t *pids;
+  FILE **result_pipes;
+  struct isolated_batch *batches;
+  struct isolated_batch *batch;
+  struct worker_result result;
+  int num_slots;
+  int num_running;
+  int status;
+  int i;
+  size_t batch_size;
+  int reported;
+  size_t next_input;
+  size_t failing_input;
+
+  num_slots = flag_jobs > 1 ? flag_jobs : 1;
+  batch_size = flag_inputs_per_fork > 1 ? (size_t) flag_inputs_per_fork : 1;
+  pids = (pid_t*) calloc((size_t) num_slots, sizeof(pid_t));
+  assert(pids != NULL);
+  result_pipes = (FILE**) malloc((size_t) num_slots * sizeof(FILE*));
+  assert(result_pipes != NULL);
+  batches = (struct isolated_batch*) calloc((size_t) num_slots, sizeof(struct isolated_batch));
+  assert(batches != NULL);
+
+  next_input = 0;
+  num_running = 0;
+  for (;;) {
+    for (i = 0; i < num_slots; i++) {
+      batch = &batches[i];
+      if (pids[i] != 0) {
+        continue;
+      }
+      if (batch->first == batch->end) {
+        if (next_input == list->len) {
+          continue;
+        }
+        batch->first = next_input;
+        batch->end = next_input + batch_size < list->len ? next_input + batch_size : list->len;
+        batch->one_per_child = 0;
+        next_input = batch->end;
+      }
+      batch->child_end = batch->one_per_child ? batch->first + 1 : batch->end;
+      pids[i] = fork_worker(0, &result_pipes[i]);
+      if (pids[i] == 0) {
+        /* The children of a slot run one after the other, so they can share a shard. */
+        start_gcov_shard(i);
+        run_in_isolated_child(list->paths + batch->first, batch->child_end - batch->first);
+      }
+      num_running++;
+    }
+    if (num_running == 0) {
+      break;
+    }
+
+    i = wait_for_worker(pids, num_slots, &status);
+    num_running--;
+    batch = &batches[i];
+    reported = collect_worker_result(result_pipes[i], status, 1, &result);
+    num_passing_inputs += result.num_passing_inputs;
+    log_progress();
+    if (worker_passed(&result, status)) {
+      batch->first = batch->child_end;
+    } else if ((reported && (size_t) result.num_passing_inputs < batch->child_end - batch->first)
+               || batch->child_end - batch->first == 1) {
+      /* Inputs run in order, so the number of passing inputs identifies the failing one. */
+      failing_input = batch->first + (size_t) result.num_passing_inputs;
+      record_failure(list->paths[failing_input], result.failure_reason, status);
+      batch->first = failing_input + 1;
+    } else {
+      batch->one_per_child = 1;
+    }
+    free_worker_result(&result);
+  }
+  free(pids);
+  free(result_pipes);
+  free(batches);
+  merge_gcov_shards();
+  if (num_failures > 0) {
+    /* Prints all failures via the exit handler. */
+    exit(first_failure_exit_code);
+  }
+}
+
+/* Runs a single input received with -server=1 in a forked child and replies with its result. */
+static void run_server_input_isolated(char *path) {
+  pid_t pid;
+  FILE *result_pipe;
+  struct worker_result result;
+  int status;
+
+  pid = fork_worker(0, &result_pipe);
+  if (pid == 0) {
+    start_gcov_shard(0);
+    run_in_isolated_child(&path, 1);
+  }
+  wait_for_worker(&pid, 1, &status);
+  collect_worker_result(result_pipe, status, 1, &result);
+  num_passing_inputs += result.num_passing_inputs;
+  if (worker_passed(&result, status)) {
+    fprintf(server_reply_stream, "PASS\t%s\n", path);
+  } else {
+    record_failure(path, result.failure_reason, status);
+    fprintf(server_reply_stream, "FAIL\t%s\t%s\n", failures[num_failures - 1].reason, path);
+  }
+  fflush(server_reply_stream);
+  free_worker_result(&result);
+}
+
+static void print_failures(void) {
+  int i;
+
+  fprintf(stderr, COLOR_RED "\nFuzz test failed on %d inputs, %d inputs passed\n" COLOR_RESET, num_failures,
+          num_passing_inputs);
+  for (i = 0; i < num_failures; i++) {
+    fprintf(stderr, COLOR_RED "  '%s'\n      Reason: %s\n" COLOR_RESET, failures[i].input, failures[i].reason);
+  }
+  fprintf(stderr, "\n");
+  /* TODO: Replace with cifuzz debug on all platforms when it has been implemented. */
+#ifdef __linux__
+  fprintf(stderr, "To debug the first failure, execute:\n\n"
+                  "    gdb -ex 'break LLVMFuzzerTestOneInput' -ex run --args '%s' '%s'\n\n", argv0, failures[0].input);
+#endif
+}
+#endif
+
+static void init_gcov_shards(void) {
+  if (flag_gcov_flush_inputs > 0 && flag_gcov_shard_dir == NULL) {
+    fprintf(stderr, "-gcov_flush_inputs requires -gcov_shard_dir\n");
+    exit(1);
+  }
+  if (flag_gcov_shard_dir == NULL) {
+    return;
+  }
+#if defined(CIFUZZ_HAS_GCOV) && !defined(_WIN32)
+  init_gcov_shard_root();
+#else
+  fprintf(stderr, "-gcov_shard_dir requires a gcov build (CIFUZZ_SANITIZERS=gcov) and isn't supported on Windows\n");
+  exit(1);
+#endif
+}
+
+/* LeakSanitizer's default exit code, which the replayer exits with if -leak_check_inputs finds a leak. */
+#define LEAK_EXIT_CODE 23
+
+/* Exits if -leak_check_inputs can't be used in this build or with the other options. */
+static void check_leak_check_flag(void) {
+  const char *conflicting_flag = NULL;
+
+  if (flag_leak_check_inputs <= 0) {
+    return;
+  }
+#if defined(_WIN32)
+  fprintf(stderr, "WARNING: -leak_check_inputs is not supported on Windows, leaks are only checked at exit\n");
+  flag_leak_check_inputs = 0;
+  (void) conflicting_flag;
+#elif !defined(CIFUZZ_HAS_LEAK_CHECK)
+  fprintf(stderr, "-leak_check_inputs requires an ASan build\n");
+  (void) conflicting_flag;
+  exit(1);
+#else
+  if (flag_threads > 1) {
+    conflicting_flag = "-threads";
+  } else if (flag_keep_going) {
+    conflicting_flag = "-keep_going";
+  } else if (flag_server) {
+    conflicting_flag = "-server";
+  } else if (flag_stream_inputs != NULL) {
+    conflicting_flag = "-stream_inputs";
+  }
+  if (conflicting_flag != NULL) {
+    fprintf(stderr, "-leak_check_inputs can't be combined with %s\n", conflicting_flag);
+    exit(1);
+  }
+#endif
+}
+
+#ifdef CIFUZZ_HAS_LEAK_CHECK
+/* Checks for leaks without printing LeakSanitizer's report, which is only printed for the input that leaked. */
+static int quiet_leak_check(void) {
+  int saved_stderr;
+  int devnull;
+  int leaked;
+
+  fflush(stderr);
+  saved_stderr = dup(STDERR_FILENO);
+  devnull = open("/dev/null", O_WRONLY);
+  if (saved_stderr >= 0 && devnull >= 0) {
+    dup2(devnull, STDERR_FILENO);
+  }
+  leaked = __lsan_do_recoverable_leak_check();
+  if (saved_stderr >= 0 && devnull >= 0) {
+    dup2(saved_stderr, STDERR_FILENO);
+  }
+  if (saved_stderr >= 0) {
+    close(saved_stderr);
+  }
+  if (devnull >= 0) {
+    close(devnull);
+  }
+  return leaked;
+}
+
+/* Forks a copy of this process that keeps its current state for bisect_leak. The copy waits until the parent writes
+ * to the pipe returned in *command_fd, in which case fork_leak_snapshot returns 0 in the copy, or closes it, in which
+ * case the copy exits. Leaked memory is still unreachable after a leak check, so only a copy forked before the inputs
+ * that leaked can tell which of them leaked. */
+static pid_t fork_leak_snapshot(int *command_fd) {
+  int fds[2];
+  pid_t pid;
+  char command;
+
+  if (pipe(fds) != 0) {
+    fprintf(stderr, "Failed to create a pipe for -leak_check_inputs: %s\n", strerror(errno));
+    exit(1);
+  }
+  /* Don't let the copy print the output buffered so far once more. */
+  fflush(stdout);
+  fflush(stderr);
+  pid = fork();
+  if (pid < 0) {
+    fprintf(stderr, "Failed to fork for -leak_check_inputs: %s\n", strerror(errno));
+    exit(1);
+  }
+  if (pid == 0) {
+    close(fds[1]);
+    if (read(fds[0], &command, 1) != 1) {
+      _exit(0);
+    }
+    close(fds[0]);
+    return 0;
+  }
+  close(fds[0]);
+  *command_fd = fds[1];
+  return pid;
+}
+
+/* Lets the copy forked by fork_leak_snapshot continue if bisect is non-zero or exit otherwise, and returns the exit
+ * code to exit with if it failed. */
+static int finish_leak_snapshot(pid_t pid, int command_fd, int bisect) {
+  char command = 'b';
+  int status;
+
+  if (bisect && write(command_fd, &command, 1) != 1) {
+    fprintf(stderr, "Failed to resume the copy forked for -leak_check_inputs: %s\n", strerror(errno));
+  }
+  close(command_fd);
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      fprintf(stderr, "Failed to wait for the copy forked for -leak_check_inputs: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+  return worker_exit_code(status);
+}
+
+/* Finds the input that leaked out of those at the indices [lo, hi) of the slice, which leaked when they were run in
+ * this order from the current state of the process. Never returns. */
+static void bisect_leak(const struct input_list *list, size_t first, size_t stride, size_t lo, size_t hi) {
+  size_t mid;
+  size_t i;
+  pid_t snapshot;
+  int command_fd;
+  const char *path;
+
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+    snapshot = fork_leak_snapshot(&command_fd);
+    if (snapshot == 0) {
+      /* Resumed if the first half leaked. */
+      hi = mid;
+      continue;
+    }
+    for (i = lo; i < mid; i++) {
+      run_file(list->paths[first + i * stride]);
+    }
+    if (quiet_leak_check()) {
+      _exit(finish_leak_snapshot(snapshot, command_fd, 1));
+    }
+    finish_leak_snapshot(snapshot, command_fd, 0);
+    lo = mid;
+  }
+
+  path = list->paths[first + lo * stride];
+  run_file(path);
+  current_input = path;
+  in_user_callback = 1;
+  /* Prints LeakSanitizer's report for this input only. */
+  if (__lsan_do_recoverable_leak_check()) {
+    print_summary("Memory leak");
+  } else {
+    print_summary("Memory leak, which this input only reproduces after the inputs before it");
+  }
+  fflush(stderr);
+  _exit(LEAK_EXIT_CODE);
+}
+
+/* Runs the inputs like run_input_slice, but checks for leaks every -leak_check_inputs inputs. The inputs aren't read
+ * ahead, so that no other thread runs while the process is forked. */
+static void run_input_slice_with_leak_checks(const struct input_list *list, size_t first, size_t stride) {
+  size_t num_inputs;
+  size_t lo;
+  size_t hi;
+  size_t i;
+  pid_t snapshot;
+  int command_fd;
+
+  num_inputs = first < list->len ? (list->len - first + stride - 1) / stride : 0;
+  for (lo = 0; lo < num_inputs; lo = hi) {
+    hi = num_inputs - lo > (size_t) flag_leak_check_inputs ? lo + (size_t) flag_leak_check_inputs : num_inputs;
+    snapshot = fork_leak_snapshot(&command_fd);
+    if (snapshot == 0) {
+      bisect_leak(list, first, stride, lo, hi);
+    }
+    for (i = lo; i < hi; i++) {
+      run_file(list->paths[first + i * stride]);
+    }
+    if (quiet_leak_check()) {
+      fprintf(stderr, "Found a memory leak in inputs %lu to %lu, running them again to find the input that leaked\n",
+              (unsigned long) lo + 1, (unsigned long) hi);
+      _exit(finish_leak_snapshot(snapshot, command_fd, 1));
+    }
+    finish_leak_snapshot(snapshot, command_fd, 0);
+  }
+}
+
+/* Runs the inputs with -leak_check_inputs, after checking that nothing leaked before them. */
+static void run_inputs_with_leak_checks(const struct input_list *list) {
+  if (quiet_leak_check()) {
+    /* Prints LeakSanitizer's report. */
+    __lsan_do_recoverable_leak_check();
+    fprintf(stderr, COLOR_RED "\nFound a memory leak before the first input, e.g. in LLVMFuzzerInitialize\n\n"
+            COLOR_RESET);
+    fflush(stderr);
+    _exit(LEAK_EXIT_CODE);
+  }
+  if (flag_jobs > 1 && list->len > 1) {
+    run_inputs_in_workers(list, run_input_slice_with_leak_checks);
+    return;
+  }
+  run_input_slice_with_leak_checks(list, 0, 1);
+}
+#endif
+
+static void run_inputs(const struct input_list *list) {
+#ifdef CIFUZZ_HAS_LEAK_CHECK
+  if (flag_leak_check_inputs > 0) {
+    run_inputs_with_leak_checks(list);
+    return;
+  }
+#endif
+#if !defined(_WIN32)
+  if (flag_threads > 1 && list->len > 1) {
+    run_inputs_in_threads(list);
+    return;
+  }
+#endif
+  if (flag_keep_going) {
+#if defined(_WIN32)
+    fprintf(stderr, "WARNING: -keep_going is not supported on Windows, stopping at the first failing input\n");
+#else
+    run_inputs_isolated(list);
+    return;
+#endif
+  }
+  if (flag_jobs > 1 && list->len > 1) {
+#if defined(_WIN32)
+    fprintf(stderr, "WARNING: -jobs is not supported on Windows, running inputs sequentially\n");
+#else
+    run_inputs_in_workers(list, run_input_slice);
+    return;
+#endif
+  }
+  run_input_slice(list, 0, 1);
+}
+
+/* The coverage of an input collected with -minimize_to or -coverage_report: the indices of the coverage counters it
+ * hit. */
+struct input_coverage {
+  size_t size;
+  uint32_t *counters;
+  uint32_t num_counters;
+};
+
+/* One file per worker (or one in total when running sequentially) that the coverage of the inputs is written to. */
+static FILE **coverage_files = NULL;
+
+static uint32_t *coverage_counters = NULL;
+static uint32_t num_coverage_counters = 0;
+
+/* Runs the inputs like run_input_slice, but writes the counters hit by each input to the coverage file of this
+ * process as a record of the input index, its size, the number of counters and their indices. */
+static void collect_coverage_slice(const struct input_list *list, size_t first, size_t stride) {
+  FILE *f;
+  uint32_t *hit;
+  uint32_t header[3];
+  uint32_t num_hit;
+  uint32_t c;
+  size_t i;
+
+  f = coverage_files[worker_number > 0 ? worker_number - 1 : 0];
+  hit = (uint32_t*) malloc(((size_t) num_coverage_counters + 1) * sizeof(uint32_t));
+  assert(hit != NULL);
+  for (i = first; i < list->len; i += stride) {
+    /* Also clears the coverage of LLVMFuzzerInitialize and the previous input. */
+    memset(coverage_counters, 0, (size_t) num_coverage_counters * 8);
+    header[1] = (uint32_t) run_file(list->paths[i]);
+    num_hit = 0;
+    for (c = 0; c < num_coverage_counters; c++) {
+      /* Avoids 64-bit types, which aren't available in C90. */
+      if ((coverage_counters[2 * c] | coverage_counters[2 * c + 1]) != 0) {
+        hit[num_hit++] = c;
+      }
+    }
+    header[0] = (uint32_t) i;
+    header[2] = num_hit;
+    if (fwrite(header, sizeof(uint32_t), 3, f) != 3 || fwrite(hit, sizeof(uint32_t), num_hit, f) != num_hit) {
+      perror("Failed to write coverage");
+      exit(1);
+    }
+  }
+  free(hit);
+}
+
+static void read_coverage(FILE *f, struct input_coverage *coverage, size_t num_inputs) {
+  uint32_t header[3];
+
+  if (fflush(f) != 0 || fseek(f, 0, SEEK_SET) != 0) {
+    perror("Failed to read coverage");
+    exit(1);
+  }
+  while (fread(header, sizeof(uint32_t), 3, f) == 3) {
+    if (header[0] >= num_inputs || header[2] > num_coverage_counters) {
+      fprintf(stderr, "Failed to read coverage: invalid record\n");
+      exit(1);
+    }
+    coverage[header[0]].size = header[1];
+    coverage[header[0]].num_counters = header[2];
+    coverage[header[0]].counters = (uint32_t*) malloc(((size_t) header[2] + 1) * sizeof(uint32_t));
+    assert(coverage[header[0]].counters != NULL);
+    if (fread(coverage[header[0]].counters, sizeof(uint32_t), header[2], f) != header[2]) {
+      fprintf(stderr, "Failed to read coverage: truncated record\n");
+      exit(1);
+    }
+  }
+  fclose(f);
+}
+
+/* A candidate of the greedy set cover. gain is an upper bound on the number of counters it hits that aren't covered
+ * yet, which only ever decreases. */
+struct cover_candidate {
+  size_t input;
+  uint32_t gain;
+};
+
+/* Orders candidates by decreasing gain, preferring smaller and then earlier inputs, so that the result is
+ * reproducible. */
+static int is_better_candidate(const struct cover_candidate *a, const struct cover_candidate *b,
+                               const struct input_coverage *coverage) {
+  if (a->gain != b->gain) {
+    return a->gain > b->gain;
+  }
+  if (coverage[a->input].size != coverage[b->input].size) {
+    return coverage[a->input].size < coverage[b->input].size;
+  }
+  return a->input < b->input;
+}
+
+/* Restores the max-heap property of heap below index i. */
+static void sift_down(struct cover_candidate *heap, size_t len, size_t i, const struct input_coverage *coverage) {
+  struct cover_candidate tmp;
+  size_t best;
+  size_t child;
+
+  for (;;) {
+    best = i;
+    for (child = 2 * i + 1; child <= 2 * i + 2 && child < len; child++) {
+      if (is_better_candidate(&heap[child], &heap[best], coverage)) {
+        best = child;
+      }
+    }
+    if (best == i) {
+      return;
+    }
+    tmp = heap[i];
+    heap[i] = heap[best];
+    heap[best] = tmp;
+    i = best;
+  }
+}
+
+/* Marks the inputs that together hit all counters any input hits with a non-zero value in selected. This is the greedy
+ * approximation of the minimal set cover, with the gains of candidates updated lazily: A candidate whose updated gain
+ * is still at least the bound of the next best one is the best candidate. Returns the number of covered counters. */
+static uint32_t select_covering_inputs(const struct input_coverage *coverage, size_t num_inputs,
+                                       unsigned char *selected) {
+  struct cover_candidate *heap;
+  unsigned char *covered;
+  size_t len;
+  size_t i;
+  uint32_t c;
+  uint32_t gain;
+  uint32_t num_covered = 0;
+
+  heap = (struct cover_candidate*) malloc((num_inputs + 1) * sizeof(struct cover_candidate));
+  assert(heap != NULL);
+  covered = (unsigned char*) calloc((size_t) num_coverage_counters + 1, 1);
+  assert(covered != NULL);
+  len = 0;
+  for (i = 0; i < num_inputs; i++) {
+    if (coverage[i].num_counters > 0) {
+      heap[len].input = i;
+      heap[len].gain = coverage[i].num_counters;
+      len++;
+    }
+  }
+  for (i = len / 2; i > 0; i--) {
+    sift_down(heap, len, i - 1, coverage);
+  }
+
+  while (len > 0) {
+    gain = 0;
+    for (c = 0; c < coverage[heap[0].input].num_counters; c++) {
+      if (!covered[coverage[heap[0].input].counters[c]]) {
+        gain++;
+      }
+    }
+    if (gain > 0 && gain < heap[0].gain) {
+      /* The bound was stale, so another candidate may be better. */
+      heap[0].gain = gain;
+      sift_down(heap, len, 0, coverage);
+      continue;
+    }
+    if (gain > 0) {
+      selected[heap[0].input] = 1;
+      for (c = 0; c < coverage[heap[0].input].num_counters; c++) {
+        covered[coverage[heap[0].input].counters[c]] = 1;
+      }
+      num_covered += gain;
+    }
+    heap[0] = heap[--len];
+    sift_down(heap, len, 0, coverage);
+  }
+  free(covered);
+  free(heap);
+  return num_covered;
+}
+
+/* Copies the input at path to dir, named after a hash of its contents like the inputs libFuzzer adds to a corpus. */
+static void copy_input_to_dir(const char *path, const char *dir) {
+  struct path_buffer out_path = {NULL, 0, 0};
+  struct content_key key;
+  struct input in;
+  char name[20];
+  FILE *f;
 
-DEFINE_DEFAULT(int, LLVMFuzzerInitialize, (int *argc, char ***argv)) {
-  (void)argc;
-  (void)argv;
-  return 0;
+  load_input(path, &in);
+  compute_content_key(in.data, in.size, &key);
+  format_ulong(name, sizeof(name), "%08lx", (unsigned long) key.hash1);
+  format_ulong(name + 8, sizeof(name) - 8, "%08lx", (unsigned long) key.hash2);
+  path_buffer_append(&out_path, dir, strlen(dir));
+  path_buffer_push(&out_path, name);
+#ifdef _WIN32
+  fopen_s(&f, out_path.str, "wb");
+#else
+  f = fopen(out_path.str, "wb");
+#endif
+  if (f == NULL || fwrite(in.data, 1, in.size, f) != in.size || fclose(f) != 0) {
+    fprintf(stderr, "Failed to write '%s': ", out_path.str);
+    perror("");
+    exit(1);
+  }
+  free(out_path.str);
+  release_input(&in);
 }
 
-/* Set by the FUZZ_TEST macro defined in cifuzz.h. */
-DEFINE_DEFAULT(const char*, cifuzz_test_name, (void)) {
-  return NULL;
-}
+/* Runs the inputs in a coverage build and returns the counters hit by each of them. */
+static struct input_coverage *collect_coverage(const struct input_list *list) {
+  struct input_coverage *coverage;
+  int num_files;
+  int i;
 
-DEFINE_DEFAULT(const char*, cifuzz_seed_corpus, (void)) {
-  return NULL;
-}
+  coverage_counters = (uint32_t*) WITH_DEFAULT(__llvm_profile_begin_counters)();
+  if (coverage_counters == NULL) {
+    fprintf(stderr, "-minimize_to and -coverage_report require a coverage build (CIFUZZ_SANITIZERS=coverage)\n");
+    exit(1);
+  }
+  num_coverage_counters = (uint32_t) ((size_t) (WITH_DEFAULT(__llvm_profile_end_counters)()
+                                                - (char*) coverage_counters) / 8);
 
-DEFINE_DEFAULT(const char*, cifuzz_generated_corpus, (void)) {
-  return NULL;
+  num_files = 1;
+#if !defined(_WIN32)
+  if (flag_jobs > 1 && list->len > 1) {
+    num_files = num_workers_for(list);
+  }
+#endif
+  coverage_files = (FILE**) malloc((size_t) num_files * sizeof(FILE*));
+  assert(coverage_files != NULL);
+  for (i = 0; i < num_files; i++) {
+    /* Created before forking so that the workers write to files this process can read back. */
+    coverage_files[i] = tmpfile();
+    if (coverage_files[i] == NULL) {
+      perror("Failed to create temporary file");
+      exit(1);
+    }
+  }
+#if !defined(_WIN32)
+  if (num_files > 1) {
+    run_inputs_in_workers(list, collect_coverage_slice);
+  } else {
+    collect_coverage_slice(list, 0, 1);
+  }
+#else
+  collect_coverage_slice(list, 0, 1);
+#endif
+
+  coverage = (struct input_coverage*) calloc(list->len + 1, sizeof(struct input_coverage));
+  assert(coverage != NULL);
+  for (i = 0; i < num_files; i++) {
+    read_coverage(coverage_files[i], coverage, list->len);
+  }
+  free(coverage_files);
+  coverage_files = NULL;
+  return coverage;
 }
 
-/* Commonly called from LLVMFuzzerCustomMutator. We define it here to prevent linker errors. */
-C_LINKAGE size_t LLVMFuzzerMutate(uint8_t *Data, size_t Size, size_t MaxSize);
-size_t LLVMFuzzerMutate(uint8_t *Data, size_t Size, size_t MaxSize) {
-  (void) Data;
-  (void) Size;
-  (void) MaxSize;
-  assert(0 && "LLVMFuzzerMutate should only be called from LLVMFuzzerCustomMutator");
-  return 0;
+/* Copies a subset of the inputs that hits the same counters as all of them to flag_minimize_to, which replaces
+ * libFuzzer's -merge=1 for corpus minimization with the replayer. */
+static void minimize_inputs(const struct input_list *list, const struct input_coverage *coverage) {
+  unsigned char *selected;
+  uint32_t num_covered;
+  size_t num_selected;
+  size_t i;
+
+  selected = (unsigned char*) calloc(list->len + 1, 1);
+  assert(selected != NULL);
+  num_covered = select_covering_inputs(coverage, list->len, selected);
+  num_selected = 0;
+  for (i = 0; i < list->len; i++) {
+    if (selected[i]) {
+      copy_input_to_dir(list->paths[i], flag_minimize_to);
+      num_selected++;
+    }
+  }
+  fprintf(stderr, "\nMinimized %lu inputs to %lu inputs hitting the same %lu coverage counters in '%s'\n",
+          (unsigned long) list->len, (unsigned long) num_selected, (unsigned long) num_covered, flag_minimize_to);
+  free(selected);
 }
 
-/* Set by the CMake integration if a sanitizer is linked in.
- * Detecting this via compiler macros isn't possible since gcc does not define a macro for UBSan.
- * Using DEFINE_DEFAULT/WITH_DEFAULT isn't possible since sanitizer runtimes are usually linked dynamically and thus
- * don't override weak symbols.
- * TODO: If this ever becomes an issue with other build systems, replace the compile-time check with a dynamic lookup
- *       at runtime. */
-#ifdef CIFUZZ_HAS_SANITIZER
-C_LINKAGE void __sanitizer_set_death_callback(void (*callback)(void));
-#endif
+/* An input in the ranking written with -coverage_report. */
+struct coverage_rank {
+  size_t input;
+  uint32_t num_unique_counters;
+  uint32_t num_counters;
+};
 
-static void run_one_input(const unsigned char *data, size_t size) {
-  int res;
+static int compare_coverage_ranks(const void *a, const void *b) {
+  const struct coverage_rank *rank_a = (const struct coverage_rank*) a;
+  const struct coverage_rank *rank_b = (const struct coverage_rank*) b;
 
-  in_user_callback = 1;
-  res = LLVMFuzzerTestOneInput(data, size);
-  /* Avoid "unused but set variable" warnings if asserts are compiled out with NDEBUG. */
-  (void)res;
-  assert(res == 0);
-  in_user_callback = 0;
-  num_passing_inputs++;
+  if (rank_a->num_unique_counters != rank_b->num_unique_counters) {
+    return rank_a->num_unique_counters > rank_b->num_unique_counters ? -1 : 1;
+  }
+  if (rank_a->num_counters != rank_b->num_counters) {
+    return rank_a->num_counters > rank_b->num_counters ? -1 : 1;
+  }
+  return rank_a->input < rank_b->input ? -1 : rank_a->input > rank_b->input;
 }
 
-static void run_file(const char *path) {
+/* Writes every input with the number of counters it hits and the number of those that no other input hits to
+ * flag_coverage_report as JSON lines, ranked by the latter. */
+static void write_coverage_report(const struct input_list *list, const struct input_coverage *coverage) {
+  struct coverage_rank *ranks;
+  uint32_t *num_hitting_inputs;
   FILE *f;
-  size_t len;
-  unsigned char *buf;
-  size_t n_read;
-  long pos;
+  size_t i;
+  uint32_t c;
+
+  num_hitting_inputs = (uint32_t*) calloc((size_t) num_coverage_counters + 1, sizeof(uint32_t));
+  assert(num_hitting_inputs != NULL);
+  for (i = 0; i < list->len; i++) {
+    for (c = 0; c < coverage[i].num_counters; c++) {
+      num_hitting_inputs[coverage[i].counters[c]]++;
+    }
+  }
+  ranks = (struct coverage_rank*) malloc((list->len + 1) * sizeof(struct coverage_rank));
+  assert(ranks != NULL);
+  for (i = 0; i < list->len; i++) {
+    ranks[i].input = i;
+    ranks[i].num_counters = coverage[i].num_counters;
+    ranks[i].num_unique_counters = 0;
+    for (c = 0; c < coverage[i].num_counters; c++) {
+      if (num_hitting_inputs[coverage[i].counters[c]] == 1) {
+        ranks[i].num_unique_counters++;
+      }
+    }
+  }
+  if (list->len > 0) {
+    qsort(ranks, list->len, sizeof(struct coverage_rank), compare_coverage_ranks);
+  }
 
-  fprintf(stderr, "Running: %s\n", path);
 #ifdef _WIN32
-  /* fopen is deprecated in the Microsoft CRT. */
-    fopen_s(&f, path, "r");
+  fopen_s(&f, flag_coverage_report, "w");
 #else
-  /* fopen_s is not available in Unix C90 system headers. */
-  f = fopen(path, "r");
+  f = fopen(flag_coverage_report, "w");
 #endif
   if (f == NULL) {
-    perror("Failed to open file");
+    fprintf(stderr, "Failed to open coverage report '%s': ", flag_coverage_report);
+    perror("");
     exit(1);
   }
-  fseek(f, 0, SEEK_END);
-  pos = ftell(f);
-  if (pos < 0) {
-    perror("File is not seekable");
+  for (i = 0; i < list->len; i++) {
+    fprintf(f, "{\"input\":");
+    write_json_string(f, list->paths[ranks[i].input]);
+    fprintf(f, ",\"size\":%lu,\"counters\":%lu,\"unique_counters\":%lu}\n",
+            (unsigned long) coverage[ranks[i].input].size, (unsigned long) ranks[i].num_counters,
+            (unsigned long) ranks[i].num_unique_counters);
+  }
+  if (fclose(f) != 0) {
+    fprintf(stderr, "Failed to write coverage report '%s': ", flag_coverage_report);
+    perror("");
     exit(1);
   }
-  len = (size_t) pos;
-  fseek(f, 0, SEEK_SET);
-  buf = (unsigned char*)malloc(len);
-  assert(buf != NULL);
-  n_read = fread(buf, 1, len, f);
-  fclose(f);
-  assert(n_read == len);
-  current_input = path;
-  run_one_input(buf, len);
-  current_input = NULL;
-  free(buf);
-  fprintf(stderr, "Done:    %s (%ld bytes)\n", path, (unsigned long) n_read);
+  fprintf(stderr, "\nWrote the coverage of %lu inputs to '%s'\n", (unsigned long) list->len, flag_coverage_report);
+  free(ranks);
+  free(num_hitting_inputs);
 }
 
-static void run_file_or_dir(const char *path);
-
-static void run_dir_entry(const char *dir, const char *file) {
-  char *path;
-  size_t path_size;
+/* Collects the coverage of every input once for -minimize_to and -coverage_report. */
+static void run_coverage_mode(const struct input_list *list) {
+  struct input_coverage *coverage;
+  struct POSIX_STAT stat_info;
+  size_t num_hit;
+  size_t i;
 
-  /* Skip hidden files as well as "." and "..". File names can't be empty. */
-  if (file[0] == '.') {
-    return;
+  if (flag_minimize_to != NULL
+      && (POSIX_STAT(flag_minimize_to, &stat_info) != 0 || !(stat_info.st_mode & POSIX_S_IFDIR))) {
+    fprintf(stderr, "-minimize_to=%s is not an existing directory\n", flag_minimize_to);
+    exit(1);
+  }
+  coverage = collect_coverage(list);
+  num_hit = 0;
+  for (i = 0; i < list->len; i++) {
+    num_hit += coverage[i].num_counters;
+  }
+  if (num_hit == 0 && list->len > 0) {
+    fprintf(stderr, "WARNING: The inputs didn't hit any coverage counters. Continuous mode (%%c in LLVM_PROFILE_FILE)"
+                    " is not supported with -minimize_to and -coverage_report.\n");
+  }
+  if (flag_minimize_to != NULL) {
+    minimize_inputs(list, coverage);
   }
+  if (flag_coverage_report != NULL) {
+    write_coverage_report(list, coverage);
+  }
+  for (i = 0; i < list->len; i++) {
+    free(coverage[i].counters);
+  }
+  free(coverage);
+}
 
-  /* +1 for path separator, +1 for "\0". */
-  path_size = strlen(dir) + 1 + strlen(file) + 1;
-  path = (char*)malloc(path_size);
-  assert(path != NULL);
+/* Runs the inputs whose paths are read line by line from stdin, replying after each one. Failing inputs are replied
+ * to from print_summary, right before the process terminates. */
+static void run_server(void) {
+  char *path;
+  size_t len;
+
+  if (flag_server_reply_fd == 2) {
+    server_reply_stream = stderr;
+  } else {
 #ifdef _WIN32
-  /* sprintf is deprecated in the Microsoft CRT. */
-  sprintf_s(path, path_size, "%s\\%s", dir, file);
-#elif __APPLE__
-  /* sprintf is deprecated in macOS LLVM. */
-  snprintf(path, path_size, "%s/%s", dir, file);
+    server_reply_stream = _fdopen(flag_server_reply_fd, "w");
 #else
-  /* sprintf_s and snprintf are not available in Unix C90 system headers. */
-  sprintf(path, "%s/%s", dir, file);
+    server_reply_stream = fdopen(flag_server_reply_fd, "w");
 #endif
-  run_file_or_dir(path);
-  free(path);
-}
+    if (server_reply_stream == NULL) {
+      fprintf(stderr, "Failed to open reply file descriptor %d: ", flag_server_reply_fd);
+      perror("");
+      exit(1);
+    }
+  }
 
+  while ((path = read_line(stdin)) != NULL) {
+    len = strlen(path);
+    if (len > 0 && path[len - 1] == '\r') {
+      path[len - 1] = '\0';
+    }
+    if (path[0] == '\0') {
+      free(path);
+      continue;
+    }
 #if !defined(_WIN32)
-/* Resets errno before calling readdir to ensure that previous errors aren't taken for readdir failures. */
-static struct dirent* clear_errno_readdir(DIR *dirp) {
-  errno = 0;
-  return readdir(dirp);
-}
+    if (flag_keep_going) {
+      run_server_input_isolated(path);
+      free(path);
+      continue;
+    }
 #endif
-
-static void traverse_dir(const char *path) {
-#if defined(_WIN32)
-  WIN32_FIND_DATA fd;
-  HANDLE h_find;
-  char *filter;
-  size_t filter_size;
-
-  /* +2 for "\*", +1 for "\0". */
-  filter_size = strlen(path) + 3;
-  filter = (char*)malloc(filter_size);
-  assert(filter != NULL);
-  sprintf_s(filter, filter_size, "%s\\*", path);
-  if ((h_find = FindFirstFile(filter, &fd)) == INVALID_HANDLE_VALUE) {
-    /* TODO: Include the stringified last error in the message. */
-    fprintf(stderr, "Failed to list files in '%s'\n", path);
-    exit(1);
+    run_file(path);
+    fprintf(server_reply_stream, "PASS\t%s\n", path);
+    fflush(server_reply_stream);
+    free(path);
   }
-  do {
-    run_dir_entry(path, fd.cFileName);
-  } while (FindNextFile(h_find, &fd) != 0);
-  if (GetLastError() != ERROR_NO_MORE_FILES) {
-    /* TODO: Include the stringified last error in the message. */
-    fprintf(stderr, "Failed to list files in '%s'\n", path);
-    exit(1);
+#if !defined(_WIN32)
+  merge_gcov_shards();
+  if (num_failures > 0) {
+    /* Prints all failures via the exit handler. */
+    exit(first_failure_exit_code);
   }
-  FindClose(h_find);
-  free(filter);
-#else
-  DIR *dir;
-  struct dirent *dir_entry;
+#endif
+}
 
-  dir = opendir(path);
-  if (dir == NULL) {
-    fprintf(stderr, "Failed to open directory '%s': %s\n", path, strerror(errno));
+/* The record run by run_stream, saved by print_summary if it fails. */
+static const unsigned char *current_stream_record = NULL;
+static size_t current_stream_record_size = 0;
+static unsigned long current_stream_record_index = 0;
+static char stream_record_name[64];
+
+/* Reads the next record of the stream into the reusable buffer. Returns zero at the end of the stream. */
+static int read_stream_record(FILE *f, struct input *in) {
+  unsigned char header[4];
+  unsigned char *new_buf;
+  size_t len;
+  size_t size;
+
+  len = fread(header, 1, sizeof(header), f);
+  if (len == 0 && feof(f)) {
+    return 0;
+  }
+  if (len != sizeof(header)) {
+    if (ferror(f)) {
+      perror("Failed to read input stream");
+    } else {
+      fprintf(stderr, "Input stream ended within the size of a record\n");
+    }
     exit(1);
   }
-  while ((dir_entry = clear_errno_readdir(dir)) != NULL) {
-    run_dir_entry(path, dir_entry->d_name);
+  size = (size_t) read_le32(header);
+  if (size == 0) {
+    set_empty_input(in);
+    return 1;
   }
-  if (errno != 0) {
-    fprintf(stderr, "Failed to list files in '%s': %s\n", path, strerror(errno));
+  if (size > reusable_buf_capacity) {
+    reusable_buf_capacity = size > 2 * reusable_buf_capacity ? size : 2 * reusable_buf_capacity;
+    new_buf = (unsigned char*) realloc(reusable_buf, reusable_buf_capacity);
+    assert(new_buf != NULL);
+    reusable_buf = new_buf;
+  }
+  if (fread(reusable_buf, 1, size, f) != size) {
+    if (ferror(f)) {
+      perror("Failed to read input stream");
+    } else {
+      fprintf(stderr, "Input stream ended within a record of %lu bytes\n", (unsigned long) size);
+    }
     exit(1);
   }
-  closedir(dir);
+  in->data = reusable_buf;
+  in->size = size;
+  in->storage = INPUT_REUSABLE_BUFFER;
+  poison_slack(in->data, in->size, reusable_buf_capacity);
+  return 1;
+}
+
+/* Runs the inputs read as length-prefixed records from path (stdin if "-"), so that generators can feed inputs to the
+ * fuzz test without writing them to files first. */
+static void run_stream(const char *path) {
+  FILE *f;
+  struct input in;
+
+  if (strcmp(path, "-") == 0) {
+    f = stdin;
+#ifdef _WIN32
+    /* Prevent the CRT from translating line endings in the records. */
+    _setmode(_fileno(stdin), _O_BINARY);
 #endif
+  } else {
+    f = open_input_file(path);
+  }
+  if (flag_keep_going || flag_jobs > 1) {
+    fprintf(stderr, "WARNING: -keep_going and -jobs are not supported with -stream_inputs, running inputs sequentially"
+                    "\n");
+  }
+  for (current_stream_record_index = 0; read_stream_record(f, &in); current_stream_record_index++) {
+    format_ulong(stream_record_name, sizeof(stream_record_name), "<stream record %lu>", current_stream_record_index);
+    log_input_started(stream_record_name);
+    current_input = stream_record_name;
+    current_stream_record = in.data;
+    current_stream_record_size = in.size;
+    run_one_input(in.data, in.size);
+    current_stream_record = NULL;
+    current_input = NULL;
+    log_input_done(stream_record_name, in.size);
+    release_input(&in);
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
 }
 
-static void run_file_or_dir(const char *path) {
-  int res;
-  struct POSIX_STAT stat_info;
+/* Writes the failing stream record to a file so that it can be reproduced like any other input, and refers to that
+ * file in the summary. */
+static void save_failing_stream_record(void) {
+  static char path[64];
+  FILE *f;
 
-  res = POSIX_STAT(path, &stat_info);
-  if (res != 0) {
-    fprintf(stderr, "Failed to access '%s': ", path);
-    /* strerror is deprecated in the Microsoft CRT. */
-    perror("");
-    exit(1);
+  format_ulong(path, sizeof(path), "crash-stream-record-%lu", current_stream_record_index);
+#ifdef _WIN32
+  fopen_s(&f, path, "wb");
+#else
+  f = fopen(path, "wb");
+#endif
+  if (f == NULL) {
+    return;
   }
-  if (stat_info.st_mode & POSIX_S_IFDIR) {
-    traverse_dir(path);
-  } else if (stat_info.st_mode & POSIX_S_IFREG) {
-    run_file(path);
-  } else {
-    fprintf(stderr, "File type of '%s' is unsupported: %d\n", path, stat_info.st_mode);
-    exit(1);
+  if (fwrite(current_stream_record, 1, current_stream_record_size, f) == current_stream_record_size
+      && fclose(f) == 0) {
+    current_input = path;
+    return;
+  }
+  fclose(f);
+}
+
+static void reply_to_server_client(const char *failure_reason) {
+  if (all_inputs_passed || !in_user_callback || current_input == NULL) {
+    return;
   }
+  fprintf(server_reply_stream, "FAIL\t%s\t%s\n", failure_reason != NULL ? failure_reason : "Unknown", current_input);
+  fflush(server_reply_stream);
 }
 
 static void print_clion_doctest_xml() {
@@ -402,11 +4909,73 @@ static void print_clion_doctest_xml() {
       "</doctest>\n", all_inputs_passed, !all_inputs_passed);
 }
 
-#define COLOR_RED "\x1b[31m"
-#define COLOR_YELLOW "\x1b[93m"
-#define COLOR_RESET "\x1b[0m"
+static void print_timing_summary(void) {
+  int i;
+
+  if (num_timed_inputs == 0) {
+    return;
+  }
+  fprintf(stderr, "\nTime per input: total %.3f s, mean %.3f ms, p99 %.3f ms, max %.3f ms\n",
+          total_input_seconds, total_input_seconds / num_timed_inputs * 1e3, latency_percentile(99) * 1e3,
+          max_input_seconds * 1e3);
+  if (num_slowest_inputs > 0) {
+    fprintf(stderr, "Slowest inputs:\n");
+  }
+  for (i = 0; i < num_slowest_inputs; i++) {
+    fprintf(stderr, "  %10.3f ms  %s (%lu bytes)\n", slowest_inputs[i].seconds * 1e3, slowest_inputs[i].path,
+            (unsigned long) slowest_inputs[i].size);
+  }
+}
+
+static void write_timing_output_summary(void) {
+  fprintf(timing_output_file, "{\"type\":\"summary\",\"passed\":%s,\"inputs\":%d,\"total_seconds\":%.9f,"
+          "\"mean_seconds\":%.9f,\"p99_seconds\":%.9f,\"max_seconds\":%.9f}\n", all_inputs_passed ? "true" : "false",
+          num_timed_inputs, total_input_seconds, num_timed_inputs > 0 ? total_input_seconds / num_timed_inputs : 0,
+          latency_percentile(99), max_input_seconds);
+  fflush(timing_output_file);
+}
 
 static void print_summary(const char *failure_reason) {
+#if !defined(_WIN32)
+  if (replay_threads != NULL) {
+    claim_thread_summary();
+  }
+  if (worker_result_pipe != NULL) {
+    report_to_parent(failure_reason);
+    return;
+  }
+#endif
+  if (current_stream_record != NULL && in_user_callback && !all_inputs_passed) {
+    save_failing_stream_record();
+  }
+  if (server_reply_stream != NULL) {
+    reply_to_server_client(failure_reason);
+  }
+  if (timing_output_file != NULL) {
+    write_timing_output_summary();
+  }
+  if (flag_print_timing) {
+    print_timing_summary();
+  }
+  if (num_duplicate_inputs > 0) {
+    fprintf(stderr, "\nSkipped %d duplicate inputs\n", num_duplicate_inputs);
+  }
+  if (num_cached_inputs > 0) {
+    fprintf(stderr, "\nSkipped %d inputs that passed in a previous run, see -pass_cache\n", num_cached_inputs);
+  }
+  if (num_unaffected_inputs > 0) {
+    fprintf(stderr, "\nSkipped %d inputs that don't cover any of the changed files, see -impact_map\n",
+            num_unaffected_inputs);
+  }
+#if !defined(_WIN32)
+  if (num_failures > 0) {
+    print_failures();
+    if (launched_as_clion_doctest) {
+      print_clion_doctest_xml();
+    }
+    return;
+  }
+#endif
   if (all_inputs_passed) {
     fprintf(stderr, "\nRan fuzz test on %d inputs - passed\n\n", num_passing_inputs);
     fprintf(stderr, COLOR_YELLOW
@@ -448,6 +5017,16 @@ static void print_summary(const char *failure_reason) {
 }
 
 static void explicit_exit_handler(void) {
+  if (flag_help) {
+    /* No inputs have been run. */
+    return;
+  }
+#if !defined(_WIN32)
+  if (worker_failure_reason != NULL) {
+    print_summary(worker_failure_reason);
+    return;
+  }
+#endif
   print_summary("Fuzz target exited");
 }
 
@@ -500,8 +5079,51 @@ static int is_clion_doctest_arg(const char *arg) {
   return 1;
 }
 
+/* Exits if -threads is combined with options that keep per-input state in globals or require a process per input. */
+static void check_threads_flag(void) {
+  const char *conflicting_flag = NULL;
+
+  if (flag_threads <= 1) {
+    return;
+  }
+#if defined(_WIN32)
+  fprintf(stderr, "WARNING: -threads is not supported on Windows, running inputs sequentially\n");
+  flag_threads = 1;
+  (void) conflicting_flag;
+#else
+  if (!WITH_DEFAULT(cifuzz_test_thread_safe)()) {
+    fprintf(stderr, "-threads requires a fuzz test declared thread-safe with FUZZ_TEST_THREAD_SAFE\n");
+    exit(1);
+  }
+  if (flag_jobs > 1) {
+    conflicting_flag = "-jobs";
+  } else if (flag_keep_going) {
+    conflicting_flag = "-keep_going";
+  } else if (flag_server) {
+    conflicting_flag = "-server";
+  } else if (flag_stream_inputs != NULL) {
+    conflicting_flag = "-stream_inputs";
+  } else if (flag_reuse_input_buffer) {
+    conflicting_flag = "-reuse_input_buffer";
+  } else if (flag_minimize_to != NULL || flag_coverage_report != NULL) {
+    conflicting_flag = "-minimize_to and -coverage_report";
+  } else if (profile_flush_path != NULL) {
+    conflicting_flag = "-profile_flush_inputs and -profile_flush_seconds";
+  } else if (flag_gcov_shard_dir != NULL) {
+    conflicting_flag = "-gcov_shard_dir";
+  }
+  if (conflicting_flag != NULL) {
+    fprintf(stderr, "-threads can't be combined with %s\n", conflicting_flag);
+    exit(1);
+  }
+#endif
+}
+
 int main(int argc, char **argv) {
   int i;
+  int num_inputs;
+  struct input_list inputs = {NULL, 0, 0};
+  char *pass_cache_key = NULL;
   unsigned char empty[1];
   char *seed_corpus_path;
   size_t seed_corpus_path_size;
@@ -545,14 +5167,58 @@ int main(int argc, char **argv) {
 
   WITH_DEFAULT(LLVMFuzzerInitialize)(&argc, &argv);
 
-  /* If no arguments are specified, run the empty input and the seed corpus at argv[0] + SEED_CORPUS_SUFFIX
+  /* Like libFuzzer, parse flags only after LLVMFuzzerInitialize had a chance to modify the arguments. */
+  num_inputs = 0;
+  for (i = 1; i < argc; i++) {
+    if (is_flag(argv[i])) {
+      parse_flag(argv[i]);
+    } else {
+      num_inputs++;
+    }
+  }
+  if (flag_help) {
+    print_help();
+    return 0;
+  }
+  if (flag_total_shards < 1 || flag_shard_index < 0 || flag_shard_index >= flag_total_shards) {
+    fprintf(stderr, "Invalid sharding: -shard_index=%d must be in [0, -total_shards=%d)\n", flag_shard_index,
+            flag_total_shards);
+    return 1;
+  }
+  if ((flag_impact_map == NULL) != (flag_changed_files == NULL)) {
+    fprintf(stderr, "-impact_map and -changed_files have to be used together\n");
+    return 1;
+  }
+  if (strcmp(flag_order, "path") != 0 && strcmp(flag_order, "size") != 0) {
+    fprintf(stderr, "Invalid value for flag -order: '%s', must be 'path' or 'size'\n", flag_order);
+    return 1;
+  }
+  timing_enabled = flag_print_timing || flag_timing_output != NULL;
+  open_timing_output();
+  init_profile_flush();
+  init_gcov_shards();
+  watchdog_enabled = flag_timeout > 0 || flag_rss_limit_mb > 0;
+  check_threads_flag();
+  check_leak_check_flag();
+  if (flag_server) {
+    run_server();
+    all_inputs_passed = 1;
+    return 0;
+  }
+  if (flag_stream_inputs != NULL) {
+    run_stream(flag_stream_inputs);
+    all_inputs_passed = 1;
+    return 0;
+  }
+
+  /* If no inputs are specified, run the empty input and the seed corpus at argv[0] + SEED_CORPUS_SUFFIX
    * Note: On Windows, ".exe" is stripped from argv[0] before forming the seed corpus path. */
-  if (argc == 1) {
+  if (num_inputs == 0) {
     /* Run the fuzz test on the empty input. This serves as a simple check to catch runtime issues in the fuzz test
      * setup (e.g. dynamic linking problems). */
-    fprintf(stderr, "Running: <empty input>\n");
+    log_input_started("<empty input>");
     run_one_input(&empty[0], 0);
-    fprintf(stderr, "Done:    <empty input>: (0 bytes)\n");
+    log_input_done("<empty input>", 0);
 
     /* If the build system integration provided the path to the seed corpus at build time via the cifuzz_seed_corpus
      * symbol, use that path. Otherwise, e.g. in case of no special build system support, look in a well-known location
@@ -561,7 +5227,7 @@ int main(int argc, char **argv) {
     if (WITH_DEFAULT(cifuzz_seed_corpus)() != NULL) {
       /* Only run the seed corpus if it exists, either as a single file or a directory. */
       if (POSIX_STAT(WITH_DEFAULT(cifuzz_seed_corpus)(), &stat_info) == 0) {
-        run_file_or_dir(WITH_DEFAULT(cifuzz_seed_corpus)());
+        collect_file_or_dir(WITH_DEFAULT(cifuzz_seed_corpus)(), &inputs);
       }
     } else {
       seed_corpus_path_size = strlen(argv[0]) + strlen(SEED_CORPUS_SUFFIX) + 1;
@@ -581,7 +5247,7 @@ int main(int argc, char **argv) {
 #endif
       /* Only run the seed corpus if it exists, either as a single file or a directory. */
       if (POSIX_STAT(seed_corpus_path, &stat_info) == 0) {
-        run_file_or_dir(seed_corpus_path);
+        collect_file_or_dir(seed_corpus_path, &inputs);
       }
       free(seed_corpus_path);
     }
@@ -589,13 +5255,43 @@ int main(int argc, char **argv) {
      * should be run in addition to the seed corpus. */
     if (WITH_DEFAULT(cifuzz_generated_corpus)() != NULL) {
       if (POSIX_STAT(WITH_DEFAULT(cifuzz_generated_corpus)(), &stat_info) == 0) {
-        run_file_or_dir(WITH_DEFAULT(cifuzz_generated_corpus)());
+        collect_file_or_dir(WITH_DEFAULT(cifuzz_generated_corpus)(), &inputs);
       }
     }
   }
 
   for (i = 1; i < argc; i++) {
-    run_file_or_dir(argv[i]);
+    if (!is_flag(argv[i])) {
+      collect_file_or_dir(argv[i], &inputs);
+    }
+  }
+  if (flag_dedup_inputs) {
+    dedup_inputs(&inputs);
+  }
+  select_shard(&inputs);
+  if (flag_impact_map != NULL) {
+    select_affected_inputs(&inputs);
+  }
+  if (flag_minimize_to != NULL || flag_coverage_report != NULL) {
+    run_coverage_mode(&inputs);
+    free_input_list(&inputs);
+    all_inputs_passed = 1;
+    return 0;
+  }
+  if (flag_pass_cache != NULL) {
+    pass_cache_key = pass_cache_build_key();
+    if (pass_cache_key != NULL) {
+      skip_cached_inputs(&inputs, pass_cache_key);
+    } else {
+      fprintf(stderr, "WARNING: Failed to identify the fuzz test binary, pass -pass_cache_key to use -pass_cache\n");
+    }
+  }
+  order_inputs(&inputs);
+  run_inputs(&inputs);
+  free_input_list(&inputs);
+  if (pass_cache_key != NULL) {
+    write_pass_cache(pass_cache_key);
+    free(pass_cache_key);
   }
 
   all_inputs_passed = 1;
@@ -2,9 +2,13 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /* volatile to prevent compiler optimizations, global to prevent unused-but-set-variable warnings */
 static volatile int some_int = INT_MAX;
+/* Holds the only pointer to the memory leaked on 'leak' until it is overwritten. */
+static char *volatile leak_sink = NULL;
 
 #ifndef DISABLE_FUZZER_INITIALIZE
 int LLVMFuzzerInitialize(int *argc, char ***argv) {
@@ -13,19 +17,32 @@ int LLVMFuzzerInitialize(int *argc, char ***argv) {
 }
 #endif
 
+#ifdef DECLARE_THREAD_SAFE
+/* Like FUZZ_TEST_THREAD_SAFE, allows the replayer to run inputs with -threads. */
+int cifuzz_test_thread_safe(void) {
+  return 1;
+}
+#endif
+
 /*
  * This fuzz target behaves as follows on these particular inputs:
  *   - 'asan': Produces an ASan finding.
  *   - 'ubsan': Produces a UBSan finding.
  *   - 'assert': Fails an assert.
  *   - 'return': Returns a non-zero value.
+ *   - 'hang': Never returns.
+ *   - 'oom': Allocates and touches 256 MB.
+ *   - 'leak': Leaks 16 bytes (detected by LSan).
  *   - all other values: Prints the input to stdout interpreted as ASCII,
  *                       wrapped in single quotes and followed by a newline.
+ *                       The line is written at once, so that the lines of
+ *                       inputs run on different threads don't interleave.
  *
  * The fuzz target also sets errno to a non-zero value. The replayer should ignore this.
  */
 int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
-  size_t i;
+  char *memory;
+  char *line;
 
   if (size == 4 && data[0] == 'a' && data[1] == 's' && data[2] == 'a' && data[3] == 'n') {
     /* Out-of-bounds read (detected by ASan). */
@@ -39,14 +56,30 @@ int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
   } else if (size == 6 && data[0] == 'r' && data[1] == 'e' && data[2] == 't' && data[3] == 'u' && data[4] == 'r'
       && data[5] == 'n') {
     return 1;
+  } else if (size == 4 && data[0] == 'h' && data[1] == 'a' && data[2] == 'n' && data[3] == 'g') {
+    /* The volatile write keeps the loop from being optimized out. */
+    for (;;) {
+      some_int = 0;
+    }
+  } else if (size == 3 && data[0] == 'o' && data[1] == 'o' && data[2] == 'm') {
+    memory = (char*) malloc(256 << 20);
+    assert(memory != NULL);
+    memset(memory, 1, 256 << 20);
+    some_int = memory[some_int % (256 << 20)];
+    free(memory);
+  } else if (size == 4 && data[0] == 'l' && data[1] == 'e' && data[2] == 'a' && data[3] == 'k') {
+    leak_sink = (char*) malloc(16);
+    leak_sink = NULL;
   }
 
-  putchar('\'');
-  for (i = 0; i < size; i++) {
-    putchar(data[i]);
-  }
-  putchar('\'');
-  putchar('\n');
+  line = (char*) malloc(size + 3);
+  assert(line != NULL);
+  line[0] = '\'';
+  memcpy(line + 1, data, size);
+  line[size + 1] = '\'';
+  line[size + 2] = '\n';
+  fwrite(line, 1, size + 3, stdout);
+  free(line);
   /* Ensure that all output has been written in case the next execution crashes. */
   fflush(stdout);
   /* Set errno to a non-zero value to verify that this doesn't cause errors in the replayer. */
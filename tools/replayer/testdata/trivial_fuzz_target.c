@@ -0,0 +1,8 @@
+#include <stddef.h>
+
+/* Returns immediately, so that benchmarks of the replayer only measure its own overhead per input. */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+  (void) data;
+  (void) size;
+  return 0;
+}
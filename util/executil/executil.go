@@ -62,6 +62,9 @@ func CommandContext(ctx context.Context, name string, arg ...string) *Cmd {
 // In contrast to StdoutPipe, Wait will *not* automatically close the
 // pipe, so it's the caller's responsibility to close the pipe. In effect,
 // it is fine to call Wait before all reads from the pipe have completed.
+//
+// If writer is io.Discard, the pipe is passed to the command directly,
+// so that the output isn't copied by an extra goroutine.
 func (c *Cmd) StdoutTeePipe(writer io.Writer) (io.ReadCloser, error) {
 	if c.Stdout != nil {
 		return nil, errors.New("exec: Stdout already set")
@@ -73,7 +76,7 @@ func (c *Cmd) StdoutTeePipe(writer io.Writer) (io.ReadCloser, error) {
 	if err != nil {
 		return nil, errors.WithStack(err)
 	}
-	c.Stdout = io.MultiWriter(writer, pw)
+	c.Stdout = teeWriter(writer, pw)
 	c.CloseAfterWait = append(c.CloseAfterWait, pw)
 	return pr, nil
 }
@@ -90,11 +93,18 @@ func (c *Cmd) StderrTeePipe(writer io.Writer) (io.ReadCloser, error) {
 	if err != nil {
 		return nil, errors.WithStack(err)
 	}
-	c.Stderr = io.MultiWriter(writer, pw)
+	c.Stderr = teeWriter(writer, pw)
 	c.CloseAfterWait = append(c.CloseAfterWait, pw)
 	return pr, nil
 }
 
+func teeWriter(writer io.Writer, pw *os.File) io.Writer {
+	if writer == io.Discard {
+		return pw
+	}
+	return io.MultiWriter(writer, pw)
+}
+
 // Does the same as exec.Cmd.Start(), but also closes the write ends of
 // tee pipes (if there are any) on the same errors that exec.Cmd.Start()
 // closes its open pipes.